@@ -0,0 +1,159 @@
+// Bindings and helpers shared by the ray tracing library of the megakernel (Raytracing.hlsl), the stages of the
+// wavefront mode (Wavefront.hlsl, WavefrontTrace.hlsl) and the inline ray tracing path (RaytracingInline.hlsl), which
+// all use the global root signature of src/Raytracing.cpp.
+
+// Global root signature
+RaytracingAccelerationStructure Scene : register(t0, space0);
+ByteAddressBuffer Geometry : register(t1, space0);
+ByteAddressBuffer SamplerTables : register(t2, space0);     // SerializeSamplerTables() of src/Sampler.h
+RWTexture2D<float4> RenderTarget : register(u0, space0);
+RWTexture2D<float4> Accumulation : register(u1, space0);     // radiance sum of the path tracing samples
+
+cbuffer GeometryConstants : register(b0, space0)
+{
+    uint MeshInfoOffset;    // Byte offset of the MeshInfo array in Geometry
+
+    // Camera basis, must match CameraConstants in src/Camera.h
+    float3 CameraPosition;
+    float3 CameraForward;
+    float CameraTanHalfFovY;
+    float3 CameraRight;
+    float CameraAspectRatio;
+    float3 CameraUp;
+
+    // Path tracing: sample of this frame, 0 restarts the accumulation, the path length limit and the SAMPLER_TYPE_* of
+    // the random numbers
+    uint SampleIndex;
+    uint MaxBounces;
+    uint SamplerType;
+
+    // Wavefront mode: bounce of the stages, set before the stages of every bounce
+    uint WavefrontBounce;
+};
+
+// Per mesh description, must match MeshInfo in src/GeometryStreams.h
+struct MeshInfo
+{
+    uint positionOffset;
+    uint positionFormat;
+    uint indexOffset;
+    uint indexStride;
+    uint attributeOffset;
+    uint colorFormat;
+    uint vertexCount;
+    uint primitiveCount;
+};
+
+static const uint COLOR_FORMAT_RGBA8 = 0;
+static const uint COLOR_FORMAT_RGB10A2 = 1;
+
+MeshInfo LoadMeshInfo(uint meshIndex)
+{
+    uint address = MeshInfoOffset + meshIndex * 32;
+    uint4 data0 = Geometry.Load4(address);
+    uint4 data1 = Geometry.Load4(address + 16);
+
+    MeshInfo info;
+    info.positionOffset = data0.x;
+    info.positionFormat = data0.y;
+    info.indexOffset = data0.z;
+    info.indexStride = data0.w;
+    info.attributeOffset = data1.x;
+    info.colorFormat = data1.y;
+    info.vertexCount = data1.z;
+    info.primitiveCount = data1.w;
+    return info;
+}
+
+uint3 LoadTriangleIndices(MeshInfo info, uint primitiveIndex)
+{
+    if (info.indexStride == 2)
+    {
+        // Three 16-bit indices, the load address must be 4 byte aligned
+        uint address = info.indexOffset + primitiveIndex * 6;
+        uint alignedAddress = address & ~3u;
+        uint2 data = Geometry.Load2(alignedAddress);
+        if (address == alignedAddress)
+        {
+            return uint3(data.x & 0xffff, data.x >> 16, data.y & 0xffff);
+        }
+        return uint3(data.x >> 16, data.y & 0xffff, data.y >> 16);
+    }
+    return Geometry.Load3(info.indexOffset + primitiveIndex * 12);
+}
+
+float DecodeSnorm16(uint value)
+{
+    int signedValue = int(value << 16) >> 16;
+    return max(float(signedValue) / 32767.0f, -1.0f);
+}
+
+// Inverse of EncodeOctahedralNormal in src/GeometryStreams.cpp
+float3 DecodeOctahedralNormal(uint encoded)
+{
+    float2 e = float2(DecodeSnorm16(encoded & 0xffff), DecodeSnorm16(encoded >> 16));
+    float3 n = float3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return normalize(n);
+}
+
+float4 UnpackColor(uint packed, uint format)
+{
+    if (format == COLOR_FORMAT_RGB10A2)
+    {
+        return float4(packed & 0x3ff, (packed >> 10) & 0x3ff, (packed >> 20) & 0x3ff, packed >> 30) / float4(1023.0f, 1023.0f, 1023.0f, 3.0f);
+    }
+    return float4(packed & 0xff, (packed >> 8) & 0xff, (packed >> 16) & 0xff, packed >> 24) / 255.0f;
+}
+
+// Ray types of the DXR pipelines, the index of the miss record and of the hit group record of a geometry. Must match
+// RayTypes in src/Raytracing.h.
+static const uint RAY_TYPE_RADIANCE = 0;
+static const uint RAY_TYPE_SHADOW = 1;      // occlusion only, no closest hit and a 4 byte payload
+static const uint RAY_TYPE_COUNT = 2;
+
+// Payloads and hit attributes of the DXR pipelines, ShadowPayload is shared by both
+#include "RayPayloads.hlsli"
+
+// Same ray interval for all rays
+static const float RAY_T_MIN = 0.001f;
+static const float RAY_T_MAX = 10000.0f;
+
+// Direction of the primary ray through the center of a pixel, GetCameraRayDirection() in src/Camera.cpp computes the same
+float3 GetCameraRayDirection(uint2 index, uint2 dimensions)
+{
+    // Calculate normalized screen coordinates
+    float2 screenCoord = (float2(index) + 0.5f) / float2(dimensions);
+    screenCoord = screenCoord * 2.0f - 1.0f;
+    screenCoord.y = -screenCoord.y; // Flip Y coordinate
+
+    return normalize(
+        CameraForward +
+        CameraRight * screenCoord.x * CameraAspectRatio * CameraTanHalfFovY +
+        CameraUp * screenCoord.y * CameraTanHalfFovY
+    );
+}
+
+// Interpolated object space normal and vertex color of a triangle
+void GetHitAttributes(uint meshIndex, uint primitiveIndex, float2 attributeBarycentrics, out float3 objectNormal, out float4 color)
+{
+    float3 barycentrics = float3(1.0f - attributeBarycentrics.x - attributeBarycentrics.y,
+                                 attributeBarycentrics.x,
+                                 attributeBarycentrics.y);
+
+    // Fetch the packed attributes of the triangle
+    MeshInfo info = LoadMeshInfo(meshIndex);
+    uint3 indices = LoadTriangleIndices(info, primitiveIndex);
+
+    objectNormal = float3(0.0f, 0.0f, 0.0f);
+    color = float4(0.0f, 0.0f, 0.0f, 0.0f);
+    [unroll]
+    for (uint i = 0; i < 3; ++i)
+    {
+        uint2 attributes = Geometry.Load2(info.attributeOffset + indices[i] * 8);
+        objectNormal += DecodeOctahedralNormal(attributes.x) * barycentrics[i];
+        color += UnpackColor(attributes.y, info.colorFormat) * barycentrics[i];
+    }
+}
@@ -0,0 +1,207 @@
+// Path tracing estimator of the megakernel (Raytracing.hlsl), the wavefront stages (Wavefront.hlsl,
+// WavefrontTrace.hlsl) and the inline RayQuery shader (RaytracingInline.hlsl), must match src/PathTracing.h and
+// src/PathTracing.cpp so that CpuRaytracer::RenderPathTraced() converges to the same image.
+
+#include "Sampler.hlsli"
+
+static const float PATH_TRACING_PI = 3.14159265f;
+
+static const uint ROULETTE_START_BOUNCE = 3;
+static const float ROULETTE_MAX_SURVIVAL = 0.95f;
+
+// Sky and sun disk, the sun irradiance at normal incidence is pi
+static const float3 SUN_DIRECTION = float3(0.40824829f, 0.81649658f, 0.40824829f);
+static const float SUN_COS_ANGULAR_RADIUS = 0.99875026f;
+static const float SUN_SOLID_ANGLE = 2.0f * PATH_TRACING_PI * (1.0f - SUN_COS_ANGULAR_RADIUS);
+static const float SUN_RADIANCE = PATH_TRACING_PI / SUN_SOLID_ANGLE;
+static const float3 SKY_RADIANCE = float3(0.2f, 0.4f, 0.6f);
+static const float SUN_SAMPLE_PROBABILITY = 0.5f;
+
+static const uint RANDOM_NUMBERS_PER_BOUNCE = 6;
+
+// Sample groups of a bounce by their first random number: light, BSDF, Russian roulette
+static const uint SAMPLE_GROUPS_PER_BOUNCE = 3;
+static const uint SAMPLE_GROUP_OFFSETS[SAMPLE_GROUPS_PER_BOUNCE + 1] = { 0, 3, 5, RANDOM_NUMBERS_PER_BOUNCE };
+
+uint InitPathRandom(uint pixelIndex, uint sampleIndex)
+{
+    return PcgHash(pixelIndex ^ PcgHash(sampleIndex));
+}
+
+// [0, 1)
+float NextPathRandom(inout uint state)
+{
+    state = PcgHash(state);
+    return float(state >> 8) * (1.0f / 16777216.0f);
+}
+
+// Random numbers of one path
+struct PathSampler
+{
+    uint type;
+    uint2 pixel;
+    uint pixelSeed;         // scramble seed of the Sobol sampler
+    uint sampleIndex;
+    uint random;            // state of the Random sampler
+};
+
+PathSampler InitPathSampler(uint type, uint2 pixel, uint width, uint sampleIndex)
+{
+    uint pixelIndex = pixel.y * width + pixel.x;
+    PathSampler pathSampler;
+    pathSampler.type = type;
+    pathSampler.pixel = pixel;
+    pathSampler.pixelSeed = PcgHash(pixelIndex);
+    pathSampler.sampleIndex = sampleIndex;
+    pathSampler.random = InitPathRandom(pixelIndex, sampleIndex);
+    return pathSampler;
+}
+
+// The random numbers of a bounce, in sample groups shuffled with a seed of the group
+void GetBounceSamples(inout PathSampler pathSampler, uint bounce, out float u[RANDOM_NUMBERS_PER_BOUNCE])
+{
+    if (pathSampler.type == SAMPLER_TYPE_RANDOM)
+    {
+        [unroll]
+        for (uint i = 0; i < RANDOM_NUMBERS_PER_BOUNCE; ++i)
+        {
+            u[i] = NextPathRandom(pathSampler.random);
+        }
+        return;
+    }
+
+    bool isSobol = pathSampler.type == SAMPLER_TYPE_SOBOL;
+    [unroll]
+    for (uint group = 0; group < SAMPLE_GROUPS_PER_BOUNCE; ++group)
+    {
+        uint groupSeed = HashSamplerSeed(isSobol ? pathSampler.pixelSeed : 0, bounce * SAMPLE_GROUPS_PER_BOUNCE + group);
+        uint index = NestedUniformScramble(pathSampler.sampleIndex, groupSeed);
+        [unroll]
+        for (uint i = SAMPLE_GROUP_OFFSETS[group]; i < SAMPLE_GROUP_OFFSETS[group + 1]; ++i)
+        {
+            uint dimension = i - SAMPLE_GROUP_OFFSETS[group];
+            uint value = isSobol ?
+                NestedUniformScramble(GetSobolSample(index, dimension), HashSamplerSeed(groupSeed, dimension)) :
+                GetLatticeSample(index, dimension) + GetBlueNoiseSample(pathSampler.pixel.x, pathSampler.pixel.y, bounce * RANDOM_NUMBERS_PER_BOUNCE + i);
+            u[i] = SampleToFloat(value);
+        }
+    }
+}
+
+// Orthonormal basis around a unit vector (Duff et al. 2017)
+void GetBasis(float3 n, out float3 tangent, out float3 bitangent)
+{
+    float sign = n.z >= 0.0f ? 1.0f : -1.0f;
+    float a = -1.0f / (sign + n.z);
+    float b = n.x * n.y * a;
+    tangent = float3(1.0f + sign * n.x * n.x * a, sign * b, -sign * n.x);
+    bitangent = float3(b, sign + n.y * n.y * a, -n.y);
+}
+
+float3 GetDirectionAround(float3 axis, float cosTheta, float u)
+{
+    float3 tangent;
+    float3 bitangent;
+    GetBasis(axis, tangent, bitangent);
+    float sinTheta = sqrt(max(0.0f, 1.0f - cosTheta * cosTheta));
+    float phi = 2.0f * PATH_TRACING_PI * u;
+    return tangent * (cos(phi) * sinTheta) + bitangent * (sin(phi) * sinTheta) + axis * cosTheta;
+}
+
+bool IsInSun(float3 direction)
+{
+    return dot(direction, SUN_DIRECTION) >= SUN_COS_ANGULAR_RADIUS;
+}
+
+float3 GetEnvironmentRadiance(float3 direction)
+{
+    return SKY_RADIANCE + (IsInSun(direction) ? SUN_RADIANCE : 0.0f);
+}
+
+float GetEnvironmentPdf(float3 direction)
+{
+    float sunPdf = IsInSun(direction) ? 1.0f / SUN_SOLID_ANGLE : 0.0f;
+    return SUN_SAMPLE_PROBABILITY * sunPdf + (1.0f - SUN_SAMPLE_PROBABILITY) / (4.0f * PATH_TRACING_PI);
+}
+
+// Sun cone or whole sphere, returns the pdf of the mixture
+float SampleEnvironment(float u0, float u1, float u2, out float3 direction)
+{
+    if (u0 < SUN_SAMPLE_PROBABILITY)
+    {
+        direction = GetDirectionAround(SUN_DIRECTION, 1.0f - u1 * (1.0f - SUN_COS_ANGULAR_RADIUS), u2);
+    }
+    else
+    {
+        direction = GetDirectionAround(float3(0.0f, 0.0f, 1.0f), 1.0f - 2.0f * u1, u2);
+    }
+    return GetEnvironmentPdf(direction);
+}
+
+// The pdf is cos / pi
+float3 SampleCosineHemisphere(float3 normal, float u1, float u2)
+{
+    return GetDirectionAround(normal, sqrt(1.0f - u1), u2);
+}
+
+float GetPowerHeuristic(float pdf, float otherPdf)
+{
+    float pdf2 = pdf * pdf;
+    float sum = pdf2 + otherPdf * otherPdf;
+    return sum > 0.0f ? pdf2 / sum : 0.0f;
+}
+
+// The steps of a bounce, in the order of TracePath() in Raytracing.hlsl
+
+// Radiance added by the environment seen by the camera ray at bounce 0 or by the BSDF sample of the last bounce,
+// weighted against the light sample of that bounce
+float3 GetEnvironmentContribution(float3 direction, float3 throughput, uint bounce, float bsdfPdf, bool isNeeEnabled)
+{
+    float weight = bounce == 0 || !isNeeEnabled ? 1.0f : GetPowerHeuristic(bsdfPdf, GetEnvironmentPdf(direction));
+    return throughput * GetEnvironmentRadiance(direction) * weight;
+}
+
+// World space normal of a hit normalized and turned to face the ray
+float3 GetShadingNormal(float3 worldNormal, float3 rayDirection)
+{
+    float3 normal = normalize(worldNormal);
+    return dot(normal, rayDirection) > 0.0f ? -normal : normal;
+}
+
+// Light sample of a bounce: the direction of the shadow ray and the radiance it adds when it is unoccluded. False when
+// the sample is below the surface, no shadow ray is traced then.
+bool SampleLight(float3 normal, float3 albedo, float3 throughput, float u[RANDOM_NUMBERS_PER_BOUNCE], out float3 direction, out float3 contribution)
+{
+    contribution = float3(0.0f, 0.0f, 0.0f);
+    float lightPdf = SampleEnvironment(u[0], u[1], u[2], direction);
+    float lightCos = dot(normal, direction);
+    if (lightCos <= 0.0f || lightPdf <= 0.0f)
+    {
+        return false;
+    }
+    float weight = GetPowerHeuristic(lightPdf, lightCos / PATH_TRACING_PI);
+    contribution = throughput * albedo / PATH_TRACING_PI * lightCos * GetEnvironmentRadiance(direction) / lightPdf * weight;
+    return true;
+}
+
+// BSDF sample and Russian roulette of a bounce: the direction of the continuation ray, its pdf and the throughput.
+// False when the roulette ends the path.
+bool ContinuePath(float3 normal, float3 albedo, float u[RANDOM_NUMBERS_PER_BOUNCE], uint bounce, out float3 direction, out float bsdfPdf, inout float3 throughput)
+{
+    // The cosine and the pdf cancel the 1 / pi of the diffuse BSDF
+    direction = SampleCosineHemisphere(normal, u[3], u[4]);
+    bsdfPdf = max(dot(normal, direction), 0.0f) / PATH_TRACING_PI;
+    throughput *= albedo;
+
+    // Russian roulette
+    if (bounce + 1 >= ROULETTE_START_BOUNCE)
+    {
+        float survival = min(max(throughput.x, max(throughput.y, throughput.z)), ROULETTE_MAX_SURVIVAL);
+        if (u[5] >= survival)
+        {
+            return false;
+        }
+        throughput /= survival;
+    }
+    return true;
+}
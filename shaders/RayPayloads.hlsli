@@ -0,0 +1,128 @@
+// Ray payload and hit attribute layouts of the DXR pipelines, shared by the shaders and by C++ through
+// src/RayPayloads.h, so that the sizes given to D3D12_RAYTRACING_SHADER_CONFIG are the ones of the structs the shaders
+// trace with. C++ declares the HLSL types used here in namespace ShaderLayout and checks the sizes with static_assert.
+// The members are 32 bit scalars and vectors of them, which HLSL and C++ lay out without padding.
+//
+// A payload is live in registers across TraceRay(), every word of it costs registers in the ray generation shader and
+// may spill. The packed radiance payload stores the surface in two words: the albedo as RGB9E5 (the layout of
+// DXGI_FORMAT_R9G9B9E5_SHAREDEXP, three 9 bit mantissas with a shared 5 bit exponent) and the normal as an octahedral
+// projection with two 16 bit unorm components. The packing functions below are mirrored by src/RayPayloads.cpp and
+// checked by tools/RayPayloadTool.
+
+#ifndef RAY_PAYLOADS_HLSLI
+#define RAY_PAYLOADS_HLSLI
+
+#ifdef __cplusplus
+#include <cstdint>
+
+namespace ShaderLayout
+{
+using uint = uint32_t;
+struct float2 { float x, y; };
+struct float3 { float x, y, z; };
+#define SHADER_LAYOUT_ASSERT(condition, message) static_assert(condition, message)
+#else
+#define SHADER_LAYOUT_ASSERT(condition, message)
+#endif
+
+// RGB9E5: red in bits 0-8, green in 9-17, blue in 18-26, the exponent in 27-31
+static const uint RGB9E5_MANTISSA_BITS = 9;
+static const uint RGB9E5_EXPONENT_BIAS = 15;
+static const uint RGB9E5_MAX_EXPONENT = 31;
+static const float RGB9E5_MAX_VALUE = 65408.0f;     // (511 / 512) * 2^16
+
+// Octahedral normal: x in bits 0-15, y in 16-31, [-1, 1] as unorm
+static const uint OCTAHEDRAL_COMPONENT_BITS = 16;
+
+// Radiance payload of the megakernel, the closest hit returns the surface and the path loop stays in the ray generation
+// shader. The PayloadPrecision permutation axis selects the variant, GetRayPayloadSize() in src/ShaderPermutation.cpp
+// returns its size.
+struct RayPayloadFull
+{
+    float3 albedo;
+    float hitT;         // negative on a miss
+    float3 normal;      // world space, not normalized and not facing the ray yet
+};
+SHADER_LAYOUT_ASSERT(sizeof(RayPayloadFull) == 28, "RayPayloadFull must be 7 words");
+
+struct RayPayloadPacked
+{
+    uint albedo;        // RGB9E5
+    uint normal;        // octahedral, normalized when unpacked
+    float hitT;         // negative on a miss
+};
+SHADER_LAYOUT_ASSERT(sizeof(RayPayloadPacked) == 12, "RayPayloadPacked must be 3 words");
+
+// Payload of the shadow rays, only the shadow miss shader runs and marks the ray visible
+struct ShadowPayload
+{
+    uint isVisible;
+};
+SHADER_LAYOUT_ASSERT(sizeof(ShadowPayload) <= sizeof(RayPayloadPacked), "The radiance payload size must hold the shadow payload");
+
+// Payload of the extend rays of the wavefront mode, the hit shaders write their results to the queues
+struct WavefrontPayload
+{
+    uint rayIndex;
+};
+SHADER_LAYOUT_ASSERT(sizeof(ShadowPayload) <= sizeof(WavefrontPayload), "The wavefront payload size must hold the shadow payload");
+
+// Triangle hit attributes
+struct RayAttributes
+{
+    float2 barycentrics;
+};
+SHADER_LAYOUT_ASSERT(sizeof(RayAttributes) == 8, "RayAttributes must be the triangle barycentrics");
+
+#ifdef __cplusplus
+}
+#else
+uint PackRgb9e5(float3 value)
+{
+    // Clamped to the range of the format, the exponent of the largest channel (at least the smallest one, also for
+    // black) rounded up when its mantissa overflows
+    float3 clamped = clamp(value, 0.0f, RGB9E5_MAX_VALUE);
+    float maxChannel = max(clamped.r, max(clamped.g, clamped.b));
+    int exponent = int(floor(log2(max(maxChannel, exp2(-float(RGB9E5_EXPONENT_BIAS + 1)))))) + 1 + int(RGB9E5_EXPONENT_BIAS);
+    if (floor(maxChannel / exp2(float(exponent - int(RGB9E5_EXPONENT_BIAS + RGB9E5_MANTISSA_BITS))) + 0.5f) == float(1u << RGB9E5_MANTISSA_BITS))
+    {
+        exponent++;
+    }
+    uint3 mantissa = uint3(floor(clamped / exp2(float(exponent - int(RGB9E5_EXPONENT_BIAS + RGB9E5_MANTISSA_BITS))) + 0.5f));
+    return mantissa.r | (mantissa.g << RGB9E5_MANTISSA_BITS) | (mantissa.b << (RGB9E5_MANTISSA_BITS * 2)) | (uint(exponent) << (RGB9E5_MANTISSA_BITS * 3));
+}
+
+float3 UnpackRgb9e5(uint packed)
+{
+    uint mantissaMask = (1u << RGB9E5_MANTISSA_BITS) - 1;
+    uint3 mantissa = uint3(packed, packed >> RGB9E5_MANTISSA_BITS, packed >> (RGB9E5_MANTISSA_BITS * 2)) & mantissaMask;
+    int exponent = int(packed >> (RGB9E5_MANTISSA_BITS * 3));
+    return float3(mantissa) * exp2(float(exponent - int(RGB9E5_EXPONENT_BIAS + RGB9E5_MANTISSA_BITS)));
+}
+
+uint PackOctahedralNormal(float3 normal)
+{
+    // Projected on the octahedron, the lower hemisphere folded over the diagonals
+    float2 projected = normal.xy / (abs(normal.x) + abs(normal.y) + abs(normal.z));
+    if (normal.z < 0.0f)
+    {
+        projected = (1.0f - abs(projected.yx)) * float2(projected.x >= 0.0f ? 1.0f : -1.0f, projected.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    float scale = float((1u << OCTAHEDRAL_COMPONENT_BITS) - 1);
+    uint2 unorm = uint2(round(saturate(projected * 0.5f + 0.5f) * scale));
+    return unorm.x | (unorm.y << OCTAHEDRAL_COMPONENT_BITS);
+}
+
+float3 UnpackOctahedralNormal(uint packed)
+{
+    float scale = float((1u << OCTAHEDRAL_COMPONENT_BITS) - 1);
+    float2 projected = float2(packed & ((1u << OCTAHEDRAL_COMPONENT_BITS) - 1), packed >> OCTAHEDRAL_COMPONENT_BITS) / scale * 2.0f - 1.0f;
+    float3 normal = float3(projected, 1.0f - abs(projected.x) - abs(projected.y));
+    float fold = saturate(-normal.z);
+    normal.x += normal.x >= 0.0f ? -fold : fold;
+    normal.y += normal.y >= 0.0f ? -fold : fold;
+    return normalize(normal);
+}
+#endif
+
+#endif
@@ -1,73 +1,178 @@
-// Global root signature
-RaytracingAccelerationStructure Scene : register(t0, space0);
-RWTexture2D<float4> RenderTarget : register(u0, space0);
+#include "Common.hlsli"
 
-// Ray payload structure
-struct RayPayload
+#include "PathTracing.hlsli"
+
+// Permutation axes, set with -D by src/ShaderPermutation.cpp. The defaults are the generic kernel.
+#ifndef PERMUTATION_MAX_BOUNCES
+#define PERMUTATION_MAX_BOUNCES 0       // 0: MaxBounces of the root constants, otherwise the compiled in limit
+#endif
+#ifndef PERMUTATION_DISABLE_NEE
+#define PERMUTATION_DISABLE_NEE 0       // 1: BSDF samples only, no shadow rays
+#endif
+#ifndef PERMUTATION_DEBUG_VIEW
+#define PERMUTATION_DEBUG_VIEW 0        // DEBUG_VIEW_*
+#endif
+#ifndef PERMUTATION_PACKED_PAYLOAD
+#define PERMUTATION_PACKED_PAYLOAD 0    // 1: RayPayloadPacked instead of RayPayloadFull
+#endif
+
+// Debug views, must match DebugView in src/ShaderPermutation.h
+#define DEBUG_VIEW_NONE 0
+#define DEBUG_VIEW_ALBEDO 1
+#define DEBUG_VIEW_NORMAL 2
+#define DEBUG_VIEW_HIT_DISTANCE 3
+
+// Distance shown as 0.5 by the hit distance view
+static const float DEBUG_VIEW_HALF_DISTANCE = 10.0f;
+
+// Radiance payload of the permutation, the layouts are in RayPayloads.hlsli
+#if PERMUTATION_PACKED_PAYLOAD
+typedef RayPayloadPacked RayPayload;
+
+void SetPayloadSurface(inout RayPayload payload, float3 albedo, float3 normal)
 {
-    float3 color;
-};
+    payload.albedo = PackRgb9e5(albedo);
+    payload.normal = PackOctahedralNormal(normal);
+}
 
-// Ray attributes
-struct RayAttributes
+float3 GetPayloadAlbedo(RayPayload payload)
 {
-    float2 barycentrics;
-};
+    return UnpackRgb9e5(payload.albedo);
+}
 
-// Vertex data
-struct Vertex
+float3 GetPayloadNormal(RayPayload payload)
 {
-    float3 position;
-    float3 normal;
-    float4 color;
-};
+    return UnpackOctahedralNormal(payload.normal);
+}
+#else
+typedef RayPayloadFull RayPayload;
+
+void SetPayloadSurface(inout RayPayload payload, float3 albedo, float3 normal)
+{
+    payload.albedo = albedo;
+    payload.normal = normal;
+}
+
+float3 GetPayloadAlbedo(RayPayload payload)
+{
+    return payload.albedo;
+}
 
-// Ray generation shader
+float3 GetPayloadNormal(RayPayload payload)
+{
+    return payload.normal;
+}
+#endif
+
+uint GetMaxBounces()
+{
+#if PERMUTATION_MAX_BOUNCES > 0
+    return PERMUTATION_MAX_BOUNCES;
+#else
+    return MaxBounces;
+#endif
+}
+
+// Surface attribute of the primary hit of the debug views, black on a miss
+float3 TraceDebugView(RayDesc ray)
+{
+    RayPayload payload = (RayPayload)0;
+    TraceRay(Scene, RAY_FLAG_FORCE_OPAQUE, ~0, RAY_TYPE_RADIANCE, RAY_TYPE_COUNT, RAY_TYPE_RADIANCE, ray, payload);
+    if (payload.hitT < 0.0f)
+    {
+        return float3(0.0f, 0.0f, 0.0f);
+    }
+#if PERMUTATION_DEBUG_VIEW == DEBUG_VIEW_ALBEDO
+    return GetPayloadAlbedo(payload);
+#elif PERMUTATION_DEBUG_VIEW == DEBUG_VIEW_NORMAL
+    return normalize(GetPayloadNormal(payload)) * 0.5f + 0.5f;
+#else
+    return (payload.hitT / (payload.hitT + DEBUG_VIEW_HALF_DISTANCE)).xxx;
+#endif
+}
+
+// Radiance of one path, see src/PathTracing.h
+float3 TracePath(RayDesc ray, inout PathSampler pathSampler)
+{
+    float3 radiance = float3(0.0f, 0.0f, 0.0f);
+    float3 throughput = float3(1.0f, 1.0f, 1.0f);
+    float bsdfPdf = 0.0f;
+    for (uint bounce = 0; bounce <= GetMaxBounces(); ++bounce)
+    {
+        RayPayload payload = (RayPayload)0;
+        TraceRay(Scene, RAY_FLAG_FORCE_OPAQUE, ~0, RAY_TYPE_RADIANCE, RAY_TYPE_COUNT, RAY_TYPE_RADIANCE, ray, payload);
+        if (payload.hitT < 0.0f)
+        {
+            radiance += GetEnvironmentContribution(ray.Direction, throughput, bounce, bsdfPdf, !PERMUTATION_DISABLE_NEE);
+            break;
+        }
+
+        // The environment the BSDF sample of the last hit would see is not traced, so the light sample is skipped as well
+        if (bounce == GetMaxBounces())
+        {
+            break;
+        }
+
+        // Random numbers of the bounce in the order of CpuRaytracer::TracePath(), consumed with or without NEE
+        float u[RANDOM_NUMBERS_PER_BOUNCE];
+        GetBounceSamples(pathSampler, bounce, u);
+
+        float3 albedo = GetPayloadAlbedo(payload);
+        float3 normal = GetShadingNormal(GetPayloadNormal(payload), ray.Direction);
+        ray.Origin += ray.Direction * payload.hitT;
+
+#if !PERMUTATION_DISABLE_NEE
+        // Light sample with an occlusion-only shadow ray, the first hit ends it without a closest hit shader
+        RayDesc shadowRay;
+        float3 contribution;
+        if (SampleLight(normal, albedo, throughput, u, shadowRay.Direction, contribution))
+        {
+            shadowRay.Origin = ray.Origin;
+            shadowRay.TMin = RAY_T_MIN;
+            shadowRay.TMax = RAY_T_MAX;
+            ShadowPayload shadowPayload = { 0 };
+            TraceRay(Scene, RAY_FLAG_FORCE_OPAQUE | RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH | RAY_FLAG_SKIP_CLOSEST_HIT_SHADER,
+                ~0, RAY_TYPE_SHADOW, RAY_TYPE_COUNT, RAY_TYPE_SHADOW, shadowRay, shadowPayload);
+            if (shadowPayload.isVisible)
+            {
+                radiance += contribution;
+            }
+        }
+#endif
+
+        if (!ContinuePath(normal, albedo, u, bounce, ray.Direction, bsdfPdf, throughput))
+        {
+            break;
+        }
+    }
+    return radiance;
+}
+
+// Ray generation shader: one path per pixel and frame added to the accumulation, or the debug view of the permutation
 [shader("raygeneration")]
 void RayGenShader()
 {
     uint2 dispatchDim = DispatchRaysDimensions().xy;
     uint2 dispatchIndex = DispatchRaysIndex().xy;
+    PathSampler pathSampler = InitPathSampler(SamplerType, dispatchIndex, dispatchDim.x, SampleIndex);
 
-    // Calculate normalized screen coordinates
-    float2 screenCoord = (float2(dispatchIndex) + 0.5f) / float2(dispatchDim);
-    screenCoord = screenCoord * 2.0f - 1.0f;
-    screenCoord.y = -screenCoord.y; // Flip Y coordinate
-    
-    // Fixed camera data for testing
-    float3 cameraPosition = float3(-10.0f, 3.0f, -5.0f);
-    float3 cameraTarget = float3(0.0f, 0.0f, 0.0f);
-    float3 cameraUp = float3(0.0f, 1.0f, 0.0f);
-    
-    // Calculate camera basis
-    float3 forward = normalize(cameraTarget - cameraPosition);
-    float3 right = normalize(cross(forward, cameraUp));
-    float3 up = cross(right, forward);
-    
-    // Calculate ray direction
-    float aspectRatio = float(dispatchDim.x) / float(dispatchDim.y);
-    float fov = 45.0f * 3.14159265f / 180.0f; // 45 degrees in radians
-    float tanHalfFov = tan(fov * 0.5f);
-    
-    float3 rayDirection = normalize(
-        forward + 
-        right * screenCoord.x * aspectRatio * tanHalfFov +
-        up * screenCoord.y * tanHalfFov
-    );
-    
     // Setup ray
     RayDesc ray;
-    ray.Origin = cameraPosition;
-    ray.Direction = rayDirection;
-    ray.TMin = 0.001f;
-    ray.TMax = 10000.0f;
-    
-    // Trace ray
-    RayPayload payload = { float3(0.0f, 0.0f, 0.0f) };
-    TraceRay(Scene, RAY_FLAG_FORCE_OPAQUE, ~0, 0, 1, 0, ray, payload);
-    
-    // Write to render target
-    RenderTarget[dispatchIndex] = float4(payload.color, 1.0f);
+    ray.Origin = CameraPosition;
+    ray.Direction = GetCameraRayDirection(dispatchIndex, dispatchDim);
+    ray.TMin = RAY_T_MIN;
+    ray.TMax = RAY_T_MAX;
+
+#if PERMUTATION_DEBUG_VIEW != DEBUG_VIEW_NONE
+    float3 radiance = TraceDebugView(ray);
+#else
+    float3 radiance = TracePath(ray, pathSampler);
+#endif
+
+    // Accumulate, the first sample overwrites what is left of a previous camera or scene
+    float3 sum = SampleIndex == 0 ? radiance : Accumulation[dispatchIndex].rgb + radiance;
+    Accumulation[dispatchIndex] = float4(sum, 1.0f);
+    RenderTarget[dispatchIndex] = float4(sum / float(SampleIndex + 1), 1.0f);
 }
 
 // Closest hit shader
@@ -75,24 +180,23 @@ void RayGenShader()
 void ClosestHitShader(inout RayPayload payload, in RayAttributes attr)
 {
     // Get hit information
-    float3 barycentrics = float3(1.0f - attr.barycentrics.x - attr.barycentrics.y, 
-                                 attr.barycentrics.x, 
-                                 attr.barycentrics.y);
-    
-    // For now, just return the instance color
-    // In a full implementation, you would access vertex data here
-    float3 lightDir = normalize(float3(0.5f, 1.0f, 0.5f));
-    float3 normal = float3(0.0f, 1.0f, 0.0f); // Placeholder normal
-    
-    // Simple diffuse lighting
-    float NdotL = max(0.0f, dot(normal, lightDir));
-    payload.color = float3(0.8f, 0.8f, 0.8f) * NdotL + float3(0.1f, 0.1f, 0.1f);
+    float3 objectNormal;
+    float4 color;
+    GetHitAttributes(InstanceID(), PrimitiveIndex(), attr.barycentrics, objectNormal, color);
+    SetPayloadSurface(payload, color.rgb, mul((float3x3)ObjectToWorld3x4(), objectNormal));
+    payload.hitT = RayTCurrent();
 }
 
 // Miss shader
 [shader("miss")]
 void MissShader(inout RayPayload payload)
 {
-    // Sky color
-    payload.color = float3(0.2f, 0.4f, 0.6f);
+    payload.hitT = -1.0f;
+}
+
+// Miss shader of the shadow rays
+[shader("miss")]
+void ShadowMissShader(inout ShadowPayload payload)
+{
+    payload.isVisible = 1;
 }
@@ -0,0 +1,120 @@
+// Inline ray tracing path (DXR 1.1): one compute thread per pixel traces the path of TracePath() in Raytracing.hlsl
+// with RayQuery, without a state object, a shader table or a payload. It uses the bindings, the camera and the
+// accumulation of the global root signature like the other render modes, and adds the same samples as the generic
+// megakernel permutation (MaxBounces of the root constants, with NEE).
+
+#include "Common.hlsli"
+#include "PathTracing.hlsli"
+
+// Surface of the closest hit like ClosestHitShader, false on a miss. Opaque triangles only, so Proceed() commits the
+// closest hit without returning candidates.
+bool TraceClosestHit(RayDesc ray, out float hitT, out float3 albedo, out float3 worldNormal)
+{
+    hitT = 0.0f;
+    albedo = float3(0.0f, 0.0f, 0.0f);
+    worldNormal = float3(0.0f, 0.0f, 0.0f);
+
+    RayQuery<RAY_FLAG_FORCE_OPAQUE | RAY_FLAG_SKIP_PROCEDURAL_PRIMITIVES> query;
+    query.TraceRayInline(Scene, RAY_FLAG_NONE, ~0, ray);
+    while (query.Proceed())
+    {
+    }
+    if (query.CommittedStatus() != COMMITTED_TRIANGLE_HIT)
+    {
+        return false;
+    }
+
+    float3 objectNormal;
+    float4 color;
+    GetHitAttributes(query.CommittedInstanceID(), query.CommittedPrimitiveIndex(), query.CommittedTriangleBarycentrics(), objectNormal, color);
+    hitT = query.CommittedRayT();
+    albedo = color.rgb;
+    worldNormal = mul((float3x3)query.CommittedObjectToWorld3x4(), objectNormal);
+    return true;
+}
+
+// Visibility only: the first hit ends the search
+bool IsUnoccluded(RayDesc ray)
+{
+    RayQuery<RAY_FLAG_FORCE_OPAQUE | RAY_FLAG_SKIP_PROCEDURAL_PRIMITIVES | RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH> query;
+    query.TraceRayInline(Scene, RAY_FLAG_NONE, ~0, ray);
+    while (query.Proceed())
+    {
+    }
+    return query.CommittedStatus() == COMMITTED_NOTHING;
+}
+
+// Radiance of one path, see src/PathTracing.h
+float3 TracePath(RayDesc ray, inout PathSampler pathSampler)
+{
+    float3 radiance = float3(0.0f, 0.0f, 0.0f);
+    float3 throughput = float3(1.0f, 1.0f, 1.0f);
+    float bsdfPdf = 0.0f;
+    for (uint bounce = 0; bounce <= MaxBounces; ++bounce)
+    {
+        float hitT;
+        float3 albedo;
+        float3 worldNormal;
+        if (!TraceClosestHit(ray, hitT, albedo, worldNormal))
+        {
+            radiance += GetEnvironmentContribution(ray.Direction, throughput, bounce, bsdfPdf, true);
+            break;
+        }
+
+        // The environment the BSDF sample of the last hit would see is not traced, so the light sample is skipped as well
+        if (bounce == MaxBounces)
+        {
+            break;
+        }
+
+        float u[RANDOM_NUMBERS_PER_BOUNCE];
+        GetBounceSamples(pathSampler, bounce, u);
+
+        float3 normal = GetShadingNormal(worldNormal, ray.Direction);
+        ray.Origin += ray.Direction * hitT;
+
+        RayDesc shadowRay;
+        float3 contribution;
+        if (SampleLight(normal, albedo, throughput, u, shadowRay.Direction, contribution))
+        {
+            shadowRay.Origin = ray.Origin;
+            shadowRay.TMin = RAY_T_MIN;
+            shadowRay.TMax = RAY_T_MAX;
+            if (IsUnoccluded(shadowRay))
+            {
+                radiance += contribution;
+            }
+        }
+
+        if (!ContinuePath(normal, albedo, u, bounce, ray.Direction, bsdfPdf, throughput))
+        {
+            break;
+        }
+    }
+    return radiance;
+}
+
+// One path per pixel and frame added to the accumulation like RayGenShader
+[numthreads(8, 8, 1)]
+void InlineRaytracingMain(uint3 dispatchThreadId : SV_DispatchThreadID)
+{
+    uint2 dimensions;
+    RenderTarget.GetDimensions(dimensions.x, dimensions.y);
+    if (any(dispatchThreadId.xy >= dimensions))
+    {
+        return;
+    }
+
+    RayDesc ray;
+    ray.Origin = CameraPosition;
+    ray.Direction = GetCameraRayDirection(dispatchThreadId.xy, dimensions);
+    ray.TMin = RAY_T_MIN;
+    ray.TMax = RAY_T_MAX;
+
+    PathSampler pathSampler = InitPathSampler(SamplerType, dispatchThreadId.xy, dimensions.x, SampleIndex);
+    float3 radiance = TracePath(ray, pathSampler);
+
+    float3 sum = SampleIndex == 0 ? radiance : Accumulation[dispatchThreadId.xy].rgb + radiance;
+    Accumulation[dispatchThreadId.xy] = float4(sum, 1.0f);
+    RenderTarget[dispatchThreadId.xy] = float4(sum / float(SampleIndex + 1), 1.0f);
+}
@@ -0,0 +1,83 @@
+// Samplers of the path tracing megakernel, must match src/Sampler.h and src/Sampler.cpp so that
+// CpuRaytracer::RenderPathTraced() converges to the same image. The tables are the SamplerTables buffer of
+// Common.hlsli in the layout of SerializeSamplerTables().
+
+// Must match SamplerType in src/Sampler.h
+static const uint SAMPLER_TYPE_RANDOM = 0;
+static const uint SAMPLER_TYPE_SOBOL = 1;
+static const uint SAMPLER_TYPE_LATTICE = 2;
+
+// Byte offsets of the tables, must match SAMPLER_TABLE_* in src/Sampler.h
+static const uint SAMPLER_TABLE_SOBOL_OFFSET = 0;
+static const uint SAMPLER_TABLE_LATTICE_OFFSET = 384;
+static const uint SAMPLER_TABLE_BLUE_NOISE_OFFSET = 400;
+
+static const uint SOBOL_BIT_COUNT = 32;
+static const uint BLUE_NOISE_SIZE = 64;
+static const uint BLUE_NOISE_DEPTH = 16;
+
+// R2 sequence offsets of the blue noise per dimension
+static const uint R2_ALPHA_X = 0xC13FA9A9u;
+static const uint R2_ALPHA_Y = 0x91E10DA5u;
+static const uint BLUE_NOISE_OFFSET_SHIFT = 26;
+
+uint PcgHash(uint value)
+{
+    uint state = value * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+uint HashSamplerSeed(uint seed, uint value)
+{
+    return PcgHash(seed ^ PcgHash(value));
+}
+
+// Owen scramble of a 32-bit fraction, shuffles the indices of every aligned block of 2^m indices
+uint NestedUniformScramble(uint value, uint seed)
+{
+    value = reversebits(value);
+    value ^= value * 0x3d20adeau;
+    value += seed;
+    value *= (seed >> 16) | 1u;
+    value ^= value * 0x05526c56u;
+    value ^= value * 0x53a22864u;
+    return reversebits(value);
+}
+
+uint GetSobolSample(uint index, uint dimension)
+{
+    uint address = SAMPLER_TABLE_SOBOL_OFFSET + dimension * SOBOL_BIT_COUNT * 4;
+    uint value = 0;
+    for (; index != 0; index >>= 1, address += 4)
+    {
+        if (index & 1)
+        {
+            value ^= SamplerTables.Load(address);
+        }
+    }
+    return value;
+}
+
+uint GetLatticeSample(uint index, uint dimension)
+{
+    return reversebits(index) * SamplerTables.Load(SAMPLER_TABLE_LATTICE_OFFSET + dimension * 4);
+}
+
+// The ranks are uint16, two per word
+uint GetBlueNoiseSample(uint x, uint y, uint dimension)
+{
+    uint texelX = (x + ((dimension * R2_ALPHA_X) >> BLUE_NOISE_OFFSET_SHIFT)) % BLUE_NOISE_SIZE;
+    uint texelY = (y + ((dimension * R2_ALPHA_Y) >> BLUE_NOISE_OFFSET_SHIFT)) % BLUE_NOISE_SIZE;
+    uint slice = dimension % BLUE_NOISE_DEPTH;
+    uint texel = (slice * BLUE_NOISE_SIZE + texelY) * BLUE_NOISE_SIZE + texelX;
+    uint word = SamplerTables.Load(SAMPLER_TABLE_BLUE_NOISE_OFFSET + (texel & ~1u) * 2);
+    uint rank = (texel & 1) ? word >> 16 : word & 0xffff;
+    return (rank << 16) | 0x8000u;
+}
+
+// [0, 1) with 24 bits
+float SampleToFloat(uint value)
+{
+    return float(value >> 8) * (1.0f / 16777216.0f);
+}
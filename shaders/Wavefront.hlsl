@@ -0,0 +1,187 @@
+// Compute stages of the wavefront mode. A frame adds one path traced sample per pixel to the accumulation:
+//   WavefrontReset -> WavefrontGenerate
+//   then for every bounce up to MaxBounces, WavefrontBounce in the root constants:
+//     [WavefrontNextBounce] -> extend (WavefrontTrace.hlsl) -> WavefrontBinOffsets -> WavefrontScatter
+//     -> WavefrontShade -> shadow connect (WavefrontTrace.hlsl)
+//   -> WavefrontResolve
+// with a UAV barrier between the stages. The extend stage of the last bounce only adds the environment, its hits end
+// the paths. The dispatches cover the largest queue size, one entry per pixel, and the threads beyond the counter of
+// their queue return early, so the bounces after the last live path cost empty dispatches.
+
+#include "Common.hlsli"
+#include "PathTracing.hlsli"
+#include "WavefrontQueues.hlsli"
+
+static const uint WAVEFRONT_GROUP_SIZE = 64;
+
+// Append to a compacted queue: the wave reserves the entries of all appending lanes with one atomic, and every lane
+// gets the index of its entry. All lanes of the wave must call it.
+uint AppendWave(uint counterOffset, bool isAppending)
+{
+    uint count = WaveActiveCountBits(isAppending);
+    uint first = 0;
+    if (WaveIsFirstLane() && count > 0)
+    {
+        Counters.InterlockedAdd(counterOffset, count, first);
+    }
+    return WaveReadLaneFirst(first) + WavePrefixCountBits(isAppending);
+}
+
+// Clear the queue counters and the bin counts
+[numthreads(WAVEFRONT_GROUP_SIZE, 1, 1)]
+void WavefrontReset(uint3 dispatchThreadId : SV_DispatchThreadID)
+{
+    if (dispatchThreadId.x * 4 < COUNTER_SIZE)
+    {
+        Counters.Store(dispatchThreadId.x * 4, 0);
+    }
+}
+
+// One camera ray per pixel, the path state of the first bounce
+[numthreads(8, 8, 1)]
+void WavefrontGenerate(uint3 dispatchThreadId : SV_DispatchThreadID)
+{
+    uint2 dimensions;
+    RenderTarget.GetDimensions(dimensions.x, dimensions.y);
+    bool isInside = all(dispatchThreadId.xy < dimensions);
+
+    uint rayIndex = AppendWave(COUNTER_RAY_COUNT, isInside);
+    if (!isInside)
+    {
+        return;
+    }
+
+    WavefrontRay ray;
+    ray.origin = CameraPosition;
+    ray.pixelIndex = dispatchThreadId.y * dimensions.x + dispatchThreadId.x;
+    ray.direction = GetCameraRayDirection(dispatchThreadId.xy, dimensions);
+    ray.bsdfPdf = 0.0f;
+    ray.throughput = float3(1.0f, 1.0f, 1.0f);
+    ray.random = InitPathSampler(SamplerType, dispatchThreadId.xy, dimensions.x, SampleIndex).random;
+    RayQueue[GetRayQueueOffset(0) + rayIndex] = ray;
+    PathRadiance[ray.pixelIndex] = float4(0.0f, 0.0f, 0.0f, 0.0f);
+}
+
+// Counters of the next bounce: the continuation rays become the ray queue, the other queues and the bin counts are
+// cleared. One group.
+[numthreads(WAVEFRONT_MATERIAL_BIN_COUNT, 1, 1)]
+void WavefrontNextBounce(uint3 groupThreadId : SV_GroupThreadID)
+{
+    uint bin = groupThreadId.x;
+    Counters.Store(COUNTER_BIN_COUNTS + bin * 4, 0);
+    if (bin == 0)
+    {
+        Counters.Store(COUNTER_RAY_COUNT, Counters.Load(COUNTER_NEXT_RAY_COUNT));
+        Counters.Store(COUNTER_NEXT_RAY_COUNT, 0);
+        Counters.Store(COUNTER_HIT_COUNT, 0);
+        Counters.Store(COUNTER_SHADOW_RAY_COUNT, 0);
+    }
+}
+
+// Exclusive prefix sum of the bin counts into the scatter cursors, one group
+groupshared uint BinOffsets[WAVEFRONT_MATERIAL_BIN_COUNT];
+
+[numthreads(WAVEFRONT_MATERIAL_BIN_COUNT, 1, 1)]
+void WavefrontBinOffsets(uint3 groupThreadId : SV_GroupThreadID)
+{
+    uint bin = groupThreadId.x;
+    uint count = Counters.Load(COUNTER_BIN_COUNTS + bin * 4);
+    BinOffsets[bin] = count;
+    GroupMemoryBarrierWithGroupSync();
+
+    // Hillis-Steele scan, inclusive
+    [unroll]
+    for (uint stride = 1; stride < WAVEFRONT_MATERIAL_BIN_COUNT; stride *= 2)
+    {
+        uint value = bin >= stride ? BinOffsets[bin - stride] : 0;
+        GroupMemoryBarrierWithGroupSync();
+        BinOffsets[bin] += value;
+        GroupMemoryBarrierWithGroupSync();
+    }
+    Counters.Store(COUNTER_BIN_OFFSETS + bin * 4, BinOffsets[bin] - count);
+}
+
+// Counting sort of the hits by material bin
+[numthreads(WAVEFRONT_GROUP_SIZE, 1, 1)]
+void WavefrontScatter(uint3 dispatchThreadId : SV_DispatchThreadID)
+{
+    uint hitIndex = dispatchThreadId.x;
+    if (hitIndex >= Counters.Load(COUNTER_HIT_COUNT))
+    {
+        return;
+    }
+
+    uint sortedIndex;
+    Counters.InterlockedAdd(COUNTER_BIN_OFFSETS + GetWavefrontMaterialBin(HitQueue[hitIndex].meshIndex) * 4, 1, sortedIndex);
+    SortedHitIndices[sortedIndex] = hitIndex;
+}
+
+// A bounce of the paths at the hits, see TracePath() in Raytracing.hlsl: the light sample becomes a shadow ray
+// carrying its contribution, and the BSDF sample a continuation ray in the ray queue of the next bounce unless Russian
+// roulette ends the path. Consecutive threads read hits of the same material.
+[numthreads(WAVEFRONT_GROUP_SIZE, 1, 1)]
+void WavefrontShade(uint3 dispatchThreadId : SV_DispatchThreadID)
+{
+    bool isHit = dispatchThreadId.x < Counters.Load(COUNTER_HIT_COUNT);
+
+    WavefrontShadowRay shadowRay = (WavefrontShadowRay)0;
+    WavefrontRay nextRay = (WavefrontRay)0;
+    bool isShadowRay = false;
+    bool isContinued = false;
+    if (isHit)
+    {
+        WavefrontHit hit = HitQueue[SortedHitIndices[dispatchThreadId.x]];
+        WavefrontRay ray = RayQueue[GetRayQueueOffset(WavefrontBounce) + hit.rayIndex];
+
+        // The sampler of the path at this bounce, the rest of its state follows from the pixel and the sample
+        uint2 dimensions;
+        RenderTarget.GetDimensions(dimensions.x, dimensions.y);
+        PathSampler pathSampler = InitPathSampler(SamplerType, uint2(ray.pixelIndex % dimensions.x, ray.pixelIndex / dimensions.x), dimensions.x, SampleIndex);
+        pathSampler.random = ray.random;
+        float u[RANDOM_NUMBERS_PER_BOUNCE];
+        GetBounceSamples(pathSampler, WavefrontBounce, u);
+
+        float3 objectNormal;
+        float4 color;
+        GetHitAttributes(hit.meshIndex, hit.primitiveIndex, hit.barycentrics, objectNormal, color);
+        float3 normal = GetShadingNormal(mul(hit.objectToWorld, objectNormal), ray.direction);
+        float3 origin = ray.origin + ray.direction * hit.hitT;
+
+        isShadowRay = SampleLight(normal, color.rgb, ray.throughput, u, shadowRay.direction, shadowRay.contribution);
+        shadowRay.origin = origin;
+        shadowRay.pixelIndex = ray.pixelIndex;
+        shadowRay.tMax = RAY_T_MAX;
+
+        nextRay = ray;
+        nextRay.origin = origin;
+        isContinued = ContinuePath(normal, color.rgb, u, WavefrontBounce, nextRay.direction, nextRay.bsdfPdf, nextRay.throughput);
+        nextRay.random = pathSampler.random;
+    }
+
+    uint shadowRayIndex = AppendWave(COUNTER_SHADOW_RAY_COUNT, isShadowRay);
+    if (isShadowRay)
+    {
+        ShadowQueue[shadowRayIndex] = shadowRay;
+    }
+    uint nextRayIndex = AppendWave(COUNTER_NEXT_RAY_COUNT, isContinued);
+    if (isContinued)
+    {
+        RayQueue[GetRayQueueOffset(WavefrontBounce + 1) + nextRayIndex] = nextRay;
+    }
+}
+
+// Add the radiance of the paths to the accumulation like RayGenShader and write the average to the output
+[numthreads(8, 8, 1)]
+void WavefrontResolve(uint3 dispatchThreadId : SV_DispatchThreadID)
+{
+    uint2 dimensions;
+    RenderTarget.GetDimensions(dimensions.x, dimensions.y);
+    if (any(dispatchThreadId.xy >= dimensions))
+    {
+        return;
+    }
+    float3 radiance = PathRadiance[dispatchThreadId.y * dimensions.x + dispatchThreadId.x].rgb;
+    float3 sum = SampleIndex == 0 ? radiance : Accumulation[dispatchThreadId.xy].rgb + radiance;
+    Accumulation[dispatchThreadId.xy] = float4(sum, 1.0f);
+    RenderTarget[dispatchThreadId.xy] = float4(sum / float(SampleIndex + 1), 1.0f);
+}
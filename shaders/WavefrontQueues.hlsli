@@ -0,0 +1,64 @@
+// Queues of the wavefront mode, bound as the wavefront UAV table of the global root signature. The structures and the
+// counter offsets must match src/WavefrontQueues.h.
+
+static const uint WAVEFRONT_MATERIAL_BIN_COUNT = 256;
+
+// Byte offsets in Counters
+static const uint COUNTER_RAY_COUNT = 0;
+static const uint COUNTER_HIT_COUNT = 4;
+static const uint COUNTER_SHADOW_RAY_COUNT = 8;
+static const uint COUNTER_NEXT_RAY_COUNT = 12;
+static const uint COUNTER_BIN_COUNTS = 16;
+static const uint COUNTER_BIN_OFFSETS = COUNTER_BIN_COUNTS + WAVEFRONT_MATERIAL_BIN_COUNT * 4;
+static const uint COUNTER_SIZE = COUNTER_BIN_OFFSETS + WAVEFRONT_MATERIAL_BIN_COUNT * 4;
+
+struct WavefrontRay
+{
+    float3 origin;
+    uint pixelIndex;
+    float3 direction;
+    float bsdfPdf;
+    float3 throughput;
+    uint random;
+};
+
+struct WavefrontHit
+{
+    uint rayIndex;
+    uint meshIndex;
+    uint primitiveIndex;
+    float hitT;
+    float2 barycentrics;
+    row_major float3x3 objectToWorld;
+    uint padding;
+};
+
+struct WavefrontShadowRay
+{
+    float3 origin;
+    uint pixelIndex;
+    float3 direction;
+    float tMax;
+    float3 contribution;
+    uint padding;
+};
+
+RWStructuredBuffer<WavefrontRay> RayQueue : register(u2, space0);             // two queues of one entry per pixel
+RWStructuredBuffer<WavefrontHit> HitQueue : register(u3, space0);
+RWStructuredBuffer<uint> SortedHitIndices : register(u4, space0);
+RWStructuredBuffer<WavefrontShadowRay> ShadowQueue : register(u5, space0);
+RWStructuredBuffer<float4> PathRadiance : register(u6, space0);     // per pixel
+RWByteAddressBuffer Counters : register(u7, space0);
+
+uint GetWavefrontMaterialBin(uint meshIndex)
+{
+    return meshIndex % WAVEFRONT_MATERIAL_BIN_COUNT;
+}
+
+// First entry of the ray queue of a bounce, the shade stage appends the continuation rays to the queue of the next one
+uint GetRayQueueOffset(uint bounce)
+{
+    uint2 dimensions;
+    RenderTarget.GetDimensions(dimensions.x, dimensions.y);
+    return (bounce & 1) * dimensions.x * dimensions.y;
+}
@@ -0,0 +1,100 @@
+// Ray tracing stages of the wavefront mode: extend traces the ray queue of the bounce, appends the closest hits to the
+// hit queue and adds the environment seen by the missing rays, shadow connect traces the shadow queue and adds the
+// contribution of the unoccluded shadow rays. Both are dispatched over the output dimensions, the largest queue size,
+// and the rays beyond the counter of their queue return early.
+
+#include "Common.hlsli"
+#include "PathTracing.hlsli"
+#include "WavefrontQueues.hlsli"
+
+uint GetQueueIndex()
+{
+    return DispatchRaysIndex().y * DispatchRaysDimensions().x + DispatchRaysIndex().x;
+}
+
+[shader("raygeneration")]
+void WavefrontExtendRayGen()
+{
+    uint rayIndex = GetQueueIndex();
+    if (rayIndex >= Counters.Load(COUNTER_RAY_COUNT))
+    {
+        return;
+    }
+
+    WavefrontRay queuedRay = RayQueue[GetRayQueueOffset(WavefrontBounce) + rayIndex];
+    RayDesc ray;
+    ray.Origin = queuedRay.origin;
+    ray.Direction = queuedRay.direction;
+    ray.TMin = RAY_T_MIN;
+    ray.TMax = RAY_T_MAX;
+
+    WavefrontPayload payload = { rayIndex };
+    TraceRay(Scene, RAY_FLAG_FORCE_OPAQUE, ~0, RAY_TYPE_RADIANCE, RAY_TYPE_COUNT, RAY_TYPE_RADIANCE, ray, payload);
+}
+
+// Append the hit and count it in its material bin, the instance data is stored for the shade stage. The hit after
+// MaxBounces bounces ends the path without a light sample, like TracePath() in Raytracing.hlsl.
+[shader("closesthit")]
+void WavefrontClosestHit(inout WavefrontPayload payload, in RayAttributes attr)
+{
+    if (WavefrontBounce == MaxBounces)
+    {
+        return;
+    }
+
+    WavefrontHit hit;
+    hit.rayIndex = payload.rayIndex;
+    hit.meshIndex = InstanceID();
+    hit.primitiveIndex = PrimitiveIndex();
+    hit.hitT = RayTCurrent();
+    hit.barycentrics = attr.barycentrics;
+    hit.objectToWorld = (float3x3)ObjectToWorld3x4();
+    hit.padding = 0;
+
+    uint hitIndex;
+    Counters.InterlockedAdd(COUNTER_HIT_COUNT, 1, hitIndex);
+    HitQueue[hitIndex] = hit;
+    Counters.InterlockedAdd(COUNTER_BIN_COUNTS + GetWavefrontMaterialBin(hit.meshIndex) * 4, 1);
+}
+
+// The environment seen by the camera ray or the BSDF sample of the last bounce
+[shader("miss")]
+void WavefrontMiss(inout WavefrontPayload payload)
+{
+    WavefrontRay ray = RayQueue[GetRayQueueOffset(WavefrontBounce) + payload.rayIndex];
+    PathRadiance[ray.pixelIndex] += float4(GetEnvironmentContribution(ray.direction, ray.throughput, WavefrontBounce, ray.bsdfPdf, true), 0.0f);
+}
+
+[shader("raygeneration")]
+void WavefrontShadowRayGen()
+{
+    uint shadowRayIndex = GetQueueIndex();
+    if (shadowRayIndex >= Counters.Load(COUNTER_SHADOW_RAY_COUNT))
+    {
+        return;
+    }
+
+    WavefrontShadowRay shadowRay = ShadowQueue[shadowRayIndex];
+    RayDesc ray;
+    ray.Origin = shadowRay.origin;
+    ray.Direction = shadowRay.direction;
+    ray.TMin = RAY_T_MIN;
+    ray.TMax = shadowRay.tMax;
+
+    // Any hit ends the search, the shadow miss shader marks the ray visible
+    ShadowPayload payload = { 0 };
+    TraceRay(Scene, RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH | RAY_FLAG_SKIP_CLOSEST_HIT_SHADER | RAY_FLAG_FORCE_OPAQUE, ~0,
+        RAY_TYPE_SHADOW, RAY_TYPE_COUNT, RAY_TYPE_SHADOW, ray, payload);
+
+    // Every pixel has at most one shadow ray per bounce
+    if (payload.isVisible)
+    {
+        PathRadiance[shadowRay.pixelIndex] += float4(shadowRay.contribution, 0.0f);
+    }
+}
+
+[shader("miss")]
+void WavefrontShadowMiss(inout ShadowPayload payload)
+{
+    payload.isVisible = 1;
+}
@@ -0,0 +1,211 @@
+#include "AccelerationStructurePolicy.h"
+#include <cstdlib>
+
+namespace
+{
+    bool ParseMeshUsage(const std::string& text, MeshUsage& usage)
+    {
+        if (text == "static")
+        {
+            usage = MeshUsage::Static;
+        }
+        else if (text == "deforming")
+        {
+            usage = MeshUsage::Deforming;
+        }
+        else if (text == "rebuilt")
+        {
+            usage = MeshUsage::Rebuilt;
+        }
+        else
+        {
+            return false;
+        }
+        return true;
+    }
+
+    // Split text at the separator, empty parts are skipped
+    std::vector<std::string> Split(const std::string& text, char separator)
+    {
+        std::vector<std::string> parts;
+        size_t begin = 0;
+        while (begin <= text.size())
+        {
+            size_t end = text.find(separator, begin);
+            if (end == std::string::npos)
+            {
+                end = text.size();
+            }
+            if (end > begin)
+            {
+                parts.push_back(text.substr(begin, end - begin));
+            }
+            begin = end + 1;
+        }
+        return parts;
+    }
+}
+
+const char* GetMeshUsageName(MeshUsage usage)
+{
+    switch (usage)
+    {
+    case MeshUsage::Static: return "static";
+    case MeshUsage::Deforming: return "deforming";
+    case MeshUsage::Rebuilt: return "rebuilt";
+    }
+    return "unknown";
+}
+
+const char* GetBLASRebuildReasonName(BLASRebuildReason reason)
+{
+    switch (reason)
+    {
+    case BLASRebuildReason::None: return "none";
+    case BLASRebuildReason::Usage: return "usage";
+    case BLASRebuildReason::RefitCount: return "refit count";
+    case BLASRebuildReason::SurfaceAreaGrowth: return "surface area growth";
+    }
+    return "unknown";
+}
+
+bool ParseAccelerationStructurePolicy(const std::string& text, AccelerationStructurePolicySettings& settings, std::string* error)
+{
+    AccelerationStructurePolicySettings parsed = settings;
+    for (const std::string& entry : Split(text, ';'))
+    {
+        const size_t equal = entry.find('=');
+        if (equal == std::string::npos)
+        {
+            if (error)
+            {
+                *error = "expected <key>=<value>: " + entry;
+            }
+            return false;
+        }
+
+        const std::string key = entry.substr(0, equal);
+        const std::string value = entry.substr(equal + 1);
+        const char* end = nullptr;
+        MeshUsage usage;
+        if (ParseMeshUsage(key, usage))
+        {
+            for (const std::string& pattern : Split(value, ','))
+            {
+                parsed.usageRules.push_back({ pattern, usage });
+            }
+            continue;
+        }
+        else if (key == "default" && ParseMeshUsage(value, usage))
+        {
+            parsed.defaultUsage = usage;
+            continue;
+        }
+        else if (key == "compaction" && (value == "on" || value == "off"))
+        {
+            parsed.compactStatic = value == "on";
+            continue;
+        }
+        else if (key == "refits" && !value.empty())
+        {
+            char* valueEnd = nullptr;
+            parsed.maxRefitsBeforeRebuild = static_cast<uint32_t>(strtoul(value.c_str(), &valueEnd, 10));
+            end = valueEnd;
+        }
+        else if (key == "growth" && !value.empty())
+        {
+            char* valueEnd = nullptr;
+            parsed.maxSurfaceAreaGrowth = strtof(value.c_str(), &valueEnd);
+            end = parsed.maxSurfaceAreaGrowth >= 1.0f ? valueEnd : nullptr;
+        }
+
+        // Numbers must be parsed completely
+        if (!end || *end != '\0')
+        {
+            if (error)
+            {
+                *error = "invalid entry: " + entry;
+            }
+            return false;
+        }
+    }
+
+    settings = std::move(parsed);
+    return true;
+}
+
+float GetBoundsSurfaceArea(const float boundsMin[3], const float boundsMax[3])
+{
+    const float x = boundsMax[0] - boundsMin[0];
+    const float y = boundsMax[1] - boundsMin[1];
+    const float z = boundsMax[2] - boundsMin[2];
+    return 2.0f * (x * y + y * z + z * x);
+}
+
+MeshUsage AccelerationStructurePolicy::Classify(const std::string& meshName, int* ruleIndex) const
+{
+    for (size_t i = 0; i < m_settings.usageRules.size(); ++i)
+    {
+        if (meshName.find(m_settings.usageRules[i].pattern) != std::string::npos)
+        {
+            if (ruleIndex)
+            {
+                *ruleIndex = static_cast<int>(i);
+            }
+            return m_settings.usageRules[i].usage;
+        }
+    }
+
+    if (ruleIndex)
+    {
+        *ruleIndex = -1;
+    }
+    return m_settings.defaultUsage;
+}
+
+uint32_t AccelerationStructurePolicy::GetBuildFlags(MeshUsage usage) const
+{
+    switch (usage)
+    {
+    case MeshUsage::Static:
+        return AccelerationStructureBuildFlags::PREFER_FAST_TRACE |
+            (m_settings.compactStatic ? AccelerationStructureBuildFlags::ALLOW_COMPACTION : AccelerationStructureBuildFlags::NONE);
+    case MeshUsage::Deforming:
+        return AccelerationStructureBuildFlags::PREFER_FAST_TRACE | AccelerationStructureBuildFlags::ALLOW_UPDATE;
+    case MeshUsage::Rebuilt:
+        return AccelerationStructureBuildFlags::PREFER_FAST_BUILD;
+    }
+    return AccelerationStructureBuildFlags::PREFER_FAST_TRACE;
+}
+
+BLASUpdate AccelerationStructurePolicy::DecideUpdate(MeshUsage usage, BLASUpdateState& state, float surfaceArea, BLASRebuildReason* reason) const
+{
+    BLASRebuildReason rebuildReason = BLASRebuildReason::None;
+    if (usage != MeshUsage::Deforming)
+    {
+        rebuildReason = BLASRebuildReason::Usage;
+    }
+    else if (m_settings.maxRefitsBeforeRebuild > 0 && state.refitCount >= m_settings.maxRefitsBeforeRebuild)
+    {
+        rebuildReason = BLASRebuildReason::RefitCount;
+    }
+    else if (surfaceArea > state.builtSurfaceArea * m_settings.maxSurfaceAreaGrowth)
+    {
+        rebuildReason = BLASRebuildReason::SurfaceAreaGrowth;
+    }
+
+    if (reason)
+    {
+        *reason = rebuildReason;
+    }
+
+    if (rebuildReason != BLASRebuildReason::None)
+    {
+        state.builtSurfaceArea = surfaceArea;
+        state.refitCount = 0;
+        return BLASUpdate::Rebuild;
+    }
+
+    state.refitCount++;
+    return BLASUpdate::Refit;
+}
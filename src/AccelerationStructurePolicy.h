@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Build flag policy of the bottom level acceleration structures.
+//
+// Every mesh is classified by how its geometry changes, and its BLAS is built with the flags of the class:
+// - Static: built once, traced every frame. Fast trace, compacted after the build.
+// - Deforming: positions change, topology does not. Fast trace with updates allowed; a change is applied with a refit
+//   and the BLAS is rebuilt when the refit quality has degraded too much or after a number of refits.
+// - Rebuilt: short lived or rebuilt on every change (one-shot geometry). Fast build, never refitted.
+//
+// A refit keeps the tree topology of the last build and only recomputes the node bounds, so the tree gets worse as
+// the primitives move away from where they were built. The surface area of the mesh bounds, relative to the bounds
+// at the last build, is used as the estimate of that degradation: the ray traversal cost of a node grows with its
+// surface area.
+//
+// This module has no Direct3D12 dependency.
+
+enum class MeshUsage : uint32_t
+{
+    Static,
+    Deforming,
+    Rebuilt,
+};
+
+// Build flags, same values as D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS
+namespace AccelerationStructureBuildFlags
+{
+    const uint32_t NONE = 0x0;
+    const uint32_t ALLOW_UPDATE = 0x1;
+    const uint32_t ALLOW_COMPACTION = 0x2;
+    const uint32_t PREFER_FAST_TRACE = 0x4;
+    const uint32_t PREFER_FAST_BUILD = 0x8;
+    const uint32_t MINIMIZE_MEMORY = 0x10;
+}
+
+enum class BLASUpdate : uint32_t
+{
+    Refit,
+    Rebuild,
+};
+
+// Why a deforming BLAS is rebuilt instead of refitted
+enum class BLASRebuildReason : uint32_t
+{
+    None,
+    Usage,              // the usage never refits
+    RefitCount,         // periodic rebuild after maxRefitsBeforeRebuild refits
+    SurfaceAreaGrowth,  // the bounds grew by more than maxSurfaceAreaGrowth since the last build
+};
+
+struct AccelerationStructurePolicySettings
+{
+    // Usage of the meshes matched by no rule
+    MeshUsage defaultUsage = MeshUsage::Static;
+
+    // A mesh whose name contains the pattern of a rule gets its usage, the first matching rule wins
+    struct UsageRule
+    {
+        std::string pattern;
+        MeshUsage usage;
+    };
+    std::vector<UsageRule> usageRules;
+
+    // Compact the static BLASes after the build
+    bool compactStatic = true;
+
+    // Rebuild a deforming BLAS after this many refits, 0 never rebuilds periodically
+    uint32_t maxRefitsBeforeRebuild = 60;
+
+    // Rebuild a deforming BLAS when the surface area of its bounds exceeds the area at the last build by this factor
+    float maxSurfaceAreaGrowth = 1.5f;
+};
+
+// Refit and rebuild bookkeeping of one deforming BLAS
+struct BLASUpdateState
+{
+    float builtSurfaceArea;     // surface area of the bounds at the last build
+    uint32_t refitCount;        // refits since the last build
+};
+
+const char* GetMeshUsageName(MeshUsage usage);
+const char* GetBLASRebuildReasonName(BLASRebuildReason reason);
+
+// Parse a policy of ';' separated entries into settings, the entries not given keep their value:
+//   static=<pattern>,...  deforming=<pattern>,...  rebuilt=<pattern>,...  default=<usage>
+//   compaction=<on|off>  refits=<count>  growth=<factor>
+// e.g. "deforming=cloth,flag;rebuilt=debris;refits=30;growth=1.25"
+bool ParseAccelerationStructurePolicy(const std::string& text, AccelerationStructurePolicySettings& settings, std::string* error = nullptr);
+
+// Surface area of an axis aligned box
+float GetBoundsSurfaceArea(const float boundsMin[3], const float boundsMax[3]);
+
+class AccelerationStructurePolicy
+{
+public:
+    AccelerationStructurePolicy() = default;
+    explicit AccelerationStructurePolicy(const AccelerationStructurePolicySettings& settings) : m_settings(settings) {}
+
+    const AccelerationStructurePolicySettings& GetSettings() const { return m_settings; }
+
+    // Usage of a mesh from the rules matching its name, and the index of the matching rule or -1 for the default
+    MeshUsage Classify(const std::string& meshName, int* ruleIndex = nullptr) const;
+
+    // BLAS build flags of a usage
+    uint32_t GetBuildFlags(MeshUsage usage) const;
+
+    // Refit or rebuild a BLAS whose bounds now have the given surface area. The state is updated for the decision.
+    BLASUpdate DecideUpdate(MeshUsage usage, BLASUpdateState& state, float surfaceArea, BLASRebuildReason* reason = nullptr) const;
+
+private:
+    AccelerationStructurePolicySettings m_settings;
+};
@@ -0,0 +1,275 @@
+#include "AllocationReplay.h"
+#include "PlatformHelpers.h"
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <unordered_map>
+
+namespace
+{
+    // The allocator used by HeapManager
+    class BestFitAllocatorBackend : public AllocatorBackend
+    {
+    public:
+        BestFitAllocatorBackend(const AllocationTraceHeapInfo& heap) :
+            m_allocator(static_cast<uint32_t>(heap.capacity / heap.alignment), heap.alignment, heap.alignment, heap.name.c_str(), false)
+        {
+        }
+
+        uint32_t Allocate(uint32_t allocationSize) override { return m_allocator.Allocate(allocationSize); }
+        void Free(uint32_t offset) override { m_allocator.Free(offset); }
+        HeapAllocationStats GetStats() const override { return m_allocator.GetStats(); }
+
+    private:
+        HeapAllocator m_allocator;
+    };
+
+    // Address ordered first-fit allocator, as a reference strategy
+    class FirstFitAllocatorBackend : public AllocatorBackend
+    {
+    public:
+        FirstFitAllocatorBackend(const AllocationTraceHeapInfo& heap) :
+            m_capacity(static_cast<uint32_t>(AlignSize(heap.capacity, heap.alignment))),
+            m_alignment(heap.alignment)
+        {
+            m_freeBlocks[0] = m_capacity;
+        }
+
+        uint32_t Allocate(uint32_t allocationSize) override
+        {
+            const uint32_t alignedSize = AlignSize(allocationSize, m_alignment);
+            for (auto it = m_freeBlocks.begin(); it != m_freeBlocks.end(); ++it)
+            {
+                if (it->second < alignedSize)
+                {
+                    continue;
+                }
+
+                const uint32_t offset = it->first;
+                const uint32_t remaining = it->second - alignedSize;
+                m_freeBlocks.erase(it);
+                if (remaining > 0)
+                {
+                    m_freeBlocks[offset + alignedSize] = remaining;
+                }
+                m_allocations[offset] = alignedSize;
+                return offset;
+            }
+            return HeapAllocator::INVALID_OFFSET;
+        }
+
+        void Free(uint32_t offset) override
+        {
+            auto allocIt = m_allocations.find(offset);
+            if (allocIt == m_allocations.end())
+            {
+                return;
+            }
+
+            uint32_t blockOffset = offset;
+            uint32_t blockSize = allocIt->second;
+            m_allocations.erase(allocIt);
+
+            // Coalesce with the next free block
+            auto nextIt = m_freeBlocks.find(blockOffset + blockSize);
+            if (nextIt != m_freeBlocks.end())
+            {
+                blockSize += nextIt->second;
+                m_freeBlocks.erase(nextIt);
+            }
+
+            // Coalesce with the previous free block
+            auto prevIt = m_freeBlocks.lower_bound(blockOffset);
+            if (prevIt != m_freeBlocks.begin())
+            {
+                --prevIt;
+                if (prevIt->first + prevIt->second == blockOffset)
+                {
+                    blockOffset = prevIt->first;
+                    blockSize += prevIt->second;
+                    m_freeBlocks.erase(prevIt);
+                }
+            }
+
+            m_freeBlocks[blockOffset] = blockSize;
+        }
+
+        HeapAllocationStats GetStats() const override
+        {
+            HeapAllocationStats stats = {};
+            stats.totalSize = m_capacity;
+            stats.numAllocations = m_allocations.size();
+            stats.numFreeBlocks = m_freeBlocks.size();
+
+            size_t freeSpace = 0;
+            for (const auto& block : m_freeBlocks)
+            {
+                freeSpace += block.second;
+                stats.largestFreeBlock = std::max(stats.largestFreeBlock, static_cast<size_t>(block.second));
+            }
+            stats.usedSize = stats.totalSize - freeSpace;
+
+            if (freeSpace > 0)
+            {
+                stats.fragmentationRatio = 1.0f - (static_cast<float>(stats.largestFreeBlock) / static_cast<float>(freeSpace));
+            }
+            return stats;
+        }
+
+    private:
+        uint32_t m_capacity;
+        uint32_t m_alignment;
+        std::map<uint32_t, uint32_t> m_freeBlocks;      // offset -> size
+        std::map<uint32_t, uint32_t> m_allocations;     // offset -> aligned size
+    };
+
+    struct ReplayAllocation
+    {
+        uint32_t offset;        // offset returned by the backend
+        uint32_t alignedSize;
+    };
+
+    struct ReplayHeapState
+    {
+        std::unique_ptr<AllocatorBackend> backend;
+        std::unordered_map<uint32_t, ReplayAllocation> offsetRemap;   // trace offset -> backend allocation
+        AllocationReplayHeapResult result;
+        uint32_t alignment;
+        size_t usedSize;
+    };
+}
+
+std::vector<std::string> GetAllocatorBackendNames()
+{
+    return { "best-fit", "first-fit" };
+}
+
+AllocatorBackendFactory GetAllocatorBackendFactory(const std::string& name)
+{
+    if (name == "best-fit")
+    {
+        return [](const AllocationTraceHeapInfo& heap) { return std::make_unique<BestFitAllocatorBackend>(heap); };
+    }
+    if (name == "first-fit")
+    {
+        return [](const AllocationTraceHeapInfo& heap) { return std::make_unique<FirstFitAllocatorBackend>(heap); };
+    }
+    return {};
+}
+
+AllocationReplayResult ReplayAllocationTrace(const AllocationTrace& trace, const std::string& backendName,
+    const AllocatorBackendFactory& factory, uint32_t sampleInterval)
+{
+    AllocationReplayResult result;
+    result.backendName = backendName;
+    result.numEvents = trace.events.size();
+
+    // Create a backend per heap
+    std::unordered_map<uint32_t, ReplayHeapState> heaps;
+    for (const auto& heap : trace.heaps)
+    {
+        ReplayHeapState& state = heaps[heap.heapId];
+        state.backend = factory(heap);
+        state.alignment = std::max(heap.alignment, 1u);
+        state.usedSize = 0;
+        state.result = {};
+        state.result.heapId = heap.heapId;
+        state.result.name = heap.name;
+        state.result.capacity = heap.capacity;
+    }
+
+    auto SampleHeaps = [&](uint64_t eventIndex, uint64_t timestamp)
+    {
+        for (const auto& heap : trace.heaps)
+        {
+            const HeapAllocationStats stats = heaps[heap.heapId].backend->GetStats();
+            result.fragmentation.push_back({ eventIndex, timestamp, heap.heapId,
+                stats.usedSize, stats.largestFreeBlock, stats.numFreeBlocks, stats.fragmentationRatio });
+        }
+    };
+
+    using Clock = std::chrono::steady_clock;
+    Clock::duration elapsed = {};
+    Clock::time_point segmentStart = Clock::now();
+
+    for (uint64_t eventIndex = 0; eventIndex < trace.events.size(); ++eventIndex)
+    {
+        const AllocationTraceEvent& event = trace.events[eventIndex];
+        auto heapIt = heaps.find(event.heapId);
+        if (heapIt == heaps.end())
+        {
+            continue;
+        }
+        ReplayHeapState& heap = heapIt->second;
+
+        switch (event.type)
+        {
+        case AllocationTraceEventType::Allocate:
+        case AllocationTraceEventType::AllocateFailed:
+        {
+            const bool failedInTrace = event.type == AllocationTraceEventType::AllocateFailed;
+            const uint32_t offset = heap.backend->Allocate(event.size);
+            if (offset == HeapAllocator::INVALID_OFFSET)
+            {
+                // Stats are taken outside of the measured time
+                elapsed += Clock::now() - segmentStart;
+                const HeapAllocationStats stats = heap.backend->GetStats();
+                result.failures.push_back({ eventIndex, event.timestamp, event.heapId, event.size,
+                    stats.usedSize, stats.largestFreeBlock, failedInTrace });
+                segmentStart = Clock::now();
+            }
+            else if (failedInTrace)
+            {
+                // The application never received this allocation, so it never frees it
+                heap.backend->Free(offset);
+            }
+            else
+            {
+                const uint32_t alignedSize = AlignSize(event.size, heap.alignment);
+                heap.offsetRemap[event.offset] = { offset, alignedSize };
+                heap.usedSize += alignedSize;
+                heap.result.numAllocations++;
+                heap.result.peakUsedSize = std::max(heap.result.peakUsedSize, heap.usedSize);
+                heap.result.peakFootprint = std::max(heap.result.peakFootprint, static_cast<uint64_t>(offset) + alignedSize);
+            }
+            break;
+        }
+        case AllocationTraceEventType::Free:
+        {
+            auto remapIt = heap.offsetRemap.find(event.offset);
+            if (remapIt != heap.offsetRemap.end())
+            {
+                heap.backend->Free(remapIt->second.offset);
+                heap.usedSize -= remapIt->second.alignedSize;
+                heap.offsetRemap.erase(remapIt);
+                heap.result.numFrees++;
+            }
+            break;
+        }
+        }
+
+        if (sampleInterval > 0 && (eventIndex + 1) % sampleInterval == 0)
+        {
+            elapsed += Clock::now() - segmentStart;
+            SampleHeaps(eventIndex, event.timestamp);
+            segmentStart = Clock::now();
+        }
+    }
+    elapsed += Clock::now() - segmentStart;
+
+    // Final sample so that short traces have at least one point
+    if (!trace.events.empty())
+    {
+        SampleHeaps(trace.events.size() - 1, trace.events.back().timestamp);
+    }
+
+    result.elapsedSeconds = std::chrono::duration<double>(elapsed).count();
+    result.operationsPerSecond = result.elapsedSeconds > 0.0 ? static_cast<double>(result.numEvents) / result.elapsedSeconds : 0.0;
+
+    for (const auto& heap : trace.heaps)
+    {
+        result.heaps.push_back(heaps[heap.heapId].result);
+    }
+
+    return result;
+}
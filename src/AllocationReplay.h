@@ -0,0 +1,79 @@
+#pragma once
+
+#include "AllocationTrace.h"
+#include "HeapAllocator.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Allocator strategy which an allocation trace can be replayed against
+class AllocatorBackend
+{
+public:
+    virtual ~AllocatorBackend() = default;
+
+    // Returns HeapAllocator::INVALID_OFFSET on failure
+    virtual uint32_t Allocate(uint32_t allocationSize) = 0;
+    virtual void Free(uint32_t offset) = 0;
+    virtual HeapAllocationStats GetStats() const = 0;
+};
+
+// Creates a backend for one heap of the trace
+using AllocatorBackendFactory = std::function<std::unique_ptr<AllocatorBackend>(const AllocationTraceHeapInfo& heap)>;
+
+// Names of the built-in backends ("best-fit" is the HeapAllocator used by the renderer)
+std::vector<std::string> GetAllocatorBackendNames();
+
+// Get the factory of a built-in backend. Returns an empty function for unknown names.
+AllocatorBackendFactory GetAllocatorBackendFactory(const std::string& name);
+
+struct AllocationReplaySample
+{
+    uint64_t eventIndex;
+    uint64_t timestamp;
+    uint32_t heapId;
+    size_t usedSize;
+    size_t largestFreeBlock;
+    size_t numFreeBlocks;
+    float fragmentationRatio;
+};
+
+struct AllocationReplayFailure
+{
+    uint64_t eventIndex;
+    uint64_t timestamp;
+    uint32_t heapId;
+    uint32_t size;
+    size_t usedSize;            // used size of the heap when the allocation failed
+    size_t largestFreeBlock;    // largest free block of the heap when the allocation failed
+    bool failedInTrace;         // the allocation also failed when the trace was recorded
+};
+
+struct AllocationReplayHeapResult
+{
+    uint32_t heapId;
+    std::string name;
+    uint64_t capacity;
+    uint64_t numAllocations;
+    uint64_t numFrees;
+    size_t peakUsedSize;        // peak of the bytes held by live allocations
+    uint64_t peakFootprint;     // peak of the highest end offset of live allocations
+};
+
+struct AllocationReplayResult
+{
+    std::string backendName;
+    uint64_t numEvents = 0;
+    double elapsedSeconds = 0.0;        // time spent inside the backend
+    double operationsPerSecond = 0.0;
+    std::vector<AllocationReplayHeapResult> heaps;
+    std::vector<AllocationReplaySample> fragmentation;  // sampled every sampleInterval events per heap
+    std::vector<AllocationReplayFailure> failures;
+};
+
+// Feed every event of the trace into the backend created by the factory.
+// Offsets of the trace are remapped to the offsets returned by the backend, so that
+// a backend with a different placement strategy sees the same allocation lifetime.
+AllocationReplayResult ReplayAllocationTrace(const AllocationTrace& trace, const std::string& backendName,
+    const AllocatorBackendFactory& factory, uint32_t sampleInterval);
@@ -0,0 +1,299 @@
+#include "AllocationTrace.h"
+#include "PlatformHelpers.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <format>
+
+AllocationTraceRecorder::AllocationTraceRecorder() :
+    m_isRecording(false),
+    m_stopWriter(false),
+    m_numActiveProducers(0),
+    m_ringBufferMask(0),
+    m_writeIndex(0),
+    m_readIndex(0),
+    m_numDroppedEvents(0),
+    m_file(nullptr),
+    m_numWrittenEvents(0)
+{
+}
+
+AllocationTraceRecorder::~AllocationTraceRecorder()
+{
+    Close();
+}
+
+AllocationTraceRecorder& AllocationTraceRecorder::Instance()
+{
+    static AllocationTraceRecorder recorder;
+    return recorder;
+}
+
+bool AllocationTraceRecorder::Open(const char* path, uint32_t ringBufferSize)
+{
+    if (IsRecording())
+    {
+        OutputDebugStringA("AllocationTraceRecorder: already recording\n");
+        return false;
+    }
+
+    m_file = OpenFileStream(path, "wb");
+    if (!m_file)
+    {
+        OutputDebugStringA(std::format("AllocationTraceRecorder: failed to open {}\n", path).c_str());
+        return false;
+    }
+
+    // Header is rewritten with the final counts in Close()
+    AllocationTraceFileHeader header = {};
+    memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+    header.version = FILE_VERSION;
+    header.eventSize = sizeof(AllocationTraceEvent);
+    fwrite(&header, sizeof(header), 1, m_file);
+
+    const uint64_t capacity = std::bit_ceil(static_cast<uint64_t>(std::max(ringBufferSize, 2u)));
+    m_slots = std::make_unique<Slot[]>(capacity);
+    for (uint64_t i = 0; i < capacity; ++i)
+    {
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    m_ringBufferMask = capacity - 1;
+    m_writeIndex.store(0, std::memory_order_relaxed);
+    m_readIndex = 0;
+    m_numDroppedEvents.store(0, std::memory_order_relaxed);
+    m_numWrittenEvents = 0;
+    m_writeBuffer.reserve(4096);
+
+    {
+        std::lock_guard<std::mutex> lock(m_heapMutex);
+        m_heaps.clear();
+    }
+
+    m_startTime = std::chrono::steady_clock::now();
+    m_stopWriter = false;
+    m_writerThread = std::thread(&AllocationTraceRecorder::WriterThread, this);
+    m_isRecording.store(true, std::memory_order_release);
+
+    OutputDebugStringA(std::format("AllocationTraceRecorder: recording to {}\n", path).c_str());
+    return true;
+}
+
+void AllocationTraceRecorder::Close()
+{
+    if (!IsRecording())
+    {
+        return;
+    }
+    // Sequentially consistent with the producer count of Record(): a producer either sees the cleared flag or is
+    // counted here, so no event is pushed after the final drain or into the freed ring buffer.
+    m_isRecording.store(false, std::memory_order_seq_cst);
+    while (m_numActiveProducers.load(std::memory_order_seq_cst) > 0)
+    {
+        std::this_thread::yield();
+    }
+
+    // Stop the writer thread. It drains the ring buffer before exiting.
+    m_stopWriter = true;
+    if (m_writerThread.joinable())
+    {
+        m_writerThread.join();
+    }
+
+    // Write heap table
+    AllocationTraceFileHeader header = {};
+    memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+    header.version = FILE_VERSION;
+    header.eventSize = sizeof(AllocationTraceEvent);
+    header.numEvents = m_numWrittenEvents;
+    header.numDroppedEvents = m_numDroppedEvents.load(std::memory_order_relaxed);
+    header.heapTableOffset = sizeof(AllocationTraceFileHeader) + m_numWrittenEvents * sizeof(AllocationTraceEvent);
+    {
+        std::lock_guard<std::mutex> lock(m_heapMutex);
+
+        const uint32_t numHeaps = static_cast<uint32_t>(m_heaps.size());
+        fwrite(&numHeaps, sizeof(numHeaps), 1, m_file);
+        for (const auto& heap : m_heaps)
+        {
+            const uint32_t nameLength = static_cast<uint32_t>(heap.name.size());
+            fwrite(&heap.heapId, sizeof(heap.heapId), 1, m_file);
+            fwrite(&heap.alignment, sizeof(heap.alignment), 1, m_file);
+            fwrite(&heap.capacity, sizeof(heap.capacity), 1, m_file);
+            fwrite(&nameLength, sizeof(nameLength), 1, m_file);
+            fwrite(heap.name.data(), 1, nameLength, m_file);
+        }
+    }
+
+    // Rewrite header with the final counts
+    SeekFile(m_file, 0);
+    fwrite(&header, sizeof(header), 1, m_file);
+    fclose(m_file);
+    m_file = nullptr;
+    m_slots.reset();
+
+    OutputDebugStringA(std::format("AllocationTraceRecorder: finished. events={}, dropped={}\n",
+        header.numEvents, header.numDroppedEvents).c_str());
+}
+
+uint32_t AllocationTraceRecorder::RegisterHeap(const std::string& name, uint64_t capacity, uint32_t alignment)
+{
+    std::lock_guard<std::mutex> lock(m_heapMutex);
+
+    AllocationTraceHeapInfo heap;
+    heap.heapId = static_cast<uint32_t>(m_heaps.size());
+    heap.alignment = alignment;
+    heap.capacity = capacity;
+    heap.name = name;
+    m_heaps.push_back(heap);
+
+    return heap.heapId;
+}
+
+void AllocationTraceRecorder::Record(AllocationTraceEventType type, uint32_t heapId, uint32_t size, uint32_t offset)
+{
+    m_numActiveProducers.fetch_add(1, std::memory_order_seq_cst);
+    if (m_isRecording.load(std::memory_order_seq_cst))
+    {
+        Push(type, heapId, size, offset);
+    }
+    m_numActiveProducers.fetch_sub(1, std::memory_order_release);
+}
+
+void AllocationTraceRecorder::Push(AllocationTraceEventType type, uint32_t heapId, uint32_t size, uint32_t offset)
+{
+    const uint64_t timestamp = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - m_startTime).count());
+
+    // Bounded MPSC queue. A slot is free for the producer when its sequence equals the write index,
+    // and is published to the consumer by storing index + 1.
+    uint64_t index = m_writeIndex.load(std::memory_order_relaxed);
+    Slot* slot = nullptr;
+    for (;;)
+    {
+        slot = &m_slots[index & m_ringBufferMask];
+        const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        if (sequence == index)
+        {
+            if (m_writeIndex.compare_exchange_weak(index, index + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (sequence < index)
+        {
+            // Ring buffer is full. Drop the event rather than stalling the allocation.
+            m_numDroppedEvents.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        else
+        {
+            index = m_writeIndex.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->event.timestamp = timestamp;
+    slot->event.heapId = heapId;
+    slot->event.type = type;
+    slot->event.size = size;
+    slot->event.offset = offset;
+    slot->sequence.store(index + 1, std::memory_order_release);
+}
+
+void AllocationTraceRecorder::Drain()
+{
+    m_writeBuffer.clear();
+    for (;;)
+    {
+        Slot& slot = m_slots[m_readIndex & m_ringBufferMask];
+        if (slot.sequence.load(std::memory_order_acquire) != m_readIndex + 1)
+        {
+            break;
+        }
+
+        m_writeBuffer.push_back(slot.event);
+
+        // Hand the slot back to the producers for the next lap
+        slot.sequence.store(m_readIndex + m_ringBufferMask + 1, std::memory_order_release);
+        ++m_readIndex;
+    }
+
+    if (!m_writeBuffer.empty())
+    {
+        fwrite(m_writeBuffer.data(), sizeof(AllocationTraceEvent), m_writeBuffer.size(), m_file);
+        m_numWrittenEvents += m_writeBuffer.size();
+    }
+}
+
+void AllocationTraceRecorder::WriterThread()
+{
+    while (!m_stopWriter)
+    {
+        Drain();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // Final drain after the recording flag is cleared
+    Drain();
+}
+
+bool LoadAllocationTrace(const char* path, AllocationTrace& trace)
+{
+    FILE* file = OpenFileStream(path, "rb");
+    if (!file)
+    {
+        OutputDebugStringA(std::format("LoadAllocationTrace: failed to open {}\n", path).c_str());
+        return false;
+    }
+
+    AllocationTraceFileHeader header = {};
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, AllocationTraceRecorder::FILE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != AllocationTraceRecorder::FILE_VERSION ||
+        header.eventSize != sizeof(AllocationTraceEvent))
+    {
+        OutputDebugStringA(std::format("LoadAllocationTrace: {} is not a supported trace file\n", path).c_str());
+        fclose(file);
+        return false;
+    }
+
+    trace.numDroppedEvents = header.numDroppedEvents;
+    trace.events.resize(header.numEvents);
+    if (fread(trace.events.data(), sizeof(AllocationTraceEvent), trace.events.size(), file) != trace.events.size())
+    {
+        OutputDebugStringA("LoadAllocationTrace: truncated event stream\n");
+        fclose(file);
+        return false;
+    }
+
+    uint32_t numHeaps = 0;
+    SeekFile(file, header.heapTableOffset);
+    if (fread(&numHeaps, sizeof(numHeaps), 1, file) != 1)
+    {
+        OutputDebugStringA("LoadAllocationTrace: missing heap table\n");
+        fclose(file);
+        return false;
+    }
+
+    trace.heaps.resize(numHeaps);
+    for (auto& heap : trace.heaps)
+    {
+        uint32_t nameLength = 0;
+        bool succeeded = fread(&heap.heapId, sizeof(heap.heapId), 1, file) == 1;
+        succeeded = succeeded && fread(&heap.alignment, sizeof(heap.alignment), 1, file) == 1;
+        succeeded = succeeded && fread(&heap.capacity, sizeof(heap.capacity), 1, file) == 1;
+        succeeded = succeeded && fread(&nameLength, sizeof(nameLength), 1, file) == 1;
+        if (succeeded)
+        {
+            heap.name.resize(nameLength);
+            succeeded = fread(heap.name.data(), 1, nameLength, file) == nameLength;
+        }
+        if (!succeeded)
+        {
+            OutputDebugStringA("LoadAllocationTrace: truncated heap table\n");
+            fclose(file);
+            return false;
+        }
+    }
+
+    fclose(file);
+    return true;
+}
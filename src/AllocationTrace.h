@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Binary allocation trace of HeapAllocator.
+//
+// File layout (little endian):
+//   AllocationTraceFileHeader
+//   AllocationTraceEvent[numEvents]
+//   heap table at heapTableOffset:
+//     uint32_t numHeaps
+//     per heap: uint32_t heapId, uint32_t alignment, uint64_t capacity, uint32_t nameLength, char name[nameLength]
+
+enum class AllocationTraceEventType : uint32_t
+{
+    Allocate = 0,
+    Free,
+    AllocateFailed,
+};
+
+struct AllocationTraceEvent
+{
+    uint64_t timestamp;     // nanoseconds since the recording started
+    uint32_t heapId;
+    AllocationTraceEventType type;
+    uint32_t size;          // requested size for allocations, block size for frees
+    uint32_t offset;        // offset returned by the allocator, or the freed offset
+};
+static_assert(sizeof(AllocationTraceEvent) == 24, "AllocationTraceEvent is written to the file as is");
+
+struct AllocationTraceFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t eventSize;
+    uint64_t numEvents;
+    uint64_t numDroppedEvents;
+    uint64_t heapTableOffset;
+};
+
+struct AllocationTraceHeapInfo
+{
+    uint32_t heapId;
+    uint32_t alignment;
+    uint64_t capacity;
+    std::string name;
+};
+
+// Whole trace loaded in memory, used by the replay tool
+struct AllocationTrace
+{
+    std::vector<AllocationTraceHeapInfo> heaps;
+    std::vector<AllocationTraceEvent> events;
+    uint64_t numDroppedEvents = 0;
+};
+
+// Load a trace file written by AllocationTraceRecorder
+bool LoadAllocationTrace(const char* path, AllocationTrace& trace);
+
+// Records allocation events of every HeapAllocator into a binary file.
+// Record() is lock-free and can be called from any thread. Events are pushed into a bounded
+// ring buffer and a writer thread drains them into the file. When the ring buffer is full,
+// events are dropped and counted instead of blocking the allocating thread. Close() waits for the producers which
+// are still inside Record() before the final drain, so every event is either written or counted as dropped.
+class AllocationTraceRecorder
+{
+public:
+    static constexpr char FILE_MAGIC[8] = { 'D', '3', 'M', 'P', 'A', 'T', 'R', 'C' };
+    static constexpr uint32_t FILE_VERSION = 1;
+
+    AllocationTraceRecorder();
+    ~AllocationTraceRecorder();
+
+    // Global recorder shared by all heap allocators
+    static AllocationTraceRecorder& Instance();
+
+    // Start recording into the file. ringBufferSize is rounded up to a power of two.
+    bool Open(const char* path, uint32_t ringBufferSize = 64 * 1024);
+
+    // Stop recording, drain the remaining events and finalize the file
+    void Close();
+
+    bool IsRecording() const { return m_isRecording.load(std::memory_order_acquire); }
+
+    // Register a heap and get the id used by Record()
+    uint32_t RegisterHeap(const std::string& name, uint64_t capacity, uint32_t alignment);
+
+    // Push an event into the ring buffer
+    void Record(AllocationTraceEventType type, uint32_t heapId, uint32_t size, uint32_t offset);
+
+    uint64_t NumDroppedEvents() const { return m_numDroppedEvents.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence;
+        AllocationTraceEvent event;
+    };
+
+    // Claim a slot of the ring buffer and publish the event, or count it as dropped
+    void Push(AllocationTraceEventType type, uint32_t heapId, uint32_t size, uint32_t offset);
+
+    // Write out the events which are already published by the producers
+    void Drain();
+    void WriterThread();
+
+    std::atomic<bool> m_isRecording;
+    std::atomic<bool> m_stopWriter;
+
+    // Producers between the recording check of Record() and the end of Push()
+    std::atomic<uint32_t> m_numActiveProducers;
+
+    // Ring buffer
+    std::unique_ptr<Slot[]> m_slots;
+    uint64_t m_ringBufferMask;
+    alignas(64) std::atomic<uint64_t> m_writeIndex;
+    alignas(64) uint64_t m_readIndex;
+    std::atomic<uint64_t> m_numDroppedEvents;
+
+    // File output (writer thread only, except for Open/Close)
+    FILE* m_file;
+    uint64_t m_numWrittenEvents;
+    std::vector<AllocationTraceEvent> m_writeBuffer;
+    std::thread m_writerThread;
+
+    // Heap table
+    std::mutex m_heapMutex;
+    std::vector<AllocationTraceHeapInfo> m_heaps;
+
+    std::chrono::steady_clock::time_point m_startTime;
+};
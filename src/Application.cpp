@@ -3,8 +3,15 @@
 #include "ImGuiManager.h"
 #include "Scene.h"
 #include "Raytracing.h"
+#include "AllocationTrace.h"
+#include "MemoryDashboard.h"
+#include "FileWatcher.h"
 #include <cmath>
 #include <algorithm>
+#include <filesystem>
+#include <format>
+#include <vector>
+#include <shellapi.h>
 #include <imgui.h>
 
 #ifdef _DEBUG
@@ -14,6 +21,10 @@
 // Window class name
 static const wchar_t WINDOW_CLASS_NAME[] = L"D3D12MiniPathtracerWindowClass";
 
+// Instance animation: every INSTANCE_ANIMATION_STRIDE-th instance spins around its vertical axis
+static const uint32_t INSTANCE_ANIMATION_STRIDE = 8;
+static const float INSTANCE_ANIMATION_RADIANS_PER_FRAME = 0.02f;
+
 // Application class implementation
 Application::Application(uint32_t width, uint32_t height, const std::wstring& name) :
     m_hwnd(nullptr),
@@ -32,7 +43,11 @@ Application::Application(uint32_t width, uint32_t height, const std::wstring& na
     m_imguiManager(std::make_unique<ImGuiManager>()),
     m_scene(std::make_unique<Scene>()),
     m_raytracing(std::make_unique<Raytracing>()),
-    m_isDxrSupported(false)
+    m_isDxrSupported(false),
+    m_isRenderModeCycling(false),
+    m_isInstanceAnimationEnabled(false),
+    m_memoryDashboard(std::make_unique<MemoryDashboard>()),
+    m_shaderWatcher(std::make_unique<FileWatcher>())
 {
     m_aspectRatio = static_cast<float>(width) / static_cast<float>(height);
     
@@ -88,17 +103,17 @@ void Application::OnInit()
         // Initialize scene
         m_scene->Initialize(m_device.Get());
         
-        // Create acceleration structures
-        ThrowIfFailed(m_commandAllocators[0]->Reset());
-        ThrowIfFailed(m_commandList->Reset(m_commandAllocators[0].Get(), nullptr));
-        
-        m_scene->BuildAccelerationStructures(m_commandList.Get(), m_commandAllocators[0].Get(), m_commandQueue.Get());
-        
-        // Close command list after building
-        ThrowIfFailed(m_commandList->Close());
+        // Create acceleration structures on the compute queue of the scene, the first frame waits for them on the GPU
+        m_scene->BuildAccelerationStructures();
         
         // Initialize raytracing
-        m_raytracing->Initialize(m_device.Get(), m_width, m_height, SWAP_CHAIN_BUFFER_COUNT);
+        m_raytracing->Initialize(m_device.Get(), m_commandQueue.Get(), m_width, m_height, SWAP_CHAIN_BUFFER_COUNT);
+
+        // Hot reload of the shaders, the sources are read relative to the working directory like the compiler does
+        if (!m_shaderWatcher->Start("shaders", { ".hlsl", ".hlsli" }))
+        {
+            OutputDebugStringA("The shader directory is not watched, shaders are not reloaded.\n");
+        }
         
         OutputDebugStringA("DXR initialization completed. Acceleration structures and pipeline are ready.\n");
     }
@@ -138,8 +153,29 @@ void Application::OnRender()
     // Check if DXR is enabled and raytracing is initialized
     if (m_isDxrSupported && m_raytracing && m_scene)
     {
+        // The TLAS with the moved instances is built before the frame picks its TLAS
+        if (m_isInstanceAnimationEnabled)
+        {
+            AnimateInstances();
+        }
+
+        // Pick the TLAS of this frame, the queue waits for the compute queue only if it has not been built yet
+        m_scene->BeginFrame(m_commandQueue.Get());
+        m_raytracing->BeginFrame(m_fenceValues[m_currentBackBufferIndex], m_fence->GetCompletedValue());
         m_raytracing->UpdateDescriptorHeap(m_scene.get(), m_currentBackBufferIndex);
 
+        // Saved shader sources reload the pipelines including them, the pipelines in use keep rendering until the new
+        // ones are compiled
+        std::vector<std::string> changedShaders = m_shaderWatcher->TakeChanges();
+        if (!changedShaders.empty())
+        {
+            for (const std::string& path : changedShaders)
+            {
+                OutputDebugStringA(std::format("Shader changed: {}\n", path).c_str());
+            }
+            m_raytracing->ReloadShaders(changedShaders);
+        }
+
         // Perform raytracing
         m_raytracing->Render(m_commandList.Get(), m_currentBackBufferIndex);
         
@@ -197,8 +233,168 @@ void Application::OnRender()
     ImGui::Separator();
     ImGui::Text("Swap Chain Buffer Count: %u", SWAP_CHAIN_BUFFER_COUNT);
     ImGui::Text("Window Size: %u x %u", m_width, m_height);
+
+    // Render mode, applied from the next frame, and the GPU time of every mode
+    if (m_isDxrSupported && m_raytracing)
+    {
+        ImGui::Separator();
+        int renderMode = static_cast<int>(m_raytracing->GetRenderMode());
+        for (uint32_t mode = 0; mode < static_cast<uint32_t>(RenderMode::Count); ++mode)
+        {
+            if (!m_raytracing->IsRenderModeSupported(static_cast<RenderMode>(mode)))
+            {
+                continue;
+            }
+            if (mode > 0)
+            {
+                ImGui::SameLine();
+            }
+            ImGui::RadioButton(GetRenderModeName(static_cast<RenderMode>(mode)), &renderMode, static_cast<int>(mode));
+        }
+        ImGui::Checkbox("Cycle Render Modes", &m_isRenderModeCycling);
+        ImGui::Checkbox("Animate Instances", &m_isInstanceAnimationEnabled);
+        if (m_isRenderModeCycling)
+        {
+            do
+            {
+                renderMode = (renderMode + 1) % static_cast<int>(RenderMode::Count);
+            } while (!m_raytracing->IsRenderModeSupported(static_cast<RenderMode>(renderMode)));
+        }
+        if (renderMode != static_cast<int>(m_raytracing->GetRenderMode()))
+        {
+            m_raytracing->SetRenderMode(static_cast<RenderMode>(renderMode));
+        }
+
+        // Progressive path tracing of every render mode
+        int maxBounces = static_cast<int>(m_raytracing->GetMaxBounces());
+        if (ImGui::SliderInt("Max Bounces", &maxBounces, 1, 32))
+        {
+            m_raytracing->SetMaxBounces(static_cast<uint32_t>(maxBounces));
+        }
+        const char* samplerTypeNames[static_cast<uint32_t>(SamplerType::Count)];
+        for (uint32_t type = 0; type < static_cast<uint32_t>(SamplerType::Count); ++type)
+        {
+            samplerTypeNames[type] = GetSamplerTypeName(static_cast<SamplerType>(type));
+        }
+        int samplerType = static_cast<int>(m_raytracing->GetSamplerType());
+        if (ImGui::Combo("Sampler", &samplerType, samplerTypeNames, static_cast<int>(SamplerType::Count)))
+        {
+            m_raytracing->SetSamplerType(static_cast<SamplerType>(samplerType));
+        }
+        ImGui::Text("Samples: %u", m_raytracing->GetSampleCount());
+        ImGui::SameLine();
+        if (ImGui::Button("Reset Accumulation"))
+        {
+            m_raytracing->ResetAccumulation();
+        }
+        if (ImGui::Button("Reload Shaders"))
+        {
+            m_raytracing->ReloadShaders();
+        }
+        if (m_raytracing->IsPipelineReloadPending())
+        {
+            ImGui::SameLine();
+            ImGui::TextDisabled("Compiling the reloaded pipelines...");
+        }
+
+        // Shader permutation of the megakernel, compiled in the background while the current one keeps rendering
+        if (m_raytracing->GetRenderMode() == RenderMode::Megakernel)
+        {
+            ShaderPermutationKey key = m_raytracing->GetShaderPermutation();
+            bool isBounceLimitSpecialized = key.Get(ShaderPermutationAxis::MaxBounces) != 0;
+            if (ImGui::Checkbox("Specialize Max Bounces", &isBounceLimitSpecialized))
+            {
+                key.Set(ShaderPermutationAxis::MaxBounces, isBounceLimitSpecialized ? m_raytracing->GetMaxBounces() : 0);
+            }
+            bool isNeeEnabled = key.Get(ShaderPermutationAxis::NEE) == static_cast<uint32_t>(NextEventEstimation::On);
+            if (ImGui::Checkbox("Next Event Estimation", &isNeeEnabled))
+            {
+                key.Set(ShaderPermutationAxis::NEE, static_cast<uint32_t>(isNeeEnabled ? NextEventEstimation::On : NextEventEstimation::Off));
+            }
+            bool isPackedPayload = key.Get(ShaderPermutationAxis::PayloadPrecision) == static_cast<uint32_t>(PayloadPrecision::Packed);
+            if (ImGui::Checkbox("Packed Payload", &isPackedPayload))
+            {
+                key.Set(ShaderPermutationAxis::PayloadPrecision, static_cast<uint32_t>(isPackedPayload ? PayloadPrecision::Packed : PayloadPrecision::Full));
+            }
+            const char* debugViewNames[static_cast<uint32_t>(DebugView::Count)];
+            for (uint32_t view = 0; view < static_cast<uint32_t>(DebugView::Count); ++view)
+            {
+                debugViewNames[view] = GetDebugViewName(static_cast<DebugView>(view));
+            }
+            int debugView = static_cast<int>(key.Get(ShaderPermutationAxis::DebugView));
+            if (ImGui::Combo("Debug View", &debugView, debugViewNames, static_cast<int>(DebugView::Count)))
+            {
+                key.Set(ShaderPermutationAxis::DebugView, static_cast<uint32_t>(debugView));
+            }
+            if (key != m_raytracing->GetShaderPermutation())
+            {
+                m_raytracing->SetShaderPermutation(key);
+            }
+            if (m_raytracing->IsShaderPermutationFailed())
+            {
+                ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Permutation failed to compile, see the Shader Compiler window");
+            }
+            else if (m_raytracing->GetActiveShaderPermutation() != key || m_raytracing->IsShaderReloadPending())
+            {
+                ImGui::TextDisabled("Compiling %u permutation(s)...", m_raytracing->GetPendingShaderPermutationCount());
+            }
+        }
+
+        for (uint32_t mode = 0; mode < static_cast<uint32_t>(RenderMode::Count); ++mode)
+        {
+            const RenderModeTiming& timing = m_raytracing->GetRenderModeTiming(static_cast<RenderMode>(mode));
+            if (timing.frameCount > 0)
+            {
+                ImGui::Text("%-16s GPU %.3f ms (avg %.3f ms)", GetRenderModeName(static_cast<RenderMode>(mode)), timing.lastMilliseconds, timing.averageMilliseconds);
+            }
+            else
+            {
+                ImGui::TextDisabled("%-16s GPU n/a", GetRenderModeName(static_cast<RenderMode>(mode)));
+            }
+        }
+        for (uint32_t mode = 0; mode < static_cast<uint32_t>(RenderMode::Count); ++mode)
+        {
+            const uint64_t stackSize = m_raytracing->GetPipelineStackSize(static_cast<RenderMode>(mode));
+            if (stackSize > 0)
+            {
+                ImGui::Text("%-16s Pipeline stack %llu bytes", GetRenderModeName(static_cast<RenderMode>(mode)), static_cast<unsigned long long>(stackSize));
+            }
+        }
+    }
     
     ImGui::End();
+
+    // Compiler output of the requested permutation and the last reload of the wavefront and inline pipelines, the
+    // renderer keeps the last pipelines that compiled. Saved files no pipeline includes are listed as not applied.
+    if (m_isDxrSupported && m_raytracing)
+    {
+        const std::string shaderErrors = m_raytracing->GetShaderErrors() + m_raytracing->GetPipelineErrors();
+        const std::vector<std::string>& unappliedChanges = m_raytracing->GetUnappliedShaderChanges();
+        if (!shaderErrors.empty() || !unappliedChanges.empty())
+        {
+            ImGui::Begin("Shader Compiler");
+            if (m_raytracing->IsShaderPermutationFailed() || m_raytracing->IsPipelineReloadFailed())
+            {
+                ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Compilation failed, rendering with the last compiled shaders");
+            }
+            else if (!shaderErrors.empty())
+            {
+                ImGui::TextDisabled("Compiled with warnings");
+            }
+            for (const std::string& path : unappliedChanges)
+            {
+                ImGui::TextColored(ImVec4(1.0f, 0.8f, 0.4f, 1.0f), "Not applied: %s is not included by any pipeline", path.c_str());
+            }
+            ImGui::Separator();
+            ImGui::BeginChild("ShaderCompilerOutput", ImVec2(0.0f, 0.0f), false, ImGuiWindowFlags_HorizontalScrollbar);
+            ImGui::TextUnformatted(shaderErrors.c_str(), shaderErrors.c_str() + shaderErrors.size());
+            ImGui::EndChild();
+            ImGui::End();
+        }
+    }
+
+    // Heaps, acceleration structures and descriptor heaps
+    m_memoryDashboard->Draw();
     
     // End ImGui frame and render
     m_imguiManager->EndFrame();
@@ -233,6 +429,10 @@ void Application::OnRender()
     // Execute the command list
     ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
     m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+    if (m_isDxrSupported && m_raytracing && m_scene)
+    {
+        m_scene->EndFrame(m_commandQueue.Get());
+    }
 
     // Present the frame
     ThrowIfFailed(m_swapChain->Present(1, 0));
@@ -253,6 +453,9 @@ void Application::OnDestroy()
         m_fenceEvent = nullptr;
     }
 
+    // Stop watching before the pipelines are released
+    m_shaderWatcher.reset();
+
     // Reset raytracing
     m_raytracing.reset();
     
@@ -261,6 +464,10 @@ void Application::OnDestroy()
     
     // Reset ImGui manager
     m_imguiManager.reset();
+    m_memoryDashboard.reset();
+
+    // All heaps are released at this point, finalize the allocation trace
+    AllocationTraceRecorder::Instance().Close();
     
     // Reset all ComPtr objects
     m_commandList.Reset();
@@ -290,7 +497,116 @@ void Application::OnDestroy()
 
 void Application::ParseCommandLineArgs()
 {
-    // TODO: Parse command line arguments if needed
+    int argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    if (!argv)
+    {
+        return;
+    }
+
+    for (int i = 1; i < argc; ++i)
+    {
+        // -allocTrace <file>: record every heap allocation and free into a binary trace for the replay tool
+        if (wcscmp(argv[i], L"-allocTrace") == 0 && i + 1 < argc)
+        {
+            AllocationTraceRecorder::Instance().Open(std::filesystem::path(argv[++i]).string().c_str());
+        }
+        // -quantizePositions: store the vertex positions as snorm16x4 instead of float3
+        else if (wcscmp(argv[i], L"-quantizePositions") == 0)
+        {
+            m_scene->SetPositionFormat(PositionFormat::Snorm16);
+        }
+        // -noMeshPreprocess: upload the meshes as they are, to compare the buffer sizes and the BLAS build time
+        else if (wcscmp(argv[i], L"-noMeshPreprocess") == 0)
+        {
+            MeshPreprocessOptions options;
+            options.weldVertices = false;
+            options.optimizeTriangleOrder = false;
+            options.allow16BitIndices = false;
+            m_scene->SetMeshPreprocessOptions(options);
+        }
+        // -scene <file.obj|file.gltf|file.glb>: load a scene file instead of the Cornell box, -obj is the former name
+        else if ((wcscmp(argv[i], L"-scene") == 0 || wcscmp(argv[i], L"-obj") == 0) && i + 1 < argc)
+        {
+            m_scene->SetScenePath(std::filesystem::path(argv[++i]).string());
+        }
+        // -noScenePack: always load the scene file, without reading or writing its scene pack
+        else if (wcscmp(argv[i], L"-noScenePack") == 0)
+        {
+            m_scene->SetScenePackEnabled(false);
+        }
+        // -noBlasDedup: build one BLAS per mesh, for comparing the build time and memory with deduplication
+        else if (wcscmp(argv[i], L"-noBlasDedup") == 0)
+        {
+            m_scene->SetBLASDeduplicationEnabled(false);
+        }
+        // -asPolicy <policy>: BLAS usage rules and refit settings, e.g. "deforming=cloth;rebuilt=debris;refits=30;growth=1.25;compaction=off"
+        else if (wcscmp(argv[i], L"-asPolicy") == 0 && i + 1 < argc)
+        {
+            AccelerationStructurePolicySettings settings;
+            std::string error;
+            if (ParseAccelerationStructurePolicy(std::filesystem::path(argv[++i]).string(), settings, &error))
+            {
+                m_scene->SetAccelerationStructurePolicy(settings);
+            }
+            else
+            {
+                OutputDebugStringA(("Invalid AS policy: " + error + "\n").c_str());
+            }
+        }
+        // -procedural <settings>: generated stress scene instead of the scene file, e.g. "instances=10000;triangles=2000;overlap=1;depth=8"
+        else if (wcscmp(argv[i], L"-procedural") == 0 && i + 1 < argc)
+        {
+            ProceduralSceneSettings settings;
+            std::string error;
+            if (ParseProceduralSceneSettings(std::filesystem::path(argv[++i]).string(), settings, &error))
+            {
+                m_scene->SetProceduralScene(settings);
+            }
+            else
+            {
+                OutputDebugStringA(("Invalid procedural scene settings: " + error + "\n").c_str());
+            }
+        }
+        // -colorFormat <rgba8|rgb10a2>: encoding of the vertex colors in the attribute stream
+        else if (wcscmp(argv[i], L"-colorFormat") == 0 && i + 1 < argc)
+        {
+            const wchar_t* format = argv[++i];
+            if (wcscmp(format, L"rgb10a2") == 0)
+            {
+                m_scene->SetColorFormat(ColorFormat::RGB10A2);
+            }
+            else if (wcscmp(format, L"rgba8") == 0)
+            {
+                m_scene->SetColorFormat(ColorFormat::RGBA8);
+            }
+            else
+            {
+                OutputDebugStringW((std::wstring(L"Unknown color format: ") + format + L"\n").c_str());
+            }
+        }
+        // -wavefront: start in the wavefront render mode instead of the megakernel
+        else if (wcscmp(argv[i], L"-wavefront") == 0)
+        {
+            m_raytracing->SetRenderMode(RenderMode::Wavefront);
+        }
+        // -inlineRayQuery: start in the inline RayQuery render mode, the megakernel is used without DXR 1.1
+        else if (wcscmp(argv[i], L"-inlineRayQuery") == 0)
+        {
+            m_raytracing->SetRenderMode(RenderMode::InlineRayQuery);
+        }
+        // -animateInstances: spin a part of the instances through the scene graph, the TLAS is rebuilt every frame
+        else if (wcscmp(argv[i], L"-animateInstances") == 0)
+        {
+            m_isInstanceAnimationEnabled = true;
+        }
+        else
+        {
+            OutputDebugStringW((std::wstring(L"Unknown command line argument: ") + argv[i] + L"\n").c_str());
+        }
+    }
+
+    LocalFree(argv);
 }
 
 int Application::Run()
@@ -879,6 +1195,37 @@ void Application::CleanupRenderTargets()
     }
 }
 
+void Application::AnimateInstances()
+{
+    SceneGraph& sceneGraph = m_scene->GetSceneGraph();
+    if (sceneGraph.GetNodeCount() == 0)
+    {
+        return;
+    }
+
+    // The rotations are applied to the transforms at the start, so that they do not accumulate errors
+    if (m_instanceAnimationBaseTransforms.size() != sceneGraph.GetNodeCount())
+    {
+        m_instanceAnimationBaseTransforms.resize(sceneGraph.GetNodeCount());
+        for (uint32_t node = 0; node < sceneGraph.GetNodeCount(); ++node)
+        {
+            m_instanceAnimationBaseTransforms[node] = sceneGraph.GetLocalTransform(node);
+        }
+    }
+
+    // Only the subtrees of the moved nodes are updated and only their TLAS instances are written
+    const XMMATRIX rotation = XMMatrixRotationY(static_cast<float>(m_frameCounter % 100000) * INSTANCE_ANIMATION_RADIANS_PER_FRAME);
+    for (uint32_t instance = 0; instance < sceneGraph.GetInstanceCount(); instance += INSTANCE_ANIMATION_STRIDE)
+    {
+        const uint32_t node = sceneGraph.GetInstanceNode(instance);
+        sceneGraph.SetLocalTransform(node, XMMatrixMultiply(rotation, XMLoadFloat3x4(&m_instanceAnimationBaseTransforms[node])));
+    }
+    m_scene->UpdateInstanceTransforms();
+
+    // The accumulated samples saw the previous transforms
+    m_raytracing->ResetAccumulation();
+}
+
 bool Application::CheckRaytracingSupport()
 {
     D3D12_FEATURE_DATA_D3D12_OPTIONS5 options5 = {};
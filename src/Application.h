@@ -7,6 +7,7 @@
 #include <condition_variable>
 #include <mutex>
 #include <memory>
+#include <vector>
 
 // D3D12 headers
 #include <d3d12.h>
@@ -26,6 +27,8 @@ using Microsoft::WRL::ComPtr;
 class ImGuiManager;
 class Scene;
 class Raytracing;
+class MemoryDashboard;
+class FileWatcher;
 
 class Application
 {
@@ -110,6 +113,13 @@ protected:
     
     // DXR support check
     bool m_isDxrSupported;
+
+    // Render a different supported mode every frame, so that the GPU times of all modes stay current
+    bool m_isRenderModeCycling;
+
+    // Spin every INSTANCE_ANIMATION_STRIDE-th instance through the scene graph, from the node transforms at the start
+    bool m_isInstanceAnimationEnabled;
+    std::vector<DirectX::XMFLOAT3X4> m_instanceAnimationBaseTransforms;
     
     // Render targets
     ComPtr<ID3D12DescriptorHeap> m_rtvHeap;
@@ -132,6 +142,12 @@ protected:
     // ImGui Manager
     std::unique_ptr<ImGuiManager> m_imguiManager;
 
+    // Memory dashboard panel
+    std::unique_ptr<MemoryDashboard> m_memoryDashboard;
+
+    // Changes of the shader sources, the megakernel is compiled again when one is saved
+    std::unique_ptr<FileWatcher> m_shaderWatcher;
+
 private:
     // Helper functions
     void CreateDevice();
@@ -144,6 +160,7 @@ private:
     void MoveToNextFrame();
     void ResizeSwapChain();
     void CleanupRenderTargets();
+    void AnimateInstances();
     
     // DXR functions
     bool CheckRaytracingSupport();
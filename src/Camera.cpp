@@ -0,0 +1,118 @@
+#include "Camera.h"
+#include <cmath>
+
+namespace
+{
+    void Normalize(float v[3])
+    {
+        const float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        v[0] /= length;
+        v[1] /= length;
+        v[2] /= length;
+    }
+
+    void Cross(const float a[3], const float b[3], float result[3])
+    {
+        result[0] = a[1] * b[2] - a[2] * b[1];
+        result[1] = a[2] * b[0] - a[0] * b[2];
+        result[2] = a[0] * b[1] - a[1] * b[0];
+    }
+}
+
+CameraConstants GetCameraConstants(const Camera& camera, float aspectRatio)
+{
+    CameraConstants constants = {};
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        constants.position[i] = camera.position[i];
+        constants.forward[i] = camera.target[i] - camera.position[i];
+    }
+    Normalize(constants.forward);
+    Cross(constants.forward, camera.up, constants.right);
+    Normalize(constants.right);
+    Cross(constants.right, constants.forward, constants.up);
+    constants.tanHalfFovY = std::tan(camera.verticalFov * 0.5f);
+    constants.aspectRatio = aspectRatio;
+    return constants;
+}
+
+void GetCameraRayDirection(const CameraConstants& constants, uint32_t x, uint32_t y, uint32_t width, uint32_t height, float direction[3])
+{
+    const float screenX = (static_cast<float>(x) + 0.5f) / static_cast<float>(width) * 2.0f - 1.0f;
+    const float screenY = 1.0f - (static_cast<float>(y) + 0.5f) / static_cast<float>(height) * 2.0f;
+    const float rightScale = screenX * constants.aspectRatio * constants.tanHalfFovY;
+    const float upScale = screenY * constants.tanHalfFovY;
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        direction[i] = constants.forward[i] + constants.right[i] * rightScale + constants.up[i] * upScale;
+    }
+    Normalize(direction);
+}
+
+const char* GetCameraPathName(CameraPath path)
+{
+    switch (path)
+    {
+    case CameraPath::Overview: return "overview";
+    case CameraPath::Orbit: return "orbit";
+    case CameraPath::Flythrough: return "flythrough";
+    default: break;
+    }
+    return "unknown";
+}
+
+Camera GetCameraPathCamera(CameraPath path, float t, const float boundsMin[3], const float boundsMax[3])
+{
+    float center[3];
+    float radius = 0.0f;
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        center[i] = (boundsMin[i] + boundsMax[i]) * 0.5f;
+        radius += (boundsMax[i] - boundsMin[i]) * (boundsMax[i] - boundsMin[i]);
+    }
+    radius = std::sqrt(radius) * 0.5f;
+
+    // Far enough for the bounding sphere to fit the vertical field of view
+    Camera camera = DEFAULT_CAMERA;
+    const float distance = radius / std::sin(camera.verticalFov * 0.5f);
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        camera.target[i] = center[i];
+    }
+
+    switch (path)
+    {
+    case CameraPath::Orbit:
+    {
+        const float angle = t * 2.0f * 3.14159265f;
+        camera.position[0] = center[0] - distance * std::cos(angle);
+        camera.position[1] = center[1] + distance * 0.3f;
+        camera.position[2] = center[2] - distance * std::sin(angle);
+        break;
+    }
+    case CameraPath::Flythrough:
+    {
+        const float z = boundsMin[2] - radius * 0.5f + (boundsMax[2] - boundsMin[2] + radius * 0.5f) * t;
+        camera.position[0] = center[0];
+        camera.position[1] = center[1];
+        camera.position[2] = z;
+        camera.target[2] = z + radius;
+        break;
+    }
+    default:
+    {
+        float direction[3];
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            direction[i] = DEFAULT_CAMERA.position[i] - DEFAULT_CAMERA.target[i];
+        }
+        Normalize(direction);
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            camera.position[i] = center[i] + direction[i] * distance;
+        }
+        break;
+    }
+    }
+    return camera;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+
+// Pinhole camera of the ray generation shader, and the fixed camera paths of the benchmarks.
+//
+// The camera is passed to the shader as root constants after the MeshInfo offset. GetCameraRayDirection() computes
+// the primary ray of a pixel exactly like RayGenShader, so that the CPU backend renders the same image.
+//
+// This module has no Direct3D12 dependency.
+
+struct Camera
+{
+    float position[3];
+    float target[3];
+    float up[3];
+    float verticalFov;      // radians
+};
+
+// The camera the ray generation shader used before it was passed as constants
+const Camera DEFAULT_CAMERA = { { -10.0f, 3.0f, -5.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, 45.0f * 3.14159265f / 180.0f };
+
+// Camera basis, must match the camera members of the GeometryConstants cbuffer in shaders/Common.hlsli
+struct CameraConstants
+{
+    float position[3];
+    float forward[3];
+    float tanHalfFovY;
+    float right[3];
+    float aspectRatio;      // width / height
+    float up[3];
+};
+static_assert(sizeof(CameraConstants) == 14 * 4, "CameraConstants must match GeometryConstants");
+
+CameraConstants GetCameraConstants(const Camera& camera, float aspectRatio);
+
+// Normalized direction of the ray through the center of pixel (x, y), y down
+void GetCameraRayDirection(const CameraConstants& constants, uint32_t x, uint32_t y, uint32_t width, uint32_t height, float direction[3]);
+
+// Fixed camera paths around the bounds of a scene, parameterized by t in [0, 1]
+enum class CameraPath : uint32_t
+{
+    Overview,       // static, the direction of DEFAULT_CAMERA from outside the bounds
+    Orbit,          // one turn around the bounds
+    Flythrough,     // along +z through the middle of the bounds, across the depth layers of a procedural scene
+    Count
+};
+
+const char* GetCameraPathName(CameraPath path);
+Camera GetCameraPathCamera(CameraPath path, float t, const float boundsMin[3], const float boundsMax[3]);
@@ -0,0 +1,189 @@
+#include "CpuBvh.h"
+#include <algorithm>
+
+namespace
+{
+    // Cost of traversing an inner node relative to intersecting a primitive
+    const float TRAVERSAL_COST = 1.0f;
+
+    struct BuildTask
+    {
+        uint32_t node;
+        uint32_t begin;
+        uint32_t end;
+        uint32_t depth;
+    };
+
+    void ResetBounds(CpuBvhBounds& bounds)
+    {
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            bounds.boundsMin[i] = 1.0e30f;
+            bounds.boundsMax[i] = -1.0e30f;
+        }
+    }
+
+    void GrowBounds(CpuBvhBounds& bounds, const CpuBvhBounds& other)
+    {
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            bounds.boundsMin[i] = std::min(bounds.boundsMin[i], other.boundsMin[i]);
+            bounds.boundsMax[i] = std::max(bounds.boundsMax[i], other.boundsMax[i]);
+        }
+    }
+
+    // Half the surface area, empty bounds have none
+    float GetHalfArea(const CpuBvhBounds& bounds)
+    {
+        const float x = bounds.boundsMax[0] - bounds.boundsMin[0];
+        const float y = bounds.boundsMax[1] - bounds.boundsMin[1];
+        const float z = bounds.boundsMax[2] - bounds.boundsMin[2];
+        return x < 0.0f ? 0.0f : x * y + y * z + z * x;
+    }
+}
+
+void CpuBvh::Build(const std::vector<CpuBvhBounds>& primitiveBounds, uint32_t maxLeafSize)
+{
+    const uint32_t numPrimitives = static_cast<uint32_t>(primitiveBounds.size());
+    maxLeafSize = std::max(maxLeafSize, 1u);
+
+    m_nodes.clear();
+    m_depth = 0;
+    m_primitiveIndices.resize(numPrimitives);
+    for (uint32_t i = 0; i < numPrimitives; ++i)
+    {
+        m_primitiveIndices[i] = i;
+    }
+    if (numPrimitives == 0)
+    {
+        return;
+    }
+
+    std::vector<float> centroids(numPrimitives * 3);
+    for (uint32_t i = 0; i < numPrimitives; ++i)
+    {
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            centroids[i * 3 + axis] = (primitiveBounds[i].boundsMin[axis] + primitiveBounds[i].boundsMax[axis]) * 0.5f;
+        }
+    }
+
+    m_nodes.reserve(numPrimitives * 2);
+    m_nodes.push_back({});
+    std::vector<BuildTask> stack = { { 0, 0, numPrimitives, 1 } };
+    while (!stack.empty())
+    {
+        const BuildTask task = stack.back();
+        stack.pop_back();
+        m_depth = std::max(m_depth, task.depth);
+
+        CpuBvhBounds bounds;
+        float centroidMin[3] = { 1.0e30f, 1.0e30f, 1.0e30f };
+        float centroidMax[3] = { -1.0e30f, -1.0e30f, -1.0e30f };
+        ResetBounds(bounds);
+        for (uint32_t i = task.begin; i < task.end; ++i)
+        {
+            const uint32_t primitive = m_primitiveIndices[i];
+            GrowBounds(bounds, primitiveBounds[primitive]);
+            for (uint32_t axis = 0; axis < 3; ++axis)
+            {
+                centroidMin[axis] = std::min(centroidMin[axis], centroids[primitive * 3 + axis]);
+                centroidMax[axis] = std::max(centroidMax[axis], centroids[primitive * 3 + axis]);
+            }
+        }
+
+        CpuBvhNode& node = m_nodes[task.node];
+        std::copy(bounds.boundsMin, bounds.boundsMin + 3, node.boundsMin);
+        std::copy(bounds.boundsMax, bounds.boundsMax + 3, node.boundsMax);
+        node.firstIndex = task.begin;
+        node.primitiveCount = task.end - task.begin;
+        if (node.primitiveCount == 1)
+        {
+            continue;
+        }
+
+        // Best binned split over the three axes: the bins are swept from both sides to get the left and right bounds
+        float bestCost = 1.0e30f;
+        uint32_t bestAxis = 0;
+        uint32_t bestSplit = 0;
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            const float extent = centroidMax[axis] - centroidMin[axis];
+            if (extent <= 0.0f)
+            {
+                continue;
+            }
+
+            CpuBvhBounds binBounds[BINNED_SAH_BIN_COUNT];
+            uint32_t binCounts[BINNED_SAH_BIN_COUNT] = {};
+            for (CpuBvhBounds& binBound : binBounds)
+            {
+                ResetBounds(binBound);
+            }
+            const float binScale = static_cast<float>(BINNED_SAH_BIN_COUNT) / extent;
+            for (uint32_t i = task.begin; i < task.end; ++i)
+            {
+                const uint32_t primitive = m_primitiveIndices[i];
+                const uint32_t bin = std::min(static_cast<uint32_t>((centroids[primitive * 3 + axis] - centroidMin[axis]) * binScale), BINNED_SAH_BIN_COUNT - 1);
+                binCounts[bin]++;
+                GrowBounds(binBounds[bin], primitiveBounds[primitive]);
+            }
+
+            float rightCosts[BINNED_SAH_BIN_COUNT] = {};
+            CpuBvhBounds sweepBounds;
+            ResetBounds(sweepBounds);
+            uint32_t sweepCount = 0;
+            for (uint32_t bin = BINNED_SAH_BIN_COUNT - 1; bin > 0; --bin)
+            {
+                GrowBounds(sweepBounds, binBounds[bin]);
+                sweepCount += binCounts[bin];
+                rightCosts[bin] = GetHalfArea(sweepBounds) * static_cast<float>(sweepCount);
+            }
+            ResetBounds(sweepBounds);
+            sweepCount = 0;
+            for (uint32_t split = 1; split < BINNED_SAH_BIN_COUNT; ++split)
+            {
+                GrowBounds(sweepBounds, binBounds[split - 1]);
+                sweepCount += binCounts[split - 1];
+                const float cost = GetHalfArea(sweepBounds) * static_cast<float>(sweepCount) + rightCosts[split];
+                if (sweepCount > 0 && sweepCount < node.primitiveCount && cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = split;
+                }
+            }
+        }
+
+        // Keep a leaf when it is small enough and splitting does not pay for the extra traversal step
+        const float area = GetHalfArea(bounds);
+        const float splitCost = area > 0.0f ? TRAVERSAL_COST + bestCost / area : TRAVERSAL_COST;
+        if (node.primitiveCount <= maxLeafSize && (bestSplit == 0 || splitCost >= static_cast<float>(node.primitiveCount)))
+        {
+            continue;
+        }
+
+        uint32_t middle;
+        if (bestSplit > 0)
+        {
+            const float binScale = static_cast<float>(BINNED_SAH_BIN_COUNT) / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+            middle = static_cast<uint32_t>(std::partition(m_primitiveIndices.begin() + task.begin, m_primitiveIndices.begin() + task.end, [&](uint32_t primitive)
+            {
+                return std::min(static_cast<uint32_t>((centroids[primitive * 3 + bestAxis] - centroidMin[bestAxis]) * binScale), BINNED_SAH_BIN_COUNT - 1) < bestSplit;
+            }) - m_primitiveIndices.begin());
+        }
+        else
+        {
+            // All centroids coincide, split the run in halves
+            middle = (task.begin + task.end) / 2;
+        }
+
+        const uint32_t firstChild = static_cast<uint32_t>(m_nodes.size());
+        m_nodes[task.node].firstIndex = firstChild;
+        m_nodes[task.node].primitiveCount = 0;
+        m_nodes.push_back({});
+        m_nodes.push_back({});
+        stack.push_back({ firstChild + 1, middle, task.end, task.depth + 1 });
+        stack.push_back({ firstChild, task.begin, middle, task.depth + 1 });
+    }
+}
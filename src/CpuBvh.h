@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Bounding volume hierarchy of the CPU ray tracing backend, built over the bounds of primitives (the triangles of a
+// mesh for a BLAS, the world bounds of the instances for the TLAS).
+//
+// The tree is binary and built top down with the surface area heuristic evaluated on BINNED_SAH_BIN_COUNT bins of the
+// primitive centroids. A node is 32 bytes: the two children of an inner node are adjacent, a leaf references a run
+// of the reordered primitive indices.
+//
+// This module has no Direct3D12 dependency.
+
+struct CpuBvhBounds
+{
+    float boundsMin[3];
+    float boundsMax[3];
+};
+
+struct CpuBvhNode
+{
+    float boundsMin[3];
+    uint32_t firstIndex;        // first child of an inner node, first primitive index of a leaf
+    float boundsMax[3];
+    uint32_t primitiveCount;    // 0 for an inner node
+};
+static_assert(sizeof(CpuBvhNode) == 32, "CpuBvhNode must be 32 bytes");
+
+class CpuBvh
+{
+public:
+    static const uint32_t BINNED_SAH_BIN_COUNT = 16;
+
+    // Build over the primitive bounds. Leaves hold at most maxLeafSize primitives, fewer when splitting is cheaper.
+    void Build(const std::vector<CpuBvhBounds>& primitiveBounds, uint32_t maxLeafSize);
+
+    // Node 0 is the root, empty when there are no primitives
+    const std::vector<CpuBvhNode>& GetNodes() const { return m_nodes; }
+    const std::vector<uint32_t>& GetPrimitiveIndices() const { return m_primitiveIndices; }
+    uint32_t GetDepth() const { return m_depth; }
+
+    // Bytes of the nodes and the primitive indices
+    size_t GetMemorySize() const { return m_nodes.size() * sizeof(CpuBvhNode) + m_primitiveIndices.size() * sizeof(uint32_t); }
+
+private:
+    std::vector<CpuBvhNode> m_nodes;
+    std::vector<uint32_t> m_primitiveIndices;
+    uint32_t m_depth = 0;
+};
@@ -0,0 +1,819 @@
+#include "CpuRaytracer.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+    // Leaf sizes of the BVHs, the TLAS leaves transform the ray for every instance so they are kept small
+    const uint32_t BLAS_MAX_LEAF_SIZE = 4;
+    const uint32_t TLAS_MAX_LEAF_SIZE = 2;
+
+    // Entries of the traversal stacks, at least the depth of the BVHs
+    const uint32_t TRAVERSAL_STACK_SIZE = 128;
+
+    // Light and sky of the simple diffuse shading of Render(), normalize(0.5, 1, 0.5)
+    const float LIGHT_DIRECTION[3] = { 0.40824829f, 0.81649658f, 0.40824829f };
+    const float AMBIENT = 0.1f;
+    const float MISS_COLOR[3] = { 0.2f, 0.4f, 0.6f };
+
+    double MillisecondsSince(std::chrono::steady_clock::time_point startTime)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    }
+
+    void TransformPoint(const float m[3][4], const float p[3], float result[3])
+    {
+        for (uint32_t row = 0; row < 3; ++row)
+        {
+            result[row] = m[row][0] * p[0] + m[row][1] * p[1] + m[row][2] * p[2] + m[row][3];
+        }
+    }
+
+    void TransformVector(const float m[3][4], const float v[3], float result[3])
+    {
+        for (uint32_t row = 0; row < 3; ++row)
+        {
+            result[row] = m[row][0] * v[0] + m[row][1] * v[1] + m[row][2] * v[2];
+        }
+    }
+
+    // Inverse of an affine 3x4 matrix
+    void InvertTransform(const float m[3][4], float result[3][4])
+    {
+        const float c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+        const float c01 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+        const float c02 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+        const float determinant = m[0][0] * c00 + m[0][1] * c01 + m[0][2] * c02;
+        const float inverseDeterminant = determinant != 0.0f ? 1.0f / determinant : 0.0f;
+
+        result[0][0] = c00 * inverseDeterminant;
+        result[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * inverseDeterminant;
+        result[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * inverseDeterminant;
+        result[1][0] = c01 * inverseDeterminant;
+        result[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * inverseDeterminant;
+        result[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * inverseDeterminant;
+        result[2][0] = c02 * inverseDeterminant;
+        result[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * inverseDeterminant;
+        result[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * inverseDeterminant;
+        for (uint32_t row = 0; row < 3; ++row)
+        {
+            result[row][3] = -(result[row][0] * m[0][3] + result[row][1] * m[1][3] + result[row][2] * m[2][3]);
+        }
+    }
+
+    // Entry distance of the ray into the node bounds, or a value above tMax when it misses
+    float IntersectBounds(const CpuBvhNode& node, const float origin[3], const float inverseDirection[3], float tMax)
+    {
+        float tEnter = CpuRaytracer::RAY_T_MIN;
+        float tExit = tMax;
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            const float t0 = (node.boundsMin[axis] - origin[axis]) * inverseDirection[axis];
+            const float t1 = (node.boundsMax[axis] - origin[axis]) * inverseDirection[axis];
+            tEnter = std::max(tEnter, std::min(t0, t1));
+            tExit = std::min(tExit, std::max(t0, t1));
+        }
+        return tEnter <= tExit ? tEnter : 1.0e30f;
+    }
+
+    void GetInverseDirection(const float direction[3], float inverseDirection[3])
+    {
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            inverseDirection[axis] = direction[axis] != 0.0f ? 1.0f / direction[axis] : 1.0e30f;
+        }
+    }
+
+    // Cosine of the world space normal, not normalized, and the light direction, clamped to 0
+    float GetNDotL(const float normal[3])
+    {
+        const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        return length > 0.0f ? std::max(0.0f, (normal[0] * LIGHT_DIRECTION[0] + normal[1] * LIGHT_DIRECTION[1] + normal[2] * LIGHT_DIRECTION[2]) / length) : 0.0f;
+    }
+
+    uint32_t PackColor(const float color[3])
+    {
+        uint32_t packed = 0xff000000u;
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            packed |= static_cast<uint32_t>(std::clamp(color[i], 0.0f, 1.0f) * 255.0f + 0.5f) << (i * 8);
+        }
+        return packed;
+    }
+}
+
+void CpuRaytracer::Build(const std::vector<CpuRaytracerMesh>& meshes, const std::vector<CpuRaytracerInstance>& instances, ThreadPool& threadPool, CpuRaytracerBuildStats* stats)
+{
+    m_meshes = meshes;
+
+    const auto blasStartTime = std::chrono::steady_clock::now();
+    m_blases.clear();
+    m_blases.resize(meshes.size());
+    threadPool.ParallelFor(static_cast<uint32_t>(meshes.size()), [&](uint32_t meshIndex)
+    {
+        const CpuRaytracerMesh& mesh = meshes[meshIndex];
+        const uint32_t numTriangles = mesh.indexCount / 3;
+        std::vector<CpuBvhBounds> triangleBounds(numTriangles);
+        for (uint32_t i = 0; i < numTriangles; ++i)
+        {
+            const float* p0 = mesh.vertices[mesh.indices[i * 3]].position;
+            const float* p1 = mesh.vertices[mesh.indices[i * 3 + 1]].position;
+            const float* p2 = mesh.vertices[mesh.indices[i * 3 + 2]].position;
+            for (uint32_t axis = 0; axis < 3; ++axis)
+            {
+                triangleBounds[i].boundsMin[axis] = std::min({ p0[axis], p1[axis], p2[axis] });
+                triangleBounds[i].boundsMax[axis] = std::max({ p0[axis], p1[axis], p2[axis] });
+            }
+        }
+
+        BLAS& blas = m_blases[meshIndex];
+        blas.bvh.Build(triangleBounds, BLAS_MAX_LEAF_SIZE);
+        assert(blas.bvh.GetDepth() <= TRAVERSAL_STACK_SIZE);
+
+        // Triangles in leaf order, so that a leaf reads one contiguous run
+        const std::vector<uint32_t>& primitiveIndices = blas.bvh.GetPrimitiveIndices();
+        blas.triangles.resize(numTriangles);
+        for (uint32_t i = 0; i < numTriangles; ++i)
+        {
+            const uint32_t primitive = primitiveIndices[i];
+            const float* p0 = mesh.vertices[mesh.indices[primitive * 3]].position;
+            const float* p1 = mesh.vertices[mesh.indices[primitive * 3 + 1]].position;
+            const float* p2 = mesh.vertices[mesh.indices[primitive * 3 + 2]].position;
+            Triangle& triangle = blas.triangles[i];
+            for (uint32_t axis = 0; axis < 3; ++axis)
+            {
+                triangle.vertex[axis] = p0[axis];
+                triangle.edge1[axis] = p1[axis] - p0[axis];
+                triangle.edge2[axis] = p2[axis] - p0[axis];
+            }
+        }
+    });
+    const double blasMilliseconds = MillisecondsSince(blasStartTime);
+
+    // World bounds of the instances from the bounds of their BLAS root
+    const auto tlasStartTime = std::chrono::steady_clock::now();
+    m_instances.resize(instances.size());
+    std::vector<CpuBvhBounds> instanceBounds(instances.size());
+    for (size_t i = 0; i < instances.size(); ++i)
+    {
+        Instance& instance = m_instances[i];
+        instance.meshIndex = instances[i].meshIndex;
+        std::copy(&instances[i].transform[0][0], &instances[i].transform[0][0] + 12, &instance.objectToWorld[0][0]);
+        InvertTransform(instance.objectToWorld, instance.worldToObject);
+
+        const std::vector<CpuBvhNode>& blasNodes = m_blases[instance.meshIndex].bvh.GetNodes();
+        for (uint32_t row = 0; row < 3; ++row)
+        {
+            float boundsMin = instance.objectToWorld[row][3];
+            float boundsMax = instance.objectToWorld[row][3];
+            for (uint32_t column = 0; !blasNodes.empty() && column < 3; ++column)
+            {
+                const float a = instance.objectToWorld[row][column] * blasNodes[0].boundsMin[column];
+                const float b = instance.objectToWorld[row][column] * blasNodes[0].boundsMax[column];
+                boundsMin += std::min(a, b);
+                boundsMax += std::max(a, b);
+            }
+            instanceBounds[i].boundsMin[row] = boundsMin;
+            instanceBounds[i].boundsMax[row] = boundsMax;
+        }
+    }
+    m_tlas.Build(instanceBounds, TLAS_MAX_LEAF_SIZE);
+    assert(m_tlas.GetDepth() <= TRAVERSAL_STACK_SIZE);
+    const double tlasMilliseconds = MillisecondsSince(tlasStartTime);
+
+    if (stats)
+    {
+        *stats = {};
+        stats->blasMilliseconds = blasMilliseconds;
+        stats->tlasMilliseconds = tlasMilliseconds;
+        for (const BLAS& blas : m_blases)
+        {
+            stats->blasMemorySize += blas.bvh.GetMemorySize() + blas.triangles.size() * sizeof(Triangle);
+            stats->maxBLASDepth = std::max(stats->maxBLASDepth, blas.bvh.GetDepth());
+        }
+        stats->tlasMemorySize = m_tlas.GetMemorySize() + m_instances.size() * sizeof(Instance);
+        stats->tlasDepth = m_tlas.GetDepth();
+    }
+}
+
+void CpuRaytracer::IntersectBLAS(const BLAS& blas, const float origin[3], const float direction[3], uint32_t instanceIndex, bool isAnyHit, Hit& hit) const
+{
+    const std::vector<CpuBvhNode>& nodes = blas.bvh.GetNodes();
+    if (nodes.empty())
+    {
+        return;
+    }
+
+    float inverseDirection[3];
+    GetInverseDirection(direction, inverseDirection);
+
+    uint32_t stack[TRAVERSAL_STACK_SIZE];
+    uint32_t stackSize = 0;
+    if (IntersectBounds(nodes[0], origin, inverseDirection, hit.t) <= hit.t)
+    {
+        stack[stackSize++] = 0;
+    }
+    while (stackSize > 0)
+    {
+        const CpuBvhNode& node = nodes[stack[--stackSize]];
+        if (node.primitiveCount > 0)
+        {
+            // Moeller-Trumbore, both faces like RAY_FLAG_FORCE_OPAQUE without culling
+            for (uint32_t i = node.firstIndex; i < node.firstIndex + node.primitiveCount; ++i)
+            {
+                const Triangle& triangle = blas.triangles[i];
+                const float p[3] = {
+                    direction[1] * triangle.edge2[2] - direction[2] * triangle.edge2[1],
+                    direction[2] * triangle.edge2[0] - direction[0] * triangle.edge2[2],
+                    direction[0] * triangle.edge2[1] - direction[1] * triangle.edge2[0] };
+                const float determinant = triangle.edge1[0] * p[0] + triangle.edge1[1] * p[1] + triangle.edge1[2] * p[2];
+                if (determinant == 0.0f)
+                {
+                    continue;
+                }
+                const float inverseDeterminant = 1.0f / determinant;
+                const float s[3] = { origin[0] - triangle.vertex[0], origin[1] - triangle.vertex[1], origin[2] - triangle.vertex[2] };
+                const float u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inverseDeterminant;
+                if (u < 0.0f || u > 1.0f)
+                {
+                    continue;
+                }
+                const float q[3] = {
+                    s[1] * triangle.edge1[2] - s[2] * triangle.edge1[1],
+                    s[2] * triangle.edge1[0] - s[0] * triangle.edge1[2],
+                    s[0] * triangle.edge1[1] - s[1] * triangle.edge1[0] };
+                const float v = (direction[0] * q[0] + direction[1] * q[1] + direction[2] * q[2]) * inverseDeterminant;
+                if (v < 0.0f || u + v > 1.0f)
+                {
+                    continue;
+                }
+                const float t = (triangle.edge2[0] * q[0] + triangle.edge2[1] * q[1] + triangle.edge2[2] * q[2]) * inverseDeterminant;
+                if (t >= RAY_T_MIN && t < hit.t)
+                {
+                    hit.t = t;
+                    hit.barycentrics[0] = u;
+                    hit.barycentrics[1] = v;
+                    hit.instanceIndex = instanceIndex;
+                    hit.triangleIndex = i;
+                    if (isAnyHit)
+                    {
+                        return;
+                    }
+                }
+            }
+            continue;
+        }
+
+        // Nearer child last, so that it is traversed first and shortens the ray for the other one
+        const float t0 = IntersectBounds(nodes[node.firstIndex], origin, inverseDirection, hit.t);
+        const float t1 = IntersectBounds(nodes[node.firstIndex + 1], origin, inverseDirection, hit.t);
+        const uint32_t nearChild = t0 <= t1 ? node.firstIndex : node.firstIndex + 1;
+        if (std::max(t0, t1) <= hit.t)
+        {
+            stack[stackSize++] = nearChild == node.firstIndex ? node.firstIndex + 1 : node.firstIndex;
+        }
+        if (std::min(t0, t1) <= hit.t)
+        {
+            stack[stackSize++] = nearChild;
+        }
+    }
+}
+
+bool CpuRaytracer::TraceClosestHit(const float origin[3], const float direction[3], Hit& hit) const
+{
+    hit.t = RAY_T_MAX;
+    return Trace(origin, direction, false, hit);
+}
+
+bool CpuRaytracer::TraceAnyHit(const float origin[3], const float direction[3], float tMax) const
+{
+    Hit hit;
+    hit.t = tMax;
+    return Trace(origin, direction, true, hit);
+}
+
+bool CpuRaytracer::Trace(const float origin[3], const float direction[3], bool isAnyHit, Hit& hit) const
+{
+    hit.instanceIndex = UINT32_MAX;
+
+    const std::vector<CpuBvhNode>& nodes = m_tlas.GetNodes();
+    if (nodes.empty())
+    {
+        return false;
+    }
+
+    float inverseDirection[3];
+    GetInverseDirection(direction, inverseDirection);
+
+    uint32_t stack[TRAVERSAL_STACK_SIZE];
+    uint32_t stackSize = 0;
+    if (IntersectBounds(nodes[0], origin, inverseDirection, hit.t) <= hit.t)
+    {
+        stack[stackSize++] = 0;
+    }
+    while (stackSize > 0)
+    {
+        const CpuBvhNode& node = nodes[stack[--stackSize]];
+        if (IntersectBounds(node, origin, inverseDirection, hit.t) > hit.t)
+        {
+            // Culled by a hit found after the node was pushed
+            continue;
+        }
+
+        if (node.primitiveCount > 0)
+        {
+            // The object space direction is not normalized, so t is the same distance as in world space
+            const std::vector<uint32_t>& instanceIndices = m_tlas.GetPrimitiveIndices();
+            for (uint32_t i = node.firstIndex; i < node.firstIndex + node.primitiveCount; ++i)
+            {
+                const Instance& instance = m_instances[instanceIndices[i]];
+                float objectOrigin[3];
+                float objectDirection[3];
+                TransformPoint(instance.worldToObject, origin, objectOrigin);
+                TransformVector(instance.worldToObject, direction, objectDirection);
+                IntersectBLAS(m_blases[instance.meshIndex], objectOrigin, objectDirection, instanceIndices[i], isAnyHit, hit);
+                if (isAnyHit && hit.instanceIndex != UINT32_MAX)
+                {
+                    return true;
+                }
+            }
+            continue;
+        }
+
+        const float t0 = IntersectBounds(nodes[node.firstIndex], origin, inverseDirection, hit.t);
+        const float t1 = IntersectBounds(nodes[node.firstIndex + 1], origin, inverseDirection, hit.t);
+        const uint32_t nearChild = t0 <= t1 ? node.firstIndex : node.firstIndex + 1;
+        if (std::max(t0, t1) <= hit.t)
+        {
+            stack[stackSize++] = nearChild == node.firstIndex ? node.firstIndex + 1 : node.firstIndex;
+        }
+        if (std::min(t0, t1) <= hit.t)
+        {
+            stack[stackSize++] = nearChild;
+        }
+    }
+    return hit.instanceIndex != UINT32_MAX;
+}
+
+void CpuRaytracer::GetHitAttributes(uint32_t meshIndex, uint32_t primitive, const float barycentrics[2], float objectNormal[3], float color[3]) const
+{
+    const CpuRaytracerMesh& mesh = m_meshes[meshIndex];
+    const float weights[3] = { 1.0f - barycentrics[0] - barycentrics[1], barycentrics[0], barycentrics[1] };
+    for (uint32_t j = 0; j < 3; ++j)
+    {
+        objectNormal[j] = 0.0f;
+        color[j] = 0.0f;
+    }
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        const GeometrySourceVertex& vertex = mesh.vertices[mesh.indices[primitive * 3 + i]];
+        for (uint32_t j = 0; j < 3; ++j)
+        {
+            objectNormal[j] += vertex.normal[j] * weights[i];
+            color[j] += vertex.color[j] * weights[i];
+        }
+    }
+}
+
+uint32_t CpuRaytracer::Shade(const Hit* hit) const
+{
+    if (!hit)
+    {
+        return PackColor(MISS_COLOR);
+    }
+
+    // ClosestHitShader: interpolated normal and color, diffuse and ambient term
+    const Instance& instance = m_instances[hit->instanceIndex];
+    const uint32_t primitive = m_blases[instance.meshIndex].bvh.GetPrimitiveIndices()[hit->triangleIndex];
+    float objectNormal[3];
+    float color[3];
+    GetHitAttributes(instance.meshIndex, primitive, hit->barycentrics, objectNormal, color);
+
+    float normal[3];
+    TransformVector(instance.objectToWorld, objectNormal, normal);
+    const float nDotL = GetNDotL(normal);
+    for (uint32_t j = 0; j < 3; ++j)
+    {
+        color[j] = color[j] * nDotL + color[j] * AMBIENT;
+    }
+    return PackColor(color);
+}
+
+void CpuRaytracer::Render(const CameraConstants& camera, uint32_t width, uint32_t height, ThreadPool& threadPool, std::vector<uint32_t>& pixels, CpuRaytracerRenderStats* stats) const
+{
+    pixels.resize(static_cast<size_t>(width) * height);
+
+    const uint32_t tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    const uint32_t tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+    std::vector<uint32_t> tileHitCounts(tilesX * tilesY, 0);
+    threadPool.ParallelFor(tilesX * tilesY, [&](uint32_t tile)
+    {
+        const uint32_t beginX = (tile % tilesX) * TILE_SIZE;
+        const uint32_t beginY = (tile / tilesX) * TILE_SIZE;
+        const uint32_t endX = std::min(beginX + TILE_SIZE, width);
+        const uint32_t endY = std::min(beginY + TILE_SIZE, height);
+        uint32_t hitCount = 0;
+        for (uint32_t y = beginY; y < endY; ++y)
+        {
+            for (uint32_t x = beginX; x < endX; ++x)
+            {
+                float direction[3];
+                GetCameraRayDirection(camera, x, y, width, height, direction);
+                Hit hit;
+                const bool isHit = TraceClosestHit(camera.position, direction, hit);
+                hitCount += isHit ? 1 : 0;
+                pixels[static_cast<size_t>(y) * width + x] = Shade(isHit ? &hit : nullptr);
+            }
+        }
+        tileHitCounts[tile] = hitCount;
+    });
+
+    if (stats)
+    {
+        stats->rayCount = static_cast<uint64_t>(width) * height;
+        stats->hitCount = 0;
+        for (uint32_t hitCount : tileHitCounts)
+        {
+            stats->hitCount += hitCount;
+        }
+    }
+}
+
+void CpuRaytracer::RenderWavefront(const CameraConstants& camera, uint32_t width, uint32_t height, uint32_t sampleIndex, const PathTracingSettings& settings, ThreadPool& threadPool, std::vector<float>& accumulation, CpuRaytracerWavefrontStats* stats) const
+{
+    const uint32_t numPixels = width * height;
+    accumulation.resize(static_cast<size_t>(numPixels) * 3, 0.0f);
+
+    // Queues sized for one entry per pixel, like the UAV buffers of the GPU path. The shade stage appends the
+    // continuation rays to the second ray queue, which is the ray queue of the next bounce.
+    std::vector<WavefrontRay> rays(numPixels);
+    std::vector<WavefrontRay> nextRays(numPixels);
+    std::vector<WavefrontHit> hits(numPixels);
+    std::vector<uint32_t> sortedHitIndices(numPixels);
+    std::vector<WavefrontShadowRay> shadowRays(numPixels);
+    std::vector<float> radiance(static_cast<size_t>(numPixels) * 3);
+    std::atomic<uint32_t> rayCounter = 0;
+    std::atomic<uint32_t> nextRayCounter = 0;
+    std::atomic<uint32_t> hitCounter = 0;
+    std::atomic<uint32_t> shadowRayCounter = 0;
+    std::atomic<uint32_t> visibleShadowRayCounter = 0;
+    std::vector<std::atomic<uint32_t>> binCounts(WAVEFRONT_MATERIAL_BIN_COUNT);
+    std::vector<std::atomic<uint32_t>> binCursors(WAVEFRONT_MATERIAL_BIN_COUNT);
+    const auto GetTaskCount = [](uint32_t count) { return (count + WAVEFRONT_TASK_SIZE - 1) / WAVEFRONT_TASK_SIZE; };
+
+    CpuRaytracerWavefrontStats frameStats = {};
+    frameStats.isHitOrderValid = true;
+
+    // Generate: one camera ray per pixel, the entries of a task are reserved with one atomic like a wave
+    const auto generateStartTime = std::chrono::steady_clock::now();
+    threadPool.ParallelFor(GetTaskCount(numPixels), [&](uint32_t task)
+    {
+        const uint32_t begin = task * WAVEFRONT_TASK_SIZE;
+        const uint32_t end = std::min(begin + WAVEFRONT_TASK_SIZE, numPixels);
+        const uint32_t first = AppendWavefrontQueue(rayCounter, end - begin);
+        for (uint32_t pixel = begin; pixel < end; ++pixel)
+        {
+            WavefrontRay& ray = rays[first + pixel - begin];
+            std::copy(camera.position, camera.position + 3, ray.origin);
+            GetCameraRayDirection(camera, pixel % width, pixel / width, width, height, ray.direction);
+            ray.pixelIndex = pixel;
+            ray.bsdfPdf = 0.0f;
+            std::fill(ray.throughput, ray.throughput + 3, 1.0f);
+            ray.random = InitPathSampler(settings.samplerType, pixel % width, pixel / width, width, sampleIndex).random;
+            std::fill(&radiance[pixel * 3], &radiance[pixel * 3] + 3, 0.0f);
+        }
+    });
+    frameStats.generateMilliseconds = MillisecondsSince(generateStartTime);
+
+    // The bounces run until the ray queue is empty, the GPU dispatches all of them as it does not read the counters back
+    for (uint32_t bounce = 0; bounce <= settings.maxBounces && rayCounter > 0; ++bounce)
+    {
+        // Extend: closest hits are appended to the hit queue and counted per material bin, misses add the environment.
+        // The hit after maxBounces bounces ends the path without a light sample, like TracePath().
+        const auto extendStartTime = std::chrono::steady_clock::now();
+        const uint32_t rayCount = rayCounter;
+        hitCounter = 0;
+        for (uint32_t bin = 0; bin < WAVEFRONT_MATERIAL_BIN_COUNT; ++bin)
+        {
+            binCounts[bin] = 0;
+        }
+        threadPool.ParallelFor(GetTaskCount(rayCount), [&](uint32_t task)
+        {
+            const uint32_t begin = task * WAVEFRONT_TASK_SIZE;
+            const uint32_t end = std::min(begin + WAVEFRONT_TASK_SIZE, rayCount);
+            WavefrontHit taskHits[WAVEFRONT_TASK_SIZE];
+            uint32_t taskHitCount = 0;
+            for (uint32_t rayIndex = begin; rayIndex < end; ++rayIndex)
+            {
+                const WavefrontRay& ray = rays[rayIndex];
+                Hit hit;
+                if (!TraceClosestHit(ray.origin, ray.direction, hit))
+                {
+                    float contribution[3];
+                    GetEnvironmentContribution(ray.direction, ray.throughput, bounce, ray.bsdfPdf, settings, contribution);
+                    for (uint32_t j = 0; j < 3; ++j)
+                    {
+                        radiance[ray.pixelIndex * 3 + j] = contribution[j] + radiance[ray.pixelIndex * 3 + j];
+                    }
+                    continue;
+                }
+                if (bounce == settings.maxBounces)
+                {
+                    continue;
+                }
+
+                const Instance& instance = m_instances[hit.instanceIndex];
+                WavefrontHit& wavefrontHit = taskHits[taskHitCount++];
+                wavefrontHit.rayIndex = rayIndex;
+                wavefrontHit.meshIndex = instance.meshIndex;
+                wavefrontHit.primitiveIndex = m_blases[instance.meshIndex].bvh.GetPrimitiveIndices()[hit.triangleIndex];
+                wavefrontHit.hitT = hit.t;
+                wavefrontHit.barycentrics[0] = hit.barycentrics[0];
+                wavefrontHit.barycentrics[1] = hit.barycentrics[1];
+                for (uint32_t row = 0; row < 3; ++row)
+                {
+                    std::copy(instance.objectToWorld[row], instance.objectToWorld[row] + 3, wavefrontHit.objectToWorld[row]);
+                }
+                wavefrontHit.padding = 0;
+                binCounts[GetWavefrontMaterialBin(instance.meshIndex)].fetch_add(1, std::memory_order_relaxed);
+            }
+            const uint32_t first = AppendWavefrontQueue(hitCounter, taskHitCount);
+            std::copy(taskHits, taskHits + taskHitCount, hits.begin() + first);
+        });
+        frameStats.extendMilliseconds += MillisecondsSince(extendStartTime);
+        frameStats.rayCount += rayCount;
+        frameStats.bounceCount++;
+        if (bounce == settings.maxBounces)
+        {
+            break;
+        }
+
+        // Sort: counting sort of the hit indices by material bin
+        const auto sortStartTime = std::chrono::steady_clock::now();
+        const uint32_t hitCount = hitCounter;
+        uint32_t counts[WAVEFRONT_MATERIAL_BIN_COUNT];
+        uint32_t offsets[WAVEFRONT_MATERIAL_BIN_COUNT];
+        for (uint32_t bin = 0; bin < WAVEFRONT_MATERIAL_BIN_COUNT; ++bin)
+        {
+            counts[bin] = binCounts[bin];
+        }
+        ComputeWavefrontBinOffsets(counts, offsets);
+        for (uint32_t bin = 0; bin < WAVEFRONT_MATERIAL_BIN_COUNT; ++bin)
+        {
+            binCursors[bin] = offsets[bin];
+        }
+        threadPool.ParallelFor(GetTaskCount(hitCount), [&](uint32_t task)
+        {
+            const uint32_t begin = task * WAVEFRONT_TASK_SIZE;
+            const uint32_t end = std::min(begin + WAVEFRONT_TASK_SIZE, hitCount);
+            for (uint32_t hitIndex = begin; hitIndex < end; ++hitIndex)
+            {
+                const uint32_t bin = GetWavefrontMaterialBin(hits[hitIndex].meshIndex);
+                sortedHitIndices[binCursors[bin].fetch_add(1, std::memory_order_relaxed)] = hitIndex;
+            }
+        });
+        frameStats.sortMilliseconds += MillisecondsSince(sortStartTime);
+        frameStats.hitCount += hitCount;
+        frameStats.isHitOrderValid = frameStats.isHitOrderValid && IsWavefrontHitOrderValid(hits, hitCount, sortedHitIndices);
+
+        // Shade: the light sample becomes a shadow ray carrying its contribution, the BSDF sample a continuation ray
+        // carrying the throughput and the sampler state, unless Russian roulette ends the path
+        const auto shadeStartTime = std::chrono::steady_clock::now();
+        shadowRayCounter = 0;
+        nextRayCounter = 0;
+        threadPool.ParallelFor(GetTaskCount(hitCount), [&](uint32_t task)
+        {
+            const uint32_t begin = task * WAVEFRONT_TASK_SIZE;
+            const uint32_t end = std::min(begin + WAVEFRONT_TASK_SIZE, hitCount);
+            WavefrontShadowRay taskShadowRays[WAVEFRONT_TASK_SIZE];
+            WavefrontRay taskRays[WAVEFRONT_TASK_SIZE];
+            uint32_t taskShadowRayCount = 0;
+            uint32_t taskRayCount = 0;
+            for (uint32_t i = begin; i < end; ++i)
+            {
+                const WavefrontHit& hit = hits[sortedHitIndices[i]];
+                const WavefrontRay& ray = rays[hit.rayIndex];
+                PathSampler sampler = InitPathSampler(settings.samplerType, ray.pixelIndex % width, ray.pixelIndex / width, width, sampleIndex);
+                sampler.random = ray.random;
+                float u[RANDOM_NUMBERS_PER_BOUNCE];
+                GetBounceSamples(sampler, settings.samplerTables, bounce, u);
+
+                float objectNormal[3];
+                float albedo[3];
+                GetHitAttributes(hit.meshIndex, hit.primitiveIndex, hit.barycentrics, objectNormal, albedo);
+                if (settings.albedoOverride >= 0.0f)
+                {
+                    albedo[0] = albedo[1] = albedo[2] = settings.albedoOverride;
+                }
+                float worldNormal[3];
+                float normal[3];
+                for (uint32_t row = 0; row < 3; ++row)
+                {
+                    worldNormal[row] = hit.objectToWorld[row][0] * objectNormal[0] + hit.objectToWorld[row][1] * objectNormal[1] + hit.objectToWorld[row][2] * objectNormal[2];
+                }
+                GetShadingNormal(worldNormal, ray.direction, normal);
+                float origin[3];
+                for (uint32_t j = 0; j < 3; ++j)
+                {
+                    origin[j] = ray.origin[j] + ray.direction[j] * hit.hitT;
+                }
+
+                WavefrontShadowRay& shadowRay = taskShadowRays[taskShadowRayCount];
+                if (SampleLight(normal, albedo, ray.throughput, u, settings, shadowRay.direction, shadowRay.contribution))
+                {
+                    std::copy(origin, origin + 3, shadowRay.origin);
+                    shadowRay.pixelIndex = ray.pixelIndex;
+                    shadowRay.tMax = RAY_T_MAX;
+                    shadowRay.padding = 0;
+                    taskShadowRayCount++;
+                }
+
+                WavefrontRay& nextRay = taskRays[taskRayCount];
+                nextRay = ray;
+                if (ContinuePath(normal, albedo, u, bounce, settings, nextRay.direction, nextRay.bsdfPdf, nextRay.throughput))
+                {
+                    std::copy(origin, origin + 3, nextRay.origin);
+                    nextRay.random = sampler.random;
+                    taskRayCount++;
+                }
+            }
+            const uint32_t firstShadowRay = AppendWavefrontQueue(shadowRayCounter, taskShadowRayCount);
+            std::copy(taskShadowRays, taskShadowRays + taskShadowRayCount, shadowRays.begin() + firstShadowRay);
+            const uint32_t firstRay = AppendWavefrontQueue(nextRayCounter, taskRayCount);
+            std::copy(taskRays, taskRays + taskRayCount, nextRays.begin() + firstRay);
+        });
+        frameStats.shadeMilliseconds += MillisecondsSince(shadeStartTime);
+
+        // Connect: unoccluded shadow rays add their contribution, every pixel has at most one shadow ray per bounce
+        const auto connectStartTime = std::chrono::steady_clock::now();
+        const uint32_t shadowRayCount = shadowRayCounter;
+        threadPool.ParallelFor(GetTaskCount(shadowRayCount), [&](uint32_t task)
+        {
+            const uint32_t begin = task * WAVEFRONT_TASK_SIZE;
+            const uint32_t end = std::min(begin + WAVEFRONT_TASK_SIZE, shadowRayCount);
+            uint32_t visibleCount = 0;
+            for (uint32_t i = begin; i < end; ++i)
+            {
+                const WavefrontShadowRay& shadowRay = shadowRays[i];
+                if (TraceAnyHit(shadowRay.origin, shadowRay.direction, shadowRay.tMax))
+                {
+                    continue;
+                }
+                for (uint32_t j = 0; j < 3; ++j)
+                {
+                    radiance[shadowRay.pixelIndex * 3 + j] = shadowRay.contribution[j] + radiance[shadowRay.pixelIndex * 3 + j];
+                }
+                visibleCount++;
+            }
+            visibleShadowRayCounter.fetch_add(visibleCount, std::memory_order_relaxed);
+        });
+        frameStats.connectMilliseconds += MillisecondsSince(connectStartTime);
+        frameStats.shadowRayCount += shadowRayCount;
+
+        // The continuation rays are the ray queue of the next bounce
+        rays.swap(nextRays);
+        rayCounter = nextRayCounter.load();
+    }
+
+    // Resolve: add the sample to the accumulation like RenderPathTraced()
+    const auto resolveStartTime = std::chrono::steady_clock::now();
+    threadPool.ParallelFor(GetTaskCount(numPixels), [&](uint32_t task)
+    {
+        const uint32_t begin = task * WAVEFRONT_TASK_SIZE;
+        const uint32_t end = std::min(begin + WAVEFRONT_TASK_SIZE, numPixels);
+        for (size_t i = static_cast<size_t>(begin) * 3; i < static_cast<size_t>(end) * 3; ++i)
+        {
+            accumulation[i] = sampleIndex == 0 ? radiance[i] : accumulation[i] + radiance[i];
+        }
+    });
+    frameStats.connectMilliseconds += MillisecondsSince(resolveStartTime);
+
+    if (stats)
+    {
+        frameStats.visibleShadowRayCount = visibleShadowRayCounter;
+        *stats = frameStats;
+    }
+}
+
+void CpuRaytracer::TracePath(const float cameraOrigin[3], const float cameraDirection[3], PathSampler& sampler, const PathTracingSettings& settings, float radiance[3], uint32_t& rayCount) const
+{
+    float origin[3] = { cameraOrigin[0], cameraOrigin[1], cameraOrigin[2] };
+    float direction[3] = { cameraDirection[0], cameraDirection[1], cameraDirection[2] };
+    float throughput[3] = { 1.0f, 1.0f, 1.0f };
+    float bsdfPdf = 0.0f;      // of the last bounce, 0 for the camera ray
+    radiance[0] = radiance[1] = radiance[2] = 0.0f;
+
+    for (uint32_t bounce = 0; bounce <= settings.maxBounces; ++bounce)
+    {
+        Hit hit;
+        rayCount++;
+        if (!TraceClosestHit(origin, direction, hit))
+        {
+            float contribution[3];
+            GetEnvironmentContribution(direction, throughput, bounce, bsdfPdf, settings, contribution);
+            for (uint32_t j = 0; j < 3; ++j)
+            {
+                radiance[j] += contribution[j];
+            }
+            break;
+        }
+
+        // The environment the BSDF sample of the last hit would see is not traced, so the light sample is skipped as well
+        if (bounce == settings.maxBounces)
+        {
+            break;
+        }
+
+        // Random numbers of the bounce, all drawn in the order of the shader
+        float u[RANDOM_NUMBERS_PER_BOUNCE];
+        GetBounceSamples(sampler, settings.samplerTables, bounce, u);
+
+        // Surface: shading normal facing the ray, albedo from the vertex color
+        const Instance& instance = m_instances[hit.instanceIndex];
+        const uint32_t primitive = m_blases[instance.meshIndex].bvh.GetPrimitiveIndices()[hit.triangleIndex];
+        float objectNormal[3];
+        float albedo[3];
+        GetHitAttributes(instance.meshIndex, primitive, hit.barycentrics, objectNormal, albedo);
+        if (settings.albedoOverride >= 0.0f)
+        {
+            albedo[0] = albedo[1] = albedo[2] = settings.albedoOverride;
+        }
+        float worldNormal[3];
+        float normal[3];
+        TransformVector(instance.objectToWorld, objectNormal, worldNormal);
+        GetShadingNormal(worldNormal, direction, normal);
+        for (uint32_t j = 0; j < 3; ++j)
+        {
+            origin[j] += direction[j] * hit.t;
+        }
+
+        // Light sample with an occlusion-only shadow ray
+        float lightDirection[3];
+        float contribution[3];
+        if (SampleLight(normal, albedo, throughput, u, settings, lightDirection, contribution))
+        {
+            rayCount++;
+            if (!TraceAnyHit(origin, lightDirection, RAY_T_MAX))
+            {
+                for (uint32_t j = 0; j < 3; ++j)
+                {
+                    radiance[j] += contribution[j];
+                }
+            }
+        }
+
+        if (!ContinuePath(normal, albedo, u, bounce, settings, direction, bsdfPdf, throughput))
+        {
+            break;
+        }
+    }
+}
+
+void CpuRaytracer::RenderPathTraced(const CameraConstants& camera, uint32_t width, uint32_t height, uint32_t sampleIndex, const PathTracingSettings& settings, ThreadPool& threadPool, std::vector<float>& accumulation, CpuRaytracerRenderStats* stats) const
+{
+    accumulation.resize(static_cast<size_t>(width) * height * 3, 0.0f);
+
+    const uint32_t tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    const uint32_t tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+    std::vector<uint32_t> tileRayCounts(tilesX * tilesY, 0);
+    threadPool.ParallelFor(tilesX * tilesY, [&](uint32_t tile)
+    {
+        const uint32_t beginX = (tile % tilesX) * TILE_SIZE;
+        const uint32_t beginY = (tile / tilesX) * TILE_SIZE;
+        const uint32_t endX = std::min(beginX + TILE_SIZE, width);
+        const uint32_t endY = std::min(beginY + TILE_SIZE, height);
+        uint32_t rayCount = 0;
+        for (uint32_t y = beginY; y < endY; ++y)
+        {
+            for (uint32_t x = beginX; x < endX; ++x)
+            {
+                float direction[3];
+                GetCameraRayDirection(camera, x, y, width, height, direction);
+                const uint32_t pixelIndex = y * width + x;
+                PathSampler sampler = InitPathSampler(settings.samplerType, x, y, width, sampleIndex);
+                float radiance[3];
+                TracePath(camera.position, direction, sampler, settings, radiance, rayCount);
+                for (uint32_t j = 0; j < 3; ++j)
+                {
+                    float& sum = accumulation[static_cast<size_t>(pixelIndex) * 3 + j];
+                    sum = sampleIndex == 0 ? radiance[j] : sum + radiance[j];
+                }
+            }
+        }
+        tileRayCounts[tile] = rayCount;
+    });
+
+    if (stats)
+    {
+        stats->rayCount = 0;
+        stats->hitCount = 0;
+        for (uint32_t rayCount : tileRayCounts)
+        {
+            stats->rayCount += rayCount;
+        }
+    }
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Camera.h"
+#include "CpuBvh.h"
+#include "GeometryStreams.h"
+#include "PathTracing.h"
+#include "WavefrontQueues.h"
+
+class ThreadPool;
+
+// CPU ray tracing backend: two level acceleration structures like the DXR scene (one BLAS per mesh, a TLAS over the
+// instances) and the primary rays of shaders/Raytracing.hlsl. Render() shades the hits of the primary rays with a
+// simple diffuse light without shadows, so that it measures the ray throughput alone.
+//
+// It renders the same image as the GPU within the quantization of the vertex attributes, so that the acceleration
+// structure builds and the ray throughput of large scenes are measured on machines without a DXR device, e.g. by
+// tools/RaytracingBenchmark on every commit. The BLASes are built in parallel on the thread pool, the TLAS is built
+// on the calling thread like the single TLAS build of the GPU path. Rendering is parallel over tiles of the image.
+//
+// RenderPathTraced() is the estimator of the path tracing megakernel (PathTracing.h) with the same random numbers, so
+// the convergence of the GPU image can be checked sample by sample.
+//
+// RenderWavefront() mirrors the wavefront mode of the GPU path stage by stage, with the queues, the compaction and
+// the material binning of WavefrontQueues.h, so that the queue logic is checked without a DXR device. It runs the
+// estimator of RenderPathTraced() with the path state in the queues and renders the same sample.
+//
+// This module has no Direct3D12 dependency.
+
+// Mesh geometry, referenced by the raytracer until the next Build()
+struct CpuRaytracerMesh
+{
+    const GeometrySourceVertex* vertices;
+    uint32_t vertexCount;
+    const uint32_t* indices;
+    uint32_t indexCount;
+};
+
+// Instance of a mesh, the transform is the row-major 3x4 object to world matrix
+struct CpuRaytracerInstance
+{
+    uint32_t meshIndex;
+    float transform[3][4];
+};
+
+struct CpuRaytracerBuildStats
+{
+    double blasMilliseconds;
+    double tlasMilliseconds;
+    uint64_t blasMemorySize;        // nodes, primitive indices and triangles of all BLASes
+    uint64_t tlasMemorySize;        // nodes, instance indices and instance transforms
+    uint32_t maxBLASDepth;
+    uint32_t tlasDepth;
+};
+
+struct CpuRaytracerRenderStats
+{
+    uint64_t rayCount;
+    uint64_t hitCount;
+};
+
+// Queue sizes and stage times of RenderWavefront(), summed over the bounces
+struct CpuRaytracerWavefrontStats
+{
+    uint32_t rayCount;
+    uint32_t hitCount;                  // shaded hits, without the hits ending the paths at the bounce limit
+    uint32_t shadowRayCount;
+    uint32_t visibleShadowRayCount;
+    uint32_t bounceCount;               // extend stages with rays in the queue
+    double generateMilliseconds;
+    double extendMilliseconds;
+    double sortMilliseconds;            // bin offsets and scatter
+    double shadeMilliseconds;
+    double connectMilliseconds;         // shadow rays and resolve
+    bool isHitOrderValid;               // the sorted hits of every bounce are grouped by material bin
+};
+
+class CpuRaytracer
+{
+public:
+    // Same ray interval as RayGenShader
+    static constexpr float RAY_T_MIN = 0.001f;
+    static constexpr float RAY_T_MAX = 10000.0f;
+
+    // Pixels of a tile rendered by one task are TILE_SIZE x TILE_SIZE
+    static const uint32_t TILE_SIZE = 16;
+
+    // Build the BLASes of the meshes and the TLAS of the instances
+    void Build(const std::vector<CpuRaytracerMesh>& meshes, const std::vector<CpuRaytracerInstance>& instances, ThreadPool& threadPool, CpuRaytracerBuildStats* stats = nullptr);
+
+    // Render one primary ray per pixel into RGBA8 pixels, red in the low bits like DXGI_FORMAT_R8G8B8A8_UNORM
+    void Render(const CameraConstants& camera, uint32_t width, uint32_t height, ThreadPool& threadPool, std::vector<uint32_t>& pixels, CpuRaytracerRenderStats* stats = nullptr) const;
+
+    // Add one path traced sample per pixel to the RGB float accumulation, which is overwritten for sample 0. The image
+    // is the accumulation divided by sampleIndex + 1. The random numbers come from the sampler of the settings. The
+    // stats count the path and shadow rays.
+    void RenderPathTraced(const CameraConstants& camera, uint32_t width, uint32_t height, uint32_t sampleIndex, const PathTracingSettings& settings, ThreadPool& threadPool, std::vector<float>& accumulation, CpuRaytracerRenderStats* stats = nullptr) const;
+
+    // Add the same sample as RenderPathTraced() in the stages of the wavefront mode: generate, then per bounce extend,
+    // sort by material, shade and shadow connect, until the ray queue is empty or the bounce limit is reached.
+    void RenderWavefront(const CameraConstants& camera, uint32_t width, uint32_t height, uint32_t sampleIndex, const PathTracingSettings& settings, ThreadPool& threadPool, std::vector<float>& accumulation, CpuRaytracerWavefrontStats* stats = nullptr) const;
+
+private:
+    // Precomputed vertex and edges for the intersection test
+    struct Triangle
+    {
+        float vertex[3];
+        float edge1[3];
+        float edge2[3];
+    };
+
+    struct BLAS
+    {
+        CpuBvh bvh;
+        std::vector<Triangle> triangles;    // in the order of the BVH primitive indices
+    };
+
+    struct Instance
+    {
+        uint32_t meshIndex;
+        float objectToWorld[3][4];
+        float worldToObject[3][4];
+    };
+
+    struct Hit
+    {
+        float t;
+        float barycentrics[2];
+        uint32_t instanceIndex;
+        uint32_t triangleIndex;             // index into BLAS::triangles
+    };
+
+    // Any hit in [RAY_T_MIN, tMax) ends the search of TraceAnyHit(), like RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH
+    bool TraceClosestHit(const float origin[3], const float direction[3], Hit& hit) const;
+    bool TraceAnyHit(const float origin[3], const float direction[3], float tMax) const;
+    bool Trace(const float origin[3], const float direction[3], bool isAnyHit, Hit& hit) const;
+    void IntersectBLAS(const BLAS& blas, const float origin[3], const float direction[3], uint32_t instanceIndex, bool isAnyHit, Hit& hit) const;
+
+    // Interpolated object space normal and vertex color of a triangle of a mesh
+    void GetHitAttributes(uint32_t meshIndex, uint32_t primitive, const float barycentrics[2], float objectNormal[3], float color[3]) const;
+    uint32_t Shade(const Hit* hit) const;
+
+    // Radiance of one path, counting the traced rays
+    void TracePath(const float origin[3], const float direction[3], PathSampler& sampler, const PathTracingSettings& settings, float radiance[3], uint32_t& rayCount) const;
+
+    std::vector<CpuRaytracerMesh> m_meshes;
+    std::vector<BLAS> m_blases;
+    std::vector<Instance> m_instances;
+    CpuBvh m_tlas;
+};
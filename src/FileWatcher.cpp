@@ -0,0 +1,161 @@
+#include "FileWatcher.h"
+#include "PlatformHelpers.h"
+#include <algorithm>
+#include <chrono>
+#include <format>
+
+namespace
+{
+    uint64_t GetMilliseconds()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+}
+
+ChangeDebouncer::ChangeDebouncer(uint64_t debounceMilliseconds) :
+    m_debounceMilliseconds(debounceMilliseconds),
+    m_lastChangeMilliseconds(0)
+{
+}
+
+void ChangeDebouncer::AddChange(const std::string& path, uint64_t nowMilliseconds)
+{
+    m_paths.push_back(path);
+    m_lastChangeMilliseconds = nowMilliseconds;
+}
+
+std::vector<std::string> ChangeDebouncer::Take(uint64_t nowMilliseconds)
+{
+    if (m_paths.empty() || nowMilliseconds < m_lastChangeMilliseconds + m_debounceMilliseconds)
+    {
+        return {};
+    }
+    std::vector<std::string> paths;
+    paths.swap(m_paths);
+    std::sort(paths.begin(), paths.end());
+    paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+    return paths;
+}
+
+FileWatcher::FileWatcher() :
+    m_pollMilliseconds(100),
+    m_debounceMilliseconds(200),
+    m_stop(false)
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+    Stop();
+}
+
+bool FileWatcher::Start(const std::string& directory, const std::vector<std::string>& extensions, uint32_t pollMilliseconds, uint32_t debounceMilliseconds)
+{
+    Stop();
+
+    std::error_code error;
+    if (!std::filesystem::is_directory(directory, error))
+    {
+        OutputDebugStringA(std::format("FileWatcher: {} is not a directory\n", directory).c_str());
+        return false;
+    }
+
+    m_directory = directory;
+    m_extensions = extensions;
+    m_pollMilliseconds = std::max(pollMilliseconds, 1u);
+    m_debounceMilliseconds = debounceMilliseconds;
+    m_changes.clear();
+    m_stop = false;
+
+    // The first scan is taken here, so a file written right after Start() returns is a change
+    m_initialFiles.clear();
+    Scan(m_initialFiles);
+    m_thread = std::thread(&FileWatcher::WatcherThread, this);
+    return true;
+}
+
+void FileWatcher::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_stopRequested.notify_all();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+std::vector<std::string> FileWatcher::TakeChanges()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<std::string> changes;
+    changes.swap(m_changes);
+    return changes;
+}
+
+void FileWatcher::WatcherThread()
+{
+    FileStates files;
+    files.swap(m_initialFiles);
+    ChangeDebouncer debouncer(m_debounceMilliseconds);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopRequested.wait_for(lock, std::chrono::milliseconds(m_pollMilliseconds), [this]() { return m_stop; }))
+    {
+        lock.unlock();
+
+        // Changed and new files, then the removed ones
+        FileStates scanned;
+        Scan(scanned);
+        const uint64_t now = GetMilliseconds();
+        for (const auto& [path, state] : scanned)
+        {
+            auto it = files.find(path);
+            if (it == files.end() || it->second.writeTime != state.writeTime || it->second.size != state.size)
+            {
+                debouncer.AddChange(path, now);
+            }
+        }
+        for (const auto& [path, state] : files)
+        {
+            if (scanned.find(path) == scanned.end())
+            {
+                debouncer.AddChange(path, now);
+            }
+        }
+        files.swap(scanned);
+        std::vector<std::string> changes = debouncer.Take(now);
+
+        lock.lock();
+        m_changes.insert(m_changes.end(), changes.begin(), changes.end());
+    }
+}
+
+void FileWatcher::Scan(FileStates& files) const
+{
+    // A file removed or replaced during the scan is skipped and seen by the next one
+    std::error_code error;
+    for (std::filesystem::recursive_directory_iterator it(m_directory, error), end; !error && it != end; it.increment(error))
+    {
+        std::error_code fileError;
+        if (!it->is_regular_file(fileError))
+        {
+            continue;
+        }
+        const std::filesystem::path& path = it->path();
+        if (!m_extensions.empty() && std::find(m_extensions.begin(), m_extensions.end(), path.extension().string()) == m_extensions.end())
+        {
+            continue;
+        }
+        FileState state;
+        state.writeTime = std::filesystem::last_write_time(path, fileError);
+        state.size = fileError ? 0 : std::filesystem::file_size(path, fileError);
+        if (!fileError)
+        {
+            files[path.lexically_relative(m_directory).generic_string()] = state;
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Collects changed paths and releases them once no change was added for the debounce time. Editors save a file in
+// several steps (truncate, write, rename) and a save of several files touches them one after the other, so the
+// changes of one edit are reported together instead of triggering a recompile per step. The time is passed in, which
+// makes the debounce deterministic for tools/FileWatcherTool.
+class ChangeDebouncer
+{
+public:
+    explicit ChangeDebouncer(uint64_t debounceMilliseconds = 200);
+
+    void AddChange(const std::string& path, uint64_t nowMilliseconds);
+
+    // The changed paths, sorted and unique, once the last change is debounceMilliseconds old; empty before
+    std::vector<std::string> Take(uint64_t nowMilliseconds);
+
+    bool IsPending() const { return !m_paths.empty(); }
+
+private:
+    uint64_t m_debounceMilliseconds;
+    uint64_t m_lastChangeMilliseconds;
+    std::vector<std::string> m_paths;
+};
+
+// Watches the files of a directory and its subdirectories with a given extension on a watcher thread.
+//
+// The thread compares the write time and the size of every file to the previous scan every poll interval, a new, a
+// changed and a removed file are changes. The changes go through a ChangeDebouncer and TakeChanges() returns the
+// debounced paths relative to the directory without blocking, so the render loop polls it once per frame. Polling
+// keeps the watcher portable; the directories watched here hold a few dozen files.
+//
+// This module has no Direct3D12 dependency, it is checked on Linux by tools/FileWatcherTool.
+class FileWatcher
+{
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Extensions with the dot (".hlsl"), empty for every file. The files present now are not reported.
+    bool Start(const std::string& directory, const std::vector<std::string>& extensions, uint32_t pollMilliseconds = 100, uint32_t debounceMilliseconds = 200);
+    void Stop();
+    bool IsWatching() const { return m_thread.joinable(); }
+
+    // Debounced changes since the last call, in generic format relative to the directory
+    std::vector<std::string> TakeChanges();
+
+private:
+    struct FileState
+    {
+        std::filesystem::file_time_type writeTime;
+        uintmax_t size;
+    };
+    using FileStates = std::unordered_map<std::string, FileState>;
+
+    void WatcherThread();
+    void Scan(FileStates& files) const;
+
+    std::filesystem::path m_directory;
+    std::vector<std::string> m_extensions;
+    uint32_t m_pollMilliseconds;
+    uint32_t m_debounceMilliseconds;
+    FileStates m_initialFiles;          // handed to the watcher thread
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_stopRequested;
+    bool m_stop;
+    std::vector<std::string> m_changes;
+};
@@ -0,0 +1,401 @@
+#include "GeometryStreams.h"
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define GEOMETRY_STREAMS_USE_SSE 1
+#include <emmintrin.h>
+#else
+#define GEOMETRY_STREAMS_USE_SSE 0
+#endif
+
+// The scalar and the SIMD paths perform the same float operations in the same order and round with
+// the current rounding mode (nearest even), so that both produce bit identical streams.
+
+namespace
+{
+    const float SNORM16_MAX = 32767.0f;
+
+    int32_t RoundToInt(float value)
+    {
+        return static_cast<int32_t>(std::nearbyint(value));
+    }
+
+    float Clamp(float value, float minValue, float maxValue)
+    {
+        return std::min(std::max(value, minValue), maxValue);
+    }
+
+    float DecodeSnorm16(int16_t value)
+    {
+        return std::max(static_cast<float>(value) / SNORM16_MAX, -1.0f);
+    }
+
+    float SignNotZero(float value)
+    {
+        return value >= 0.0f ? 1.0f : -1.0f;
+    }
+
+    // Scale and bias mapping the bounds of the positions to [-1, 1]
+    PositionDequantization ComputeDequantization(const GeometrySourceVertex* vertices, uint32_t vertexCount)
+    {
+        PositionDequantization dequantization = {};
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            float minValue = FLT_MAX;
+            float maxValue = -FLT_MAX;
+            for (uint32_t i = 0; i < vertexCount; ++i)
+            {
+                minValue = std::min(minValue, vertices[i].position[axis]);
+                maxValue = std::max(maxValue, vertices[i].position[axis]);
+            }
+
+            const float halfExtent = (maxValue - minValue) * 0.5f;
+            dequantization.scale[axis] = halfExtent > 0.0f ? halfExtent : 1.0f;
+            dequantization.bias[axis] = vertexCount > 0 ? (maxValue + minValue) * 0.5f : 0.0f;
+        }
+        return dequantization;
+    }
+
+    void QuantizePosition(const float position[3], const float bias[3], const float invScale[3], int16_t quantized[4])
+    {
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            const float normalized = Clamp((position[axis] - bias[axis]) * invScale[axis], -1.0f, 1.0f);
+            quantized[axis] = static_cast<int16_t>(RoundToInt(normalized * SNORM16_MAX));
+        }
+        quantized[3] = 0;
+    }
+
+    void BuildStreamsScalar(const GeometrySourceVertex* vertices, uint32_t begin, uint32_t end, const float invScale[3], GeometryStreams& streams)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            const GeometrySourceVertex& vertex = vertices[i];
+
+            if (streams.positionFormat == PositionFormat::Snorm16)
+            {
+                QuantizePosition(vertex.position, streams.dequantization.bias, invScale, &streams.quantizedPositions[i * 4]);
+            }
+
+            streams.attributes[i].normal = EncodeOctahedralNormal(vertex.normal);
+            streams.attributes[i].color = PackColor(vertex.color, streams.colorFormat);
+        }
+    }
+
+#if GEOMETRY_STREAMS_USE_SSE
+    __m128 Abs(__m128 value)
+    {
+        return _mm_andnot_ps(_mm_set1_ps(-0.0f), value);
+    }
+
+    __m128 Select(__m128 mask, __m128 a, __m128 b)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+
+    __m128 Clamp(__m128 value, float minValue, float maxValue)
+    {
+        return _mm_min_ps(_mm_max_ps(value, _mm_set1_ps(minValue)), _mm_set1_ps(maxValue));
+    }
+
+    __m128 SignNotZero(__m128 value)
+    {
+        return Select(_mm_cmpge_ps(value, _mm_setzero_ps()), _mm_set1_ps(1.0f), _mm_set1_ps(-1.0f));
+    }
+
+    // Transpose one float component of 4 AoS vertices into a register
+    __m128 Gather(const GeometrySourceVertex* vertices, size_t memberOffset)
+    {
+        const uint8_t* base = reinterpret_cast<const uint8_t*>(vertices) + memberOffset;
+        return _mm_setr_ps(
+            *reinterpret_cast<const float*>(base),
+            *reinterpret_cast<const float*>(base + sizeof(GeometrySourceVertex)),
+            *reinterpret_cast<const float*>(base + sizeof(GeometrySourceVertex) * 2),
+            *reinterpret_cast<const float*>(base + sizeof(GeometrySourceVertex) * 3));
+    }
+
+    __m128i EncodeOctahedralNormals(__m128 x, __m128 y, __m128 z)
+    {
+        const __m128 l1 = _mm_max_ps(_mm_add_ps(_mm_add_ps(Abs(x), Abs(y)), Abs(z)), _mm_set1_ps(FLT_MIN));
+        __m128 ox = _mm_div_ps(x, l1);
+        __m128 oy = _mm_div_ps(y, l1);
+
+        // Fold the lower hemisphere
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 lower = _mm_cmplt_ps(z, _mm_setzero_ps());
+        const __m128 foldedX = _mm_mul_ps(_mm_sub_ps(one, Abs(oy)), SignNotZero(ox));
+        const __m128 foldedY = _mm_mul_ps(_mm_sub_ps(one, Abs(ox)), SignNotZero(oy));
+        ox = Select(lower, foldedX, ox);
+        oy = Select(lower, foldedY, oy);
+
+        const __m128 snormMax = _mm_set1_ps(SNORM16_MAX);
+        const __m128i ix = _mm_cvtps_epi32(_mm_mul_ps(Clamp(ox, -1.0f, 1.0f), snormMax));
+        const __m128i iy = _mm_cvtps_epi32(_mm_mul_ps(Clamp(oy, -1.0f, 1.0f), snormMax));
+        return _mm_or_si128(_mm_and_si128(ix, _mm_set1_epi32(0xFFFF)), _mm_slli_epi32(iy, 16));
+    }
+
+    __m128i PackColors(__m128 r, __m128 g, __m128 b, __m128 a, ColorFormat format)
+    {
+        const bool is10Bit = format == ColorFormat::RGB10A2;
+        const __m128 rgbMax = _mm_set1_ps(is10Bit ? 1023.0f : 255.0f);
+        const __m128 alphaMax = _mm_set1_ps(is10Bit ? 3.0f : 255.0f);
+        const int rgbBits = is10Bit ? 10 : 8;
+
+        const __m128i ir = _mm_cvtps_epi32(_mm_mul_ps(Clamp(r, 0.0f, 1.0f), rgbMax));
+        const __m128i ig = _mm_cvtps_epi32(_mm_mul_ps(Clamp(g, 0.0f, 1.0f), rgbMax));
+        const __m128i ib = _mm_cvtps_epi32(_mm_mul_ps(Clamp(b, 0.0f, 1.0f), rgbMax));
+        const __m128i ia = _mm_cvtps_epi32(_mm_mul_ps(Clamp(a, 0.0f, 1.0f), alphaMax));
+
+        __m128i packed = ir;
+        packed = _mm_or_si128(packed, _mm_slli_epi32(ig, rgbBits));
+        packed = _mm_or_si128(packed, _mm_slli_epi32(ib, rgbBits * 2));
+        packed = _mm_or_si128(packed, _mm_slli_epi32(ia, rgbBits * 3));
+        return packed;
+    }
+
+    // Process 4 vertices per iteration. Returns the index of the first vertex left for the scalar path.
+    uint32_t BuildStreamsSse(const GeometrySourceVertex* vertices, uint32_t vertexCount, const float invScale[3], GeometryStreams& streams)
+    {
+        const __m128 bias[3] = {
+            _mm_set1_ps(streams.dequantization.bias[0]), _mm_set1_ps(streams.dequantization.bias[1]), _mm_set1_ps(streams.dequantization.bias[2]) };
+        const __m128 inverseScale[3] = { _mm_set1_ps(invScale[0]), _mm_set1_ps(invScale[1]), _mm_set1_ps(invScale[2]) };
+        const __m128 snormMax = _mm_set1_ps(SNORM16_MAX);
+
+        uint32_t i = 0;
+        for (; i + 4 <= vertexCount; i += 4)
+        {
+            const GeometrySourceVertex* group = vertices + i;
+
+            if (streams.positionFormat == PositionFormat::Snorm16)
+            {
+                __m128i quantized[3];
+                for (uint32_t axis = 0; axis < 3; ++axis)
+                {
+                    const __m128 position = Gather(group, offsetof(GeometrySourceVertex, position) + axis * sizeof(float));
+                    const __m128 normalized = Clamp(_mm_mul_ps(_mm_sub_ps(position, bias[axis]), inverseScale[axis]), -1.0f, 1.0f);
+                    quantized[axis] = _mm_cvtps_epi32(_mm_mul_ps(normalized, snormMax));
+                }
+
+                // Transpose xxxx yyyy zzzz 0000 to xyz0 per vertex and narrow to 16 bits
+                const __m128i zero = _mm_setzero_si128();
+                const __m128i xyLow = _mm_unpacklo_epi32(quantized[0], quantized[1]);
+                const __m128i xyHigh = _mm_unpackhi_epi32(quantized[0], quantized[1]);
+                const __m128i zwLow = _mm_unpacklo_epi32(quantized[2], zero);
+                const __m128i zwHigh = _mm_unpackhi_epi32(quantized[2], zero);
+                const __m128i vertices01 = _mm_packs_epi32(_mm_unpacklo_epi64(xyLow, zwLow), _mm_unpackhi_epi64(xyLow, zwLow));
+                const __m128i vertices23 = _mm_packs_epi32(_mm_unpacklo_epi64(xyHigh, zwHigh), _mm_unpackhi_epi64(xyHigh, zwHigh));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(&streams.quantizedPositions[i * 4]), vertices01);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(&streams.quantizedPositions[i * 4 + 8]), vertices23);
+            }
+
+            const __m128i normals = EncodeOctahedralNormals(
+                Gather(group, offsetof(GeometrySourceVertex, normal)),
+                Gather(group, offsetof(GeometrySourceVertex, normal) + sizeof(float)),
+                Gather(group, offsetof(GeometrySourceVertex, normal) + sizeof(float) * 2));
+
+            const __m128i colors = PackColors(
+                Gather(group, offsetof(GeometrySourceVertex, color)),
+                Gather(group, offsetof(GeometrySourceVertex, color) + sizeof(float)),
+                Gather(group, offsetof(GeometrySourceVertex, color) + sizeof(float) * 2),
+                Gather(group, offsetof(GeometrySourceVertex, color) + sizeof(float) * 3),
+                streams.colorFormat);
+
+            // Interleave to normal, color pairs
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&streams.attributes[i]), _mm_unpacklo_epi32(normals, colors));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&streams.attributes[i + 2]), _mm_unpackhi_epi32(normals, colors));
+        }
+        return i;
+    }
+#endif
+}
+
+const void* GeometryStreams::GetPositionData() const
+{
+    return positionFormat == PositionFormat::Snorm16 ? static_cast<const void*>(quantizedPositions.data()) : static_cast<const void*>(positions.data());
+}
+
+uint32_t GeometryStreams::GetPositionStride() const
+{
+    return positionFormat == PositionFormat::Snorm16 ? sizeof(int16_t) * 4 : sizeof(float) * 3;
+}
+
+size_t GeometryStreams::GetPositionDataSize() const
+{
+    return static_cast<size_t>(vertexCount) * GetPositionStride();
+}
+
+uint32_t EncodeOctahedralNormal(const float normal[3])
+{
+    const float l1 = std::max(std::fabs(normal[0]) + std::fabs(normal[1]) + std::fabs(normal[2]), FLT_MIN);
+    float ox = normal[0] / l1;
+    float oy = normal[1] / l1;
+
+    // Fold the lower hemisphere
+    if (normal[2] < 0.0f)
+    {
+        const float foldedX = (1.0f - std::fabs(oy)) * SignNotZero(ox);
+        const float foldedY = (1.0f - std::fabs(ox)) * SignNotZero(oy);
+        ox = foldedX;
+        oy = foldedY;
+    }
+
+    const int32_t ix = RoundToInt(Clamp(ox, -1.0f, 1.0f) * SNORM16_MAX);
+    const int32_t iy = RoundToInt(Clamp(oy, -1.0f, 1.0f) * SNORM16_MAX);
+    return (static_cast<uint32_t>(ix) & 0xFFFF) | (static_cast<uint32_t>(iy) << 16);
+}
+
+void DecodeOctahedralNormal(uint32_t encoded, float normal[3])
+{
+    float x = DecodeSnorm16(static_cast<int16_t>(encoded & 0xFFFF));
+    float y = DecodeSnorm16(static_cast<int16_t>(encoded >> 16));
+    const float z = 1.0f - std::fabs(x) - std::fabs(y);
+
+    // Unfold the lower hemisphere
+    const float t = std::max(-z, 0.0f);
+    x += x >= 0.0f ? -t : t;
+    y += y >= 0.0f ? -t : t;
+
+    const float length = std::sqrt(x * x + y * y + z * z);
+    normal[0] = x / length;
+    normal[1] = y / length;
+    normal[2] = z / length;
+}
+
+uint32_t PackColor(const float color[4], ColorFormat format)
+{
+    const bool is10Bit = format == ColorFormat::RGB10A2;
+    const float rgbMax = is10Bit ? 1023.0f : 255.0f;
+    const float alphaMax = is10Bit ? 3.0f : 255.0f;
+    const uint32_t rgbBits = is10Bit ? 10 : 8;
+
+    uint32_t packed = 0;
+    for (uint32_t channel = 0; channel < 3; ++channel)
+    {
+        packed |= static_cast<uint32_t>(RoundToInt(Clamp(color[channel], 0.0f, 1.0f) * rgbMax)) << (rgbBits * channel);
+    }
+    packed |= static_cast<uint32_t>(RoundToInt(Clamp(color[3], 0.0f, 1.0f) * alphaMax)) << (rgbBits * 3);
+    return packed;
+}
+
+void UnpackColor(uint32_t packed, ColorFormat format, float color[4])
+{
+    const bool is10Bit = format == ColorFormat::RGB10A2;
+    const uint32_t rgbBits = is10Bit ? 10 : 8;
+    const uint32_t rgbMask = (1u << rgbBits) - 1;
+    const uint32_t alphaMask = is10Bit ? 0x3 : 0xFF;
+
+    for (uint32_t channel = 0; channel < 3; ++channel)
+    {
+        color[channel] = static_cast<float>((packed >> (rgbBits * channel)) & rgbMask) / static_cast<float>(rgbMask);
+    }
+    color[3] = static_cast<float>((packed >> (rgbBits * 3)) & alphaMask) / static_cast<float>(alphaMask);
+}
+
+void BuildGeometryStreams(const GeometrySourceVertex* vertices, uint32_t vertexCount, PositionFormat positionFormat, ColorFormat colorFormat,
+    GeometryStreams& streams, bool useSimd)
+{
+    streams.positionFormat = positionFormat;
+    streams.colorFormat = colorFormat;
+    streams.vertexCount = vertexCount;
+    streams.positions.clear();
+    streams.quantizedPositions.clear();
+    streams.dequantization = {};
+    streams.attributes.resize(vertexCount);
+
+    float invScale[3] = { 1.0f, 1.0f, 1.0f };
+    if (positionFormat == PositionFormat::Snorm16)
+    {
+        streams.dequantization = ComputeDequantization(vertices, vertexCount);
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            invScale[axis] = 1.0f / streams.dequantization.scale[axis];
+        }
+        streams.quantizedPositions.resize(static_cast<size_t>(vertexCount) * 4);
+    }
+    else
+    {
+        // Drop normal and color from the stride of the BLAS input
+        streams.positions.resize(static_cast<size_t>(vertexCount) * 3);
+        for (uint32_t i = 0; i < vertexCount; ++i)
+        {
+            streams.positions[i * 3 + 0] = vertices[i].position[0];
+            streams.positions[i * 3 + 1] = vertices[i].position[1];
+            streams.positions[i * 3 + 2] = vertices[i].position[2];
+        }
+    }
+
+    uint32_t first = 0;
+#if GEOMETRY_STREAMS_USE_SSE
+    if (useSimd)
+    {
+        first = BuildStreamsSse(vertices, vertexCount, invScale, streams);
+    }
+#else
+    (void)useSimd;
+#endif
+    BuildStreamsScalar(vertices, first, vertexCount, invScale, streams);
+}
+
+GeometryStreamErrors MeasureGeometryStreamErrors(const GeometrySourceVertex* vertices, uint32_t vertexCount, const GeometryStreams& streams)
+{
+    assert(vertexCount == streams.vertexCount);
+
+    const double RADIANS_TO_DEGREES = 57.29577951308232;
+
+    GeometryStreamErrors errors = {};
+    for (uint32_t i = 0; i < vertexCount; ++i)
+    {
+        const GeometrySourceVertex& vertex = vertices[i];
+
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            float decoded = 0.0f;
+            if (streams.positionFormat == PositionFormat::Snorm16)
+            {
+                decoded = DecodeSnorm16(streams.quantizedPositions[i * 4 + axis]) * streams.dequantization.scale[axis] + streams.dequantization.bias[axis];
+            }
+            else
+            {
+                decoded = streams.positions[i * 3 + axis];
+            }
+            errors.maxPositionError = std::max(errors.maxPositionError, std::fabs(decoded - vertex.position[axis]));
+        }
+
+        const float length = std::sqrt(vertex.normal[0] * vertex.normal[0] + vertex.normal[1] * vertex.normal[1] + vertex.normal[2] * vertex.normal[2]);
+        if (length > 0.0f)
+        {
+            float normal[3];
+            DecodeOctahedralNormal(streams.attributes[i].normal, normal);
+            // atan2 of |cross| and dot in double, acos of a float dot product cannot resolve angles this small
+            const double cx = static_cast<double>(normal[1]) * vertex.normal[2] - static_cast<double>(normal[2]) * vertex.normal[1];
+            const double cy = static_cast<double>(normal[2]) * vertex.normal[0] - static_cast<double>(normal[0]) * vertex.normal[2];
+            const double cz = static_cast<double>(normal[0]) * vertex.normal[1] - static_cast<double>(normal[1]) * vertex.normal[0];
+            const double dot = static_cast<double>(normal[0]) * vertex.normal[0] + static_cast<double>(normal[1]) * vertex.normal[1] + static_cast<double>(normal[2]) * vertex.normal[2];
+            const double angle = std::atan2(std::sqrt(cx * cx + cy * cy + cz * cz), dot);
+            errors.maxNormalErrorDegrees = std::max(errors.maxNormalErrorDegrees, static_cast<float>(angle * RADIANS_TO_DEGREES));
+        }
+
+        float color[4];
+        UnpackColor(streams.attributes[i].color, streams.colorFormat, color);
+        for (uint32_t channel = 0; channel < 4; ++channel)
+        {
+            errors.maxColorError = std::max(errors.maxColorError, std::fabs(color[channel] - Clamp(vertex.color[channel], 0.0f, 1.0f)));
+        }
+    }
+    return errors;
+}
+
+void GetDequantizationTransform(const PositionDequantization& dequantization, float transform[12])
+{
+    for (uint32_t row = 0; row < 3; ++row)
+    {
+        for (uint32_t column = 0; column < 3; ++column)
+        {
+            transform[row * 4 + column] = row == column ? dequantization.scale[row] : 0.0f;
+        }
+        transform[row * 4 + 3] = dequantization.bias[row];
+    }
+}
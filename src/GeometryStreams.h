@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Conversion of AoS vertices into the split vertex streams used by the acceleration structure builds and the shaders.
+//
+// Position stream: tightly packed float3 (12 bytes), or snorm16x4 (8 bytes) quantized to the bounds of the mesh.
+//                  Quantized positions are dequantized by the geometry transform of the BLAS build.
+// Attribute stream: 8 bytes per vertex, an octahedral encoded snorm16x2 normal and an RGBA8 or RGB10A2 unorm color.
+//
+// This module has no Direct3D12 dependency so that the round-trip errors can be checked by tools/GeometryStreamsTool.
+
+enum class PositionFormat : uint32_t
+{
+    Float3 = 0,     // DXGI_FORMAT_R32G32B32_FLOAT
+    Snorm16 = 1,    // DXGI_FORMAT_R16G16B16A16_SNORM, w is 0
+};
+
+enum class ColorFormat : uint32_t
+{
+    RGBA8 = 0,      // DXGI_FORMAT_R8G8B8A8_UNORM
+    RGB10A2 = 1,    // DXGI_FORMAT_R10G10B10A2_UNORM
+};
+
+// Source vertex layout, identical to Vertex in RaytracingHelpers.h
+struct GeometrySourceVertex
+{
+    float position[3];
+    float normal[3];
+    float color[4];
+};
+static_assert(sizeof(GeometrySourceVertex) == 40, "GeometrySourceVertex must match Vertex");
+
+struct PackedVertexAttributes
+{
+    uint32_t normal;    // octahedral snorm16x2, x in the low 16 bits
+    uint32_t color;     // RGBA8 or RGB10A2, red in the low bits
+};
+static_assert(sizeof(PackedVertexAttributes) == 8, "PackedVertexAttributes is read with Load2 in the shaders");
+
+// position = snorm * scale + bias
+struct PositionDequantization
+{
+    float scale[3];
+    float bias[3];
+};
+
+// Per mesh description read by the closest hit shader. Must match MeshInfo in shaders/Common.hlsli.
+// Offsets are byte offsets in the geometry buffer.
+struct MeshInfo
+{
+    uint32_t positionOffset;
+    uint32_t positionFormat;
+    uint32_t indexOffset;
+    uint32_t indexStride;
+    uint32_t attributeOffset;
+    uint32_t colorFormat;
+    uint32_t vertexCount;
+    uint32_t primitiveCount;
+};
+static_assert(sizeof(MeshInfo) == 32, "MeshInfo is read with two Load4 in the shaders");
+
+struct GeometryStreams
+{
+    PositionFormat positionFormat = PositionFormat::Float3;
+    ColorFormat colorFormat = ColorFormat::RGBA8;
+    uint32_t vertexCount = 0;
+
+    // PositionFormat::Float3, 3 floats per vertex
+    std::vector<float> positions;
+
+    // PositionFormat::Snorm16, 4 components per vertex
+    std::vector<int16_t> quantizedPositions;
+    PositionDequantization dequantization = {};
+
+    std::vector<PackedVertexAttributes> attributes;
+
+    const void* GetPositionData() const;
+    uint32_t GetPositionStride() const;
+    size_t GetPositionDataSize() const;
+};
+
+// Maximum errors of the decoded streams against the source vertices
+struct GeometryStreamErrors
+{
+    float maxPositionError;         // in the units of the positions
+    float maxNormalErrorDegrees;
+    float maxColorError;            // in [0, 1]
+};
+
+// Build the streams. useSimd selects the SSE2 path on x86; both paths produce identical results.
+void BuildGeometryStreams(const GeometrySourceVertex* vertices, uint32_t vertexCount, PositionFormat positionFormat, ColorFormat colorFormat,
+    GeometryStreams& streams, bool useSimd = true);
+
+// Decode the streams and compare them with the source vertices
+GeometryStreamErrors MeasureGeometryStreamErrors(const GeometrySourceVertex* vertices, uint32_t vertexCount, const GeometryStreams& streams);
+
+// Row-major 3x4 matrix for D3D12_RAYTRACING_GEOMETRY_TRIANGLES_DESC::Transform3x4
+void GetDequantizationTransform(const PositionDequantization& dequantization, float transform[12]);
+
+// Scalar encoders and decoders, the reference of the SIMD path and of the shader decoders
+uint32_t EncodeOctahedralNormal(const float normal[3]);
+void DecodeOctahedralNormal(uint32_t encoded, float normal[3]);
+uint32_t PackColor(const float color[4], ColorFormat format);
+void UnpackColor(uint32_t packed, ColorFormat format, float color[4]);
@@ -0,0 +1,815 @@
+#include "GltfLoader.h"
+#include "Json.h"
+#include "MappedFile.h"
+#include "PlatformHelpers.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <format>
+
+namespace
+{
+    const uint32_t GLB_MAGIC = 0x46546C67;          // "glTF"
+    const uint32_t GLB_HEADER_SIZE = 12;
+    const uint32_t GLB_CHUNK_HEADER_SIZE = 8;
+    const uint32_t GLB_CHUNK_JSON = 0x4E4F534A;     // "JSON"
+    const uint32_t GLB_CHUNK_BIN = 0x004E4942;      // "BIN\0"
+
+    const uint32_t GLTF_MODE_TRIANGLES = 4;
+    const uint32_t INVALID_INDEX = UINT32_MAX;
+
+    // Same as the OBJ loader
+    const float DEFAULT_BASE_COLOR[4] = { 0.8f, 0.8f, 0.8f, 1.0f };
+
+    struct BufferView
+    {
+        uint32_t buffer;
+        uint64_t byteOffset;
+        uint64_t byteLength;
+        uint32_t byteStride;    // 0 for tightly packed
+    };
+
+    uint32_t ReadUInt32(const uint8_t* data)
+    {
+        uint32_t value = 0;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    uint32_t GetComponentSize(GltfComponentType type)
+    {
+        switch (type)
+        {
+        case GltfComponentType::Int8:
+        case GltfComponentType::UInt8:
+            return 1;
+        case GltfComponentType::Int16:
+        case GltfComponentType::UInt16:
+            return 2;
+        case GltfComponentType::UInt32:
+        case GltfComponentType::Float:
+            return 4;
+        }
+        return 0;
+    }
+
+    uint32_t GetNumComponents(const std::string& type)
+    {
+        if (type == "SCALAR")
+        {
+            return 1;
+        }
+        if (type.size() == 4 && type.compare(0, 3, "VEC") == 0 && type[3] >= '2' && type[3] <= '4')
+        {
+            return static_cast<uint32_t>(type[3] - '0');
+        }
+        // Matrices are not used by the supported attributes
+        return 0;
+    }
+
+    bool DecodeBase64(const char* begin, const char* end, std::vector<uint8_t>& output)
+    {
+        output.clear();
+        output.reserve(static_cast<size_t>(end - begin) / 4 * 3);
+
+        uint32_t bits = 0;
+        uint32_t numBits = 0;
+        for (const char* p = begin; p < end; ++p)
+        {
+            const char c = *p;
+            uint32_t value = 0;
+            if (c >= 'A' && c <= 'Z')
+            {
+                value = c - 'A';
+            }
+            else if (c >= 'a' && c <= 'z')
+            {
+                value = c - 'a' + 26;
+            }
+            else if (c >= '0' && c <= '9')
+            {
+                value = c - '0' + 52;
+            }
+            else if (c == '+')
+            {
+                value = 62;
+            }
+            else if (c == '/')
+            {
+                value = 63;
+            }
+            else if (c == '=')
+            {
+                break;
+            }
+            else
+            {
+                return false;
+            }
+
+            bits = (bits << 6) | value;
+            numBits += 6;
+            if (numBits >= 8)
+            {
+                numBits -= 8;
+                output.push_back(static_cast<uint8_t>(bits >> numBits));
+            }
+        }
+        return true;
+    }
+
+    // URIs of external buffers are relative paths with percent encoding
+    std::string DecodeUri(const std::string& uri)
+    {
+        std::string path;
+        path.reserve(uri.size());
+        for (size_t i = 0; i < uri.size(); ++i)
+        {
+            if (uri[i] == '%' && i + 2 < uri.size() && isxdigit(static_cast<unsigned char>(uri[i + 1])) && isxdigit(static_cast<unsigned char>(uri[i + 2])))
+            {
+                path += static_cast<char>(std::stoi(uri.substr(i + 1, 2), nullptr, 16));
+                i += 2;
+            }
+            else
+            {
+                path += uri[i];
+            }
+        }
+        return path;
+    }
+
+    // result = a * b for row-major 3x4 affine transforms, result must not alias the inputs
+    void MultiplyTransforms(const float a[3][4], const float b[3][4], float result[3][4])
+    {
+        for (uint32_t row = 0; row < 3; ++row)
+        {
+            for (uint32_t column = 0; column < 4; ++column)
+            {
+                result[row][column] = a[row][0] * b[0][column] + a[row][1] * b[1][column] + a[row][2] * b[2][column];
+            }
+            result[row][3] += a[row][3];
+        }
+    }
+
+    // Either "matrix" (column-major 4x4) or translation * rotation * scale
+    void GetLocalTransform(const JsonValue& node, float m[3][4])
+    {
+        const JsonValue& matrix = node["matrix"];
+        if (matrix.Size() == 16)
+        {
+            for (uint32_t row = 0; row < 3; ++row)
+            {
+                for (uint32_t column = 0; column < 4; ++column)
+                {
+                    m[row][column] = matrix.At(column * 4 + row).GetFloat();
+                }
+            }
+            return;
+        }
+
+        const JsonValue& translation = node["translation"];
+        const JsonValue& rotation = node["rotation"];
+        const JsonValue& scale = node["scale"];
+        const float t[3] = { translation.At(0).GetFloat(0.0f), translation.At(1).GetFloat(0.0f), translation.At(2).GetFloat(0.0f) };
+        const float x = rotation.At(0).GetFloat(0.0f);
+        const float y = rotation.At(1).GetFloat(0.0f);
+        const float z = rotation.At(2).GetFloat(0.0f);
+        const float w = rotation.At(3).GetFloat(1.0f);
+        const float s[3] = { scale.At(0).GetFloat(1.0f), scale.At(1).GetFloat(1.0f), scale.At(2).GetFloat(1.0f) };
+
+        const float r[3][3] = {
+            { 1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y - z * w), 2.0f * (x * z + y * w) },
+            { 2.0f * (x * y + z * w), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z - x * w) },
+            { 2.0f * (x * z - y * w), 2.0f * (y * z + x * w), 1.0f - 2.0f * (x * x + y * y) },
+        };
+        for (uint32_t row = 0; row < 3; ++row)
+        {
+            for (uint32_t column = 0; column < 3; ++column)
+            {
+                m[row][column] = r[row][column] * s[column];
+            }
+            m[row][3] = t[row];
+        }
+    }
+
+    double MillisecondsSince(std::chrono::steady_clock::time_point startTime)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    }
+}
+
+uint32_t GltfAccessorView::GetElementSize() const
+{
+    return GetComponentSize(componentType) * numComponents;
+}
+
+void GltfAccessorView::ReadFloats(uint32_t index, float* values, uint32_t numValues) const
+{
+    const uint8_t* element = data + static_cast<size_t>(index) * stride;
+    const uint32_t numRead = std::min(numValues, numComponents);
+    for (uint32_t c = 0; c < numRead; ++c)
+    {
+        switch (componentType)
+        {
+        case GltfComponentType::Int8:
+        {
+            const float value = static_cast<float>(static_cast<int8_t>(element[c]));
+            values[c] = normalized ? std::max(value / 127.0f, -1.0f) : value;
+            break;
+        }
+        case GltfComponentType::UInt8:
+        {
+            const float value = static_cast<float>(element[c]);
+            values[c] = normalized ? value / 255.0f : value;
+            break;
+        }
+        case GltfComponentType::Int16:
+        {
+            int16_t component = 0;
+            memcpy(&component, element + c * sizeof(component), sizeof(component));
+            const float value = static_cast<float>(component);
+            values[c] = normalized ? std::max(value / 32767.0f, -1.0f) : value;
+            break;
+        }
+        case GltfComponentType::UInt16:
+        {
+            uint16_t component = 0;
+            memcpy(&component, element + c * sizeof(component), sizeof(component));
+            const float value = static_cast<float>(component);
+            values[c] = normalized ? value / 65535.0f : value;
+            break;
+        }
+        case GltfComponentType::UInt32:
+            values[c] = static_cast<float>(ReadUInt32(element + c * sizeof(uint32_t)));
+            break;
+        case GltfComponentType::Float:
+            memcpy(&values[c], element + c * sizeof(float), sizeof(float));
+            break;
+        }
+    }
+}
+
+uint32_t GltfAccessorView::ReadIndex(uint32_t index) const
+{
+    const uint8_t* element = data + static_cast<size_t>(index) * stride;
+    switch (componentType)
+    {
+    case GltfComponentType::UInt8:
+        return element[0];
+    case GltfComponentType::UInt16:
+    {
+        uint16_t value = 0;
+        memcpy(&value, element, sizeof(value));
+        return value;
+    }
+    case GltfComponentType::UInt32:
+        return ReadUInt32(element);
+    default:
+        return 0;
+    }
+}
+
+GltfScene::GltfScene()
+{
+}
+
+GltfScene::~GltfScene()
+{
+}
+
+bool GltfScene::Load(const char* path, ThreadPool& threadPool, GltfLoadStats* stats)
+{
+    m_files.clear();
+    m_filePaths.clear();
+    m_decodedBuffers.clear();
+    m_buffers.clear();
+    m_meshes.clear();
+    m_primitives.clear();
+    m_instances.clear();
+
+    GltfLoadStats loadStats = {};
+
+    // Map the file, the JSON and the BIN chunk of a .glb are ranges of the mapping
+    auto startTime = std::chrono::steady_clock::now();
+    m_files.push_back(std::make_unique<MappedFile>());
+    m_filePaths.push_back(path);
+    MappedFile& file = *m_files.back();
+    if (!file.Open(path) || file.GetSize() == 0)
+    {
+        OutputDebugStringA(std::format("glTF: failed to open {}\n", path).c_str());
+        return false;
+    }
+    loadStats.fileSize = file.GetSize();
+    loadStats.mapMilliseconds = MillisecondsSince(startTime);
+
+    const uint8_t* fileData = reinterpret_cast<const uint8_t*>(file.GetData());
+    const char* json = file.GetData();
+    uint64_t jsonSize = file.GetSize();
+    Buffer binChunk = {};
+    if (file.GetSize() >= GLB_HEADER_SIZE && ReadUInt32(fileData) == GLB_MAGIC)
+    {
+        const uint64_t length = std::min<uint64_t>(ReadUInt32(fileData + 8), file.GetSize());
+        uint64_t chunkOffset = GLB_HEADER_SIZE;
+        json = nullptr;
+        while (chunkOffset + GLB_CHUNK_HEADER_SIZE <= length)
+        {
+            const uint32_t chunkLength = ReadUInt32(fileData + chunkOffset);
+            const uint32_t chunkType = ReadUInt32(fileData + chunkOffset + 4);
+            const uint64_t chunkData = chunkOffset + GLB_CHUNK_HEADER_SIZE;
+            if (chunkData + chunkLength > length)
+            {
+                break;
+            }
+
+            if (chunkType == GLB_CHUNK_JSON && !json)
+            {
+                json = reinterpret_cast<const char*>(fileData + chunkData);
+                jsonSize = chunkLength;
+            }
+            else if (chunkType == GLB_CHUNK_BIN && !binChunk.data)
+            {
+                binChunk.data = fileData + chunkData;
+                binChunk.size = chunkLength;
+            }
+
+            // Chunks are 4 byte aligned
+            chunkOffset = chunkData + AlignSize(static_cast<uint64_t>(chunkLength), 4u);
+        }
+
+        if (!json)
+        {
+            OutputDebugStringA(std::format("glTF: {} has no JSON chunk\n", path).c_str());
+            return false;
+        }
+    }
+
+    startTime = std::chrono::steady_clock::now();
+    JsonValue document;
+    std::string error;
+    if (!ParseJson(json, static_cast<size_t>(jsonSize), document, &error))
+    {
+        OutputDebugStringA(std::format("glTF: failed to parse {}: {}\n", path, error).c_str());
+        return false;
+    }
+    loadStats.parseMilliseconds = MillisecondsSince(startTime);
+
+    const std::string& version = document["asset"]["version"].GetString();
+    if (version.empty() || version[0] != '2')
+    {
+        OutputDebugStringA(std::format("glTF: {} has unsupported version \"{}\"\n", path, version).c_str());
+        return false;
+    }
+
+    // Buffers: the BIN chunk, data URIs or files relative to the .gltf
+    const JsonValue& buffers = document["buffers"];
+    const std::filesystem::path directory = std::filesystem::path(path).parent_path();
+    for (size_t i = 0; i < buffers.Size(); ++i)
+    {
+        const JsonValue& buffer = buffers.At(i);
+        const uint64_t byteLength = buffer["byteLength"].GetUInt64();
+        const JsonValue* uri = buffer.Find("uri");
+
+        Buffer loaded = {};
+        if (!uri)
+        {
+            // Only the first buffer of a .glb may omit the URI
+            if (i == 0)
+            {
+                loaded = binChunk;
+            }
+        }
+        else if (uri->GetString().compare(0, 5, "data:") == 0)
+        {
+            const std::string& dataUri = uri->GetString();
+            const size_t dataBegin = dataUri.find(";base64,");
+            m_decodedBuffers.emplace_back();
+            if (dataBegin != std::string::npos &&
+                DecodeBase64(dataUri.data() + dataBegin + 8, dataUri.data() + dataUri.size(), m_decodedBuffers.back()))
+            {
+                loaded.data = m_decodedBuffers.back().data();
+                loaded.size = m_decodedBuffers.back().size();
+                loadStats.copiedBufferSize += loaded.size;
+            }
+        }
+        else
+        {
+            const std::string bufferPath = (directory / std::filesystem::path(DecodeUri(uri->GetString()))).string();
+            m_files.push_back(std::make_unique<MappedFile>());
+            m_filePaths.push_back(bufferPath);
+            if (m_files.back()->Open(bufferPath.c_str()))
+            {
+                loaded.data = reinterpret_cast<const uint8_t*>(m_files.back()->GetData());
+                loaded.size = m_files.back()->GetSize();
+            }
+        }
+
+        if (!loaded.data || loaded.size < byteLength)
+        {
+            OutputDebugStringA(std::format("glTF: buffer {} of {} is missing or shorter than {} bytes\n", i, path, byteLength).c_str());
+            return false;
+        }
+        loaded.size = byteLength;
+        m_buffers.push_back(loaded);
+        loadStats.bufferSize += byteLength;
+    }
+
+    // Buffer views are validated once, accessors are validated against their view
+    const JsonValue& bufferViewValues = document["bufferViews"];
+    std::vector<BufferView> bufferViews(bufferViewValues.Size());
+    for (size_t i = 0; i < bufferViews.size(); ++i)
+    {
+        const JsonValue& value = bufferViewValues.At(i);
+        BufferView& view = bufferViews[i];
+        view.buffer = value["buffer"].GetUInt(INVALID_INDEX);
+        view.byteOffset = value["byteOffset"].GetUInt64();
+        view.byteLength = value["byteLength"].GetUInt64();
+        view.byteStride = value["byteStride"].GetUInt();
+        if (view.buffer >= m_buffers.size() || view.byteOffset + view.byteLength > m_buffers[view.buffer].size)
+        {
+            view.buffer = INVALID_INDEX;
+        }
+    }
+
+    const JsonValue& accessors = document["accessors"];
+    auto getAccessorView = [&](uint32_t accessorIndex, GltfAccessorView& view)
+    {
+        view = GltfAccessorView();
+        const JsonValue& accessor = accessors.At(accessorIndex);
+        const uint32_t bufferViewIndex = accessor["bufferView"].GetUInt(INVALID_INDEX);
+
+        // Accessors without a buffer view are all zeros, sparse accessors are not supported
+        if (bufferViewIndex >= bufferViews.size() || bufferViews[bufferViewIndex].buffer == INVALID_INDEX || accessor.Find("sparse"))
+        {
+            return false;
+        }
+
+        const BufferView& bufferView = bufferViews[bufferViewIndex];
+        view.componentType = static_cast<GltfComponentType>(accessor["componentType"].GetUInt());
+        view.numComponents = GetNumComponents(accessor["type"].GetString());
+        view.count = accessor["count"].GetUInt();
+        view.normalized = accessor["normalized"].GetBool();
+        const uint32_t elementSize = view.GetElementSize();
+        view.stride = bufferView.byteStride ? bufferView.byteStride : elementSize;
+
+        const uint64_t byteOffset = accessor["byteOffset"].GetUInt64();
+        if (elementSize == 0 || view.count == 0 ||
+            byteOffset + static_cast<uint64_t>(view.count - 1) * view.stride + elementSize > bufferView.byteLength)
+        {
+            return false;
+        }
+
+        view.data = m_buffers[bufferView.buffer].data + bufferView.byteOffset + byteOffset;
+        return true;
+    };
+
+    // Base color factors of the materials
+    const JsonValue& materials = document["materials"];
+    std::vector<std::array<float, 4>> baseColors(materials.Size());
+    for (size_t i = 0; i < baseColors.size(); ++i)
+    {
+        const JsonValue& factor = materials.At(i)["pbrMetallicRoughness"]["baseColorFactor"];
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            baseColors[i][c] = factor.At(c).GetFloat(1.0f);
+        }
+    }
+
+    // Triangle primitives of every mesh
+    const JsonValue& meshes = document["meshes"];
+    std::vector<GltfPrimitive> candidates;
+    for (uint32_t meshIndex = 0; meshIndex < meshes.Size(); ++meshIndex)
+    {
+        const JsonValue& primitives = meshes.At(meshIndex)["primitives"];
+        for (size_t i = 0; i < primitives.Size(); ++i)
+        {
+            const JsonValue& primitive = primitives.At(i);
+            const JsonValue& attributes = primitive["attributes"];
+
+            GltfPrimitive candidate = {};
+            candidate.meshIndex = meshIndex;
+            const uint32_t mode = primitive["mode"].GetUInt(GLTF_MODE_TRIANGLES);
+            if (mode != GLTF_MODE_TRIANGLES || !getAccessorView(attributes["POSITION"].GetUInt(INVALID_INDEX), candidate.positions) ||
+                !candidate.positions.Is(GltfComponentType::Float, 3))
+            {
+                ++loadStats.numSkippedPrimitives;
+                continue;
+            }
+
+            // Optional attributes of the wrong type or count are ignored
+            const uint32_t vertexCount = candidate.positions.count;
+            if (!getAccessorView(attributes["NORMAL"].GetUInt(INVALID_INDEX), candidate.normals) ||
+                !candidate.normals.Is(GltfComponentType::Float, 3) || candidate.normals.count != vertexCount)
+            {
+                candidate.normals = GltfAccessorView();
+            }
+            if (!getAccessorView(attributes["COLOR_0"].GetUInt(INVALID_INDEX), candidate.colors) ||
+                (candidate.colors.numComponents != 3 && candidate.colors.numComponents != 4) || candidate.colors.count != vertexCount ||
+                (candidate.colors.componentType != GltfComponentType::Float && !candidate.colors.normalized))
+            {
+                candidate.colors = GltfAccessorView();
+            }
+
+            const JsonValue* indices = primitive.Find("indices");
+            if (indices)
+            {
+                if (!getAccessorView(indices->GetUInt(INVALID_INDEX), candidate.indices) || candidate.indices.numComponents != 1 ||
+                    (candidate.indices.componentType != GltfComponentType::UInt8 && candidate.indices.componentType != GltfComponentType::UInt16 &&
+                     candidate.indices.componentType != GltfComponentType::UInt32) ||
+                    candidate.indices.count % 3 != 0)
+                {
+                    ++loadStats.numSkippedPrimitives;
+                    continue;
+                }
+            }
+            else if (vertexCount % 3 != 0)
+            {
+                ++loadStats.numSkippedPrimitives;
+                continue;
+            }
+
+            // POSITION accessors are required to have min and max, they are computed below if they are missing
+            const JsonValue& positionAccessor = accessors.At(attributes["POSITION"].GetUInt(INVALID_INDEX));
+            const JsonValue& boundsMin = positionAccessor["min"];
+            const JsonValue& boundsMax = positionAccessor["max"];
+            for (uint32_t axis = 0; axis < 3; ++axis)
+            {
+                candidate.boundsMin[axis] = boundsMin.At(axis).GetFloat(FLT_MAX);
+                candidate.boundsMax[axis] = boundsMax.At(axis).GetFloat(-FLT_MAX);
+            }
+
+            const uint32_t material = primitive["material"].GetUInt(INVALID_INDEX);
+            memcpy(candidate.baseColor, material < baseColors.size() ? baseColors[material].data() : DEFAULT_BASE_COLOR, sizeof(candidate.baseColor));
+            candidates.push_back(candidate);
+        }
+    }
+
+    // Indices referencing missing vertices would be read out of bounds by the BLAS builds
+    std::vector<uint8_t> isValid(candidates.size(), 1);
+    threadPool.ParallelFor(static_cast<uint32_t>(candidates.size()), [&](uint32_t i)
+    {
+        GltfPrimitive& candidate = candidates[i];
+        if (candidate.boundsMin[0] > candidate.boundsMax[0])
+        {
+            for (uint32_t v = 0; v < candidate.positions.count; ++v)
+            {
+                float position[3];
+                candidate.positions.ReadFloats(v, position, 3);
+                for (uint32_t axis = 0; axis < 3; ++axis)
+                {
+                    candidate.boundsMin[axis] = std::min(candidate.boundsMin[axis], position[axis]);
+                    candidate.boundsMax[axis] = std::max(candidate.boundsMax[axis], position[axis]);
+                }
+            }
+        }
+
+        if (!candidate.indices.IsPresent())
+        {
+            return;
+        }
+
+        uint32_t maxIndex = 0;
+        for (uint32_t k = 0; k < candidate.indices.count; ++k)
+        {
+            maxIndex = std::max(maxIndex, candidate.indices.ReadIndex(k));
+        }
+        isValid[i] = maxIndex < candidate.positions.count;
+    });
+
+    m_meshes.resize(meshes.Size());
+    for (uint32_t meshIndex = 0; meshIndex < m_meshes.size(); ++meshIndex)
+    {
+        m_meshes[meshIndex].name = meshes.At(meshIndex)["name"].GetString();
+        if (m_meshes[meshIndex].name.empty())
+        {
+            m_meshes[meshIndex].name = std::format("mesh_{}", meshIndex);
+        }
+    }
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+        if (!isValid[i])
+        {
+            ++loadStats.numSkippedPrimitives;
+            continue;
+        }
+
+        // Candidates are in mesh order
+        GltfMesh& mesh = m_meshes[candidates[i].meshIndex];
+        if (mesh.numPrimitives == 0)
+        {
+            mesh.firstPrimitive = static_cast<uint32_t>(m_primitives.size());
+        }
+        ++mesh.numPrimitives;
+        m_primitives.push_back(candidates[i]);
+    }
+
+    // Breadth first levels of the node hierarchy of the default scene. A node reached twice (invalid in glTF) is
+    // only instantiated once, which also stops cycles.
+    startTime = std::chrono::steady_clock::now();
+    const JsonValue& nodes = document["nodes"];
+    const uint32_t numNodes = static_cast<uint32_t>(nodes.Size());
+    std::vector<uint32_t> parents(numNodes, INVALID_INDEX);
+    std::vector<uint8_t> isVisited(numNodes, 0);
+    std::vector<std::vector<uint32_t>> levels(1);
+
+    const JsonValue& scenes = document["scenes"];
+    if (scenes.Size() > 0)
+    {
+        const JsonValue& rootNodes = scenes.At(std::min<size_t>(document["scene"].GetUInt(0), scenes.Size() - 1))["nodes"];
+        for (size_t i = 0; i < rootNodes.Size(); ++i)
+        {
+            const uint32_t node = rootNodes.At(i).GetUInt(INVALID_INDEX);
+            if (node < numNodes && !isVisited[node])
+            {
+                isVisited[node] = 1;
+                levels[0].push_back(node);
+            }
+        }
+    }
+    else
+    {
+        // Without scenes every node which is nobody's child is a root
+        std::vector<uint8_t> isChild(numNodes, 0);
+        for (uint32_t node = 0; node < numNodes; ++node)
+        {
+            const JsonValue& children = nodes.At(node)["children"];
+            for (size_t i = 0; i < children.Size(); ++i)
+            {
+                const uint32_t child = children.At(i).GetUInt(INVALID_INDEX);
+                if (child < numNodes)
+                {
+                    isChild[child] = 1;
+                }
+            }
+        }
+        for (uint32_t node = 0; node < numNodes; ++node)
+        {
+            if (!isChild[node])
+            {
+                isVisited[node] = 1;
+                levels[0].push_back(node);
+            }
+        }
+    }
+
+    while (!levels.back().empty())
+    {
+        std::vector<uint32_t> nextLevel;
+        for (uint32_t node : levels.back())
+        {
+            const JsonValue& children = nodes.At(node)["children"];
+            for (size_t i = 0; i < children.Size(); ++i)
+            {
+                const uint32_t child = children.At(i).GetUInt(INVALID_INDEX);
+                if (child < numNodes && !isVisited[child])
+                {
+                    isVisited[child] = 1;
+                    parents[child] = node;
+                    nextLevel.push_back(child);
+                }
+            }
+        }
+        levels.push_back(std::move(nextLevel));
+    }
+    levels.pop_back();
+
+    // The nodes of a level only depend on the previous level
+    std::vector<std::array<float, 12>> worldTransforms(numNodes);
+    for (const std::vector<uint32_t>& level : levels)
+    {
+        threadPool.ParallelFor(static_cast<uint32_t>(level.size()), [&](uint32_t i)
+        {
+            const uint32_t node = level[i];
+            float (*world)[4] = reinterpret_cast<float (*)[4]>(worldTransforms[node].data());
+            float local[3][4];
+            GetLocalTransform(nodes.At(node), local);
+            if (parents[node] == INVALID_INDEX)
+            {
+                memcpy(world, local, sizeof(local));
+            }
+            else
+            {
+                MultiplyTransforms(reinterpret_cast<const float (*)[4]>(worldTransforms[parents[node]].data()), local, world);
+            }
+        });
+    }
+    loadStats.flattenMilliseconds = MillisecondsSince(startTime);
+
+    for (const std::vector<uint32_t>& level : levels)
+    {
+        for (uint32_t node : level)
+        {
+            const uint32_t meshIndex = nodes.At(node)["mesh"].GetUInt(INVALID_INDEX);
+            if (meshIndex < m_meshes.size() && m_meshes[meshIndex].numPrimitives > 0)
+            {
+                GltfInstance instance = {};
+                instance.meshIndex = meshIndex;
+                memcpy(instance.transform, worldTransforms[node].data(), sizeof(instance.transform));
+                m_instances.push_back(instance);
+            }
+        }
+    }
+
+    loadStats.numNodes = numNodes;
+    loadStats.numMeshes = static_cast<uint32_t>(m_meshes.size());
+    loadStats.numPrimitives = static_cast<uint32_t>(m_primitives.size());
+    loadStats.numInstances = static_cast<uint32_t>(m_instances.size());
+    loadStats.hierarchyDepth = static_cast<uint32_t>(levels.size());
+    if (stats)
+    {
+        *stats = loadStats;
+    }
+
+    if (loadStats.numSkippedPrimitives > 0)
+    {
+        OutputDebugStringA(std::format("glTF: {} primitives of {} skipped (not triangles, sparse or invalid accessors)\n", loadStats.numSkippedPrimitives, path).c_str());
+    }
+    if (m_instances.empty())
+    {
+        OutputDebugStringA(std::format("glTF: {} has no instance of a triangle mesh\n", path).c_str());
+        return false;
+    }
+    return true;
+}
+
+void ConvertGltfPrimitive(const GltfPrimitive& primitive, std::vector<GeometrySourceVertex>& vertices, std::vector<uint32_t>& indices)
+{
+    const uint32_t vertexCount = primitive.positions.count;
+    vertices.resize(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; ++v)
+    {
+        GeometrySourceVertex& vertex = vertices[v];
+        primitive.positions.ReadFloats(v, vertex.position, 3);
+        GetGltfVertexColor(primitive, v, vertex.color);
+        if (primitive.normals.IsPresent())
+        {
+            primitive.normals.ReadFloats(v, vertex.normal, 3);
+        }
+        else
+        {
+            memset(vertex.normal, 0, sizeof(vertex.normal));
+        }
+    }
+
+    indices.resize(primitive.indices.IsPresent() ? primitive.indices.count : vertexCount);
+    for (uint32_t i = 0; i < indices.size(); ++i)
+    {
+        indices[i] = primitive.indices.IsPresent() ? primitive.indices.ReadIndex(i) : i;
+    }
+
+    // Area weighted normals when the primitive has none
+    if (!primitive.normals.IsPresent())
+    {
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            const float* p0 = vertices[indices[i]].position;
+            const float* p1 = vertices[indices[i + 1]].position;
+            const float* p2 = vertices[indices[i + 2]].position;
+            const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            const float faceNormal[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                float* normal = vertices[indices[i + k]].normal;
+                normal[0] += faceNormal[0];
+                normal[1] += faceNormal[1];
+                normal[2] += faceNormal[2];
+            }
+        }
+
+        for (GeometrySourceVertex& vertex : vertices)
+        {
+            float* normal = vertex.normal;
+            const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+            if (length > 0.0f)
+            {
+                normal[0] /= length;
+                normal[1] /= length;
+                normal[2] /= length;
+            }
+            else
+            {
+                normal[1] = 1.0f;
+            }
+        }
+    }
+}
+
+void GetGltfVertexColor(const GltfPrimitive& primitive, uint32_t vertex, float color[4])
+{
+    // COLOR_0 is multiplied by the base color factor
+    float vertexColor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    if (primitive.colors.IsPresent())
+    {
+        primitive.colors.ReadFloats(vertex, vertexColor, 4);
+    }
+    for (uint32_t c = 0; c < 4; ++c)
+    {
+        color[c] = vertexColor[c] * primitive.baseColor[c];
+    }
+}
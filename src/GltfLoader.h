@@ -0,0 +1,141 @@
+#pragma once
+
+#include "GeometryStreams.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class MappedFile;
+class ThreadPool;
+
+// glTF 2.0 loader (.gltf with external or data URI buffers, and .glb).
+//
+// Buffers are memory mapped (the BIN chunk of a .glb is a range of the mapped file) and accessors are returned as
+// views into them, so that data already in the GPU format (float3 positions, uint16/uint32 indices) can be uploaded
+// without a copy. Only data URIs are decoded into memory owned by the scene.
+//
+// Every triangle primitive of a mesh is listed separately, the node hierarchy of the default scene is flattened
+// into one instance per node with a mesh. The world transforms are computed level by level on a ThreadPool.
+// Materials other than the base color factor, textures, skins, morph targets and cameras are ignored.
+//
+// This module has no Direct3D12 dependency.
+
+enum class GltfComponentType : uint32_t
+{
+    Int8 = 5120,
+    UInt8 = 5121,
+    Int16 = 5122,
+    UInt16 = 5123,
+    UInt32 = 5125,
+    Float = 5126,
+};
+
+// View of an accessor in a loaded buffer, the data is not copied
+struct GltfAccessorView
+{
+    const uint8_t* data = nullptr;      // first element, nullptr if the attribute is absent
+    uint32_t count = 0;
+    uint32_t stride = 0;                // bytes between elements
+    GltfComponentType componentType = GltfComponentType::Float;
+    uint32_t numComponents = 0;         // 1 for SCALAR, n for VECn
+    bool normalized = false;
+
+    bool IsPresent() const { return data != nullptr; }
+    uint32_t GetElementSize() const;
+    bool IsTightlyPacked() const { return stride == GetElementSize(); }
+    bool Is(GltfComponentType type, uint32_t components) const { return componentType == type && numComponents == components; }
+
+    // Read the first numValues components of element index as floats, normalized integers map to [0, 1] or [-1, 1]
+    void ReadFloats(uint32_t index, float* values, uint32_t numValues) const;
+
+    // Read element index of a SCALAR integer accessor
+    uint32_t ReadIndex(uint32_t index) const;
+};
+
+struct GltfPrimitive
+{
+    uint32_t meshIndex;
+    GltfAccessorView positions;     // VEC3 float
+    GltfAccessorView normals;       // VEC3 float, optional
+    GltfAccessorView colors;        // COLOR_0, VEC3 or VEC4, optional
+    GltfAccessorView indices;       // optional, non-indexed primitives are triangle lists of the positions
+    float baseColor[4];             // baseColorFactor of the material
+    float boundsMin[3];             // object space bounds of the positions
+    float boundsMax[3];
+};
+
+struct GltfMesh
+{
+    std::string name;
+    uint32_t firstPrimitive;
+    uint32_t numPrimitives;
+};
+
+// A node referencing a mesh, the transform is the row-major 3x4 object to world matrix
+struct GltfInstance
+{
+    uint32_t meshIndex;
+    float transform[3][4];
+};
+
+struct GltfLoadStats
+{
+    uint64_t fileSize;
+    uint64_t bufferSize;            // bytes of all buffers
+    uint64_t copiedBufferSize;      // bytes decoded from data URIs
+    uint32_t numNodes;
+    uint32_t numMeshes;
+    uint32_t numPrimitives;
+    uint32_t numSkippedPrimitives;  // non-triangle modes, sparse or invalid accessors
+    uint32_t numInstances;
+    uint32_t hierarchyDepth;
+    double mapMilliseconds;
+    double parseMilliseconds;       // JSON
+    double flattenMilliseconds;     // world transforms of the nodes
+};
+
+class GltfScene
+{
+public:
+    GltfScene();
+    ~GltfScene();
+
+    GltfScene(const GltfScene&) = delete;
+    GltfScene& operator=(const GltfScene&) = delete;
+
+    // Load a .gltf or .glb file. The accessor views stay valid until the scene is destroyed or loaded again.
+    bool Load(const char* path, ThreadPool& threadPool, GltfLoadStats* stats = nullptr);
+
+    const std::vector<GltfMesh>& GetMeshes() const { return m_meshes; }
+    const std::vector<GltfPrimitive>& GetPrimitives() const { return m_primitives; }
+    const std::vector<GltfInstance>& GetInstances() const { return m_instances; }
+
+    // The .gltf/.glb file and the external buffer files the scene was loaded from
+    const std::vector<std::string>& GetFilePaths() const { return m_filePaths; }
+
+private:
+    struct Buffer
+    {
+        const uint8_t* data;
+        uint64_t size;
+    };
+
+    // Mapped .glb/.gltf and external buffer files, and buffers decoded from data URIs
+    std::vector<std::unique_ptr<MappedFile>> m_files;
+    std::vector<std::string> m_filePaths;
+    std::vector<std::vector<uint8_t>> m_decodedBuffers;
+    std::vector<Buffer> m_buffers;
+
+    std::vector<GltfMesh> m_meshes;
+    std::vector<GltfPrimitive> m_primitives;
+    std::vector<GltfInstance> m_instances;
+};
+
+// Convert a primitive into AoS vertices and 32-bit indices, for the data which cannot be uploaded as it is.
+// Primitives without normals get area weighted normals.
+void ConvertGltfPrimitive(const GltfPrimitive& primitive, std::vector<GeometrySourceVertex>& vertices, std::vector<uint32_t>& indices);
+
+// COLOR_0 of a vertex multiplied by the base color factor
+void GetGltfVertexColor(const GltfPrimitive& primitive, uint32_t vertex, float color[4]);
@@ -0,0 +1,121 @@
+#include "Hash.h"
+#include "ThreadPool.h"
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    const uint64_t PRIME1 = 0x9E3779B185EBCA87ull;
+    const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4Full;
+    const uint64_t PRIME3 = 0x165667B19E3779F9ull;
+    const uint64_t PRIME4 = 0x85EBCA77C2B2AE63ull;
+    const uint64_t PRIME5 = 0x27D4EB2F165667C5ull;
+
+    // Block size of Hash64Parallel, large enough to amortize the task overhead
+    const size_t PARALLEL_BLOCK_SIZE = 4 * 1024 * 1024;
+
+    inline uint64_t RotateLeft(uint64_t value, uint32_t count)
+    {
+        return (value << count) | (value >> (64 - count));
+    }
+
+    inline uint64_t Read64(const uint8_t* p)
+    {
+        uint64_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline uint32_t Read32(const uint8_t* p)
+    {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline uint64_t Round(uint64_t accumulator, uint64_t input)
+    {
+        accumulator += input * PRIME2;
+        accumulator = RotateLeft(accumulator, 31);
+        return accumulator * PRIME1;
+    }
+
+    inline uint64_t MergeRound(uint64_t accumulator, uint64_t value)
+    {
+        accumulator ^= Round(0, value);
+        return accumulator * PRIME1 + PRIME4;
+    }
+}
+
+uint64_t Hash64(const void* data, size_t size, uint64_t seed)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    const uint8_t* end = p + size;
+
+    uint64_t hash;
+    if (size >= 32)
+    {
+        uint64_t v1 = seed + PRIME1 + PRIME2;
+        uint64_t v2 = seed + PRIME2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME1;
+        const uint8_t* limit = end - 32;
+        do
+        {
+            v1 = Round(v1, Read64(p));
+            v2 = Round(v2, Read64(p + 8));
+            v3 = Round(v3, Read64(p + 16));
+            v4 = Round(v4, Read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+        hash = MergeRound(hash, v1);
+        hash = MergeRound(hash, v2);
+        hash = MergeRound(hash, v3);
+        hash = MergeRound(hash, v4);
+    }
+    else
+    {
+        hash = seed + PRIME5;
+    }
+    hash += static_cast<uint64_t>(size);
+
+    for (; p + 8 <= end; p += 8)
+    {
+        hash ^= Round(0, Read64(p));
+        hash = RotateLeft(hash, 27) * PRIME1 + PRIME4;
+    }
+    if (p + 4 <= end)
+    {
+        hash ^= static_cast<uint64_t>(Read32(p)) * PRIME1;
+        hash = RotateLeft(hash, 23) * PRIME2 + PRIME3;
+        p += 4;
+    }
+    for (; p < end; ++p)
+    {
+        hash ^= (*p) * PRIME5;
+        hash = RotateLeft(hash, 11) * PRIME1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+uint64_t Hash64Parallel(const void* data, size_t size, ThreadPool& threadPool, uint64_t seed)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    const uint32_t numBlocks = static_cast<uint32_t>((size + PARALLEL_BLOCK_SIZE - 1) / PARALLEL_BLOCK_SIZE);
+    std::vector<uint64_t> blockHashes(numBlocks);
+    threadPool.ParallelFor(numBlocks, [&](uint32_t block)
+    {
+        const size_t offset = static_cast<size_t>(block) * PARALLEL_BLOCK_SIZE;
+        const size_t blockSize = size - offset < PARALLEL_BLOCK_SIZE ? size - offset : PARALLEL_BLOCK_SIZE;
+        blockHashes[block] = Hash64(bytes + offset, blockSize, seed);
+    });
+    return HashCombine(Hash64(blockHashes.data(), blockHashes.size() * sizeof(uint64_t), seed), static_cast<uint64_t>(size));
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class ThreadPool;
+
+// 64-bit non-cryptographic content hashes (xxHash64) used to identify scene sources and cached data.
+//
+// This module has no Direct3D12 dependency.
+
+uint64_t Hash64(const void* data, size_t size, uint64_t seed = 0);
+
+// Hash of large data computed on a ThreadPool. The data is hashed in fixed size blocks whose hashes are combined in
+// order, so the result does not depend on the number of threads (but differs from Hash64 of the same data).
+uint64_t Hash64Parallel(const void* data, size_t size, ThreadPool& threadPool, uint64_t seed = 0);
+
+// Combine a value into a hash, for hashing a few fields without a buffer
+inline uint64_t HashCombine(uint64_t hash, uint64_t value)
+{
+    return Hash64(&value, sizeof(value), hash);
+}
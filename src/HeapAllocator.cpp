@@ -0,0 +1,346 @@
+#include "HeapAllocator.h"
+#include "AllocationTrace.h"
+#include "PlatformHelpers.h"
+#include <algorithm>
+#include <bit>
+#include <format>
+#include <cassert>
+
+
+HeapAllocator::HeapAllocator(uint32_t numElements, uint32_t elementSize, uint32_t alignment, const char *allocatorName, bool outputDebugStringLogs)
+{
+    m_numElements = numElements;
+    m_elementSize = elementSize;
+    m_alignment = alignment;
+    m_outputDebugStringLogs = outputDebugStringLogs;
+
+    const uint64_t totalSize = static_cast<uint64_t>(numElements) * elementSize;
+    m_alignedSize = static_cast<uint32_t>(AlignSize(totalSize, m_alignment));
+
+    // Initialize memory management structures
+    auto blockIt = m_blocks.emplace(m_blocks.end());
+    blockIt->offset = 0;
+    blockIt->size = m_alignedSize;
+    blockIt->isFree = true;
+
+    // Add to lookup maps
+    m_blockByOffset[0] = blockIt;
+    m_freeBlocksBySizeMap.emplace(m_alignedSize, blockIt);
+
+    if (allocatorName) {
+        m_allocatorName = allocatorName;
+    }
+    else {
+        m_allocatorName = "Unnamed HeapAllocator";
+    }
+
+    // Register to the allocation trace if it is being recorded
+    AllocationTraceRecorder& traceRecorder = AllocationTraceRecorder::Instance();
+    if (traceRecorder.IsRecording())
+    {
+        m_traceHeapId = traceRecorder.RegisterHeap(m_allocatorName, m_alignedSize, m_alignment);
+    }
+}
+
+HeapAllocator::~HeapAllocator()
+{
+    // output warning if there are any allocations
+    if (m_allocations.size() > 0)
+    {
+        OutputDebugStringLog("Warning - there are still allocations");
+    }
+    // show some detailed information about the left allocations
+    for (const auto& allocation : m_allocations)
+    {
+        OutputDebugStringLog(std::format("Allocation - offset={}, size={}\n", allocation.first, allocation.second.size).c_str());
+    }
+}
+
+uint32_t HeapAllocator::Allocate(uint32_t allocationSize)
+{
+    auto FindBestFitBlock = [this](uint32_t size) -> std::list<Block>::iterator
+    {
+        // Find the smallest free block that can fit the requested size - O(log n)
+        auto it = m_freeBlocksBySizeMap.lower_bound(size);
+        if (it != m_freeBlocksBySizeMap.end())
+        {
+            return it->second;
+        }
+        return m_blocks.end();
+    };
+
+    auto SplitBlock = [this](std::list<Block>::iterator blockIt, uint32_t size)
+    {
+        // Create new free block for the remaining space
+        auto newBlockIt = m_blocks.emplace(std::next(blockIt));
+        newBlockIt->offset = blockIt->offset + size;
+        newBlockIt->size = blockIt->size - size;
+        newBlockIt->isFree = true;
+
+        // Resize current block
+        blockIt->size = size;
+
+        // Add new block to lookup map
+        m_blockByOffset[newBlockIt->offset] = newBlockIt;
+
+        // Add new block to free blocks map
+        m_freeBlocksBySizeMap.emplace(newBlockIt->size, newBlockIt);
+    };
+
+    // Sample the latency of every LATENCY_SAMPLE_INTERVAL-th call
+    const bool sampleLatency = (m_numAllocateCalls++ % LATENCY_SAMPLE_INTERVAL) == 0;
+    const std::chrono::steady_clock::time_point startTime = sampleLatency ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+
+    const uint32_t alignedSize = static_cast<uint32_t>(AlignSize(allocationSize, m_alignment));
+
+    // Find best fit block
+    auto blockIt = FindBestFitBlock(alignedSize);
+    if (blockIt == m_blocks.end())
+    {
+        m_failedAllocations++;
+        OutputDebugStringLog(std::format("Allocation failed - no suitable block found for {} bytes\n", alignedSize).c_str());
+        if (m_traceHeapId != INVALID_OFFSET)
+        {
+            AllocationTraceRecorder::Instance().Record(AllocationTraceEventType::AllocateFailed, m_traceHeapId, allocationSize, INVALID_OFFSET);
+        }
+        return INVALID_OFFSET;
+    }
+
+    uint32_t allocOffset = blockIt->offset;
+
+    // Remove from free blocks map before modification
+    RemoveFromFreeMap(blockIt);
+
+    // Split block if necessary
+    if (blockIt->size > alignedSize)
+    {
+        SplitBlock(blockIt, alignedSize);
+    }
+
+    // Mark block as allocated
+    blockIt->isFree = false;
+
+    // Add to allocations map
+    AllocationInfo allocInfo;
+    allocInfo.offset = allocOffset;
+    allocInfo.size = alignedSize;
+    allocInfo.blockIt = blockIt;
+    m_allocations[allocOffset] = allocInfo;
+
+    // Update statistics
+    m_usedSize += alignedSize;
+    m_peakUsedSize = std::max(m_peakUsedSize, m_usedSize);
+    m_totalAllocations++;
+    const uint32_t histogramBucket = alignedSize > 0 ? static_cast<uint32_t>(std::bit_width(alignedSize)) - 1 : 0;
+    m_sizeHistogram[histogramBucket]++;
+
+    if (sampleLatency)
+    {
+        RecordAllocateLatency(startTime);
+    }
+
+    OutputDebugStringLog(std::format("Allocated {} bytes at internal offset {}\n",
+        alignedSize, allocOffset).c_str());
+
+    if (m_traceHeapId != INVALID_OFFSET)
+    {
+        AllocationTraceRecorder::Instance().Record(AllocationTraceEventType::Allocate, m_traceHeapId, allocationSize, allocOffset);
+    }
+
+    return allocOffset;
+}
+
+void HeapAllocator::Free(uint32_t offset)
+{
+    if (offset == INVALID_OFFSET)
+    {
+        return;
+    }
+
+    // Find allocation - O(log n)
+    auto allocIt = m_allocations.find(offset);
+    if (allocIt == m_allocations.end())
+    {
+        OutputDebugStringLog(std::format("Free failed - no allocation found at offset {}\n", offset).c_str(), true);
+        assert(false);
+        return;
+    }
+
+    // Get block iterator from allocation info - O(1)
+    auto blockIt = allocIt->second.blockIt;
+
+    // Mark block as free
+    blockIt->isFree = true;
+
+    // Remove from allocations
+    m_allocations.erase(allocIt);
+
+    // Update statistics
+    m_usedSize -= blockIt->size;
+    m_totalFrees++;
+
+    OutputDebugStringLog(std::format("Freed {} bytes at offset {}\n", blockIt->size, offset).c_str());
+
+    if (m_traceHeapId != INVALID_OFFSET)
+    {
+        AllocationTraceRecorder::Instance().Record(AllocationTraceEventType::Free, m_traceHeapId, blockIt->size, offset);
+    }
+
+    // Coalesce only with adjacent blocks - O(1)
+    CoalesceAdjacentFreeBlocks(blockIt);
+}
+
+HeapAllocationStats HeapAllocator::GetStats() const
+{
+    HeapAllocationStats stats = {};
+    stats.totalSize = static_cast<size_t>(static_cast<uint64_t>(m_numElements) * m_elementSize);
+    stats.usedSize = static_cast<size_t>(m_usedSize);
+    stats.numAllocations = m_allocations.size();
+
+    // The free block index is sorted by size, so the largest free block is the last entry
+    stats.numFreeBlocks = m_freeBlocksBySizeMap.size();
+    if (!m_freeBlocksBySizeMap.empty())
+    {
+        stats.largestFreeBlock = m_freeBlocksBySizeMap.rbegin()->first;
+    }
+
+    // Calculate fragmentation ratio
+    if (stats.totalSize > stats.usedSize && stats.largestFreeBlock > 0)
+    {
+        size_t freeSpace = stats.totalSize - stats.usedSize;
+        stats.fragmentationRatio = std::max(0.0f, 1.0f - (static_cast<float>(stats.largestFreeBlock) / static_cast<float>(freeSpace)));
+    }
+
+    stats.peakUsedSize = static_cast<size_t>(m_peakUsedSize);
+    stats.totalAllocations = m_totalAllocations;
+    stats.totalFrees = m_totalFrees;
+    stats.failedAllocations = m_failedAllocations;
+    stats.sizeHistogram = m_sizeHistogram;
+
+    stats.numLatencySamples = m_numLatencySamples;
+    stats.maxAllocateLatencyNs = m_maxAllocateLatencyNs;
+    if (m_numLatencySamples > 0)
+    {
+        stats.averageAllocateLatencyNs = static_cast<double>(m_totalAllocateLatencyNs) / static_cast<double>(m_numLatencySamples);
+    }
+
+    return stats;
+}
+
+void HeapAllocator::GetOccupancyMap(uint32_t numCells, std::vector<float>& occupancy) const
+{
+    occupancy.assign(numCells, 0.0f);
+    if (numCells == 0 || m_alignedSize == 0)
+    {
+        return;
+    }
+
+    const double cellSize = static_cast<double>(m_alignedSize) / static_cast<double>(numCells);
+    for (const auto& block : m_blocks)
+    {
+        if (block.isFree)
+        {
+            continue;
+        }
+
+        // Spread the block over the cells it overlaps
+        const double blockBegin = static_cast<double>(block.offset);
+        const double blockEnd = blockBegin + static_cast<double>(block.size);
+        uint32_t cell = static_cast<uint32_t>(blockBegin / cellSize);
+        for (; cell < numCells; ++cell)
+        {
+            const double cellBegin = cell * cellSize;
+            const double cellEnd = cellBegin + cellSize;
+            if (cellBegin >= blockEnd)
+            {
+                break;
+            }
+            const double overlap = std::min(cellEnd, blockEnd) - std::max(cellBegin, blockBegin);
+            occupancy[cell] += static_cast<float>(overlap / cellSize);
+        }
+    }
+
+    for (float& value : occupancy)
+    {
+        value = std::min(value, 1.0f);
+    }
+}
+
+void HeapAllocator::OutputDebugStringLog(const char *message, bool forceOutput)
+{
+    if (m_outputDebugStringLogs || forceOutput)
+    {
+        OutputDebugStringA(std::format("{}: {}\n", m_allocatorName, message).c_str());
+    }
+}
+
+void HeapAllocator::CoalesceAdjacentFreeBlocks(std::list<Block>::iterator freedBlockIt)
+{
+    // Try to merge with previous block
+    if (freedBlockIt != m_blocks.begin())
+    {
+        auto prevIt = std::prev(freedBlockIt);
+        if (prevIt->isFree && prevIt->offset + prevIt->size == freedBlockIt->offset)
+        {
+            // Remove prev block from free map
+            RemoveFromFreeMap(prevIt);
+
+            // Merge into previous block
+            prevIt->size += freedBlockIt->size;
+
+            // Remove current block from lookup map
+            m_blockByOffset.erase(freedBlockIt->offset);
+
+            // Erase current block
+            m_blocks.erase(freedBlockIt);
+
+            // Continue with the merged block
+            freedBlockIt = prevIt;
+        }
+    }
+
+    // Try to merge with next block
+    auto nextIt = std::next(freedBlockIt);
+    if (nextIt != m_blocks.end())
+    {
+        if (nextIt->isFree && freedBlockIt->offset + freedBlockIt->size == nextIt->offset)
+        {
+            // Remove next block from free map
+            RemoveFromFreeMap(nextIt);
+
+            // Merge into current block
+            freedBlockIt->size += nextIt->size;
+
+            // Remove next block from lookup map
+            m_blockByOffset.erase(nextIt->offset);
+
+            // Erase next block
+            m_blocks.erase(nextIt);
+        }
+    }
+
+    // Add the (possibly merged) block to free map
+    m_freeBlocksBySizeMap.emplace(freedBlockIt->size, freedBlockIt);
+}
+
+void HeapAllocator::RecordAllocateLatency(std::chrono::steady_clock::time_point startTime)
+{
+    const uint64_t latencyNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count());
+    m_numLatencySamples++;
+    m_totalAllocateLatencyNs += latencyNs;
+    m_maxAllocateLatencyNs = std::max(m_maxAllocateLatencyNs, latencyNs);
+}
+
+void HeapAllocator::RemoveFromFreeMap(std::list<Block>::iterator blockIt)
+{
+    // Optimized removal using hint from block size
+    auto range = m_freeBlocksBySizeMap.equal_range(blockIt->size);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (it->second == blockIt)
+        {
+            m_freeBlocksBySizeMap.erase(it);
+            break;
+        }
+    }
+}
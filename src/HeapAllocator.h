@@ -0,0 +1,131 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+// Number of log2 buckets of the allocation size histogram (bucket i counts sizes in [2^i, 2^(i+1)))
+static constexpr uint32_t HEAP_ALLOCATION_SIZE_HISTOGRAM_BUCKETS = 32;
+
+// Get allocation statistics
+struct HeapAllocationStats {
+    size_t totalSize;
+    size_t usedSize;
+    size_t largestFreeBlock;
+    size_t numAllocations;
+    size_t numFreeBlocks;
+    float fragmentationRatio;  // 0.0 = no fragmentation, 1.0 = heavily fragmented
+
+    // Telemetry since the allocator was created
+    size_t peakUsedSize;
+    uint64_t totalAllocations;
+    uint64_t totalFrees;
+    uint64_t failedAllocations;
+    std::array<uint64_t, HEAP_ALLOCATION_SIZE_HISTOGRAM_BUCKETS> sizeHistogram;   // aligned allocation sizes
+
+    // Allocate() latency, sampled once every HeapAllocator::LATENCY_SAMPLE_INTERVAL calls
+    uint64_t numLatencySamples;
+    double averageAllocateLatencyNs;
+    uint64_t maxAllocateLatencyNs;
+};
+
+// Best-fit suballocator used by HeapManager and ReadbackHeapManager.
+// This class has no Direct3D12 dependency so that the allocation trace replay tool can use it as a backend.
+class HeapAllocator
+{
+public:
+    // Returned by Allocate() when there is no suitable free block
+    static constexpr uint32_t INVALID_OFFSET = static_cast<uint32_t>(-1);
+
+    // Allocate() is timed once every LATENCY_SAMPLE_INTERVAL calls to keep clock reads off the common path
+    static constexpr uint32_t LATENCY_SAMPLE_INTERVAL = 64;
+
+    // Initialize the heap allocator
+    HeapAllocator(uint32_t numElements, uint32_t elementSize, uint32_t alignment, const char *allocatorName = nullptr, bool outputDebugStringLogs = false);
+    ~HeapAllocator();
+
+    // suballocate memory from the heap
+    uint32_t Allocate(uint32_t allocationSize);
+
+    // free memory from the heap
+    void Free(uint32_t offset);
+
+    // O(1), the counters are maintained by Allocate() and Free()
+    HeapAllocationStats GetStats() const;
+
+    // Fill occupancy[i] with the used fraction (0..1) of the i-th of numCells equally sized ranges of the heap.
+    // This walks every block, so it is meant for visualization and snapshots rather than per allocation use.
+    void GetOccupancyMap(uint32_t numCells, std::vector<float>& occupancy) const;
+
+    // Element size
+    uint32_t ElementSize() const { return m_elementSize; }
+
+    // Aligned size
+    uint32_t AlignedSize() const { return m_alignedSize; }
+
+    // Allocator name
+    std::string AllocatorName() const { return m_allocatorName; }
+
+private:
+    // Enhanced memory block structure with bidirectional links
+    struct Block {
+        uint32_t offset;
+        uint32_t size;
+        bool isFree;
+    };
+
+    // Enhanced allocation info structure
+    struct AllocationInfo {
+        uint32_t offset;
+        uint32_t size;
+        std::list<Block>::iterator blockIt;  // Direct iterator to the block
+    };
+
+    // Number of elements
+    uint32_t m_numElements = {};
+
+    // Element size
+    uint32_t m_elementSize = {};
+
+    // Alignment
+    uint32_t m_alignment = {};
+
+    // Aligned size
+    uint32_t m_alignedSize = {};
+
+    // Output debug string logs
+    bool m_outputDebugStringLogs = false;
+
+    // Allocator name
+    std::string m_allocatorName;
+
+    // Heap id in the allocation trace, or INVALID_OFFSET when the trace is not recorded
+    uint32_t m_traceHeapId = INVALID_OFFSET;
+
+    // Optimized memory management structures
+    std::list<Block> m_blocks;                                          // All blocks (always sorted by offset)
+    std::map<uint32_t, std::list<Block>::iterator> m_blockByOffset;    // O(1) block lookup by offset
+    std::multimap<uint32_t, std::list<Block>::iterator> m_freeBlocksBySizeMap;  // Free blocks sorted by size
+    std::map<uint32_t, AllocationInfo> m_allocations;                  // Active allocations by offset
+
+    // Incremental statistics
+    uint64_t m_usedSize = 0;
+    uint64_t m_peakUsedSize = 0;
+    uint64_t m_totalAllocations = 0;
+    uint64_t m_totalFrees = 0;
+    uint64_t m_failedAllocations = 0;
+    uint64_t m_numAllocateCalls = 0;
+    std::array<uint64_t, HEAP_ALLOCATION_SIZE_HISTOGRAM_BUCKETS> m_sizeHistogram = {};
+    uint64_t m_numLatencySamples = 0;
+    uint64_t m_totalAllocateLatencyNs = 0;
+    uint64_t m_maxAllocateLatencyNs = 0;
+
+    void OutputDebugStringLog(const char *message, bool forceOutput = false);
+    void CoalesceAdjacentFreeBlocks(std::list<Block>::iterator freedBlockIt);
+    void RemoveFromFreeMap(std::list<Block>::iterator blockIt);
+    void RecordAllocateLatency(std::chrono::steady_clock::time_point startTime);
+};
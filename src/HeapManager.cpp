@@ -1,313 +1,12 @@
 #include "HeapManager.h"
 #include "Helper.h"
+#include "HeapRegistry.h"
 #include <algorithm>
 #include <format>
 #include <cassert>
 
-
-class HeapAllocator
-{
-public:
-    // Initialize the heap allocator
-    HeapAllocator(uint32_t numElements, uint32_t elementSize, uint32_t alignment, const char *allocatorName = nullptr, bool outputDebugStringLogs = false)
-    {
-        m_numElements = numElements;
-        m_elementSize = elementSize;
-        m_alignment = alignment; 
-        m_outputDebugStringLogs = outputDebugStringLogs;
-
-        const uint64_t totalSize = static_cast<uint64_t>(numElements) * elementSize;
-        m_alignedSize = static_cast<uint32_t>(AlignSize(totalSize, m_alignment));
-    
-        // Initialize memory management structures
-        auto blockIt = m_blocks.emplace(m_blocks.end());
-        blockIt->offset = 0;
-        blockIt->size = m_alignedSize;
-        blockIt->isFree = true;
-        
-        // Add to lookup maps
-        m_blockByOffset[0] = blockIt;
-        m_freeBlocksBySizeMap.emplace(m_alignedSize, blockIt);
-
-        if (allocatorName) {
-            m_allocatorName = allocatorName;
-        }
-        else {
-            m_allocatorName = "Unnamed HeapAllocator";
-        }
-    }
-
-    ~HeapAllocator()
-    {
-        // output warning if there are any allocations
-        if (m_allocations.size() > 0)
-        {
-            OutputDebugStringLog("Warning - there are still allocations");
-        }
-        // show some detailed information about the left allocations
-        for (const auto& allocation : m_allocations)
-        {
-            OutputDebugStringLog(std::format("Allocation - offset={}, size={}\n", allocation.first, allocation.second.size).c_str());
-        }
-    }
-
-    // suballocate memory from the heap
-    uint32_t Allocate(uint32_t allocationSize)
-    {
-        auto FindBestFitBlock = [this](uint32_t size) -> std::list<Block>::iterator
-        {
-            // Find the smallest free block that can fit the requested size - O(log n)
-            auto it = m_freeBlocksBySizeMap.lower_bound(size);
-            if (it != m_freeBlocksBySizeMap.end())
-            {
-                return it->second;
-            }
-            return m_blocks.end();
-        };
-
-        auto SplitBlock = [this](std::list<Block>::iterator blockIt, uint32_t size)
-        {
-            // Create new free block for the remaining space
-            auto newBlockIt = m_blocks.emplace(std::next(blockIt));
-            newBlockIt->offset = blockIt->offset + size;
-            newBlockIt->size = blockIt->size - size;
-            newBlockIt->isFree = true;
-           
-            // Resize current block
-            blockIt->size = size;
-            
-            // Add new block to lookup map
-            m_blockByOffset[newBlockIt->offset] = newBlockIt;
-            
-            // Add new block to free blocks map
-            m_freeBlocksBySizeMap.emplace(newBlockIt->size, newBlockIt);
-        };
-
-        const uint32_t alignedSize = static_cast<uint32_t>(AlignSize(allocationSize, m_alignment));
-
-        // Find best fit block
-        auto blockIt = FindBestFitBlock(alignedSize);
-        if (blockIt == m_blocks.end())
-        {
-            OutputDebugStringLog(std::format("Allocation failed - no suitable block found for {} bytes\n", alignedSize).c_str());
-            return (uint32_t)-1;
-        }
-        
-        uint32_t allocOffset = blockIt->offset;
-        
-        // Remove from free blocks map before modification
-        RemoveFromFreeMap(blockIt);
-        
-        // Split block if necessary
-        if (blockIt->size > alignedSize)
-        {
-            SplitBlock(blockIt, alignedSize);
-        }
-        
-        // Mark block as allocated
-        blockIt->isFree = false;
-        
-        // Add to allocations map
-        AllocationInfo allocInfo;
-        allocInfo.offset = allocOffset;
-        allocInfo.size = alignedSize;
-        allocInfo.blockIt = blockIt;
-        m_allocations[allocOffset] = allocInfo;
-    
-        OutputDebugStringLog(std::format("Allocated {} bytes at internal offset {}\n", 
-            alignedSize, allocOffset).c_str());
-    
-        return allocOffset;
-    }
-    
-    // free memory from the heap
-    void Free(uint32_t offset)
-    {
-        if (offset == (uint32_t)-1)
-        {
-            return;
-        }
-        
-        // Find allocation - O(log n)
-        auto allocIt = m_allocations.find(offset);
-        if (allocIt == m_allocations.end())
-        {
-            OutputDebugStringLog(std::format("Free failed - no allocation found at offset {}\n", offset).c_str(), true);
-            assert(false);
-            return;
-        }
-        
-        // Get block iterator from allocation info - O(1)
-        auto blockIt = allocIt->second.blockIt;
-        
-        // Mark block as free
-        blockIt->isFree = true;
-        
-        // Remove from allocations
-        m_allocations.erase(allocIt);
-
-        OutputDebugStringLog(std::format("Freed {} bytes at offset {}\n", blockIt->size, offset).c_str());
-
-        // Coalesce only with adjacent blocks - O(1)
-        CoalesceAdjacentFreeBlocks(blockIt);        
-    }
-
-    HeapAllocationStats GetStats() const
-    {
-        HeapAllocationStats stats = {};
-        stats.totalSize = m_numElements * m_elementSize;
-        stats.numAllocations = m_allocations.size();
-        
-        for (const auto& block : m_blocks)
-        {
-            if (!block.isFree)
-            {
-                stats.usedSize += block.size;
-            }
-            else
-            {
-                stats.numFreeBlocks++;
-                stats.largestFreeBlock = std::max(stats.largestFreeBlock, static_cast<size_t>(block.size));
-            }
-        }
-        
-        // Calculate fragmentation ratio
-        if (stats.totalSize > stats.usedSize && stats.largestFreeBlock > 0)
-        {
-            size_t freeSpace = stats.totalSize - stats.usedSize;
-            stats.fragmentationRatio = 1.0f - (static_cast<float>(stats.largestFreeBlock) / static_cast<float>(freeSpace));
-        }
-       
-        return stats;
-    }
-
-    // Element size
-    uint32_t ElementSize() const { return m_elementSize; }
-
-    // Aligned size
-    uint32_t AlignedSize() const { return m_alignedSize; }
-
-    // Allocator name
-    std::string AllocatorName() const { return m_allocatorName; }
-
-private:
-    // Enhanced memory block structure with bidirectional links
-    struct Block {
-        uint32_t offset;
-        uint32_t size;
-        bool isFree;
-    };
-
-    // Enhanced allocation info structure
-    struct AllocationInfo {
-        uint32_t offset;
-        uint32_t size;
-        std::list<Block>::iterator blockIt;  // Direct iterator to the block
-    };
-   
-    // Number of elements
-    uint32_t m_numElements = {};
-    
-    // Element size
-    uint32_t m_elementSize = {};
-
-    // Alignment
-    uint32_t m_alignment = {};
-
-    // Aligned size
-    uint32_t m_alignedSize = {};
-
-    // Output debug string logs
-    bool m_outputDebugStringLogs = false;
-
-    // Allocator name
-    std::string m_allocatorName;
-
-    // Optimized memory management structures
-    std::list<Block> m_blocks;                                          // All blocks (always sorted by offset)
-    std::map<uint32_t, std::list<Block>::iterator> m_blockByOffset;    // O(1) block lookup by offset
-    std::multimap<uint32_t, std::list<Block>::iterator> m_freeBlocksBySizeMap;  // Free blocks sorted by size
-    std::map<uint32_t, AllocationInfo> m_allocations;                  // Active allocations by offset
-   
-    void OutputDebugStringLog(const char *message, bool forceOutput = false)
-    {
-        if (m_outputDebugStringLogs || forceOutput)
-        {
-            OutputDebugStringA(std::format("{}: {}\n", m_allocatorName, message).c_str());
-        }
-    }
-
-    void CoalesceAdjacentFreeBlocks(std::list<Block>::iterator freedBlockIt)
-    {
-        // Try to merge with previous block
-        if (freedBlockIt != m_blocks.begin())
-        {
-            auto prevIt = std::prev(freedBlockIt);
-            if (prevIt->isFree && prevIt->offset + prevIt->size == freedBlockIt->offset)
-            {
-                // Remove prev block from free map
-                RemoveFromFreeMap(prevIt);
-                
-                // Merge into previous block
-                prevIt->size += freedBlockIt->size;
-
-                // Remove current block from lookup map
-                m_blockByOffset.erase(freedBlockIt->offset);
-                
-                // Erase current block
-                m_blocks.erase(freedBlockIt);
-                
-                // Continue with the merged block
-                freedBlockIt = prevIt;
-            }
-        }
-        
-        // Try to merge with next block
-        auto nextIt = std::next(freedBlockIt);
-        if (nextIt != m_blocks.end())
-        {
-            if (nextIt->isFree && freedBlockIt->offset + freedBlockIt->size == nextIt->offset)
-            {
-                // Remove next block from free map
-                RemoveFromFreeMap(nextIt);
-
-                // Merge into current block
-                freedBlockIt->size += nextIt->size;
-
-                // Remove next block from lookup map
-                m_blockByOffset.erase(nextIt->offset);
-                
-                // Erase next block
-                m_blocks.erase(nextIt);
-            }
-        }
-        
-        // Add the (possibly merged) block to free map
-        m_freeBlocksBySizeMap.emplace(freedBlockIt->size, freedBlockIt);
-    }
-    
-    void RemoveFromFreeMap(std::list<Block>::iterator blockIt)
-    {
-        // Optimized removal using hint from block size
-        auto range = m_freeBlocksBySizeMap.equal_range(blockIt->size);
-        for (auto it = range.first; it != range.second; ++it)
-        {
-            if (it->second == blockIt)
-            {
-                m_freeBlocksBySizeMap.erase(it);
-                break;
-            }
-        }
-    }
-    
-};
-
-
-
-
-
-
 HeapManager::HeapManager() :
+    m_registryId(HeapRegistry::INVALID_ID),
     m_device(nullptr),
     m_isGPUUploadHeapIsSupported(false),
     m_isManualWriteTrackingResourceSupported(false),
@@ -322,6 +21,8 @@ HeapManager::HeapManager() :
 
 HeapManager::~HeapManager()
 {
+    HeapRegistry::Instance().Unregister(m_registryId);
+
     if (m_mappedPtr && m_resource)
     {
         m_resource->Unmap(0, nullptr);
@@ -441,13 +142,41 @@ void HeapManager::Initialize(ID3D12Device5* device, uint32_t numElements, uint32
     if (m_heapFlags & D3D12_HEAP_FLAG_TOOLS_USE_MANUAL_WRITE_TRACKING) {
         m_resource->QueryInterface(IID_PPV_ARGS(&m_manualWriteTrackingResource));
     }
+
+    // Register to the heap registry for the memory dashboard
+    const char* kind = "Default";
+    if (type == D3D12_HEAP_TYPE_GPU_UPLOAD)
+    {
+        kind = "GPU Upload";
+    }
+    else if (type == D3D12_HEAP_TYPE_UPLOAD)
+    {
+        kind = "Upload";
+    }
+    else if (type == D3D12_HEAP_TYPE_READBACK)
+    {
+        kind = "Readback";
+    }
+    m_registryId = HeapRegistry::Instance().Register(m_heapAllocator->AllocatorName(), kind,
+        [this]() { return GetStats(); },
+        [this](uint32_t numCells, std::vector<float>& occupancy) { GetOccupancyMap(numCells, occupancy); });
 }
 
 uint32_t HeapManager::Allocate(uint32_t allocationSize)
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    uint32_t offset = HeapAllocator::INVALID_OFFSET;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        offset = m_heapAllocator->Allocate(allocationSize);
+    }
 
-    return m_heapAllocator->Allocate(allocationSize) + RESERVED_OFFSET;
+    // The snapshot queries this heap, so it must be taken without holding the lock
+    if (offset == HeapAllocator::INVALID_OFFSET)
+    {
+        HeapRegistry::Instance().OnAllocationFailure(m_heapAllocator->AllocatorName(), allocationSize);
+    }
+
+    return offset + RESERVED_OFFSET;
 }
 
 void HeapManager::Free(uint32_t offset)
@@ -457,23 +186,61 @@ void HeapManager::Free(uint32_t offset)
     m_heapAllocator->Free(offset - RESERVED_OFFSET);
 }
 
+void HeapManager::Write(uint32_t offset, const void* data, uint32_t size)
+{
+    void* destination = GetMappedPtr(offset);
+    assert(destination);
+    if (!destination)
+    {
+        return;
+    }
+
+    // Mapped upload heaps are write-combined: stream whole lines and never read back
+    StreamCopy(destination, data, size);
+
+    D3D12_RANGE writtenRange = {};
+    writtenRange.Begin = offset - RESERVED_OFFSET;
+    writtenRange.End = writtenRange.Begin + size;
+    TrackWrite(&writtenRange);
+}
+
 void HeapManager::TrackWrite(D3D12_RANGE* pWrittenRange)
 {
     if (!m_isManualWriteTrackingResourceSupported || !pWrittenRange)
     {
         return;
     }
-    
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_writtenRanges.Add(pWrittenRange->Begin, pWrittenRange->End);
+}
+
+void HeapManager::FlushTrackedWrites()
+{
+    std::vector<WriteRangeAccumulator::Range> ranges;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ranges = m_writtenRanges.Take();
+    }
+
     // If manual write tracking is supported, we can track the written range
     // This helps with GPU debugging tools like PIX
-    if (m_manualWriteTrackingResource && m_mappedPtr) {
-        m_manualWriteTrackingResource->TrackWrite(0, pWrittenRange);
-    
-        // In a real implementation, you would accumulate written ranges
-        // and potentially call WriteToSubresource or similar
-        OutputDebugStringA(std::format("TrackWrite: Range [{}, {}]\n", 
-            pWrittenRange->Begin, pWrittenRange->End).c_str());
+    if (ranges.empty() || !m_manualWriteTrackingResource || !m_mappedPtr)
+    {
+        return;
+    }
+
+    size_t totalSize = 0;
+    for (const WriteRangeAccumulator::Range& range : ranges)
+    {
+        D3D12_RANGE writtenRange = { range.begin, range.end };
+        m_manualWriteTrackingResource->TrackWrite(0, &writtenRange);
+        totalSize += range.end - range.begin;
     }
+
+    OutputDebugStringA(std::format("{}: TrackWrite: {} ranges, {} bytes\n",
+        m_heapAllocator->AllocatorName(), ranges.size(), totalSize).c_str());
 }
 
 HeapAllocationStats HeapManager::GetStats() const
@@ -483,6 +250,13 @@ HeapAllocationStats HeapManager::GetStats() const
     return m_heapAllocator->GetStats();
 }
 
+void HeapManager::GetOccupancyMap(uint32_t numCells, std::vector<float>& occupancy) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_heapAllocator->GetOccupancyMap(numCells, occupancy);
+}
+
 void HeapManager::Transition(ID3D12GraphicsCommandList4* commandList, D3D12_RESOURCE_STATES state)
 {
     if (m_resourceState == state)
@@ -520,14 +294,18 @@ void HeapManager::UAVBarrier(ID3D12GraphicsCommandList4* commandList)
 
 
 ReadbackHeapManager::ReadbackHeapManager() :
+    m_registryId(HeapRegistry::INVALID_ID),
     m_device(nullptr),
     m_mappedPtr(nullptr),
+    m_readbackFenceValue(0),
     m_gpuVirtualAddress(0)
 {
 }
 
 ReadbackHeapManager::~ReadbackHeapManager()
 {
+    HeapRegistry::Instance().Unregister(m_registryId);
+
     if (m_mappedPtr && m_readbackResource)
     {
         m_readbackResource->Unmap(0, nullptr);
@@ -610,13 +388,31 @@ void ReadbackHeapManager::Initialize(ID3D12Device5* device, uint32_t numElements
         OutputDebugStringA(std::format("{}: Failed to get the GPU virtual address of the resource\n", m_heapAllocator->AllocatorName()).c_str());
         assert(false);
     }
+
+    ThrowIfFailed(m_device->CreateFence(m_readbackFenceValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_readbackFence)));
+    m_readbackFence->SetName(L"Readback Fence");
+
+    // Register to the heap registry for the memory dashboard
+    m_registryId = HeapRegistry::Instance().Register(m_heapAllocator->AllocatorName(), "Readback",
+        [this]() { return GetStats(); },
+        [this](uint32_t numCells, std::vector<float>& occupancy) { GetOccupancyMap(numCells, occupancy); });
 }
 
 uint32_t ReadbackHeapManager::Allocate(uint32_t allocationSize)
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    uint32_t offset = HeapAllocator::INVALID_OFFSET;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        offset = m_heapAllocator->Allocate(allocationSize);
+    }
+
+    // The snapshot queries this heap, so it must be taken without holding the lock
+    if (offset == HeapAllocator::INVALID_OFFSET)
+    {
+        HeapRegistry::Instance().OnAllocationFailure(m_heapAllocator->AllocatorName(), allocationSize);
+    }
 
-    return m_heapAllocator->Allocate(allocationSize) + RESERVED_OFFSET;
+    return offset + RESERVED_OFFSET;
 }
 
 void ReadbackHeapManager::Free(uint32_t offset)
@@ -633,8 +429,31 @@ HeapAllocationStats ReadbackHeapManager::GetStats() const
     return m_heapAllocator->GetStats();
 }
 
+void ReadbackHeapManager::GetOccupancyMap(uint32_t numCells, std::vector<float>& occupancy) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_heapAllocator->GetOccupancyMap(numCells, occupancy);
+}
+
+ReadbackQueue::Ticket ReadbackHeapManager::RequestReadback(uint32_t offset, uint32_t size, ReadbackQueue::Callback callback)
+{
+    if (offset == 0 || offset < RESERVED_OFFSET || size == 0)
+    {
+        return ReadbackQueue::INVALID_TICKET;
+    }
+
+    return m_readbackQueue.Request(offset - RESERVED_OFFSET, size, std::move(callback));
+}
+
 void ReadbackHeapManager::GPUWriteBegin(ID3D12GraphicsCommandList4* commandList)
 {
+    // Consecutive writes without readbacks in between keep the UAV state
+    if (m_resourceState == D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+    {
+        return;
+    }
+
     // Transition default resource to UAV state
     D3D12_RESOURCE_BARRIER barriers[1] = {};
     barriers[0].Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
@@ -650,6 +469,12 @@ void ReadbackHeapManager::GPUWriteBegin(ID3D12GraphicsCommandList4* commandList)
 
 void ReadbackHeapManager::GPUWriteEnd(ID3D12GraphicsCommandList4* commandList)
 {
+    const std::vector<ReadbackRegion> regions = m_readbackQueue.TakePendingRegions();
+    if (regions.empty())
+    {
+        return;
+    }
+
     // transition the default resource to copy source
     // transition the readback resource to copy dest
     {
@@ -671,8 +496,11 @@ void ReadbackHeapManager::GPUWriteEnd(ID3D12GraphicsCommandList4* commandList)
         m_readbackResourceState = D3D12_RESOURCE_STATE_COPY_DEST;
     }
 
-    // copy the default resource to the readback resource
-    commandList->CopyResource(m_readbackResource.Get(), m_resource.Get());
+    // copy only the requested regions of the default resource to the readback resource
+    for (const ReadbackRegion& region : regions)
+    {
+        commandList->CopyBufferRegion(m_readbackResource.Get(), region.offset, m_resource.Get(), region.offset, region.size);
+    }
 
     {
         D3D12_RESOURCE_BARRIER barriers[1] = {};
@@ -688,5 +516,54 @@ void ReadbackHeapManager::GPUWriteEnd(ID3D12GraphicsCommandList4* commandList)
     }
 }
 
+void ReadbackHeapManager::SubmitReadbacks(ID3D12CommandQueue* commandQueue)
+{
+    ++m_readbackFenceValue;
+    ThrowIfFailed(commandQueue->Signal(m_readbackFence.Get(), m_readbackFenceValue));
+    m_readbackQueue.Submit(m_readbackFenceValue);
+}
+
+void ReadbackHeapManager::Update()
+{
+    if (!m_readbackFence)
+    {
+        return;
+    }
 
+    m_readbackQueue.Retire(m_readbackFence->GetCompletedValue(), m_mappedPtr);
+}
 
+void ReadbackHeapManager::ResolveQueryData(ID3D12GraphicsCommandList4* commandList, ID3D12QueryHeap* queryHeap, D3D12_QUERY_TYPE type,
+    uint32_t startIndex, uint32_t numQueries, uint32_t offset)
+{
+    if (offset == 0 || offset < RESERVED_OFFSET)
+    {
+        return;
+    }
+
+    {
+        D3D12_RESOURCE_BARRIER barriers[1] = {};
+        barriers[0].Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+        barriers[0].Transition.pResource = m_readbackResource.Get();
+        barriers[0].Transition.StateBefore = m_readbackResourceState;
+        barriers[0].Transition.StateAfter = D3D12_RESOURCE_STATE_COPY_DEST;
+        barriers[0].Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+
+        commandList->ResourceBarrier(1, barriers);
+        m_readbackResourceState = D3D12_RESOURCE_STATE_COPY_DEST;
+    }
+
+    commandList->ResolveQueryData(queryHeap, type, startIndex, numQueries, m_readbackResource.Get(), offset - RESERVED_OFFSET);
+
+    {
+        D3D12_RESOURCE_BARRIER barriers[1] = {};
+        barriers[0].Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+        barriers[0].Transition.pResource = m_readbackResource.Get();
+        barriers[0].Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
+        barriers[0].Transition.StateAfter = D3D12_RESOURCE_STATE_COMMON;
+        barriers[0].Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+
+        commandList->ResourceBarrier(1, barriers);
+        m_readbackResourceState = D3D12_RESOURCE_STATE_COMMON;
+    }
+}
@@ -9,22 +9,13 @@
 #include <map>
 #include <list>
 #include <mutex>
+#include <cassert>
+#include "HeapAllocator.h"
+#include "UploadWriter.h"
+#include "ReadbackQueue.h"
 
 using Microsoft::WRL::ComPtr;
 
-// Get allocation statistics
-struct HeapAllocationStats {
-    size_t totalSize;
-    size_t usedSize;
-    size_t largestFreeBlock;
-    size_t numAllocations;
-    size_t numFreeBlocks;
-    float fragmentationRatio;  // 0.0 = no fragmentation, 1.0 = heavily fragmented
-};
-
-
-class HeapAllocator;
-
 class HeapManager
 {
 public:
@@ -50,6 +41,13 @@ public:
         return m_gpuVirtualAddress + static_cast<uint64_t>(offset - RESERVED_OFFSET); 
     }
 
+    // Get the byte offset of the allocated memory in the resource, e.g. for raw buffer views
+    uint64_t GetResourceOffset(uint32_t offset) const
+    {
+        assert(offset >= RESERVED_OFFSET);
+        return static_cast<uint64_t>(offset - RESERVED_OFFSET);
+    }
+
     // Get the mapped pointer of the allocated memory
     void *GetMappedPtr(uint32_t offset) const
         {
@@ -66,12 +64,23 @@ public:
     // This function takes the offset of the allocated element in the heap.
     void Free(uint32_t offset);
 
+    // Write data to the mapped memory of the allocation at offset with write-combining friendly stores.
+    // The written range is accumulated for TrackWrite.
+    void Write(uint32_t offset, const void* data, uint32_t size);
+
     // This is used to determine the range of the heap to give a hint for PIX or NSight.
+    // Ranges are accumulated and merged, and reported by FlushTrackedWrites().
     void TrackWrite(D3D12_RANGE* pWrittenRange);
 
+    // Report the accumulated written ranges to the tools. Call before submitting the command lists which read them.
+    void FlushTrackedWrites();
+
     // Get allocation statistics
     HeapAllocationStats GetStats() const;
 
+    // Get the used fraction of numCells equally sized ranges of the heap
+    void GetOccupancyMap(uint32_t numCells, std::vector<float>& occupancy) const;
+
 private:
     // Reserved offset
     const uint32_t RESERVED_OFFSET = 1;
@@ -82,6 +91,9 @@ private:
     // Thread safety
     mutable std::mutex m_mutex;
 
+    // Id in the HeapRegistry
+    uint32_t m_registryId;
+
     // Device reference (not owned)
     ID3D12Device5* m_device;
     
@@ -94,6 +106,9 @@ private:
     //  A heap managed by this class.
     ComPtr<ID3D12Resource>                      m_resource;
     ComPtr<ID3D12ManualWriteTrackingResource>   m_manualWriteTrackingResource;
+
+    // Written ranges not yet reported to the manual write tracking resource
+    WriteRangeAccumulator m_writtenRanges;
     
     // Heap type
     D3D12_HEAP_TYPE m_type;
@@ -151,9 +166,29 @@ public:
 
     HeapAllocationStats GetStats() const;
 
+    // Get the used fraction of numCells equally sized ranges of the heap
+    void GetOccupancyMap(uint32_t numCells, std::vector<float>& occupancy) const;
+
+    // Request a readback of size bytes of the allocation at offset. The copy is recorded by the next GPUWriteEnd()
+    // and the ticket resolves, invoking the callback with the mapped data, once Update() sees its fence completed.
+    ReadbackQueue::Ticket RequestReadback(uint32_t offset, uint32_t size, ReadbackQueue::Callback callback = {});
+
     void GPUWriteBegin(ID3D12GraphicsCommandList4* commandList);
+
+    // Copy the regions of the pending readback requests, merged where they overlap or touch, to the readback resource
     void GPUWriteEnd(ID3D12GraphicsCommandList4* commandList);
 
+    // Signal the readback fence on the queue which executes the command lists recorded by GPUWriteEnd()
+    void SubmitReadbacks(ID3D12CommandQueue* commandQueue);
+
+    // Resolve the readbacks whose fence has completed. This never waits for the GPU.
+    void Update();
+
+    // Resolve queries directly into the readback resource at the allocation at offset.
+    // The data can be read from GetMappedPtr() once the command list has completed.
+    void ResolveQueryData(ID3D12GraphicsCommandList4* commandList, ID3D12QueryHeap* queryHeap, D3D12_QUERY_TYPE type,
+        uint32_t startIndex, uint32_t numQueries, uint32_t offset);
+
 private:
     // Reserved offset
     const uint32_t RESERVED_OFFSET = 1;
@@ -164,6 +199,9 @@ private:
     // Thread safety
     mutable std::mutex m_mutex;
 
+    // Id in the HeapRegistry
+    uint32_t m_registryId;
+
     // Device reference (not owned)
     ID3D12Device5* m_device;
 
@@ -176,6 +214,11 @@ private:
     // mapped pointer for readback resource
     void *m_mappedPtr;
 
+    // Readback requests and the fence signaled after their copies
+    ReadbackQueue m_readbackQueue;
+    ComPtr<ID3D12Fence> m_readbackFence;
+    uint64_t m_readbackFenceValue;
+
     // GPU virtual address for default resource
     D3D12_GPU_VIRTUAL_ADDRESS m_gpuVirtualAddress; 
 };
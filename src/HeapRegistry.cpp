@@ -0,0 +1,236 @@
+#include "HeapRegistry.h"
+#include "PlatformHelpers.h"
+#include <algorithm>
+#include <chrono>
+#include <format>
+
+namespace
+{
+    // Escape a string for a JSON string literal
+    std::string JsonEscape(const std::string& str)
+    {
+        std::string escaped;
+        escaped.reserve(str.size());
+        for (char c : str)
+        {
+            switch (c)
+            {
+            case '"':  escaped += "\\\""; break;
+            case '\\': escaped += "\\\\"; break;
+            case '\n': escaped += "\\n"; break;
+            case '\r': escaped += "\\r"; break;
+            case '\t': escaped += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    escaped += std::format("\\u{:04x}", static_cast<unsigned int>(static_cast<unsigned char>(c)));
+                }
+                else
+                {
+                    escaped += c;
+                }
+                break;
+            }
+        }
+        return escaped;
+    }
+}
+
+HeapRegistry& HeapRegistry::Instance()
+{
+    static HeapRegistry registry;
+    return registry;
+}
+
+uint32_t HeapRegistry::Register(const std::string& name, const std::string& kind, StatsCallback statsCallback, OccupancyCallback occupancyCallback)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Entry entry;
+    entry.id = m_nextId++;
+    entry.name = name;
+    entry.kind = kind;
+    entry.statsCallback = std::move(statsCallback);
+    entry.occupancyCallback = std::move(occupancyCallback);
+    m_entries.push_back(std::move(entry));
+
+    return m_entries.back().id;
+}
+
+void HeapRegistry::Unregister(uint32_t id)
+{
+    if (id == INVALID_ID)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = std::find_if(m_entries.begin(), m_entries.end(), [id](const Entry& entry) { return entry.id == id; });
+    if (it != m_entries.end())
+    {
+        m_entries.erase(it);
+    }
+}
+
+void HeapRegistry::CollectStats(std::vector<RegisteredHeapStats>& heaps) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    heaps.resize(m_entries.size());
+    for (size_t i = 0; i < m_entries.size(); ++i)
+    {
+        heaps[i].id = m_entries[i].id;
+        heaps[i].name = m_entries[i].name;
+        heaps[i].kind = m_entries[i].kind;
+        heaps[i].stats = m_entries[i].statsCallback();
+    }
+}
+
+bool HeapRegistry::GetOccupancyMap(uint32_t id, uint32_t numCells, std::vector<float>& occupancy) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = std::find_if(m_entries.begin(), m_entries.end(), [id](const Entry& entry) { return entry.id == id; });
+    if (it == m_entries.end() || !it->occupancyCallback)
+    {
+        return false;
+    }
+
+    it->occupancyCallback(numCells, occupancy);
+    return true;
+}
+
+void HeapRegistry::SetResourceSize(const std::string& name, uint64_t currentSize, uint64_t allocatedSize)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = std::find_if(m_resourceSizes.begin(), m_resourceSizes.end(), [&name](const TrackedResourceSize& resource) { return resource.name == name; });
+    if (it == m_resourceSizes.end())
+    {
+        m_resourceSizes.push_back({ name, currentSize, allocatedSize });
+    }
+    else
+    {
+        it->currentSize = currentSize;
+        it->allocatedSize = allocatedSize;
+    }
+}
+
+void HeapRegistry::RemoveResourceSize(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::erase_if(m_resourceSizes, [&name](const TrackedResourceSize& resource) { return resource.name == name; });
+}
+
+std::vector<TrackedResourceSize> HeapRegistry::GetResourceSizes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    return m_resourceSizes;
+}
+
+bool HeapRegistry::WriteJsonSnapshot(const char* path, const char* reason) const
+{
+    std::string json;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        const int64_t unixTime = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        json += "{\n";
+        json += std::format("  \"reason\": \"{}\",\n", JsonEscape(reason ? reason : ""));
+        json += std::format("  \"unixTime\": {},\n", unixTime);
+
+        json += "  \"heaps\": [\n";
+        std::vector<float> occupancy;
+        for (size_t i = 0; i < m_entries.size(); ++i)
+        {
+            const Entry& entry = m_entries[i];
+            const HeapAllocationStats stats = entry.statsCallback();
+
+            json += "    {\n";
+            json += std::format("      \"name\": \"{}\",\n", JsonEscape(entry.name));
+            json += std::format("      \"kind\": \"{}\",\n", JsonEscape(entry.kind));
+            json += std::format("      \"totalSize\": {},\n", stats.totalSize);
+            json += std::format("      \"usedSize\": {},\n", stats.usedSize);
+            json += std::format("      \"peakUsedSize\": {},\n", stats.peakUsedSize);
+            json += std::format("      \"largestFreeBlock\": {},\n", stats.largestFreeBlock);
+            json += std::format("      \"numAllocations\": {},\n", stats.numAllocations);
+            json += std::format("      \"numFreeBlocks\": {},\n", stats.numFreeBlocks);
+            json += std::format("      \"fragmentationRatio\": {},\n", stats.fragmentationRatio);
+            json += std::format("      \"totalAllocations\": {},\n", stats.totalAllocations);
+            json += std::format("      \"totalFrees\": {},\n", stats.totalFrees);
+            json += std::format("      \"failedAllocations\": {},\n", stats.failedAllocations);
+            json += std::format("      \"averageAllocateLatencyNs\": {},\n", stats.averageAllocateLatencyNs);
+            json += std::format("      \"maxAllocateLatencyNs\": {},\n", stats.maxAllocateLatencyNs);
+
+            json += "      \"sizeHistogramLog2\": [";
+            for (uint32_t bucket = 0; bucket < HEAP_ALLOCATION_SIZE_HISTOGRAM_BUCKETS; ++bucket)
+            {
+                json += std::format("{}{}", bucket > 0 ? ", " : "", stats.sizeHistogram[bucket]);
+            }
+            json += "],\n";
+
+            json += "      \"occupancy\": [";
+            if (entry.occupancyCallback)
+            {
+                entry.occupancyCallback(SNAPSHOT_OCCUPANCY_CELLS, occupancy);
+                for (size_t cell = 0; cell < occupancy.size(); ++cell)
+                {
+                    json += std::format("{}{:.3f}", cell > 0 ? ", " : "", occupancy[cell]);
+                }
+            }
+            json += "]\n";
+            json += std::format("    }}{}\n", i + 1 < m_entries.size() ? "," : "");
+        }
+        json += "  ],\n";
+
+        json += "  \"resources\": [\n";
+        for (size_t i = 0; i < m_resourceSizes.size(); ++i)
+        {
+            const TrackedResourceSize& resource = m_resourceSizes[i];
+            json += std::format("    {{ \"name\": \"{}\", \"currentSize\": {}, \"allocatedSize\": {} }}{}\n",
+                JsonEscape(resource.name), resource.currentSize, resource.allocatedSize, i + 1 < m_resourceSizes.size() ? "," : "");
+        }
+        json += "  ]\n";
+        json += "}\n";
+    }
+
+    FILE* file = OpenFileStream(path, "wb");
+    if (!file)
+    {
+        OutputDebugStringA(std::format("HeapRegistry: Failed to open {}\n", path).c_str());
+        return false;
+    }
+    const bool succeeded = fwrite(json.data(), 1, json.size(), file) == json.size();
+    fclose(file);
+
+    OutputDebugStringA(std::format("HeapRegistry: Memory snapshot written to {}\n", path).c_str());
+    return succeeded;
+}
+
+void HeapRegistry::OnAllocationFailure(const std::string& heapName, uint32_t allocationSize)
+{
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_outOfMemorySnapshotWritten)
+        {
+            return;
+        }
+        m_outOfMemorySnapshotWritten = true;
+        path = m_outOfMemorySnapshotPath;
+    }
+
+    const std::string reason = std::format("Allocation of {} bytes failed in {}", allocationSize, heapName);
+    OutputDebugStringA(std::format("HeapRegistry: {}, writing memory snapshot\n", reason).c_str());
+    WriteJsonSnapshot(path.c_str(), reason.c_str());
+}
+
+void HeapRegistry::SetOutOfMemorySnapshotPath(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_outOfMemorySnapshotPath = path;
+}
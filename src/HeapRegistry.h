@@ -0,0 +1,95 @@
+#pragma once
+
+#include "HeapAllocator.h"
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Statistics of one registered heap at the time of the query
+struct RegisteredHeapStats
+{
+    uint32_t id;
+    std::string name;
+    std::string kind;           // "Default", "Upload", "GPU Upload", "Readback" or "Descriptor"
+    HeapAllocationStats stats;  // sizes are in descriptors for descriptor heaps
+};
+
+// Size of a single resource which is interesting for memory analysis (e.g. BLAS and TLAS)
+struct TrackedResourceSize
+{
+    std::string name;
+    uint64_t currentSize;       // size actually used by the resource (e.g. post-build current size)
+    uint64_t allocatedSize;     // size reserved in the heap
+};
+
+// Build the statistics of a descriptor heap, sizes are in descriptors
+inline HeapAllocationStats MakeDescriptorHeapStats(uint32_t numDescriptors, uint32_t numUsedDescriptors)
+{
+    HeapAllocationStats stats = {};
+    stats.totalSize = numDescriptors;
+    stats.usedSize = numUsedDescriptors;
+    stats.peakUsedSize = numUsedDescriptors;
+    stats.numAllocations = numUsedDescriptors;
+    stats.largestFreeBlock = numDescriptors - numUsedDescriptors;
+    return stats;
+}
+
+// Single enumeration point of every heap in the application.
+// Heaps register themselves when they are initialized and unregister in their destructor.
+// The callbacks are invoked with the registry lock held, so unregistering waits for in-flight queries.
+class HeapRegistry
+{
+public:
+    using StatsCallback = std::function<HeapAllocationStats()>;
+    using OccupancyCallback = std::function<void(uint32_t numCells, std::vector<float>& occupancy)>;
+
+    static constexpr uint32_t INVALID_ID = static_cast<uint32_t>(-1);
+
+    // Number of cells of the occupancy map written to the JSON snapshot
+    static constexpr uint32_t SNAPSHOT_OCCUPANCY_CELLS = 256;
+
+    // Global registry
+    static HeapRegistry& Instance();
+
+    // Register a heap. occupancyCallback may be empty when the heap has no block map (e.g. descriptor heaps).
+    uint32_t Register(const std::string& name, const std::string& kind, StatsCallback statsCallback, OccupancyCallback occupancyCallback = {});
+    void Unregister(uint32_t id);
+
+    // Query the statistics of every registered heap in registration order
+    void CollectStats(std::vector<RegisteredHeapStats>& heaps) const;
+
+    // Query the occupancy map of a heap. Returns false if the heap is unknown or has no block map.
+    bool GetOccupancyMap(uint32_t id, uint32_t numCells, std::vector<float>& occupancy) const;
+
+    // Set or remove the size of a tracked resource
+    void SetResourceSize(const std::string& name, uint64_t currentSize, uint64_t allocatedSize);
+    void RemoveResourceSize(const std::string& name);
+    std::vector<TrackedResourceSize> GetResourceSizes() const;
+
+    // Write every heap (stats, size histogram and occupancy map) and the tracked resources into a JSON file
+    bool WriteJsonSnapshot(const char* path, const char* reason) const;
+
+    // Called by the heaps when an allocation fails. The first failure writes a JSON snapshot to the OOM snapshot path.
+    void OnAllocationFailure(const std::string& heapName, uint32_t allocationSize);
+
+    void SetOutOfMemorySnapshotPath(const std::string& path);
+
+private:
+    struct Entry
+    {
+        uint32_t id;
+        std::string name;
+        std::string kind;
+        StatsCallback statsCallback;
+        OccupancyCallback occupancyCallback;
+    };
+
+    mutable std::mutex m_mutex;
+    uint32_t m_nextId = 0;
+    std::vector<Entry> m_entries;
+    std::vector<TrackedResourceSize> m_resourceSizes;
+    std::string m_outOfMemorySnapshotPath = "MemorySnapshot_OOM.json";
+    bool m_outOfMemorySnapshotWritten = false;
+};
@@ -5,6 +5,7 @@
 #include <dxgi1_6.h>
 #include <wrl/client.h>
 #include <string>
+#include "PlatformHelpers.h"
 
 using Microsoft::WRL::ComPtr;
 
@@ -28,15 +29,3 @@ inline std::wstring HrToString(HRESULT hr)
     }                                                                  \
 }
 
-
-// Helper function to align size to given alignment
-inline uint32_t AlignSize(uint32_t size, uint32_t alignment)
-{
-    return (size + alignment - 1) & ~(alignment - 1);
-}
-
-// Helper function to align size to given alignment (64-bit version)
-inline uint64_t AlignSize(uint64_t size, uint32_t alignment)
-{
-    return (size + static_cast<uint64_t>(alignment) - 1) & ~(static_cast<uint64_t>(alignment) - 1);
-}
@@ -18,6 +18,7 @@ struct ImGuiManager::DescriptorHeapAllocator
     D3D12_GPU_DESCRIPTOR_HANDLE m_heapStartGpu = {};
     UINT                        m_heapHandleIncrement = {};
     std::vector<int>            m_freeIndices = {};
+    uint32_t                    m_numDescriptors = {};
 
     void Create(ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t num)
     {
@@ -37,6 +38,7 @@ struct ImGuiManager::DescriptorHeapAllocator
         m_heapStartCpu = m_heap->GetCPUDescriptorHandleForHeapStart();
         m_heapStartGpu = m_heap->GetGPUDescriptorHandleForHeapStart();
         m_heapHandleIncrement = device->GetDescriptorHandleIncrementSize(m_heapType);
+        m_numDescriptors = desc.NumDescriptors;
         m_freeIndices.reserve((int)desc.NumDescriptors);
         for (int n = desc.NumDescriptors; n > 0; n--)
             m_freeIndices.push_back(n - 1);
@@ -50,6 +52,11 @@ struct ImGuiManager::DescriptorHeapAllocator
 
     ComPtr<ID3D12DescriptorHeap>& Heap() { return m_heap; }
 
+    HeapAllocationStats GetStats() const
+    {
+        return MakeDescriptorHeapStats(m_numDescriptors, m_numDescriptors - static_cast<uint32_t>(m_freeIndices.size()));
+    }
+
     void Alloc(D3D12_CPU_DESCRIPTOR_HANDLE* out_cpu_desc_handle, D3D12_GPU_DESCRIPTOR_HANDLE* out_gpu_desc_handle)
     {
         assert(m_freeIndices.size() > 0);
@@ -104,6 +111,7 @@ void ImGuiManager::Initialize(HWND hwnd, ID3D12Device* device, ID3D12CommandQueu
 
     m_srvHeapAllcoator = std::make_unique<DescriptorHeapAllocator>();
     m_srvHeapAllcoator->Create(device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 32);
+    m_srvHeapRegistryId = HeapRegistry::Instance().Register("ImGui SRV Heap", "Descriptor", []() { return m_srvHeapAllcoator->GetStats(); });
 
     ImGui_ImplDX12_InitInfo init_info = {};
     init_info.Device = device;
@@ -132,6 +140,9 @@ void ImGuiManager::Shutdown()
     ImGui_ImplWin32_Shutdown();
     ImGui::DestroyContext();
 
+    HeapRegistry::Instance().Unregister(m_srvHeapRegistryId);
+    m_srvHeapRegistryId = HeapRegistry::INVALID_ID;
+
     m_initialized = false;
 }
 
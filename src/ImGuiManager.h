@@ -6,6 +6,7 @@
 #include <wrl/client.h>
 #include <cstdint>
 #include <memory>
+#include "HeapRegistry.h"
 
 // Use Microsoft::WRL::ComPtr
 using Microsoft::WRL::ComPtr;
@@ -52,4 +53,7 @@ private:
     
     // Number of swap chain buffers
     uint32_t m_bufferCount = 0;
+
+    // Id of the SRV heap in the HeapRegistry
+    uint32_t m_srvHeapRegistryId = HeapRegistry::INVALID_ID;
 };
@@ -0,0 +1,470 @@
+#include "Json.h"
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <format>
+
+namespace
+{
+    // Deeper documents are rejected instead of overflowing the stack
+    const uint32_t MAX_DEPTH = 256;
+
+    const JsonValue& NullValue()
+    {
+        static const JsonValue nullValue;
+        return nullValue;
+    }
+
+    const std::string& EmptyString()
+    {
+        static const std::string emptyString;
+        return emptyString;
+    }
+
+    void AppendUtf8(uint32_t codePoint, std::string& output)
+    {
+        if (codePoint < 0x80)
+        {
+            output += static_cast<char>(codePoint);
+        }
+        else if (codePoint < 0x800)
+        {
+            output += static_cast<char>(0xc0 | (codePoint >> 6));
+            output += static_cast<char>(0x80 | (codePoint & 0x3f));
+        }
+        else if (codePoint < 0x10000)
+        {
+            output += static_cast<char>(0xe0 | (codePoint >> 12));
+            output += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+            output += static_cast<char>(0x80 | (codePoint & 0x3f));
+        }
+        else
+        {
+            output += static_cast<char>(0xf0 | (codePoint >> 18));
+            output += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f));
+            output += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+            output += static_cast<char>(0x80 | (codePoint & 0x3f));
+        }
+    }
+}
+
+class JsonParser
+{
+public:
+    JsonParser(const char* text, size_t size) :
+        m_begin(text),
+        m_position(text),
+        m_end(text + size)
+    {
+    }
+
+    bool Parse(JsonValue& value, std::string* error)
+    {
+        SkipWhitespace();
+        bool isParsed = ParseValue(value, 0);
+        if (isParsed)
+        {
+            SkipWhitespace();
+            if (m_position != m_end)
+            {
+                isParsed = Fail("Unexpected data after the value");
+            }
+        }
+
+        if (!isParsed && error)
+        {
+            *error = std::format("{} at byte {}", m_error, m_position - m_begin);
+        }
+        return isParsed;
+    }
+
+private:
+    const char* m_begin;
+    const char* m_position;
+    const char* m_end;
+    const char* m_error = "";
+
+    bool Fail(const char* message)
+    {
+        m_error = message;
+        return false;
+    }
+
+    void SkipWhitespace()
+    {
+        while (m_position < m_end && (*m_position == ' ' || *m_position == '\t' || *m_position == '\n' || *m_position == '\r'))
+        {
+            ++m_position;
+        }
+    }
+
+    bool Consume(char c)
+    {
+        if (m_position < m_end && *m_position == c)
+        {
+            ++m_position;
+            return true;
+        }
+        return false;
+    }
+
+    bool ConsumeLiteral(const char* literal)
+    {
+        const char* p = m_position;
+        for (; *literal; ++literal, ++p)
+        {
+            if (p >= m_end || *p != *literal)
+            {
+                return false;
+            }
+        }
+        m_position = p;
+        return true;
+    }
+
+    bool ParseValue(JsonValue& value, uint32_t depth)
+    {
+        if (m_position >= m_end)
+        {
+            return Fail("Unexpected end of the document");
+        }
+
+        switch (*m_position)
+        {
+        case '{':
+            return ParseObject(value, depth);
+        case '[':
+            return ParseArray(value, depth);
+        case '"':
+            value.m_type = JsonValue::Type::String;
+            return ParseString(value.m_string);
+        case 't':
+            value.m_type = JsonValue::Type::Bool;
+            value.m_bool = true;
+            return ConsumeLiteral("true") || Fail("Invalid literal");
+        case 'f':
+            value.m_type = JsonValue::Type::Bool;
+            value.m_bool = false;
+            return ConsumeLiteral("false") || Fail("Invalid literal");
+        case 'n':
+            value.m_type = JsonValue::Type::Null;
+            return ConsumeLiteral("null") || Fail("Invalid literal");
+        default:
+            return ParseNumber(value);
+        }
+    }
+
+    bool ParseObject(JsonValue& value, uint32_t depth)
+    {
+        if (depth >= MAX_DEPTH)
+        {
+            return Fail("Nesting is too deep");
+        }
+
+        value.m_type = JsonValue::Type::Object;
+        ++m_position;
+        SkipWhitespace();
+        if (Consume('}'))
+        {
+            return true;
+        }
+
+        for (;;)
+        {
+            SkipWhitespace();
+            if (m_position >= m_end || *m_position != '"')
+            {
+                return Fail("Expected a member name");
+            }
+            value.m_keys.emplace_back();
+            if (!ParseString(value.m_keys.back()))
+            {
+                return false;
+            }
+
+            SkipWhitespace();
+            if (!Consume(':'))
+            {
+                return Fail("Expected ':'");
+            }
+            SkipWhitespace();
+            value.m_elements.emplace_back();
+            if (!ParseValue(value.m_elements.back(), depth + 1))
+            {
+                return false;
+            }
+
+            SkipWhitespace();
+            if (Consume('}'))
+            {
+                return true;
+            }
+            if (!Consume(','))
+            {
+                return Fail("Expected ',' or '}'");
+            }
+        }
+    }
+
+    bool ParseArray(JsonValue& value, uint32_t depth)
+    {
+        if (depth >= MAX_DEPTH)
+        {
+            return Fail("Nesting is too deep");
+        }
+
+        value.m_type = JsonValue::Type::Array;
+        ++m_position;
+        SkipWhitespace();
+        if (Consume(']'))
+        {
+            return true;
+        }
+
+        for (;;)
+        {
+            SkipWhitespace();
+            value.m_elements.emplace_back();
+            if (!ParseValue(value.m_elements.back(), depth + 1))
+            {
+                return false;
+            }
+
+            SkipWhitespace();
+            if (Consume(']'))
+            {
+                return true;
+            }
+            if (!Consume(','))
+            {
+                return Fail("Expected ',' or ']'");
+            }
+        }
+    }
+
+    bool ParseHex4(uint32_t& codeUnit)
+    {
+        if (m_end - m_position < 4)
+        {
+            return Fail("Truncated \\u escape");
+        }
+
+        codeUnit = 0;
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            const char c = *m_position++;
+            uint32_t digit = 0;
+            if (c >= '0' && c <= '9')
+            {
+                digit = c - '0';
+            }
+            else if (c >= 'a' && c <= 'f')
+            {
+                digit = c - 'a' + 10;
+            }
+            else if (c >= 'A' && c <= 'F')
+            {
+                digit = c - 'A' + 10;
+            }
+            else
+            {
+                return Fail("Invalid \\u escape");
+            }
+            codeUnit = (codeUnit << 4) | digit;
+        }
+        return true;
+    }
+
+    bool ParseString(std::string& output)
+    {
+        ++m_position;
+        for (;;)
+        {
+            // Copy the run of plain characters at once
+            const char* runBegin = m_position;
+            while (m_position < m_end && *m_position != '"' && *m_position != '\\' && static_cast<unsigned char>(*m_position) >= 0x20)
+            {
+                ++m_position;
+            }
+            output.append(runBegin, m_position);
+
+            if (m_position >= m_end)
+            {
+                return Fail("Unterminated string");
+            }
+            if (*m_position == '"')
+            {
+                ++m_position;
+                return true;
+            }
+            if (*m_position != '\\')
+            {
+                return Fail("Control character in string");
+            }
+
+            ++m_position;
+            if (m_position >= m_end)
+            {
+                return Fail("Unterminated string");
+            }
+            const char escape = *m_position++;
+            switch (escape)
+            {
+            case '"': output += '"'; break;
+            case '\\': output += '\\'; break;
+            case '/': output += '/'; break;
+            case 'b': output += '\b'; break;
+            case 'f': output += '\f'; break;
+            case 'n': output += '\n'; break;
+            case 'r': output += '\r'; break;
+            case 't': output += '\t'; break;
+            case 'u':
+            {
+                uint32_t codePoint = 0;
+                if (!ParseHex4(codePoint))
+                {
+                    return false;
+                }
+
+                // Surrogate pair
+                if (codePoint >= 0xd800 && codePoint < 0xdc00)
+                {
+                    uint32_t low = 0;
+                    if (!ConsumeLiteral("\\u") || !ParseHex4(low) || low < 0xdc00 || low >= 0xe000)
+                    {
+                        return Fail("Invalid surrogate pair");
+                    }
+                    codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (low - 0xdc00);
+                }
+                AppendUtf8(codePoint, output);
+                break;
+            }
+            default:
+                return Fail("Invalid escape");
+            }
+        }
+    }
+
+    bool ParseNumber(JsonValue& value)
+    {
+        // Validate the JSON grammar, from_chars also accepts forms JSON does not (e.g. "inf")
+        const char* p = m_position;
+        if (p < m_end && *p == '-')
+        {
+            ++p;
+        }
+        if (p >= m_end || static_cast<unsigned>(*p - '0') >= 10)
+        {
+            return Fail("Invalid value");
+        }
+        if (*p == '0')
+        {
+            ++p;
+        }
+        else
+        {
+            while (p < m_end && static_cast<unsigned>(*p - '0') < 10)
+            {
+                ++p;
+            }
+        }
+        if (p < m_end && *p == '.')
+        {
+            ++p;
+            if (p >= m_end || static_cast<unsigned>(*p - '0') >= 10)
+            {
+                return Fail("Invalid number");
+            }
+            while (p < m_end && static_cast<unsigned>(*p - '0') < 10)
+            {
+                ++p;
+            }
+        }
+        if (p < m_end && (*p == 'e' || *p == 'E'))
+        {
+            ++p;
+            if (p < m_end && (*p == '+' || *p == '-'))
+            {
+                ++p;
+            }
+            if (p >= m_end || static_cast<unsigned>(*p - '0') >= 10)
+            {
+                return Fail("Invalid number");
+            }
+            while (p < m_end && static_cast<unsigned>(*p - '0') < 10)
+            {
+                ++p;
+            }
+        }
+
+        value.m_type = JsonValue::Type::Number;
+        if (std::from_chars(m_position, p, value.m_number).ec == std::errc::result_out_of_range)
+        {
+            // Rare, strtod rounds to infinity or zero
+            value.m_number = strtod(std::string(m_position, p).c_str(), nullptr);
+        }
+        m_position = p;
+        return true;
+    }
+};
+
+JsonValue::JsonValue() :
+    m_type(Type::Null),
+    m_bool(false),
+    m_number(0.0)
+{
+}
+
+uint32_t JsonValue::GetUInt(uint32_t defaultValue) const
+{
+    if (m_type != Type::Number || !(m_number >= 0.0) || m_number > static_cast<double>(UINT32_MAX) || m_number != std::floor(m_number))
+    {
+        return defaultValue;
+    }
+    return static_cast<uint32_t>(m_number);
+}
+
+uint64_t JsonValue::GetUInt64(uint64_t defaultValue) const
+{
+    // Exact up to 2^53, enough for byte offsets
+    if (m_type != Type::Number || !(m_number >= 0.0) || m_number >= 18446744073709551616.0 || m_number != std::floor(m_number))
+    {
+        return defaultValue;
+    }
+    return static_cast<uint64_t>(m_number);
+}
+
+const JsonValue& JsonValue::At(size_t index) const
+{
+    return index < m_elements.size() ? m_elements[index] : NullValue();
+}
+
+const JsonValue* JsonValue::Find(const char* key) const
+{
+    for (size_t i = 0; i < m_keys.size(); ++i)
+    {
+        if (m_keys[i] == key)
+        {
+            return &m_elements[i];
+        }
+    }
+    return nullptr;
+}
+
+const JsonValue& JsonValue::operator[](const char* key) const
+{
+    const JsonValue* value = Find(key);
+    return value ? *value : NullValue();
+}
+
+const std::string& JsonValue::GetKey(size_t index) const
+{
+    return index < m_keys.size() ? m_keys[index] : EmptyString();
+}
+
+bool ParseJson(const char* text, size_t size, JsonValue& value, std::string* error)
+{
+    value = JsonValue();
+    JsonParser parser(text, size);
+    return parser.Parse(value, error);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Minimal JSON DOM parser (RFC 8259) for the scene files.
+//
+// Lookups never fail: a missing member or element returns a shared null value, so that optional properties can be
+// read with defaults, e.g. value["nodes"].At(0)["mesh"].GetUInt(INVALID). Objects keep their members in file order and
+// are searched linearly, which is fast for the small objects of glTF.
+//
+// This module has no Direct3D12 dependency.
+
+class JsonValue
+{
+public:
+    enum class Type : uint8_t
+    {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object,
+    };
+
+    JsonValue();
+
+    Type GetType() const { return m_type; }
+    bool IsNull() const { return m_type == Type::Null; }
+    bool IsBool() const { return m_type == Type::Bool; }
+    bool IsNumber() const { return m_type == Type::Number; }
+    bool IsString() const { return m_type == Type::String; }
+    bool IsArray() const { return m_type == Type::Array; }
+    bool IsObject() const { return m_type == Type::Object; }
+
+    // Values of other types return the default
+    bool GetBool(bool defaultValue = false) const { return m_type == Type::Bool ? m_bool : defaultValue; }
+    double GetNumber(double defaultValue = 0.0) const { return m_type == Type::Number ? m_number : defaultValue; }
+    float GetFloat(float defaultValue = 0.0f) const { return m_type == Type::Number ? static_cast<float>(m_number) : defaultValue; }
+    // Non-negative integers below 2^32 only
+    uint32_t GetUInt(uint32_t defaultValue = 0) const;
+    uint64_t GetUInt64(uint64_t defaultValue = 0) const;
+    const std::string& GetString() const { return m_string; }
+
+    // Number of array elements or object members
+    size_t Size() const { return m_elements.size(); }
+
+    // Array element, or the value of the index-th object member
+    const JsonValue& At(size_t index) const;
+
+    // Object member, nullptr if missing
+    const JsonValue* Find(const char* key) const;
+    const JsonValue& operator[](const char* key) const;
+
+    // Key of the index-th object member
+    const std::string& GetKey(size_t index) const;
+
+private:
+    friend class JsonParser;
+
+    Type m_type;
+    bool m_bool;
+    double m_number;
+    std::string m_string;
+    std::vector<JsonValue> m_elements;  // array elements or object member values
+    std::vector<std::string> m_keys;    // object member keys
+};
+
+// Parse text into value. Returns false with a message containing the byte offset on malformed input.
+bool ParseJson(const char* text, size_t size, JsonValue& value, std::string* error = nullptr);
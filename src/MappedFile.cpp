@@ -0,0 +1,134 @@
+#include "MappedFile.h"
+#include <format>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() :
+#ifdef _WIN32
+    m_file(INVALID_HANDLE_VALUE),
+    m_mapping(nullptr),
+#else
+    m_file(-1),
+#endif
+    m_data(nullptr),
+    m_size(0),
+    m_isOpen(false)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(const char* path)
+{
+    Close();
+
+#ifdef _WIN32
+    m_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE)
+    {
+        OutputDebugStringA(std::format("MappedFile: failed to open {}\n", path).c_str());
+        return false;
+    }
+
+    LARGE_INTEGER fileSize = {};
+    if (!GetFileSizeEx(m_file, &fileSize))
+    {
+        OutputDebugStringA(std::format("MappedFile: failed to get the size of {}\n", path).c_str());
+        Close();
+        return false;
+    }
+    m_size = static_cast<uint64_t>(fileSize.QuadPart);
+
+    // A mapping of an empty file cannot be created
+    if (m_size > 0)
+    {
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mapping)
+        {
+            m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        }
+        if (!m_data)
+        {
+            OutputDebugStringA(std::format("MappedFile: failed to map {}\n", path).c_str());
+            Close();
+            return false;
+        }
+    }
+#else
+    m_file = open(path, O_RDONLY);
+    if (m_file < 0)
+    {
+        OutputDebugStringA(std::format("MappedFile: failed to open {}\n", path).c_str());
+        return false;
+    }
+
+    struct stat fileStat = {};
+    if (fstat(m_file, &fileStat) != 0)
+    {
+        OutputDebugStringA(std::format("MappedFile: failed to get the size of {}\n", path).c_str());
+        Close();
+        return false;
+    }
+    m_size = static_cast<uint64_t>(fileStat.st_size);
+
+    if (m_size > 0)
+    {
+        void* data = mmap(nullptr, static_cast<size_t>(m_size), PROT_READ, MAP_PRIVATE, m_file, 0);
+        if (data == MAP_FAILED)
+        {
+            OutputDebugStringA(std::format("MappedFile: failed to map {}\n", path).c_str());
+            Close();
+            return false;
+        }
+        m_data = static_cast<const char*>(data);
+
+        // The file is read front to back by the parsers
+        madvise(data, static_cast<size_t>(m_size), MADV_SEQUENTIAL);
+    }
+#endif
+
+    m_isOpen = true;
+    return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+    if (m_data)
+    {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping)
+    {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+    }
+    if (m_file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_file);
+        m_file = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (m_data)
+    {
+        munmap(const_cast<char*>(m_data), static_cast<size_t>(m_size));
+    }
+    if (m_file >= 0)
+    {
+        close(m_file);
+        m_file = -1;
+    }
+#endif
+
+    m_data = nullptr;
+    m_size = 0;
+    m_isOpen = false;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "PlatformHelpers.h"
+#include <cstdint>
+
+// Read-only memory mapping of a whole file. An empty file opens successfully with a null data pointer.
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const char* path);
+    void Close();
+
+    bool IsOpen() const { return m_isOpen; }
+    const char* GetData() const { return m_data; }
+    uint64_t GetSize() const { return m_size; }
+
+private:
+#ifdef _WIN32
+    HANDLE m_file;
+    HANDLE m_mapping;
+#else
+    int m_file;
+#endif
+    const char* m_data;
+    uint64_t m_size;
+    bool m_isOpen;
+};
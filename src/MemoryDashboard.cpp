@@ -0,0 +1,211 @@
+#include "MemoryDashboard.h"
+#include <imgui.h>
+#include <algorithm>
+#include <cfloat>
+#include <format>
+
+namespace
+{
+    std::string FormatBytes(uint64_t bytes)
+    {
+        if (bytes >= 1024ull * 1024ull)
+        {
+            return std::format("{:.2f} MB", static_cast<double>(bytes) / (1024.0 * 1024.0));
+        }
+        if (bytes >= 1024ull)
+        {
+            return std::format("{:.2f} KB", static_cast<double>(bytes) / 1024.0);
+        }
+        return std::format("{} B", bytes);
+    }
+
+    bool IsDescriptorHeap(const RegisteredHeapStats& heap)
+    {
+        return heap.kind == "Descriptor";
+    }
+}
+
+MemoryDashboard::MemoryDashboard() :
+    m_snapshotCounter(0)
+{
+}
+
+MemoryDashboard::~MemoryDashboard()
+{
+}
+
+void MemoryDashboard::Draw()
+{
+    HeapRegistry::Instance().CollectStats(m_heaps);
+    UpdateHistory();
+
+    ImGui::Begin("Memory");
+
+    // Summary of the buffer heaps
+    uint64_t totalSize = 0;
+    uint64_t usedSize = 0;
+    for (const auto& heap : m_heaps)
+    {
+        if (!IsDescriptorHeap(heap))
+        {
+            totalSize += heap.stats.totalSize;
+            usedSize += heap.stats.usedSize;
+        }
+    }
+    ImGui::Text("Heaps: %s / %s used", FormatBytes(usedSize).c_str(), FormatBytes(totalSize).c_str());
+
+    if (ImGui::Button("Export JSON snapshot"))
+    {
+        const std::string path = std::format("MemorySnapshot_{}.json", m_snapshotCounter++);
+        if (HeapRegistry::Instance().WriteJsonSnapshot(path.c_str(), "Exported from the memory dashboard"))
+        {
+            m_snapshotMessage = "Written to " + path;
+        }
+        else
+        {
+            m_snapshotMessage = "Failed to write " + path;
+        }
+    }
+    if (!m_snapshotMessage.empty())
+    {
+        ImGui::SameLine();
+        ImGui::TextUnformatted(m_snapshotMessage.c_str());
+    }
+
+    // Buffer heaps
+    for (const auto& heap : m_heaps)
+    {
+        if (!IsDescriptorHeap(heap))
+        {
+            DrawHeap(heap);
+        }
+    }
+
+    // Acceleration structures
+    if (ImGui::CollapsingHeader("Acceleration Structures", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        for (const auto& resource : HeapRegistry::Instance().GetResourceSizes())
+        {
+            ImGui::Text("%s: %s (reserved %s)", resource.name.c_str(),
+                FormatBytes(resource.currentSize).c_str(), FormatBytes(resource.allocatedSize).c_str());
+        }
+    }
+
+    // Descriptor heaps
+    if (ImGui::CollapsingHeader("Descriptor Heaps", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        for (const auto& heap : m_heaps)
+        {
+            if (!IsDescriptorHeap(heap))
+            {
+                continue;
+            }
+            const float usage = heap.stats.totalSize > 0 ? static_cast<float>(heap.stats.usedSize) / static_cast<float>(heap.stats.totalSize) : 0.0f;
+            const std::string overlay = std::format("{}: {} / {} descriptors", heap.name, heap.stats.usedSize, heap.stats.totalSize);
+            ImGui::ProgressBar(usage, ImVec2(-1.0f, 0.0f), overlay.c_str());
+        }
+    }
+
+    ImGui::End();
+}
+
+void MemoryDashboard::UpdateHistory()
+{
+    // Drop the history of unregistered heaps
+    for (auto it = m_histories.begin(); it != m_histories.end();)
+    {
+        const uint32_t id = it->first;
+        if (std::none_of(m_heaps.begin(), m_heaps.end(), [id](const RegisteredHeapStats& heap) { return heap.id == id; }))
+        {
+            it = m_histories.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    for (const auto& heap : m_heaps)
+    {
+        if (IsDescriptorHeap(heap))
+        {
+            continue;
+        }
+
+        HeapHistory& history = m_histories[heap.id];
+        history.fragmentation[history.nextIndex] = heap.stats.fragmentationRatio;
+        history.usage[history.nextIndex] = heap.stats.totalSize > 0 ? static_cast<float>(heap.stats.usedSize) / static_cast<float>(heap.stats.totalSize) : 0.0f;
+        history.nextIndex = (history.nextIndex + 1) % HISTORY_LENGTH;
+        history.numSamples = std::min(history.numSamples + 1, HISTORY_LENGTH);
+    }
+}
+
+void MemoryDashboard::DrawHeap(const RegisteredHeapStats& heap)
+{
+    const HeapAllocationStats& stats = heap.stats;
+
+    ImGui::PushID(static_cast<int>(heap.id));
+    const std::string header = std::format("{} ({})", heap.name, heap.kind);
+    if (ImGui::CollapsingHeader(header.c_str(), ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        const float usage = stats.totalSize > 0 ? static_cast<float>(stats.usedSize) / static_cast<float>(stats.totalSize) : 0.0f;
+        const std::string overlay = std::format("{} / {}", FormatBytes(stats.usedSize), FormatBytes(stats.totalSize));
+        ImGui::ProgressBar(usage, ImVec2(-1.0f, 0.0f), overlay.c_str());
+
+        ImGui::Text("Peak: %s, Largest free block: %s", FormatBytes(stats.peakUsedSize).c_str(), FormatBytes(stats.largestFreeBlock).c_str());
+        ImGui::Text("Allocations: %zu live, %llu total, %llu failed", stats.numAllocations,
+            static_cast<unsigned long long>(stats.totalAllocations), static_cast<unsigned long long>(stats.failedAllocations));
+        ImGui::Text("Free blocks: %zu, Fragmentation: %.3f", stats.numFreeBlocks, stats.fragmentationRatio);
+        if (stats.numLatencySamples > 0)
+        {
+            ImGui::Text("Allocate latency: avg %.0f ns, max %llu ns", stats.averageAllocateLatencyNs, static_cast<unsigned long long>(stats.maxAllocateLatencyNs));
+        }
+
+        // Fragmentation sparkline, oldest sample first
+        const auto historyIt = m_histories.find(heap.id);
+        if (historyIt != m_histories.end() && historyIt->second.numSamples > 0)
+        {
+            const HeapHistory& history = historyIt->second;
+            const int offset = history.numSamples < HISTORY_LENGTH ? 0 : static_cast<int>(history.nextIndex);
+            ImGui::PlotLines("Fragmentation", history.fragmentation.data(), static_cast<int>(history.numSamples), offset, nullptr, 0.0f, 1.0f, ImVec2(0.0f, 32.0f));
+            ImGui::PlotLines("Usage", history.usage.data(), static_cast<int>(history.numSamples), offset, nullptr, 0.0f, 1.0f, ImVec2(0.0f, 32.0f));
+        }
+
+        // Allocation size histogram, bucket i holds the sizes in [2^i, 2^(i+1))
+        std::array<float, HEAP_ALLOCATION_SIZE_HISTOGRAM_BUCKETS> histogram = {};
+        for (uint32_t bucket = 0; bucket < HEAP_ALLOCATION_SIZE_HISTOGRAM_BUCKETS; ++bucket)
+        {
+            histogram[bucket] = static_cast<float>(stats.sizeHistogram[bucket]);
+        }
+        ImGui::PlotHistogram("Sizes (log2)", histogram.data(), static_cast<int>(histogram.size()), 0, nullptr, 0.0f, FLT_MAX, ImVec2(0.0f, 32.0f));
+
+        DrawBlockMap(heap.id);
+    }
+    ImGui::PopID();
+}
+
+void MemoryDashboard::DrawBlockMap(uint32_t heapId)
+{
+    if (!HeapRegistry::Instance().GetOccupancyMap(heapId, BLOCK_MAP_CELLS, m_occupancy))
+    {
+        return;
+    }
+
+    const float width = std::max(ImGui::GetContentRegionAvail().x, 1.0f);
+    const float height = 12.0f;
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+
+    // Free space is dark, fully used cells are bright orange
+    for (uint32_t cell = 0; cell < BLOCK_MAP_CELLS; ++cell)
+    {
+        const float x0 = origin.x + width * static_cast<float>(cell) / static_cast<float>(BLOCK_MAP_CELLS);
+        const float x1 = origin.x + width * static_cast<float>(cell + 1) / static_cast<float>(BLOCK_MAP_CELLS);
+        const float occupancy = m_occupancy[cell];
+        const ImU32 color = ImGui::GetColorU32(ImVec4(0.15f + 0.85f * occupancy, 0.15f + 0.45f * occupancy, 0.15f, 1.0f));
+        drawList->AddRectFilled(ImVec2(x0, origin.y), ImVec2(x1, origin.y + height), color);
+    }
+    drawList->AddRect(origin, ImVec2(origin.x + width, origin.y + height), ImGui::GetColorU32(ImGuiCol_Border));
+
+    ImGui::Dummy(ImVec2(width, height));
+}
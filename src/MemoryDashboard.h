@@ -0,0 +1,52 @@
+#pragma once
+
+#include "HeapRegistry.h"
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// ImGui panel listing every heap of the HeapRegistry with usage, fragmentation history and block map,
+// the acceleration structure sizes and the descriptor heap occupancy.
+class MemoryDashboard
+{
+public:
+    // Number of frames kept in the fragmentation and usage history
+    static constexpr uint32_t HISTORY_LENGTH = 240;
+
+    // Number of cells of the block map
+    static constexpr uint32_t BLOCK_MAP_CELLS = 128;
+
+    MemoryDashboard();
+    ~MemoryDashboard();
+
+    // Sample the registry and draw the "Memory" window. Call between ImGuiManager::BeginFrame() and EndFrame().
+    void Draw();
+
+private:
+    struct HeapHistory
+    {
+        std::array<float, HISTORY_LENGTH> fragmentation = {};
+        std::array<float, HISTORY_LENGTH> usage = {};
+        uint32_t nextIndex = 0;
+        uint32_t numSamples = 0;
+    };
+
+    void UpdateHistory();
+    void DrawHeap(const RegisteredHeapStats& heap);
+    void DrawBlockMap(uint32_t heapId);
+
+    // Stats of the current frame
+    std::vector<RegisteredHeapStats> m_heaps;
+
+    // History per registry id
+    std::map<uint32_t, HeapHistory> m_histories;
+
+    // Scratch buffer of the block map
+    std::vector<float> m_occupancy;
+
+    // Result of the last JSON export
+    std::string m_snapshotMessage;
+    uint32_t m_snapshotCounter;
+};
@@ -0,0 +1,388 @@
+#include "MeshPreprocess.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    const uint32_t INVALID_INDEX = UINT32_MAX;
+
+    // Parameters of the linear-speed vertex cache optimization (Tom Forsyth)
+    const uint32_t OPTIMIZER_CACHE_SIZE = 32;
+    const float CACHE_DECAY_POWER = 1.5f;
+    const float LAST_TRIANGLE_SCORE = 0.75f;
+    const float VALENCE_BOOST_SCALE = 2.0f;
+    const float VALENCE_BOOST_POWER = 0.5f;
+
+    // -0 and +0 must weld, so the zeros are normalized before the bitwise comparison
+    GeometrySourceVertex CanonicalizeVertex(const GeometrySourceVertex& vertex)
+    {
+        GeometrySourceVertex canonical = vertex;
+        float* values = reinterpret_cast<float*>(&canonical);
+        for (size_t i = 0; i < sizeof(GeometrySourceVertex) / sizeof(float); ++i)
+        {
+            if (values[i] == 0.0f)
+            {
+                values[i] = 0.0f;
+            }
+        }
+        return canonical;
+    }
+
+    uint32_t HashVertex(const GeometrySourceVertex& vertex)
+    {
+        uint32_t words[sizeof(GeometrySourceVertex) / sizeof(uint32_t)];
+        memcpy(words, &vertex, sizeof(words));
+
+        uint32_t hash = 2166136261u;
+        for (uint32_t word : words)
+        {
+            hash = (hash ^ word) * 16777619u;
+            hash ^= hash >> 15;
+        }
+        return hash;
+    }
+
+    // Merge bitwise identical vertices. Returns the remap from the input vertices to the welded ones.
+    std::vector<uint32_t> WeldVertices(const GeometrySourceVertex* vertices, uint32_t vertexCount, std::vector<GeometrySourceVertex>& weldedVertices)
+    {
+        // Open addressing with linear probing, at most half full
+        uint32_t tableSize = 1;
+        while (tableSize < vertexCount * 2)
+        {
+            tableSize <<= 1;
+        }
+        std::vector<uint32_t> table(tableSize, INVALID_INDEX);
+
+        std::vector<uint32_t> remap(vertexCount);
+        weldedVertices.clear();
+        weldedVertices.reserve(vertexCount);
+
+        for (uint32_t i = 0; i < vertexCount; ++i)
+        {
+            const GeometrySourceVertex vertex = CanonicalizeVertex(vertices[i]);
+
+            uint32_t slot = HashVertex(vertex) & (tableSize - 1);
+            while (table[slot] != INVALID_INDEX && memcmp(&weldedVertices[table[slot]], &vertex, sizeof(vertex)) != 0)
+            {
+                slot = (slot + 1) & (tableSize - 1);
+            }
+
+            if (table[slot] == INVALID_INDEX)
+            {
+                table[slot] = static_cast<uint32_t>(weldedVertices.size());
+                weldedVertices.push_back(vertex);
+            }
+            remap[i] = table[slot];
+        }
+        return remap;
+    }
+
+    const uint32_t MAX_VALENCE_IN_TABLE = 32;
+
+    struct VertexScoreTables
+    {
+        float cachePositionScores[OPTIMIZER_CACHE_SIZE];
+        float valenceBoostScores[MAX_VALENCE_IN_TABLE + 1];
+
+        VertexScoreTables()
+        {
+            // The vertices of the last triangle get a fixed score to avoid favoring one of its edges
+            for (uint32_t i = 0; i < OPTIMIZER_CACHE_SIZE; ++i)
+            {
+                const float scale = 1.0f / static_cast<float>(OPTIMIZER_CACHE_SIZE - 3);
+                cachePositionScores[i] = i < 3 ? LAST_TRIANGLE_SCORE : std::pow(1.0f - static_cast<float>(i - 3) * scale, CACHE_DECAY_POWER);
+            }
+
+            valenceBoostScores[0] = 0.0f;
+            for (uint32_t i = 1; i <= MAX_VALENCE_IN_TABLE; ++i)
+            {
+                valenceBoostScores[i] = VALENCE_BOOST_SCALE * std::pow(static_cast<float>(i), -VALENCE_BOOST_POWER);
+            }
+        }
+    };
+
+    float ComputeVertexScore(int32_t cachePosition, uint32_t numActiveTriangles)
+    {
+        static const VertexScoreTables tables;
+
+        // No triangle left to use this vertex
+        if (numActiveTriangles == 0)
+        {
+            return -1.0f;
+        }
+
+        const float cacheScore = cachePosition >= 0 ? tables.cachePositionScores[cachePosition] : 0.0f;
+
+        // Prefer vertices with few remaining triangles to finish them off
+        const float valenceScore = numActiveTriangles <= MAX_VALENCE_IN_TABLE ? tables.valenceBoostScores[numActiveTriangles] :
+            VALENCE_BOOST_SCALE * std::pow(static_cast<float>(numActiveTriangles), -VALENCE_BOOST_POWER);
+        return cacheScore + valenceScore;
+    }
+
+    void OptimizeTriangleOrder(std::vector<uint32_t>& indices, uint32_t vertexCount)
+    {
+        const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+        if (triangleCount == 0)
+        {
+            return;
+        }
+
+        // Triangles adjacent to each vertex. The first numActiveTriangles entries are the ones not emitted yet.
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+        for (uint32_t index : indices)
+        {
+            ++adjacencyOffsets[index + 1];
+        }
+        for (uint32_t v = 0; v < vertexCount; ++v)
+        {
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        }
+
+        std::vector<uint32_t> adjacency(indices.size());
+        std::vector<uint32_t> numActiveTriangles(vertexCount, 0);
+        for (uint32_t t = 0; t < triangleCount; ++t)
+        {
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                const uint32_t v = indices[t * 3 + k];
+                adjacency[adjacencyOffsets[v] + numActiveTriangles[v]++] = t;
+            }
+        }
+
+        std::vector<int32_t> cachePositions(vertexCount, -1);
+        std::vector<float> vertexScores(vertexCount);
+        for (uint32_t v = 0; v < vertexCount; ++v)
+        {
+            vertexScores[v] = ComputeVertexScore(-1, numActiveTriangles[v]);
+        }
+
+        std::vector<uint8_t> isEmitted(triangleCount, 0);
+        std::vector<uint32_t> output;
+        output.reserve(indices.size());
+
+        uint32_t cache[OPTIMIZER_CACHE_SIZE + 3];
+        uint32_t cacheCount = 0;
+        uint32_t nextCandidate = 0;
+        uint32_t bestTriangle = INVALID_INDEX;
+
+        for (uint32_t numEmitted = 0; numEmitted < triangleCount; ++numEmitted)
+        {
+            // No cached vertex has a remaining triangle, continue with the next triangle in the input order
+            if (bestTriangle == INVALID_INDEX)
+            {
+                while (isEmitted[nextCandidate])
+                {
+                    ++nextCandidate;
+                }
+                bestTriangle = nextCandidate;
+            }
+
+            const uint32_t triangle[3] = { indices[bestTriangle * 3], indices[bestTriangle * 3 + 1], indices[bestTriangle * 3 + 2] };
+            output.insert(output.end(), triangle, triangle + 3);
+            isEmitted[bestTriangle] = 1;
+
+            // Remove the triangle from the active triangles of its vertices
+            for (uint32_t v : triangle)
+            {
+                uint32_t* begin = &adjacency[adjacencyOffsets[v]];
+                uint32_t* end = begin + numActiveTriangles[v];
+                uint32_t* found = std::find(begin, end, bestTriangle);
+                if (found != end)
+                {
+                    std::swap(*found, *(end - 1));
+                    --numActiveTriangles[v];
+                }
+            }
+
+            // The vertices of the triangle move to the front of the cache
+            uint32_t newCache[OPTIMIZER_CACHE_SIZE + 3];
+            uint32_t newCacheCount = 0;
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                if (std::find(newCache, newCache + newCacheCount, triangle[k]) == newCache + newCacheCount)
+                {
+                    newCache[newCacheCount++] = triangle[k];
+                }
+            }
+            for (uint32_t i = 0; i < cacheCount; ++i)
+            {
+                const uint32_t v = cache[i];
+                if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                {
+                    newCache[newCacheCount++] = v;
+                }
+            }
+
+            for (uint32_t i = 0; i < newCacheCount; ++i)
+            {
+                const uint32_t v = newCache[i];
+                cachePositions[v] = i < OPTIMIZER_CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+                vertexScores[v] = ComputeVertexScore(cachePositions[v], numActiveTriangles[v]);
+            }
+
+            // Rescore the triangles touching the cache, including the vertices which were just evicted
+            bestTriangle = INVALID_INDEX;
+            float bestScore = -1.0f;
+            for (uint32_t i = 0; i < newCacheCount; ++i)
+            {
+                const uint32_t v = newCache[i];
+                for (uint32_t j = 0; j < numActiveTriangles[v]; ++j)
+                {
+                    const uint32_t t = adjacency[adjacencyOffsets[v] + j];
+                    const float score = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+                    if (score > bestScore)
+                    {
+                        bestScore = score;
+                        bestTriangle = t;
+                    }
+                }
+            }
+
+            cacheCount = std::min(newCacheCount, OPTIMIZER_CACHE_SIZE);
+            memcpy(cache, newCache, cacheCount * sizeof(uint32_t));
+        }
+
+        indices.swap(output);
+    }
+
+    // Renumber the vertices in the order of their first reference and drop the unreferenced ones
+    void OptimizeVertexOrder(std::vector<GeometrySourceVertex>& vertices, std::vector<uint32_t>& indices)
+    {
+        std::vector<uint32_t> remap(vertices.size(), INVALID_INDEX);
+        std::vector<GeometrySourceVertex> orderedVertices;
+        orderedVertices.reserve(vertices.size());
+
+        for (uint32_t& index : indices)
+        {
+            if (remap[index] == INVALID_INDEX)
+            {
+                remap[index] = static_cast<uint32_t>(orderedVertices.size());
+                orderedVertices.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+
+        vertices.swap(orderedVertices);
+    }
+}
+
+const void* PreprocessedMesh::GetIndexData() const
+{
+    return indexStride == sizeof(uint16_t) ? static_cast<const void*>(indices16.data()) : static_cast<const void*>(indices32.data());
+}
+
+size_t PreprocessedMesh::GetIndexDataSize() const
+{
+    return static_cast<size_t>(GetIndexCount()) * indexStride;
+}
+
+uint32_t PreprocessedMesh::GetIndexCount() const
+{
+    return static_cast<uint32_t>(indexStride == sizeof(uint16_t) ? indices16.size() : indices32.size());
+}
+
+void PreprocessMesh(const GeometrySourceVertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount,
+    const MeshPreprocessOptions& options, PreprocessedMesh& mesh, MeshPreprocessStats* stats)
+{
+    assert(indexCount % 3 == 0);
+
+    const auto startTime = std::chrono::steady_clock::now();
+
+    std::vector<uint32_t> outputIndices(indices, indices + indexCount);
+    if (options.weldVertices)
+    {
+        const std::vector<uint32_t> remap = WeldVertices(vertices, vertexCount, mesh.vertices);
+        for (uint32_t& index : outputIndices)
+        {
+            assert(index < vertexCount);
+            index = remap[index];
+        }
+    }
+    else
+    {
+        mesh.vertices.assign(vertices, vertices + vertexCount);
+    }
+
+    // Degenerate triangles never produce a hit
+    size_t numKept = 0;
+    for (size_t i = 0; i < outputIndices.size(); i += 3)
+    {
+        const uint32_t a = outputIndices[i];
+        const uint32_t b = outputIndices[i + 1];
+        const uint32_t c = outputIndices[i + 2];
+        if (a != b && b != c && c != a)
+        {
+            outputIndices[numKept++] = a;
+            outputIndices[numKept++] = b;
+            outputIndices[numKept++] = c;
+        }
+    }
+    outputIndices.resize(numKept);
+
+    if (options.optimizeTriangleOrder)
+    {
+        OptimizeTriangleOrder(outputIndices, static_cast<uint32_t>(mesh.vertices.size()));
+    }
+    OptimizeVertexOrder(mesh.vertices, outputIndices);
+
+    // Index 0xFFFF is only a strip cut value for strips, so all 65536 vertices can be addressed
+    const uint32_t outputVertexCount = static_cast<uint32_t>(mesh.vertices.size());
+    mesh.indices16.clear();
+    mesh.indices32.clear();
+    if (options.allow16BitIndices && outputVertexCount <= 65536)
+    {
+        mesh.indexStride = sizeof(uint16_t);
+        mesh.indices16.assign(outputIndices.begin(), outputIndices.end());
+    }
+    else
+    {
+        mesh.indexStride = sizeof(uint32_t);
+        mesh.indices32.swap(outputIndices);
+    }
+
+    if (stats)
+    {
+        stats->milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+        stats->inputVertexCount = vertexCount;
+        stats->outputVertexCount = outputVertexCount;
+        stats->inputTriangleCount = indexCount / 3;
+        stats->outputTriangleCount = mesh.GetIndexCount() / 3;
+        stats->indexStride = mesh.indexStride;
+        stats->inputBytes = static_cast<size_t>(vertexCount) * sizeof(GeometrySourceVertex) + static_cast<size_t>(indexCount) * sizeof(uint32_t);
+        stats->outputBytes = static_cast<size_t>(outputVertexCount) * sizeof(GeometrySourceVertex) + mesh.GetIndexDataSize();
+        stats->inputAcmr = ComputeAcmr(indices, indexCount, vertexCount, ACMR_CACHE_SIZE);
+
+        std::vector<uint32_t> finalIndices(mesh.GetIndexCount());
+        for (uint32_t i = 0; i < mesh.GetIndexCount(); ++i)
+        {
+            finalIndices[i] = mesh.GetIndex(i);
+        }
+        stats->outputAcmr = ComputeAcmr(finalIndices.data(), mesh.GetIndexCount(), outputVertexCount, ACMR_CACHE_SIZE);
+    }
+}
+
+float ComputeAcmr(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize)
+{
+    if (indexCount < 3)
+    {
+        return 0.0f;
+    }
+
+    // A vertex is in the FIFO cache while fewer than cacheSize misses happened after its own miss
+    std::vector<uint32_t> missTimestamps(vertexCount, 0);
+    uint32_t timestamp = cacheSize + 1;
+    uint32_t numMisses = 0;
+    for (uint32_t i = 0; i < indexCount; ++i)
+    {
+        const uint32_t v = indices[i];
+        if (timestamp - missTimestamps[v] > cacheSize)
+        {
+            missTimestamps[v] = timestamp++;
+            ++numMisses;
+        }
+    }
+    return static_cast<float>(numMisses) / static_cast<float>(indexCount / 3);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "GeometryStreams.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Preprocessing of indexed triangle meshes before they are converted into the vertex streams.
+//
+// 1. Weld: vertices whose position, normal and color are bitwise identical are merged (-0 and +0 are treated as equal).
+//    Triangles which become degenerate by the weld are removed.
+// 2. Triangle order: triangles are reordered for a vertex cache with the linear-speed algorithm of Tom Forsyth.
+// 3. Vertex order: vertices are renumbered in the order of their first reference, unreferenced vertices are removed.
+// 4. Index format: 16-bit indices when the vertex count allows it, 32-bit otherwise.
+//
+// This module has no Direct3D12 dependency so that it can be checked and measured by tools/MeshPreprocessTool.
+
+struct MeshPreprocessOptions
+{
+    bool weldVertices = true;
+    bool optimizeTriangleOrder = true;
+    bool allow16BitIndices = true;
+};
+
+struct MeshPreprocessStats
+{
+    uint32_t inputVertexCount;
+    uint32_t outputVertexCount;
+    uint32_t inputTriangleCount;
+    uint32_t outputTriangleCount;   // without the triangles which became degenerate
+    uint32_t indexStride;
+    size_t inputBytes;              // vertices and 32-bit indices
+    size_t outputBytes;             // vertices and indices in the selected index format
+    float inputAcmr;                // average vertex cache misses per triangle, FIFO cache of ACMR_CACHE_SIZE entries
+    float outputAcmr;
+    double milliseconds;
+};
+
+struct PreprocessedMesh
+{
+    std::vector<GeometrySourceVertex> vertices;
+
+    // Only the vector of indexStride is filled
+    uint32_t indexStride = sizeof(uint32_t);
+    std::vector<uint16_t> indices16;
+    std::vector<uint32_t> indices32;
+
+    const void* GetIndexData() const;
+    size_t GetIndexDataSize() const;
+    uint32_t GetIndexCount() const;
+    uint32_t GetIndex(uint32_t i) const { return indexStride == sizeof(uint16_t) ? indices16[i] : indices32[i]; }
+};
+
+// Cache size used for the reported ACMR, a typical size of a post-transform cache
+const uint32_t ACMR_CACHE_SIZE = 16;
+
+// Preprocess a triangle list. indexCount must be a multiple of 3. stats can be nullptr.
+void PreprocessMesh(const GeometrySourceVertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount,
+    const MeshPreprocessOptions& options, PreprocessedMesh& mesh, MeshPreprocessStats* stats = nullptr);
+
+// Average number of misses of a FIFO cache per triangle
+float ComputeAcmr(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize);
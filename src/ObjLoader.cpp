@@ -0,0 +1,746 @@
+#include "ObjLoader.h"
+#include "MappedFile.h"
+#include "PlatformHelpers.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <unordered_map>
+
+namespace
+{
+    // Chunks are small enough to balance the threads and large enough to keep the per-chunk overhead low
+    const uint64_t MIN_CHUNK_SIZE = 1 << 20;
+    const uint32_t CHUNKS_PER_THREAD = 4;
+
+    const int32_t NO_INDEX = INT32_MIN;
+    const uint32_t NO_VERTEX = UINT32_MAX;
+    const float DEFAULT_COLOR[4] = { 0.8f, 0.8f, 0.8f, 1.0f };
+
+    // Powers of ten which are exact in double precision
+    const double POW10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+    const int32_t MAX_EXACT_POW10 = 22;
+
+    // Position and normal indices of a face corner. Positive OBJ indices are stored 0-based, relative ones are
+    // stored relative to the start of the chunk until the merge adds the counts of the preceding chunks.
+    struct ObjCorner
+    {
+        int32_t position;
+        int32_t normal;     // NO_INDEX when the corner has no normal
+    };
+
+    struct ObjGroupStart
+    {
+        uint64_t triangle;
+        std::string name;
+    };
+
+    struct ObjChunk
+    {
+        std::vector<float> positions;
+        std::vector<float> colors;      // empty unless a vertex of the chunk has a color
+        std::vector<float> normals;
+        std::vector<ObjCorner> corners; // 3 per triangle
+        std::vector<uint32_t> relativePositionCorners;
+        std::vector<uint32_t> relativeNormalCorners;
+        std::vector<ObjGroupStart> groups;
+        uint64_t numMalformedLines = 0;
+    };
+
+    struct PendingCorner
+    {
+        ObjCorner corner;
+        bool isPositionRelative;
+        bool isNormalRelative;
+    };
+
+    bool IsSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    const char* SkipSpaces(const char* p, const char* end)
+    {
+        while (p < end && IsSpace(*p))
+        {
+            ++p;
+        }
+        return p;
+    }
+
+    const char* ParseInt(const char* p, const char* end, int64_t& value)
+    {
+        bool isNegative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+        {
+            isNegative = *p == '-';
+            ++p;
+        }
+
+        const char* digitsBegin = p;
+        int64_t result = 0;
+        while (p < end && static_cast<unsigned>(*p - '0') < 10 && result < INT32_MAX)
+        {
+            result = result * 10 + (*p - '0');
+            ++p;
+        }
+        if (p == digitsBegin)
+        {
+            return nullptr;
+        }
+
+        value = isNegative ? -result : result;
+        return p;
+    }
+
+    void ParsePosition(const char* p, const char* end, ObjChunk& chunk)
+    {
+        // x y z, optionally followed by w or by the r g b extension
+        float values[7];
+        uint32_t numValues = 0;
+        for (; numValues < 7; ++numValues)
+        {
+            p = SkipSpaces(p, end);
+            const char* next = ParseObjFloat(p, end, values[numValues]);
+            if (!next)
+            {
+                break;
+            }
+            p = next;
+        }
+
+        if (numValues < 3)
+        {
+            ++chunk.numMalformedLines;
+            return;
+        }
+
+        chunk.positions.insert(chunk.positions.end(), values, values + 3);
+
+        const bool hasColor = numValues >= 6;
+        if (hasColor && chunk.colors.empty())
+        {
+            // Backfill the vertices of the chunk parsed before the first colored one
+            chunk.colors.reserve(chunk.positions.capacity());
+            for (size_t i = 0; i + 3 < chunk.positions.size(); i += 3)
+            {
+                chunk.colors.insert(chunk.colors.end(), DEFAULT_COLOR, DEFAULT_COLOR + 3);
+            }
+        }
+        if (hasColor)
+        {
+            chunk.colors.insert(chunk.colors.end(), values + 3, values + 6);
+        }
+        else if (!chunk.colors.empty())
+        {
+            chunk.colors.insert(chunk.colors.end(), DEFAULT_COLOR, DEFAULT_COLOR + 3);
+        }
+    }
+
+    void ParseNormal(const char* p, const char* end, ObjChunk& chunk)
+    {
+        float values[3];
+        for (float& value : values)
+        {
+            p = SkipSpaces(p, end);
+            p = ParseObjFloat(p, end, value);
+            if (!p)
+            {
+                ++chunk.numMalformedLines;
+                return;
+            }
+        }
+        chunk.normals.insert(chunk.normals.end(), values, values + 3);
+    }
+
+    void EmitCorner(const PendingCorner& pending, ObjChunk& chunk)
+    {
+        const uint32_t cornerIndex = static_cast<uint32_t>(chunk.corners.size());
+        if (pending.isPositionRelative)
+        {
+            chunk.relativePositionCorners.push_back(cornerIndex);
+        }
+        if (pending.isNormalRelative)
+        {
+            chunk.relativeNormalCorners.push_back(cornerIndex);
+        }
+        chunk.corners.push_back(pending.corner);
+    }
+
+    void ParseFace(const char* p, const char* end, ObjChunk& chunk)
+    {
+        const int64_t numChunkPositions = static_cast<int64_t>(chunk.positions.size() / 3);
+        const int64_t numChunkNormals = static_cast<int64_t>(chunk.normals.size() / 3);
+
+        PendingCorner first = {};
+        PendingCorner previous = {};
+        uint32_t numCorners = 0;
+        for (;;)
+        {
+            p = SkipSpaces(p, end);
+            if (p >= end)
+            {
+                break;
+            }
+
+            int64_t position = 0;
+            int64_t normal = 0;
+            p = ParseInt(p, end, position);
+            if (p && p < end && *p == '/')
+            {
+                ++p;
+                // Texture coordinate index, not used
+                int64_t texcoord = 0;
+                if (p < end && *p != '/')
+                {
+                    p = ParseInt(p, end, texcoord);
+                }
+                if (p && p < end && *p == '/')
+                {
+                    p = ParseInt(p + 1, end, normal);
+                }
+            }
+
+            if (!p || position == 0 || (p < end && !IsSpace(*p)))
+            {
+                ++chunk.numMalformedLines;
+                return;
+            }
+
+            PendingCorner corner = {};
+            corner.isPositionRelative = position < 0;
+            corner.corner.position = static_cast<int32_t>(position < 0 ? numChunkPositions + position : position - 1);
+            corner.isNormalRelative = normal < 0;
+            corner.corner.normal = normal == 0 ? NO_INDEX : static_cast<int32_t>(normal < 0 ? numChunkNormals + normal : normal - 1);
+
+            // Fan triangulation of polygons
+            if (numCorners == 0)
+            {
+                first = corner;
+            }
+            else if (numCorners >= 2)
+            {
+                EmitCorner(first, chunk);
+                EmitCorner(previous, chunk);
+                EmitCorner(corner, chunk);
+            }
+            previous = corner;
+            ++numCorners;
+        }
+
+        if (numCorners < 3)
+        {
+            ++chunk.numMalformedLines;
+        }
+    }
+
+    void ParseGroup(const char* p, const char* end, ObjChunk& chunk)
+    {
+        p = SkipSpaces(p, end);
+        while (end > p && IsSpace(end[-1]))
+        {
+            --end;
+        }
+        chunk.groups.push_back({ chunk.corners.size() / 3, std::string(p, end) });
+    }
+
+    void ParseChunk(const char* p, const char* end, ObjChunk& chunk)
+    {
+        // Rough reservations from the typical line lengths, avoid most of the reallocations
+        const size_t size = static_cast<size_t>(end - p);
+        chunk.positions.reserve(size / 40 * 3);
+        chunk.corners.reserve(size / 24 * 3);
+
+        while (p < end)
+        {
+            const char* lineEnd = static_cast<const char*>(memchr(p, '\n', static_cast<size_t>(end - p)));
+            if (!lineEnd)
+            {
+                lineEnd = end;
+            }
+
+            const char* q = SkipSpaces(p, lineEnd);
+            const size_t length = static_cast<size_t>(lineEnd - q);
+            if (length >= 2)
+            {
+                if (q[0] == 'v' && IsSpace(q[1]))
+                {
+                    ParsePosition(q + 2, lineEnd, chunk);
+                }
+                else if (q[0] == 'v' && q[1] == 'n' && length >= 3 && IsSpace(q[2]))
+                {
+                    ParseNormal(q + 3, lineEnd, chunk);
+                }
+                else if (q[0] == 'f' && IsSpace(q[1]))
+                {
+                    ParseFace(q + 2, lineEnd, chunk);
+                }
+                else if ((q[0] == 'o' || q[0] == 'g') && IsSpace(q[1]))
+                {
+                    ParseGroup(q + 2, lineEnd, chunk);
+                }
+            }
+
+            p = lineEnd + 1;
+        }
+    }
+
+    // Unique vertices of a mesh. Corners sharing a position usually share the normal as well, so the vertex of
+    // a position is cached in an array and the hash map is only used for the additional normals of a position.
+    class MeshVertexBuilder
+    {
+    public:
+        MeshVertexBuilder(int32_t minPosition, int32_t maxPosition) :
+            m_minPosition(minPosition),
+            m_firstVertices(static_cast<size_t>(maxPosition - minPosition) + 1, NO_VERTEX)
+        {
+        }
+
+        // Returns the vertex of the corner and whether it was created by this call
+        uint32_t GetVertex(const ObjCorner& corner, uint32_t nextVertex, bool& isNew)
+        {
+            isNew = false;
+            uint32_t& firstVertex = m_firstVertices[static_cast<size_t>(corner.position - m_minPosition)];
+            if (firstVertex == NO_VERTEX)
+            {
+                firstVertex = nextVertex;
+                m_vertexNormals.push_back(corner.normal);
+                isNew = true;
+                return nextVertex;
+            }
+            if (m_vertexNormals[firstVertex] == corner.normal)
+            {
+                return firstVertex;
+            }
+
+            const uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(corner.position)) << 32) | static_cast<uint32_t>(corner.normal);
+            auto [it, isInserted] = m_otherVertices.try_emplace(key, nextVertex);
+            if (isInserted)
+            {
+                m_vertexNormals.push_back(corner.normal);
+                isNew = true;
+            }
+            return it->second;
+        }
+
+    private:
+        int32_t m_minPosition;
+        std::vector<uint32_t> m_firstVertices;
+        std::vector<int32_t> m_vertexNormals;
+        std::unordered_map<uint64_t, uint32_t> m_otherVertices;
+    };
+
+    struct ObjData
+    {
+        std::vector<float> positions;
+        std::vector<float> colors;
+        std::vector<float> normals;
+        std::vector<ObjCorner> corners;
+    };
+
+    uint64_t BuildMesh(const ObjData& data, uint64_t firstTriangle, uint64_t endTriangle, ObjMesh& mesh)
+    {
+        const int64_t numPositions = static_cast<int64_t>(data.positions.size() / 3);
+        const int64_t numNormals = static_cast<int64_t>(data.normals.size() / 3);
+
+        auto isValid = [&](const ObjCorner& corner)
+        {
+            return corner.position >= 0 && corner.position < numPositions &&
+                (corner.normal == NO_INDEX || (corner.normal >= 0 && corner.normal < numNormals));
+        };
+
+        int32_t minPosition = INT32_MAX;
+        int32_t maxPosition = INT32_MIN;
+        for (uint64_t i = firstTriangle * 3; i < endTriangle * 3; ++i)
+        {
+            const ObjCorner& corner = data.corners[i];
+            if (isValid(corner))
+            {
+                minPosition = std::min(minPosition, corner.position);
+                maxPosition = std::max(maxPosition, corner.position);
+            }
+        }
+        if (minPosition > maxPosition)
+        {
+            return endTriangle - firstTriangle;
+        }
+
+        MeshVertexBuilder builder(minPosition, maxPosition);
+        std::vector<uint8_t> needsNormal;
+        uint64_t numInvalidTriangles = 0;
+        mesh.indices.reserve(static_cast<size_t>(endTriangle - firstTriangle) * 3);
+
+        for (uint64_t triangle = firstTriangle; triangle < endTriangle; ++triangle)
+        {
+            const ObjCorner* corners = &data.corners[triangle * 3];
+            if (!isValid(corners[0]) || !isValid(corners[1]) || !isValid(corners[2]))
+            {
+                ++numInvalidTriangles;
+                continue;
+            }
+
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                bool isNew = false;
+                const uint32_t vertexIndex = builder.GetVertex(corners[k], static_cast<uint32_t>(mesh.vertices.size()), isNew);
+                if (isNew)
+                {
+                    GeometrySourceVertex vertex = {};
+                    const size_t position = static_cast<size_t>(corners[k].position) * 3;
+                    memcpy(vertex.position, &data.positions[position], sizeof(vertex.position));
+                    if (data.colors.empty())
+                    {
+                        memcpy(vertex.color, DEFAULT_COLOR, sizeof(vertex.color));
+                    }
+                    else
+                    {
+                        memcpy(vertex.color, &data.colors[position], sizeof(float) * 3);
+                        vertex.color[3] = 1.0f;
+                    }
+                    if (corners[k].normal != NO_INDEX)
+                    {
+                        memcpy(vertex.normal, &data.normals[static_cast<size_t>(corners[k].normal) * 3], sizeof(vertex.normal));
+                    }
+                    mesh.vertices.push_back(vertex);
+                    needsNormal.push_back(corners[k].normal == NO_INDEX);
+                }
+                mesh.indices.push_back(vertexIndex);
+            }
+        }
+
+        // Area weighted normals for the vertices without one
+        if (std::find(needsNormal.begin(), needsNormal.end(), 1) != needsNormal.end())
+        {
+            for (size_t i = 0; i < mesh.indices.size(); i += 3)
+            {
+                const float* p0 = mesh.vertices[mesh.indices[i]].position;
+                const float* p1 = mesh.vertices[mesh.indices[i + 1]].position;
+                const float* p2 = mesh.vertices[mesh.indices[i + 2]].position;
+                const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+                const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+                const float faceNormal[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+                for (uint32_t k = 0; k < 3; ++k)
+                {
+                    const uint32_t v = mesh.indices[i + k];
+                    if (needsNormal[v])
+                    {
+                        for (uint32_t axis = 0; axis < 3; ++axis)
+                        {
+                            mesh.vertices[v].normal[axis] += faceNormal[axis];
+                        }
+                    }
+                }
+            }
+
+            for (size_t v = 0; v < mesh.vertices.size(); ++v)
+            {
+                if (!needsNormal[v])
+                {
+                    continue;
+                }
+
+                float* normal = mesh.vertices[v].normal;
+                const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+                if (length > 0.0f)
+                {
+                    normal[0] /= length;
+                    normal[1] /= length;
+                    normal[2] /= length;
+                }
+                else
+                {
+                    normal[0] = 0.0f;
+                    normal[1] = 1.0f;
+                    normal[2] = 0.0f;
+                }
+            }
+        }
+
+        return numInvalidTriangles;
+    }
+
+    double MillisecondsSince(std::chrono::steady_clock::time_point startTime)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    }
+}
+
+const char* ParseObjFloat(const char* p, const char* end, float& value)
+{
+    bool isNegative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        isNegative = *p == '-';
+        ++p;
+    }
+
+    // Up to 19 significant digits fit in the mantissa, the remaining ones only affect the exponent
+    uint64_t mantissa = 0;
+    int32_t numSignificantDigits = 0;
+    int32_t exponent = 0;
+    bool hasDigits = false;
+
+    while (p < end && static_cast<unsigned>(*p - '0') < 10)
+    {
+        if (numSignificantDigits < 19)
+        {
+            mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+            numSignificantDigits += mantissa != 0;
+        }
+        else
+        {
+            ++exponent;
+        }
+        hasDigits = true;
+        ++p;
+    }
+
+    if (p < end && *p == '.')
+    {
+        ++p;
+        while (p < end && static_cast<unsigned>(*p - '0') < 10)
+        {
+            if (numSignificantDigits < 19)
+            {
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+                numSignificantDigits += mantissa != 0;
+                --exponent;
+            }
+            hasDigits = true;
+            ++p;
+        }
+    }
+
+    if (!hasDigits)
+    {
+        return nullptr;
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        int64_t explicitExponent = 0;
+        const char* next = ParseInt(p + 1, end, explicitExponent);
+        if (next)
+        {
+            exponent += static_cast<int32_t>(std::clamp<int64_t>(explicitExponent, -1000, 1000));
+            p = next;
+        }
+    }
+
+    double result = static_cast<double>(mantissa);
+    if (mantissa != 0 && exponent != 0)
+    {
+        if (exponent >= -MAX_EXACT_POW10 && exponent <= MAX_EXACT_POW10)
+        {
+            // One correctly rounded operation for the common case
+            result = exponent < 0 ? result / POW10[-exponent] : result * POW10[exponent];
+        }
+        else
+        {
+            result *= std::pow(10.0, exponent);
+        }
+    }
+
+    value = static_cast<float>(isNegative ? -result : result);
+    return p;
+}
+
+bool ParseObj(const char* data, size_t size, ThreadPool& threadPool, std::vector<ObjMesh>& meshes, ObjLoadStats* stats)
+{
+    meshes.clear();
+
+    // Line aligned chunks
+    const uint32_t numThreads = threadPool.GetNumThreads();
+    const uint64_t maxChunks = std::max<uint64_t>(size / MIN_CHUNK_SIZE, 1);
+    const uint32_t numChunks = static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(numThreads) * CHUNKS_PER_THREAD, maxChunks));
+
+    std::vector<size_t> chunkBegins(numChunks + 1, size);
+    chunkBegins[0] = 0;
+    for (uint32_t i = 1; i < numChunks; ++i)
+    {
+        size_t begin = std::max(size / numChunks * i, chunkBegins[i - 1]);
+        const void* newline = begin < size ? memchr(data + begin, '\n', size - begin) : nullptr;
+        chunkBegins[i] = newline ? static_cast<size_t>(static_cast<const char*>(newline) - data) + 1 : size;
+    }
+
+    auto parseStartTime = std::chrono::steady_clock::now();
+    std::vector<ObjChunk> chunks(numChunks);
+    threadPool.ParallelFor(numChunks, [&](uint32_t i)
+        {
+            ParseChunk(data + chunkBegins[i], data + chunkBegins[i + 1], chunks[i]);
+        });
+    const double parseMilliseconds = MillisecondsSince(parseStartTime);
+
+    // Prefix sums of the chunk counts give the place of every chunk in the merged arrays
+    const auto mergeStartTime = std::chrono::steady_clock::now();
+    std::vector<uint64_t> positionBases(numChunks + 1, 0);
+    std::vector<uint64_t> normalBases(numChunks + 1, 0);
+    std::vector<uint64_t> cornerBases(numChunks + 1, 0);
+    bool hasColors = false;
+    uint64_t numMalformedLines = 0;
+    for (uint32_t i = 0; i < numChunks; ++i)
+    {
+        positionBases[i + 1] = positionBases[i] + chunks[i].positions.size() / 3;
+        normalBases[i + 1] = normalBases[i] + chunks[i].normals.size() / 3;
+        cornerBases[i + 1] = cornerBases[i] + chunks[i].corners.size();
+        hasColors = hasColors || !chunks[i].colors.empty();
+        numMalformedLines += chunks[i].numMalformedLines;
+    }
+
+    if (positionBases[numChunks] > static_cast<uint64_t>(INT32_MAX) || normalBases[numChunks] > static_cast<uint64_t>(INT32_MAX))
+    {
+        OutputDebugStringA("ObjLoader: too many vertices\n");
+        return false;
+    }
+
+    ObjData objData;
+    objData.positions.resize(positionBases[numChunks] * 3);
+    objData.normals.resize(normalBases[numChunks] * 3);
+    objData.corners.resize(cornerBases[numChunks]);
+    if (hasColors)
+    {
+        objData.colors.resize(objData.positions.size());
+    }
+
+    threadPool.ParallelFor(numChunks, [&](uint32_t i)
+        {
+            ObjChunk& chunk = chunks[i];
+            std::copy(chunk.positions.begin(), chunk.positions.end(), objData.positions.begin() + positionBases[i] * 3);
+            std::copy(chunk.normals.begin(), chunk.normals.end(), objData.normals.begin() + normalBases[i] * 3);
+            if (hasColors && chunk.colors.empty())
+            {
+                for (uint64_t v = positionBases[i]; v < positionBases[i + 1]; ++v)
+                {
+                    std::copy(DEFAULT_COLOR, DEFAULT_COLOR + 3, objData.colors.begin() + v * 3);
+                }
+            }
+            else if (hasColors)
+            {
+                std::copy(chunk.colors.begin(), chunk.colors.end(), objData.colors.begin() + positionBases[i] * 3);
+            }
+
+            ObjCorner* corners = objData.corners.data() + cornerBases[i];
+            std::copy(chunk.corners.begin(), chunk.corners.end(), corners);
+            for (uint32_t corner : chunk.relativePositionCorners)
+            {
+                corners[corner].position += static_cast<int32_t>(positionBases[i]);
+            }
+            for (uint32_t corner : chunk.relativeNormalCorners)
+            {
+                corners[corner].normal += static_cast<int32_t>(normalBases[i]);
+            }
+
+            // Release the chunk memory early, the merged arrays hold a second copy. The groups are still needed.
+            chunk.positions = std::vector<float>();
+            chunk.colors = std::vector<float>();
+            chunk.normals = std::vector<float>();
+            chunk.corners = std::vector<ObjCorner>();
+        });
+
+    // Every group starts a mesh. Triangles before the first group form an unnamed mesh.
+    std::vector<ObjGroupStart> meshStarts;
+    meshStarts.push_back({ 0, "default" });
+    for (uint32_t i = 0; i < numChunks; ++i)
+    {
+        for (ObjGroupStart& group : chunks[i].groups)
+        {
+            group.triangle += cornerBases[i] / 3;
+            if (meshStarts.back().triangle == group.triangle)
+            {
+                meshStarts.back().name = std::move(group.name);
+            }
+            else
+            {
+                meshStarts.push_back(std::move(group));
+            }
+        }
+    }
+    const uint64_t numTriangles = cornerBases[numChunks] / 3;
+    const double mergeMilliseconds = MillisecondsSince(mergeStartTime);
+
+    // The meshes are built in parallel, the largest first so that they do not end up last
+    const auto buildStartTime = std::chrono::steady_clock::now();
+    std::vector<ObjMesh> builtMeshes(meshStarts.size());
+    std::vector<uint64_t> numInvalidTriangles(meshStarts.size(), 0);
+    std::vector<uint32_t> buildOrder(meshStarts.size());
+    auto getEndTriangle = [&](size_t i) { return i + 1 < meshStarts.size() ? meshStarts[i + 1].triangle : numTriangles; };
+    for (uint32_t i = 0; i < buildOrder.size(); ++i)
+    {
+        buildOrder[i] = i;
+    }
+    std::sort(buildOrder.begin(), buildOrder.end(), [&](uint32_t a, uint32_t b)
+        {
+            return getEndTriangle(a) - meshStarts[a].triangle > getEndTriangle(b) - meshStarts[b].triangle;
+        });
+
+    threadPool.ParallelFor(static_cast<uint32_t>(meshStarts.size()), [&](uint32_t i)
+        {
+            const uint32_t meshIndex = buildOrder[i];
+            builtMeshes[meshIndex].name = meshStarts[meshIndex].name;
+            numInvalidTriangles[meshIndex] = BuildMesh(objData, meshStarts[meshIndex].triangle, getEndTriangle(meshIndex), builtMeshes[meshIndex]);
+        });
+
+    uint64_t numOutputTriangles = 0;
+    uint64_t totalInvalidTriangles = 0;
+    for (size_t i = 0; i < builtMeshes.size(); ++i)
+    {
+        totalInvalidTriangles += numInvalidTriangles[i];
+        if (!builtMeshes[i].indices.empty())
+        {
+            numOutputTriangles += builtMeshes[i].indices.size() / 3;
+            meshes.push_back(std::move(builtMeshes[i]));
+        }
+    }
+    const double buildMilliseconds = MillisecondsSince(buildStartTime);
+
+    if (numMalformedLines > 0 || totalInvalidTriangles > 0)
+    {
+        OutputDebugStringA(std::format("ObjLoader: skipped {} malformed lines and {} triangles with invalid indices\n",
+            numMalformedLines, totalInvalidTriangles).c_str());
+    }
+
+    if (stats)
+    {
+        stats->fileSize = size;
+        stats->numThreads = numThreads;
+        stats->numChunks = numChunks;
+        stats->numPositions = positionBases[numChunks];
+        stats->numNormals = normalBases[numChunks];
+        stats->numTriangles = numOutputTriangles;
+        stats->numInvalidTriangles = totalInvalidTriangles;
+        stats->numMeshes = static_cast<uint32_t>(meshes.size());
+        stats->parseMilliseconds = parseMilliseconds;
+        stats->mergeMilliseconds = mergeMilliseconds;
+        stats->buildMilliseconds = buildMilliseconds;
+    }
+
+    return !meshes.empty();
+}
+
+bool LoadObjFile(const char* path, ThreadPool& threadPool, std::vector<ObjMesh>& meshes, ObjLoadStats* stats)
+{
+    const auto mapStartTime = std::chrono::steady_clock::now();
+    MappedFile file;
+    if (!file.Open(path))
+    {
+        return false;
+    }
+    const double mapMilliseconds = MillisecondsSince(mapStartTime);
+
+    const bool isLoaded = ParseObj(file.GetData(), static_cast<size_t>(file.GetSize()), threadPool, meshes, stats);
+    if (stats)
+    {
+        stats->mapMilliseconds = mapMilliseconds;
+    }
+
+    if (!isLoaded)
+    {
+        OutputDebugStringA(std::format("ObjLoader: no triangle in {}\n", path).c_str());
+    }
+    return isLoaded;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "GeometryStreams.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// Multithreaded Wavefront OBJ loader.
+//
+// The file is memory mapped and split into line aligned chunks which are parsed in parallel with a hand-written
+// number parser. The per-chunk positions, normals and faces are merged with prefix sums of the chunk counts, and
+// every object/group ("o", "g") becomes one mesh whose vertices are the unique position/normal pairs of its faces.
+//
+// Supported: "v x y z [r g b]", "vn", "f" with v, v/vt, v//vn and v/vt/vn corners, negative (relative) indices and
+// polygons (fan triangulated), "o" and "g". Texture coordinates, materials and the remaining statements are skipped.
+// Vertices without a normal get the area weighted normal of their faces, vertices without a color are light gray.
+//
+// This module has no Direct3D12 dependency so that it can be measured by tools/ObjLoaderBenchmark.
+
+struct ObjMesh
+{
+    std::string name;
+    std::vector<GeometrySourceVertex> vertices;
+    std::vector<uint32_t> indices;
+};
+
+struct ObjLoadStats
+{
+    uint64_t fileSize;
+    uint32_t numThreads;
+    uint32_t numChunks;
+    uint64_t numPositions;
+    uint64_t numNormals;
+    uint64_t numTriangles;
+    uint64_t numInvalidTriangles;   // triangles referencing missing positions or normals, skipped
+    uint32_t numMeshes;
+    double mapMilliseconds;
+    double parseMilliseconds;       // parallel parse of the chunks
+    double mergeMilliseconds;       // prefix sums and concatenation of the chunks
+    double buildMilliseconds;       // per mesh vertex deduplication and normal generation
+};
+
+// Load an OBJ file. Returns false when the file cannot be read or contains no triangle. stats can be nullptr.
+bool LoadObjFile(const char* path, ThreadPool& threadPool, std::vector<ObjMesh>& meshes, ObjLoadStats* stats = nullptr);
+
+// Parse OBJ text in memory
+bool ParseObj(const char* data, size_t size, ThreadPool& threadPool, std::vector<ObjMesh>& meshes, ObjLoadStats* stats = nullptr);
+
+// Parse a decimal floating point number ([+-]digits[.digits][(e|E)[+-]digits]) starting at begin.
+// Returns the end of the number, or nullptr when no number starts at begin.
+const char* ParseObjFloat(const char* begin, const char* end, float& value);
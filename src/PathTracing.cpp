@@ -0,0 +1,214 @@
+#include "PathTracing.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    uint32_t PcgHash(uint32_t value)
+    {
+        const uint32_t state = value * 747796405u + 2891336453u;
+        const uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+        return (word >> 22u) ^ word;
+    }
+
+    // Orthonormal basis around a unit vector (Duff et al. 2017)
+    void GetBasis(const float n[3], float tangent[3], float bitangent[3])
+    {
+        const float sign = std::copysign(1.0f, n[2]);
+        const float a = -1.0f / (sign + n[2]);
+        const float b = n[0] * n[1] * a;
+        tangent[0] = 1.0f + sign * n[0] * n[0] * a;
+        tangent[1] = sign * b;
+        tangent[2] = -sign * n[0];
+        bitangent[0] = b;
+        bitangent[1] = sign + n[1] * n[1] * a;
+        bitangent[2] = -n[1];
+    }
+
+    // Direction at the polar angle cosine and the azimuth u around the axis
+    void GetDirectionAround(const float axis[3], float cosTheta, float u, float direction[3])
+    {
+        float tangent[3];
+        float bitangent[3];
+        GetBasis(axis, tangent, bitangent);
+        const float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+        const float phi = 2.0f * PATH_TRACING_PI * u;
+        const float x = std::cos(phi) * sinTheta;
+        const float y = std::sin(phi) * sinTheta;
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            direction[i] = tangent[i] * x + bitangent[i] * y + axis[i] * cosTheta;
+        }
+    }
+
+    bool IsInSun(const float direction[3])
+    {
+        return direction[0] * SUN_DIRECTION[0] + direction[1] * SUN_DIRECTION[1] + direction[2] * SUN_DIRECTION[2] >= SUN_COS_ANGULAR_RADIUS;
+    }
+}
+
+uint32_t InitPathRandom(uint32_t pixelIndex, uint32_t sampleIndex)
+{
+    return PcgHash(pixelIndex ^ PcgHash(sampleIndex));
+}
+
+float NextPathRandom(uint32_t& state)
+{
+    state = PcgHash(state);
+    return static_cast<float>(state >> 8) * (1.0f / 16777216.0f);
+}
+
+PathSampler InitPathSampler(SamplerType type, uint32_t x, uint32_t y, uint32_t width, uint32_t sampleIndex)
+{
+    const uint32_t pixelIndex = y * width + x;
+    PathSampler sampler;
+    sampler.type = type;
+    sampler.x = x;
+    sampler.y = y;
+    sampler.pixelSeed = PcgHash(pixelIndex);
+    sampler.sampleIndex = sampleIndex;
+    sampler.random = InitPathRandom(pixelIndex, sampleIndex);
+    return sampler;
+}
+
+void GetBounceSamples(PathSampler& sampler, const SamplerTables* tables, uint32_t bounce, float u[RANDOM_NUMBERS_PER_BOUNCE])
+{
+    if (sampler.type == SamplerType::Random || !tables)
+    {
+        for (uint32_t i = 0; i < RANDOM_NUMBERS_PER_BOUNCE; ++i)
+        {
+            u[i] = NextPathRandom(sampler.random);
+        }
+        return;
+    }
+
+    const bool isSobol = sampler.type == SamplerType::Sobol;
+    for (uint32_t group = 0; group < SAMPLE_GROUPS_PER_BOUNCE; ++group)
+    {
+        const uint32_t groupSeed = HashSamplerSeed(isSobol ? sampler.pixelSeed : 0, bounce * SAMPLE_GROUPS_PER_BOUNCE + group);
+        const uint32_t index = NestedUniformScramble(sampler.sampleIndex, groupSeed);
+        for (uint32_t i = SAMPLE_GROUP_OFFSETS[group]; i < SAMPLE_GROUP_OFFSETS[group + 1]; ++i)
+        {
+            const uint32_t dimension = i - SAMPLE_GROUP_OFFSETS[group];
+            const uint32_t value = isSobol ?
+                NestedUniformScramble(GetSobolSample(*tables, index, dimension), HashSamplerSeed(groupSeed, dimension)) :
+                GetLatticeSample(*tables, index, dimension) + GetBlueNoiseSample(*tables, sampler.x, sampler.y, bounce * RANDOM_NUMBERS_PER_BOUNCE + i);
+            u[i] = SampleToFloat(value);
+        }
+    }
+}
+
+void GetEnvironmentRadiance(const float direction[3], bool isSunEnabled, float radiance[3])
+{
+    const float sun = isSunEnabled && IsInSun(direction) ? SUN_RADIANCE : 0.0f;
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        radiance[i] = SKY_RADIANCE[i] + sun;
+    }
+}
+
+float SampleEnvironment(float u0, float u1, float u2, bool isSunEnabled, float direction[3])
+{
+    if (isSunEnabled && u0 < SUN_SAMPLE_PROBABILITY)
+    {
+        GetDirectionAround(SUN_DIRECTION, 1.0f - u1 * (1.0f - SUN_COS_ANGULAR_RADIUS), u2, direction);
+    }
+    else
+    {
+        const float axis[3] = { 0.0f, 0.0f, 1.0f };
+        GetDirectionAround(axis, 1.0f - 2.0f * u1, u2, direction);
+    }
+    return GetEnvironmentPdf(direction, isSunEnabled);
+}
+
+float GetEnvironmentPdf(const float direction[3], bool isSunEnabled)
+{
+    if (!isSunEnabled)
+    {
+        return 1.0f / (4.0f * PATH_TRACING_PI);
+    }
+    const float sunPdf = IsInSun(direction) ? 1.0f / SUN_SOLID_ANGLE : 0.0f;
+    return SUN_SAMPLE_PROBABILITY * sunPdf + (1.0f - SUN_SAMPLE_PROBABILITY) / (4.0f * PATH_TRACING_PI);
+}
+
+void SampleCosineHemisphere(const float normal[3], float u1, float u2, float direction[3])
+{
+    GetDirectionAround(normal, std::sqrt(1.0f - u1), u2, direction);
+}
+
+float GetPowerHeuristic(float pdf, float otherPdf)
+{
+    const float pdf2 = pdf * pdf;
+    const float sum = pdf2 + otherPdf * otherPdf;
+    return sum > 0.0f ? pdf2 / sum : 0.0f;
+}
+
+void GetEnvironmentContribution(const float direction[3], const float throughput[3], uint32_t bounce, float bsdfPdf, const PathTracingSettings& settings, float contribution[3])
+{
+    float environment[3];
+    GetEnvironmentRadiance(direction, settings.isSunEnabled, environment);
+    const float weight = bounce == 0 || !settings.isNeeEnabled ? 1.0f : GetPowerHeuristic(bsdfPdf, GetEnvironmentPdf(direction, settings.isSunEnabled));
+    for (uint32_t j = 0; j < 3; ++j)
+    {
+        contribution[j] = throughput[j] * environment[j] * weight;
+    }
+}
+
+void GetShadingNormal(const float worldNormal[3], const float rayDirection[3], float normal[3])
+{
+    const float length = std::sqrt(worldNormal[0] * worldNormal[0] + worldNormal[1] * worldNormal[1] + worldNormal[2] * worldNormal[2]);
+    const float facing = worldNormal[0] * rayDirection[0] + worldNormal[1] * rayDirection[1] + worldNormal[2] * rayDirection[2] > 0.0f ? -1.0f : 1.0f;
+    for (uint32_t j = 0; j < 3; ++j)
+    {
+        normal[j] = length > 0.0f ? worldNormal[j] * facing / length : 0.0f;
+    }
+}
+
+bool SampleLight(const float normal[3], const float albedo[3], const float throughput[3], const float u[RANDOM_NUMBERS_PER_BOUNCE], const PathTracingSettings& settings, float direction[3], float contribution[3])
+{
+    if (!settings.isNeeEnabled)
+    {
+        return false;
+    }
+    const float lightPdf = SampleEnvironment(u[0], u[1], u[2], settings.isSunEnabled, direction);
+    const float lightCos = normal[0] * direction[0] + normal[1] * direction[1] + normal[2] * direction[2];
+    if (lightCos <= 0.0f || lightPdf <= 0.0f)
+    {
+        return false;
+    }
+
+    float environment[3];
+    GetEnvironmentRadiance(direction, settings.isSunEnabled, environment);
+    const float weight = GetPowerHeuristic(lightPdf, lightCos / PATH_TRACING_PI);
+    for (uint32_t j = 0; j < 3; ++j)
+    {
+        contribution[j] = throughput[j] * albedo[j] / PATH_TRACING_PI * lightCos * environment[j] / lightPdf * weight;
+    }
+    return true;
+}
+
+bool ContinuePath(const float normal[3], const float albedo[3], const float u[RANDOM_NUMBERS_PER_BOUNCE], uint32_t bounce, const PathTracingSettings& settings, float direction[3], float& bsdfPdf, float throughput[3])
+{
+    // The cosine and the pdf cancel the 1 / pi of the diffuse BSDF
+    SampleCosineHemisphere(normal, u[3], u[4], direction);
+    bsdfPdf = std::max(normal[0] * direction[0] + normal[1] * direction[1] + normal[2] * direction[2], 0.0f) / PATH_TRACING_PI;
+    for (uint32_t j = 0; j < 3; ++j)
+    {
+        throughput[j] *= albedo[j];
+    }
+
+    // Russian roulette
+    if (bounce + 1 >= settings.rouletteStartBounce)
+    {
+        const float survival = std::min(std::max({ throughput[0], throughput[1], throughput[2] }), ROULETTE_MAX_SURVIVAL);
+        if (u[5] >= survival)
+        {
+            return false;
+        }
+        for (uint32_t j = 0; j < 3; ++j)
+        {
+            throughput[j] /= survival;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "Sampler.h"
+#include <cstdint>
+
+// Path tracing estimator of every render mode, shared by RayGenShader, the wavefront stages and the inline RayQuery
+// shader (shaders/PathTracing.hlsli mirrors this module) and by CpuRaytracer::RenderPathTraced() and
+// CpuRaytracer::RenderWavefront(), so that all of them converge to the same image sample by sample.
+//
+// Surfaces are diffuse with the vertex color as albedo. The only light is the environment: a constant sky and a sun
+// disk around SUN_DIRECTION. Every bounce
+//   1. samples the environment (the sun cone or the whole sphere) and traces an occlusion-only shadow ray,
+//   2. samples the cosine weighted hemisphere to continue the path,
+// and the environment seen by either sample is weighted with the power heuristic, so neither the small bright sun nor
+// the large dim sky is sampled badly. Paths are cut by Russian roulette on the throughput after
+// rouletteStartBounce bounces, and end at the hit after maxBounces bounces: that hit is not light sampled, as the
+// environment its BSDF sample would see is not traced either, so that the estimator converges to the same image
+// with and without the light samples.
+//
+// Every bounce consumes RANDOM_NUMBERS_PER_BOUNCE random numbers in a fixed order whether they are used or not, in
+// sample groups that are stratified together by the low-discrepancy samplers of Sampler.h. The Random sampler is a PCG
+// hash sequence per pixel and sample.
+//
+// This module has no Direct3D12 dependency.
+
+const float PATH_TRACING_PI = 3.14159265f;
+
+const uint32_t DEFAULT_MAX_BOUNCES = 8;
+const uint32_t DEFAULT_ROULETTE_START_BOUNCE = 3;
+const float ROULETTE_MAX_SURVIVAL = 0.95f;
+
+// Sun disk of 0.05 radians radius, its radiance gives an irradiance of pi at normal incidence, so that a white surface
+// facing the sun reflects a radiance of 1
+const float SUN_DIRECTION[3] = { 0.40824829f, 0.81649658f, 0.40824829f };     // normalize(0.5, 1, 0.5)
+const float SUN_COS_ANGULAR_RADIUS = 0.99875026f;
+const float SUN_SOLID_ANGLE = 2.0f * PATH_TRACING_PI * (1.0f - SUN_COS_ANGULAR_RADIUS);
+const float SUN_RADIANCE = PATH_TRACING_PI / SUN_SOLID_ANGLE;
+const float SKY_RADIANCE[3] = { 0.2f, 0.4f, 0.6f };
+
+// Probability of sampling the sun cone instead of the sphere for the shadow ray
+const float SUN_SAMPLE_PROBABILITY = 0.5f;
+
+// Light selection and two for the light direction, two for the BSDF direction, one for Russian roulette
+const uint32_t RANDOM_NUMBERS_PER_BOUNCE = 6;
+
+// Sample groups of a bounce by their first random number: the light sample u[0..2], the BSDF sample u[3..4] and
+// Russian roulette u[5]
+const uint32_t SAMPLE_GROUPS_PER_BOUNCE = 3;
+const uint32_t SAMPLE_GROUP_OFFSETS[SAMPLE_GROUPS_PER_BOUNCE + 1] = { 0, 3, 5, RANDOM_NUMBERS_PER_BOUNCE };
+
+struct PathTracingSettings
+{
+    uint32_t maxBounces = DEFAULT_MAX_BOUNCES;
+    uint32_t rouletteStartBounce = DEFAULT_ROULETTE_START_BOUNCE;
+
+    // Light samples with the shadow rays, without them only the BSDF samples see the environment (PERMUTATION_DISABLE_NEE)
+    bool isNeeEnabled = true;
+
+    // Test settings of the CPU backend, a furnace with a white albedo and the sky alone must render the sky everywhere
+    bool isSunEnabled = true;
+    float albedoOverride = -1.0f;           // negative for the vertex colors
+
+    // Sobol and Lattice read the tables, without them the Random sampler is used
+    SamplerType samplerType = SamplerType::Random;
+    const SamplerTables* samplerTables = nullptr;
+};
+
+uint32_t InitPathRandom(uint32_t pixelIndex, uint32_t sampleIndex);
+float NextPathRandom(uint32_t& state);      // [0, 1)
+
+// Random numbers of one path
+struct PathSampler
+{
+    SamplerType type;
+    uint32_t x;
+    uint32_t y;
+    uint32_t pixelSeed;         // scramble seed of the Sobol sampler
+    uint32_t sampleIndex;
+    uint32_t random;            // state of the Random sampler
+};
+
+PathSampler InitPathSampler(SamplerType type, uint32_t x, uint32_t y, uint32_t width, uint32_t sampleIndex);
+
+// The RANDOM_NUMBERS_PER_BOUNCE random numbers of a bounce in [0, 1). A sample group reads the point of its sampler at
+// the sample index shuffled with a seed of the group, of the pixel for Sobol, shared by the pixels for Lattice.
+void GetBounceSamples(PathSampler& sampler, const SamplerTables* tables, uint32_t bounce, float u[RANDOM_NUMBERS_PER_BOUNCE]);
+
+// Radiance of the environment in a direction
+void GetEnvironmentRadiance(const float direction[3], bool isSunEnabled, float radiance[3]);
+
+// Sample a direction of the environment and return its solid angle pdf, the pdf of the mixture of both strategies
+float SampleEnvironment(float u0, float u1, float u2, bool isSunEnabled, float direction[3]);
+float GetEnvironmentPdf(const float direction[3], bool isSunEnabled);
+
+// Cosine weighted direction around the normal, the pdf is cos / pi
+void SampleCosineHemisphere(const float normal[3], float u1, float u2, float direction[3]);
+
+float GetPowerHeuristic(float pdf, float otherPdf);
+
+// The steps of a bounce, in the order of TracePath() in shaders/Raytracing.hlsl. A megakernel runs them in one loop,
+// the wavefront mode splits them over its stages with the path state in the queues.
+
+// Radiance added by the environment seen by the camera ray at bounce 0 or by the BSDF sample of the last bounce,
+// weighted against the light sample of that bounce
+void GetEnvironmentContribution(const float direction[3], const float throughput[3], uint32_t bounce, float bsdfPdf, const PathTracingSettings& settings, float contribution[3]);
+
+// World space normal of a hit normalized and turned to face the ray
+void GetShadingNormal(const float worldNormal[3], const float rayDirection[3], float normal[3]);
+
+// Light sample of a bounce: the direction of the shadow ray and the radiance it adds when it is unoccluded. False when
+// NEE is disabled or the sample is below the surface, no shadow ray is traced then.
+bool SampleLight(const float normal[3], const float albedo[3], const float throughput[3], const float u[RANDOM_NUMBERS_PER_BOUNCE], const PathTracingSettings& settings, float direction[3], float contribution[3]);
+
+// BSDF sample and Russian roulette of a bounce: the direction of the continuation ray, its pdf and the throughput.
+// False when the roulette ends the path.
+bool ContinuePath(const float normal[3], const float albedo[3], const float u[RANDOM_NUMBERS_PER_BOUNCE], uint32_t bounce, const PathTracingSettings& settings, float direction[3], float& bsdfPdf, float throughput[3]);
@@ -0,0 +1,133 @@
+#include "PipelineStackSize.h"
+#include "PlatformHelpers.h"
+#include <algorithm>
+#include <format>
+
+namespace
+{
+    const uint64_t NOT_COMPUTED = ~0ull;
+}
+
+void PipelineStackGraph::Reset()
+{
+    m_shaders.clear();
+    m_hitGroups.clear();
+    m_misses.clear();
+}
+
+uint32_t PipelineStackGraph::AddShader(PipelineShaderStage stage, uint64_t stackSize)
+{
+    Shader shader;
+    shader.stage = stage;
+    shader.stackSize = stackSize;
+    m_shaders.push_back(shader);
+    return static_cast<uint32_t>(m_shaders.size() - 1);
+}
+
+void PipelineStackGraph::AddHitGroup(uint32_t rayType, uint32_t closestHit, uint32_t anyHit, uint32_t intersection)
+{
+    m_hitGroups.push_back({ rayType, closestHit, anyHit, intersection });
+}
+
+void PipelineStackGraph::AddMiss(uint32_t rayType, uint32_t miss)
+{
+    m_misses.emplace_back(rayType, miss);
+}
+
+void PipelineStackGraph::AddTrace(uint32_t shader, uint32_t rayType)
+{
+    const PipelineShaderStage stage = m_shaders[shader].stage;
+    if (stage == PipelineShaderStage::AnyHit || stage == PipelineShaderStage::Intersection)
+    {
+        OutputDebugStringA(std::format("PipelineStackGraph: shader {} cannot trace rays\n", shader).c_str());
+        return;
+    }
+    std::vector<uint32_t>& tracedRayTypes = m_shaders[shader].tracedRayTypes;
+    if (std::find(tracedRayTypes.begin(), tracedRayTypes.end(), rayType) == tracedRayTypes.end())
+    {
+        tracedRayTypes.push_back(rayType);
+    }
+}
+
+uint64_t PipelineStackGraph::ComputeStackSize(uint32_t maxTraceRecursionDepth) const
+{
+    // One entry per shader and depth, the graphs are small but a shader is reached on many paths
+    std::vector<uint64_t> memo(m_shaders.size() * (static_cast<size_t>(maxTraceRecursionDepth) + 1), NOT_COMPUTED);
+    uint64_t stackSize = 0;
+    for (uint32_t shader = 0; shader < GetShaderCount(); ++shader)
+    {
+        if (m_shaders[shader].stage == PipelineShaderStage::RayGen)
+        {
+            stackSize = std::max(stackSize, ComputeShaderStackSize(shader, 0, maxTraceRecursionDepth, memo));
+        }
+    }
+    return stackSize;
+}
+
+uint64_t PipelineStackGraph::ComputeDefaultStackSize(uint32_t maxTraceRecursionDepth) const
+{
+    uint64_t maxStackSizes[static_cast<uint32_t>(PipelineShaderStage::Count)] = {};
+    for (const Shader& shader : m_shaders)
+    {
+        uint64_t& maxStackSize = maxStackSizes[static_cast<uint32_t>(shader.stage)];
+        maxStackSize = std::max(maxStackSize, shader.stackSize);
+    }
+    return GetDefaultPipelineStackSize(
+        maxStackSizes[static_cast<uint32_t>(PipelineShaderStage::RayGen)],
+        maxStackSizes[static_cast<uint32_t>(PipelineShaderStage::ClosestHit)],
+        maxStackSizes[static_cast<uint32_t>(PipelineShaderStage::AnyHit)],
+        maxStackSizes[static_cast<uint32_t>(PipelineShaderStage::Intersection)],
+        maxStackSizes[static_cast<uint32_t>(PipelineShaderStage::Miss)],
+        maxTraceRecursionDepth);
+}
+
+uint64_t PipelineStackGraph::ComputeShaderStackSize(uint32_t shader, uint32_t depth, uint32_t maxDepth, std::vector<uint64_t>& memo) const
+{
+    uint64_t& stackSize = memo[static_cast<size_t>(shader) * (maxDepth + 1) + depth];
+    if (stackSize != NOT_COMPUTED)
+    {
+        return stackSize;
+    }
+
+    // A shader at the recursion limit must not trace, its traces are not part of a valid path
+    uint64_t calleeStackSize = 0;
+    if (depth < maxDepth)
+    {
+        for (uint32_t rayType : m_shaders[shader].tracedRayTypes)
+        {
+            calleeStackSize = std::max(calleeStackSize, ComputeRayStackSize(rayType, depth + 1, maxDepth, memo));
+        }
+    }
+    stackSize = m_shaders[shader].stackSize + calleeStackSize;
+    return stackSize;
+}
+
+uint64_t PipelineStackGraph::ComputeRayStackSize(uint32_t rayType, uint32_t depth, uint32_t maxDepth, std::vector<uint64_t>& memo) const
+{
+    uint64_t stackSize = 0;
+    for (const HitGroup& hitGroup : m_hitGroups)
+    {
+        if (hitGroup.rayType != rayType)
+        {
+            continue;
+        }
+        const uint64_t closestHitStackSize = hitGroup.closestHit != NO_SHADER ? ComputeShaderStackSize(hitGroup.closestHit, depth, maxDepth, memo) : 0;
+        stackSize = std::max({ stackSize, closestHitStackSize, GetStackSize(hitGroup.intersection) + GetStackSize(hitGroup.anyHit) });
+    }
+    for (const auto& [missRayType, miss] : m_misses)
+    {
+        if (missRayType == rayType)
+        {
+            stackSize = std::max(stackSize, ComputeShaderStackSize(miss, depth, maxDepth, memo));
+        }
+    }
+    return stackSize;
+}
+
+uint64_t GetDefaultPipelineStackSize(uint64_t rayGen, uint64_t closestHit, uint64_t anyHit, uint64_t intersection, uint64_t miss, uint32_t maxTraceRecursionDepth)
+{
+    // "Default pipeline stack size" of the DXR specification without callable shaders
+    return rayGen +
+        std::max({ closestHit, miss, intersection + anyHit }) * std::min(1u, maxTraceRecursionDepth) +
+        std::max(closestHit, miss) * (std::max(maxTraceRecursionDepth, 1u) - 1);
+}
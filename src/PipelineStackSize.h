@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Stack size of a DXR pipeline computed from the call graph of its shaders.
+//
+// Without ID3D12StateObjectProperties::SetPipelineStackSize() the runtime uses the conservative default of the DXR
+// specification, which assumes that every closest hit and miss shader traces again up to MaxTraceRecursionDepth. The
+// stack is allocated per thread for the deepest of these paths, so a pipeline whose hit and miss shaders never trace
+// pays for stack it does not use. PipelineStackGraph records which shader traces which ray type and which shaders run
+// for a ray type, and returns the deepest path that can actually occur:
+//
+//   stack(shader, depth) = size(shader) + max over the traced ray types of stack(ray type, depth + 1)
+//   stack(ray type, depth) = max(stack(closest hit, depth), stack(miss, depth), size(intersection) + size(any hit))
+//
+// Ray generation shaders are at depth 0 and a shader at MaxTraceRecursionDepth does not trace. The pipeline stack is
+// the largest of its ray generation shaders, as a dispatch runs one of them. Intersection and any hit shaders cannot
+// trace and run nested (ReportHit() calls the any hit shader). Callable shaders are not modeled, no pipeline uses them.
+//
+// The sizes are the ones of ID3D12StateObjectProperties::GetShaderStackSize(), for a hit group shader with the
+// "HitGroup::closesthit" export. This module has no Direct3D12 dependency, it is checked on the CPU by
+// tools/PipelineStackSizeTool.
+
+enum class PipelineShaderStage : uint32_t
+{
+    RayGen,
+    ClosestHit,
+    AnyHit,
+    Intersection,
+    Miss,
+    Count
+};
+
+class PipelineStackGraph
+{
+public:
+    static const uint32_t NO_SHADER = ~0u;
+
+    void Reset();
+
+    // Add a shader with its stack size in bytes and return its index
+    uint32_t AddShader(PipelineShaderStage stage, uint64_t stackSize);
+
+    // Shaders run for a ray type: a hit group with any of its shaders NO_SHADER, or a miss shader. A ray type with a
+    // null hit group record only adds the miss shader.
+    void AddHitGroup(uint32_t rayType, uint32_t closestHit, uint32_t anyHit, uint32_t intersection);
+    void AddMiss(uint32_t rayType, uint32_t miss);
+
+    // The shader calls TraceRay() with the ray type, only ray generation, closest hit and miss shaders can
+    void AddTrace(uint32_t shader, uint32_t rayType);
+
+    // Deepest path of the graph with at most maxTraceRecursionDepth nested TraceRay() calls
+    uint64_t ComputeStackSize(uint32_t maxTraceRecursionDepth) const;
+
+    // Default of the runtime: every closest hit and miss shader of the graph traces again
+    uint64_t ComputeDefaultStackSize(uint32_t maxTraceRecursionDepth) const;
+
+    uint32_t GetShaderCount() const { return static_cast<uint32_t>(m_shaders.size()); }
+
+private:
+    struct Shader
+    {
+        PipelineShaderStage stage;
+        uint64_t stackSize;
+        std::vector<uint32_t> tracedRayTypes;
+    };
+
+    struct HitGroup
+    {
+        uint32_t rayType;
+        uint32_t closestHit;
+        uint32_t anyHit;
+        uint32_t intersection;
+    };
+
+    uint64_t ComputeShaderStackSize(uint32_t shader, uint32_t depth, uint32_t maxDepth, std::vector<uint64_t>& memo) const;
+    uint64_t ComputeRayStackSize(uint32_t rayType, uint32_t depth, uint32_t maxDepth, std::vector<uint64_t>& memo) const;
+    uint64_t GetStackSize(uint32_t shader) const { return shader == NO_SHADER ? 0 : m_shaders[shader].stackSize; }
+
+    std::vector<Shader> m_shaders;
+    std::vector<HitGroup> m_hitGroups;
+    std::vector<std::pair<uint32_t, uint32_t>> m_misses;    // ray type, shader
+};
+
+// Pipeline stack size of the DXR specification for the largest stack sizes of every stage, used when none is set
+uint64_t GetDefaultPipelineStackSize(uint64_t rayGen, uint64_t closestHit, uint64_t anyHit, uint64_t intersection, uint64_t miss, uint32_t maxTraceRecursionDepth);
@@ -0,0 +1,63 @@
+#pragma once
+
+// Helpers for the modules that are shared with the command line tools in tools/.
+// These modules must not depend on Direct3D12 so that they can be built on Linux as well.
+
+#ifdef _WIN32
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+
+#else
+
+#include <cstdio>
+
+// Route debug output to stderr on platforms without a debugger output channel
+inline void OutputDebugStringA(const char* message)
+{
+    fputs(message, stderr);
+}
+
+#endif
+
+#include <cstdint>
+#include <cstdio>
+
+// Open a file with fopen_s on Windows (fopen is rejected by SDL checks) and fopen elsewhere
+inline FILE* OpenFileStream(const char* path, const char* mode)
+{
+#ifdef _WIN32
+    FILE* file = nullptr;
+    if (fopen_s(&file, path, mode) != 0)
+    {
+        return nullptr;
+    }
+    return file;
+#else
+    return fopen(path, mode);
+#endif
+}
+
+// Seek with a 64-bit offset
+inline int SeekFile(FILE* file, uint64_t offset)
+{
+#ifdef _WIN32
+    return _fseeki64(file, static_cast<int64_t>(offset), SEEK_SET);
+#else
+    return fseeko(file, static_cast<off_t>(offset), SEEK_SET);
+#endif
+}
+
+// Helper function to align size to given alignment
+inline uint32_t AlignSize(uint32_t size, uint32_t alignment)
+{
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
+// Helper function to align size to given alignment (64-bit version)
+inline uint64_t AlignSize(uint64_t size, uint32_t alignment)
+{
+    return (size + static_cast<uint64_t>(alignment) - 1) & ~(static_cast<uint64_t>(alignment) - 1);
+}
@@ -0,0 +1,347 @@
+#include "ProceduralScene.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+    const float PI = 3.14159265f;
+
+    // Number of sinusoids displacing the sphere surface
+    const uint32_t NOISE_TERM_COUNT = 4;
+
+    // SplitMix64, the generator and the hash of the seeds
+    uint64_t NextRandom(uint64_t& state)
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform in [0, 1)
+    float NextFloat(uint64_t& state)
+    {
+        return static_cast<float>(NextRandom(state) >> 40) * (1.0f / 16777216.0f);
+    }
+
+    // Independent stream of the seed for one mesh or the instances
+    uint64_t GetStreamState(uint64_t seed, uint64_t stream)
+    {
+        uint64_t state = seed ^ (stream * 0xD6E8FEB86659FD93ull);
+        NextRandom(state);
+        return state;
+    }
+
+    // Split text at the separator, empty parts are skipped
+    std::vector<std::string> Split(const std::string& text, char separator)
+    {
+        std::vector<std::string> parts;
+        size_t begin = 0;
+        while (begin <= text.size())
+        {
+            size_t end = text.find(separator, begin);
+            if (end == std::string::npos)
+            {
+                end = text.size();
+            }
+            if (end > begin)
+            {
+                parts.push_back(text.substr(begin, end - begin));
+            }
+            begin = end + 1;
+        }
+        return parts;
+    }
+
+    // Sphere of rings x segments quads with triangles at the poles, displaced along the normal by a sum of sinusoids.
+    // The sinusoids have whole periods around the axis and vanish at the poles, so the surface is closed.
+    void GenerateMesh(uint32_t meshIndex, uint32_t numTriangles, uint64_t seed, ProceduralMesh& mesh)
+    {
+        uint64_t state = GetStreamState(seed, meshIndex + 1);
+
+        const uint32_t rings = std::max(2u, static_cast<uint32_t>(std::lround(std::sqrt(numTriangles / 4.0))) + 1);
+        const uint32_t segments = std::max(3u, static_cast<uint32_t>(std::lround(static_cast<double>(numTriangles) / (2 * rings - 2))));
+
+        struct NoiseTerm
+        {
+            float amplitude;
+            float latitudeFrequency;
+            float latitudePhase;
+            float longitudeFrequency;
+            float longitudePhase;
+        };
+        NoiseTerm terms[NOISE_TERM_COUNT];
+        for (NoiseTerm& term : terms)
+        {
+            term.amplitude = 0.03f + 0.02f * NextFloat(state);
+            term.latitudeFrequency = 1.0f + 7.0f * NextFloat(state);
+            term.latitudePhase = 2.0f * PI * NextFloat(state);
+            term.longitudeFrequency = static_cast<float>(1 + NextRandom(state) % 8);
+            term.longitudePhase = 2.0f * PI * NextFloat(state);
+        }
+
+        float color[4] = { 0.2f + 0.8f * NextFloat(state), 0.2f + 0.8f * NextFloat(state), 0.2f + 0.8f * NextFloat(state), 1.0f };
+
+        mesh.name = "procedural_" + std::to_string(meshIndex);
+        mesh.vertices.resize((rings + 1) * (segments + 1));
+        for (uint32_t ring = 0; ring <= rings; ++ring)
+        {
+            const float theta = PI * static_cast<float>(ring) / static_cast<float>(rings);
+            for (uint32_t segment = 0; segment <= segments; ++segment)
+            {
+                // The seam vertices are computed from the same angle as the first segment, so the positions match
+                const float phi = 2.0f * PI * static_cast<float>(segment % segments) / static_cast<float>(segments);
+                float displacement = 0.0f;
+                for (const NoiseTerm& term : terms)
+                {
+                    displacement += term.amplitude * std::sin(term.latitudeFrequency * theta + term.latitudePhase) * std::cos(term.longitudeFrequency * phi + term.longitudePhase);
+                }
+                const float radius = 0.8f + displacement * std::sin(theta);
+
+                GeometrySourceVertex& vertex = mesh.vertices[ring * (segments + 1) + segment];
+                vertex.position[0] = radius * std::sin(theta) * std::cos(phi);
+                vertex.position[1] = radius * std::cos(theta);
+                vertex.position[2] = radius * std::sin(theta) * std::sin(phi);
+                vertex.normal[0] = vertex.normal[1] = vertex.normal[2] = 0.0f;
+                std::copy(color, color + 4, vertex.color);
+            }
+        }
+
+        mesh.indices.clear();
+        mesh.indices.reserve(segments * (2 * rings - 2) * 3);
+        for (uint32_t ring = 0; ring < rings; ++ring)
+        {
+            for (uint32_t segment = 0; segment < segments; ++segment)
+            {
+                const uint32_t v0 = ring * (segments + 1) + segment;
+                const uint32_t v1 = v0 + 1;
+                const uint32_t v2 = v0 + segments + 1;
+                const uint32_t v3 = v2 + 1;
+                if (ring > 0)
+                {
+                    mesh.indices.insert(mesh.indices.end(), { v0, v1, v2 });
+                }
+                if (ring < rings - 1)
+                {
+                    mesh.indices.insert(mesh.indices.end(), { v1, v3, v2 });
+                }
+            }
+        }
+
+        // Area weighted vertex normals, shared by the copies of a vertex at the seam and the poles
+        for (size_t i = 0; i < mesh.indices.size(); i += 3)
+        {
+            const float* p0 = mesh.vertices[mesh.indices[i]].position;
+            const float* p1 = mesh.vertices[mesh.indices[i + 1]].position;
+            const float* p2 = mesh.vertices[mesh.indices[i + 2]].position;
+            const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            const float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            for (uint32_t j = 0; j < 3; ++j)
+            {
+                float* normal = mesh.vertices[mesh.indices[i + j]].normal;
+                normal[0] += n[0];
+                normal[1] += n[1];
+                normal[2] += n[2];
+            }
+        }
+        auto mergeNormals = [&](uint32_t first, uint32_t count, uint32_t stride)
+        {
+            float sum[3] = { 0.0f, 0.0f, 0.0f };
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                const float* normal = mesh.vertices[first + i * stride].normal;
+                sum[0] += normal[0];
+                sum[1] += normal[1];
+                sum[2] += normal[2];
+            }
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                std::copy(sum, sum + 3, mesh.vertices[first + i * stride].normal);
+            }
+        };
+        for (uint32_t ring = 1; ring < rings; ++ring)
+        {
+            mergeNormals(ring * (segments + 1), 2, segments);
+        }
+        mergeNormals(0, segments + 1, 1);
+        mergeNormals(rings * (segments + 1), segments + 1, 1);
+
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            mesh.boundsMin[i] = 1.0e30f;
+            mesh.boundsMax[i] = -1.0e30f;
+        }
+        for (GeometrySourceVertex& vertex : mesh.vertices)
+        {
+            const float length = std::sqrt(vertex.normal[0] * vertex.normal[0] + vertex.normal[1] * vertex.normal[1] + vertex.normal[2] * vertex.normal[2]);
+            for (uint32_t i = 0; i < 3; ++i)
+            {
+                vertex.normal[i] = length > 0.0f ? vertex.normal[i] / length : 0.0f;
+                mesh.boundsMin[i] = std::min(mesh.boundsMin[i], vertex.position[i]);
+                mesh.boundsMax[i] = std::max(mesh.boundsMax[i], vertex.position[i]);
+            }
+        }
+    }
+}
+
+bool ParseProceduralSceneSettings(const std::string& text, ProceduralSceneSettings& settings, std::string* error)
+{
+    ProceduralSceneSettings parsed = settings;
+    for (const std::string& entry : Split(text, ';'))
+    {
+        const size_t equal = entry.find('=');
+        const std::string key = equal != std::string::npos ? entry.substr(0, equal) : entry;
+        const std::string value = equal != std::string::npos ? entry.substr(equal + 1) : std::string();
+        char* end = nullptr;
+        bool isValid = !value.empty();
+        if (isValid && key == "seed")
+        {
+            parsed.seed = strtoull(value.c_str(), &end, 10);
+        }
+        else if (isValid && key == "meshes")
+        {
+            parsed.numMeshes = static_cast<uint32_t>(strtoul(value.c_str(), &end, 10));
+            isValid = parsed.numMeshes > 0;
+        }
+        else if (isValid && key == "triangles")
+        {
+            parsed.trianglesPerMesh = static_cast<uint32_t>(strtoul(value.c_str(), &end, 10));
+            isValid = parsed.trianglesPerMesh > 0;
+        }
+        else if (isValid && key == "instances")
+        {
+            parsed.numInstances = static_cast<uint32_t>(strtoul(value.c_str(), &end, 10));
+            isValid = parsed.numInstances > 0;
+        }
+        else if (isValid && key == "overlap")
+        {
+            parsed.overlap = strtof(value.c_str(), &end);
+            isValid = parsed.overlap >= 0.0f;
+        }
+        else if (isValid && key == "depth")
+        {
+            parsed.depthComplexity = static_cast<uint32_t>(strtoul(value.c_str(), &end, 10));
+            isValid = parsed.depthComplexity > 0;
+        }
+        else if (isValid && key == "size")
+        {
+            parsed.size = strtof(value.c_str(), &end);
+            isValid = parsed.size > 0.0f;
+        }
+        else
+        {
+            isValid = false;
+        }
+
+        // Numbers must be parsed completely
+        if (!isValid || !end || *end != '\0')
+        {
+            if (error)
+            {
+                *error = "invalid entry: " + entry;
+            }
+            return false;
+        }
+    }
+
+    settings = parsed;
+    return true;
+}
+
+std::string GetProceduralSceneSettingsText(const ProceduralSceneSettings& settings)
+{
+    return "seed=" + std::to_string(settings.seed) + ";meshes=" + std::to_string(settings.numMeshes) + ";triangles=" + std::to_string(settings.trianglesPerMesh) +
+        ";instances=" + std::to_string(settings.numInstances) + ";overlap=" + std::to_string(settings.overlap) + ";depth=" + std::to_string(settings.depthComplexity) +
+        ";size=" + std::to_string(settings.size);
+}
+
+void GenerateProceduralScene(const ProceduralSceneSettings& settings, ProceduralScene& scene, ThreadPool* threadPool)
+{
+    const uint32_t numMeshes = std::max(settings.numMeshes, 1u);
+    scene.meshes.resize(numMeshes);
+    auto generateMesh = [&](uint32_t i)
+    {
+        GenerateMesh(i, settings.trianglesPerMesh, settings.seed, scene.meshes[i]);
+    };
+    if (threadPool)
+    {
+        threadPool->ParallelFor(numMeshes, generateMesh);
+    }
+    else
+    {
+        for (uint32_t i = 0; i < numMeshes; ++i)
+        {
+            generateMesh(i);
+        }
+    }
+
+    // Square grids of cells in depthComplexity layers, filled in order
+    const uint32_t numLayers = std::max(settings.depthComplexity, 1u);
+    const uint32_t instancesPerLayer = (settings.numInstances + numLayers - 1) / numLayers;
+    const uint32_t gridSize = std::max(1u, static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(instancesPerLayer)))));
+    const float cellSize = settings.size / static_cast<float>(gridSize);
+    const float radius = 0.5f * cellSize * (1.0f + settings.overlap);
+
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        scene.boundsMin[i] = 1.0e30f;
+        scene.boundsMax[i] = -1.0e30f;
+    }
+
+    uint64_t state = GetStreamState(settings.seed, 0);
+    scene.instances.resize(settings.numInstances);
+    for (uint32_t i = 0; i < settings.numInstances; ++i)
+    {
+        ProceduralInstance& instance = scene.instances[i];
+        instance.meshIndex = static_cast<uint32_t>(NextRandom(state) % numMeshes);
+
+        const uint32_t layer = i / instancesPerLayer;
+        const uint32_t cell = i % instancesPerLayer;
+        const float center[3] = {
+            (static_cast<float>(cell % gridSize) + 0.25f + 0.5f * NextFloat(state)) * cellSize - settings.size * 0.5f,
+            (static_cast<float>(cell / gridSize) + 0.25f + 0.5f * NextFloat(state)) * cellSize - settings.size * 0.5f,
+            (static_cast<float>(layer) + 0.25f + 0.5f * NextFloat(state) - static_cast<float>(numLayers) * 0.5f) * cellSize };
+
+        // Uniform random rotation from a unit quaternion, scaled to the radius. The meshes fit the unit sphere.
+        const float u0 = NextFloat(state);
+        const float u1 = 2.0f * PI * NextFloat(state);
+        const float u2 = 2.0f * PI * NextFloat(state);
+        const float x = std::sqrt(1.0f - u0) * std::sin(u1);
+        const float y = std::sqrt(1.0f - u0) * std::cos(u1);
+        const float z = std::sqrt(u0) * std::sin(u2);
+        const float w = std::sqrt(u0) * std::cos(u2);
+        const float scale = radius * (0.75f + 0.25f * NextFloat(state));
+        const float rotation[3][3] = {
+            { 1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y - z * w), 2.0f * (x * z + y * w) },
+            { 2.0f * (x * y + z * w), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z - x * w) },
+            { 2.0f * (x * z - y * w), 2.0f * (y * z + x * w), 1.0f - 2.0f * (x * x + y * y) } };
+        for (uint32_t row = 0; row < 3; ++row)
+        {
+            for (uint32_t column = 0; column < 3; ++column)
+            {
+                instance.transform[row][column] = rotation[row][column] * scale;
+            }
+            instance.transform[row][3] = center[row];
+        }
+
+        // World bounds of the transformed mesh bounds
+        const ProceduralMesh& mesh = scene.meshes[instance.meshIndex];
+        for (uint32_t row = 0; row < 3; ++row)
+        {
+            float boundsMin = instance.transform[row][3];
+            float boundsMax = instance.transform[row][3];
+            for (uint32_t column = 0; column < 3; ++column)
+            {
+                const float a = instance.transform[row][column] * mesh.boundsMin[column];
+                const float b = instance.transform[row][column] * mesh.boundsMax[column];
+                boundsMin += std::min(a, b);
+                boundsMax += std::max(a, b);
+            }
+            scene.boundsMin[row] = std::min(scene.boundsMin[row], boundsMin);
+            scene.boundsMax[row] = std::max(scene.boundsMax[row], boundsMax);
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "GeometryStreams.h"
+
+class ThreadPool;
+
+// Deterministic stress scenes for the acceleration structure builds and the ray tracing throughput.
+//
+// The scene has numMeshes noisy spheres of about trianglesPerMesh triangles each, and numInstances instances of them
+// placed on a grid of depthComplexity layers along +z. A ray along z through the scene crosses about depthComplexity
+// instances. The instance radius is half the grid cell times (1 + overlap), so overlap 0 makes neighbours touch and
+// larger values make the instance bounds overlap, which is the expensive case of a TLAS. Positions, rotations, sizes,
+// mesh assignments and colors come from the seed only: the same settings produce the same scene on every run.
+//
+// This module has no Direct3D12 dependency.
+
+struct ProceduralSceneSettings
+{
+    uint64_t seed = 1;
+    uint32_t numMeshes = 16;
+    uint32_t trianglesPerMesh = 5000;
+    uint32_t numInstances = 1000;
+    float overlap = 0.5f;
+    uint32_t depthComplexity = 4;
+    float size = 5.0f;          // edge of the square the layers cover, the depth is depthComplexity grid cells
+};
+
+struct ProceduralMesh
+{
+    std::string name;
+    std::vector<GeometrySourceVertex> vertices;
+    std::vector<uint32_t> indices;
+    float boundsMin[3];
+    float boundsMax[3];
+};
+
+// Instance of a mesh, the transform is the row-major 3x4 object to world matrix
+struct ProceduralInstance
+{
+    uint32_t meshIndex;
+    float transform[3][4];
+};
+
+struct ProceduralScene
+{
+    std::vector<ProceduralMesh> meshes;
+    std::vector<ProceduralInstance> instances;
+    float boundsMin[3];     // world bounds of the instances
+    float boundsMax[3];
+};
+
+// Parse settings of ';' separated entries, the entries not given keep their value:
+//   seed=<n>  meshes=<count>  triangles=<count per mesh>  instances=<count>  overlap=<factor>  depth=<layers>  size=<edge>
+// e.g. "instances=10000;triangles=2000;overlap=1;depth=8"
+bool ParseProceduralSceneSettings(const std::string& text, ProceduralSceneSettings& settings, std::string* error = nullptr);
+
+// Settings as text parseable by ParseProceduralSceneSettings()
+std::string GetProceduralSceneSettingsText(const ProceduralSceneSettings& settings);
+
+// Generate the scene, the meshes in parallel on the thread pool when one is given
+void GenerateProceduralScene(const ProceduralSceneSettings& settings, ProceduralScene& scene, ThreadPool* threadPool = nullptr);
@@ -0,0 +1,86 @@
+#include "QueueSyncTracker.h"
+#include <algorithm>
+
+QueueSyncTracker::QueueSyncTracker(uint32_t numQueues, uint32_t numResources) :
+    m_queues(numQueues),
+    m_resources(numResources)
+{
+    for (QueueState& state : m_queues)
+    {
+        state.lastSubmittedValue = 0;
+        state.completedValue = 0;
+        state.waitedValues.assign(numQueues, 0);
+    }
+    for (ResourceState& state : m_resources)
+    {
+        state.writeQueue = 0;
+        state.writeValue = 0;
+        state.readValues.assign(numQueues, 0);
+    }
+}
+
+void QueueSyncTracker::AddWait(uint32_t queue, uint32_t other, uint64_t fenceValue, std::vector<QueueWait>& waits) const
+{
+    if (other == queue || fenceValue == 0 || IsCompleted(other, fenceValue) || fenceValue <= m_queues[queue].waitedValues[other])
+    {
+        return;
+    }
+
+    for (QueueWait& wait : waits)
+    {
+        if (wait.queue == other)
+        {
+            wait.fenceValue = std::max(wait.fenceValue, fenceValue);
+            return;
+        }
+    }
+    waits.push_back({ other, fenceValue });
+}
+
+void QueueSyncTracker::GetWaitsBeforeRead(uint32_t queue, uint32_t resource, std::vector<QueueWait>& waits) const
+{
+    const ResourceState& state = m_resources[resource];
+    AddWait(queue, state.writeQueue, state.writeValue, waits);
+}
+
+void QueueSyncTracker::GetWaitsBeforeWrite(uint32_t queue, uint32_t resource, std::vector<QueueWait>& waits) const
+{
+    const ResourceState& state = m_resources[resource];
+    AddWait(queue, state.writeQueue, state.writeValue, waits);
+    for (uint32_t other = 0; other < GetQueueCount(); ++other)
+    {
+        AddWait(queue, other, state.readValues[other], waits);
+    }
+}
+
+void QueueSyncTracker::RecordWait(uint32_t queue, const QueueWait& wait)
+{
+    uint64_t& waitedValue = m_queues[queue].waitedValues[wait.queue];
+    waitedValue = std::max(waitedValue, wait.fenceValue);
+}
+
+uint64_t QueueSyncTracker::Submit(uint32_t queue)
+{
+    return ++m_queues[queue].lastSubmittedValue;
+}
+
+void QueueSyncTracker::RecordRead(uint32_t queue, uint32_t resource, uint64_t fenceValue)
+{
+    uint64_t& readValue = m_resources[resource].readValues[queue];
+    readValue = std::max(readValue, fenceValue);
+}
+
+void QueueSyncTracker::RecordWrite(uint32_t queue, uint32_t resource, uint64_t fenceValue)
+{
+    // A write orders all earlier accesses before it, they no longer need to be waited for
+    ResourceState& state = m_resources[resource];
+    state.writeQueue = queue;
+    state.writeValue = fenceValue;
+    std::fill(state.readValues.begin(), state.readValues.end(), 0);
+}
+
+void QueueSyncTracker::SetCompletedValue(uint32_t queue, uint64_t completedValue)
+{
+    QueueState& state = m_queues[queue];
+    state.completedValue = std::max(state.completedValue, completedValue);
+}
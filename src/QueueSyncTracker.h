@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Fence bookkeeping of resources shared between command queues.
+//
+// Every queue has a fence which each submission signals with the next value. The submissions record the resources
+// they read and write with their fence values. Before a submission, the tracker gives the fence values of the other
+// queues it must wait for on the GPU: the last write of a resource it reads (read after write), and the last reads
+// and the last write of a resource it writes (write after read, write after write). A wait is elided when the queue
+// has already waited for that value or a later one, or when the CPU has seen the value completed, so that a queue
+// only waits for the work it actually depends on. Submissions of the same queue execute in order and never wait for
+// each other.
+//
+// This module has no Direct3D12 dependency: the caller issues the Signal and Wait commands and reports the completed
+// fence values, so the scheduling order is checked on the CPU by tools/QueueSyncTool.
+
+struct QueueWait
+{
+    uint32_t queue;
+    uint64_t fenceValue;
+};
+
+class QueueSyncTracker
+{
+public:
+    QueueSyncTracker(uint32_t numQueues, uint32_t numResources);
+
+    uint32_t GetQueueCount() const { return static_cast<uint32_t>(m_queues.size()); }
+    uint32_t GetResourceCount() const { return static_cast<uint32_t>(m_resources.size()); }
+
+    // Fence values of a queue: signaled by its last submission, and seen completed by the CPU
+    uint64_t GetLastSubmittedValue(uint32_t queue) const { return m_queues[queue].lastSubmittedValue; }
+    uint64_t GetCompletedValue(uint32_t queue) const { return m_queues[queue].completedValue; }
+    bool IsCompleted(uint32_t queue, uint64_t fenceValue) const { return fenceValue <= m_queues[queue].completedValue; }
+
+    // Waits of a submission of queue which reads or writes a resource, appended to waits with at most one wait per
+    // other queue
+    void GetWaitsBeforeRead(uint32_t queue, uint32_t resource, std::vector<QueueWait>& waits) const;
+    void GetWaitsBeforeWrite(uint32_t queue, uint32_t resource, std::vector<QueueWait>& waits) const;
+
+    // A GPU wait issued on queue before its next submission
+    void RecordWait(uint32_t queue, const QueueWait& wait);
+
+    // Start a submission of queue and return the fence value it signals. The accesses of the submission are recorded
+    // with that value.
+    uint64_t Submit(uint32_t queue);
+    void RecordRead(uint32_t queue, uint32_t resource, uint64_t fenceValue);
+    void RecordWrite(uint32_t queue, uint32_t resource, uint64_t fenceValue);
+
+    // The CPU has seen the fence of queue reach completedValue
+    void SetCompletedValue(uint32_t queue, uint64_t completedValue);
+
+private:
+    struct QueueState
+    {
+        uint64_t lastSubmittedValue;
+        uint64_t completedValue;
+        std::vector<uint64_t> waitedValues;     // per other queue, the largest value this queue has waited for
+    };
+
+    struct ResourceState
+    {
+        uint32_t writeQueue;
+        uint64_t writeValue;                    // 0 if never written
+        std::vector<uint64_t> readValues;       // per queue, the last submission reading the resource
+    };
+
+    // Add a wait for fenceValue of other unless it is implied, merging with a wait for the same queue in waits
+    void AddWait(uint32_t queue, uint32_t other, uint64_t fenceValue, std::vector<QueueWait>& waits) const;
+
+    std::vector<QueueState> m_queues;
+    std::vector<ResourceState> m_resources;
+};
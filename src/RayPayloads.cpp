@@ -0,0 +1,93 @@
+#include "RayPayloads.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace ShaderLayout;
+
+namespace
+{
+    float GetRgb9e5Scale(int exponent)
+    {
+        return std::exp2(static_cast<float>(exponent - static_cast<int>(RGB9E5_EXPONENT_BIAS + RGB9E5_MANTISSA_BITS)));
+    }
+
+    float GetSign(float value)
+    {
+        return value >= 0.0f ? 1.0f : -1.0f;
+    }
+}
+
+uint32_t PackRgb9e5(const float value[3])
+{
+    // Clamped to the range of the format, the exponent of the largest channel (at least the smallest one, also for
+    // black) rounded up when its mantissa overflows
+    float clamped[3];
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        clamped[i] = std::clamp(value[i], 0.0f, RGB9E5_MAX_VALUE);
+    }
+    const float maxChannel = std::max({ clamped[0], clamped[1], clamped[2] });
+    const float minExponentValue = std::exp2(-static_cast<float>(RGB9E5_EXPONENT_BIAS + 1));
+    int exponent = static_cast<int>(std::floor(std::log2(std::max(maxChannel, minExponentValue)))) + 1 + static_cast<int>(RGB9E5_EXPONENT_BIAS);
+    if (std::floor(maxChannel / GetRgb9e5Scale(exponent) + 0.5f) == static_cast<float>(1u << RGB9E5_MANTISSA_BITS))
+    {
+        exponent++;
+    }
+
+    uint32_t packed = static_cast<uint32_t>(exponent) << (RGB9E5_MANTISSA_BITS * 3);
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        packed |= static_cast<uint32_t>(std::floor(clamped[i] / GetRgb9e5Scale(exponent) + 0.5f)) << (RGB9E5_MANTISSA_BITS * i);
+    }
+    return packed;
+}
+
+void UnpackRgb9e5(uint32_t packed, float value[3])
+{
+    const uint32_t mantissaMask = (1u << RGB9E5_MANTISSA_BITS) - 1;
+    const float scale = GetRgb9e5Scale(static_cast<int>(packed >> (RGB9E5_MANTISSA_BITS * 3)));
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        value[i] = static_cast<float>((packed >> (RGB9E5_MANTISSA_BITS * i)) & mantissaMask) * scale;
+    }
+}
+
+uint32_t PackOctahedralNormal(const float normal[3])
+{
+    // Projected on the octahedron, the lower hemisphere folded over the diagonals
+    const float length = std::abs(normal[0]) + std::abs(normal[1]) + std::abs(normal[2]);
+    float projected[2] = { normal[0] / length, normal[1] / length };
+    if (normal[2] < 0.0f)
+    {
+        const float folded[2] = {
+            (1.0f - std::abs(projected[1])) * GetSign(projected[0]),
+            (1.0f - std::abs(projected[0])) * GetSign(projected[1])
+        };
+        projected[0] = folded[0];
+        projected[1] = folded[1];
+    }
+    const float scale = static_cast<float>((1u << OCTAHEDRAL_COMPONENT_BITS) - 1);
+    uint32_t packed = 0;
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        packed |= static_cast<uint32_t>(std::round(std::clamp(projected[i] * 0.5f + 0.5f, 0.0f, 1.0f) * scale)) << (OCTAHEDRAL_COMPONENT_BITS * i);
+    }
+    return packed;
+}
+
+void UnpackOctahedralNormal(uint32_t packed, float normal[3])
+{
+    const uint32_t mask = (1u << OCTAHEDRAL_COMPONENT_BITS) - 1;
+    const float scale = static_cast<float>(mask);
+    normal[0] = static_cast<float>(packed & mask) / scale * 2.0f - 1.0f;
+    normal[1] = static_cast<float>(packed >> OCTAHEDRAL_COMPONENT_BITS) / scale * 2.0f - 1.0f;
+    normal[2] = 1.0f - std::abs(normal[0]) - std::abs(normal[1]);
+    const float fold = std::clamp(-normal[2], 0.0f, 1.0f);
+    normal[0] += normal[0] >= 0.0f ? -fold : fold;
+    normal[1] += normal[1] >= 0.0f ? -fold : fold;
+    const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        normal[i] /= length;
+    }
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "../shaders/RayPayloads.hlsli"
+
+// Ray payload layouts of the DXR pipelines (ShaderLayout::RayPayloadFull, RayPayloadPacked, ShadowPayload,
+// WavefrontPayload and RayAttributes), declared once in shaders/RayPayloads.hlsli for HLSL and C++, and the C++ mirror
+// of the packing functions of the packed radiance payload. The functions produce the same bits as the shaders, so the
+// precision of the packed payload is checked on the CPU by tools/RayPayloadTool.
+//
+// This module has no Direct3D12 dependency.
+
+// RGB9E5 of a color, negative channels are 0 and channels above RGB9E5_MAX_VALUE are clamped to it
+uint32_t PackRgb9e5(const float value[3]);
+void UnpackRgb9e5(uint32_t packed, float value[3]);
+
+// Octahedral projection of a non-zero direction, unpacked normalized
+uint32_t PackOctahedralNormal(const float normal[3]);
+void UnpackOctahedralNormal(uint32_t packed, float normal[3]);
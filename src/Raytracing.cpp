@@ -1,28 +1,162 @@
 #include "Raytracing.h"
 #include "Scene.h"
 #include "Helper.h"
+#include "HeapRegistry.h"
+#include "WavefrontQueues.h"
+#include "PathTracing.h"
+#include "PipelineStackSize.h"
+#include "RayPayloads.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <format>
 #include <fstream>
 #include <vector>
 
+namespace
+{
+    const uint32_t WAVEFRONT_GROUP_SIZE = 64;           // 1D stages of shaders/Wavefront.hlsl
+    const uint32_t WAVEFRONT_TILE_SIZE = 8;             // 2D stages
+
+    const uint32_t INLINE_RAYTRACING_TILE_SIZE = 8;     // shaders/RaytracingInline.hlsl
+
+    // Weight of the last frame in the average GPU time of a render mode
+    const float TIMING_AVERAGE_WEIGHT = 0.05f;
+
+    static_assert(sizeof(ShaderLayout::RayAttributes) <= D3D12_RAYTRACING_MAX_ATTRIBUTE_SIZE_IN_BYTES, "RayAttributes exceeds the attribute size of DXR");
+
+    const char* RENDER_MODE_NAMES[] = { "Megakernel", "Wavefront", "Inline RayQuery" };
+    static_assert(_countof(RENDER_MODE_NAMES) == static_cast<size_t>(RenderMode::Count), "Missing render mode name");
+
+    // Cache of the sample tables in the working directory
+    const char* SAMPLER_TABLES_PATH = "SamplerTables.bin";
+
+    // Include depth followed by IncludesShader(), deeper includes are an include cycle
+    const uint32_t MAX_SHADER_INCLUDE_DEPTH = 16;
+
+    // Whether the shader source includes the file, directly or through its includes. The paths are relative to
+    // shaders/, which is the include directory of the compiler, and the sources are read like the compiler does.
+    bool IncludesShader(const std::string& source, const std::string& file, uint32_t depth = 0)
+    {
+        if (source == file)
+        {
+            return true;
+        }
+        if (depth >= MAX_SHADER_INCLUDE_DEPTH)
+        {
+            return false;
+        }
+
+        std::ifstream stream("shaders/" + source);
+        std::string line;
+        while (std::getline(stream, line))
+        {
+            // #include "Name.hlsli"
+            const size_t directive = line.find("#include");
+            const size_t begin = directive == std::string::npos ? std::string::npos : line.find('"', directive);
+            const size_t end = begin == std::string::npos ? std::string::npos : line.find('"', begin + 1);
+            if (end != std::string::npos && IncludesShader(line.substr(begin + 1, end - begin - 1), file, depth + 1))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    ComPtr<ID3D12Resource> CreateBuffer(ID3D12Device* device, uint64_t size, D3D12_HEAP_TYPE heapType, D3D12_RESOURCE_FLAGS flags, D3D12_RESOURCE_STATES state, const wchar_t* name)
+    {
+        D3D12_HEAP_PROPERTIES heapProperties = {};
+        heapProperties.Type = heapType;
+
+        D3D12_RESOURCE_DESC bufferDesc = {};
+        bufferDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+        bufferDesc.Width = size;
+        bufferDesc.Height = 1;
+        bufferDesc.DepthOrArraySize = 1;
+        bufferDesc.MipLevels = 1;
+        bufferDesc.Format = DXGI_FORMAT_UNKNOWN;
+        bufferDesc.SampleDesc.Count = 1;
+        bufferDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+        bufferDesc.Flags = flags;
+
+        ComPtr<ID3D12Resource> buffer;
+        ThrowIfFailed(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc, state, nullptr, IID_PPV_ARGS(&buffer)));
+        buffer->SetName(name);
+        return buffer;
+    }
+
+    // Stack size of an export, "HitGroup::closesthit" for a shader of a hit group, 0 for an invalid export
+    uint64_t GetShaderStackSize(ID3D12StateObjectProperties* properties, const wchar_t* exportName)
+    {
+        const UINT64 stackSize = properties->GetShaderStackSize(exportName);
+        return stackSize != 0xffffffff ? stackSize : 0;
+    }
+
+    // Set the stack size of the deepest call path of the graph instead of the conservative default of the runtime
+    uint64_t SetPipelineStackSize(ID3D12StateObjectProperties* properties, const PipelineStackGraph& stackGraph, uint32_t maxTraceRecursionDepth, const std::string& name)
+    {
+        const uint64_t stackSize = stackGraph.ComputeStackSize(maxTraceRecursionDepth);
+        properties->SetPipelineStackSize(stackSize);
+        OutputDebugStringA(std::format("Pipeline stack size of {}: {} bytes, default {} bytes\n", name, stackSize,
+            stackGraph.ComputeDefaultStackSize(maxTraceRecursionDepth)).c_str());
+        return stackSize;
+    }
+}
+
+const char* GetRenderModeName(RenderMode mode)
+{
+    return mode < RenderMode::Count ? RENDER_MODE_NAMES[static_cast<uint32_t>(mode)] : "Unknown";
+}
+
 Raytracing::Raytracing() :
     m_device(nullptr),
     m_width(0),
     m_height(0),
-    m_shaderTableEntrySize(0),
-    m_CBVSRVUAVdescHeapSize(0)
+    m_CBVSRVUAVdescHeapSize(0),
+    m_descHeapRegistryId(HeapRegistry::INVALID_ID),
+    m_meshInfoOffset(0),
+    m_camera(DEFAULT_CAMERA),
+    m_sampleIndex(0),
+    m_maxBounces(DEFAULT_MAX_BOUNCES),
+    m_accumulatedTLAS(0),
+    m_samplerType(SamplerType::Random),
+    m_samplerTablesUploadFenceValue(0),
+    m_isReloadPending(false),
+    m_frameFenceValue(0),
+    m_shaderTable(nullptr),
+    m_renderMode(RenderMode::Megakernel),
+    m_isInlineRaytracingSupported(false),
+    m_queuedPipelineReloads(0),
+    m_failedPipelines(0),
+    m_timestampFrequency(0),
+    m_renderModeTimings{}
 {
 }
 
 Raytracing::~Raytracing()
 {
+    if (m_pipelineReload.valid())
+    {
+        m_pipelineReload.wait();
+    }
+    m_permutationCache.Shutdown();
+    HeapRegistry::Instance().Unregister(m_descHeapRegistryId);
 }
 
-void Raytracing::Initialize(ID3D12Device5* device, uint32_t width, uint32_t height, uint32_t swapChainBufferCount)
+void Raytracing::Initialize(ID3D12Device5* device, ID3D12CommandQueue* commandQueue, uint32_t width, uint32_t height, uint32_t swapChainBufferCount)
 {
     m_device = device;
     m_width = width;
     m_height = height;
     m_swapChainBufferCount = swapChainBufferCount;
+
+    // RayQuery needs DXR 1.1
+    D3D12_FEATURE_DATA_D3D12_OPTIONS5 options5 = {};
+    m_isInlineRaytracingSupported = SUCCEEDED(m_device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS5, &options5, sizeof(options5))) &&
+        options5.RaytracingTier >= D3D12_RAYTRACING_TIER_1_1;
     
     // Create raytracing pipeline
     CreateRaytracingPipeline();
@@ -32,53 +166,378 @@ void Raytracing::Initialize(ID3D12Device5* device, uint32_t width, uint32_t heig
     
     // Create raytracing output resource
     CreateRaytracingOutputResource();
+
+    CreateSamplerTables();
     
     // Create shader table
-    CreateShaderTable();
+    m_shaderTable = &GetShaderTable(m_activePermutation, m_rtPipelineState.Get());
+
+    // Wavefront stages and the inline pipeline, the wavefront queues only when the mode was selected on the command line
+    ShaderPipelines pipelines = CreateShaderPipelines(Pipeline_Wavefront | Pipeline_Inline);
+    if (pipelines.failedPipelines != 0)
+    {
+        OutputDebugStringA(pipelines.errors.c_str());
+        ThrowIfFailed(E_FAIL);
+    }
+    ApplyShaderPipelines(pipelines);
+    if (m_renderMode == RenderMode::Wavefront)
+    {
+        CreateWavefrontResources();
+    }
+
+    if (!m_isInlineRaytracingSupported && m_renderMode == RenderMode::InlineRayQuery)
+    {
+        OutputDebugStringA("Inline ray tracing is not supported on this device, using the megakernel.\n");
+        m_renderMode = RenderMode::Megakernel;
+    }
+
+    CreateTimestampQueries(commandQueue);
+}
+
+uint64_t Raytracing::GetPipelineStackSize(RenderMode mode) const
+{
+    ID3D12StateObject* stateObject = mode == RenderMode::Megakernel ? m_rtPipelineState.Get() :
+        mode == RenderMode::Wavefront ? m_wavefrontPipelineState.Get() : nullptr;
+    ComPtr<ID3D12StateObjectProperties> properties;
+    if (!stateObject || FAILED(stateObject->QueryInterface(IID_PPV_ARGS(&properties))))
+    {
+        return 0;
+    }
+    return properties->GetPipelineStackSize();
+}
+
+bool Raytracing::IsRenderModeSupported(RenderMode mode) const
+{
+    // Before Initialize() the device is unknown, the mode is checked there
+    return mode < RenderMode::Count && (mode != RenderMode::InlineRayQuery || !m_device || m_isInlineRaytracingSupported);
+}
+
+void Raytracing::SetCamera(const Camera& camera)
+{
+    if (memcmp(&camera, &m_camera, sizeof(Camera)) != 0)
+    {
+        m_camera = camera;
+        m_sampleIndex = 0;
+    }
+}
+
+void Raytracing::SetMaxBounces(uint32_t maxBounces)
+{
+    if (maxBounces != m_maxBounces)
+    {
+        m_maxBounces = maxBounces;
+        m_sampleIndex = 0;
+    }
+    if (m_requestedPermutation.Get(ShaderPermutationAxis::MaxBounces) != 0)
+    {
+        ShaderPermutationKey key = m_requestedPermutation;
+        key.Set(ShaderPermutationAxis::MaxBounces, std::min(maxBounces, MAX_SPECIALIZED_BOUNCES));
+        SetShaderPermutation(key);
+    }
+}
+
+void Raytracing::SetSamplerType(SamplerType type)
+{
+    if (type < SamplerType::Count && type != m_samplerType)
+    {
+        m_samplerType = type;
+        m_sampleIndex = 0;
+    }
+}
+
+void Raytracing::SetShaderPermutation(const ShaderPermutationKey& key)
+{
+    m_requestedPermutation = key;
+    if (m_device)
+    {
+        m_permutationCache.Request(key);
+    }
+}
+
+void Raytracing::UpdateShaderPermutation()
+{
+    // Switched between two frames on the render thread, so a frame uses one state object and its shader table
+    if (m_requestedPermutation == m_activePermutation && !m_isReloadPending)
+    {
+        return;
+    }
+    ID3D12StateObject* stateObject = m_permutationCache.Request(m_requestedPermutation);
+    if (!stateObject)
+    {
+        return;
+    }
+
+    // The previous frames may still use the state object compiled before the reload
+    if (m_isReloadPending)
+    {
+        RetirePipeline(std::move(m_rtPipelineState), std::move(m_staleShaderTable));
+        m_isReloadPending = false;
+    }
+    m_rtPipelineState = stateObject;
+    m_shaderTable = &GetShaderTable(m_requestedPermutation, stateObject);
+    m_activePermutation = m_requestedPermutation;
+    m_sampleIndex = 0;
+}
+
+void Raytracing::BeginFrame(uint64_t frameFenceValue, uint64_t completedFenceValue)
+{
+    m_frameFenceValue = frameFenceValue;
+    std::erase_if(m_retiredPipelines, [completedFenceValue](const RetiredPipeline& retired) { return retired.fenceValue <= completedFenceValue; });
+    if (m_samplerTablesUpload && m_samplerTablesUploadFenceValue != 0 && m_samplerTablesUploadFenceValue <= completedFenceValue)
+    {
+        m_samplerTablesUpload.Reset();
+    }
+}
+
+void Raytracing::ReloadShaders(const std::vector<std::string>& changedShaders)
+{
+    if (!m_device)
+    {
+        return;
+    }
+
+    // Root files of the pipelines, a pipeline is compiled again when its sources include a changed file
+    struct PipelineSource
+    {
+        const char* file;
+        ShaderPipelineFlags pipeline;
+    };
+    const PipelineSource pipelineSources[] = {
+        { "Raytracing.hlsl", Pipeline_Megakernel },
+        { "Wavefront.hlsl", Pipeline_Wavefront },
+        { "WavefrontTrace.hlsl", Pipeline_Wavefront },
+        { "RaytracingInline.hlsl", Pipeline_Inline }
+    };
+    uint32_t pipelines = changedShaders.empty() ? static_cast<uint32_t>(Pipeline_All) : 0u;
+    m_unappliedShaderChanges.clear();
+    for (const std::string& changedShader : changedShaders)
+    {
+        uint32_t dependentPipelines = 0;
+        for (const PipelineSource& source : pipelineSources)
+        {
+            if (IncludesShader(source.file, changedShader))
+            {
+                dependentPipelines |= source.pipeline;
+            }
+        }
+        if (dependentPipelines == 0)
+        {
+            OutputDebugStringA(std::format("{} is not included by any pipeline, not reloaded.\n", changedShader).c_str());
+            m_unappliedShaderChanges.push_back(changedShader);
+        }
+        pipelines |= dependentPipelines;
+    }
+
+    // Started by the next Render(), after the pipeline reload in progress
+    if (!m_isInlineRaytracingSupported)
+    {
+        pipelines &= ~Pipeline_Inline;
+    }
+    m_queuedPipelineReloads |= pipelines & (Pipeline_Wavefront | Pipeline_Inline);
+    if ((pipelines & Pipeline_Megakernel) == 0)
+    {
+        return;
+    }
+
+    // The state objects of the cache and their shader tables are released after the frames in flight, the active ones
+    // keep rendering until the requested permutation is compiled from the new sources. A permutation queued before the
+    // reload is compiled from the new sources anyway.
+    std::vector<ComPtr<ID3D12StateObject>> stateObjects;
+    m_permutationCache.Invalidate(stateObjects);
+    for (ComPtr<ID3D12StateObject>& stateObject : stateObjects)
+    {
+        RetirePipeline(std::move(stateObject), nullptr);
+    }
+    for (auto& [packedKey, shaderTable] : m_shaderTables)
+    {
+        if (shaderTable.get() == m_shaderTable)
+        {
+            m_staleShaderTable = std::move(shaderTable);
+        }
+        else
+        {
+            RetirePipeline(nullptr, std::move(shaderTable));
+        }
+    }
+    m_shaderTables.clear();
+
+    m_isReloadPending = true;
+    m_permutationCache.Request(m_requestedPermutation);
+    OutputDebugStringA(std::format("Reloading the shaders of permutation [{}].\n", GetShaderPermutationName(m_requestedPermutation)).c_str());
+}
+
+void Raytracing::RetirePipeline(ComPtr<ID3D12StateObject> stateObject, std::unique_ptr<ShaderTableBuilder> shaderTable,
+    std::vector<ComPtr<ID3D12PipelineState>> pipelineStates)
+{
+    // The fence of the current frame is never smaller than the one of a previous frame using them
+    RetiredPipeline retired;
+    retired.fenceValue = m_frameFenceValue;
+    retired.stateObject = std::move(stateObject);
+    retired.shaderTable = std::move(shaderTable);
+    retired.pipelineStates = std::move(pipelineStates);
+    m_retiredPipelines.push_back(std::move(retired));
+}
+
+Raytracing::ShaderPipelines Raytracing::CreateShaderPipelines(uint32_t pipelines) const
+{
+    // Called on the reload thread: only the device, the root signature and the frame count, which do not change after
+    // Initialize(), are read
+    ShaderPipelines shaderPipelines;
+    shaderPipelines.pipelines = pipelines;
+    if ((pipelines & Pipeline_Wavefront) && !CreateWavefrontPipeline(shaderPipelines))
+    {
+        shaderPipelines.failedPipelines |= Pipeline_Wavefront;
+    }
+    if ((pipelines & Pipeline_Inline) && m_isInlineRaytracingSupported && !CreateInlineRaytracingPipeline(shaderPipelines))
+    {
+        shaderPipelines.failedPipelines |= Pipeline_Inline;
+    }
+    return shaderPipelines;
+}
+
+void Raytracing::ApplyShaderPipelines(ShaderPipelines& pipelines)
+{
+    // Switched between two frames like the megakernel permutation, the previous frames may still use the replaced ones
+    if (pipelines.wavefrontPipelineState)
+    {
+        std::vector<ComPtr<ID3D12PipelineState>> stages;
+        for (uint32_t stage = 0; stage < StageCount; ++stage)
+        {
+            stages.push_back(std::move(m_wavefrontStages[stage]));
+            m_wavefrontStages[stage] = std::move(pipelines.wavefrontStages[stage]);
+        }
+        if (m_wavefrontPipelineState)
+        {
+            RetirePipeline(std::move(m_wavefrontPipelineState), std::move(m_wavefrontShaderTable), std::move(stages));
+        }
+        m_wavefrontPipelineState = std::move(pipelines.wavefrontPipelineState);
+        m_wavefrontShaderTable = std::move(pipelines.wavefrontShaderTable);
+        if (m_renderMode == RenderMode::Wavefront)
+        {
+            m_sampleIndex = 0;
+        }
+    }
+    if (pipelines.inlineRaytracingState)
+    {
+        if (m_inlineRaytracingState)
+        {
+            std::vector<ComPtr<ID3D12PipelineState>> inlineState;
+            inlineState.push_back(std::move(m_inlineRaytracingState));
+            RetirePipeline(nullptr, nullptr, std::move(inlineState));
+        }
+        m_inlineRaytracingState = std::move(pipelines.inlineRaytracingState);
+        if (m_renderMode == RenderMode::InlineRayQuery)
+        {
+            m_sampleIndex = 0;
+        }
+    }
+}
+
+void Raytracing::UpdateShaderPipelines()
+{
+    if (m_pipelineReload.valid() && m_pipelineReload.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+    {
+        ShaderPipelines pipelines = m_pipelineReload.get();
+        m_failedPipelines = (m_failedPipelines & ~pipelines.pipelines) | pipelines.failedPipelines;
+        m_pipelineErrors = std::move(pipelines.errors);
+        if (pipelines.failedPipelines != 0)
+        {
+            OutputDebugStringA("A pipeline failed to reload, the previous one keeps rendering.\n");
+        }
+        ApplyShaderPipelines(pipelines);
+    }
+
+    // Changes saved while the last reload compiled are compiled from the newer sources
+    if (!m_pipelineReload.valid() && m_queuedPipelineReloads != 0)
+    {
+        const uint32_t pipelines = m_queuedPipelineReloads;
+        m_queuedPipelineReloads = 0;
+        m_pipelineReload = std::async(std::launch::async, [this, pipelines]() { return CreateShaderPipelines(pipelines); });
+        const char* names = pipelines == (Pipeline_Wavefront | Pipeline_Inline) ? "wavefront and inline pipelines" :
+            pipelines == Pipeline_Wavefront ? "wavefront pipeline" : "inline pipeline";
+        OutputDebugStringA(std::format("Reloading the {}.\n", names).c_str());
+    }
+}
+
+void Raytracing::SetRenderMode(RenderMode mode)
+{
+    if (!IsRenderModeSupported(mode))
+    {
+        OutputDebugStringA(std::format("Render mode {} is not supported on this device.\n", GetRenderModeName(mode)).c_str());
+        return;
+    }
+
+    if (mode != m_renderMode)
+    {
+        m_sampleIndex = 0;
+    }
+    m_renderMode = mode;
+    if (m_device && m_renderMode == RenderMode::Wavefront && !m_rayQueue)
+    {
+        CreateWavefrontResources();
+    }
 }
 
 
 void Raytracing::CreateRaytracingPipeline()
 {
-    // Compile shaders
-    ComPtr<IDxcBlob> rayGenShader = CompileShader(L"shaders/Raytracing.hlsl", L"RayGenShader", L"lib_6_3");
-    ComPtr<IDxcBlob> closestHitShader = CompileShader(L"shaders/Raytracing.hlsl", L"ClosestHitShader", L"lib_6_3");
-    ComPtr<IDxcBlob> missShader = CompileShader(L"shaders/Raytracing.hlsl", L"MissShader", L"lib_6_3");
-    
     // Create root signature
     {
         // Define descriptor ranges
+        // t0: acceleration structure, t1: geometry buffer, t2: sample tables
         D3D12_DESCRIPTOR_RANGE srvRange = {};
         srvRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-        srvRange.NumDescriptors = 1;
+        srvRange.NumDescriptors = DescHeapEntries::SRV_SamplerTables - DescHeapEntries::SRV_TLAS + 1;
         srvRange.BaseShaderRegister = 0;
         srvRange.RegisterSpace = 0;
         srvRange.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
 
+        // u0: output, u1: path tracing accumulation
         D3D12_DESCRIPTOR_RANGE uavRange = {};
         uavRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
-        uavRange.NumDescriptors = 1;
+        uavRange.NumDescriptors = DescHeapEntries::UAV_Accumulation - DescHeapEntries::UAV_Output + 1;
         uavRange.BaseShaderRegister = 0;
         uavRange.RegisterSpace = 0;
         uavRange.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+
+        // u2-u7: queues of the wavefront mode
+        D3D12_DESCRIPTOR_RANGE wavefrontRange = {};
+        wavefrontRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
+        wavefrontRange.NumDescriptors = DescHeapEntries::UAV_Counters - DescHeapEntries::UAV_RayQueue + 1;
+        wavefrontRange.BaseShaderRegister = 2;
+        wavefrontRange.RegisterSpace = 0;
+        wavefrontRange.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
         
         // Define root parameters
-        D3D12_ROOT_PARAMETER rootParameters[2] = {};
+        D3D12_ROOT_PARAMETER rootParameters[4] = {};
         
-        // SRV for acceleration structure (as descriptor table)
+        // SRVs for acceleration structure and geometry buffer (as descriptor table)
         rootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
         rootParameters[0].DescriptorTable.NumDescriptorRanges = 1;
         rootParameters[0].DescriptorTable.pDescriptorRanges = &srvRange;
         rootParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
 
-        // UAV for output (as descriptor table)
+        // UAVs for the output and the accumulation (as descriptor table)
         rootParameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
         rootParameters[1].DescriptorTable.NumDescriptorRanges = 1;
         rootParameters[1].DescriptorTable.pDescriptorRanges = &uavRange;
         rootParameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+        // Root constants for the MeshInfo offset, the camera and the path tracing sample
+        rootParameters[2].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+        rootParameters[2].Constants.ShaderRegister = 0;
+        rootParameters[2].Constants.RegisterSpace = 0;
+        rootParameters[2].Constants.Num32BitValues = GEOMETRY_CONSTANT_COUNT;
+        rootParameters[2].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+        // UAVs for the wavefront queues (as descriptor table)
+        rootParameters[3].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+        rootParameters[3].DescriptorTable.NumDescriptorRanges = 1;
+        rootParameters[3].DescriptorTable.pDescriptorRanges = &wavefrontRange;
+        rootParameters[3].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
         
         D3D12_ROOT_SIGNATURE_DESC rootSignatureDesc = {};
-        rootSignatureDesc.NumParameters = 2;
+        rootSignatureDesc.NumParameters = _countof(rootParameters);
         rootSignatureDesc.pParameters = rootParameters;
         rootSignatureDesc.NumStaticSamplers = 0;
         rootSignatureDesc.pStaticSamplers = nullptr;
@@ -102,81 +561,125 @@ void Raytracing::CreateRaytracingPipeline()
         m_rtGlobalRootSignature->SetName(L"Raytracing Global Root Signature");
     }
     
-    // Create raytracing pipeline state object
+    // The permutation of the first frames is compiled now, the others on the compile threads. DXC instances are per
+    // thread and the state objects are created on the free threaded device, the root signature is not changed again.
+    const uint32_t numCompileThreads = std::clamp(std::thread::hardware_concurrency() / 4, 1u, 4u);
+    m_permutationCache.Initialize([this](const ShaderPermutationKey& key, std::string& errors) { return CreateRaytracingStateObject(key, errors); }, numCompileThreads);
+    m_activePermutation = m_requestedPermutation;
+    m_rtPipelineState = m_permutationCache.Compile(m_activePermutation);
+    if (!m_rtPipelineState)
     {
-        std::vector<D3D12_STATE_SUBOBJECT> subobjects;
-        
-        // DXIL library - Since all shaders are in the same file, we only need one library
-        D3D12_DXIL_LIBRARY_DESC dxilLibDesc = {};
-        dxilLibDesc.DXILLibrary.pShaderBytecode = rayGenShader->GetBufferPointer();
-        dxilLibDesc.DXILLibrary.BytecodeLength = rayGenShader->GetBufferSize();
-        
-        // Define exports for all shaders in the library
-        D3D12_EXPORT_DESC exports[] = {
-            { L"RayGenShader", nullptr, D3D12_EXPORT_FLAG_NONE },
-            { L"ClosestHitShader", nullptr, D3D12_EXPORT_FLAG_NONE },
-            { L"MissShader", nullptr, D3D12_EXPORT_FLAG_NONE }
-        };
-        dxilLibDesc.NumExports = _countof(exports);
-        dxilLibDesc.pExports = exports;
-        
-        D3D12_STATE_SUBOBJECT dxilLib = {};
-        dxilLib.Type = D3D12_STATE_SUBOBJECT_TYPE_DXIL_LIBRARY;
-        dxilLib.pDesc = &dxilLibDesc;
-        subobjects.push_back(dxilLib);
-        
-        // Hit group
-        D3D12_HIT_GROUP_DESC hitGroup = {};
-        hitGroup.HitGroupExport = L"HitGroup";
-        hitGroup.Type = D3D12_HIT_GROUP_TYPE_TRIANGLES;
-        hitGroup.ClosestHitShaderImport = L"ClosestHitShader";
-        
-        D3D12_STATE_SUBOBJECT hitGroupSubobject = {};
-        hitGroupSubobject.Type = D3D12_STATE_SUBOBJECT_TYPE_HIT_GROUP;
-        hitGroupSubobject.pDesc = &hitGroup;
-        subobjects.push_back(hitGroupSubobject);
-        
-        // Shader config
-        D3D12_RAYTRACING_SHADER_CONFIG shaderConfig = {};
-        shaderConfig.MaxPayloadSizeInBytes = sizeof(float) * 3;  // float3 color
-        shaderConfig.MaxAttributeSizeInBytes = sizeof(float) * 2; // float2 barycentrics
-        
-        D3D12_STATE_SUBOBJECT shaderConfigSubobject = {};
-        shaderConfigSubobject.Type = D3D12_STATE_SUBOBJECT_TYPE_RAYTRACING_SHADER_CONFIG;
-        shaderConfigSubobject.pDesc = &shaderConfig;
-        subobjects.push_back(shaderConfigSubobject);
-        
-        // Global root signature
-        D3D12_GLOBAL_ROOT_SIGNATURE globalRootSig = {};
-        globalRootSig.pGlobalRootSignature = m_rtGlobalRootSignature.Get();
-        
-        D3D12_STATE_SUBOBJECT globalRootSigSubobject = {};
-        globalRootSigSubobject.Type = D3D12_STATE_SUBOBJECT_TYPE_GLOBAL_ROOT_SIGNATURE;
-        globalRootSigSubobject.pDesc = &globalRootSig;
-        subobjects.push_back(globalRootSigSubobject);
-        
-        // Pipeline config
-        D3D12_RAYTRACING_PIPELINE_CONFIG pipelineConfig = {};
-        pipelineConfig.MaxTraceRecursionDepth = 1;
-        
-        D3D12_STATE_SUBOBJECT pipelineConfigSubobject = {};
-        pipelineConfigSubobject.Type = D3D12_STATE_SUBOBJECT_TYPE_RAYTRACING_PIPELINE_CONFIG;
-        pipelineConfigSubobject.pDesc = &pipelineConfig;
-        subobjects.push_back(pipelineConfigSubobject);
-        
-        // Create the state object
-        D3D12_STATE_OBJECT_DESC raytracingPipeline = {};
-        raytracingPipeline.Type = D3D12_STATE_OBJECT_TYPE_RAYTRACING_PIPELINE;
-        raytracingPipeline.NumSubobjects = static_cast<UINT>(subobjects.size());
-        raytracingPipeline.pSubobjects = subobjects.data();
-        
-        ThrowIfFailed(m_device->CreateStateObject(&raytracingPipeline, IID_PPV_ARGS(&m_rtPipelineState)));
-        m_rtPipelineState->SetName(L"Raytracing Pipeline State Object");
+        ThrowIfFailed(E_FAIL);
     }
     
     OutputDebugStringA("Raytracing pipeline created successfully.\n");
 }
 
+ComPtr<ID3D12StateObject> Raytracing::CreateRaytracingStateObject(const ShaderPermutationKey& key, std::string& errors)
+{
+    ComPtr<IDxcBlob> library = TryCompileShader(L"shaders/Raytracing.hlsl", L"RayGenShader", L"lib_6_3", GetShaderPermutationDefines(key), errors);
+    if (!library)
+    {
+        return nullptr;
+    }
+
+    std::vector<D3D12_STATE_SUBOBJECT> subobjects;
+    
+    // DXIL library - Since all shaders are in the same file, we only need one library
+    D3D12_DXIL_LIBRARY_DESC dxilLibDesc = {};
+    dxilLibDesc.DXILLibrary.pShaderBytecode = library->GetBufferPointer();
+    dxilLibDesc.DXILLibrary.BytecodeLength = library->GetBufferSize();
+    
+    // Define exports for all shaders in the library
+    D3D12_EXPORT_DESC exports[] = {
+        { L"RayGenShader", nullptr, D3D12_EXPORT_FLAG_NONE },
+        { L"ClosestHitShader", nullptr, D3D12_EXPORT_FLAG_NONE },
+        { L"MissShader", nullptr, D3D12_EXPORT_FLAG_NONE },
+        { L"ShadowMissShader", nullptr, D3D12_EXPORT_FLAG_NONE }
+    };
+    dxilLibDesc.NumExports = _countof(exports);
+    dxilLibDesc.pExports = exports;
+    
+    D3D12_STATE_SUBOBJECT dxilLib = {};
+    dxilLib.Type = D3D12_STATE_SUBOBJECT_TYPE_DXIL_LIBRARY;
+    dxilLib.pDesc = &dxilLibDesc;
+    subobjects.push_back(dxilLib);
+    
+    // Hit group
+    D3D12_HIT_GROUP_DESC hitGroup = {};
+    hitGroup.HitGroupExport = L"HitGroup";
+    hitGroup.Type = D3D12_HIT_GROUP_TYPE_TRIANGLES;
+    hitGroup.ClosestHitShaderImport = L"ClosestHitShader";
+    
+    D3D12_STATE_SUBOBJECT hitGroupSubobject = {};
+    hitGroupSubobject.Type = D3D12_STATE_SUBOBJECT_TYPE_HIT_GROUP;
+    hitGroupSubobject.pDesc = &hitGroup;
+    subobjects.push_back(hitGroupSubobject);
+    
+    // Shader config
+    D3D12_RAYTRACING_SHADER_CONFIG shaderConfig = {};
+    shaderConfig.MaxPayloadSizeInBytes = GetRayPayloadSize(key);   // the radiance payload holds the shadow payload
+    shaderConfig.MaxAttributeSizeInBytes = sizeof(ShaderLayout::RayAttributes);
+    
+    D3D12_STATE_SUBOBJECT shaderConfigSubobject = {};
+    shaderConfigSubobject.Type = D3D12_STATE_SUBOBJECT_TYPE_RAYTRACING_SHADER_CONFIG;
+    shaderConfigSubobject.pDesc = &shaderConfig;
+    subobjects.push_back(shaderConfigSubobject);
+    
+    // Global root signature
+    D3D12_GLOBAL_ROOT_SIGNATURE globalRootSig = {};
+    globalRootSig.pGlobalRootSignature = m_rtGlobalRootSignature.Get();
+    
+    D3D12_STATE_SUBOBJECT globalRootSigSubobject = {};
+    globalRootSigSubobject.Type = D3D12_STATE_SUBOBJECT_TYPE_GLOBAL_ROOT_SIGNATURE;
+    globalRootSigSubobject.pDesc = &globalRootSig;
+    subobjects.push_back(globalRootSigSubobject);
+    
+    // Pipeline config
+    D3D12_RAYTRACING_PIPELINE_CONFIG pipelineConfig = {};
+    pipelineConfig.MaxTraceRecursionDepth = 1;
+    
+    D3D12_STATE_SUBOBJECT pipelineConfigSubobject = {};
+    pipelineConfigSubobject.Type = D3D12_STATE_SUBOBJECT_TYPE_RAYTRACING_PIPELINE_CONFIG;
+    pipelineConfigSubobject.pDesc = &pipelineConfig;
+    subobjects.push_back(pipelineConfigSubobject);
+    
+    // Create the state object
+    D3D12_STATE_OBJECT_DESC raytracingPipeline = {};
+    raytracingPipeline.Type = D3D12_STATE_OBJECT_TYPE_RAYTRACING_PIPELINE;
+    raytracingPipeline.NumSubobjects = static_cast<UINT>(subobjects.size());
+    raytracingPipeline.pSubobjects = subobjects.data();
+    
+    ComPtr<ID3D12StateObject> stateObject;
+    HRESULT hr = m_device->CreateStateObject(&raytracingPipeline, IID_PPV_ARGS(&stateObject));
+    if (FAILED(hr))
+    {
+        std::string message = std::format("Failed to create the ray tracing state object of [{}]: 0x{:08X}\n", GetShaderPermutationName(key), static_cast<uint32_t>(hr));
+        OutputDebugStringA(message.c_str());
+        errors += message;
+        return nullptr;
+    }
+    std::wstring name = L"Raytracing Pipeline State Object " + std::to_wstring(key.Pack());
+    stateObject->SetName(name.c_str());
+
+    // The ray generation shader traces the radiance and the shadow rays of the path, the closest hit and miss shaders
+    // do not trace and the shadow ray has a null hit group. Set before the state object is shared with the render thread.
+    ComPtr<ID3D12StateObjectProperties> properties;
+    if (SUCCEEDED(stateObject.As(&properties)))
+    {
+        PipelineStackGraph stackGraph;
+        const uint32_t rayGen = stackGraph.AddShader(PipelineShaderStage::RayGen, GetShaderStackSize(properties.Get(), L"RayGenShader"));
+        const uint32_t closestHit = stackGraph.AddShader(PipelineShaderStage::ClosestHit, GetShaderStackSize(properties.Get(), L"HitGroup::closesthit"));
+        stackGraph.AddHitGroup(RayType_Radiance, closestHit, PipelineStackGraph::NO_SHADER, PipelineStackGraph::NO_SHADER);
+        stackGraph.AddMiss(RayType_Radiance, stackGraph.AddShader(PipelineShaderStage::Miss, GetShaderStackSize(properties.Get(), L"MissShader")));
+        stackGraph.AddMiss(RayType_Shadow, stackGraph.AddShader(PipelineShaderStage::Miss, GetShaderStackSize(properties.Get(), L"ShadowMissShader")));
+        stackGraph.AddTrace(rayGen, RayType_Radiance);
+        stackGraph.AddTrace(rayGen, RayType_Shadow);
+        SetPipelineStackSize(properties.Get(), stackGraph, pipelineConfig.MaxTraceRecursionDepth, "[" + GetShaderPermutationName(key) + "]");
+    }
+    return stateObject;
+}
+
 void Raytracing::CreateDescriptorHeap()
 {
     // Create descriptor heaps for each frame
@@ -196,6 +699,11 @@ void Raytracing::CreateDescriptorHeap()
         std::wstring heapName = L"Raytracing Descriptor Heap[" + std::to_wstring(i) + L"]";
         m_descHeaps[i]->SetName(heapName.c_str());
     }
+
+    // Every entry of the per-frame heaps is written in UpdateDescriptorHeap()
+    const uint32_t numDescriptors = DescHeapEntries::Count * m_swapChainBufferCount;
+    m_descHeapRegistryId = HeapRegistry::Instance().Register("Raytracing Descriptor Heaps", "Descriptor",
+        [numDescriptors]() { return MakeDescriptorHeapStats(numDescriptors, numDescriptors); });
 }
 
 void Raytracing::CreateRaytracingOutputResource()
@@ -229,88 +737,303 @@ void Raytracing::CreateRaytracingOutputResource()
         nullptr,
         IID_PPV_ARGS(&m_raytracingOutput)));
     m_raytracingOutput->SetName(L"Raytracing Output");
+
+    // Radiance sum of the path tracing samples, restarted with the new size
+    outputDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+    ThrowIfFailed(m_device->CreateCommittedResource(
+        &heapProperties,
+        D3D12_HEAP_FLAG_NONE,
+        &outputDesc,
+        D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+        nullptr,
+        IID_PPV_ARGS(&m_accumulation)));
+    m_accumulation->SetName(L"Path Tracing Accumulation");
+    m_sampleIndex = 0;
 }
 
-void Raytracing::CreateShaderTable()
+void Raytracing::CreateSamplerTables()
 {
-    
-    // Get shader identifiers
-    ComPtr<ID3D12StateObjectProperties> stateObjectProps;
-    ThrowIfFailed(m_rtPipelineState.As(&stateObjectProps));
-    
-    void* rayGenShaderIdentifier = stateObjectProps->GetShaderIdentifier(L"RayGenShader");
-    void* missShaderIdentifier = stateObjectProps->GetShaderIdentifier(L"MissShader");
-    void* hitGroupIdentifier = stateObjectProps->GetShaderIdentifier(L"HitGroup");
-    
-    if (!rayGenShaderIdentifier || !missShaderIdentifier || !hitGroupIdentifier)
+    // The generation takes a few seconds on one core, the cache file skips it on the next start
+    SamplerTables tables;
     {
-        OutputDebugStringA("Failed to get shader identifiers\n");
-        ThrowIfFailed(E_FAIL);
+        ThreadPool threadPool;
+        LoadOrGenerateSamplerTables(SAMPLER_TABLES_PATH, threadPool, tables);
     }
+    const std::vector<uint8_t> data = SerializeSamplerTables(tables);
 
-    // Shader table entry size (aligned to D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT)
-    const uint32_t shaderIdentifierSize = D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES;
-    const uint32_t shaderTableAlignment = D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT;
-    m_shaderTableEntrySize = AlignSize(shaderIdentifierSize, shaderTableAlignment);
-    
-    // Calculate shader table size
-    const uint32_t shaderTableSize = m_shaderTableEntrySize * 3; // RayGen + Miss + HitGroup
-    
-    // Create shader table buffer
-    D3D12_HEAP_PROPERTIES uploadHeap = {};
-    uploadHeap.Type = D3D12_HEAP_TYPE_UPLOAD;
-    uploadHeap.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-    uploadHeap.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-    uploadHeap.CreationNodeMask = 0;
-    uploadHeap.VisibleNodeMask = 0;
-    
-    D3D12_RESOURCE_DESC bufferDesc = {};
-    bufferDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-    bufferDesc.Alignment = 0;
-    bufferDesc.Width = shaderTableSize;
-    bufferDesc.Height = 1;
-    bufferDesc.DepthOrArraySize = 1;
-    bufferDesc.MipLevels = 1;
-    bufferDesc.Format = DXGI_FORMAT_UNKNOWN;
-    bufferDesc.SampleDesc.Count = 1;
-    bufferDesc.SampleDesc.Quality = 0;
-    bufferDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-    bufferDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-    
-    ThrowIfFailed(m_device->CreateCommittedResource(
-        &uploadHeap,
-        D3D12_HEAP_FLAG_NONE,
-        &bufferDesc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&m_shaderTable)));
-    m_shaderTable->SetName(L"Shader Table");
-    
-    // Map and write shader identifiers
+    m_samplerTables = CreateBuffer(m_device, data.size(), D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_FLAG_NONE,
+        D3D12_RESOURCE_STATE_COPY_DEST, L"Sampler Tables");
+    m_samplerTablesUpload = CreateBuffer(m_device, data.size(), D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_FLAG_NONE,
+        D3D12_RESOURCE_STATE_GENERIC_READ, L"Sampler Tables Upload");
+    void* mapped = nullptr;
+    const D3D12_RANGE readRange = { 0, 0 };
+    ThrowIfFailed(m_samplerTablesUpload->Map(0, &readRange, &mapped));
+    memcpy(mapped, data.data(), data.size());
+    m_samplerTablesUpload->Unmap(0, nullptr);
+    m_samplerTablesUploadFenceValue = 0;
+}
+
+void Raytracing::UploadSamplerTables(ID3D12GraphicsCommandList4* commandList)
+{
+    if (!m_samplerTablesUpload || m_samplerTablesUploadFenceValue != 0)
     {
-        uint8_t* pData = nullptr;
-        ThrowIfFailed(m_shaderTable->Map(0, nullptr, reinterpret_cast<void**>(&pData)));
-        
-        // Copy shader identifiers
-        memcpy(pData, rayGenShaderIdentifier, shaderIdentifierSize);
-        pData += m_shaderTableEntrySize;
-        
-        memcpy(pData, missShaderIdentifier, shaderIdentifierSize);
-        pData += m_shaderTableEntrySize;
-        
-        memcpy(pData, hitGroupIdentifier, shaderIdentifierSize);
-        
-        m_shaderTable->Unmap(0, nullptr);
+        return;
+    }
+    commandList->CopyBufferRegion(m_samplerTables.Get(), 0, m_samplerTablesUpload.Get(), 0, SAMPLER_TABLES_SIZE);
+
+    D3D12_RESOURCE_BARRIER barrier = {};
+    barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+    barrier.Transition.pResource = m_samplerTables.Get();
+    barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
+    barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+    barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+    commandList->ResourceBarrier(1, &barrier);
+    m_samplerTablesUploadFenceValue = m_frameFenceValue;
+}
+
+ShaderTableBuilder& Raytracing::GetShaderTable(const ShaderPermutationKey& key, ID3D12StateObject* stateObject)
+{
+    std::unique_ptr<ShaderTableBuilder>& shaderTablePointer = m_shaderTables[key.Pack()];
+    if (shaderTablePointer)
+    {
+        return *shaderTablePointer;
+    }
+    shaderTablePointer = std::make_unique<ShaderTableBuilder>();
+    ShaderTableBuilder& shaderTable = *shaderTablePointer;
+
+    // Ray generation, a miss record per ray type and the hit group records of the single geometry of every BLAS in ray
+    // type order, null for the shadow hit group. No shader has local root arguments yet.
+    const wchar_t* hitGroupExports[RayTypeCount] = { L"HitGroup", nullptr };
+    shaderTable.AddRecord(ShaderTableSection::RayGen, L"RayGenShader");
+    shaderTable.AddRecord(ShaderTableSection::Miss, L"MissShader");
+    shaderTable.AddRecord(ShaderTableSection::Miss, L"ShadowMissShader");
+    shaderTable.AddHitGroupRecords(hitGroupExports, RayTypeCount, 1);
+    std::wstring name = L"Shader Table " + std::to_wstring(key.Pack());
+    shaderTable.Build(m_device, stateObject, m_swapChainBufferCount, name.c_str());
+    return shaderTable;
+}
+
+bool Raytracing::CreateWavefrontPipeline(ShaderPipelines& pipelines) const
+{
+    // Compute stages, with the global root signature of the ray tracing pipeline. Nothing is set in pipelines unless
+    // every stage, the state object and the shader table are created.
+    const wchar_t* stageEntryPoints[StageCount] = {
+        L"WavefrontReset", L"WavefrontGenerate", L"WavefrontNextBounce", L"WavefrontBinOffsets", L"WavefrontScatter", L"WavefrontShade", L"WavefrontResolve"
+    };
+    ComPtr<ID3D12PipelineState> stages[StageCount];
+    for (uint32_t stage = 0; stage < StageCount; ++stage)
+    {
+        ComPtr<IDxcBlob> computeShader = TryCompileShader(L"shaders/Wavefront.hlsl", stageEntryPoints[stage], L"cs_6_3", {}, pipelines.errors);
+        if (!computeShader)
+        {
+            return false;
+        }
+
+        D3D12_COMPUTE_PIPELINE_STATE_DESC pipelineDesc = {};
+        pipelineDesc.pRootSignature = m_rtGlobalRootSignature.Get();
+        pipelineDesc.CS.pShaderBytecode = computeShader->GetBufferPointer();
+        pipelineDesc.CS.BytecodeLength = computeShader->GetBufferSize();
+        HRESULT hr = m_device->CreateComputePipelineState(&pipelineDesc, IID_PPV_ARGS(&stages[stage]));
+        if (FAILED(hr))
+        {
+            pipelines.errors += std::format("Failed to create the wavefront stage {}: 0x{:08X}\n", stage, static_cast<uint32_t>(hr));
+            return false;
+        }
+        stages[stage]->SetName(stageEntryPoints[stage]);
+    }
+
+    // Extend and shadow connect state object
+    ComPtr<ID3D12StateObject> stateObject;
+    {
+        ComPtr<IDxcBlob> library = TryCompileShader(L"shaders/WavefrontTrace.hlsl", L"WavefrontExtendRayGen", L"lib_6_3", {}, pipelines.errors);
+        if (!library)
+        {
+            return false;
+        }
+        std::vector<D3D12_STATE_SUBOBJECT> subobjects;
+
+        D3D12_DXIL_LIBRARY_DESC dxilLibDesc = {};
+        dxilLibDesc.DXILLibrary.pShaderBytecode = library->GetBufferPointer();
+        dxilLibDesc.DXILLibrary.BytecodeLength = library->GetBufferSize();
+        D3D12_EXPORT_DESC exports[] = {
+            { L"WavefrontExtendRayGen", nullptr, D3D12_EXPORT_FLAG_NONE },
+            { L"WavefrontShadowRayGen", nullptr, D3D12_EXPORT_FLAG_NONE },
+            { L"WavefrontClosestHit", nullptr, D3D12_EXPORT_FLAG_NONE },
+            { L"WavefrontMiss", nullptr, D3D12_EXPORT_FLAG_NONE },
+            { L"WavefrontShadowMiss", nullptr, D3D12_EXPORT_FLAG_NONE }
+        };
+        dxilLibDesc.NumExports = _countof(exports);
+        dxilLibDesc.pExports = exports;
+        subobjects.push_back({ D3D12_STATE_SUBOBJECT_TYPE_DXIL_LIBRARY, &dxilLibDesc });
+
+        D3D12_HIT_GROUP_DESC hitGroup = {};
+        hitGroup.HitGroupExport = L"WavefrontHitGroup";
+        hitGroup.Type = D3D12_HIT_GROUP_TYPE_TRIANGLES;
+        hitGroup.ClosestHitShaderImport = L"WavefrontClosestHit";
+        subobjects.push_back({ D3D12_STATE_SUBOBJECT_TYPE_HIT_GROUP, &hitGroup });
+
+        // The payloads are a ray index and a visibility flag, the hits go to the queues
+        D3D12_RAYTRACING_SHADER_CONFIG shaderConfig = {};
+        shaderConfig.MaxPayloadSizeInBytes = sizeof(ShaderLayout::WavefrontPayload);    // holds the shadow payload
+        shaderConfig.MaxAttributeSizeInBytes = sizeof(ShaderLayout::RayAttributes);
+        subobjects.push_back({ D3D12_STATE_SUBOBJECT_TYPE_RAYTRACING_SHADER_CONFIG, &shaderConfig });
+
+        D3D12_GLOBAL_ROOT_SIGNATURE globalRootSig = {};
+        globalRootSig.pGlobalRootSignature = m_rtGlobalRootSignature.Get();
+        subobjects.push_back({ D3D12_STATE_SUBOBJECT_TYPE_GLOBAL_ROOT_SIGNATURE, &globalRootSig });
+
+        D3D12_RAYTRACING_PIPELINE_CONFIG pipelineConfig = {};
+        pipelineConfig.MaxTraceRecursionDepth = 1;
+        subobjects.push_back({ D3D12_STATE_SUBOBJECT_TYPE_RAYTRACING_PIPELINE_CONFIG, &pipelineConfig });
+
+        D3D12_STATE_OBJECT_DESC raytracingPipeline = {};
+        raytracingPipeline.Type = D3D12_STATE_OBJECT_TYPE_RAYTRACING_PIPELINE;
+        raytracingPipeline.NumSubobjects = static_cast<UINT>(subobjects.size());
+        raytracingPipeline.pSubobjects = subobjects.data();
+        HRESULT hr = m_device->CreateStateObject(&raytracingPipeline, IID_PPV_ARGS(&stateObject));
+        if (FAILED(hr))
+        {
+            pipelines.errors += std::format("Failed to create the wavefront state object: 0x{:08X}\n", static_cast<uint32_t>(hr));
+            return false;
+        }
+        stateObject->SetName(L"Wavefront Pipeline State Object");
+
+        // The extend ray generation shader traces the radiance rays and the shadow connect one the shadow rays, a
+        // dispatch runs one of them
+        ComPtr<ID3D12StateObjectProperties> properties;
+        ThrowIfFailed(stateObject.As(&properties));
+        PipelineStackGraph stackGraph;
+        const uint32_t extendRayGen = stackGraph.AddShader(PipelineShaderStage::RayGen, GetShaderStackSize(properties.Get(), L"WavefrontExtendRayGen"));
+        const uint32_t shadowRayGen = stackGraph.AddShader(PipelineShaderStage::RayGen, GetShaderStackSize(properties.Get(), L"WavefrontShadowRayGen"));
+        const uint32_t closestHit = stackGraph.AddShader(PipelineShaderStage::ClosestHit, GetShaderStackSize(properties.Get(), L"WavefrontHitGroup::closesthit"));
+        stackGraph.AddHitGroup(RayType_Radiance, closestHit, PipelineStackGraph::NO_SHADER, PipelineStackGraph::NO_SHADER);
+        stackGraph.AddMiss(RayType_Radiance, stackGraph.AddShader(PipelineShaderStage::Miss, GetShaderStackSize(properties.Get(), L"WavefrontMiss")));
+        stackGraph.AddMiss(RayType_Shadow, stackGraph.AddShader(PipelineShaderStage::Miss, GetShaderStackSize(properties.Get(), L"WavefrontShadowMiss")));
+        stackGraph.AddTrace(extendRayGen, RayType_Radiance);
+        stackGraph.AddTrace(shadowRayGen, RayType_Shadow);
+        SetPipelineStackSize(properties.Get(), stackGraph, pipelineConfig.MaxTraceRecursionDepth, "the wavefront pipeline");
+    }
+
+    // Shader table, the extend and the shadow connect ray generation records share the miss and hit group records
+    auto shaderTable = std::make_unique<ShaderTableBuilder>();
+    {
+        const wchar_t* hitGroupExports[RayTypeCount] = { L"WavefrontHitGroup", nullptr };
+        shaderTable->AddRecord(ShaderTableSection::RayGen, L"WavefrontExtendRayGen");
+        shaderTable->AddRecord(ShaderTableSection::RayGen, L"WavefrontShadowRayGen");
+        shaderTable->AddRecord(ShaderTableSection::Miss, L"WavefrontMiss");
+        shaderTable->AddRecord(ShaderTableSection::Miss, L"WavefrontShadowMiss");
+        shaderTable->AddHitGroupRecords(hitGroupExports, RayTypeCount, 1);
+        shaderTable->Build(m_device, stateObject.Get(), m_swapChainBufferCount, L"Wavefront Shader Table");
+    }
+
+    for (uint32_t stage = 0; stage < StageCount; ++stage)
+    {
+        pipelines.wavefrontStages[stage] = std::move(stages[stage]);
+    }
+    pipelines.wavefrontPipelineState = std::move(stateObject);
+    pipelines.wavefrontShaderTable = std::move(shaderTable);
+    OutputDebugStringA("Wavefront pipeline created successfully.\n");
+    return true;
+}
+
+void Raytracing::CreateWavefrontResources()
+{
+    // One entry per pixel in every queue, the largest count of a bounce. The ray queue holds the rays of the bounce and
+    // the continuation rays of the next one.
+    const uint64_t numPixels = static_cast<uint64_t>(m_width) * m_height;
+    const D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+    const D3D12_RESOURCE_STATES state = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+    m_rayQueue = CreateBuffer(m_device, 2 * numPixels * sizeof(WavefrontRay), D3D12_HEAP_TYPE_DEFAULT, flags, state, L"Wavefront Ray Queue");
+    m_hitQueue = CreateBuffer(m_device, numPixels * sizeof(WavefrontHit), D3D12_HEAP_TYPE_DEFAULT, flags, state, L"Wavefront Hit Queue");
+    m_sortedHitIndices = CreateBuffer(m_device, numPixels * sizeof(uint32_t), D3D12_HEAP_TYPE_DEFAULT, flags, state, L"Wavefront Sorted Hit Indices");
+    m_shadowQueue = CreateBuffer(m_device, numPixels * sizeof(WavefrontShadowRay), D3D12_HEAP_TYPE_DEFAULT, flags, state, L"Wavefront Shadow Queue");
+    m_pathRadiance = CreateBuffer(m_device, numPixels * sizeof(float) * 4, D3D12_HEAP_TYPE_DEFAULT, flags, state, L"Wavefront Path Radiance");
+    m_wavefrontCounters = CreateBuffer(m_device, WavefrontCounters::SIZE, D3D12_HEAP_TYPE_DEFAULT, flags, state, L"Wavefront Counters");
+}
+
+bool Raytracing::CreateInlineRaytracingPipeline(ShaderPipelines& pipelines) const
+{
+    ComPtr<IDxcBlob> computeShader = TryCompileShader(L"shaders/RaytracingInline.hlsl", L"InlineRaytracingMain", L"cs_6_5", {}, pipelines.errors);
+    if (!computeShader)
+    {
+        return false;
+    }
+
+    // Same global root signature as the ray tracing pipeline, the wavefront table is not used
+    D3D12_COMPUTE_PIPELINE_STATE_DESC pipelineDesc = {};
+    pipelineDesc.pRootSignature = m_rtGlobalRootSignature.Get();
+    pipelineDesc.CS.pShaderBytecode = computeShader->GetBufferPointer();
+    pipelineDesc.CS.BytecodeLength = computeShader->GetBufferSize();
+    HRESULT hr = m_device->CreateComputePipelineState(&pipelineDesc, IID_PPV_ARGS(&pipelines.inlineRaytracingState));
+    if (FAILED(hr))
+    {
+        pipelines.errors += std::format("Failed to create the inline raytracing pipeline state: 0x{:08X}\n", static_cast<uint32_t>(hr));
+        return false;
+    }
+    pipelines.inlineRaytracingState->SetName(L"Inline Raytracing Pipeline State");
+
+    OutputDebugStringA("Inline raytracing pipeline created successfully.\n");
+    return true;
+}
+
+void Raytracing::CreateTimestampQueries(ID3D12CommandQueue* commandQueue)
+{
+    if (!commandQueue || FAILED(commandQueue->GetTimestampFrequency(&m_timestampFrequency)))
+    {
+        m_timestampFrequency = 0;
+        return;
+    }
+
+    D3D12_QUERY_HEAP_DESC queryHeapDesc = {};
+    queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+    queryHeapDesc.Count = m_swapChainBufferCount * 2;
+    ThrowIfFailed(m_device->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&m_timestampQueryHeap)));
+    m_timestampQueryHeap->SetName(L"Raytracing Timestamp Queries");
+
+    m_timestampReadback = CreateBuffer(m_device, sizeof(uint64_t) * queryHeapDesc.Count, D3D12_HEAP_TYPE_READBACK,
+        D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST, L"Raytracing Timestamp Readback");
+    m_timestampRenderModes.assign(m_swapChainBufferCount, RenderMode::Count);
+}
+
+void Raytracing::UpdateRenderModeTiming(uint32_t frameIndex)
+{
+    // The frame index is used again after the fence of its previous frame, so its timestamps are resolved
+    const RenderMode mode = m_timestampRenderModes[frameIndex];
+    if (mode == RenderMode::Count)
+    {
+        return;
+    }
+    m_timestampRenderModes[frameIndex] = RenderMode::Count;
+
+    const D3D12_RANGE readRange = { sizeof(uint64_t) * frameIndex * 2, sizeof(uint64_t) * (frameIndex * 2 + 2) };
+    uint64_t* timestamps = nullptr;
+    if (FAILED(m_timestampReadback->Map(0, &readRange, reinterpret_cast<void**>(&timestamps))))
+    {
+        return;
+    }
+    const uint64_t beginTicks = timestamps[frameIndex * 2];
+    const uint64_t endTicks = timestamps[frameIndex * 2 + 1];
+    const D3D12_RANGE writeRange = { 0, 0 };
+    m_timestampReadback->Unmap(0, &writeRange);
+    if (endTicks < beginTicks)
+    {
+        return;
     }
+
+    RenderModeTiming& timing = m_renderModeTimings[static_cast<uint32_t>(mode)];
+    timing.lastMilliseconds = static_cast<float>(static_cast<double>(endTicks - beginTicks) * 1000.0 / static_cast<double>(m_timestampFrequency));
+    timing.averageMilliseconds = timing.frameCount == 0 ? timing.lastMilliseconds :
+        timing.averageMilliseconds + (timing.lastMilliseconds - timing.averageMilliseconds) * TIMING_AVERAGE_WEIGHT;
+    timing.frameCount++;
 }
 
-ComPtr<IDxcBlob> Raytracing::CompileShader(const std::wstring& filename, const std::wstring& entryPoint, const std::wstring& target)
+ComPtr<IDxcBlob> Raytracing::TryCompileShader(const std::wstring& filename, const std::wstring& entryPoint, const std::wstring& target, const std::vector<std::string>& defines, std::string& messages)
 {
-    static ComPtr<IDxcLibrary> library;
-    static ComPtr<IDxcCompiler> compiler;
-    static ComPtr<IDxcIncludeHandler> includeHandler;
+    // DXC instances must not be shared between threads, every compile thread initializes its own on first use
+    thread_local ComPtr<IDxcLibrary> library;
+    thread_local ComPtr<IDxcCompiler> compiler;
+    thread_local ComPtr<IDxcIncludeHandler> includeHandler;
     
-    // Initialize DXC on first use
     if (!library)
     {
         ThrowIfFailed(DxcCreateInstance(CLSID_DxcLibrary, IID_PPV_ARGS(&library)));
@@ -322,9 +1045,10 @@ ComPtr<IDxcBlob> Raytracing::CompileShader(const std::wstring& filename, const s
     std::ifstream shaderFile(filename, std::ios::binary);
     if (!shaderFile.is_open())
     {
-        std::wstring errorMsg = L"Failed to open shader file: " + filename;
+        std::wstring errorMsg = L"Failed to open shader file: " + filename + L"\n";
         OutputDebugStringW(errorMsg.c_str());
-        throw std::runtime_error("Shader file not found");
+        messages += "Failed to open shader file: " + std::filesystem::path(filename).string() + "\n";
+        return nullptr;
     }
     
     shaderFile.seekg(0, std::ios::end);
@@ -340,7 +1064,12 @@ ComPtr<IDxcBlob> Raytracing::CompileShader(const std::wstring& filename, const s
     ThrowIfFailed(library->CreateBlobWithEncodingFromPinned(
         shaderSource.data(), static_cast<UINT32>(fileSize), CP_UTF8, &sourceBlob));
     
-    // Compile arguments
+    // Compile arguments, the defines of a permutation as -D NAME=VALUE
+    std::vector<std::wstring> defineArguments;
+    for (const std::string& define : defines)
+    {
+        defineArguments.emplace_back(define.begin(), define.end());     // ASCII
+    }
     std::vector<LPCWSTR> arguments;
     arguments.push_back(L"-E");
     arguments.push_back(entryPoint.c_str());
@@ -350,6 +1079,11 @@ ComPtr<IDxcBlob> Raytracing::CompileShader(const std::wstring& filename, const s
     arguments.push_back(L"2021");
     arguments.push_back(L"-I");
     arguments.push_back(L"shaders/");
+    for (const std::wstring& define : defineArguments)
+    {
+        arguments.push_back(L"-D");
+        arguments.push_back(define.c_str());
+    }
     
 #ifdef _DEBUG
     arguments.push_back(L"-Zi");
@@ -373,6 +1107,7 @@ ComPtr<IDxcBlob> Raytracing::CompileShader(const std::wstring& filename, const s
         &result);
     
     // Check for compilation errors or warnings
+    if (SUCCEEDED(hr))
     {
         ComPtr<IDxcBlobEncoding> errors;
         if (SUCCEEDED(result->GetErrorBuffer(&errors)) && errors) {
@@ -380,23 +1115,33 @@ ComPtr<IDxcBlob> Raytracing::CompileShader(const std::wstring& filename, const s
             if (pText != nullptr && errors->GetBufferSize() > 0) {
                 OutputDebugStringA("Shader compilation messages:\n");
                 OutputDebugStringA(pText);
+                messages.append(pText, strnlen(pText, errors->GetBufferSize()));
             }
         }
     }
     
-    // Check if compilation failed
+    // Check if compilation failed, a shader with errors compiles with a failed status
+    if (SUCCEEDED(hr))
+    {
+        HRESULT status = S_OK;
+        hr = SUCCEEDED(result->GetStatus(&status)) ? status : E_FAIL;
+    }
     if (FAILED(hr))
     {
         OutputDebugStringA("Shader compilation failed\n");
-        ThrowIfFailed(hr);
+        if (messages.empty())
+        {
+            messages = "Shader compilation failed\n";
+        }
+        return nullptr;
     }
 
     // Get compiled shader
     ComPtr<IDxcBlob> compiledShader;
     hr = result->GetResult(&compiledShader);
-    if (FAILED(hr)) {
+    if (FAILED(hr) || !compiledShader) {
         OutputDebugStringA("Failed to get compiled shader\n");
-        ThrowIfFailed(hr);
+        return nullptr;
     }
     
     std::wstring successMsg = L"Successfully compiled shader: " + filename + L" [" + entryPoint + L"]\n";
@@ -425,6 +1170,47 @@ void Raytracing::UpdateDescriptorHeap(Scene* scene, uint32_t frameIndex)
         srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
         srvDesc.RaytracingAccelerationStructure.Location = scene->GetTLAS();
         m_device->CreateShaderResourceView(nullptr, &srvDesc, srvDescriptor);
+
+        // A rebuilt or updated TLAS of a changed scene lands in the other buffer, the samples are stale
+        if (scene->GetTLAS() != m_accumulatedTLAS)
+        {
+            m_accumulatedTLAS = scene->GetTLAS();
+            m_sampleIndex = 0;
+        }
+    }
+
+    // Create raw SRV for the geometry buffer
+    if (scene && scene->GetGeometryBuffer())
+    {
+        D3D12_CPU_DESCRIPTOR_HANDLE srvDescriptor = cpuHandle;
+        srvDescriptor.ptr += m_CBVSRVUAVdescHeapSize * DescHeapEntries::SRV_Geometry;
+
+        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+        srvDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+        srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+        srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        srvDesc.Buffer.FirstElement = 0;
+        srvDesc.Buffer.NumElements = static_cast<UINT>(scene->GetGeometryBuffer()->GetDesc().Width / sizeof(uint32_t));
+        srvDesc.Buffer.StructureByteStride = 0;
+        srvDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_RAW;
+        m_device->CreateShaderResourceView(scene->GetGeometryBuffer(), &srvDesc, srvDescriptor);
+
+        m_meshInfoOffset = scene->GetMeshInfoOffset();
+    }
+
+    // Create raw SRV for the sample tables
+    if (m_samplerTables)
+    {
+        D3D12_CPU_DESCRIPTOR_HANDLE srvDescriptor = cpuHandle;
+        srvDescriptor.ptr += m_CBVSRVUAVdescHeapSize * DescHeapEntries::SRV_SamplerTables;
+
+        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+        srvDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+        srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+        srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        srvDesc.Buffer.NumElements = SAMPLER_TABLES_SIZE / sizeof(uint32_t);
+        srvDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_RAW;
+        m_device->CreateShaderResourceView(m_samplerTables.Get(), &srvDesc, srvDescriptor);
     }
     
     // Create UAV for output
@@ -436,6 +1222,50 @@ void Raytracing::UpdateDescriptorHeap(Scene* scene, uint32_t frameIndex)
         uavDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
         uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
         m_device->CreateUnorderedAccessView(m_raytracingOutput.Get(), nullptr, &uavDesc, uavDescriptor);
+
+        uavDescriptor = cpuHandle;
+        uavDescriptor.ptr += m_CBVSRVUAVdescHeapSize * DescHeapEntries::UAV_Accumulation;
+        uavDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+        m_device->CreateUnorderedAccessView(m_accumulation.Get(), nullptr, &uavDesc, uavDescriptor);
+    }
+
+    // Create UAVs for the wavefront queues, null descriptors until the queues are created
+    {
+        struct QueueView
+        {
+            DescHeapEntries entry;
+            ID3D12Resource* resource;
+            uint32_t stride;        // 0 for the raw counter buffer
+        };
+        const QueueView views[] = {
+            { DescHeapEntries::UAV_RayQueue, m_rayQueue.Get(), sizeof(WavefrontRay) },
+            { DescHeapEntries::UAV_HitQueue, m_hitQueue.Get(), sizeof(WavefrontHit) },
+            { DescHeapEntries::UAV_SortedHitIndices, m_sortedHitIndices.Get(), sizeof(uint32_t) },
+            { DescHeapEntries::UAV_ShadowQueue, m_shadowQueue.Get(), sizeof(WavefrontShadowRay) },
+            { DescHeapEntries::UAV_PathRadiance, m_pathRadiance.Get(), sizeof(float) * 4 },
+            { DescHeapEntries::UAV_Counters, m_wavefrontCounters.Get(), 0 }
+        };
+        for (const QueueView& view : views)
+        {
+            D3D12_CPU_DESCRIPTOR_HANDLE uavDescriptor = cpuHandle;
+            uavDescriptor.ptr += m_CBVSRVUAVdescHeapSize * view.entry;
+
+            D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+            uavDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
+            if (view.stride == 0)
+            {
+                uavDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+                uavDesc.Buffer.NumElements = WavefrontCounters::SIZE / sizeof(uint32_t);
+                uavDesc.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_RAW;
+            }
+            else
+            {
+                uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+                uavDesc.Buffer.NumElements = view.resource ? static_cast<UINT>(view.resource->GetDesc().Width / view.stride) : 0;
+                uavDesc.Buffer.StructureByteStride = view.stride;
+            }
+            m_device->CreateUnorderedAccessView(view.resource, nullptr, &uavDesc, uavDescriptor);
+        }
     }
 }
 
@@ -444,6 +1274,10 @@ void Raytracing::Render(ID3D12GraphicsCommandList4* commandList, uint32_t frameI
     if (!m_rtPipelineState || m_descHeaps.empty() || frameIndex >= m_swapChainBufferCount)
         return;
     
+    // Switch to the requested megakernel permutation and the reloaded pipelines once they are compiled
+    UpdateShaderPermutation();
+    UpdateShaderPipelines();
+    
     // Set descriptor heap
     ID3D12DescriptorHeap* heaps[] = { m_descHeaps[frameIndex].Get() };
     commandList->SetDescriptorHeaps(1, heaps);
@@ -460,39 +1294,142 @@ void Raytracing::Render(ID3D12GraphicsCommandList4* commandList, uint32_t frameI
         commandList->SetComputeRootDescriptorTable(0, gpuHandle);
     }
     {
-        // Bind descriptor table for UAV (output)
+        // Bind descriptor table for UAVs (output and accumulation)
         D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle = m_descHeaps[frameIndex]->GetGPUDescriptorHandleForHeapStart();
         gpuHandle.ptr += m_CBVSRVUAVdescHeapSize * DescHeapEntries::UAV_Output;
         commandList->SetComputeRootDescriptorTable(1, gpuHandle);
     }
+    {
+        // Bind descriptor table for UAVs (wavefront queues)
+        D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle = m_descHeaps[frameIndex]->GetGPUDescriptorHandleForHeapStart();
+        gpuHandle.ptr += m_CBVSRVUAVdescHeapSize * DescHeapEntries::UAV_RayQueue;
+        commandList->SetComputeRootDescriptorTable(3, gpuHandle);
+    }
+    GeometryConstants constants = {};
+    constants.meshInfoOffset = m_meshInfoOffset;
+    constants.camera = GetCameraConstants(m_camera, static_cast<float>(m_width) / static_cast<float>(m_height));
+    constants.sampleIndex = m_sampleIndex;
+    constants.maxBounces = m_maxBounces;
+    constants.samplerType = m_samplerType;
+    commandList->SetComputeRoot32BitConstants(2, GEOMETRY_CONSTANT_COUNT, &constants, 0);
+
+    // Sample tables of the first frame and changed shader records, outside of the timed range
+    UploadSamplerTables(commandList);
+    m_shaderTable->Upload(commandList, frameIndex);
+    m_wavefrontShaderTable->Upload(commandList, frameIndex);
 
-    // Dispatch rays
-    if (m_shaderTable)
+    // GPU time of the mode, the timestamps of the last use of this frame index are read first
+    const bool hasTimestamps = m_timestampQueryHeap != nullptr;
+    if (hasTimestamps)
     {
-        // DispatchRays
-        D3D12_DISPATCH_RAYS_DESC dispatchDesc = {};
-        
-        // Ray generation shader table
-        dispatchDesc.RayGenerationShaderRecord.StartAddress = m_shaderTable->GetGPUVirtualAddress();
-        dispatchDesc.RayGenerationShaderRecord.SizeInBytes = m_shaderTableEntrySize;
-        
-        // Miss shader table
-        dispatchDesc.MissShaderTable.StartAddress = m_shaderTable->GetGPUVirtualAddress() + m_shaderTableEntrySize;
-        dispatchDesc.MissShaderTable.SizeInBytes = m_shaderTableEntrySize;
-        dispatchDesc.MissShaderTable.StrideInBytes = m_shaderTableEntrySize;
-        
-        // Hit group table
-        dispatchDesc.HitGroupTable.StartAddress = m_shaderTable->GetGPUVirtualAddress() + m_shaderTableEntrySize * 2;
-        dispatchDesc.HitGroupTable.SizeInBytes = m_shaderTableEntrySize;
-        dispatchDesc.HitGroupTable.StrideInBytes = m_shaderTableEntrySize;
-        
-        // Dispatch dimensions
-        dispatchDesc.Width = m_width;
-        dispatchDesc.Height = m_height;
-        dispatchDesc.Depth = 1;
-        
+        UpdateRenderModeTiming(frameIndex);
+        commandList->EndQuery(m_timestampQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, frameIndex * 2);
+    }
+
+    RenderMode renderedMode = RenderMode::Megakernel;
+    if (m_renderMode == RenderMode::Wavefront && m_rayQueue)
+    {
+        RenderWavefront(commandList);
+        renderedMode = RenderMode::Wavefront;
+    }
+    else if (m_renderMode == RenderMode::InlineRayQuery && m_inlineRaytracingState)
+    {
+        // One thread per pixel, no shader table
+        renderedMode = RenderMode::InlineRayQuery;
+        commandList->SetPipelineState(m_inlineRaytracingState.Get());
+        commandList->Dispatch((m_width + INLINE_RAYTRACING_TILE_SIZE - 1) / INLINE_RAYTRACING_TILE_SIZE,
+            (m_height + INLINE_RAYTRACING_TILE_SIZE - 1) / INLINE_RAYTRACING_TILE_SIZE, 1);
+    }
+    else if (m_shaderTable)
+    {
+        // DispatchRays, TraceRay() strides over the hit group records of the ray types with
+        // MultiplierForGeometryContributionToHitGroupIndex
+        D3D12_DISPATCH_RAYS_DESC dispatchDesc;
+        m_shaderTable->GetDispatchRaysDesc(0, m_width, m_height, dispatchDesc);
         commandList->DispatchRays(&dispatchDesc);
     }
+
+    // Every mode added one path traced sample
+    m_sampleIndex++;
+
+    if (hasTimestamps)
+    {
+        commandList->EndQuery(m_timestampQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, frameIndex * 2 + 1);
+        commandList->ResolveQueryData(m_timestampQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, frameIndex * 2, 2, m_timestampReadback.Get(), sizeof(uint64_t) * frameIndex * 2);
+        m_timestampRenderModes[frameIndex] = renderedMode;
+    }
+}
+
+void Raytracing::RenderWavefront(ID3D12GraphicsCommandList4* commandList)
+{
+    // Every stage reads what the previous one wrote, the root signature and the descriptor tables stay bound
+    D3D12_RESOURCE_BARRIER uavBarrier = {};
+    uavBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+    uavBarrier.UAV.pResource = nullptr;
+
+    const uint32_t numPixels = m_width * m_height;
+    const uint32_t groupsX = (m_width + WAVEFRONT_TILE_SIZE - 1) / WAVEFRONT_TILE_SIZE;
+    const uint32_t groupsY = (m_height + WAVEFRONT_TILE_SIZE - 1) / WAVEFRONT_TILE_SIZE;
+    const uint32_t queueGroups = (numPixels + WAVEFRONT_GROUP_SIZE - 1) / WAVEFRONT_GROUP_SIZE;
+
+    // Ray tracing stages are dispatched over the output dimensions, the largest queue size
+    D3D12_DISPATCH_RAYS_DESC extendDesc;
+    D3D12_DISPATCH_RAYS_DESC shadowDesc;
+    m_wavefrontShaderTable->GetDispatchRaysDesc(0, m_width, m_height, extendDesc);
+    m_wavefrontShaderTable->GetDispatchRaysDesc(1, m_width, m_height, shadowDesc);
+
+    // Reset the counters
+    commandList->SetPipelineState(m_wavefrontStages[Stage_Reset].Get());
+    commandList->Dispatch((WavefrontCounters::SIZE / sizeof(uint32_t) + WAVEFRONT_GROUP_SIZE - 1) / WAVEFRONT_GROUP_SIZE, 1, 1);
+    commandList->ResourceBarrier(1, &uavBarrier);
+
+    // Generate
+    commandList->SetPipelineState(m_wavefrontStages[Stage_Generate].Get());
+    commandList->Dispatch(groupsX, groupsY, 1);
+    commandList->ResourceBarrier(1, &uavBarrier);
+
+    // The bounces, the dispatches after the last live path find empty queues as the counters stay on the GPU
+    for (uint32_t bounce = 0; bounce <= m_maxBounces; ++bounce)
+    {
+        commandList->SetComputeRoot32BitConstant(2, bounce, offsetof(GeometryConstants, wavefrontBounce) / sizeof(uint32_t));
+        if (bounce > 0)
+        {
+            commandList->SetPipelineState(m_wavefrontStages[Stage_NextBounce].Get());
+            commandList->Dispatch(1, 1, 1);
+            commandList->ResourceBarrier(1, &uavBarrier);
+        }
+
+        // Extend, the hits of the last bounce end the paths
+        commandList->SetPipelineState1(m_wavefrontPipelineState.Get());
+        commandList->DispatchRays(&extendDesc);
+        commandList->ResourceBarrier(1, &uavBarrier);
+        if (bounce == m_maxBounces)
+        {
+            break;
+        }
+
+        // Sort the hits by material
+        commandList->SetPipelineState(m_wavefrontStages[Stage_BinOffsets].Get());
+        commandList->Dispatch(1, 1, 1);
+        commandList->ResourceBarrier(1, &uavBarrier);
+        commandList->SetPipelineState(m_wavefrontStages[Stage_Scatter].Get());
+        commandList->Dispatch(queueGroups, 1, 1);
+        commandList->ResourceBarrier(1, &uavBarrier);
+
+        // Shade
+        commandList->SetPipelineState(m_wavefrontStages[Stage_Shade].Get());
+        commandList->Dispatch(queueGroups, 1, 1);
+        commandList->ResourceBarrier(1, &uavBarrier);
+
+        // Shadow connect
+        commandList->SetPipelineState1(m_wavefrontPipelineState.Get());
+        commandList->DispatchRays(&shadowDesc);
+        commandList->ResourceBarrier(1, &uavBarrier);
+    }
+
+    // Add the sample to the accumulation and resolve to the output
+    commandList->SetPipelineState(m_wavefrontStages[Stage_Resolve].Get());
+    commandList->Dispatch(groupsX, groupsY, 1);
 }
 
 void Raytracing::CopyToRenderTarget(ID3D12GraphicsCommandList4* commandList, ID3D12Resource* renderTarget)
@@ -539,5 +1476,11 @@ void Raytracing::Resize(uint32_t width, uint32_t height)
     
     // Recreate output resource
     CreateRaytracingOutputResource();
+
+    // The queues are sized for the pixels
+    if (m_rayQueue)
+    {
+        CreateWavefrontResources();
+    }
 }
 
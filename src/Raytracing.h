@@ -3,14 +3,39 @@
 #include <d3d12.h>
 #include <dxcapi.h>
 #include <wrl/client.h>
+#include <future>
 #include <string>
 #include <memory>
 #include <vector>
+#include "Camera.h"
+#include "Sampler.h"
+#include "ShaderPermutationCache.h"
+#include "ShaderTableBuilder.h"
+#include <unordered_map>
 
 using Microsoft::WRL::ComPtr;
 
 class Scene;
 
+// How a frame is ray traced
+enum class RenderMode : uint32_t
+{
+    Megakernel,     // one DispatchRays, RayGenShader traces and shades every pixel through ClosestHitShader
+    Wavefront,      // generate, then per bounce extend, sort by material, shade and shadow connect stages with queues between them
+    InlineRayQuery, // one compute dispatch tracing the paths with RayQuery, needs DXR 1.1
+    Count
+};
+
+const char* GetRenderModeName(RenderMode mode);
+
+// GPU time of the ray tracing work of a render mode, measured with timestamps around Raytracing::Render()
+struct RenderModeTiming
+{
+    float lastMilliseconds;
+    float averageMilliseconds;      // exponential moving average
+    uint64_t frameCount;            // 0 until the mode was rendered once
+};
+
 class Raytracing
 {
 public:
@@ -18,14 +43,69 @@ public:
     ~Raytracing();
     
     // Initialize raytracing pipeline
-    void Initialize(ID3D12Device5* device, uint32_t width, uint32_t height, uint32_t swapChainBufferCount);
+    void Initialize(ID3D12Device5* device, ID3D12CommandQueue* commandQueue, uint32_t width, uint32_t height, uint32_t swapChainBufferCount);
     
     // Update descriptor heap with scene resources
     void UpdateDescriptorHeap(Scene* scene, uint32_t frameIndex);
     
+    // Fence value signaled after the commands of this frame and the last completed one. Pipelines replaced by a shader
+    // reload or a permutation switch are released once the fence of the last frame using them has completed.
+    void BeginFrame(uint64_t frameFenceValue, uint64_t completedFenceValue);
+    
     // Render the scene using raytracing
     void Render(ID3D12GraphicsCommandList4* commandList, uint32_t frameIndex);
     
+    // Camera of the following frames, DEFAULT_CAMERA until set. A different camera restarts the accumulation.
+    void SetCamera(const Camera& camera);
+    
+    // Path tracing: samples accumulated into the current image, restarted when the camera, the TLAS, the output size,
+    // the render mode or the bounce limit change. Every render mode runs the estimator of PathTracing.h, the wavefront
+    // and inline modes with the bounce limit of the root constants and NEE whatever the permutation.
+    uint32_t GetSampleCount() const { return m_sampleIndex; }
+    void ResetAccumulation() { m_sampleIndex = 0; }
+    void SetMaxBounces(uint32_t maxBounces);
+    uint32_t GetMaxBounces() const { return m_maxBounces; }
+    
+    // Random numbers of the path tracing. The tables of the Sobol and Lattice samplers are read from
+    // SAMPLER_TABLES_PATH or generated in Initialize(). A different sampler restarts the accumulation.
+    void SetSamplerType(SamplerType type);
+    SamplerType GetSamplerType() const { return m_samplerType; }
+    
+    // Permutation of the megakernel, compiled in the background the first time it is set. The megakernel keeps the
+    // permutation it has until the new one is compiled and restarts the accumulation when it switches. A key with a
+    // specialized bounce limit follows SetMaxBounces().
+    void SetShaderPermutation(const ShaderPermutationKey& key);
+    const ShaderPermutationKey& GetShaderPermutation() const { return m_requestedPermutation; }
+    const ShaderPermutationKey& GetActiveShaderPermutation() const { return m_activePermutation; }
+    bool IsShaderPermutationFailed() const { return m_permutationCache.IsFailed(m_requestedPermutation); }
+    uint32_t GetPendingShaderPermutationCount() const { return m_permutationCache.GetPendingCount(); }
+    
+    // Compile the pipelines whose sources include one of the changed files (paths relative to shaders/) again, every
+    // pipeline without a list. The requested megakernel permutation, the wavefront pipeline and the inline pipeline
+    // are compiled in the background and replace the ones in use when they succeed; on failure those keep rendering
+    // and the compiler output is returned by GetShaderErrors() and GetPipelineErrors(). A changed file no pipeline
+    // includes is returned by GetUnappliedShaderChanges() until the next reload.
+    void ReloadShaders(const std::vector<std::string>& changedShaders = {});
+    bool IsShaderReloadPending() const { return m_isReloadPending; }
+    std::string GetShaderErrors() const { return m_permutationCache.GetErrors(m_requestedPermutation); }
+    bool IsPipelineReloadPending() const { return m_pipelineReload.valid() || m_queuedPipelineReloads != 0; }
+    bool IsPipelineReloadFailed() const { return m_failedPipelines != 0; }
+    const std::string& GetPipelineErrors() const { return m_pipelineErrors; }
+    const std::vector<std::string>& GetUnappliedShaderChanges() const { return m_unappliedShaderChanges; }
+    
+    // Render mode of the following frames, the wavefront queues are created on the first switch to the wavefront mode.
+    // An unsupported mode is ignored once the device is known.
+    void SetRenderMode(RenderMode mode);
+    RenderMode GetRenderMode() const { return m_renderMode; }
+    bool IsRenderModeSupported(RenderMode mode) const;
+    
+    // GPU times of every render mode, kept when the mode changes so that the modes can be compared
+    const RenderModeTiming& GetRenderModeTiming(RenderMode mode) const { return m_renderModeTimings[static_cast<uint32_t>(mode)]; }
+    
+    // Stack size per thread of the state object of a render mode, set from the call graph of its shaders. 0 for the
+    // inline RayQuery mode, which has no state object.
+    uint64_t GetPipelineStackSize(RenderMode mode) const;
+    
     // Copy raytracing output to render target
     void CopyToRenderTarget(ID3D12GraphicsCommandList4* commandList, ID3D12Resource* renderTarget);
     
@@ -40,16 +120,61 @@ private:
     void CreateRaytracingPipeline();
     void CreateDescriptorHeap();
     void CreateRaytracingOutputResource();
-    void CreateShaderTable();
-    ComPtr<IDxcBlob> CompileShader(const std::wstring& filename, const std::wstring& entryPoint, const std::wstring& target);
+    void CreateSamplerTables();
+    void UploadSamplerTables(ID3D12GraphicsCommandList4* commandList);
+    ComPtr<ID3D12StateObject> CreateRaytracingStateObject(const ShaderPermutationKey& key, std::string& errors);
+    ShaderTableBuilder& GetShaderTable(const ShaderPermutationKey& key, ID3D12StateObject* stateObject);
+    void UpdateShaderPermutation();
+    void RetirePipeline(ComPtr<ID3D12StateObject> stateObject, std::unique_ptr<ShaderTableBuilder> shaderTable,
+        std::vector<ComPtr<ID3D12PipelineState>> pipelineStates = {});
+    struct ShaderPipelines;
+    ShaderPipelines CreateShaderPipelines(uint32_t pipelines) const;
+    void ApplyShaderPipelines(ShaderPipelines& pipelines);
+    void UpdateShaderPipelines();
+    bool CreateWavefrontPipeline(ShaderPipelines& pipelines) const;
+    void CreateWavefrontResources();
+    void RenderWavefront(ID3D12GraphicsCommandList4* commandList);
+    bool CreateInlineRaytracingPipeline(ShaderPipelines& pipelines) const;
+    void CreateTimestampQueries(ID3D12CommandQueue* commandQueue);
+    void UpdateRenderModeTiming(uint32_t frameIndex);
+    static ComPtr<IDxcBlob> TryCompileShader(const std::wstring& filename, const std::wstring& entryPoint, const std::wstring& target, const std::vector<std::string>& defines, std::string& messages);
     
 private:
     enum DescHeapEntries : uint32_t {
         SRV_TLAS = 0,
+        SRV_Geometry,
+        SRV_SamplerTables,      // t2, SerializeSamplerTables() of Sampler.h
         UAV_Output,
+        UAV_Accumulation,       // u1, the radiance sum of the path tracing megakernel
+        UAV_RayQueue,           // the wavefront queues, u2 to u7 in shaders/WavefrontQueues.hlsli
+        UAV_HitQueue,
+        UAV_SortedHitIndices,
+        UAV_ShadowQueue,
+        UAV_PathRadiance,
+        UAV_Counters,
         Count
     };
 
+    // Ray types of both DXR pipelines, RAY_TYPE_* in shaders/Common.hlsli. Every ray type has a miss record and a hit
+    // group record per geometry, the shadow rays have a null hit group record as they never run a hit shader.
+    enum RayTypes : uint32_t {
+        RayType_Radiance = 0,
+        RayType_Shadow,
+        RayTypeCount
+    };
+
+    // Compute stages of the wavefront mode in shaders/Wavefront.hlsl
+    enum WavefrontStages : uint32_t {
+        Stage_Reset = 0,
+        Stage_Generate,
+        Stage_NextBounce,
+        Stage_BinOffsets,
+        Stage_Scatter,
+        Stage_Shade,
+        Stage_Resolve,
+        StageCount
+    };
+
     // Device reference (not owned)
     ID3D12Device5* m_device;
     
@@ -57,15 +182,120 @@ private:
     uint32_t m_width;
     uint32_t m_height;
     
-    // DXR pipeline objects
+    // DXR pipeline objects, m_rtPipelineState is the state object of the active permutation owned by the cache
     ComPtr<ID3D12StateObject> m_rtPipelineState;
     ComPtr<ID3D12RootSignature> m_rtGlobalRootSignature;
+    ShaderPermutationCache m_permutationCache;
+    ShaderPermutationKey m_requestedPermutation;
+    ShaderPermutationKey m_activePermutation;
+    bool m_isReloadPending;             // the active permutation is compiled from the sources before the last reload
+
+    // State objects, pipeline states and shader tables released once the GPU has passed the fence value of the last
+    // frame using them
+    struct RetiredPipeline
+    {
+        uint64_t fenceValue;
+        ComPtr<ID3D12StateObject> stateObject;
+        std::unique_ptr<ShaderTableBuilder> shaderTable;
+        std::vector<ComPtr<ID3D12PipelineState>> pipelineStates;
+    };
+    std::vector<RetiredPipeline> m_retiredPipelines;
+    uint64_t m_frameFenceValue;
     
     // Resources
     ComPtr<ID3D12Resource> m_raytracingOutput;
+    ComPtr<ID3D12Resource> m_accumulation;          // RGBA32F
     std::vector<ComPtr<ID3D12DescriptorHeap>> m_descHeaps;
     uint32_t m_CBVSRVUAVdescHeapSize;
-    ComPtr<ID3D12Resource> m_shaderTable;
-    uint32_t m_shaderTableEntrySize;
+    uint32_t m_descHeapRegistryId;
+
+    // Root constants of the GeometryConstants cbuffer
+    struct GeometryConstants
+    {
+        uint32_t meshInfoOffset;
+        CameraConstants camera;
+        uint32_t sampleIndex;
+        uint32_t maxBounces;
+        SamplerType samplerType;
+        uint32_t wavefrontBounce;       // set before the stages of every bounce
+    };
+    static const uint32_t GEOMETRY_CONSTANT_COUNT = sizeof(GeometryConstants) / sizeof(uint32_t);
+
+    // Byte offset of the MeshInfo array in the geometry buffer, passed as a root constant with the camera
+    uint32_t m_meshInfoOffset;
+    Camera m_camera;
+
+    // Progressive path tracing state, the TLAS address of the accumulated samples
+    uint32_t m_sampleIndex;
+    uint32_t m_maxBounces;
+    D3D12_GPU_VIRTUAL_ADDRESS m_accumulatedTLAS;
+
+    // Sample tables, copied from the upload buffer by the first Render() and the upload buffer released once the
+    // fence of that frame has completed
+    SamplerType m_samplerType;
+    ComPtr<ID3D12Resource> m_samplerTables;
+    ComPtr<ID3D12Resource> m_samplerTablesUpload;
+    uint64_t m_samplerTablesUploadFenceValue;       // 0 until the copy is recorded
+
+    // Shader tables of the compiled permutations by packed key, the identifiers differ between state objects:
+    // [RayGenShader], [MissShader, ShadowMissShader], [HitGroup, null shadow hit group]. After a reload the table of the
+    // active permutation is kept in m_staleShaderTable until the permutation is replaced.
+    std::unordered_map<uint32_t, std::unique_ptr<ShaderTableBuilder>> m_shaderTables;
+    std::unique_ptr<ShaderTableBuilder> m_staleShaderTable;
+    ShaderTableBuilder* m_shaderTable;
     uint32_t m_swapChainBufferCount;
+
+    // Wavefront mode: compute stages, the extend and shadow connect state object and its shader table
+    // [WavefrontExtendRayGen, WavefrontShadowRayGen], [WavefrontMiss, WavefrontShadowMiss], [WavefrontHitGroup, null
+    // shadow hit group], and the queues sized for one entry per pixel, two for the ray queue
+    RenderMode m_renderMode;
+    ComPtr<ID3D12PipelineState> m_wavefrontStages[StageCount];
+    ComPtr<ID3D12StateObject> m_wavefrontPipelineState;
+    std::unique_ptr<ShaderTableBuilder> m_wavefrontShaderTable;
+    ComPtr<ID3D12Resource> m_rayQueue;
+    ComPtr<ID3D12Resource> m_hitQueue;
+    ComPtr<ID3D12Resource> m_sortedHitIndices;
+    ComPtr<ID3D12Resource> m_shadowQueue;
+    ComPtr<ID3D12Resource> m_pathRadiance;
+    ComPtr<ID3D12Resource> m_wavefrontCounters;
+
+    // Inline ray tracing mode, null without DXR 1.1
+    bool m_isInlineRaytracingSupported;
+    ComPtr<ID3D12PipelineState> m_inlineRaytracingState;
+
+    // Pipelines compiled from the shader sources, by their root files
+    enum ShaderPipelineFlags : uint32_t {
+        Pipeline_Megakernel = 1 << 0,       // shaders/Raytracing.hlsl
+        Pipeline_Wavefront = 1 << 1,        // shaders/Wavefront.hlsl and shaders/WavefrontTrace.hlsl
+        Pipeline_Inline = 1 << 2,           // shaders/RaytracingInline.hlsl
+        Pipeline_All = Pipeline_Megakernel | Pipeline_Wavefront | Pipeline_Inline
+    };
+
+    // Wavefront and inline pipelines of CreateShaderPipelines(), null when not requested or when they failed
+    struct ShaderPipelines
+    {
+        ComPtr<ID3D12PipelineState> wavefrontStages[StageCount];
+        ComPtr<ID3D12StateObject> wavefrontPipelineState;
+        std::unique_ptr<ShaderTableBuilder> wavefrontShaderTable;
+        ComPtr<ID3D12PipelineState> inlineRaytracingState;
+        uint32_t pipelines = 0;         // ShaderPipelineFlags compiled
+        uint32_t failedPipelines = 0;
+        std::string errors;             // compiler output, warnings included
+    };
+
+    // Reload of the wavefront and inline pipelines on a background thread. The render thread swaps them in between two
+    // frames and retires the replaced ones, the pipelines queued while one compiles are compiled from newer sources next.
+    std::future<ShaderPipelines> m_pipelineReload;
+    uint32_t m_queuedPipelineReloads;
+    uint32_t m_failedPipelines;         // failed the last time they were compiled and render with older sources
+    std::string m_pipelineErrors;       // output of the last reload
+    std::vector<std::string> m_unappliedShaderChanges;
+
+    // Two timestamps per frame in flight around the ray tracing work, resolved to a readback buffer and read when the
+    // frame index is used again
+    ComPtr<ID3D12QueryHeap> m_timestampQueryHeap;
+    ComPtr<ID3D12Resource> m_timestampReadback;
+    uint64_t m_timestampFrequency;
+    std::vector<RenderMode> m_timestampRenderModes;     // per frame index, Count when no timestamps are pending
+    RenderModeTiming m_renderModeTimings[static_cast<uint32_t>(RenderMode::Count)];
 };
@@ -0,0 +1,127 @@
+#include "ReadbackQueue.h"
+#include <algorithm>
+#include <cassert>
+
+ReadbackQueue::ReadbackQueue() :
+    m_nextTicket(INVALID_TICKET + 1),
+    m_lastRetiredTicket(INVALID_TICKET)
+{
+}
+
+ReadbackQueue::Ticket ReadbackQueue::Request(uint64_t offset, uint64_t size, Callback callback)
+{
+    assert(size > 0);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const Ticket ticket = m_nextTicket++;
+    m_pending.push_back({ ticket, offset, size, std::move(callback) });
+    return ticket;
+}
+
+std::vector<ReadbackRegion> ReadbackQueue::TakePendingRegions()
+{
+    std::vector<ReadbackRegion> regions;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_pending.empty())
+    {
+        return regions;
+    }
+
+    regions.reserve(m_pending.size());
+    for (const RequestEntry& request : m_pending)
+    {
+        regions.push_back({ request.offset, request.size });
+    }
+
+    // Merge overlapping and exactly adjacent regions, a gap is never copied
+    std::sort(regions.begin(), regions.end(), [](const ReadbackRegion& a, const ReadbackRegion& b) { return a.offset < b.offset; });
+    size_t numMerged = 0;
+    for (size_t i = 1; i < regions.size(); ++i)
+    {
+        ReadbackRegion& last = regions[numMerged];
+        const uint64_t lastEnd = last.offset + last.size;
+        if (regions[i].offset <= lastEnd)
+        {
+            last.size = std::max(lastEnd, regions[i].offset + regions[i].size) - last.offset;
+        }
+        else
+        {
+            regions[++numMerged] = regions[i];
+        }
+    }
+    regions.resize(numMerged + 1);
+
+    m_recorded.insert(m_recorded.end(), std::make_move_iterator(m_pending.begin()), std::make_move_iterator(m_pending.end()));
+    m_pending.clear();
+
+    return regions;
+}
+
+void ReadbackQueue::Submit(uint64_t fenceValue)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_recorded.empty())
+    {
+        return;
+    }
+
+    // Fence values must increase, otherwise the batches would retire out of order
+    assert(m_inFlight.empty() || m_inFlight.back().fenceValue <= fenceValue);
+
+    m_inFlight.push_back({ fenceValue, std::move(m_recorded) });
+    m_recorded.clear();
+}
+
+uint32_t ReadbackQueue::Retire(uint64_t completedFenceValue, const void* mappedBase)
+{
+    std::vector<RequestEntry> retired;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        while (!m_inFlight.empty() && m_inFlight.front().fenceValue <= completedFenceValue)
+        {
+            Batch& batch = m_inFlight.front();
+            for (RequestEntry& request : batch.requests)
+            {
+                m_lastRetiredTicket = std::max(m_lastRetiredTicket, request.ticket);
+                retired.push_back(std::move(request));
+            }
+            m_inFlight.pop_front();
+        }
+    }
+
+    // Callbacks may request new readbacks, so they are invoked without holding the lock
+    const uint8_t* base = static_cast<const uint8_t*>(mappedBase);
+    for (const RequestEntry& request : retired)
+    {
+        if (request.callback)
+        {
+            request.callback(base ? base + request.offset : nullptr, request.size);
+        }
+    }
+
+    return static_cast<uint32_t>(retired.size());
+}
+
+bool ReadbackQueue::IsReady(Ticket ticket) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    return ticket != INVALID_TICKET && ticket <= m_lastRetiredTicket;
+}
+
+uint32_t ReadbackQueue::GetNumUnresolvedRequests() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    size_t numRequests = m_pending.size() + m_recorded.size();
+    for (const Batch& batch : m_inFlight)
+    {
+        numRequests += batch.requests.size();
+    }
+    return static_cast<uint32_t>(numRequests);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Byte range of a buffer copied from the GPU writable resource to the readback resource
+struct ReadbackRegion
+{
+    uint64_t offset;
+    uint64_t size;
+};
+
+// Bookkeeping of asynchronous readbacks, independent of Direct3D12.
+//
+// Requests are recorded by byte range and return a ticket. TakePendingRegions() merges the
+// overlapping and adjacent pending requests into the copy regions of one command list, a region
+// never covers a byte that was not requested: the other bytes of the readback resource may be
+// written by ResolveQueryData() or still be read by the CPU. Submit() tags the requests with the
+// fence value signaled after that command list, and Retire() resolves every ticket whose fence value
+// has completed and invokes its callback with the mapped data. Tickets retire in issue order, which is checked on
+// the CPU by tools/ReadbackQueueTool together with the merging of the regions.
+class ReadbackQueue
+{
+public:
+    using Ticket = uint64_t;
+    using Callback = std::function<void(const void* data, uint64_t size)>;
+
+    static constexpr Ticket INVALID_TICKET = 0;
+
+    ReadbackQueue();
+
+    // Request a readback of [offset, offset + size). The callback is invoked from Retire().
+    Ticket Request(uint64_t offset, uint64_t size, Callback callback = {});
+
+    // Move the pending requests to the recorded batch and return their merged copy regions sorted by offset
+    std::vector<ReadbackRegion> TakePendingRegions();
+
+    // Tag the recorded requests with the fence value signaled after their copies
+    void Submit(uint64_t fenceValue);
+
+    // Resolve the requests whose fence value is less than or equal to completedFenceValue.
+    // mappedBase is the CPU pointer of offset 0. Returns the number of resolved tickets.
+    uint32_t Retire(uint64_t completedFenceValue, const void* mappedBase);
+
+    // Whether the data of the ticket can be read
+    bool IsReady(Ticket ticket) const;
+
+    // Number of requests which are not resolved yet
+    uint32_t GetNumUnresolvedRequests() const;
+
+private:
+    struct RequestEntry
+    {
+        Ticket ticket;
+        uint64_t offset;
+        uint64_t size;
+        Callback callback;
+    };
+
+    struct Batch
+    {
+        uint64_t fenceValue;
+        std::vector<RequestEntry> requests;
+    };
+
+    // Requests not yet recorded in a command list
+    std::vector<RequestEntry> m_pending;
+
+    // Requests recorded in a command list which is not submitted yet
+    std::vector<RequestEntry> m_recorded;
+
+    // Submitted batches in fence order
+    std::deque<Batch> m_inFlight;
+
+    Ticket m_nextTicket;
+    Ticket m_lastRetiredTicket;
+
+    mutable std::mutex m_mutex;
+};
@@ -0,0 +1,520 @@
+#include "Sampler.h"
+#include "Hash.h"
+#include "PlatformHelpers.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <iterator>
+#include <limits>
+#include <system_error>
+
+namespace
+{
+    const uint32_t SAMPLER_TABLES_MAGIC = 0x54504D53;   // "SMPT"
+
+    struct SamplerTablesHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t settingsHash;
+        uint64_t dataSize;
+        uint64_t dataHash;
+    };
+    static_assert(sizeof(SamplerTablesHeader) == 32, "SamplerTablesHeader layout");
+
+    const char* SAMPLER_TYPE_NAMES[] = { "Random", "Sobol", "Lattice" };
+    static_assert(std::size(SAMPLER_TYPE_NAMES) == static_cast<size_t>(SamplerType::Count), "Missing sampler type name");
+
+    // Primitive polynomials and initial direction numbers of the dimensions after the van der Corput sequence
+    // (Joe and Kuo 2008, new-joe-kuo-6.21201)
+    struct SobolPolynomial
+    {
+        uint32_t degree;
+        uint32_t coefficients;      // a, the inner coefficients with the highest degree first
+        uint32_t initialDirections[SAMPLER_DIMENSION_COUNT - 1];
+    };
+    const SobolPolynomial SOBOL_POLYNOMIALS[SAMPLER_DIMENSION_COUNT - 1] = {
+        { 1, 0, { 1, 0 } },
+        { 2, 1, { 1, 3 } }
+    };
+
+    // Korobov generators a < 2 * LATTICE_CANDIDATE_COUNT, odd so that every prefix is a lattice of distinct points
+    const uint32_t LATTICE_CANDIDATE_COUNT = 4096;
+    const uint32_t LATTICE_CANDIDATES_PER_TASK = 64;
+
+    // Void-and-cluster: Gaussian energy of Wolfe et al. 2022, a tenth of every slice in the initial pattern
+    const float BLUE_NOISE_SPATIAL_SIGMA = 1.9f;
+    const float BLUE_NOISE_TEMPORAL_SIGMA = 1.9f;
+    const uint32_t BLUE_NOISE_INITIAL_COUNT = BLUE_NOISE_SLICE_TEXEL_COUNT / 10;
+    const uint32_t BLUE_NOISE_MAX_RELAX_PASSES = BLUE_NOISE_INITIAL_COUNT * 4;
+    const uint32_t BLUE_NOISE_SEED = 1;
+
+    // R2 sequence (Roberts 2018) in 32-bit fixed point, the top bits are the texel offset of a dimension
+    const uint32_t R2_ALPHA_X = 0xC13FA9A9u;
+    const uint32_t R2_ALPHA_Y = 0x91E10DA5u;
+    const uint32_t BLUE_NOISE_OFFSET_SHIFT = 26;
+    static_assert(BLUE_NOISE_SIZE == 1u << (32 - BLUE_NOISE_OFFSET_SHIFT), "BLUE_NOISE_OFFSET_SHIFT of another size");
+
+    uint32_t PcgHash(uint32_t value)
+    {
+        const uint32_t state = value * 747796405u + 2891336453u;
+        const uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+        return (word >> 22u) ^ word;
+    }
+
+    void GenerateSobolMatrices(uint32_t matrices[SAMPLER_DIMENSION_COUNT][SOBOL_BIT_COUNT])
+    {
+        for (uint32_t bit = 0; bit < SOBOL_BIT_COUNT; ++bit)
+        {
+            matrices[0][bit] = 1u << (31 - bit);
+        }
+        for (uint32_t dimension = 1; dimension < SAMPLER_DIMENSION_COUNT; ++dimension)
+        {
+            const SobolPolynomial& polynomial = SOBOL_POLYNOMIALS[dimension - 1];
+            uint32_t* directions = matrices[dimension];
+            for (uint32_t bit = 0; bit < SOBOL_BIT_COUNT; ++bit)
+            {
+                if (bit < polynomial.degree)
+                {
+                    directions[bit] = polynomial.initialDirections[bit] << (31 - bit);
+                    continue;
+                }
+                uint32_t direction = directions[bit - polynomial.degree] ^ (directions[bit - polynomial.degree] >> polynomial.degree);
+                for (uint32_t k = 1; k < polynomial.degree; ++k)
+                {
+                    if ((polynomial.coefficients >> (polynomial.degree - 1 - k)) & 1)
+                    {
+                        direction ^= directions[bit - k];
+                    }
+                }
+                directions[bit] = direction;
+            }
+        }
+    }
+
+    // Minimum distance on the torus between the points of the rank-1 lattice of pointCount points, relative to the
+    // densest lattice packing of the dimension (hexagonal, face centered cubic)
+    double GetLatticeQuality(const uint32_t* generator, uint32_t dimensionCount, uint32_t pointCount)
+    {
+        uint64_t minDistance2 = std::numeric_limits<uint64_t>::max();
+        for (uint32_t point = 1; point < pointCount; ++point)
+        {
+            uint64_t distance2 = 0;
+            for (uint32_t dimension = 0; dimension < dimensionCount; ++dimension)
+            {
+                const uint32_t coordinate = (point * generator[dimension]) & (pointCount - 1);
+                const uint64_t toroidal = std::min(coordinate, pointCount - coordinate);
+                distance2 += toroidal * toroidal;
+            }
+            minDistance2 = std::min(minDistance2, distance2);
+        }
+        const double n = static_cast<double>(pointCount);
+        const double densest = dimensionCount == 2 ? std::sqrt(2.0 / (std::sqrt(3.0) * n)) : std::cbrt(std::sqrt(2.0) / n);
+        return std::sqrt(static_cast<double>(minDistance2)) / n / densest;
+    }
+
+    // Worst projection of the generator (1, a, a^2) over the prefixes. (a, a^2) is the lattice of (1, a).
+    double GetKorobovQuality(uint32_t a)
+    {
+        const uint32_t generator[3] = { 1, a, a * a };
+        const uint32_t squareGenerator[2] = { 1, a * a };
+        double quality = std::numeric_limits<double>::max();
+        for (uint32_t pointCount = LATTICE_MIN_POINTS; pointCount <= LATTICE_MAX_POINTS; pointCount *= 2)
+        {
+            quality = std::min({ quality, GetLatticeQuality(generator, 2, pointCount),
+                GetLatticeQuality(squareGenerator, 2, pointCount), GetLatticeQuality(generator, 3, pointCount) });
+        }
+        return quality;
+    }
+
+    // Void-and-cluster on the spatiotemporal energy. The energy of a texel is the sum of the Gaussians of the set
+    // texels of its slice (itself included) and of the set texels at the same position in the other slices.
+    class BlueNoiseGenerator
+    {
+    public:
+        BlueNoiseGenerator() :
+            m_energy(BLUE_NOISE_TEXEL_COUNT, 0.0f),
+            m_isSet(BLUE_NOISE_TEXEL_COUNT, 0)
+        {
+            for (uint32_t y = 0; y < BLUE_NOISE_SIZE; ++y)
+            {
+                for (uint32_t x = 0; x < BLUE_NOISE_SIZE * 2; ++x)
+                {
+                    const uint32_t wrappedX = x % BLUE_NOISE_SIZE;
+                    const float dx = static_cast<float>(std::min(wrappedX, BLUE_NOISE_SIZE - wrappedX));
+                    const float dy = static_cast<float>(std::min(y, BLUE_NOISE_SIZE - y));
+                    m_spatialKernel[y * BLUE_NOISE_SIZE * 2 + x] = std::exp(-(dx * dx + dy * dy) / (2.0f * BLUE_NOISE_SPATIAL_SIGMA * BLUE_NOISE_SPATIAL_SIGMA));
+                }
+            }
+            for (uint32_t slice = 0; slice < BLUE_NOISE_DEPTH; ++slice)
+            {
+                const float dt = static_cast<float>(std::min(slice, BLUE_NOISE_DEPTH - slice));
+                m_temporalKernel[slice] = slice == 0 ? 0.0f : std::exp(-dt * dt / (2.0f * BLUE_NOISE_TEMPORAL_SIGMA * BLUE_NOISE_TEMPORAL_SIGMA));
+            }
+        }
+
+        void Generate(std::vector<uint16_t>& ranks)
+        {
+            ranks.assign(BLUE_NOISE_TEXEL_COUNT, 0);
+
+            // Random initial pattern, the same count in every slice
+            uint32_t randomIndex = 0;
+            for (uint32_t slice = 0; slice < BLUE_NOISE_DEPTH; ++slice)
+            {
+                for (uint32_t count = 0; count < BLUE_NOISE_INITIAL_COUNT;)
+                {
+                    const uint32_t texel = HashSamplerSeed(BLUE_NOISE_SEED, randomIndex++) % BLUE_NOISE_SLICE_TEXEL_COUNT;
+                    if (!m_isSet[slice * BLUE_NOISE_SLICE_TEXEL_COUNT + texel])
+                    {
+                        Toggle(slice, texel);
+                        ++count;
+                    }
+                }
+            }
+
+            // Move the tightest cluster to the largest void until a slice is stable
+            bool isStable[BLUE_NOISE_DEPTH] = {};
+            for (uint32_t pass = 0; pass < BLUE_NOISE_MAX_RELAX_PASSES; ++pass)
+            {
+                bool isDone = true;
+                for (uint32_t slice = 0; slice < BLUE_NOISE_DEPTH; ++slice)
+                {
+                    if (isStable[slice])
+                    {
+                        continue;
+                    }
+                    const uint32_t cluster = FindTexel(slice, true);
+                    Toggle(slice, cluster);
+                    const uint32_t largestVoid = FindTexel(slice, false);
+                    Toggle(slice, largestVoid);
+                    isStable[slice] = largestVoid == cluster;
+                    isDone = isDone && isStable[slice];
+                }
+                if (isDone)
+                {
+                    break;
+                }
+            }
+
+            // Ranks of the initial pattern by removing the tightest clusters, then of the other texels by filling the
+            // largest voids. The energy of the unset texels is a constant minus the energy of the set ones, so the
+            // tightest cluster of unset texels is the largest void and a single fill covers both halves.
+            const std::vector<float> initialEnergy = m_energy;
+            const std::vector<uint8_t> initialIsSet = m_isSet;
+            for (uint32_t rank = BLUE_NOISE_INITIAL_COUNT; rank-- > 0;)
+            {
+                for (uint32_t slice = 0; slice < BLUE_NOISE_DEPTH; ++slice)
+                {
+                    const uint32_t cluster = FindTexel(slice, true);
+                    Toggle(slice, cluster);
+                    ranks[slice * BLUE_NOISE_SLICE_TEXEL_COUNT + cluster] = static_cast<uint16_t>(rank * BLUE_NOISE_DEPTH + slice);
+                }
+            }
+            m_energy = initialEnergy;
+            m_isSet = initialIsSet;
+            for (uint32_t rank = BLUE_NOISE_INITIAL_COUNT; rank < BLUE_NOISE_SLICE_TEXEL_COUNT; ++rank)
+            {
+                for (uint32_t slice = 0; slice < BLUE_NOISE_DEPTH; ++slice)
+                {
+                    const uint32_t largestVoid = FindTexel(slice, false);
+                    Toggle(slice, largestVoid);
+                    ranks[slice * BLUE_NOISE_SLICE_TEXEL_COUNT + largestVoid] = static_cast<uint16_t>(rank * BLUE_NOISE_DEPTH + slice);
+                }
+            }
+        }
+
+    private:
+        // Set an unset texel or clear a set one and update the energy
+        void Toggle(uint32_t slice, uint32_t texel)
+        {
+            uint8_t& isSet = m_isSet[slice * BLUE_NOISE_SLICE_TEXEL_COUNT + texel];
+            isSet = !isSet;
+            const float sign = isSet ? 1.0f : -1.0f;
+
+            const uint32_t texelX = texel % BLUE_NOISE_SIZE;
+            const uint32_t texelY = texel / BLUE_NOISE_SIZE;
+            float* energy = &m_energy[slice * BLUE_NOISE_SLICE_TEXEL_COUNT];
+            for (uint32_t y = 0; y < BLUE_NOISE_SIZE; ++y)
+            {
+                const float* kernelRow = &m_spatialKernel[((y + BLUE_NOISE_SIZE - texelY) % BLUE_NOISE_SIZE) * BLUE_NOISE_SIZE * 2 + BLUE_NOISE_SIZE - texelX];
+                float* energyRow = &energy[y * BLUE_NOISE_SIZE];
+                for (uint32_t x = 0; x < BLUE_NOISE_SIZE; ++x)
+                {
+                    energyRow[x] += sign * kernelRow[x];
+                }
+            }
+            for (uint32_t other = 1; other < BLUE_NOISE_DEPTH; ++other)
+            {
+                const uint32_t otherSlice = (slice + other) % BLUE_NOISE_DEPTH;
+                m_energy[otherSlice * BLUE_NOISE_SLICE_TEXEL_COUNT + texel] += sign * m_temporalKernel[other];
+            }
+        }
+
+        // Set texel of the highest energy (tightest cluster) or unset texel of the lowest energy (largest void), the
+        // first one on a tie
+        uint32_t FindTexel(uint32_t slice, bool isSet) const
+        {
+            const float* energy = &m_energy[slice * BLUE_NOISE_SLICE_TEXEL_COUNT];
+            const uint8_t* texelIsSet = &m_isSet[slice * BLUE_NOISE_SLICE_TEXEL_COUNT];
+            const float sign = isSet ? 1.0f : -1.0f;
+            const uint8_t match = isSet ? 1 : 0;
+            uint32_t best = 0;
+            float bestEnergy = -std::numeric_limits<float>::max();
+            for (uint32_t texel = 0; texel < BLUE_NOISE_SLICE_TEXEL_COUNT; ++texel)
+            {
+                const float value = texelIsSet[texel] == match ? sign * energy[texel] : -std::numeric_limits<float>::max();
+                if (value > bestEnergy)
+                {
+                    best = texel;
+                    bestEnergy = value;
+                }
+            }
+            return best;
+        }
+
+        std::vector<float> m_energy;
+        std::vector<uint8_t> m_isSet;
+        float m_spatialKernel[BLUE_NOISE_SLICE_TEXEL_COUNT * 2];   // rows repeated twice, read without wrapping
+        float m_temporalKernel[BLUE_NOISE_DEPTH];       // by the slice distance, 0 for the same slice
+    };
+
+    bool Fail(std::string* error, std::string message)
+    {
+        if (error)
+        {
+            *error = std::move(message);
+        }
+        return false;
+    }
+}
+
+const char* GetSamplerTypeName(SamplerType type)
+{
+    return type < SamplerType::Count ? SAMPLER_TYPE_NAMES[static_cast<uint32_t>(type)] : "Unknown";
+}
+
+void GenerateSamplerTables(ThreadPool& threadPool, SamplerTables& tables)
+{
+    GenerateSobolMatrices(tables.sobolMatrices);
+
+    // The blue noise is the longest task and is claimed first, the other threads search the lattice generators in
+    // chunks meanwhile. The best generator of a chunk is the first one of the highest quality, as is the best chunk.
+    const uint32_t numLatticeTasks = LATTICE_CANDIDATE_COUNT / LATTICE_CANDIDATES_PER_TASK;
+    std::vector<double> taskQualities(numLatticeTasks, 0.0);
+    std::vector<uint32_t> taskGenerators(numLatticeTasks, 1);
+    threadPool.ParallelFor(numLatticeTasks + 1, [&](uint32_t task)
+    {
+        if (task == 0)
+        {
+            BlueNoiseGenerator generator;
+            generator.Generate(tables.blueNoise);
+            return;
+        }
+        const uint32_t latticeTask = task - 1;
+        for (uint32_t candidate = latticeTask * LATTICE_CANDIDATES_PER_TASK; candidate < (latticeTask + 1) * LATTICE_CANDIDATES_PER_TASK; ++candidate)
+        {
+            const uint32_t a = candidate * 2 + 1;
+            const double quality = GetKorobovQuality(a);
+            if (quality > taskQualities[latticeTask])
+            {
+                taskQualities[latticeTask] = quality;
+                taskGenerators[latticeTask] = a;
+            }
+        }
+    });
+    const size_t bestTask = std::max_element(taskQualities.begin(), taskQualities.end()) - taskQualities.begin();
+    const uint32_t a = taskGenerators[bestTask];
+    tables.latticeGenerator[0] = 1;
+    tables.latticeGenerator[1] = a;
+    tables.latticeGenerator[2] = a * a;
+}
+
+uint64_t GetSamplerTablesSettingsHash()
+{
+    uint64_t hash = Hash64(&SAMPLER_TABLES_VERSION, sizeof(SAMPLER_TABLES_VERSION));
+    hash = Hash64(SOBOL_POLYNOMIALS, sizeof(SOBOL_POLYNOMIALS), hash);
+    const uint32_t values[] = { SAMPLER_DIMENSION_COUNT, SOBOL_BIT_COUNT, LATTICE_MIN_POINTS, LATTICE_MAX_POINTS, LATTICE_CANDIDATE_COUNT,
+        BLUE_NOISE_SIZE, BLUE_NOISE_DEPTH, BLUE_NOISE_INITIAL_COUNT, BLUE_NOISE_MAX_RELAX_PASSES, BLUE_NOISE_SEED };
+    hash = Hash64(values, sizeof(values), hash);
+    const float sigmas[] = { BLUE_NOISE_SPATIAL_SIGMA, BLUE_NOISE_TEMPORAL_SIGMA };
+    return Hash64(sigmas, sizeof(sigmas), hash);
+}
+
+std::vector<uint8_t> SerializeSamplerTables(const SamplerTables& tables)
+{
+    std::vector<uint8_t> data(SAMPLER_TABLES_SIZE, 0);
+    memcpy(&data[SAMPLER_TABLE_SOBOL_OFFSET], tables.sobolMatrices, sizeof(tables.sobolMatrices));
+    memcpy(&data[SAMPLER_TABLE_LATTICE_OFFSET], tables.latticeGenerator, sizeof(tables.latticeGenerator));
+    if (tables.blueNoise.size() == BLUE_NOISE_TEXEL_COUNT)
+    {
+        memcpy(&data[SAMPLER_TABLE_BLUE_NOISE_OFFSET], tables.blueNoise.data(), BLUE_NOISE_TEXEL_COUNT * sizeof(uint16_t));
+    }
+    return data;
+}
+
+bool DeserializeSamplerTables(const void* data, size_t size, SamplerTables& tables)
+{
+    if (size != SAMPLER_TABLES_SIZE)
+    {
+        return false;
+    }
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    memcpy(tables.sobolMatrices, bytes + SAMPLER_TABLE_SOBOL_OFFSET, sizeof(tables.sobolMatrices));
+    memcpy(tables.latticeGenerator, bytes + SAMPLER_TABLE_LATTICE_OFFSET, sizeof(tables.latticeGenerator));
+    tables.blueNoise.resize(BLUE_NOISE_TEXEL_COUNT);
+    memcpy(tables.blueNoise.data(), bytes + SAMPLER_TABLE_BLUE_NOISE_OFFSET, BLUE_NOISE_TEXEL_COUNT * sizeof(uint16_t));
+    return true;
+}
+
+bool WriteSamplerTables(const char* path, const SamplerTables& tables, std::string* error)
+{
+    const std::vector<uint8_t> data = SerializeSamplerTables(tables);
+    SamplerTablesHeader header = {};
+    header.magic = SAMPLER_TABLES_MAGIC;
+    header.version = SAMPLER_TABLES_VERSION;
+    header.settingsHash = GetSamplerTablesSettingsHash();
+    header.dataSize = data.size();
+    header.dataHash = Hash64(data.data(), data.size());
+
+    // Write to a temporary file so that an interrupted write never leaves a file which looks valid
+    const std::string temporaryPath = std::string(path) + ".tmp";
+    FILE* file = OpenFileStream(temporaryPath.c_str(), "wb");
+    if (!file)
+    {
+        return Fail(error, std::format("failed to create {}", temporaryPath));
+    }
+    bool isWritten = fwrite(&header, sizeof(header), 1, file) == 1;
+    isWritten = isWritten && fwrite(data.data(), 1, data.size(), file) == data.size();
+    isWritten = (fclose(file) == 0) && isWritten;
+
+    std::error_code errorCode;
+    if (isWritten)
+    {
+        std::filesystem::rename(temporaryPath, path, errorCode);
+    }
+    if (!isWritten || errorCode)
+    {
+        std::filesystem::remove(temporaryPath, errorCode);
+        return Fail(error, std::format("failed to write {}", path));
+    }
+    return true;
+}
+
+bool ReadSamplerTables(const char* path, SamplerTables& tables, std::string* error)
+{
+    FILE* file = OpenFileStream(path, "rb");
+    if (!file)
+    {
+        return Fail(error, std::format("{} not found", path));
+    }
+    SamplerTablesHeader header = {};
+    std::vector<uint8_t> data;
+    bool isRead = fread(&header, sizeof(header), 1, file) == 1 && header.magic == SAMPLER_TABLES_MAGIC && header.dataSize == SAMPLER_TABLES_SIZE;
+    if (isRead)
+    {
+        data.resize(SAMPLER_TABLES_SIZE);
+        uint8_t extra = 0;
+        isRead = fread(data.data(), 1, data.size(), file) == data.size() && fread(&extra, 1, 1, file) == 0;
+    }
+    fclose(file);
+
+    if (!isRead)
+    {
+        return Fail(error, std::format("{} is malformed", path));
+    }
+    if (header.version != SAMPLER_TABLES_VERSION || header.settingsHash != GetSamplerTablesSettingsHash())
+    {
+        return Fail(error, std::format("{} has other settings", path));
+    }
+    if (Hash64(data.data(), data.size()) != header.dataHash)
+    {
+        return Fail(error, std::format("{} is corrupted", path));
+    }
+    return DeserializeSamplerTables(data.data(), data.size(), tables);
+}
+
+bool LoadOrGenerateSamplerTables(const char* path, ThreadPool& threadPool, SamplerTables& tables)
+{
+    std::string error;
+    if (ReadSamplerTables(path, tables, &error))
+    {
+        return true;
+    }
+    OutputDebugStringA(std::format("Sampler tables: {}, generating them.\n", error).c_str());
+
+    const auto startTime = std::chrono::steady_clock::now();
+    GenerateSamplerTables(threadPool, tables);
+    const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    OutputDebugStringA(std::format("Sampler tables generated in {:.1f} ms on {} threads, lattice generator a = {}.\n",
+        milliseconds, threadPool.GetNumThreads(), tables.latticeGenerator[1]).c_str());
+
+    if (!WriteSamplerTables(path, tables, &error))
+    {
+        OutputDebugStringA(std::format("Sampler tables: {}\n", error).c_str());
+    }
+    return false;
+}
+
+uint32_t ReverseBits(uint32_t value)
+{
+    value = (value << 16) | (value >> 16);
+    value = ((value & 0x00ff00ffu) << 8) | ((value & 0xff00ff00u) >> 8);
+    value = ((value & 0x0f0f0f0fu) << 4) | ((value & 0xf0f0f0f0u) >> 4);
+    value = ((value & 0x33333333u) << 2) | ((value & 0xccccccccu) >> 2);
+    value = ((value & 0x55555555u) << 1) | ((value & 0xaaaaaaaau) >> 1);
+    return value;
+}
+
+uint32_t HashSamplerSeed(uint32_t seed, uint32_t value)
+{
+    return PcgHash(seed ^ PcgHash(value));
+}
+
+uint32_t NestedUniformScramble(uint32_t value, uint32_t seed)
+{
+    // Laine-Karras style permutation of the reversed bits with the constants of Vegdahl 2021: every operation only
+    // carries into higher bits, which are the lower digits of the fraction
+    value = ReverseBits(value);
+    value ^= value * 0x3d20adeau;
+    value += seed;
+    value *= (seed >> 16) | 1u;
+    value ^= value * 0x05526c56u;
+    value ^= value * 0x53a22864u;
+    return ReverseBits(value);
+}
+
+uint32_t GetSobolSample(const SamplerTables& tables, uint32_t index, uint32_t dimension)
+{
+    uint32_t value = 0;
+    for (uint32_t bit = 0; index != 0; index >>= 1, ++bit)
+    {
+        if (index & 1)
+        {
+            value ^= tables.sobolMatrices[dimension][bit];
+        }
+    }
+    return value;
+}
+
+uint32_t GetLatticeSample(const SamplerTables& tables, uint32_t index, uint32_t dimension)
+{
+    return ReverseBits(index) * tables.latticeGenerator[dimension];
+}
+
+uint32_t GetBlueNoiseSample(const SamplerTables& tables, uint32_t x, uint32_t y, uint32_t dimension)
+{
+    const uint32_t texelX = (x + ((dimension * R2_ALPHA_X) >> BLUE_NOISE_OFFSET_SHIFT)) % BLUE_NOISE_SIZE;
+    const uint32_t texelY = (y + ((dimension * R2_ALPHA_Y) >> BLUE_NOISE_OFFSET_SHIFT)) % BLUE_NOISE_SIZE;
+    const uint32_t slice = dimension % BLUE_NOISE_DEPTH;
+    const uint32_t rank = tables.blueNoise[(slice * BLUE_NOISE_SIZE + texelY) * BLUE_NOISE_SIZE + texelX];
+    return (rank << 16) | 0x8000u;
+}
+
+float SampleToFloat(uint32_t value)
+{
+    return static_cast<float>(value >> 8) * (1.0f / 16777216.0f);
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// Low-discrepancy sample tables of the path tracing estimator, shared by the megakernel (shaders/Sampler.hlsli mirrors
+// this module) and CpuRaytracer::RenderPathTraced().
+//
+// The random numbers of a path are drawn in sample groups of up to SAMPLER_DIMENSION_COUNT dimensions (PathTracing.h).
+// A group reads the point of a sequence at the sample index shuffled with a nested uniform scramble, which maps the
+// first 2^m indices onto an aligned block of 2^m indices: every power of two prefix keeps the stratification of the
+// sequence while the groups are decorrelated (Burley 2020, "Practical Hash-based Owen Scrambling"). The sequences are
+//   - Sobol: the first dimensions of the Sobol sequence (Joe and Kuo direction numbers), Owen scrambled per dimension
+//     with a seed hashed from the pixel, so that the pixels are decorrelated,
+//   - rank-1 lattice: the radical inverse of the index times a Korobov generator (1, a, a^2) modulo 1, which is a
+//     lattice for every power of two prefix. a is searched for the largest minimum distance between the points of
+//     the prefixes of LATTICE_MIN_POINTS to LATTICE_MAX_POINTS points. The pixels share the points and are
+//     decorrelated by a Cranley-Patterson rotation with a blue-noise value per pixel and dimension, so that the
+//     error of the first samples is distributed as blue noise over the image.
+//
+// The blue noise is a volume of BLUE_NOISE_DEPTH slices of BLUE_NOISE_SIZE^2 ranks made with void-and-cluster
+// (Ulichney 1993) on a spatiotemporal energy (Wolfe et al. 2022): points of a slice repel each other, and points of
+// the same texel in nearby slices repel each other, so every slice and the values of a texel across the slices are
+// blue noise. The slices are filled in lockstep, a slice holds every BLUE_NOISE_DEPTH-th rank and its values are
+// uniform. A dimension reads the slice of its index modulo the depth, shifted by an R2 sequence offset.
+//
+// The tables are generated on a ThreadPool and cached in a file, the GPU reads them from a raw buffer of
+// SAMPLER_TABLES_SIZE bytes in the layout of SerializeSamplerTables().
+//
+// This module has no Direct3D12 dependency, it is checked on Linux by tools/SamplerTool.
+
+const uint32_t SAMPLER_TABLES_VERSION = 1;
+
+// Dimensions of the largest sample group
+const uint32_t SAMPLER_DIMENSION_COUNT = 3;
+const uint32_t SOBOL_BIT_COUNT = 32;
+
+// Point counts of the lattice prefixes the generator is searched for
+const uint32_t LATTICE_MIN_POINTS = 16;
+const uint32_t LATTICE_MAX_POINTS = 4096;
+
+// 65536 texels, the rank of a texel is a uint16
+const uint32_t BLUE_NOISE_SIZE = 64;
+const uint32_t BLUE_NOISE_DEPTH = 16;
+const uint32_t BLUE_NOISE_SLICE_TEXEL_COUNT = BLUE_NOISE_SIZE * BLUE_NOISE_SIZE;
+const uint32_t BLUE_NOISE_TEXEL_COUNT = BLUE_NOISE_SLICE_TEXEL_COUNT * BLUE_NOISE_DEPTH;
+
+// Byte offsets of the tables in the buffer of SerializeSamplerTables(), SAMPLER_TABLE_* in shaders/Sampler.hlsli
+const uint32_t SAMPLER_TABLE_SOBOL_OFFSET = 0;
+const uint32_t SAMPLER_TABLE_LATTICE_OFFSET = SAMPLER_TABLE_SOBOL_OFFSET + SAMPLER_DIMENSION_COUNT * SOBOL_BIT_COUNT * 4;
+const uint32_t SAMPLER_TABLE_BLUE_NOISE_OFFSET = SAMPLER_TABLE_LATTICE_OFFSET + 16;
+const uint32_t SAMPLER_TABLES_SIZE = SAMPLER_TABLE_BLUE_NOISE_OFFSET + BLUE_NOISE_TEXEL_COUNT * 2;
+
+// Random numbers of the path tracing estimator, SAMPLER_TYPE_* in shaders/Sampler.hlsli
+enum class SamplerType : uint32_t
+{
+    Random,     // PCG hash sequence per pixel and sample
+    Sobol,      // Owen scrambled Sobol, a scramble per pixel
+    Lattice,    // rank-1 lattice, a blue-noise rotation per pixel
+    Count
+};
+
+const char* GetSamplerTypeName(SamplerType type);
+
+struct SamplerTables
+{
+    uint32_t sobolMatrices[SAMPLER_DIMENSION_COUNT][SOBOL_BIT_COUNT];  // value of every index bit, XORed
+    uint32_t latticeGenerator[SAMPLER_DIMENSION_COUNT];                // (1, a, a^2) modulo 2^32
+    std::vector<uint16_t> blueNoise;    // rank per texel, x first, then y, then the slice
+};
+
+// Generate the tables on the threads of the pool. The result does not depend on the number of threads.
+void GenerateSamplerTables(ThreadPool& threadPool, SamplerTables& tables);
+
+// Hash of the generation settings and the version, a cache file of other settings is stale
+uint64_t GetSamplerTablesSettingsHash();
+
+// Buffer of SAMPLER_TABLES_SIZE bytes, uploaded to the GPU and stored in the cache file
+std::vector<uint8_t> SerializeSamplerTables(const SamplerTables& tables);
+bool DeserializeSamplerTables(const void* data, size_t size, SamplerTables& tables);
+
+// Cache file, written to a temporary file which replaces path once it is complete. Reading fails with the reason if
+// the file is missing, malformed or of other settings.
+bool WriteSamplerTables(const char* path, const SamplerTables& tables, std::string* error = nullptr);
+bool ReadSamplerTables(const char* path, SamplerTables& tables, std::string* error = nullptr);
+
+// Read the cache file, or generate the tables and write it. Returns true when the tables were read.
+bool LoadOrGenerateSamplerTables(const char* path, ThreadPool& threadPool, SamplerTables& tables);
+
+// Samples are 32-bit fractions of [0, 1) until SampleToFloat()
+uint32_t ReverseBits(uint32_t value);
+uint32_t HashSamplerSeed(uint32_t seed, uint32_t value);
+
+// Owen scramble of a 32-bit fraction: a bit is flipped depending on the seed and the bits above it. Applied to an
+// index it shuffles the indices of every aligned block of 2^m indices onto another aligned block.
+uint32_t NestedUniformScramble(uint32_t value, uint32_t seed);
+
+uint32_t GetSobolSample(const SamplerTables& tables, uint32_t index, uint32_t dimension);
+uint32_t GetLatticeSample(const SamplerTables& tables, uint32_t index, uint32_t dimension);
+
+// Blue-noise value of a pixel for a dimension of any index, the middle of the interval of the rank
+uint32_t GetBlueNoiseSample(const SamplerTables& tables, uint32_t x, uint32_t y, uint32_t dimension);
+
+// [0, 1) with 24 bits, like NextPathRandom()
+float SampleToFloat(uint32_t value);
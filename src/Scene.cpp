@@ -1,13 +1,29 @@
 #include "Scene.h"
 #include "Helper.h"
 #include "RaytracingHelpers.h"
+#include "HeapRegistry.h"
+#include "ThreadPool.h"
+#include "Hash.h"
+#include <algorithm>
+#include <bit>
+#include <cfloat>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
 #include <format>
+#include <unordered_map>
 
 // DXR related constants (if not defined in SDK)
 #ifndef D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT
 #define D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT 256
 #endif
 
+static_assert(AccelerationStructureBuildFlags::ALLOW_UPDATE == D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE, "Build flags must match D3D12");
+static_assert(AccelerationStructureBuildFlags::ALLOW_COMPACTION == D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_COMPACTION, "Build flags must match D3D12");
+static_assert(AccelerationStructureBuildFlags::PREFER_FAST_TRACE == D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE, "Build flags must match D3D12");
+static_assert(AccelerationStructureBuildFlags::PREFER_FAST_BUILD == D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_BUILD, "Build flags must match D3D12");
+static_assert(AccelerationStructureBuildFlags::MINIMIZE_MEMORY == D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_MINIMIZE_MEMORY, "Build flags must match D3D12");
+
 namespace
 {
     // Cornell Box geometry data
@@ -80,343 +96,1674 @@ namespace
             return indices;
         }
     };
+
+    // Loaded meshes are fitted into a cube of the size of the Cornell box, centered at the camera target
+    const float SCENE_FIT_SIZE = 5.0f;
+
+    // Version of the conversion and preprocessing output, part of the scene pack settings hash. Increment when the
+    // uploaded streams change for the same options so that existing packs are rebuilt.
+    const uint64_t SCENE_STREAM_VERSION = 1;
+
+    // Build flags of the TLAS. It is rebuilt after BLAS updates: a full build of the instances is cheap and keeps the
+    // trace performance of the whole frame.
+    const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS TLAS_BUILD_FLAGS = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
+
+    const uint32_t AS_HEAP_ELEMENT_SIZE = 256;
+
+    // Number of elements of a heap holding size bytes, at least minNumElements
+    uint32_t GetHeapElementCount(uint64_t size, uint32_t elementSize, uint32_t minNumElements)
+    {
+        return std::max(static_cast<uint32_t>(AlignSize(size, elementSize) / elementSize), minNumElements);
+    }
+
+    double MillisecondsSince(std::chrono::steady_clock::time_point startTime)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    }
+
+    // Surface area of the bounds of a position stream. Snorm16 components are multiplied by the scale.
+    float GetPositionSurfaceArea(const void* positionData, uint32_t vertexCount, PositionFormat format, const float scale[3])
+    {
+        if (vertexCount == 0)
+        {
+            return 0.0f;
+        }
+
+        float boundsMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+        float boundsMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+        for (uint32_t i = 0; i < vertexCount; ++i)
+        {
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                const float value = format == PositionFormat::Snorm16 ?
+                    static_cast<const int16_t*>(positionData)[i * 4 + c] * scale[c] : static_cast<const float*>(positionData)[i * 3 + c];
+                boundsMin[c] = std::min(boundsMin[c], value);
+                boundsMax[c] = std::max(boundsMax[c], value);
+            }
+        }
+        return GetBoundsSurfaceArea(boundsMin, boundsMax);
+    }
 }
 
 Scene::Scene() :
     m_device(nullptr),
-    m_vertexCount(0),
-    m_indexCount(0),
-    m_isBuilt(false)
+    m_topLevelASOffsets{},
+    m_currentTLASIndex(0),
+    m_latestTLASIndex(0),
+    m_latestTLASFenceValue(0),
+    m_tlasPrebuildInfo{},
+    m_meshInfoOffset(0),
+    m_isBLASDeduplicationEnabled(true),
+    m_hasUpdatableBLAS(false),
+    m_isScenePackEnabled(true),
+    m_isProcedural(false),
+    m_positionFormat(PositionFormat::Float3),
+    m_colorFormat(ColorFormat::RGBA8),
+    m_isBuilt(false),
+    m_computeAllocatorFenceValues{},
+    m_computeAllocatorIndex(0),
+    m_queueSync(SyncQueueCount, SyncResourceCount),
+    m_fenceEvent(nullptr),
+    m_buildFenceValue(0),
+    m_blasScratchBufferOffset(0),
+    m_blasUpdateScratchBufferOffset(0),
+    m_tlasScratchBufferOffset(0),
+    m_instanceDescBufferOffset(0),
+    m_blasPostBuildInfoBufferOffset(0),
+    m_blasCompactedSizeBufferOffset(0),
+    m_tlasPostBuildInfoBufferOffset(0),
+    m_blasPostBuildInfoReadbackOffset(0),
+    m_tlasPostBuildInfoReadbackOffset(0),
+    m_timestampReadbackOffset(0),
+    m_blasResultDataMaxSize(0),
+    m_tlasResultDataMaxSize(0)
 {
 }
 
 Scene::~Scene()
 {
+    // The frames on the direct queue have completed, the compute queue may still be building
+    if (m_computeQueue)
+    {
+        WaitForQueue(ComputeQueue, m_queueSync.GetLastSubmittedValue(ComputeQueue));
+    }
+
     // Explicitly reset resources in proper order
     // Temporary resources first
-    m_uploadTemporaryHeapManager.Free(m_vertexBufferOffset);
-    m_uploadTemporaryHeapManager.Free(m_indexBufferOffset);
     m_uploadTemporaryHeapManager.Free(m_instanceDescBufferOffset);
 
     m_defaultTemporaryHeapManager.Free(m_blasScratchBufferOffset);
+    m_defaultTemporaryHeapManager.Free(m_blasUpdateScratchBufferOffset);
     m_defaultTemporaryHeapManager.Free(m_tlasScratchBufferOffset);
 
     m_readbackHeapManager.Free(m_blasPostBuildInfoBufferOffset);
+    m_readbackHeapManager.Free(m_blasCompactedSizeBufferOffset);
     m_readbackHeapManager.Free(m_tlasPostBuildInfoBufferOffset);
 
-    m_ASHeapManager.Free(m_topLevelASOffset);
-    m_ASHeapManager.Free(m_bottomLevelASOffset);
+    if (m_ASBuildHeapManager)
+    {
+        for (const SceneBLAS& blas : m_blases)
+        {
+            m_ASBuildHeapManager->Free(blas.buildOffset);
+        }
+    }
+
+    for (uint32_t offset : m_topLevelASOffsets)
+    {
+        m_ASHeapManager.Free(offset);
+    }
+
+    for (const SceneMesh& mesh : m_meshes)
+    {
+        ReleaseBLAS(mesh.blasIndex);
+
+        m_geometryHeapManager.Free(mesh.vertexBufferOffset);
+        m_geometryHeapManager.Free(mesh.attributeBufferOffset);
+        m_geometryHeapManager.Free(mesh.indexBufferOffset);
+        m_geometryHeapManager.Free(mesh.geometryTransformOffset);
+    }
+    m_geometryHeapManager.Free(m_meshInfoOffset);
+
+    HeapRegistry::Instance().RemoveResourceSize("BLAS");
+    HeapRegistry::Instance().RemoveResourceSize("TLAS");
+
+    if (m_fenceEvent != nullptr)
+    {
+        CloseHandle(m_fenceEvent);
+    }
 }
 
 void Scene::Initialize(ID3D12Device5* device)
 {
     m_device = device;
     m_isBuilt = false;
+
+    if (!m_threadPool)
+    {
+        m_threadPool = std::make_unique<ThreadPool>();
+    }
+
+    // Compute queue of the acceleration structure builds, and the fences of the queues sharing the scene resources
+    if (!m_computeQueue)
+    {
+        D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+        queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COMPUTE;
+        queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+        ThrowIfFailed(m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_computeQueue)));
+        m_computeQueue->SetName(L"Scene Compute Queue");
+
+        for (uint32_t i = 0; i < COMPUTE_ALLOCATOR_COUNT; ++i)
+        {
+            ThrowIfFailed(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COMPUTE, IID_PPV_ARGS(&m_computeCommandAllocators[i])));
+
+            wchar_t name[48];
+            swprintf_s(name, L"Scene Compute Allocator %u", i);
+            m_computeCommandAllocators[i]->SetName(name);
+        }
+
+        // The command list stays open for the next build
+        ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COMPUTE, m_computeCommandAllocators[0].Get(), nullptr,
+            IID_PPV_ARGS(&m_computeCommandList)));
+        m_computeCommandList->SetName(L"Scene Compute Command List");
+
+        ThrowIfFailed(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_queueFences[DirectQueue])));
+        ThrowIfFailed(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_queueFences[ComputeQueue])));
+        m_queueFences[DirectQueue]->SetName(L"Scene Direct Fence");
+        m_queueFences[ComputeQueue]->SetName(L"Scene Compute Fence");
+
+        m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+        if (m_fenceEvent == nullptr)
+        {
+            ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+        }
+    }
 }
 
-void Scene::BuildAccelerationStructures(ID3D12GraphicsCommandList4* commandList,
-                                       ID3D12CommandAllocator* commandAllocator,
-                                       ID3D12CommandQueue* commandQueue)
+void Scene::BuildAccelerationStructures()
 {
     if (m_isBuilt)
     {
         OutputDebugStringA("Scene acceleration structures already built.\n");
         return;
     }
-    
-    if (!m_device)
+
+    if (!m_device || !m_computeQueue)
     {
         OutputDebugStringA("Error: Scene not initialized with device.\n");
         return;
     }
 
-    // allocate 10MB for the default heap. 1KB per element.
-    m_ASHeapManager.Initialize(m_device, 1024 * 10, 256, D3D12_HEAP_TYPE_DEFAULT, D3D12_HEAP_FLAG_NONE, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, "AS Heap", false);
-    m_defaultTemporaryHeapManager.Initialize(m_device, 1024 * 10, 256, D3D12_HEAP_TYPE_DEFAULT, D3D12_HEAP_FLAG_NONE, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON, "Scene Default temporary Heap");
+    // Create geometry, from the scene pack if it is valid. The source meshes and the mapped pack are released once
+    // the streams are in the geometry heap.
+    {
+        ScenePack scenePack;
+        if (!LoadScenePack(scenePack))
+        {
+            GltfScene gltfScene;
+            std::vector<MeshSource> sources;
+            std::vector<std::string> sourcePaths;
+            LoadMeshes(sources, gltfScene, sourcePaths);
+            CreateGeometry(sources, sourcePaths);
+        }
+    }
+    if (m_meshes.empty() || m_instances.empty())
+    {
+        OutputDebugStringA("Error: The scene has no triangle.\n");
+        return;
+    }
 
-    // allocate 10MB for the upload heap. 1KB per element.
-    m_uploadTemporaryHeapManager.Initialize(m_device, 1024 * 10, 256, D3D12_HEAP_TYPE_GPU_UPLOAD, D3D12_HEAP_FLAG_NONE, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COMMON, "Scene Upload temporary Heap");
+    // The instance transforms are the world transforms of the scene graph
+    BuildSceneGraph();
 
-    // allocate 32KB for the readback heap. 256B per element.
-    m_readbackHeapManager.Initialize(m_device, 32 * 1024, 256, "SceneReadback Heap");
+    // The heaps are sized from the prebuild info of all acceleration structures
+    ComputeAccelerationStructureSizes();
 
-    // Create geometry
-    CreateCornellBoxGeometry();
-    
-    // Build acceleration structures
+    // Timestamps to measure the BLAS builds
+    {
+        D3D12_QUERY_HEAP_DESC queryHeapDesc = {};
+        queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+        queryHeapDesc.Count = TimestampQueries::Count;
+        ThrowIfFailed(m_device->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&m_timestampQueryHeap)));
+        m_timestampReadbackOffset = m_readbackHeapManager.Allocate(sizeof(uint64_t) * TimestampQueries::Count);
+    }
+
+    // Build the BLASes and read back their post-build info
+    ID3D12GraphicsCommandList4* commandList = m_computeCommandList.Get();
     CreateBottomLevelAS(commandList);
-    CreateTopLevelAS(commandList);
-    
-    // Close and execute command list
-    ThrowIfFailed(commandList->Close());
-    
-    ID3D12CommandList* commandLists[] = { commandList };
-    commandQueue->ExecuteCommandLists(1, commandLists);
+    RequestBLASPostBuildInfoReadback();
+    m_readbackHeapManager.GPUWriteEnd(commandList);
+    m_readbackHeapManager.ResolveQueryData(commandList, m_timestampQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, 0, TimestampQueries::Count, m_timestampReadbackOffset);
 
-    // Reset command list for future use
-    ThrowIfFailed(commandList->Reset(commandAllocator, nullptr));
+    // Report the uploaded ranges to the tools before the GPU consumes them
+    m_geometryHeapManager.FlushTrackedWrites();
 
-    // Wait for GPU to complete building
-    WaitForGPU(commandQueue);
-    
-    // Read back post-build info for debugging
-    ReadbackPostBuildInfo();
-    
-    FreeTemporaryResources();
+    // Compacted BLASes are built in the build heap. The compacted sizes are known once the builds have completed,
+    // then the AS heap is created and the BLASes are compacted or copied into it.
+    if (m_ASBuildHeapManager)
+    {
+        WaitForQueue(ComputeQueue, ExecuteCompute({}));
+        m_readbackHeapManager.Update();
+        CompactBottomLevelAS(commandList);
+    }
+
+    CreateTopLevelAS(commandList);
+    RequestTLASPostBuildInfoReadback();
+    m_readbackHeapManager.GPUWriteEnd(commandList);
+    m_uploadTemporaryHeapManager.FlushTrackedWrites();
+
+    // The frames wait for the build on the GPU. The build time is reported and the temporary resources are freed by
+    // the first BeginFrame() which sees it completed.
+    m_buildFenceValue = ExecuteCompute({});
+    m_queueSync.RecordRead(ComputeQueue, GeometryResource, m_buildFenceValue);
+    m_queueSync.RecordWrite(ComputeQueue, BLASResource, m_buildFenceValue);
+    m_queueSync.RecordRead(ComputeQueue, InstanceDescResource, m_buildFenceValue);
+    m_queueSync.RecordWrite(ComputeQueue, TLASResource, m_buildFenceValue);
+    m_currentTLASIndex = 0;
+    m_latestTLASIndex = 0;
+    m_latestTLASFenceValue = m_buildFenceValue;
 
     m_isBuilt = true;
-    OutputDebugStringA("Scene acceleration structures built successfully.\n");
+    OutputDebugStringA("Scene acceleration structures submitted to the compute queue.\n");
 }
 
-void Scene::CreateCornellBoxGeometry()
+void Scene::BeginFrame(ID3D12CommandQueue* directQueue)
 {
-    // Get Cornell Box vertices and indices
-    auto vertices = CornellBoxGeometry::GetVertices();
-    auto indices = CornellBoxGeometry::GetIndices();
-    
-    m_vertexCount = static_cast<uint32_t>(vertices.size());
-    m_indexCount = static_cast<uint32_t>(indices.size());
-    
-    const UINT vertexBufferSize = static_cast<UINT>(vertices.size() * sizeof(Vertex));
-    const UINT indexBufferSize = static_cast<UINT>(indices.size() * sizeof(uint32_t));
+    if (!m_isBuilt)
+    {
+        return;
+    }
 
-    m_vertexBufferOffset = m_uploadTemporaryHeapManager.Allocate(vertexBufferSize);
-    m_indexBufferOffset = m_uploadTemporaryHeapManager.Allocate(indexBufferSize);
-    
-    memcpy(m_uploadTemporaryHeapManager.GetMappedPtr(m_vertexBufferOffset), vertices.data(), vertexBufferSize);
-    memcpy(m_uploadTemporaryHeapManager.GetMappedPtr(m_indexBufferOffset), indices.data(), indexBufferSize);
-    
-    OutputDebugStringA("Cornell Box geometry created successfully.\n");
+    UpdateCompletedValues();
+    m_readbackHeapManager.Update();
+    if (m_buildFenceValue != 0 && m_queueSync.IsCompleted(ComputeQueue, m_buildFenceValue))
+    {
+        ReportBLASBuildTime(m_computeQueue.Get());
+        FreeTemporaryResources();
+        m_buildFenceValue = 0;
+        OutputDebugStringA("Scene acceleration structures built successfully.\n");
+    }
+
+    // A frame keeps the TLAS it has been reading while a newer one builds. It switches once the build has completed,
+    // or when it must wait for the compute queue anyway because BLASes are refitted in place.
+    std::vector<QueueWait> waits;
+    m_queueSync.GetWaitsBeforeRead(DirectQueue, BLASResource, waits);
+    if (m_latestTLASIndex != m_currentTLASIndex && (!waits.empty() || m_queueSync.IsCompleted(ComputeQueue, m_latestTLASFenceValue)))
+    {
+        m_currentTLASIndex = m_latestTLASIndex;
+    }
+    m_queueSync.GetWaitsBeforeRead(DirectQueue, GeometryResource, waits);
+    m_queueSync.GetWaitsBeforeRead(DirectQueue, TLASResource + m_currentTLASIndex, waits);
+
+    // Only the compute queue writes what the frames read
+    for (const QueueWait& wait : waits)
+    {
+        ThrowIfFailed(directQueue->Wait(m_queueFences[wait.queue].Get(), wait.fenceValue));
+        m_queueSync.RecordWait(DirectQueue, wait);
+    }
 }
 
-void Scene::CreateBottomLevelAS(ID3D12GraphicsCommandList4* commandList)
+void Scene::EndFrame(ID3D12CommandQueue* directQueue)
 {
-    // Check that we have created geometry
-    if (m_vertexBufferOffset == 0 || m_indexBufferOffset == 0)
+    if (!m_isBuilt)
     {
-        OutputDebugStringA("Error: Create geometry before building acceleration structures.\n");
         return;
     }
-    
-    // Describe the geometry
-    D3D12_RAYTRACING_GEOMETRY_DESC geometryDesc = {};
-    geometryDesc.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
-    geometryDesc.Triangles.VertexBuffer.StartAddress = m_uploadTemporaryHeapManager.GetGPUVirtualAddress(m_vertexBufferOffset);
-    geometryDesc.Triangles.VertexBuffer.StrideInBytes = sizeof(Vertex);
-    geometryDesc.Triangles.VertexCount = m_vertexCount;
-    geometryDesc.Triangles.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;  // Position only
-    geometryDesc.Triangles.IndexBuffer = m_uploadTemporaryHeapManager.GetGPUVirtualAddress(m_indexBufferOffset);
-    geometryDesc.Triangles.IndexCount = m_indexCount;
-    geometryDesc.Triangles.IndexFormat = DXGI_FORMAT_R32_UINT;
-    geometryDesc.Triangles.Transform3x4 = 0;  // No per-geometry transform
-    geometryDesc.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE;
-    
-    // Get required sizes for acceleration structure buffers
-    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs = {};
-    inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
-    inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
-    inputs.NumDescs = 1;
-    inputs.pGeometryDescs = &geometryDesc;
-    inputs.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
 
-    D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO prebuildInfo = {};
-    m_device->GetRaytracingAccelerationStructurePrebuildInfo(&inputs, &prebuildInfo);
+    const uint64_t fenceValue = m_queueSync.Submit(DirectQueue);
+    ThrowIfFailed(directQueue->Signal(m_queueFences[DirectQueue].Get(), fenceValue));
+    m_queueSync.RecordRead(DirectQueue, GeometryResource, fenceValue);
+    m_queueSync.RecordRead(DirectQueue, BLASResource, fenceValue);
+    m_queueSync.RecordRead(DirectQueue, TLASResource + m_currentTLASIndex, fenceValue);
+}
 
-    // Print prebuild info
+void Scene::LoadMeshes(std::vector<MeshSource>& sources, GltfScene& gltfScene, std::vector<std::string>& sourcePaths)
+{
+    m_instances.clear();
+    sourcePaths.clear();
+
+    std::string extension = std::filesystem::path(m_scenePath).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(tolower(static_cast<unsigned char>(c))); });
+
+    bool isLoaded = false;
+    if (m_isProcedural)
     {
-        OutputDebugStringA("BLAS Prebuild Info:\n");
-        OutputDebugStringA(std::format("Scratch Data Size: {} bytes\n", prebuildInfo.ScratchDataSizeInBytes).c_str());
-        OutputDebugStringA(std::format("Result Data Max Size: {} bytes\n", prebuildInfo.ResultDataMaxSizeInBytes).c_str());
+        const auto startTime = std::chrono::steady_clock::now();
+        ProceduralScene scene;
+        GenerateProceduralScene(m_proceduralSettings, scene, m_threadPool.get());
+
+        sources.resize(scene.meshes.size());
+        for (size_t i = 0; i < scene.meshes.size(); ++i)
+        {
+            MeshSource& source = sources[i];
+            source.name = std::move(scene.meshes[i].name);
+            source.vertices = std::move(scene.meshes[i].vertices);
+            source.indices = std::move(scene.meshes[i].indices);
+            source.gltfPrimitive = nullptr;
+            memcpy(source.boundsMin, scene.meshes[i].boundsMin, sizeof(source.boundsMin));
+            memcpy(source.boundsMax, scene.meshes[i].boundsMax, sizeof(source.boundsMax));
+        }
+
+        m_instances.resize(scene.instances.size());
+        for (size_t i = 0; i < scene.instances.size(); ++i)
+        {
+            m_instances[i].meshIndex = scene.instances[i].meshIndex;
+            memcpy(m_instances[i].transform, scene.instances[i].transform, sizeof(m_instances[i].transform));
+        }
+
+        OutputDebugStringA(std::format("Procedural scene {}: {} meshes, {} instances, generated in {:.3f} ms\n", GetProceduralSceneSettingsText(m_proceduralSettings),
+            sources.size(), m_instances.size(), MillisecondsSince(startTime)).c_str());
+        isLoaded = true;
     }
-    
-    // Allocate scratch buffer
-    m_blasScratchBufferOffset = m_defaultTemporaryHeapManager.Allocate(static_cast<uint32_t>(prebuildInfo.ScratchDataSizeInBytes));
-    
-    // Allocate BLAS buffer
-    m_bottomLevelASOffset = m_ASHeapManager.Allocate(static_cast<uint32_t>(prebuildInfo.ResultDataMaxSizeInBytes));
-    
-    // Create post-build info buffer for BLAS (must be UAV-compatible)
-    m_blasPostBuildInfoBufferOffset = m_readbackHeapManager.Allocate(sizeof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_CURRENT_SIZE_DESC));
+    else if (extension == ".gltf" || extension == ".glb")
+    {
+        GltfLoadStats stats = {};
+        if (gltfScene.Load(m_scenePath.c_str(), *m_threadPool, &stats))
+        {
+            OutputDebugStringA(std::format("glTF {}: {:.1f} MB, {:.1f} MB of buffers ({:.1f} MB decoded), {} nodes (depth {}), {} meshes, {} primitives, {} instances, map {:.3f} ms, JSON {:.3f} ms, flatten {:.3f} ms\n",
+                m_scenePath, static_cast<double>(stats.fileSize) / (1024.0 * 1024.0), static_cast<double>(stats.bufferSize) / (1024.0 * 1024.0),
+                static_cast<double>(stats.copiedBufferSize) / (1024.0 * 1024.0), stats.numNodes, stats.hierarchyDepth, stats.numMeshes, stats.numPrimitives,
+                stats.numInstances, stats.mapMilliseconds, stats.parseMilliseconds, stats.flattenMilliseconds).c_str());
 
-    // Transition buffers to UAV state
-    m_defaultTemporaryHeapManager.Transition(commandList, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-    m_ASHeapManager.Transition(commandList, D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE);
+            // One mesh per primitive. A node instances every primitive of its glTF mesh with the same transform.
+            const std::vector<GltfMesh>& gltfMeshes = gltfScene.GetMeshes();
+            const std::vector<GltfPrimitive>& primitives = gltfScene.GetPrimitives();
+            sources.resize(primitives.size());
+            for (size_t i = 0; i < primitives.size(); ++i)
+            {
+                const GltfMesh& gltfMesh = gltfMeshes[primitives[i].meshIndex];
+                MeshSource& source = sources[i];
+                source.name = gltfMesh.numPrimitives > 1 ? std::format("{}[{}]", gltfMesh.name, i - gltfMesh.firstPrimitive) : gltfMesh.name;
+                source.gltfPrimitive = &primitives[i];
+                memcpy(source.boundsMin, primitives[i].boundsMin, sizeof(source.boundsMin));
+                memcpy(source.boundsMax, primitives[i].boundsMax, sizeof(source.boundsMax));
+            }
 
-    m_readbackHeapManager.GPUWriteBegin(commandList);
-    
-    // Build BLAS
-    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildDesc = {};
-    buildDesc.Inputs = inputs;
-    buildDesc.DestAccelerationStructureData = m_ASHeapManager.GetGPUVirtualAddress(m_bottomLevelASOffset);
-    buildDesc.ScratchAccelerationStructureData = m_defaultTemporaryHeapManager.GetGPUVirtualAddress(m_blasScratchBufferOffset);
-    
-    D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC postBuildInfoDesc = {};
-    postBuildInfoDesc.InfoType = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_CURRENT_SIZE;
-    postBuildInfoDesc.DestBuffer = m_readbackHeapManager.GetGPUVirtualAddress(m_blasPostBuildInfoBufferOffset);
+            for (const GltfInstance& gltfInstance : gltfScene.GetInstances())
+            {
+                const GltfMesh& gltfMesh = gltfMeshes[gltfInstance.meshIndex];
+                for (uint32_t k = 0; k < gltfMesh.numPrimitives; ++k)
+                {
+                    SceneInstance instance = {};
+                    instance.meshIndex = gltfMesh.firstPrimitive + k;
+                    memcpy(instance.transform, gltfInstance.transform, sizeof(instance.transform));
+                    m_instances.push_back(instance);
+                }
+            }
+            sourcePaths = gltfScene.GetFilePaths();
+            isLoaded = true;
+        }
+    }
+    else if (!m_scenePath.empty())
+    {
+        std::vector<ObjMesh> objMeshes;
+        ObjLoadStats stats = {};
+        if (LoadObjFile(m_scenePath.c_str(), *m_threadPool, objMeshes, &stats))
+        {
+            const double parseSeconds = std::max(stats.parseMilliseconds, 1.0e-3) / 1000.0;
+            OutputDebugStringA(std::format("OBJ {}: {:.1f} MB, {} meshes, {} triangles, {} threads, {} chunks, map {:.3f} ms, parse {:.3f} ms ({:.2f} GB/s), merge {:.3f} ms, build {:.3f} ms\n",
+                m_scenePath, static_cast<double>(stats.fileSize) / (1024.0 * 1024.0), stats.numMeshes, stats.numTriangles, stats.numThreads, stats.numChunks,
+                stats.mapMilliseconds, stats.parseMilliseconds, static_cast<double>(stats.fileSize) / 1.0e9 / parseSeconds,
+                stats.mergeMilliseconds, stats.buildMilliseconds).c_str());
 
-    commandList->BuildRaytracingAccelerationStructure(&buildDesc, 1, &postBuildInfoDesc);
-    
-    // Insert UAV barriers to ensure BLAS and post-build info writes complete
-    m_defaultTemporaryHeapManager.UAVBarrier(commandList);
-    m_ASHeapManager.UAVBarrier(commandList);
-    
-    // Copy post-build info to readback buffer
-    m_readbackHeapManager.GPUWriteEnd(commandList);
+            // One mesh and one instance per object/group
+            sources.resize(objMeshes.size());
+            m_threadPool->ParallelFor(static_cast<uint32_t>(objMeshes.size()), [&](uint32_t i)
+            {
+                MeshSource& source = sources[i];
+                source.name = std::move(objMeshes[i].name);
+                source.vertices = std::move(objMeshes[i].vertices);
+                source.indices = std::move(objMeshes[i].indices);
+                source.gltfPrimitive = nullptr;
+                for (uint32_t axis = 0; axis < 3; ++axis)
+                {
+                    source.boundsMin[axis] = FLT_MAX;
+                    source.boundsMax[axis] = -FLT_MAX;
+                }
+                for (const GeometrySourceVertex& vertex : source.vertices)
+                {
+                    for (uint32_t axis = 0; axis < 3; ++axis)
+                    {
+                        source.boundsMin[axis] = std::min(source.boundsMin[axis], vertex.position[axis]);
+                        source.boundsMax[axis] = std::max(source.boundsMax[axis], vertex.position[axis]);
+                    }
+                }
+            });
 
-    OutputDebugStringA("Bottom Level Acceleration Structure created successfully.\n");
-}
+            for (uint32_t i = 0; i < sources.size(); ++i)
+            {
+                SceneInstance instance = {};
+                instance.meshIndex = i;
+                instance.transform[0][0] = 1.0f;
+                instance.transform[1][1] = 1.0f;
+                instance.transform[2][2] = 1.0f;
+                m_instances.push_back(instance);
+            }
+            sourcePaths.push_back(m_scenePath);
+            isLoaded = true;
+        }
+    }
 
-void Scene::CreateTopLevelAS(ID3D12GraphicsCommandList4* commandList)
-{
-    // Check that we have created BLAS
-    if (m_bottomLevelASOffset == 0)
+    if (isLoaded)
     {
-        OutputDebugStringA("Error: Create BLAS before building TLAS.\n");
+        FitInstancesToView(sources);
         return;
     }
-    
-    // Create instance description buffer
-    {
-        D3D12_RAYTRACING_INSTANCE_DESC instanceDesc = {};
-        instanceDesc.InstanceID = 0;
-        instanceDesc.InstanceMask = 0xFF;  // Visible to all rays
-        instanceDesc.InstanceContributionToHitGroupIndex = 0;
-        instanceDesc.Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
-        instanceDesc.AccelerationStructure = m_ASHeapManager.GetGPUVirtualAddress(m_bottomLevelASOffset);
-        
-        // Set identity transform
-        instanceDesc.Transform[0][0] = 1.0f;
-        instanceDesc.Transform[1][1] = 1.0f;
-        instanceDesc.Transform[2][2] = 1.0f;
-        
-        // Upload instance description to GPU
-        m_instanceDescBufferOffset = m_uploadTemporaryHeapManager.Allocate(sizeof(D3D12_RAYTRACING_INSTANCE_DESC));
-        memcpy(m_uploadTemporaryHeapManager.GetMappedPtr(m_instanceDescBufferOffset), &instanceDesc, sizeof(D3D12_RAYTRACING_INSTANCE_DESC));
+    if (!m_scenePath.empty())
+    {
+        OutputDebugStringA(std::format("Failed to load {}, using the Cornell box.\n", m_scenePath).c_str());
+        sources.clear();
+        m_instances.clear();
+        sourcePaths.clear();
     }
-    
-    // Get required sizes for TLAS
-    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs = {};
-    inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL;
-    inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
-    inputs.NumDescs = 1;  // One instance of Cornell Box
-    inputs.InstanceDescs = m_uploadTemporaryHeapManager.GetGPUVirtualAddress(m_instanceDescBufferOffset);
-    inputs.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
-    
-    D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO prebuildInfo = {};
-    m_device->GetRaytracingAccelerationStructurePrebuildInfo(&inputs, &prebuildInfo);
-    
-    // Allocate scratch buffer
-    m_tlasScratchBufferOffset = m_defaultTemporaryHeapManager.Allocate(static_cast<uint32_t>(prebuildInfo.ScratchDataSizeInBytes));
-    
-    // Allocate TLAS buffer
-    m_topLevelASOffset = m_ASHeapManager.Allocate(static_cast<uint32_t>(prebuildInfo.ResultDataMaxSizeInBytes));
 
-    // Create post-build info buffer for TLAS (must be UAV-compatible)
-    m_tlasPostBuildInfoBufferOffset = m_readbackHeapManager.Allocate(sizeof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_CURRENT_SIZE_DESC));
+    static_assert(sizeof(Vertex) == sizeof(GeometrySourceVertex) && offsetof(Vertex, normal) == offsetof(GeometrySourceVertex, normal) &&
+        offsetof(Vertex, color) == offsetof(GeometrySourceVertex, color), "Vertex must match GeometrySourceVertex");
+    const std::vector<Vertex> vertices = CornellBoxGeometry::GetVertices();
 
-    m_defaultTemporaryHeapManager.Transition(commandList, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-    m_ASHeapManager.Transition(commandList, D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE);
-    m_readbackHeapManager.GPUWriteBegin(commandList);
-    
-    // Build TLAS
-    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildDesc = {};
-    buildDesc.Inputs = inputs;
-    buildDesc.DestAccelerationStructureData = m_ASHeapManager.GetGPUVirtualAddress(m_topLevelASOffset);
-    buildDesc.ScratchAccelerationStructureData = m_defaultTemporaryHeapManager.GetGPUVirtualAddress(m_tlasScratchBufferOffset);
-    
-    D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC postBuildInfoDesc = {};
-    postBuildInfoDesc.InfoType = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_CURRENT_SIZE;
-    postBuildInfoDesc.DestBuffer = m_readbackHeapManager.GetGPUVirtualAddress(m_tlasPostBuildInfoBufferOffset);
-    
-    commandList->BuildRaytracingAccelerationStructure(&buildDesc, 1, &postBuildInfoDesc);
-    
-    // Insert UAV barriers to ensure TLAS and post-build info writes complete
-    m_defaultTemporaryHeapManager.UAVBarrier(commandList);
-    m_ASHeapManager.UAVBarrier(commandList);
-    m_readbackHeapManager.GPUWriteEnd(commandList);
+    MeshSource cornellBox = {};
+    cornellBox.name = "CornellBox";
+    cornellBox.vertices.resize(vertices.size());
+    memcpy(cornellBox.vertices.data(), vertices.data(), vertices.size() * sizeof(Vertex));
+    cornellBox.indices = CornellBoxGeometry::GetIndices();
+    sources.push_back(std::move(cornellBox));
 
-    OutputDebugStringA("Top Level Acceleration Structure created successfully.\n");
+    SceneInstance instance = {};
+    instance.transform[0][0] = 1.0f;
+    instance.transform[1][1] = 1.0f;
+    instance.transform[2][2] = 1.0f;
+    m_instances.push_back(instance);
+
+    OutputDebugStringA("Cornell Box geometry created successfully.\n");
 }
 
-void Scene::WaitForGPU(ID3D12CommandQueue* commandQueue)
+void Scene::FitInstancesToView(const std::vector<MeshSource>& sources)
 {
-    // Create temporary fence for synchronization
-    ComPtr<ID3D12Fence> fence;
-    ThrowIfFailed(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)));
-    
-    // Create event
-    HANDLE fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-    if (fenceEvent == nullptr)
+    // World space bounds of the instances from the corners of the mesh bounds
+    float boundsMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float boundsMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (const SceneInstance& instance : m_instances)
     {
-        ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+        const MeshSource& source = sources[instance.meshIndex];
+        if (source.boundsMin[0] > source.boundsMax[0])
+        {
+            continue;
+        }
+
+        for (uint32_t corner = 0; corner < 8; ++corner)
+        {
+            const float position[3] = {
+                (corner & 1) ? source.boundsMax[0] : source.boundsMin[0],
+                (corner & 2) ? source.boundsMax[1] : source.boundsMin[1],
+                (corner & 4) ? source.boundsMax[2] : source.boundsMin[2],
+            };
+            for (uint32_t axis = 0; axis < 3; ++axis)
+            {
+                const float* row = instance.transform[axis];
+                const float world = row[0] * position[0] + row[1] * position[1] + row[2] * position[2] + row[3];
+                boundsMin[axis] = std::min(boundsMin[axis], world);
+                boundsMax[axis] = std::max(boundsMax[axis], world);
+            }
+        }
+    }
+    if (boundsMin[0] > boundsMax[0])
+    {
+        return;
+    }
+
+    // Scale and center the scene to the Cornell box
+    const float extent = std::max({ boundsMax[0] - boundsMin[0], boundsMax[1] - boundsMin[1], boundsMax[2] - boundsMin[2] });
+    const float scale = extent > 0.0f ? SCENE_FIT_SIZE / extent : 1.0f;
+    for (SceneInstance& instance : m_instances)
+    {
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            for (uint32_t column = 0; column < 4; ++column)
+            {
+                instance.transform[axis][column] *= scale;
+            }
+            instance.transform[axis][3] -= 0.5f * (boundsMin[axis] + boundsMax[axis]) * scale;
+        }
     }
-    
-    // Signal and wait
-    const UINT64 fenceValue = 1;
-    ThrowIfFailed(commandQueue->Signal(fence.Get(), fenceValue));
-    ThrowIfFailed(fence->SetEventOnCompletion(fenceValue, fenceEvent));
-    WaitForSingleObjectEx(fenceEvent, INFINITE, FALSE);
-    
-    // Cleanup
-    CloseHandle(fenceEvent);
 }
 
-void Scene::ReadbackPostBuildInfo()
+void Scene::CreateGeometry(const std::vector<MeshSource>& sources, const std::vector<std::string>& sourcePaths)
 {
-    if (m_blasPostBuildInfoBufferOffset == 0 || m_tlasPostBuildInfoBufferOffset == 0)
+    struct PreparedMesh
     {
-        OutputDebugStringA("Warning: Post-build info readback buffers not available.\n");
-        return;
+        PreprocessedMesh mesh;
+        MeshPreprocessStats stats;
+        GeometryStreams streams;
+        GeometryStreamErrors errors;
+        bool isPreprocessed;
+
+        // Uploaded data, in the streams and the preprocessed mesh or in the mapped glTF buffers
+        const void* positionData;
+        size_t positionDataSize;
+        const void* indexData;
+        size_t indexDataSize;
+        uint32_t indexStride;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+    };
+
+    // glTF primitives whose positions and indices are in the GPU formats are uploaded from the mapped file, only the
+    // attributes are packed. Everything else is welded, reordered for locality, gets the index format selected and
+    // the AoS vertices split into the position stream for the BLAS build and the compressed attribute stream.
+    // The meshes are independent.
+    const bool isQuantized = m_positionFormat == PositionFormat::Snorm16;
+    auto canUploadDirectly = [isQuantized](const GltfPrimitive& primitive)
+    {
+        return !isQuantized && primitive.positions.IsTightlyPacked() && primitive.normals.IsPresent() &&
+            primitive.indices.IsPresent() && primitive.indices.IsTightlyPacked() &&
+            (primitive.indices.componentType == GltfComponentType::UInt16 || primitive.indices.componentType == GltfComponentType::UInt32);
+    };
+
+    const auto prepareStartTime = std::chrono::steady_clock::now();
+    const uint32_t numSources = static_cast<uint32_t>(sources.size());
+    std::vector<PreparedMesh> preparedMeshes(numSources);
+    m_threadPool->ParallelFor(numSources, [&](uint32_t i)
+    {
+        const MeshSource& source = sources[i];
+        PreparedMesh& prepared = preparedMeshes[i];
+        const GltfPrimitive* primitive = source.gltfPrimitive;
+
+        if (primitive && canUploadDirectly(*primitive))
+        {
+            prepared.isPreprocessed = false;
+            prepared.vertexCount = primitive->positions.count;
+            prepared.indexCount = primitive->indices.count;
+            prepared.indexStride = primitive->indices.GetElementSize();
+            prepared.positionData = primitive->positions.data;
+            prepared.positionDataSize = static_cast<size_t>(prepared.vertexCount) * primitive->positions.stride;
+            prepared.indexData = primitive->indices.data;
+            prepared.indexDataSize = static_cast<size_t>(prepared.indexCount) * prepared.indexStride;
+
+            prepared.streams.attributes.resize(prepared.vertexCount);
+            for (uint32_t v = 0; v < prepared.vertexCount; ++v)
+            {
+                float normal[3];
+                float color[4];
+                primitive->normals.ReadFloats(v, normal, 3);
+                GetGltfVertexColor(*primitive, v, color);
+                prepared.streams.attributes[v].normal = EncodeOctahedralNormal(normal);
+                prepared.streams.attributes[v].color = PackColor(color, m_colorFormat);
+            }
+            return;
+        }
+
+        const std::vector<GeometrySourceVertex>* vertices = &source.vertices;
+        const std::vector<uint32_t>* indices = &source.indices;
+        std::vector<GeometrySourceVertex> convertedVertices;
+        std::vector<uint32_t> convertedIndices;
+        if (primitive)
+        {
+            ConvertGltfPrimitive(*primitive, convertedVertices, convertedIndices);
+            vertices = &convertedVertices;
+            indices = &convertedIndices;
+        }
+
+        PreprocessMesh(vertices->data(), static_cast<uint32_t>(vertices->size()),
+            indices->data(), static_cast<uint32_t>(indices->size()), m_meshPreprocessOptions, prepared.mesh, &prepared.stats);
+
+        const uint32_t vertexCount = static_cast<uint32_t>(prepared.mesh.vertices.size());
+        BuildGeometryStreams(prepared.mesh.vertices.data(), vertexCount, m_positionFormat, m_colorFormat, prepared.streams);
+        prepared.errors = MeasureGeometryStreamErrors(prepared.mesh.vertices.data(), vertexCount, prepared.streams);
+
+        prepared.isPreprocessed = true;
+        prepared.vertexCount = vertexCount;
+        prepared.indexCount = prepared.mesh.GetIndexCount();
+        prepared.indexStride = prepared.mesh.indexStride;
+        prepared.positionData = prepared.streams.GetPositionData();
+        prepared.positionDataSize = prepared.streams.GetPositionDataSize();
+        prepared.indexData = prepared.mesh.GetIndexData();
+        prepared.indexDataSize = prepared.mesh.GetIndexDataSize();
+    });
+    const double prepareMilliseconds = MillisecondsSince(prepareStartTime);
+
+    MeshPreprocessStats totalStats = {};
+    GeometryStreamErrors maxErrors = {};
+    double inputCacheMisses = 0.0;
+    double outputCacheMisses = 0.0;
+    uint32_t numPreprocessedMeshes = 0;
+    uint64_t directUploadSize = 0;
+    for (const PreparedMesh& prepared : preparedMeshes)
+    {
+        if (!prepared.isPreprocessed)
+        {
+            directUploadSize += prepared.positionDataSize + prepared.indexDataSize;
+            continue;
+        }
+
+        ++numPreprocessedMeshes;
+        totalStats.inputVertexCount += prepared.stats.inputVertexCount;
+        totalStats.outputVertexCount += prepared.stats.outputVertexCount;
+        totalStats.inputTriangleCount += prepared.stats.inputTriangleCount;
+        totalStats.outputTriangleCount += prepared.stats.outputTriangleCount;
+        totalStats.inputBytes += prepared.stats.inputBytes;
+        totalStats.outputBytes += prepared.stats.outputBytes;
+        inputCacheMisses += static_cast<double>(prepared.stats.inputAcmr) * prepared.stats.inputTriangleCount;
+        outputCacheMisses += static_cast<double>(prepared.stats.outputAcmr) * prepared.stats.outputTriangleCount;
+
+        maxErrors.maxPositionError = std::max(maxErrors.maxPositionError, prepared.errors.maxPositionError);
+        maxErrors.maxNormalErrorDegrees = std::max(maxErrors.maxNormalErrorDegrees, prepared.errors.maxNormalErrorDegrees);
+        maxErrors.maxColorError = std::max(maxErrors.maxColorError, prepared.errors.maxColorError);
     }
-    
-    // Read BLAS post-build info
+
+    OutputDebugStringA(std::format("Mesh preprocess: {} meshes, vertices {} -> {}, triangles {} -> {}, {} -> {} bytes, ACMR {:.3f} -> {:.3f}, {:.3f} ms on {} threads\n",
+        numPreprocessedMeshes, totalStats.inputVertexCount, totalStats.outputVertexCount, totalStats.inputTriangleCount, totalStats.outputTriangleCount,
+        totalStats.inputBytes, totalStats.outputBytes,
+        inputCacheMisses / std::max(totalStats.inputTriangleCount, 1u), outputCacheMisses / std::max(totalStats.outputTriangleCount, 1u),
+        prepareMilliseconds, m_threadPool->GetNumThreads()).c_str());
+    if (numPreprocessedMeshes < numSources)
     {
-        D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_CURRENT_SIZE_DESC* pData = 
-        static_cast<D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_CURRENT_SIZE_DESC*>(m_readbackHeapManager.GetMappedPtr(m_blasPostBuildInfoBufferOffset));
+        OutputDebugStringA(std::format("Direct upload: {} glTF primitives, {} bytes of positions and indices uploaded from the mapped buffers\n",
+            numSources - numPreprocessedMeshes, directUploadSize).c_str());
+    }
+    OutputDebugStringA(std::format("Geometry streams: {} + {} bytes per vertex (was {}), max error: position {}, normal {} degrees, color {}\n",
+        isQuantized ? sizeof(int16_t) * 4 : sizeof(float) * 3, sizeof(PackedVertexAttributes), sizeof(Vertex),
+        maxErrors.maxPositionError, maxErrors.maxNormalErrorDegrees, maxErrors.maxColorError).c_str());
 
-        if (pData)
+    // Meshes whose triangles were all degenerate are dropped together with their instances
+    const uint32_t INVALID_MESH = UINT32_MAX;
+    std::vector<ScenePackMesh> uploads;
+    std::vector<uint32_t> meshIndices(numSources, INVALID_MESH);
+    uploads.reserve(numSources);
+    for (uint32_t i = 0; i < numSources; ++i)
+    {
+        const PreparedMesh& prepared = preparedMeshes[i];
+        if (prepared.indexCount == 0)
         {
-            char debugMsg[256];
-            sprintf_s(debugMsg, "BLAS Current Size: %llu bytes (%.2f KB)\n", 
-                     pData->CurrentSizeInBytes,
-                     pData->CurrentSizeInBytes / 1024.0);
-            OutputDebugStringA(debugMsg);
+            OutputDebugStringA(std::format("Mesh {} has no triangle, skipped.\n", sources[i].name).c_str());
+            continue;
         }
-        else
+
+        ScenePackMesh upload = {};
+        upload.name = sources[i].name;
+        upload.positionData = prepared.positionData;
+        upload.positionDataSize = prepared.positionDataSize;
+        upload.attributeData = prepared.streams.attributes.data();
+        upload.attributeDataSize = prepared.streams.attributes.size() * sizeof(PackedVertexAttributes);
+        upload.indexData = prepared.indexData;
+        upload.indexDataSize = prepared.indexDataSize;
+        upload.vertexCount = prepared.vertexCount;
+        upload.indexCount = prepared.indexCount;
+        upload.indexStride = prepared.indexStride;
+        if (isQuantized)
         {
-            OutputDebugStringA("Warning: Failed to map BLAS post-build info readback buffer.\n");
+            GetDequantizationTransform(prepared.streams.dequantization, upload.geometryTransform);
         }
+
+        meshIndices[i] = static_cast<uint32_t>(uploads.size());
+        uploads.push_back(std::move(upload));
     }
-    
-    // Read TLAS post-build info
+
+    std::erase_if(m_instances, [&](const SceneInstance& instance) { return meshIndices[instance.meshIndex] == INVALID_MESH; });
+    for (SceneInstance& instance : m_instances)
+    {
+        instance.meshIndex = meshIndices[instance.meshIndex];
+    }
+
+    UploadGeometry(uploads);
+
+    // Cache exactly what was uploaded for the next launch
+    if (m_isScenePackEnabled && !sourcePaths.empty() && !uploads.empty())
     {
-        D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_CURRENT_SIZE_DESC* pData = 
-        static_cast<D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_CURRENT_SIZE_DESC*>(m_readbackHeapManager.GetMappedPtr(m_tlasPostBuildInfoBufferOffset));
+        std::vector<ScenePackInstance> instances(m_instances.size());
+        for (size_t i = 0; i < m_instances.size(); ++i)
+        {
+            instances[i].meshIndex = m_instances[i].meshIndex;
+            memcpy(instances[i].transform, m_instances[i].transform, sizeof(instances[i].transform));
+        }
 
-        if (pData)
+        const std::string packPath = GetScenePackPath(m_scenePath);
+        ScenePackStats stats = {};
+        std::string error;
+        if (WriteScenePack(packPath.c_str(), GetScenePackSettingsHash(), sourcePaths, uploads, instances, *m_threadPool, &stats, &error))
         {
-            char debugMsg[256];
-            sprintf_s(debugMsg, "TLAS Current Size: %llu bytes (%.2f KB)\n", 
-                     pData->CurrentSizeInBytes,
-                     pData->CurrentSizeInBytes / 1024.0);
-            OutputDebugStringA(debugMsg);
+            OutputDebugStringA(std::format("Scene pack {} written: {:.1f} MB, {} sources, {:.3f} ms\n",
+                packPath, static_cast<double>(stats.fileSize) / (1024.0 * 1024.0), stats.numSources, stats.milliseconds).c_str());
         }
         else
         {
-            OutputDebugStringA("Warning: Failed to map TLAS post-build info readback buffer.\n");
+            OutputDebugStringA(std::format("Scene pack not written: {}\n", error).c_str());
         }
     }
 }
 
-void Scene::FreeTemporaryResources()
+void Scene::UploadGeometry(const std::vector<ScenePackMesh>& meshes)
 {
-    m_uploadTemporaryHeapManager.Free(m_vertexBufferOffset);
-    m_uploadTemporaryHeapManager.Free(m_indexBufferOffset);
-    m_uploadTemporaryHeapManager.Free(m_instanceDescBufferOffset);
+    // The geometry heap is sized for all meshes. Every allocation is rounded up to the element size.
+    const bool isQuantized = m_positionFormat == PositionFormat::Snorm16;
+    const uint32_t GEOMETRY_HEAP_ELEMENT_SIZE = 256;
+    uint64_t geometrySize = AlignSize(static_cast<uint64_t>(meshes.size()) * sizeof(MeshInfo), GEOMETRY_HEAP_ELEMENT_SIZE);
+    for (const ScenePackMesh& mesh : meshes)
+    {
+        geometrySize += AlignSize(mesh.positionDataSize, GEOMETRY_HEAP_ELEMENT_SIZE);
+        geometrySize += AlignSize(mesh.attributeDataSize, GEOMETRY_HEAP_ELEMENT_SIZE);
+        geometrySize += AlignSize(mesh.indexDataSize, GEOMETRY_HEAP_ELEMENT_SIZE);
+        geometrySize += isQuantized ? GEOMETRY_HEAP_ELEMENT_SIZE : 0;
+    }
 
-    m_defaultTemporaryHeapManager.Free(m_blasScratchBufferOffset);
-    m_defaultTemporaryHeapManager.Free(m_tlasScratchBufferOffset);
+    m_geometryHeapManager.Initialize(m_device, GetHeapElementCount(geometrySize, GEOMETRY_HEAP_ELEMENT_SIZE, 1024 * 16), GEOMETRY_HEAP_ELEMENT_SIZE,
+        D3D12_HEAP_TYPE_GPU_UPLOAD, D3D12_HEAP_FLAG_NONE, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COMMON, "Scene Geometry Heap");
 
-    m_readbackHeapManager.Free(m_blasPostBuildInfoBufferOffset);
-    m_readbackHeapManager.Free(m_tlasPostBuildInfoBufferOffset);
+    // Allocate on this thread so that the layout of the heap does not depend on the thread timing
+    m_meshes.clear();
+    m_meshes.reserve(meshes.size());
+    for (const ScenePackMesh& upload : meshes)
+    {
+        SceneMesh mesh = {};
+        mesh.name = upload.name;
+        mesh.vertexCount = upload.vertexCount;
+        mesh.indexCount = upload.indexCount;
+        mesh.indexStride = upload.indexStride;
+        mesh.vertexBufferOffset = m_geometryHeapManager.Allocate(static_cast<uint32_t>(upload.positionDataSize));
+        mesh.attributeBufferOffset = m_geometryHeapManager.Allocate(static_cast<uint32_t>(upload.attributeDataSize));
+        mesh.indexBufferOffset = m_geometryHeapManager.Allocate(static_cast<uint32_t>(upload.indexDataSize));
+
+        // The BLAS is built from the quantized positions with the dequantization as its geometry transform
+        if (isQuantized)
+        {
+            mesh.geometryTransformOffset = m_geometryHeapManager.Allocate(sizeof(float) * 12);
+        }
+        m_meshes.push_back(std::move(mesh));
+    }
+
+    if (m_meshes.empty())
+    {
+        return;
+    }
+    m_meshInfoOffset = m_geometryHeapManager.Allocate(static_cast<uint32_t>(m_meshes.size() * sizeof(MeshInfo)));
+
+    // Write the streams of the meshes in parallel, HeapManager::Write is thread safe
+    const auto uploadStartTime = std::chrono::steady_clock::now();
+    std::vector<MeshInfo> meshInfos(m_meshes.size());
+    m_threadPool->ParallelFor(static_cast<uint32_t>(m_meshes.size()), [&](uint32_t i)
+    {
+        const SceneMesh& mesh = m_meshes[i];
+        const ScenePackMesh& upload = meshes[i];
+
+        m_geometryHeapManager.Write(mesh.vertexBufferOffset, upload.positionData, static_cast<uint32_t>(upload.positionDataSize));
+        m_geometryHeapManager.Write(mesh.attributeBufferOffset, upload.attributeData, static_cast<uint32_t>(upload.attributeDataSize));
+        m_geometryHeapManager.Write(mesh.indexBufferOffset, upload.indexData, static_cast<uint32_t>(upload.indexDataSize));
+        if (isQuantized)
+        {
+            m_geometryHeapManager.Write(mesh.geometryTransformOffset, upload.geometryTransform, sizeof(upload.geometryTransform));
+        }
+
+        MeshInfo& meshInfo = meshInfos[i];
+        meshInfo.positionOffset = static_cast<uint32_t>(m_geometryHeapManager.GetResourceOffset(mesh.vertexBufferOffset));
+        meshInfo.positionFormat = static_cast<uint32_t>(m_positionFormat);
+        meshInfo.indexOffset = static_cast<uint32_t>(m_geometryHeapManager.GetResourceOffset(mesh.indexBufferOffset));
+        meshInfo.indexStride = mesh.indexStride;
+        meshInfo.attributeOffset = static_cast<uint32_t>(m_geometryHeapManager.GetResourceOffset(mesh.attributeBufferOffset));
+        meshInfo.colorFormat = static_cast<uint32_t>(m_colorFormat);
+        meshInfo.vertexCount = mesh.vertexCount;
+        meshInfo.primitiveCount = mesh.indexCount / 3;
+    });
+    m_geometryHeapManager.Write(m_meshInfoOffset, meshInfos.data(), static_cast<uint32_t>(meshInfos.size() * sizeof(MeshInfo)));
+
+    OutputDebugStringA(std::format("Geometry upload: {} meshes, {} instances, {:.1f} MB, {:.3f} ms\n",
+        m_meshes.size(), m_instances.size(), static_cast<double>(geometrySize) / (1024.0 * 1024.0), MillisecondsSince(uploadStartTime)).c_str());
+
+    DeduplicateBLAS(meshes);
+}
+
+void Scene::DeduplicateBLAS(const std::vector<ScenePackMesh>& meshes)
+{
+    // Classify the meshes with the policy. Only static meshes share a BLAS, a deforming or rebuilt mesh changes on its
+    // own.
+    std::vector<MeshUsage> usages(m_meshes.size());
+    for (size_t i = 0; i < m_meshes.size(); ++i)
+    {
+        int ruleIndex = -1;
+        usages[i] = m_asPolicy.Classify(m_meshes[i].name, &ruleIndex);
+        if (ruleIndex >= 0)
+        {
+            OutputDebugStringA(std::format("AS policy: mesh '{}' is {} (rule '{}')\n",
+                m_meshes[i].name, GetMeshUsageName(usages[i]), m_asPolicy.GetSettings().usageRules[ruleIndex].pattern).c_str());
+        }
+    }
+
+    // Static meshes whose BLAS build inputs are identical share one BLAS: the position and index streams, the counts
+    // and formats, the build flags and, for quantized positions, the geometry transform. Only the BLAS is shared, each
+    // mesh keeps its own streams and MeshInfo because the attributes may differ.
+    const auto startTime = std::chrono::steady_clock::now();
+    const bool isQuantized = m_positionFormat == PositionFormat::Snorm16;
+    std::vector<uint64_t> hashes(meshes.size());
+    if (m_isBLASDeduplicationEnabled)
+    {
+        m_threadPool->ParallelFor(static_cast<uint32_t>(meshes.size()), [&](uint32_t i)
+        {
+            const ScenePackMesh& mesh = meshes[i];
+            uint64_t hash = HashCombine(static_cast<uint64_t>(m_positionFormat), m_asPolicy.GetBuildFlags(usages[i]));
+            hash = HashCombine(hash, (static_cast<uint64_t>(mesh.vertexCount) << 32) | mesh.indexCount);
+            hash = HashCombine(hash, mesh.indexStride);
+            hash = Hash64(mesh.positionData, mesh.positionDataSize, hash);
+            hash = Hash64(mesh.indexData, mesh.indexDataSize, hash);
+            if (isQuantized)
+            {
+                hash = Hash64(mesh.geometryTransform, sizeof(mesh.geometryTransform), hash);
+            }
+            hashes[i] = hash;
+        });
+    }
+
+    // Equal hashes are confirmed by comparing the data, a collision must not share a BLAS of different geometry
+    auto isSameGeometry = [&](const ScenePackMesh& a, const ScenePackMesh& b)
+    {
+        return a.vertexCount == b.vertexCount && a.indexCount == b.indexCount && a.indexStride == b.indexStride &&
+            a.positionDataSize == b.positionDataSize && a.indexDataSize == b.indexDataSize &&
+            memcmp(a.positionData, b.positionData, a.positionDataSize) == 0 &&
+            memcmp(a.indexData, b.indexData, a.indexDataSize) == 0 &&
+            (!isQuantized || memcmp(a.geometryTransform, b.geometryTransform, sizeof(a.geometryTransform)) == 0);
+    };
+
+    m_blases.clear();
+    m_hasUpdatableBLAS = false;
+    uint32_t numUsageBLASes[3] = {};
+    std::unordered_multimap<uint64_t, uint32_t> blasIndices;
+    for (uint32_t i = 0; i < static_cast<uint32_t>(m_meshes.size()); ++i)
+    {
+        const bool isShareable = m_isBLASDeduplicationEnabled && usages[i] == MeshUsage::Static;
+        uint32_t blasIndex = static_cast<uint32_t>(m_blases.size());
+        if (isShareable)
+        {
+            const auto range = blasIndices.equal_range(hashes[i]);
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                if (isSameGeometry(meshes[m_blases[it->second].meshIndex], meshes[i]))
+                {
+                    blasIndex = it->second;
+                    break;
+                }
+            }
+        }
+
+        if (blasIndex == m_blases.size())
+        {
+            SceneBLAS blas = {};
+            blas.meshIndex = i;
+            blas.usage = usages[i];
+            blas.buildFlags = m_asPolicy.GetBuildFlags(usages[i]);
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                blas.positionScale[c] = isQuantized ? meshes[i].geometryTransform[c * 5] / 32767.0f : 1.0f;
+            }
+
+            // The refit heuristic compares the bounds of the updates with the bounds of the last build
+            if (blas.usage != MeshUsage::Static)
+            {
+                blas.updateState.builtSurfaceArea = GetPositionSurfaceArea(meshes[i].positionData, meshes[i].vertexCount, m_positionFormat, blas.positionScale);
+                m_hasUpdatableBLAS = true;
+            }
+
+            m_blases.push_back(blas);
+            numUsageBLASes[static_cast<uint32_t>(blas.usage)]++;
+            if (isShareable)
+            {
+                blasIndices.emplace(hashes[i], blasIndex);
+            }
+        }
+        m_blases[blasIndex].refCount++;
+        m_meshes[i].blasIndex = blasIndex;
+    }
+
+    if (m_isBLASDeduplicationEnabled)
+    {
+        OutputDebugStringA(std::format("BLAS deduplication: {} meshes -> {} BLASes, {:.3f} ms\n",
+            m_meshes.size(), m_blases.size(), MillisecondsSince(startTime)).c_str());
+    }
+    OutputDebugStringA(std::format("AS policy: {} static BLASes ({}), {} deforming (refit, rebuild after {} refits or {:.2f}x surface area), {} rebuilt (fast build)\n",
+        numUsageBLASes[static_cast<uint32_t>(MeshUsage::Static)], m_asPolicy.GetSettings().compactStatic ? "compacted" : "not compacted",
+        numUsageBLASes[static_cast<uint32_t>(MeshUsage::Deforming)], m_asPolicy.GetSettings().maxRefitsBeforeRebuild,
+        m_asPolicy.GetSettings().maxSurfaceAreaGrowth, numUsageBLASes[static_cast<uint32_t>(MeshUsage::Rebuilt)]).c_str());
+}
+
+void Scene::ReleaseBLAS(uint32_t blasIndex)
+{
+    SceneBLAS& blas = m_blases[blasIndex];
+    if (blas.refCount > 0 && --blas.refCount == 0)
+    {
+        m_ASHeapManager.Free(blas.bottomLevelASOffset);
+        blas.bottomLevelASOffset = 0;
+    }
+}
+
+bool Scene::LoadScenePack(ScenePack& scenePack)
+{
+    if (!m_isScenePackEnabled || m_scenePath.empty() || m_isProcedural)
+    {
+        return false;
+    }
+
+    const auto startTime = std::chrono::steady_clock::now();
+    const std::string packPath = GetScenePackPath(m_scenePath);
+    ScenePackStats stats = {};
+    std::string error;
+    if (!scenePack.Open(packPath.c_str(), GetScenePackSettingsHash(), *m_threadPool, &stats, &error))
+    {
+        OutputDebugStringA(std::format("Scene pack {} not used: {}\n", packPath, error).c_str());
+        return false;
+    }
+    OutputDebugStringA(std::format("Scene pack {}: {:.1f} MB, {} meshes, {} instances, {} of {} sources hashed, opened in {:.3f} ms\n",
+        packPath, static_cast<double>(stats.fileSize) / (1024.0 * 1024.0), stats.numMeshes, stats.numInstances,
+        stats.numHashedSources, stats.numSources, stats.milliseconds).c_str());
+
+    m_instances.resize(scenePack.GetInstances().size());
+    for (size_t i = 0; i < m_instances.size(); ++i)
+    {
+        m_instances[i].meshIndex = scenePack.GetInstances()[i].meshIndex;
+        memcpy(m_instances[i].transform, scenePack.GetInstances()[i].transform, sizeof(m_instances[i].transform));
+    }
+
+    // The streams are copied from the mapped pages into the geometry heap
+    UploadGeometry(scenePack.GetMeshes());
+    OutputDebugStringA(std::format("Scene loaded from the pack in {:.3f} ms ({:.2f} GB/s)\n", MillisecondsSince(startTime),
+        static_cast<double>(stats.dataSize) / 1.0e9 / (std::max(MillisecondsSince(startTime), 1.0e-3) / 1000.0)).c_str());
+    return true;
+}
+
+uint64_t Scene::GetScenePackSettingsHash() const
+{
+    // Everything the uploaded streams and the instance transforms depend on besides the source files
+    uint64_t hash = HashCombine(SCENE_STREAM_VERSION, static_cast<uint64_t>(m_positionFormat));
+    hash = HashCombine(hash, static_cast<uint64_t>(m_colorFormat));
+    hash = HashCombine(hash, m_meshPreprocessOptions.weldVertices);
+    hash = HashCombine(hash, m_meshPreprocessOptions.optimizeTriangleOrder);
+    hash = HashCombine(hash, m_meshPreprocessOptions.allow16BitIndices);
+    hash = HashCombine(hash, std::bit_cast<uint32_t>(SCENE_FIT_SIZE));
+    return hash;
+}
+
+D3D12_RAYTRACING_GEOMETRY_DESC Scene::GetGeometryDesc(const SceneMesh& mesh) const
+{
+    D3D12_RAYTRACING_GEOMETRY_DESC geometryDesc = {};
+    geometryDesc.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
+    const bool isQuantized = m_positionFormat == PositionFormat::Snorm16;
+    geometryDesc.Triangles.VertexBuffer.StartAddress = m_geometryHeapManager.GetGPUVirtualAddress(mesh.vertexBufferOffset);
+    geometryDesc.Triangles.VertexBuffer.StrideInBytes = isQuantized ? sizeof(int16_t) * 4 : sizeof(float) * 3;  // Tightly packed position stream
+    geometryDesc.Triangles.VertexCount = mesh.vertexCount;
+    geometryDesc.Triangles.VertexFormat = isQuantized ? DXGI_FORMAT_R16G16B16A16_SNORM : DXGI_FORMAT_R32G32B32_FLOAT;
+    geometryDesc.Triangles.IndexBuffer = m_geometryHeapManager.GetGPUVirtualAddress(mesh.indexBufferOffset);
+    geometryDesc.Triangles.IndexCount = mesh.indexCount;
+    geometryDesc.Triangles.IndexFormat = mesh.indexStride == sizeof(uint16_t) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+    geometryDesc.Triangles.Transform3x4 = isQuantized ? m_geometryHeapManager.GetGPUVirtualAddress(mesh.geometryTransformOffset) : 0;  // Dequantization
+    geometryDesc.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE;
+    return geometryDesc;
+}
+
+void Scene::BuildSceneGraph()
+{
+    // A root node with one child per instance. The root moves the whole scene.
+    std::vector<SceneGraphNodeDesc> descs(m_instances.size() + 1);
+    descs[0].parent = SceneGraph::INVALID_NODE;
+    XMStoreFloat3x4(&descs[0].localTransform, XMMatrixIdentity());
+    for (size_t i = 0; i < m_instances.size(); ++i)
+    {
+        descs[i + 1].parent = 0;
+        memcpy(&descs[i + 1].localTransform, m_instances[i].transform, sizeof(descs[i + 1].localTransform));
+    }
+
+    std::vector<uint32_t> nodeIndices;
+    if (!m_sceneGraph.Build(descs, nodeIndices))
+    {
+        OutputDebugStringA("Error: Failed to build the scene graph.\n");
+        return;
+    }
+
+    // The children follow the root in desc order, so the instance nodes are sorted
+    m_sceneGraph.SetInstanceNodes(std::vector<uint32_t>(nodeIndices.begin() + 1, nodeIndices.end()));
+}
+
+void Scene::ComputeAccelerationStructureSizes()
+{
+    static_assert(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT <= AS_HEAP_ELEMENT_SIZE, "Acceleration structures must be aligned by the heap elements");
+
+    // The prebuild info only depends on the counts, formats and flags, so every size is known before the heaps are
+    // created
+    uint64_t blasSize = 0;
+    uint64_t blasScratchSize = 0;
+    uint64_t blasUpdateScratchSize = 0;
+    uint64_t builtTriangleCount = 0;
+    uint64_t triangleCount = 0;
+    uint64_t undeduplicatedResultDataSize = 0;
+    uint64_t undeduplicatedScratchSize = 0;
+    bool isCompacting = false;
+    m_blasResultDataMaxSize = 0;
+    for (SceneBLAS& blas : m_blases)
+    {
+        const D3D12_RAYTRACING_GEOMETRY_DESC geometryDesc = GetGeometryDesc(m_meshes[blas.meshIndex]);
+
+        D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs = {};
+        inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
+        inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+        inputs.NumDescs = 1;
+        inputs.pGeometryDescs = &geometryDesc;
+        inputs.Flags = static_cast<D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS>(blas.buildFlags);
+        m_device->GetRaytracingAccelerationStructurePrebuildInfo(&inputs, &blas.prebuildInfo);
+
+        blas.scratchOffset = blasScratchSize;
+        const uint64_t scratchDataSize = AlignSize(blas.prebuildInfo.ScratchDataSizeInBytes, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT);
+        blasScratchSize += scratchDataSize;
+        blasSize += AlignSize(blas.prebuildInfo.ResultDataMaxSizeInBytes, AS_HEAP_ELEMENT_SIZE);
+        m_blasResultDataMaxSize += blas.prebuildInfo.ResultDataMaxSizeInBytes;
+        isCompacting |= (blas.buildFlags & AccelerationStructureBuildFlags::ALLOW_COMPACTION) != 0;
+
+        // An update is a refit or a rebuild, its scratch memory must hold either
+        if (blas.usage != MeshUsage::Static)
+        {
+            blas.updateScratchOffset = blasUpdateScratchSize;
+            blasUpdateScratchSize += AlignSize(std::max(blas.prebuildInfo.ScratchDataSizeInBytes, blas.prebuildInfo.UpdateScratchDataSizeInBytes),
+                D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT);
+        }
+
+        // What the meshes sharing this BLAS would cost with a BLAS each
+        const uint64_t blasTriangleCount = m_meshes[blas.meshIndex].indexCount / 3;
+        builtTriangleCount += blasTriangleCount;
+        triangleCount += blasTriangleCount * blas.refCount;
+        undeduplicatedResultDataSize += blas.prebuildInfo.ResultDataMaxSizeInBytes * blas.refCount;
+        undeduplicatedScratchSize += scratchDataSize * blas.refCount;
+    }
+
+    // The instance descs are not read by the prebuild info
+    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS tlasInputs = {};
+    tlasInputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL;
+    tlasInputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+    tlasInputs.NumDescs = static_cast<UINT>(m_instances.size());
+    tlasInputs.Flags = TLAS_BUILD_FLAGS;
+    m_device->GetRaytracingAccelerationStructurePrebuildInfo(&tlasInputs, &m_tlasPrebuildInfo);
+
+    // Print prebuild info
+    {
+        OutputDebugStringA(std::format("BLAS Prebuild Info: {} meshes, {} BLASes\n", m_meshes.size(), m_blases.size()).c_str());
+        OutputDebugStringA(std::format("Scratch Data Size: {} bytes\n", blasScratchSize).c_str());
+        OutputDebugStringA(std::format("Result Data Max Size: {} bytes\n", m_blasResultDataMaxSize).c_str());
+    }
+
+    // The build time scales with the triangles built, the memory with the result and scratch sizes
+    if (m_blases.size() < m_meshes.size())
+    {
+        OutputDebugStringA(std::format("BLAS deduplication: {:.2f}x fewer BLASes, {} of {} triangles built, result data {:.2f} of {:.2f} MB, scratch {:.2f} of {:.2f} MB\n",
+            static_cast<double>(m_meshes.size()) / static_cast<double>(m_blases.size()), builtTriangleCount, triangleCount,
+            static_cast<double>(m_blasResultDataMaxSize) / (1024.0 * 1024.0), static_cast<double>(undeduplicatedResultDataSize) / (1024.0 * 1024.0),
+            static_cast<double>(blasScratchSize) / (1024.0 * 1024.0), static_cast<double>(undeduplicatedScratchSize) / (1024.0 * 1024.0)).c_str());
+    }
+
+    const uint64_t asSize = blasSize + AlignSize(m_tlasPrebuildInfo.ResultDataMaxSizeInBytes, AS_HEAP_ELEMENT_SIZE) * TLAS_BUFFER_COUNT;
+    const uint64_t scratchSize = blasScratchSize + blasUpdateScratchSize +
+        AlignSize(m_tlasPrebuildInfo.ScratchDataSizeInBytes, AS_HEAP_ELEMENT_SIZE);
+    const uint64_t instanceDescSize = m_instances.size() * sizeof(D3D12_RAYTRACING_INSTANCE_DESC);
+
+    // Current and compacted size of every BLAS, current size of the TLAS
+    const uint64_t postBuildInfoSize = (m_blases.size() * 2 + 1) * sizeof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_CURRENT_SIZE_DESC);
+    const uint64_t readbackSize = AlignSize(postBuildInfoSize, AS_HEAP_ELEMENT_SIZE) + 3 * AS_HEAP_ELEMENT_SIZE;
+
+    // With compaction the BLASes are built in a temporary heap, the AS heap is created for the compacted sizes
+    if (isCompacting)
+    {
+        m_ASBuildHeapManager = std::make_unique<HeapManager>();
+        m_ASBuildHeapManager->Initialize(m_device, GetHeapElementCount(blasSize, AS_HEAP_ELEMENT_SIZE, 1024 * 10), AS_HEAP_ELEMENT_SIZE, D3D12_HEAP_TYPE_DEFAULT, D3D12_HEAP_FLAG_NONE, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, "AS Build Heap", false);
+    }
+    else
+    {
+        m_ASHeapManager.Initialize(m_device, GetHeapElementCount(asSize, AS_HEAP_ELEMENT_SIZE, 1024 * 10), AS_HEAP_ELEMENT_SIZE, D3D12_HEAP_TYPE_DEFAULT, D3D12_HEAP_FLAG_NONE, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, "AS Heap", false);
+    }
+    m_defaultTemporaryHeapManager.Initialize(m_device, GetHeapElementCount(scratchSize, AS_HEAP_ELEMENT_SIZE, 1024 * 10), AS_HEAP_ELEMENT_SIZE, D3D12_HEAP_TYPE_DEFAULT, D3D12_HEAP_FLAG_NONE, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON, "Scene Default temporary Heap");
+    m_uploadTemporaryHeapManager.Initialize(m_device, GetHeapElementCount(instanceDescSize, AS_HEAP_ELEMENT_SIZE, 1024 * 10), AS_HEAP_ELEMENT_SIZE, D3D12_HEAP_TYPE_GPU_UPLOAD, D3D12_HEAP_FLAG_NONE, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COMMON, "Scene Upload temporary Heap");
+    m_readbackHeapManager.Initialize(m_device, GetHeapElementCount(readbackSize, AS_HEAP_ELEMENT_SIZE, 32 * 1024), AS_HEAP_ELEMENT_SIZE, "SceneReadback Heap");
+}
+
+void Scene::CreateBottomLevelAS(ID3D12GraphicsCommandList4* commandList)
+{
+    // Check that we have created geometry
+    if (m_blases.empty())
+    {
+        OutputDebugStringA("Error: Create geometry before building acceleration structures.\n");
+        return;
+    }
+
+    // Allocate the shared scratch buffer, and the scratch buffer of the updates
+    const SceneBLAS& lastBLAS = m_blases.back();
+    const uint64_t scratchSize = lastBLAS.scratchOffset + AlignSize(lastBLAS.prebuildInfo.ScratchDataSizeInBytes, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT);
+    m_blasScratchBufferOffset = m_defaultTemporaryHeapManager.Allocate(static_cast<uint32_t>(scratchSize));
+
+    uint64_t updateScratchSize = 0;
+    for (const SceneBLAS& blas : m_blases)
+    {
+        if (blas.usage != MeshUsage::Static)
+        {
+            updateScratchSize = blas.updateScratchOffset + AlignSize(std::max(blas.prebuildInfo.ScratchDataSizeInBytes, blas.prebuildInfo.UpdateScratchDataSizeInBytes),
+                D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT);
+        }
+    }
+    if (updateScratchSize > 0)
+    {
+        m_blasUpdateScratchBufferOffset = m_defaultTemporaryHeapManager.Allocate(static_cast<uint32_t>(updateScratchSize));
+    }
+
+    // Allocate BLAS buffers, in the build heap when they are compacted afterwards
+    HeapManager& buildHeapManager = m_ASBuildHeapManager ? *m_ASBuildHeapManager : m_ASHeapManager;
+    for (SceneBLAS& blas : m_blases)
+    {
+        const uint32_t offset = buildHeapManager.Allocate(static_cast<uint32_t>(blas.prebuildInfo.ResultDataMaxSizeInBytes));
+        (m_ASBuildHeapManager ? blas.buildOffset : blas.bottomLevelASOffset) = offset;
+    }
+
+    // Create post-build info buffers for the BLASes (must be UAV-compatible)
+    const uint32_t postBuildInfoSize = static_cast<uint32_t>(m_blases.size() * sizeof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_CURRENT_SIZE_DESC));
+    m_blasPostBuildInfoBufferOffset = m_readbackHeapManager.Allocate(postBuildInfoSize);
+    if (m_ASBuildHeapManager)
+    {
+        static_assert(sizeof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC) == sizeof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_CURRENT_SIZE_DESC),
+            "The compacted sizes are read back like the current sizes");
+        m_blasCompactedSizeBufferOffset = m_readbackHeapManager.Allocate(postBuildInfoSize);
+    }
+
+    // Transition buffers to UAV state
+    m_defaultTemporaryHeapManager.Transition(commandList, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    buildHeapManager.Transition(commandList, D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE);
+
+    m_readbackHeapManager.GPUWriteBegin(commandList);
+
+    // Build BLASes. They do not share memory, so there is no barrier between them and the GPU can overlap the builds.
+    commandList->EndQuery(m_timestampQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, TimestampQueries::BLASBuildBegin);
+    for (size_t i = 0; i < m_blases.size(); ++i)
+    {
+        const SceneBLAS& blas = m_blases[i];
+
+        D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC postBuildInfoDescs[2] = {};
+        postBuildInfoDescs[0].InfoType = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_CURRENT_SIZE;
+        postBuildInfoDescs[0].DestBuffer = m_readbackHeapManager.GetGPUVirtualAddress(m_blasPostBuildInfoBufferOffset) +
+            i * sizeof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_CURRENT_SIZE_DESC);
+        postBuildInfoDescs[1].InfoType = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE;
+        postBuildInfoDescs[1].DestBuffer = m_readbackHeapManager.GetGPUVirtualAddress(m_blasCompactedSizeBufferOffset) +
+            i * sizeof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC);
+        const bool isCompacted = (blas.buildFlags & AccelerationStructureBuildFlags::ALLOW_COMPACTION) != 0;
+
+        BuildBottomLevelAS(commandList, blas, buildHeapManager.GetGPUVirtualAddress(m_ASBuildHeapManager ? blas.buildOffset : blas.bottomLevelASOffset),
+            m_defaultTemporaryHeapManager.GetGPUVirtualAddress(m_blasScratchBufferOffset) + blas.scratchOffset, false, postBuildInfoDescs, isCompacted ? 2 : 1);
+    }
+
+    // Insert UAV barriers to ensure BLAS and post-build info writes complete
+    m_defaultTemporaryHeapManager.UAVBarrier(commandList);
+    buildHeapManager.UAVBarrier(commandList);
+    commandList->EndQuery(m_timestampQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, TimestampQueries::BLASBuildEnd);
+
+    OutputDebugStringA(std::format("{} Bottom Level Acceleration Structures created successfully.\n", m_blases.size()).c_str());
+}
+
+void Scene::BuildBottomLevelAS(ID3D12GraphicsCommandList4* commandList, const SceneBLAS& blas, D3D12_GPU_VIRTUAL_ADDRESS destination,
+    D3D12_GPU_VIRTUAL_ADDRESS scratch, bool isRefit, const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC* postBuildInfoDescs,
+    uint32_t numPostBuildInfoDescs)
+{
+    const D3D12_RAYTRACING_GEOMETRY_DESC geometryDesc = GetGeometryDesc(m_meshes[blas.meshIndex]);
+
+    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildDesc = {};
+    buildDesc.Inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
+    buildDesc.Inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+    buildDesc.Inputs.NumDescs = 1;
+    buildDesc.Inputs.pGeometryDescs = &geometryDesc;
+    buildDesc.Inputs.Flags = static_cast<D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS>(blas.buildFlags);
+    buildDesc.DestAccelerationStructureData = destination;
+    buildDesc.ScratchAccelerationStructureData = scratch;
+
+    // A refit updates the BLAS in place
+    if (isRefit)
+    {
+        buildDesc.Inputs.Flags |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE;
+        buildDesc.SourceAccelerationStructureData = destination;
+    }
+
+    commandList->BuildRaytracingAccelerationStructure(&buildDesc, numPostBuildInfoDescs, postBuildInfoDescs);
+}
+
+void Scene::CompactBottomLevelAS(ID3D12GraphicsCommandList4* commandList)
+{
+    // The AS heap holds the compacted BLASes, the BLASes which are not compacted are copied with their size from the
+    // prebuild info, and the TLAS
+    auto isCompacted = [](const SceneBLAS& blas)
+    {
+        return (blas.buildFlags & AccelerationStructureBuildFlags::ALLOW_COMPACTION) != 0 && blas.compactedSize > 0;
+    };
+    uint64_t asSize = AlignSize(m_tlasPrebuildInfo.ResultDataMaxSizeInBytes, AS_HEAP_ELEMENT_SIZE) * TLAS_BUFFER_COUNT;
+    for (const SceneBLAS& blas : m_blases)
+    {
+        asSize += AlignSize(isCompacted(blas) ? blas.compactedSize : blas.prebuildInfo.ResultDataMaxSizeInBytes, AS_HEAP_ELEMENT_SIZE);
+    }
+    m_ASHeapManager.Initialize(m_device, GetHeapElementCount(asSize, AS_HEAP_ELEMENT_SIZE, 1024 * 10), AS_HEAP_ELEMENT_SIZE, D3D12_HEAP_TYPE_DEFAULT, D3D12_HEAP_FLAG_NONE, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, "AS Heap", false);
+
+    uint32_t numCompacted = 0;
+    uint64_t uncompactedSize = 0;
+    uint64_t currentSize = 0;
+    m_blasResultDataMaxSize = 0;
+    for (SceneBLAS& blas : m_blases)
+    {
+        const bool compact = isCompacted(blas);
+        const uint64_t size = compact ? blas.compactedSize : blas.prebuildInfo.ResultDataMaxSizeInBytes;
+        blas.bottomLevelASOffset = m_ASHeapManager.Allocate(static_cast<uint32_t>(size));
+        commandList->CopyRaytracingAccelerationStructure(m_ASHeapManager.GetGPUVirtualAddress(blas.bottomLevelASOffset),
+            m_ASBuildHeapManager->GetGPUVirtualAddress(blas.buildOffset),
+            compact ? D3D12_RAYTRACING_ACCELERATION_STRUCTURE_COPY_MODE_COMPACT : D3D12_RAYTRACING_ACCELERATION_STRUCTURE_COPY_MODE_CLONE);
+
+        numCompacted += compact;
+        uncompactedSize += blas.currentSize;
+        currentSize += compact ? blas.compactedSize : blas.currentSize;
+        m_blasResultDataMaxSize += size;
+    }
+    m_ASHeapManager.UAVBarrier(commandList);
+
+    OutputDebugStringA(std::format("BLAS compaction: {} of {} BLASes compacted, {:.2f} MB -> {:.2f} MB\n", numCompacted, m_blases.size(),
+        static_cast<double>(uncompactedSize) / (1024.0 * 1024.0), static_cast<double>(currentSize) / (1024.0 * 1024.0)).c_str());
+    HeapRegistry::Instance().SetResourceSize("BLAS", currentSize, m_blasResultDataMaxSize);
+}
+
+void Scene::CreateTopLevelAS(ID3D12GraphicsCommandList4* commandList)
+{
+    // Check that we have created BLAS
+    if (m_blases.empty() || m_blases[0].bottomLevelASOffset == 0)
+    {
+        OutputDebugStringA("Error: Create BLAS before building TLAS.\n");
+        return;
+    }
+
+    // Create instance description buffer, instances of the same mesh and meshes of the same geometry share a BLAS.
+    // The descs are kept for the updates of the instance transforms.
+    {
+        std::vector<D3D12_RAYTRACING_INSTANCE_DESC>& instanceDescs = m_instanceDescs;
+        instanceDescs.resize(m_instances.size());
+        for (size_t i = 0; i < m_instances.size(); ++i)
+        {
+            const SceneInstance& instance = m_instances[i];
+            D3D12_RAYTRACING_INSTANCE_DESC& instanceDesc = instanceDescs[i];
+            instanceDesc.InstanceID = instance.meshIndex;  // Index of the MeshInfo read by the closest hit shader
+            instanceDesc.InstanceMask = 0xFF;  // Visible to all rays
+            instanceDesc.InstanceContributionToHitGroupIndex = 0;
+            instanceDesc.Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
+            instanceDesc.AccelerationStructure = m_ASHeapManager.GetGPUVirtualAddress(m_blases[m_meshes[instance.meshIndex].blasIndex].bottomLevelASOffset);
+            memcpy(instanceDesc.Transform, &m_sceneGraph.GetInstanceWorldTransform(static_cast<uint32_t>(i)), sizeof(instanceDesc.Transform));
+        }
+
+        // Upload instance descriptions to GPU
+        const uint32_t instanceDescSize = static_cast<uint32_t>(instanceDescs.size() * sizeof(D3D12_RAYTRACING_INSTANCE_DESC));
+        m_instanceDescBufferOffset = m_uploadTemporaryHeapManager.Allocate(instanceDescSize);
+        m_uploadTemporaryHeapManager.Write(m_instanceDescBufferOffset, instanceDescs.data(), instanceDescSize);
+    }
+
+    // Allocate scratch buffer
+    m_tlasScratchBufferOffset = m_defaultTemporaryHeapManager.Allocate(static_cast<uint32_t>(m_tlasPrebuildInfo.ScratchDataSizeInBytes));
+
+    // Allocate TLAS buffers
+    for (uint32_t i = 0; i < TLAS_BUFFER_COUNT; ++i)
+    {
+        m_topLevelASOffsets[i] = m_ASHeapManager.Allocate(static_cast<uint32_t>(m_tlasPrebuildInfo.ResultDataMaxSizeInBytes));
+    }
+    m_tlasResultDataMaxSize = m_tlasPrebuildInfo.ResultDataMaxSizeInBytes * TLAS_BUFFER_COUNT;
+
+    // Create post-build info buffer for TLAS (must be UAV-compatible)
+    m_tlasPostBuildInfoBufferOffset = m_readbackHeapManager.Allocate(sizeof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_CURRENT_SIZE_DESC));
+
+    m_defaultTemporaryHeapManager.Transition(commandList, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    m_ASHeapManager.Transition(commandList, D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE);
+    m_readbackHeapManager.GPUWriteBegin(commandList);
+
+    // Build TLAS
+    D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC postBuildInfoDesc = {};
+    postBuildInfoDesc.InfoType = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_CURRENT_SIZE;
+    postBuildInfoDesc.DestBuffer = m_readbackHeapManager.GetGPUVirtualAddress(m_tlasPostBuildInfoBufferOffset);
+    BuildTopLevelAS(commandList, 0, &postBuildInfoDesc);
+
+    OutputDebugStringA("Top Level Acceleration Structure created successfully.\n");
+}
+
+void Scene::BuildTopLevelAS(ID3D12GraphicsCommandList4* commandList, uint32_t tlasIndex, const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC* postBuildInfoDesc)
+{
+    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildDesc = {};
+    buildDesc.Inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL;
+    buildDesc.Inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+    buildDesc.Inputs.NumDescs = static_cast<UINT>(m_instances.size());
+    buildDesc.Inputs.InstanceDescs = m_uploadTemporaryHeapManager.GetGPUVirtualAddress(m_instanceDescBufferOffset);
+    buildDesc.Inputs.Flags = TLAS_BUILD_FLAGS;
+    buildDesc.DestAccelerationStructureData = m_ASHeapManager.GetGPUVirtualAddress(m_topLevelASOffsets[tlasIndex]);
+    buildDesc.ScratchAccelerationStructureData = m_defaultTemporaryHeapManager.GetGPUVirtualAddress(m_tlasScratchBufferOffset);
+
+    commandList->BuildRaytracingAccelerationStructure(&buildDesc, postBuildInfoDesc ? 1 : 0, postBuildInfoDesc);
+
+    // Insert UAV barriers to ensure TLAS and post-build info writes complete
+    m_defaultTemporaryHeapManager.UAVBarrier(commandList);
+    m_ASHeapManager.UAVBarrier(commandList);
+}
+
+void Scene::UpdateDeformedMeshes(const std::vector<MeshDeformation>& deformations)
+{
+    if (!m_isBuilt || !m_hasUpdatableBLAS)
+    {
+        OutputDebugStringA("Error: The scene has no deforming or rebuilt mesh to update.\n");
+        return;
+    }
+
+    // The positions are written in place, the CPU waits for the frames and builds reading the previous ones
+    BeginHostWrite(GeometryResource);
+
+    ID3D12GraphicsCommandList4* commandList = m_computeCommandList.Get();
+    const uint32_t positionStride = m_positionFormat == PositionFormat::Snorm16 ? sizeof(int16_t) * 4 : sizeof(float) * 3;
+    m_defaultTemporaryHeapManager.Transition(commandList, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+    // The BLASes have their own scratch memory, there is no barrier between the updates
+    for (const MeshDeformation& deformation : deformations)
+    {
+        const SceneMesh& mesh = m_meshes[deformation.meshIndex];
+        SceneBLAS& blas = m_blases[mesh.blasIndex];
+        if (blas.usage == MeshUsage::Static)
+        {
+            OutputDebugStringA(std::format("Warning: Mesh '{}' is static, its deformation is ignored.\n", mesh.name).c_str());
+            continue;
+        }
+
+        m_geometryHeapManager.Write(mesh.vertexBufferOffset, deformation.positionData, mesh.vertexCount * positionStride);
+
+        // Rebuilds of deforming BLASes are logged for tuning the policy
+        const float surfaceArea = GetPositionSurfaceArea(deformation.positionData, mesh.vertexCount, m_positionFormat, blas.positionScale);
+        const BLASUpdateState previousState = blas.updateState;
+        BLASRebuildReason reason = BLASRebuildReason::None;
+        const BLASUpdate update = m_asPolicy.DecideUpdate(blas.usage, blas.updateState, surfaceArea, &reason);
+        if (update == BLASUpdate::Rebuild && reason != BLASRebuildReason::Usage)
+        {
+            OutputDebugStringA(std::format("AS policy: rebuild '{}' after {} refits ({}, surface area {:.2f}x of the last build)\n",
+                mesh.name, previousState.refitCount, GetBLASRebuildReasonName(reason),
+                previousState.builtSurfaceArea > 0.0f ? surfaceArea / previousState.builtSurfaceArea : 1.0f).c_str());
+        }
+
+        BuildBottomLevelAS(commandList, blas, m_ASHeapManager.GetGPUVirtualAddress(blas.bottomLevelASOffset),
+            m_defaultTemporaryHeapManager.GetGPUVirtualAddress(m_blasUpdateScratchBufferOffset) + blas.updateScratchOffset,
+            update == BLASUpdate::Refit, nullptr, 0);
+    }
+    m_geometryHeapManager.FlushTrackedWrites();
+
+    // The TLAS build reads the updated BLASes
+    m_ASHeapManager.UAVBarrier(commandList);
+    RebuildTopLevelAS(true);
+}
+
+void Scene::UpdateInstanceTransforms()
+{
+    if (!m_isBuilt || !m_sceneGraph.IsDirty())
+    {
+        return;
+    }
+
+    const auto updateStartTime = std::chrono::steady_clock::now();
+    std::vector<SceneGraphInstanceRange> changedInstances;
+    const uint32_t numUpdatedNodes = m_sceneGraph.Update(*m_threadPool, changedInstances);
+    if (changedInstances.empty())
+    {
+        return;
+    }
+
+    // The instance descs are written in place, the CPU waits for the TLAS build reading them
+    BeginHostWrite(InstanceDescResource);
+
+    // Only the transforms of the changed instances are written, one contiguous write per range
+    uint32_t numChangedInstances = 0;
+    for (const SceneGraphInstanceRange& range : changedInstances)
+    {
+        for (uint32_t i = range.begin; i < range.end; ++i)
+        {
+            memcpy(m_instanceDescs[i].Transform, &m_sceneGraph.GetInstanceWorldTransform(i), sizeof(m_instanceDescs[i].Transform));
+        }
+        m_uploadTemporaryHeapManager.Write(m_instanceDescBufferOffset + range.begin * static_cast<uint32_t>(sizeof(D3D12_RAYTRACING_INSTANCE_DESC)),
+            &m_instanceDescs[range.begin], (range.end - range.begin) * static_cast<uint32_t>(sizeof(D3D12_RAYTRACING_INSTANCE_DESC)));
+        numChangedInstances += range.end - range.begin;
+    }
+    m_uploadTemporaryHeapManager.FlushTrackedWrites();
+
+    RebuildTopLevelAS(false);
+
+    OutputDebugStringA(std::format("Instance update: {} of {} nodes, {} of {} instances in {} ranges, {:.3f} ms\n", numUpdatedNodes,
+        m_sceneGraph.GetNodeCount(), numChangedInstances, m_instances.size(), changedInstances.size(), MillisecondsSince(updateStartTime)).c_str());
+}
+
+void Scene::RebuildTopLevelAS(bool hasBLASUpdates)
+{
+    // The TLAS is built into the buffer the frames are not reading, so the compute queue only waits for the frames
+    // which read that buffer before, and for the frames which read the BLASes when they are updated in place
+    ID3D12GraphicsCommandList4* commandList = m_computeCommandList.Get();
+    const uint32_t tlasIndex = (m_currentTLASIndex + 1) % TLAS_BUFFER_COUNT;
+    m_defaultTemporaryHeapManager.Transition(commandList, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    BuildTopLevelAS(commandList, tlasIndex, nullptr);
+
+    std::vector<QueueWait> waits;
+    UpdateCompletedValues();
+    m_queueSync.GetWaitsBeforeRead(ComputeQueue, InstanceDescResource, waits);
+    m_queueSync.GetWaitsBeforeWrite(ComputeQueue, TLASResource + tlasIndex, waits);
+    if (hasBLASUpdates)
+    {
+        m_queueSync.GetWaitsBeforeRead(ComputeQueue, GeometryResource, waits);
+        m_queueSync.GetWaitsBeforeWrite(ComputeQueue, BLASResource, waits);
+    }
+
+    const uint64_t fenceValue = ExecuteCompute(waits);
+    m_queueSync.RecordRead(ComputeQueue, InstanceDescResource, fenceValue);
+    m_queueSync.RecordWrite(ComputeQueue, TLASResource + tlasIndex, fenceValue);
+    if (hasBLASUpdates)
+    {
+        m_queueSync.RecordRead(ComputeQueue, GeometryResource, fenceValue);
+        m_queueSync.RecordWrite(ComputeQueue, BLASResource, fenceValue);
+    }
+    m_latestTLASIndex = tlasIndex;
+    m_latestTLASFenceValue = fenceValue;
+}
+
+uint64_t Scene::ExecuteCompute(const std::vector<QueueWait>& waits)
+{
+    ThrowIfFailed(m_computeCommandList->Close());
+
+    // The GPU waits for the other queues before the command list, the CPU does not wait
+    for (const QueueWait& wait : waits)
+    {
+        ThrowIfFailed(m_computeQueue->Wait(m_queueFences[wait.queue].Get(), wait.fenceValue));
+        m_queueSync.RecordWait(ComputeQueue, wait);
+    }
+
+    ID3D12CommandList* commandLists[] = { m_computeCommandList.Get() };
+    m_computeQueue->ExecuteCommandLists(1, commandLists);
+    m_readbackHeapManager.SubmitReadbacks(m_computeQueue.Get());
+
+    const uint64_t fenceValue = m_queueSync.Submit(ComputeQueue);
+    ThrowIfFailed(m_computeQueue->Signal(m_queueFences[ComputeQueue].Get(), fenceValue));
+    m_computeAllocatorFenceValues[m_computeAllocatorIndex] = fenceValue;
+
+    // Reset the command list with the next allocator once the GPU has finished its last submission
+    m_computeAllocatorIndex = (m_computeAllocatorIndex + 1) % COMPUTE_ALLOCATOR_COUNT;
+    WaitForQueue(ComputeQueue, m_computeAllocatorFenceValues[m_computeAllocatorIndex]);
+    ThrowIfFailed(m_computeCommandAllocators[m_computeAllocatorIndex]->Reset());
+    ThrowIfFailed(m_computeCommandList->Reset(m_computeCommandAllocators[m_computeAllocatorIndex].Get(), nullptr));
+
+    return fenceValue;
+}
+
+void Scene::WaitForQueue(uint32_t queue, uint64_t fenceValue)
+{
+    ID3D12Fence* fence = m_queueFences[queue].Get();
+    if (fence->GetCompletedValue() < fenceValue)
+    {
+        ThrowIfFailed(fence->SetEventOnCompletion(fenceValue, m_fenceEvent));
+        WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE);
+    }
+    m_queueSync.SetCompletedValue(queue, fenceValue);
+}
+
+void Scene::BeginHostWrite(uint32_t resource)
+{
+    std::vector<QueueWait> waits;
+    UpdateCompletedValues();
+    m_queueSync.GetWaitsBeforeWrite(HostQueue, resource, waits);
+    for (const QueueWait& wait : waits)
+    {
+        WaitForQueue(wait.queue, wait.fenceValue);
+    }
+
+    // The CPU writes are complete when they are recorded
+    const uint64_t hostValue = m_queueSync.Submit(HostQueue);
+    m_queueSync.SetCompletedValue(HostQueue, hostValue);
+    m_queueSync.RecordWrite(HostQueue, resource, hostValue);
+}
+
+void Scene::UpdateCompletedValues()
+{
+    // Completed fence values elide the waits for them
+    m_queueSync.SetCompletedValue(DirectQueue, m_queueFences[DirectQueue]->GetCompletedValue());
+    m_queueSync.SetCompletedValue(ComputeQueue, m_queueFences[ComputeQueue]->GetCompletedValue());
+}
+
+void Scene::RequestBLASPostBuildInfoReadback()
+{
+    if (m_blasPostBuildInfoBufferOffset == 0)
+    {
+        OutputDebugStringA("Warning: BLAS post-build info readback buffer not available.\n");
+        return;
+    }
+    
+    // Read BLAS post-build info, one element per BLAS
+    m_readbackHeapManager.RequestReadback(m_blasPostBuildInfoBufferOffset, m_blases.size() * sizeof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_CURRENT_SIZE_DESC),
+        [this](const void* data, uint64_t)
+        {
+            const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_CURRENT_SIZE_DESC* pData = 
+            static_cast<const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_CURRENT_SIZE_DESC*>(data);
+
+            if (pData)
+            {
+                uint64_t currentSize = 0;
+                for (size_t i = 0; i < m_blases.size(); ++i)
+                {
+                    m_blases[i].currentSize = pData[i].CurrentSizeInBytes;
+                    currentSize += pData[i].CurrentSizeInBytes;
+                }
+
+                char debugMsg[256];
+                sprintf_s(debugMsg, "BLAS Current Size: %llu bytes (%.2f KB) in %zu BLASes\n", 
+                         currentSize,
+                         currentSize / 1024.0,
+                         m_blases.size());
+                OutputDebugStringA(debugMsg);
+
+                HeapRegistry::Instance().SetResourceSize("BLAS", currentSize, m_blasResultDataMaxSize);
+            }
+            else
+            {
+                OutputDebugStringA("Warning: Failed to map BLAS post-build info readback buffer.\n");
+            }
+        });
+
+    // Read the compacted sizes, the elements of the BLASes which are not compacted are not written
+    if (m_blasCompactedSizeBufferOffset != 0)
+    {
+        m_readbackHeapManager.RequestReadback(m_blasCompactedSizeBufferOffset, m_blases.size() * sizeof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC),
+            [this](const void* data, uint64_t)
+            {
+                const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC* pData =
+                static_cast<const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC*>(data);
+
+                for (size_t i = 0; i < m_blases.size(); ++i)
+                {
+                    const bool isCompacted = pData && (m_blases[i].buildFlags & AccelerationStructureBuildFlags::ALLOW_COMPACTION) != 0;
+                    m_blases[i].compactedSize = isCompacted ? pData[i].CompactedSizeInBytes : 0;
+                }
+                if (!pData)
+                {
+                    OutputDebugStringA("Warning: Failed to map BLAS compacted size readback buffer, the BLASes are not compacted.\n");
+                }
+            });
+    }
+}
+
+void Scene::RequestTLASPostBuildInfoReadback()
+{
+    if (m_tlasPostBuildInfoBufferOffset == 0)
+    {
+        OutputDebugStringA("Warning: TLAS post-build info readback buffer not available.\n");
+        return;
+    }
+
+    // Read TLAS post-build info
+    m_readbackHeapManager.RequestReadback(m_tlasPostBuildInfoBufferOffset, sizeof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_CURRENT_SIZE_DESC),
+        [this](const void* data, uint64_t)
+        {
+            const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_CURRENT_SIZE_DESC* pData = 
+            static_cast<const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_CURRENT_SIZE_DESC*>(data);
+
+            if (pData)
+            {
+                char debugMsg[256];
+                sprintf_s(debugMsg, "TLAS Current Size: %llu bytes (%.2f KB)\n", 
+                         pData->CurrentSizeInBytes,
+                         pData->CurrentSizeInBytes / 1024.0);
+                OutputDebugStringA(debugMsg);
+
+                HeapRegistry::Instance().SetResourceSize("TLAS", pData->CurrentSizeInBytes, m_tlasResultDataMaxSize);
+            }
+            else
+            {
+                OutputDebugStringA("Warning: Failed to map TLAS post-build info readback buffer.\n");
+            }
+        });
+}
+
+void Scene::ReportBLASBuildTime(ID3D12CommandQueue* commandQueue)
+{
+    const uint64_t* timestamps = static_cast<const uint64_t*>(m_readbackHeapManager.GetMappedPtr(m_timestampReadbackOffset));
+    uint64_t frequency = 0;
+    if (!timestamps || FAILED(commandQueue->GetTimestampFrequency(&frequency)) || frequency == 0)
+    {
+        return;
+    }
+
+    uint64_t vertexCount = 0;
+    uint64_t triangleCount = 0;
+    uint32_t num16BitIndexMeshes = 0;
+    for (const SceneMesh& mesh : m_meshes)
+    {
+        vertexCount += mesh.vertexCount;
+        triangleCount += mesh.indexCount / 3;
+        num16BitIndexMeshes += mesh.indexStride == sizeof(uint16_t);
+    }
+
+    uint64_t builtTriangleCount = 0;
+    for (const SceneBLAS& blas : m_blases)
+    {
+        builtTriangleCount += m_meshes[blas.meshIndex].indexCount / 3;
+    }
+
+    const uint64_t ticks = timestamps[TimestampQueries::BLASBuildEnd] - timestamps[TimestampQueries::BLASBuildBegin];
+    OutputDebugStringA(std::format("BLAS build: {:.3f} us ({} BLASes of {} meshes, {} vertices, {} of {} triangles built, {} meshes with 16-bit indices)\n",
+        static_cast<double>(ticks) * 1.0e6 / static_cast<double>(frequency), m_blases.size(), m_meshes.size(), vertexCount, builtTriangleCount, triangleCount,
+        num16BitIndexMeshes).c_str());
+}
+
+void Scene::FreeTemporaryResources()
+{
+    // The offsets are cleared so that the destructor does not free them again. The TLAS rebuilds after BLAS and
+    // instance updates keep the TLAS scratch buffer and the instance descs.
+    m_defaultTemporaryHeapManager.Free(m_blasScratchBufferOffset);
+    m_blasScratchBufferOffset = 0;
+
+    m_readbackHeapManager.Free(m_blasPostBuildInfoBufferOffset);
+    m_readbackHeapManager.Free(m_blasCompactedSizeBufferOffset);
+    m_readbackHeapManager.Free(m_tlasPostBuildInfoBufferOffset);
+    m_readbackHeapManager.Free(m_timestampReadbackOffset);
+    m_blasPostBuildInfoBufferOffset = 0;
+    m_blasCompactedSizeBufferOffset = 0;
+    m_tlasPostBuildInfoBufferOffset = 0;
+    m_timestampReadbackOffset = 0;
+
+    // The BLASes have been compacted or copied into the AS heap
+    if (m_ASBuildHeapManager)
+    {
+        for (SceneBLAS& blas : m_blases)
+        {
+            m_ASBuildHeapManager->Free(blas.buildOffset);
+            blas.buildOffset = 0;
+        }
+        m_ASBuildHeapManager.reset();
+    }
 }
@@ -4,14 +4,25 @@
 #include <directxmath.h>
 #include <wrl/client.h>
 #include <memory>
+#include <string>
 #include <vector>
 #include <HeapManager.h>
+#include "GeometryStreams.h"
+#include "MeshPreprocess.h"
+#include "ObjLoader.h"
+#include "GltfLoader.h"
+#include "ScenePack.h"
+#include "ProceduralScene.h"
+#include "AccelerationStructurePolicy.h"
+#include "QueueSyncTracker.h"
+#include "SceneGraph.h"
 
 using Microsoft::WRL::ComPtr;
 using namespace DirectX;
 
 // Forward declaration
 struct AccelerationStructureBuffers;
+class ThreadPool;
 
 class Scene
 {
@@ -19,64 +30,294 @@ public:
     Scene();
     ~Scene();
 
-    // Initialize the scene with device
+    // Initialize the scene with device, and create the compute queue of the acceleration structure builds
     void Initialize(ID3D12Device5* device);
 
-    // Build acceleration structures
-    void BuildAccelerationStructures(ID3D12GraphicsCommandList4* commandList,
-                                   ID3D12CommandAllocator* commandAllocator,
-                                   ID3D12CommandQueue* commandQueue);
+    // Vertex stream formats, must be set before BuildAccelerationStructures()
+    void SetPositionFormat(PositionFormat format) { m_positionFormat = format; }
+    void SetColorFormat(ColorFormat format) { m_colorFormat = format; }
+
+    // Weld, reorder and 16-bit index options of the mesh preprocessing, must be set before BuildAccelerationStructures()
+    void SetMeshPreprocessOptions(const MeshPreprocessOptions& options) { m_meshPreprocessOptions = options; }
+
+    // Wavefront OBJ (.obj) or glTF (.gltf, .glb) file loaded instead of the Cornell box, must be set before
+    // BuildAccelerationStructures(). Every object/group of an OBJ file becomes one mesh with one instance. Every glTF
+    // primitive becomes one mesh, instanced by the nodes referencing its glTF mesh.
+    void SetScenePath(const std::string& path) { m_scenePath = path; }
+
+    // Procedural stress scene generated instead of loading the scene file or the Cornell box, must be set before
+    // BuildAccelerationStructures(). Every generated mesh becomes one mesh, without a scene pack.
+    void SetProceduralScene(const ProceduralSceneSettings& settings) { m_proceduralSettings = settings; m_isProcedural = true; }
+
+    // Load the scene file from its scene pack (<scene file>.scenepack) when the pack is valid, and write the pack
+    // after loading from the scene file otherwise. Enabled by default.
+    void SetScenePackEnabled(bool isEnabled) { m_isScenePackEnabled = isEnabled; }
+
+    // Share one BLAS between meshes with identical positions, indices and build inputs. Enabled by default, must be
+    // set before BuildAccelerationStructures().
+    void SetBLASDeduplicationEnabled(bool isEnabled) { m_isBLASDeduplicationEnabled = isEnabled; }
+
+    // Classification of the meshes into static, deforming and rebuilt BLASes and their build flags, must be set
+    // before BuildAccelerationStructures(). All meshes are static and compacted by default.
+    void SetAccelerationStructurePolicy(const AccelerationStructurePolicySettings& settings) { m_asPolicy = AccelerationStructurePolicy(settings); }
+
+    // Build acceleration structures on the compute queue. Only the compaction waits for the GPU: the TLAS build is
+    // submitted without waiting, the first frame waits for it on the GPU.
+    void BuildAccelerationStructures();
+
+    // Frames rendered on the direct queue which read the geometry and the TLAS of GetTLAS(). BeginFrame() picks the
+    // TLAS of the frame and makes the direct queue wait for the compute queue only when that TLAS, or a BLAS refitted
+    // in place, has not completed yet. EndFrame() is called after the command lists of the frame are executed.
+    void BeginFrame(ID3D12CommandQueue* directQueue);
+    void EndFrame(ID3D12CommandQueue* directQueue);
+
+    // New positions of a deforming or rebuilt mesh, in the layout of its position stream
+    struct MeshDeformation
+    {
+        uint32_t meshIndex;
+        const void* positionData;
+    };
+
+    // Write the positions of the meshes, refit or rebuild their BLASes as decided by the policy and rebuild the TLAS
+    // into the buffer the frames are not reading, on the compute queue. The CPU waits for the frames reading the
+    // previous positions, the compute queue waits on the GPU for the frames reading the BLASes.
+    void UpdateDeformedMeshes(const std::vector<MeshDeformation>& deformations);
+
+    // Scene graph of the instance transforms, built with the acceleration structures. Node 0 is the root, its
+    // children are the instances with their transform at load as the local transform. Set node transforms with
+    // GetSceneGraph().SetLocalTransform(), then UpdateInstanceTransforms() rewrites the changed TLAS instances.
+    SceneGraph& GetSceneGraph() { return m_sceneGraph; }
+    uint32_t GetInstanceNode(uint32_t instanceIndex) const { return m_sceneGraph.GetInstanceNode(instanceIndex); }
+
+    // Update the world transforms of the dirty nodes, write the instance descs of the changed instances and rebuild
+    // the TLAS into the buffer the frames are not reading, on the compute queue. The CPU waits only for the last TLAS
+    // build reading the instance descs.
+    void UpdateInstanceTransforms();
 
     // Accessors
     // BLAS and TLAS should be allocated in the default heap
-    D3D12_GPU_VIRTUAL_ADDRESS GetTLAS() const { return m_ASHeapManager.GetGPUVirtualAddress(m_topLevelASOffset); }
-    D3D12_GPU_VIRTUAL_ADDRESS GetBLAS() const { return m_ASHeapManager.GetGPUVirtualAddress(m_bottomLevelASOffset); }
+    D3D12_GPU_VIRTUAL_ADDRESS GetTLAS() const { return m_ASHeapManager.GetGPUVirtualAddress(m_topLevelASOffsets[m_currentTLASIndex]); }
+    D3D12_GPU_VIRTUAL_ADDRESS GetBLAS(uint32_t meshIndex) const { return m_ASHeapManager.GetGPUVirtualAddress(m_blases[m_meshes[meshIndex].blasIndex].bottomLevelASOffset); }
+    uint32_t GetMeshCount() const { return static_cast<uint32_t>(m_meshes.size()); }
+    uint32_t GetBLASCount() const { return static_cast<uint32_t>(m_blases.size()); }
+    uint32_t GetInstanceCount() const { return static_cast<uint32_t>(m_instances.size()); }
+
+    // Geometry buffer read by the shaders as a ByteAddressBuffer, and the byte offset of the MeshInfo array in it
+    ID3D12Resource* GetGeometryBuffer() const { return m_geometryHeapManager.Get().Get(); }
+    uint32_t GetMeshInfoOffset() const { return m_meshInfoOffset ? static_cast<uint32_t>(m_geometryHeapManager.GetResourceOffset(m_meshInfoOffset)) : 0; }
     
 private:
+    // Geometry of one mesh and the BLAS it references. The mesh index is the InstanceID of its TLAS instances and
+    // the index of its MeshInfo.
+    struct SceneMesh
+    {
+        std::string name;
+
+        // Geometry buffers
+        uint32_t vertexBufferOffset;        // position stream
+        uint32_t attributeBufferOffset;     // normal and color stream
+        uint32_t indexBufferOffset;
+        uint32_t geometryTransformOffset;   // dequantization of snorm16 positions
+
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t indexStride;
+
+        uint32_t blasIndex;
+    };
+
+    // Bottom level acceleration structure, shared by the static meshes with identical geometry. It is built from the
+    // geometry of the first mesh referencing it and freed with the last one.
+    struct SceneBLAS
+    {
+        uint32_t meshIndex;
+        uint32_t refCount;
+
+        // Policy of the BLAS, and the refit state of a deforming BLAS
+        MeshUsage usage;
+        uint32_t buildFlags;
+        BLASUpdateState updateState;
+        float positionScale[3];             // dequantization scale of the position stream, for the bounds
+
+        // BLAS, and the byte offset of its scratch memory in the shared scratch buffer
+        uint32_t bottomLevelASOffset;
+        uint64_t scratchOffset;
+        uint64_t updateScratchOffset;       // in the update scratch buffer, deforming and rebuilt BLASes
+        D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO prebuildInfo;
+
+        // BLAS in the build heap before it is compacted or copied into the AS heap, and its post-build sizes
+        uint32_t buildOffset;
+        uint64_t currentSize;
+        uint64_t compactedSize;
+    };
+
+    // Mesh before the upload: AoS vertices (OBJ, procedural, Cornell box), or a glTF primitive whose accessors may be uploaded
+    // as they are
+    struct MeshSource
+    {
+        std::string name;
+        std::vector<GeometrySourceVertex> vertices;
+        std::vector<uint32_t> indices;
+        const GltfPrimitive* gltfPrimitive;
+        float boundsMin[3];
+        float boundsMax[3];
+    };
+
+    // TLAS instance of a mesh, the transform is the row-major 3x4 object to world matrix
+    struct SceneInstance
+    {
+        uint32_t meshIndex;
+        float transform[3][4];
+    };
+
     // Device reference (not owned)
     ID3D12Device5* m_device;
 
+    // Mesh loading and preprocessing
+    std::unique_ptr<ThreadPool> m_threadPool;
+
     HeapManager m_ASHeapManager;
+
+    // BLASes as they are built, when some of them are compacted into the AS heap. Released after the compaction.
+    std::unique_ptr<HeapManager> m_ASBuildHeapManager;
     HeapManager m_defaultTemporaryHeapManager;
     HeapManager m_uploadTemporaryHeapManager;
 
+    // Vertex streams, index buffer and mesh infos, kept for the shaders
+    HeapManager m_geometryHeapManager;
+
     ReadbackHeapManager m_readbackHeapManager;
     
-    // Acceleration structures
-    uint32_t m_topLevelASOffset;
-    uint32_t m_bottomLevelASOffset; 
-   
-    // Geometry buffers
-    uint32_t m_vertexBufferOffset;
-    uint32_t m_indexBufferOffset;
+    // Acceleration structures. The TLAS is double buffered: after BLAS or instance updates it is rebuilt into the
+    // buffer the frames are not reading, and the frames switch to it once its build has completed.
+    static const uint32_t TLAS_BUFFER_COUNT = 2;
+    uint32_t m_topLevelASOffsets[TLAS_BUFFER_COUNT];
+    uint32_t m_currentTLASIndex;        // read by the frames
+    uint32_t m_latestTLASIndex;         // last built
+    uint64_t m_latestTLASFenceValue;    // compute fence value of the last build
+    D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO m_tlasPrebuildInfo;
+
+    // Meshes, and the MeshInfo array indexed by InstanceID
+    std::vector<SceneMesh> m_meshes;
+    uint32_t m_meshInfoOffset;
+
+    // BLASes referenced by the meshes
+    std::vector<SceneBLAS> m_blases;
+    bool m_isBLASDeduplicationEnabled;
+    AccelerationStructurePolicy m_asPolicy;
+
+    // Some BLASes are deforming or rebuilt, their update scratch memory is kept
+    bool m_hasUpdatableBLAS;
+
+    // Instances of the meshes, InstanceID is the mesh index
+    std::vector<SceneInstance> m_instances;
+
+    // Transforms of the instances, and the instance descs as they are in the upload heap
+    SceneGraph m_sceneGraph;
+    std::vector<D3D12_RAYTRACING_INSTANCE_DESC> m_instanceDescs;
     
     // Geometry info
-    uint32_t m_vertexCount;
-    uint32_t m_indexCount;
+    std::string m_scenePath;
+    bool m_isScenePackEnabled;
+    ProceduralSceneSettings m_proceduralSettings;
+    bool m_isProcedural;
+    MeshPreprocessOptions m_meshPreprocessOptions;
+    PositionFormat m_positionFormat;
+    ColorFormat m_colorFormat;
     
     // Build flags
     bool m_isBuilt;
 
+    // Acceleration structures are built on the compute queue. The allocators are recycled once the compute fence
+    // passes the value of their submission.
+    static const uint32_t COMPUTE_ALLOCATOR_COUNT = 3;
+    ComPtr<ID3D12CommandQueue> m_computeQueue;
+    ComPtr<ID3D12CommandAllocator> m_computeCommandAllocators[COMPUTE_ALLOCATOR_COUNT];
+    uint64_t m_computeAllocatorFenceValues[COMPUTE_ALLOCATOR_COUNT];
+    uint32_t m_computeAllocatorIndex;
+    ComPtr<ID3D12GraphicsCommandList4> m_computeCommandList;
+
+    // Fences and accesses of the queues sharing the scene resources. The host queue stands for the CPU writes of the
+    // upload heaps, which are complete when they are recorded.
+    enum SyncQueues : uint32_t {
+        DirectQueue = 0,
+        ComputeQueue,
+        HostQueue,
+        SyncQueueCount
+    };
+    enum SyncResources : uint32_t {
+        GeometryResource = 0,
+        BLASResource,
+        InstanceDescResource,
+        TLASResource,       // one per TLAS buffer
+        SyncResourceCount = TLASResource + TLAS_BUFFER_COUNT
+    };
+    QueueSyncTracker m_queueSync;
+    ComPtr<ID3D12Fence> m_queueFences[HostQueue];
+    HANDLE m_fenceEvent;
+
+    // Compute fence value of the initial build, whose temporary resources are freed once it has completed
+    uint64_t m_buildFenceValue;
+
     // Temporary resources for AS build (must be kept alive until GPU finishes)
+    // The BLAS builds share one scratch buffer so that they can run concurrently on the GPU. The updates of the
+    // deforming and rebuilt BLASes have their own scratch buffer. The TLAS scratch and instance descs are kept for
+    // the TLAS rebuilds.
     uint32_t m_blasScratchBufferOffset;
+    uint32_t m_blasUpdateScratchBufferOffset;
     uint32_t m_tlasScratchBufferOffset;
     uint32_t m_instanceDescBufferOffset;
 
-    // Post-build info buffers (GPU writable)
+    // Post-build info buffers (GPU writable), one element per BLAS
     uint32_t m_blasPostBuildInfoBufferOffset;
+    uint32_t m_blasCompactedSizeBufferOffset;
     uint32_t m_tlasPostBuildInfoBufferOffset;
 
     // Readback buffers for post-build info
     uint32_t m_blasPostBuildInfoReadbackOffset;
     uint32_t m_tlasPostBuildInfoReadbackOffset;
+
+    // GPU timestamps of the BLAS builds
+    enum TimestampQueries : uint32_t {
+        BLASBuildBegin = 0,
+        BLASBuildEnd,
+        Count
+    };
+    ComPtr<ID3D12QueryHeap> m_timestampQueryHeap;
+    uint32_t m_timestampReadbackOffset;
+
+    // Sizes reserved for the acceleration structures from the prebuild info
+    uint64_t m_blasResultDataMaxSize;
+    uint64_t m_tlasResultDataMaxSize;
     
     // Private methods
-    void CreateCornellBoxGeometry();
+    bool LoadScenePack(ScenePack& scenePack);
+    uint64_t GetScenePackSettingsHash() const;
+    void LoadMeshes(std::vector<MeshSource>& sources, GltfScene& gltfScene, std::vector<std::string>& sourcePaths);
+    void FitInstancesToView(const std::vector<MeshSource>& sources);
+    void CreateGeometry(const std::vector<MeshSource>& sources, const std::vector<std::string>& sourcePaths);
+    void UploadGeometry(const std::vector<ScenePackMesh>& meshes);
+    void DeduplicateBLAS(const std::vector<ScenePackMesh>& meshes);
+    void ReleaseBLAS(uint32_t blasIndex);
+    void BuildSceneGraph();
+    void ComputeAccelerationStructureSizes();
+    D3D12_RAYTRACING_GEOMETRY_DESC GetGeometryDesc(const SceneMesh& mesh) const;
     void CreateBottomLevelAS(ID3D12GraphicsCommandList4* commandList);
+    void BuildBottomLevelAS(ID3D12GraphicsCommandList4* commandList, const SceneBLAS& blas, D3D12_GPU_VIRTUAL_ADDRESS destination,
+        D3D12_GPU_VIRTUAL_ADDRESS scratch, bool isRefit, const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC* postBuildInfoDescs,
+        uint32_t numPostBuildInfoDescs);
+    void CompactBottomLevelAS(ID3D12GraphicsCommandList4* commandList);
     void CreateTopLevelAS(ID3D12GraphicsCommandList4* commandList);
-    void ReadbackPostBuildInfo();
+    void BuildTopLevelAS(ID3D12GraphicsCommandList4* commandList, uint32_t tlasIndex, const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC* postBuildInfoDesc);
+    void RebuildTopLevelAS(bool hasBLASUpdates);
+    uint64_t ExecuteCompute(const std::vector<QueueWait>& waits);
+    void WaitForQueue(uint32_t queue, uint64_t fenceValue);
+    void UpdateCompletedValues();
+
+    // Wait on the CPU for the GPU work accessing a resource which the CPU writes in place, and record the write
+    void BeginHostWrite(uint32_t resource);
+    void RequestBLASPostBuildInfoReadback();
+    void RequestTLASPostBuildInfoReadback();
+    void ReportBLASBuildTime(ID3D12CommandQueue* commandQueue);
     void FreeTemporaryResources();
-    
-    // Helper method to wait for GPU completion
-    void WaitForGPU(ID3D12CommandQueue* commandQueue);
 };
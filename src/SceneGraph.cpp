@@ -0,0 +1,236 @@
+#include "SceneGraph.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+    // Nodes updated by one task. Larger subtrees are split at their children.
+    const uint32_t UPDATE_TASK_NODE_COUNT = 1024;
+}
+
+bool SceneGraph::Build(const std::vector<SceneGraphNodeDesc>& descs, std::vector<uint32_t>& nodeIndices)
+{
+    const uint32_t numNodes = static_cast<uint32_t>(descs.size());
+    nodeIndices.assign(numNodes, INVALID_NODE);
+
+    // Children of every desc in desc order
+    std::vector<uint32_t> childOffsets(numNodes + 1, 0);
+    for (const SceneGraphNodeDesc& desc : descs)
+    {
+        if (desc.parent != INVALID_NODE)
+        {
+            if (desc.parent >= numNodes)
+            {
+                return false;
+            }
+            childOffsets[desc.parent + 1]++;
+        }
+    }
+    for (uint32_t i = 0; i < numNodes; ++i)
+    {
+        childOffsets[i + 1] += childOffsets[i];
+    }
+    std::vector<uint32_t> children(childOffsets[numNodes]);
+    std::vector<uint32_t> childCursors(childOffsets.begin(), childOffsets.end() - 1);
+    for (uint32_t i = 0; i < numNodes; ++i)
+    {
+        if (descs[i].parent != INVALID_NODE)
+        {
+            children[childCursors[descs[i].parent]++] = i;
+        }
+    }
+
+    m_localTransforms.resize(numNodes);
+    m_worldTransforms.resize(numNodes);
+    m_parents.resize(numNodes);
+    m_subtreeEnds.resize(numNodes);
+
+    // Depth first from the roots, a parent gets its index before its children
+    uint32_t numVisited = 0;
+    std::vector<uint32_t> stack;
+    for (uint32_t root = 0; root < numNodes; ++root)
+    {
+        if (descs[root].parent != INVALID_NODE)
+        {
+            continue;
+        }
+
+        stack.push_back(root);
+        while (!stack.empty())
+        {
+            const uint32_t descIndex = stack.back();
+            stack.pop_back();
+
+            const uint32_t node = numVisited++;
+            const uint32_t parent = descs[descIndex].parent;
+            nodeIndices[descIndex] = node;
+            m_localTransforms[node] = descs[descIndex].localTransform;
+            m_parents[node] = parent != INVALID_NODE ? nodeIndices[parent] : INVALID_NODE;
+            m_subtreeEnds[node] = node + 1;
+
+            // Reversed so that the children are visited in desc order
+            for (uint32_t i = childOffsets[descIndex + 1]; i > childOffsets[descIndex]; --i)
+            {
+                stack.push_back(children[i - 1]);
+            }
+        }
+    }
+
+    // The descs in a cycle are not reachable from a root
+    if (numVisited != numNodes)
+    {
+        m_localTransforms.clear();
+        m_worldTransforms.clear();
+        m_parents.clear();
+        m_subtreeEnds.clear();
+        return false;
+    }
+
+    // The children follow their parent, so the subtree ends are accumulated backwards
+    for (uint32_t node = numNodes; node-- > 0;)
+    {
+        const uint32_t parent = m_parents[node];
+        if (parent != INVALID_NODE)
+        {
+            m_subtreeEnds[parent] = std::max(m_subtreeEnds[parent], m_subtreeEnds[node]);
+        }
+    }
+
+    m_dirtyFlags.assign(numNodes, 0);
+    m_dirtyNodes.clear();
+    m_instanceNodes.clear();
+    m_nodeFirstInstances.assign(numNodes + 1, 0);
+
+    UpdateWorldTransforms(0, numNodes);
+    return true;
+}
+
+void SceneGraph::SetInstanceNodes(const std::vector<uint32_t>& instanceNodes)
+{
+    assert(std::is_sorted(instanceNodes.begin(), instanceNodes.end()));
+
+    m_instanceNodes = instanceNodes;
+    m_nodeFirstInstances.assign(GetNodeCount() + 1, 0);
+    for (uint32_t node : m_instanceNodes)
+    {
+        m_nodeFirstInstances[node + 1]++;
+    }
+    for (uint32_t node = 0; node < GetNodeCount(); ++node)
+    {
+        m_nodeFirstInstances[node + 1] += m_nodeFirstInstances[node];
+    }
+}
+
+void SceneGraph::SetLocalTransform(uint32_t node, FXMMATRIX transform)
+{
+    XMStoreFloat3x4(&m_localTransforms[node], transform);
+    if (!m_dirtyFlags[node])
+    {
+        m_dirtyFlags[node] = 1;
+        m_dirtyNodes.push_back(node);
+    }
+}
+
+void SceneGraph::UpdateWorldTransforms(uint32_t begin, uint32_t end)
+{
+    // XMLoadFloat3x4 transposes the 3x4 matrix, the XMMATRIX transforms row vectors: the parent applies last
+    for (uint32_t node = begin; node < end; ++node)
+    {
+        const XMMATRIX local = XMLoadFloat3x4(&m_localTransforms[node]);
+        const uint32_t parent = m_parents[node];
+        XMStoreFloat3x4(&m_worldTransforms[node], parent != INVALID_NODE ? XMMatrixMultiply(local, XMLoadFloat3x4(&m_worldTransforms[parent])) : local);
+    }
+}
+
+uint32_t SceneGraph::Update(ThreadPool& threadPool, std::vector<SceneGraphInstanceRange>& changedInstances)
+{
+    changedInstances.clear();
+    if (m_dirtyNodes.empty())
+    {
+        return 0;
+    }
+
+    // Dirty subtrees in preorder, a dirty node inside an earlier subtree is updated with it
+    std::sort(m_dirtyNodes.begin(), m_dirtyNodes.end());
+    std::vector<NodeRange> dirtyRanges;
+    for (uint32_t node : m_dirtyNodes)
+    {
+        m_dirtyFlags[node] = 0;
+        if (dirtyRanges.empty() || node >= dirtyRanges.back().end)
+        {
+            dirtyRanges.push_back({ node, m_subtreeEnds[node] });
+        }
+    }
+    m_dirtyNodes.clear();
+
+    // Split the large subtrees into tasks: the root is updated here, then runs of its child subtrees are independent.
+    // The ancestors of a dirty subtree are not dirty, so the tasks only read world transforms which are up to date.
+    std::vector<NodeRange> tasks;
+    std::vector<NodeRange> stack(dirtyRanges.rbegin(), dirtyRanges.rend());
+    while (!stack.empty())
+    {
+        const NodeRange range = stack.back();
+        stack.pop_back();
+        if (range.end - range.begin <= UPDATE_TASK_NODE_COUNT)
+        {
+            tasks.push_back(range);
+            continue;
+        }
+
+        UpdateWorldTransforms(range.begin, range.begin + 1);
+        NodeRange run = { range.begin + 1, range.begin + 1 };
+        for (uint32_t child = range.begin + 1; child < range.end; child = m_subtreeEnds[child])
+        {
+            const uint32_t childEnd = m_subtreeEnds[child];
+            if (childEnd - child > UPDATE_TASK_NODE_COUNT)
+            {
+                stack.push_back({ child, childEnd });
+                if (run.end > run.begin)
+                {
+                    tasks.push_back(run);
+                }
+                run = { childEnd, childEnd };
+                continue;
+            }
+
+            if (childEnd - run.begin > UPDATE_TASK_NODE_COUNT && run.end > run.begin)
+            {
+                tasks.push_back(run);
+                run.begin = child;
+            }
+            run.end = childEnd;
+        }
+        if (run.end > run.begin)
+        {
+            tasks.push_back(run);
+        }
+    }
+
+    threadPool.ParallelFor(static_cast<uint32_t>(tasks.size()), [&](uint32_t i)
+    {
+        UpdateWorldTransforms(tasks[i].begin, tasks[i].end);
+    });
+
+    // The instances of the dirty subtrees, adjacent ranges merged
+    uint32_t numUpdated = 0;
+    for (const NodeRange& range : dirtyRanges)
+    {
+        numUpdated += range.end - range.begin;
+        const uint32_t begin = m_nodeFirstInstances[range.begin];
+        const uint32_t end = m_nodeFirstInstances[range.end];
+        if (begin == end)
+        {
+            continue;
+        }
+        if (!changedInstances.empty() && changedInstances.back().end == begin)
+        {
+            changedInstances.back().end = end;
+        }
+        else
+        {
+            changedInstances.push_back({ begin, end });
+        }
+    }
+    return numUpdated;
+}
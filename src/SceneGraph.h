@@ -0,0 +1,87 @@
+#pragma once
+
+#include <directxmath.h>
+#include <cstdint>
+#include <vector>
+
+using namespace DirectX;
+
+class ThreadPool;
+
+// Flat scene graph of the instance transforms.
+//
+// The nodes are stored in preorder, so the subtree of a node is the contiguous range [node, GetSubtreeEnd(node)).
+// The local and world transforms, the parents, the subtree ends and the dirty flags are separate arrays indexed by
+// the node. Setting the local transform of a node marks its subtree dirty. Update() recomputes the world transforms
+// of the dirty subtrees only, so its cost follows the size of the change and not the size of the graph.
+//
+// The instances are sorted by their node, so the instances of a subtree are contiguous as well. Update() returns the
+// changed instances as ranges, which are the only TLAS instance records to rewrite.
+//
+// Transforms are row-major 3x4 object to parent matrices, the layout of D3D12_RAYTRACING_INSTANCE_DESC::Transform.
+
+struct SceneGraphNodeDesc
+{
+    uint32_t parent;                // index of the parent desc, SceneGraph::INVALID_NODE for a root
+    XMFLOAT3X4 localTransform;
+};
+
+// Instances [begin, end) whose world transform changed
+struct SceneGraphInstanceRange
+{
+    uint32_t begin;
+    uint32_t end;
+};
+
+class SceneGraph
+{
+public:
+    static const uint32_t INVALID_NODE = UINT32_MAX;
+
+    // Build the graph from nodes in any order. nodeIndices receives the node index of every desc. Returns false if a
+    // parent is out of range or the parents form a cycle. The world transforms are computed, no node is dirty.
+    bool Build(const std::vector<SceneGraphNodeDesc>& descs, std::vector<uint32_t>& nodeIndices);
+
+    // Node of every instance, in ascending node order
+    void SetInstanceNodes(const std::vector<uint32_t>& instanceNodes);
+
+    uint32_t GetNodeCount() const { return static_cast<uint32_t>(m_parents.size()); }
+    uint32_t GetInstanceCount() const { return static_cast<uint32_t>(m_instanceNodes.size()); }
+    uint32_t GetParent(uint32_t node) const { return m_parents[node]; }
+    uint32_t GetSubtreeEnd(uint32_t node) const { return m_subtreeEnds[node]; }
+    uint32_t GetInstanceNode(uint32_t instance) const { return m_instanceNodes[instance]; }
+    const XMFLOAT3X4& GetLocalTransform(uint32_t node) const { return m_localTransforms[node]; }
+    const XMFLOAT3X4& GetWorldTransform(uint32_t node) const { return m_worldTransforms[node]; }
+    const XMFLOAT3X4& GetInstanceWorldTransform(uint32_t instance) const { return m_worldTransforms[m_instanceNodes[instance]]; }
+
+    // Set the local transform of a node and mark its subtree dirty
+    void SetLocalTransform(uint32_t node, FXMMATRIX transform);
+    bool IsDirty() const { return !m_dirtyNodes.empty(); }
+
+    // Recompute the world transforms of the dirty subtrees on the thread pool. changedInstances receives the sorted
+    // and merged ranges of the instances in them. Returns the number of nodes updated.
+    uint32_t Update(ThreadPool& threadPool, std::vector<SceneGraphInstanceRange>& changedInstances);
+
+private:
+    struct NodeRange
+    {
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    // World transforms of the nodes [begin, end) in preorder. The parents outside the range are up to date.
+    void UpdateWorldTransforms(uint32_t begin, uint32_t end);
+
+    std::vector<XMFLOAT3X4> m_localTransforms;
+    std::vector<XMFLOAT3X4> m_worldTransforms;
+    std::vector<uint32_t> m_parents;
+    std::vector<uint32_t> m_subtreeEnds;
+    std::vector<uint8_t> m_dirtyFlags;
+
+    // Nodes whose local transform changed since the last Update(), each once
+    std::vector<uint32_t> m_dirtyNodes;
+
+    // Instances sorted by node, and the first instance of every node (GetNodeCount() + 1 elements)
+    std::vector<uint32_t> m_instanceNodes;
+    std::vector<uint32_t> m_nodeFirstInstances;
+};
@@ -0,0 +1,424 @@
+#include "ScenePack.h"
+#include "Hash.h"
+#include "ThreadPool.h"
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <system_error>
+
+namespace
+{
+    const uint32_t SCENE_PACK_MAGIC = 0x4B505353;  // "SSPK"
+
+    // Layout: header, source table, mesh table, instance table, names, then the page aligned data blocks
+    struct PackHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t fileSize;
+        uint64_t settingsHash;
+        uint64_t metadataHash;      // of the tables and names between the header and dataOffset
+        uint64_t dataOffset;
+        uint32_t numSources;
+        uint32_t numMeshes;
+        uint32_t numInstances;
+        uint32_t stringDataSize;
+    };
+    static_assert(sizeof(PackHeader) == 56, "PackHeader layout");
+
+    struct PackSource
+    {
+        uint64_t size;
+        uint64_t writeTime;
+        uint64_t contentHash;
+        uint32_t pathOffset;        // in the names, relative to the directory of the pack
+        uint32_t pathLength;
+    };
+    static_assert(sizeof(PackSource) == 32, "PackSource layout");
+
+    struct PackMesh
+    {
+        uint64_t positionOffset;
+        uint64_t positionDataSize;
+        uint64_t attributeOffset;
+        uint64_t attributeDataSize;
+        uint64_t indexOffset;
+        uint64_t indexDataSize;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t indexStride;
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        uint32_t padding;
+        float geometryTransform[12];
+    };
+    static_assert(sizeof(PackMesh) == 120, "PackMesh layout");
+    static_assert(sizeof(ScenePackInstance) == 52, "ScenePackInstance is stored as it is");
+
+    double MillisecondsSince(std::chrono::steady_clock::time_point startTime)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    }
+
+    uint64_t GetMetadataSize(uint32_t numSources, uint32_t numMeshes, uint32_t numInstances, uint32_t stringDataSize)
+    {
+        return static_cast<uint64_t>(numSources) * sizeof(PackSource) + static_cast<uint64_t>(numMeshes) * sizeof(PackMesh) +
+            static_cast<uint64_t>(numInstances) * sizeof(ScenePackInstance) + stringDataSize;
+    }
+
+    bool IsBlockInFile(uint64_t offset, uint64_t size, uint64_t dataOffset, uint64_t fileSize)
+    {
+        return size == 0 || (offset >= dataOffset && offset % SCENE_PACK_ALIGNMENT == 0 && offset <= fileSize && size <= fileSize - offset);
+    }
+
+    bool Fail(std::string* error, std::string message)
+    {
+        if (error)
+        {
+            *error = std::move(message);
+        }
+        return false;
+    }
+}
+
+std::string GetScenePackPath(const std::string& scenePath)
+{
+    return scenePath + ".scenepack";
+}
+
+bool GetScenePackSource(const std::string& path, ThreadPool* threadPool, ScenePackSource& source)
+{
+    std::error_code errorCode;
+    const uint64_t size = std::filesystem::file_size(path, errorCode);
+    if (errorCode)
+    {
+        return false;
+    }
+    const auto writeTime = std::filesystem::last_write_time(path, errorCode);
+    if (errorCode)
+    {
+        return false;
+    }
+
+    source.path = path;
+    source.size = size;
+    source.writeTime = static_cast<uint64_t>(writeTime.time_since_epoch().count());
+    source.contentHash = 0;
+    if (threadPool)
+    {
+        MappedFile file;
+        if (!file.Open(path.c_str()) || file.GetSize() != size)
+        {
+            return false;
+        }
+        source.contentHash = Hash64Parallel(file.GetData(), static_cast<size_t>(file.GetSize()), *threadPool);
+    }
+    return true;
+}
+
+bool WriteScenePack(const char* path, uint64_t settingsHash, const std::vector<std::string>& sourcePaths,
+    const std::vector<ScenePackMesh>& meshes, const std::vector<ScenePackInstance>& instances, ThreadPool& threadPool,
+    ScenePackStats* stats, std::string* error)
+{
+    const auto startTime = std::chrono::steady_clock::now();
+    const std::filesystem::path directory = std::filesystem::path(path).parent_path();
+
+    // Names, source paths relative to the pack so that the pack can be moved together with the scene
+    std::string stringData;
+    std::vector<PackSource> packSources(sourcePaths.size());
+    for (size_t i = 0; i < sourcePaths.size(); ++i)
+    {
+        ScenePackSource source;
+        if (!GetScenePackSource(sourcePaths[i], &threadPool, source))
+        {
+            return Fail(error, std::format("failed to read the source {}", sourcePaths[i]));
+        }
+
+        std::string relativePath = std::filesystem::path(sourcePaths[i]).lexically_relative(directory).generic_string();
+        if (relativePath.empty())
+        {
+            relativePath = std::filesystem::absolute(sourcePaths[i]).generic_string();
+        }
+
+        PackSource& packSource = packSources[i];
+        packSource.size = source.size;
+        packSource.writeTime = source.writeTime;
+        packSource.contentHash = source.contentHash;
+        packSource.pathOffset = static_cast<uint32_t>(stringData.size());
+        packSource.pathLength = static_cast<uint32_t>(relativePath.size());
+        stringData += relativePath;
+    }
+
+    // Data blocks after the metadata, each on a page boundary
+    std::vector<PackMesh> packMeshes(meshes.size());
+    for (size_t i = 0; i < meshes.size(); ++i)
+    {
+        packMeshes[i].nameOffset = static_cast<uint32_t>(stringData.size());
+        packMeshes[i].nameLength = static_cast<uint32_t>(meshes[i].name.size());
+        stringData += meshes[i].name;
+    }
+
+    const uint64_t dataOffset = AlignSize(sizeof(PackHeader) + GetMetadataSize(static_cast<uint32_t>(packSources.size()),
+        static_cast<uint32_t>(packMeshes.size()), static_cast<uint32_t>(instances.size()), static_cast<uint32_t>(stringData.size())), SCENE_PACK_ALIGNMENT);
+    uint64_t offset = dataOffset;
+    uint64_t dataSize = 0;
+    for (size_t i = 0; i < meshes.size(); ++i)
+    {
+        const ScenePackMesh& mesh = meshes[i];
+        PackMesh& packMesh = packMeshes[i];
+        packMesh.positionOffset = offset;
+        packMesh.positionDataSize = mesh.positionDataSize;
+        offset += AlignSize(mesh.positionDataSize, SCENE_PACK_ALIGNMENT);
+        packMesh.attributeOffset = offset;
+        packMesh.attributeDataSize = mesh.attributeDataSize;
+        offset += AlignSize(mesh.attributeDataSize, SCENE_PACK_ALIGNMENT);
+        packMesh.indexOffset = offset;
+        packMesh.indexDataSize = mesh.indexDataSize;
+        offset += AlignSize(mesh.indexDataSize, SCENE_PACK_ALIGNMENT);
+
+        packMesh.vertexCount = mesh.vertexCount;
+        packMesh.indexCount = mesh.indexCount;
+        packMesh.indexStride = mesh.indexStride;
+        packMesh.padding = 0;
+        memcpy(packMesh.geometryTransform, mesh.geometryTransform, sizeof(packMesh.geometryTransform));
+        dataSize += mesh.positionDataSize + mesh.attributeDataSize + mesh.indexDataSize;
+    }
+
+    std::vector<uint8_t> metadata(static_cast<size_t>(dataOffset), 0);
+    uint8_t* p = metadata.data() + sizeof(PackHeader);
+    memcpy(p, packSources.data(), packSources.size() * sizeof(PackSource));
+    p += packSources.size() * sizeof(PackSource);
+    memcpy(p, packMeshes.data(), packMeshes.size() * sizeof(PackMesh));
+    p += packMeshes.size() * sizeof(PackMesh);
+    memcpy(p, instances.data(), instances.size() * sizeof(ScenePackInstance));
+    p += instances.size() * sizeof(ScenePackInstance);
+    memcpy(p, stringData.data(), stringData.size());
+    p += stringData.size();
+
+    PackHeader header = {};
+    header.magic = SCENE_PACK_MAGIC;
+    header.version = SCENE_PACK_VERSION;
+    header.fileSize = offset;
+    header.settingsHash = settingsHash;
+    header.dataOffset = dataOffset;
+    header.numSources = static_cast<uint32_t>(packSources.size());
+    header.numMeshes = static_cast<uint32_t>(packMeshes.size());
+    header.numInstances = static_cast<uint32_t>(instances.size());
+    header.stringDataSize = static_cast<uint32_t>(stringData.size());
+    header.metadataHash = Hash64(metadata.data() + sizeof(PackHeader), static_cast<size_t>(p - metadata.data()) - sizeof(PackHeader));
+    memcpy(metadata.data(), &header, sizeof(header));
+
+    // Write to a temporary file so that an interrupted write never leaves a pack which looks valid
+    const std::string temporaryPath = std::string(path) + ".tmp";
+    FILE* file = OpenFileStream(temporaryPath.c_str(), "wb");
+    if (!file)
+    {
+        return Fail(error, std::format("failed to create {}", temporaryPath));
+    }
+
+    static const uint8_t zeros[SCENE_PACK_ALIGNMENT] = {};
+    bool isWritten = fwrite(metadata.data(), 1, metadata.size(), file) == metadata.size();
+    auto writeBlock = [&](const void* data, uint64_t size)
+    {
+        const size_t padding = static_cast<size_t>(AlignSize(size, SCENE_PACK_ALIGNMENT) - size);
+        isWritten = isWritten && (size == 0 || fwrite(data, 1, static_cast<size_t>(size), file) == size);
+        isWritten = isWritten && (padding == 0 || fwrite(zeros, 1, padding, file) == padding);
+    };
+    for (const ScenePackMesh& mesh : meshes)
+    {
+        writeBlock(mesh.positionData, mesh.positionDataSize);
+        writeBlock(mesh.attributeData, mesh.attributeDataSize);
+        writeBlock(mesh.indexData, mesh.indexDataSize);
+    }
+    isWritten = (fclose(file) == 0) && isWritten;
+
+    std::error_code errorCode;
+    if (isWritten)
+    {
+        std::filesystem::rename(temporaryPath, path, errorCode);
+    }
+    if (!isWritten || errorCode)
+    {
+        std::filesystem::remove(temporaryPath, errorCode);
+        return Fail(error, std::format("failed to write {}", path));
+    }
+
+    if (stats)
+    {
+        *stats = {};
+        stats->fileSize = header.fileSize;
+        stats->dataSize = dataSize;
+        stats->numMeshes = header.numMeshes;
+        stats->numInstances = header.numInstances;
+        stats->numSources = header.numSources;
+        stats->milliseconds = MillisecondsSince(startTime);
+    }
+    return true;
+}
+
+bool ScenePack::Open(const char* path, uint64_t settingsHash, ThreadPool& threadPool, ScenePackStats* stats, std::string* error)
+{
+    Close();
+    const auto startTime = std::chrono::steady_clock::now();
+
+    auto fail = [&](std::string message)
+    {
+        Close();
+        return Fail(error, std::move(message));
+    };
+
+    if (!m_file.Open(path))
+    {
+        return fail("no pack");
+    }
+
+    // Header and metadata
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(m_file.GetData());
+    const uint64_t fileSize = m_file.GetSize();
+    PackHeader header = {};
+    if (fileSize < sizeof(PackHeader))
+    {
+        return fail("truncated header");
+    }
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != SCENE_PACK_MAGIC)
+    {
+        return fail("not a scene pack");
+    }
+    if (header.version != SCENE_PACK_VERSION)
+    {
+        return fail(std::format("format version {} instead of {}", header.version, SCENE_PACK_VERSION));
+    }
+    if (header.fileSize != fileSize)
+    {
+        return fail(std::format("{} bytes instead of {}", fileSize, header.fileSize));
+    }
+    if (header.settingsHash != settingsHash)
+    {
+        return fail("written with different stream formats or preprocessing options");
+    }
+
+    const uint64_t metadataSize = GetMetadataSize(header.numSources, header.numMeshes, header.numInstances, header.stringDataSize);
+    if (header.dataOffset > fileSize || sizeof(PackHeader) + metadataSize > header.dataOffset)
+    {
+        return fail("invalid metadata size");
+    }
+    const uint8_t* metadata = data + sizeof(PackHeader);
+    if (Hash64(metadata, static_cast<size_t>(metadataSize)) != header.metadataHash)
+    {
+        return fail("metadata hash mismatch");
+    }
+
+    const uint8_t* sourceTable = metadata;
+    const uint8_t* meshTable = sourceTable + static_cast<size_t>(header.numSources) * sizeof(PackSource);
+    const uint8_t* instanceTable = meshTable + static_cast<size_t>(header.numMeshes) * sizeof(PackMesh);
+    const char* stringData = reinterpret_cast<const char*>(instanceTable + static_cast<size_t>(header.numInstances) * sizeof(ScenePackInstance));
+    auto isStringValid = [&](uint32_t offset, uint32_t length)
+    {
+        return offset <= header.stringDataSize && length <= header.stringDataSize - offset;
+    };
+
+    // Meshes, the blocks are views of the mapping
+    m_meshes.resize(header.numMeshes);
+    uint64_t dataSize = 0;
+    for (uint32_t i = 0; i < header.numMeshes; ++i)
+    {
+        PackMesh packMesh;
+        memcpy(&packMesh, meshTable + static_cast<size_t>(i) * sizeof(PackMesh), sizeof(packMesh));
+        if (!IsBlockInFile(packMesh.positionOffset, packMesh.positionDataSize, header.dataOffset, fileSize) ||
+            !IsBlockInFile(packMesh.attributeOffset, packMesh.attributeDataSize, header.dataOffset, fileSize) ||
+            !IsBlockInFile(packMesh.indexOffset, packMesh.indexDataSize, header.dataOffset, fileSize) ||
+            (packMesh.indexStride != 2 && packMesh.indexStride != 4) ||
+            packMesh.indexDataSize != static_cast<uint64_t>(packMesh.indexCount) * packMesh.indexStride || packMesh.indexCount % 3 != 0 ||
+            !isStringValid(packMesh.nameOffset, packMesh.nameLength))
+        {
+            return fail(std::format("invalid mesh {}", i));
+        }
+
+        ScenePackMesh& mesh = m_meshes[i];
+        mesh.name.assign(stringData + packMesh.nameOffset, packMesh.nameLength);
+        mesh.positionData = data + packMesh.positionOffset;
+        mesh.positionDataSize = packMesh.positionDataSize;
+        mesh.attributeData = data + packMesh.attributeOffset;
+        mesh.attributeDataSize = packMesh.attributeDataSize;
+        mesh.indexData = data + packMesh.indexOffset;
+        mesh.indexDataSize = packMesh.indexDataSize;
+        mesh.vertexCount = packMesh.vertexCount;
+        mesh.indexCount = packMesh.indexCount;
+        mesh.indexStride = packMesh.indexStride;
+        memcpy(mesh.geometryTransform, packMesh.geometryTransform, sizeof(mesh.geometryTransform));
+        dataSize += mesh.positionDataSize + mesh.attributeDataSize + mesh.indexDataSize;
+    }
+
+    m_instances.resize(header.numInstances);
+    memcpy(m_instances.data(), instanceTable, m_instances.size() * sizeof(ScenePackInstance));
+    for (const ScenePackInstance& instance : m_instances)
+    {
+        if (instance.meshIndex >= header.numMeshes)
+        {
+            return fail("invalid instance");
+        }
+    }
+
+    // Sources: unchanged size and write time are trusted, a changed write time is checked with the content hash
+    const std::filesystem::path directory = std::filesystem::path(path).parent_path();
+    uint32_t numHashedSources = 0;
+    m_sources.resize(header.numSources);
+    for (uint32_t i = 0; i < header.numSources; ++i)
+    {
+        PackSource packSource;
+        memcpy(&packSource, sourceTable + static_cast<size_t>(i) * sizeof(PackSource), sizeof(packSource));
+        if (!isStringValid(packSource.pathOffset, packSource.pathLength))
+        {
+            return fail(std::format("invalid source {}", i));
+        }
+
+        const std::filesystem::path storedPath(std::string(stringData + packSource.pathOffset, packSource.pathLength));
+        const std::string sourcePath = (storedPath.is_absolute() ? storedPath : directory / storedPath).string();
+        ScenePackSource current;
+        if (!GetScenePackSource(sourcePath, nullptr, current))
+        {
+            return fail(std::format("source {} is missing", sourcePath));
+        }
+        if (current.size != packSource.size)
+        {
+            return fail(std::format("source {} changed", sourcePath));
+        }
+        if (current.writeTime != packSource.writeTime)
+        {
+            ++numHashedSources;
+            if (!GetScenePackSource(sourcePath, &threadPool, current) || current.contentHash != packSource.contentHash)
+            {
+                return fail(std::format("source {} changed", sourcePath));
+            }
+        }
+
+        ScenePackSource& source = m_sources[i];
+        source.path = sourcePath;
+        source.size = packSource.size;
+        source.writeTime = packSource.writeTime;
+        source.contentHash = packSource.contentHash;
+    }
+
+    if (stats)
+    {
+        *stats = {};
+        stats->fileSize = fileSize;
+        stats->dataSize = dataSize;
+        stats->numMeshes = header.numMeshes;
+        stats->numInstances = header.numInstances;
+        stats->numSources = header.numSources;
+        stats->numHashedSources = numHashedSources;
+        stats->milliseconds = MillisecondsSince(startTime);
+    }
+    return true;
+}
+
+void ScenePack::Close()
+{
+    m_meshes.clear();
+    m_instances.clear();
+    m_sources.clear();
+    m_file.Close();
+}
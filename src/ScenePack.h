@@ -0,0 +1,103 @@
+#pragma once
+
+#include "MappedFile.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// Versioned binary cache of a preprocessed scene (.scenepack next to the scene file).
+//
+// A pack holds the uploaded vertex streams and index buffers of every mesh and the instance table, so that a scene is
+// opened by mapping the pack and copying the streams from the mapped pages into the geometry heap, without parsing
+// or preprocessing. Every data block starts on a page boundary. The metadata (tables and names) is at the start of
+// the file and checked with a hash.
+//
+// A pack is valid for the settings hash it was written with (stream formats, preprocessing options, format version)
+// and for its source files: a source whose size and write time are unchanged is trusted, a source whose write time
+// changed is hashed and compared with the content hash recorded when the pack was written.
+// Materials are the vertex colors of the attribute stream, there is no separate material table.
+//
+// This module has no Direct3D12 dependency.
+
+const uint32_t SCENE_PACK_VERSION = 1;
+const uint32_t SCENE_PACK_ALIGNMENT = 4096;
+
+// Mesh streams as they are uploaded, pointing into the mapped pack or into the memory of the writer
+struct ScenePackMesh
+{
+    std::string name;
+    const void* positionData;
+    uint64_t positionDataSize;
+    const void* attributeData;
+    uint64_t attributeDataSize;
+    const void* indexData;
+    uint64_t indexDataSize;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t indexStride;
+    float geometryTransform[12];    // dequantization of snorm16 positions, row-major 3x4
+};
+
+// TLAS instance, the transform is the row-major 3x4 object to world matrix
+struct ScenePackInstance
+{
+    uint32_t meshIndex;
+    float transform[3][4];
+};
+
+struct ScenePackSource
+{
+    std::string path;
+    uint64_t size;
+    uint64_t writeTime;
+    uint64_t contentHash;
+};
+
+struct ScenePackStats
+{
+    uint64_t fileSize;
+    uint64_t dataSize;              // bytes of the mesh streams
+    uint32_t numMeshes;
+    uint32_t numInstances;
+    uint32_t numSources;
+    uint32_t numHashedSources;      // sources whose write time changed and were hashed
+    double milliseconds;            // map and validate, or write
+};
+
+// Path of the pack of a scene file
+std::string GetScenePackPath(const std::string& scenePath);
+
+// Size and write time of a file, and its content hash if threadPool is not null
+bool GetScenePackSource(const std::string& path, ThreadPool* threadPool, ScenePackSource& source);
+
+// Write a pack of the meshes and instances loaded from sourcePaths. The pack is written to a temporary file which
+// replaces path once it is complete.
+bool WriteScenePack(const char* path, uint64_t settingsHash, const std::vector<std::string>& sourcePaths,
+    const std::vector<ScenePackMesh>& meshes, const std::vector<ScenePackInstance>& instances, ThreadPool& threadPool,
+    ScenePackStats* stats = nullptr, std::string* error = nullptr);
+
+class ScenePack
+{
+public:
+    ScenePack() = default;
+
+    ScenePack(const ScenePack&) = delete;
+    ScenePack& operator=(const ScenePack&) = delete;
+
+    // Map a pack and validate it against the settings hash and its sources. Returns false with the reason if the
+    // pack is missing, malformed or stale. The mesh data stays mapped until Close() or destruction.
+    bool Open(const char* path, uint64_t settingsHash, ThreadPool& threadPool, ScenePackStats* stats = nullptr, std::string* error = nullptr);
+    void Close();
+
+    const std::vector<ScenePackMesh>& GetMeshes() const { return m_meshes; }
+    const std::vector<ScenePackInstance>& GetInstances() const { return m_instances; }
+    const std::vector<ScenePackSource>& GetSources() const { return m_sources; }
+
+private:
+    MappedFile m_file;
+    std::vector<ScenePackMesh> m_meshes;
+    std::vector<ScenePackInstance> m_instances;
+    std::vector<ScenePackSource> m_sources;
+};
@@ -0,0 +1,92 @@
+#include "ShaderPermutation.h"
+#include "RayPayloads.h"
+#include <algorithm>
+#include <format>
+#include <iterator>
+
+namespace
+{
+    const ShaderPermutationAxisDesc AXES[] = {
+        { "MaxBounces", "PERMUTATION_MAX_BOUNCES", MAX_SPECIALIZED_BOUNCES + 1 },
+        { "NEE", "PERMUTATION_DISABLE_NEE", static_cast<uint32_t>(NextEventEstimation::Count) },
+        { "DebugView", "PERMUTATION_DEBUG_VIEW", static_cast<uint32_t>(DebugView::Count) },
+        { "PayloadPrecision", "PERMUTATION_PACKED_PAYLOAD", static_cast<uint32_t>(PayloadPrecision::Count) },
+    };
+    static_assert(std::size(AXES) == static_cast<size_t>(ShaderPermutationAxis::Count), "Missing shader permutation axis");
+
+    const char* DEBUG_VIEW_NAMES[] = { "None", "Albedo", "Normal", "Hit Distance" };
+    static_assert(std::size(DEBUG_VIEW_NAMES) == static_cast<size_t>(DebugView::Count), "Missing debug view name");
+}
+
+const ShaderPermutationAxisDesc& GetShaderPermutationAxisDesc(ShaderPermutationAxis axis)
+{
+    return AXES[static_cast<uint32_t>(axis)];
+}
+
+const char* GetDebugViewName(DebugView view)
+{
+    return view < DebugView::Count ? DEBUG_VIEW_NAMES[static_cast<uint32_t>(view)] : "Unknown";
+}
+
+void ShaderPermutationKey::Set(ShaderPermutationAxis axis, uint32_t value)
+{
+    values[static_cast<uint32_t>(axis)] = std::min(value, GetShaderPermutationAxisDesc(axis).valueCount - 1);
+}
+
+uint32_t ShaderPermutationKey::Pack() const
+{
+    uint32_t packed = 0;
+    for (uint32_t axis = static_cast<uint32_t>(ShaderPermutationAxis::Count); axis-- > 0;)
+    {
+        packed = packed * AXES[axis].valueCount + values[axis];
+    }
+    return packed;
+}
+
+ShaderPermutationKey ShaderPermutationKey::Unpack(uint32_t packed)
+{
+    ShaderPermutationKey key;
+    for (uint32_t axis = 0; axis < static_cast<uint32_t>(ShaderPermutationAxis::Count); ++axis)
+    {
+        key.values[axis] = packed % AXES[axis].valueCount;
+        packed /= AXES[axis].valueCount;
+    }
+    return key;
+}
+
+uint32_t GetShaderPermutationCount()
+{
+    uint32_t count = 1;
+    for (const ShaderPermutationAxisDesc& axis : AXES)
+    {
+        count *= axis.valueCount;
+    }
+    return count;
+}
+
+std::vector<std::string> GetShaderPermutationDefines(const ShaderPermutationKey& key)
+{
+    std::vector<std::string> defines;
+    for (uint32_t axis = 0; axis < static_cast<uint32_t>(ShaderPermutationAxis::Count); ++axis)
+    {
+        defines.push_back(std::format("{}={}", AXES[axis].define, key.values[axis]));
+    }
+    return defines;
+}
+
+std::string GetShaderPermutationName(const ShaderPermutationKey& key)
+{
+    std::string name;
+    for (uint32_t axis = 0; axis < static_cast<uint32_t>(ShaderPermutationAxis::Count); ++axis)
+    {
+        name += std::format("{}{}={}", axis == 0 ? "" : " ", AXES[axis].name, key.values[axis]);
+    }
+    return name;
+}
+
+uint32_t GetRayPayloadSize(const ShaderPermutationKey& key)
+{
+    // The shadow payload is smaller than both radiance payloads, checked in shaders/RayPayloads.hlsli
+    const bool isPacked = key.Get(ShaderPermutationAxis::PayloadPrecision) == static_cast<uint32_t>(PayloadPrecision::Packed);
+    return isPacked ? sizeof(ShaderLayout::RayPayloadPacked) : sizeof(ShaderLayout::RayPayloadFull);
+}
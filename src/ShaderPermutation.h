@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Permutations of the path tracing megakernel (shaders/Raytracing.hlsl).
+//
+// Every axis is a compile time switch of the ray tracing library, passed to DXC as -D<define>=<value>. The shader
+// defaults every define to the value 0 of its axis, so the library compiles without defines as the generic kernel:
+//   MaxBounces        PERMUTATION_MAX_BOUNCES      0 reads the bounce limit from the root constants, 1 to
+//                                                  MAX_SPECIALIZED_BOUNCES compiles it in so the loop has a constant
+//                                                  trip count
+//   NEE               PERMUTATION_DISABLE_NEE      0 samples the environment with the shadow rays, 1 only follows the
+//                                                  BSDF samples (no shadow rays, no MIS)
+//   DebugView         PERMUTATION_DEBUG_VIEW       DebugView, a surface attribute of the primary hit instead of the path
+//   PayloadPrecision  PERMUTATION_PACKED_PAYLOAD   PayloadPrecision, the radiance payload as floats or packed words
+//
+// A key holds one value per axis and packs into a dense index (mixed radix over the value counts), which identifies
+// the permutation in the pipeline cache and the shader tables.
+//
+// This module has no Direct3D12 dependency.
+
+const uint32_t MAX_SPECIALIZED_BOUNCES = 32;
+
+enum class ShaderPermutationAxis : uint32_t
+{
+    MaxBounces,
+    NEE,
+    DebugView,
+    PayloadPrecision,
+    Count
+};
+
+// Values of the NEE axis, On is the default
+enum class NextEventEstimation : uint32_t
+{
+    On,
+    Off,
+    Count
+};
+
+// Values of the DebugView axis, DEBUG_VIEW_* in shaders/Raytracing.hlsl
+enum class DebugView : uint32_t
+{
+    None,
+    Albedo,
+    Normal,
+    HitDistance,
+    Count
+};
+
+// Values of the PayloadPrecision axis, the radiance payloads of shaders/RayPayloads.hlsli
+enum class PayloadPrecision : uint32_t
+{
+    Full,       // RayPayloadFull: float3 albedo, float hitT, float3 normal
+    Packed,     // RayPayloadPacked: RGB9E5 albedo, octahedral normal, float hitT
+    Count
+};
+
+struct ShaderPermutationAxisDesc
+{
+    const char* name;
+    const char* define;
+    uint32_t valueCount;
+};
+
+const ShaderPermutationAxisDesc& GetShaderPermutationAxisDesc(ShaderPermutationAxis axis);
+const char* GetDebugViewName(DebugView view);
+
+struct ShaderPermutationKey
+{
+    uint32_t values[static_cast<uint32_t>(ShaderPermutationAxis::Count)] = {};
+
+    uint32_t Get(ShaderPermutationAxis axis) const { return values[static_cast<uint32_t>(axis)]; }
+
+    // Values outside of the axis are clamped to its last value
+    void Set(ShaderPermutationAxis axis, uint32_t value);
+
+    // Dense index of the key, less than GetShaderPermutationCount()
+    uint32_t Pack() const;
+    static ShaderPermutationKey Unpack(uint32_t packed);
+
+    bool operator==(const ShaderPermutationKey& other) const { return Pack() == other.Pack(); }
+    bool operator!=(const ShaderPermutationKey& other) const { return !(*this == other); }
+};
+
+uint32_t GetShaderPermutationCount();
+
+// "<define>=<value>" for every axis, the arguments of -D
+std::vector<std::string> GetShaderPermutationDefines(const ShaderPermutationKey& key);
+
+// "MaxBounces=8 NEE=0 DebugView=0 PayloadPrecision=1" for logs and the UI
+std::string GetShaderPermutationName(const ShaderPermutationKey& key);
+
+// MaxPayloadSizeInBytes of the ray tracing pipeline of the key, the radiance payload is the largest one
+uint32_t GetRayPayloadSize(const ShaderPermutationKey& key);
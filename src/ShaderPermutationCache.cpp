@@ -0,0 +1,198 @@
+#include "ShaderPermutationCache.h"
+#include "Helper.h"
+#include <algorithm>
+#include <chrono>
+#include <format>
+
+ShaderPermutationCache::ShaderPermutationCache() :
+    m_numCompiling(0),
+    m_stop(false)
+{
+}
+
+ShaderPermutationCache::~ShaderPermutationCache()
+{
+    Shutdown();
+}
+
+void ShaderPermutationCache::Initialize(CreateFunction create, uint32_t numThreads)
+{
+    Shutdown();
+    m_create = std::move(create);
+    m_stop = false;
+    for (uint32_t i = 0; i < std::max(numThreads, 1u); ++i)
+    {
+        m_workers.emplace_back(&ShaderPermutationCache::WorkerMain, this);
+    }
+}
+
+void ShaderPermutationCache::Shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+
+        // Queued keys are compiled again when they are requested after a new Initialize()
+        for (uint32_t packedKey : m_queue)
+        {
+            m_entries.erase(packedKey);
+        }
+        m_queue.clear();
+    }
+    m_workAvailable.notify_all();
+    for (std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+    m_workers.clear();
+}
+
+ID3D12StateObject* ShaderPermutationCache::Request(const ShaderPermutationKey& key)
+{
+    const uint32_t packedKey = key.Pack();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(packedKey);
+    if (it == m_entries.end())
+    {
+        m_entries.emplace(packedKey, Entry());
+        m_queue.push_back(packedKey);
+        lock.unlock();
+        m_workAvailable.notify_one();
+        return nullptr;
+    }
+
+    // A queued key requested again moves to the back of the queue
+    if (it->second.state == EntryState::Queued)
+    {
+        auto queued = std::find(m_queue.begin(), m_queue.end(), packedKey);
+        if (queued != m_queue.end() && queued + 1 != m_queue.end())
+        {
+            m_queue.erase(queued);
+            m_queue.push_back(packedKey);
+        }
+    }
+    return it->second.state == EntryState::Ready ? it->second.stateObject.Get() : nullptr;
+}
+
+ID3D12StateObject* ShaderPermutationCache::Compile(const ShaderPermutationKey& key)
+{
+    const uint32_t packedKey = key.Pack();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        // A stale compilation of another thread is erased when it completes, the key is compiled again here
+        Entry& entry = m_entries[packedKey];
+        if (entry.state == EntryState::Queued)
+        {
+            m_queue.erase(std::remove(m_queue.begin(), m_queue.end(), packedKey), m_queue.end());
+            CompileEntry(packedKey, lock);
+        }
+        else if (entry.state == EntryState::Compiling)
+        {
+            m_entryCompiled.wait(lock);
+        }
+        else
+        {
+            return entry.state == EntryState::Ready ? entry.stateObject.Get() : nullptr;
+        }
+    }
+}
+
+void ShaderPermutationCache::Invalidate(std::vector<ComPtr<ID3D12StateObject>>& stateObjects)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_entries.begin(); it != m_entries.end();)
+    {
+        Entry& entry = it->second;
+        if (entry.state == EntryState::Compiling)
+        {
+            entry.isStale = true;
+            ++it;
+        }
+        else if (entry.state == EntryState::Queued)
+        {
+            ++it;
+        }
+        else
+        {
+            if (entry.stateObject)
+            {
+                stateObjects.push_back(entry.stateObject);
+            }
+            it = m_entries.erase(it);
+        }
+    }
+}
+
+bool ShaderPermutationCache::IsFailed(const ShaderPermutationKey& key) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(key.Pack());
+    return it != m_entries.end() && it->second.state == EntryState::Failed;
+}
+
+std::string ShaderPermutationCache::GetErrors(const ShaderPermutationKey& key) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(key.Pack());
+    return it != m_entries.end() ? it->second.errors : std::string();
+}
+
+uint32_t ShaderPermutationCache::GetPendingCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return static_cast<uint32_t>(m_queue.size()) + m_numCompiling;
+}
+
+void ShaderPermutationCache::WorkerMain()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        m_workAvailable.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+        if (m_stop)
+        {
+            return;
+        }
+        const uint32_t packedKey = m_queue.back();
+        m_queue.pop_back();
+        CompileEntry(packedKey, lock);
+    }
+}
+
+void ShaderPermutationCache::CompileEntry(uint32_t packedKey, std::unique_lock<std::mutex>& lock)
+{
+    // Entries are never erased while compiling, the reference stays valid without the lock
+    Entry& entry = m_entries[packedKey];
+    entry.state = EntryState::Compiling;
+    ++m_numCompiling;
+    lock.unlock();
+
+    const ShaderPermutationKey key = ShaderPermutationKey::Unpack(packedKey);
+    const auto startTime = std::chrono::steady_clock::now();
+    std::string errors;
+    ComPtr<ID3D12StateObject> stateObject = m_create(key, errors);
+    const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    if (stateObject)
+    {
+        OutputDebugStringA(std::format("Shader permutation [{}] compiled in {:.1f} ms.\n", GetShaderPermutationName(key), milliseconds).c_str());
+    }
+    else
+    {
+        OutputDebugStringA(std::format("Shader permutation [{}] failed to compile.\n", GetShaderPermutationName(key)).c_str());
+    }
+
+    lock.lock();
+    --m_numCompiling;
+    if (entry.isStale)
+    {
+        m_entries.erase(packedKey);
+    }
+    else
+    {
+        entry.stateObject = stateObject;
+        entry.errors = std::move(errors);
+        entry.state = stateObject ? EntryState::Ready : EntryState::Failed;
+    }
+    m_entryCompiled.notify_all();
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl/client.h>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "ShaderPermutation.h"
+
+using Microsoft::WRL::ComPtr;
+
+// State objects of shader permutations, created on background threads and cached by the packed key.
+//
+// Request() returns the state object of a key once it is compiled and queues the key the first time it is seen, so
+// the render thread keeps the pipeline it has until the requested one is ready and never waits for DXC. The most
+// recent request is compiled first: when a setting is flipped several times the permutation in use next is not
+// behind the ones it replaced. Compiled and failed permutations stay in the cache, so flipping back is immediate and
+// a state object is never released while a frame in flight uses it. Invalidate() hands the compiled state objects to
+// the caller, which releases them once the frames using them are complete, and compiles every key again from the
+// current sources when it is requested.
+class ShaderPermutationCache
+{
+public:
+    // Compile and create the state object of a key, null on failure with the compiler output in errors. Called on the
+    // compile threads and must not touch state of the render thread.
+    using CreateFunction = std::function<ComPtr<ID3D12StateObject>(const ShaderPermutationKey& key, std::string& errors)>;
+
+    ShaderPermutationCache();
+    ~ShaderPermutationCache();
+
+    ShaderPermutationCache(const ShaderPermutationCache&) = delete;
+    ShaderPermutationCache& operator=(const ShaderPermutationCache&) = delete;
+
+    void Initialize(CreateFunction create, uint32_t numThreads);
+
+    // Finish the compilations in progress, drop the queued ones and stop the threads
+    void Shutdown();
+
+    // State object of the key, null while it is queued or compiling and when it failed
+    ID3D12StateObject* Request(const ShaderPermutationKey& key);
+
+    // State object of the key compiled on the calling thread unless it is cached, null when it failed
+    ID3D12StateObject* Compile(const ShaderPermutationKey& key);
+
+    // Forget every permutation and move the compiled state objects to stateObjects. A compilation in progress is
+    // dropped when it completes, its sources may be older than the change.
+    void Invalidate(std::vector<ComPtr<ID3D12StateObject>>& stateObjects);
+
+    bool IsFailed(const ShaderPermutationKey& key) const;
+
+    // Compiler output of the last compilation of the key, warnings included
+    std::string GetErrors(const ShaderPermutationKey& key) const;
+
+    // Queued and compiling permutations
+    uint32_t GetPendingCount() const;
+
+private:
+    enum class EntryState : uint32_t
+    {
+        Queued,
+        Compiling,
+        Ready,
+        Failed
+    };
+
+    struct Entry
+    {
+        EntryState state = EntryState::Queued;
+        bool isStale = false;           // invalidated while compiling
+        ComPtr<ID3D12StateObject> stateObject;
+        std::string errors;
+    };
+
+    void WorkerMain();
+
+    // Run the create function outside of the lock and store the result
+    void CompileEntry(uint32_t packedKey, std::unique_lock<std::mutex>& lock);
+
+    CreateFunction m_create;
+    std::vector<std::thread> m_workers;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_entryCompiled;
+    std::unordered_map<uint32_t, Entry> m_entries;
+    std::vector<uint32_t> m_queue;      // packed keys, the back is compiled first
+    uint32_t m_numCompiling;
+    bool m_stop;
+};
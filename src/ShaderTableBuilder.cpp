@@ -0,0 +1,221 @@
+#include "ShaderTableBuilder.h"
+#include "Helper.h"
+#include <cstring>
+
+static_assert(SHADER_IDENTIFIER_SIZE == D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES, "ShaderTableLayout must match d3d12.h");
+static_assert(SHADER_RECORD_ALIGNMENT == D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT, "ShaderTableLayout must match d3d12.h");
+static_assert(SHADER_TABLE_ALIGNMENT == D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT, "ShaderTableLayout must match d3d12.h");
+static_assert(MAX_SHADER_RECORD_STRIDE == D3D12_RAYTRACING_MAX_SHADER_RECORD_STRIDE, "ShaderTableLayout must match d3d12.h");
+
+namespace
+{
+    ComPtr<ID3D12Resource> CreateTableBuffer(ID3D12Device* device, uint64_t size, D3D12_HEAP_TYPE heapType, D3D12_RESOURCE_STATES state, const std::wstring& name)
+    {
+        D3D12_HEAP_PROPERTIES heapProperties = {};
+        heapProperties.Type = heapType;
+
+        D3D12_RESOURCE_DESC bufferDesc = {};
+        bufferDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+        bufferDesc.Width = size;
+        bufferDesc.Height = 1;
+        bufferDesc.DepthOrArraySize = 1;
+        bufferDesc.MipLevels = 1;
+        bufferDesc.Format = DXGI_FORMAT_UNKNOWN;
+        bufferDesc.SampleDesc.Count = 1;
+        bufferDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+
+        ComPtr<ID3D12Resource> buffer;
+        ThrowIfFailed(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc, state, nullptr, IID_PPV_ARGS(&buffer)));
+        buffer->SetName(name.c_str());
+        return buffer;
+    }
+}
+
+void ShaderTableBuilder::Reset()
+{
+    m_layout.Reset();
+    for (std::vector<Record>& records : m_records)
+    {
+        records.clear();
+    }
+    if (m_uploadBuffer)
+    {
+        m_uploadBuffer->Unmap(0, nullptr);
+    }
+    m_stateObjectProperties.Reset();
+    m_buffer.Reset();
+    m_uploadBuffer.Reset();
+    m_uploadData = nullptr;
+    m_frameCount = 0;
+    m_isInitialState = true;
+    m_data.clear();
+    m_changedRanges.Take();
+}
+
+uint32_t ShaderTableBuilder::AddRecord(ShaderTableSection section, const wchar_t* exportName, const void* localRootArguments, uint32_t localRootArgumentsSize)
+{
+    const uint32_t index = m_layout.AddRecord(section, localRootArgumentsSize);
+    Record record;
+    record.exportName = exportName ? exportName : L"";
+    record.localRootArguments.resize(localRootArgumentsSize, 0);
+    if (localRootArguments)
+    {
+        memcpy(record.localRootArguments.data(), localRootArguments, localRootArgumentsSize);
+    }
+    m_records[static_cast<uint32_t>(section)].push_back(std::move(record));
+    return index;
+}
+
+uint32_t ShaderTableBuilder::AddHitGroupRecords(const wchar_t* const* rayTypeExports, uint32_t rayTypeCount, uint32_t geometryCount, uint32_t localRootArgumentsSize)
+{
+    const uint32_t firstIndex = m_layout.AddHitGroupRecords(geometryCount, rayTypeCount, localRootArgumentsSize);
+    std::vector<Record>& records = m_records[static_cast<uint32_t>(ShaderTableSection::HitGroup)];
+    for (uint32_t geometry = 0; geometry < geometryCount; ++geometry)
+    {
+        for (uint32_t rayType = 0; rayType < rayTypeCount; ++rayType)
+        {
+            Record record;
+            record.exportName = rayTypeExports[rayType] ? rayTypeExports[rayType] : L"";
+            record.localRootArguments.resize(localRootArgumentsSize, 0);
+            records.push_back(std::move(record));
+        }
+    }
+    return firstIndex;
+}
+
+void ShaderTableBuilder::Build(ID3D12Device* device, ID3D12StateObject* stateObject, uint32_t frameCount, const wchar_t* name)
+{
+    if (!m_layout.Finalize())
+    {
+        ThrowIfFailed(E_INVALIDARG);
+    }
+    ThrowIfFailed(stateObject->QueryInterface(IID_PPV_ARGS(&m_stateObjectProperties)));
+
+    // The table is read as NON_PIXEL_SHADER_RESOURCE, the first upload moves it there
+    const uint64_t size = m_layout.GetSize();
+    m_frameCount = frameCount;
+    m_buffer = CreateTableBuffer(device, size, D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_STATE_COPY_DEST, name);
+    m_uploadBuffer = CreateTableBuffer(device, size * frameCount, D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_STATE_GENERIC_READ, std::wstring(name) + L" Upload");
+    ThrowIfFailed(m_uploadBuffer->Map(0, nullptr, reinterpret_cast<void**>(&m_uploadData)));
+    m_isInitialState = true;
+
+    // Padding between the records and the sections stays zero
+    m_data.assign(size, 0);
+    for (uint32_t section = 0; section < static_cast<uint32_t>(ShaderTableSection::Count); ++section)
+    {
+        for (uint32_t index = 0; index < static_cast<uint32_t>(m_records[section].size()); ++index)
+        {
+            WriteRecord(static_cast<ShaderTableSection>(section), index);
+        }
+    }
+    m_changedRanges.Take();
+    m_changedRanges.Add(0, size);
+}
+
+void ShaderTableBuilder::SetLocalRootArguments(ShaderTableSection section, uint32_t index, const void* localRootArguments, uint32_t localRootArgumentsSize)
+{
+    Record& record = m_records[static_cast<uint32_t>(section)][index];
+    if (localRootArgumentsSize > record.localRootArguments.size())
+    {
+        OutputDebugStringA("Local root arguments larger than their shader record\n");
+        return;
+    }
+    memcpy(record.localRootArguments.data(), localRootArguments, localRootArgumentsSize);
+    if (IsBuilt())
+    {
+        WriteRecord(section, index);
+    }
+}
+
+void ShaderTableBuilder::SetRecordExport(ShaderTableSection section, uint32_t index, const wchar_t* exportName)
+{
+    m_records[static_cast<uint32_t>(section)][index].exportName = exportName ? exportName : L"";
+    if (IsBuilt())
+    {
+        WriteRecord(section, index);
+    }
+}
+
+void ShaderTableBuilder::WriteRecord(ShaderTableSection section, uint32_t index)
+{
+    const Record& record = m_records[static_cast<uint32_t>(section)][index];
+    const uint64_t offset = m_layout.GetRecordOffset(section, index);
+    uint8_t* data = m_data.data() + offset;
+
+    // A null shader identifier is valid in miss and hit group records and runs no shader
+    if (record.exportName.empty())
+    {
+        memset(data, 0, SHADER_IDENTIFIER_SIZE);
+    }
+    else
+    {
+        const void* identifier = m_stateObjectProperties->GetShaderIdentifier(record.exportName.c_str());
+        if (!identifier)
+        {
+            OutputDebugStringW((L"Failed to get the shader identifier of " + record.exportName + L"\n").c_str());
+            ThrowIfFailed(E_FAIL);
+        }
+        memcpy(data, identifier, SHADER_IDENTIFIER_SIZE);
+    }
+    if (!record.localRootArguments.empty())
+    {
+        memcpy(data + SHADER_IDENTIFIER_SIZE, record.localRootArguments.data(), record.localRootArguments.size());
+    }
+    m_changedRanges.Add(offset, offset + SHADER_IDENTIFIER_SIZE + record.localRootArguments.size());
+}
+
+void ShaderTableBuilder::Upload(ID3D12GraphicsCommandList* commandList, uint32_t frameIndex)
+{
+    if (!IsBuilt() || m_changedRanges.Empty() || frameIndex >= m_frameCount)
+    {
+        return;
+    }
+
+    D3D12_RESOURCE_BARRIER barrier = {};
+    barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+    barrier.Transition.pResource = m_buffer.Get();
+    barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+    barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_COPY_DEST;
+    barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+    if (!m_isInitialState)
+    {
+        commandList->ResourceBarrier(1, &barrier);
+    }
+
+    // The upload copy of this frame index is no longer read by the GPU, the frame that used it has completed
+    const uint64_t uploadOffset = m_layout.GetSize() * frameIndex;
+    for (const WriteRangeAccumulator::Range& range : m_changedRanges.Take())
+    {
+        StreamCopy(m_uploadData + uploadOffset + range.begin, m_data.data() + range.begin, range.end - range.begin);
+        commandList->CopyBufferRegion(m_buffer.Get(), range.begin, m_uploadBuffer.Get(), uploadOffset + range.begin, range.end - range.begin);
+    }
+
+    std::swap(barrier.Transition.StateBefore, barrier.Transition.StateAfter);
+    commandList->ResourceBarrier(1, &barrier);
+    m_isInitialState = false;
+}
+
+void ShaderTableBuilder::GetDispatchRaysDesc(uint32_t rayGenIndex, uint32_t width, uint32_t height, D3D12_DISPATCH_RAYS_DESC& dispatchDesc) const
+{
+    const D3D12_GPU_VIRTUAL_ADDRESS address = m_buffer->GetGPUVirtualAddress();
+    dispatchDesc = {};
+    dispatchDesc.RayGenerationShaderRecord.StartAddress = address + m_layout.GetRecordOffset(ShaderTableSection::RayGen, rayGenIndex);
+    dispatchDesc.RayGenerationShaderRecord.SizeInBytes = SHADER_IDENTIFIER_SIZE + m_layout.GetLocalRootArgumentsSize(ShaderTableSection::RayGen, rayGenIndex);
+
+    D3D12_GPU_VIRTUAL_ADDRESS_RANGE_AND_STRIDE* tables[] = { nullptr, &dispatchDesc.MissShaderTable, &dispatchDesc.HitGroupTable, &dispatchDesc.CallableShaderTable };
+    static_assert(_countof(tables) == static_cast<size_t>(ShaderTableSection::Count), "Missing shader table section");
+    for (uint32_t section = 1; section < static_cast<uint32_t>(ShaderTableSection::Count); ++section)
+    {
+        const ShaderTableSection tableSection = static_cast<ShaderTableSection>(section);
+        if (m_layout.GetRecordCount(tableSection) > 0)
+        {
+            tables[section]->StartAddress = address + m_layout.GetSectionOffset(tableSection);
+            tables[section]->SizeInBytes = m_layout.GetSectionSize(tableSection);
+            tables[section]->StrideInBytes = m_layout.GetStride(tableSection);
+        }
+    }
+
+    dispatchDesc.Width = width;
+    dispatchDesc.Height = height;
+    dispatchDesc.Depth = 1;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl/client.h>
+#include <string>
+#include <vector>
+#include "ShaderTableLayout.h"
+#include "UploadWriter.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Shader table of a DXR state object in a default heap buffer.
+//
+// Records are added with the export name of their shader (nullptr for a null record, which runs no shader) and their
+// local root arguments, ShaderTableLayout computes the strides and the sections. Build() creates the default heap
+// buffer and an upload buffer with one copy of the table per frame in flight, and keeps a CPU copy of the records.
+// SetLocalRootArguments() and SetRecordExport() change single records in the CPU copy; Upload() writes the changed
+// ranges to the upload copy of the frame and copies them to the default heap buffer on the frame's command list, so a
+// partial update neither rewrites the whole table nor touches the upload copy of a frame still in flight.
+class ShaderTableBuilder
+{
+public:
+    void Reset();
+
+    // Append a record and return its index in the section
+    uint32_t AddRecord(ShaderTableSection section, const wchar_t* exportName, const void* localRootArguments = nullptr, uint32_t localRootArgumentsSize = 0);
+
+    // Append rayTypeCount records per geometry with the hit group export of every ray type and localRootArgumentsSize
+    // zeroed bytes of local root arguments, return the index of the first one (the InstanceContributionToHitGroupIndex)
+    uint32_t AddHitGroupRecords(const wchar_t* const* rayTypeExports, uint32_t rayTypeCount, uint32_t geometryCount, uint32_t localRootArgumentsSize = 0);
+
+    // Lay out the records, look up the shader identifiers and create the buffers, all records are uploaded by the next
+    // Upload()
+    void Build(ID3D12Device* device, ID3D12StateObject* stateObject, uint32_t frameCount, const wchar_t* name);
+    bool IsBuilt() const { return m_buffer != nullptr; }
+
+    // Partial updates, uploaded by the next Upload(). The arguments must fit in the size the record was added with.
+    void SetLocalRootArguments(ShaderTableSection section, uint32_t index, const void* localRootArguments, uint32_t localRootArgumentsSize);
+    void SetRecordExport(ShaderTableSection section, uint32_t index, const wchar_t* exportName);
+
+    // Copy the changed records to the default heap buffer, nothing when no record changed
+    void Upload(ID3D12GraphicsCommandList* commandList, uint32_t frameIndex);
+
+    // Tables of a DispatchRays() with the ray generation record rayGenIndex
+    void GetDispatchRaysDesc(uint32_t rayGenIndex, uint32_t width, uint32_t height, D3D12_DISPATCH_RAYS_DESC& dispatchDesc) const;
+
+    const ShaderTableLayout& GetLayout() const { return m_layout; }
+
+private:
+    struct Record
+    {
+        std::wstring exportName;        // empty for a null record
+        std::vector<uint8_t> localRootArguments;
+    };
+
+    void WriteRecord(ShaderTableSection section, uint32_t index);
+
+    ShaderTableLayout m_layout;
+    std::vector<Record> m_records[static_cast<uint32_t>(ShaderTableSection::Count)];
+
+    ComPtr<ID3D12StateObjectProperties> m_stateObjectProperties;
+    ComPtr<ID3D12Resource> m_buffer;                // default heap, NON_PIXEL_SHADER_RESOURCE between uploads
+    ComPtr<ID3D12Resource> m_uploadBuffer;          // frameCount copies of the table
+    uint8_t* m_uploadData = nullptr;
+    uint32_t m_frameCount = 0;
+    bool m_isInitialState = true;                   // COPY_DEST until the first upload
+
+    std::vector<uint8_t> m_data;                    // CPU copy of the table
+    WriteRangeAccumulator m_changedRanges;
+};
@@ -0,0 +1,56 @@
+#include "ShaderTableLayout.h"
+#include "PlatformHelpers.h"
+#include <algorithm>
+#include <format>
+
+void ShaderTableLayout::Reset()
+{
+    for (Section& section : m_sections)
+    {
+        section = {};
+    }
+    m_size = 0;
+}
+
+uint32_t ShaderTableLayout::AddRecord(ShaderTableSection section, uint32_t localRootArgumentsSize)
+{
+    std::vector<uint32_t>& argumentSizes = m_sections[static_cast<uint32_t>(section)].argumentSizes;
+    argumentSizes.push_back(localRootArgumentsSize);
+    return static_cast<uint32_t>(argumentSizes.size() - 1);
+}
+
+uint32_t ShaderTableLayout::AddHitGroupRecords(uint32_t geometryCount, uint32_t rayTypeCount, uint32_t localRootArgumentsSize)
+{
+    std::vector<uint32_t>& argumentSizes = m_sections[static_cast<uint32_t>(ShaderTableSection::HitGroup)].argumentSizes;
+    const uint32_t firstIndex = static_cast<uint32_t>(argumentSizes.size());
+    argumentSizes.resize(argumentSizes.size() + static_cast<size_t>(geometryCount) * rayTypeCount, localRootArgumentsSize);
+    return firstIndex;
+}
+
+bool ShaderTableLayout::Finalize()
+{
+    uint64_t offset = 0;
+    for (uint32_t i = 0; i < static_cast<uint32_t>(ShaderTableSection::Count); ++i)
+    {
+        Section& section = m_sections[i];
+        uint32_t maxArgumentsSize = 0;
+        for (uint32_t argumentsSize : section.argumentSizes)
+        {
+            maxArgumentsSize = std::max(maxArgumentsSize, argumentsSize);
+        }
+
+        // Ray generation records are referenced one by one, at the table alignment
+        const uint32_t recordAlignment = i == static_cast<uint32_t>(ShaderTableSection::RayGen) ? SHADER_TABLE_ALIGNMENT : SHADER_RECORD_ALIGNMENT;
+        section.stride = section.argumentSizes.empty() ? 0 : AlignSize(SHADER_IDENTIFIER_SIZE + maxArgumentsSize, recordAlignment);
+        section.offset = AlignSize(offset, SHADER_TABLE_ALIGNMENT);
+        offset = section.offset + static_cast<uint64_t>(section.stride) * section.argumentSizes.size();
+
+        if (section.stride > MAX_SHADER_RECORD_STRIDE)
+        {
+            OutputDebugStringA(std::format("Shader table section {} has a record stride of {} bytes, the maximum is {}.\n", i, section.stride, MAX_SHADER_RECORD_STRIDE).c_str());
+            return false;
+        }
+    }
+    m_size = offset;
+    return true;
+}
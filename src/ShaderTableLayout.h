@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Layout of a DXR shader table: the sections of ray generation, miss, hit group and callable records in one buffer.
+//
+// A record is a shader identifier followed by the local root arguments of its shader. The records of a section share
+// one stride, the largest record rounded up to SHADER_RECORD_ALIGNMENT, because D3D12_DISPATCH_RAYS_DESC has one
+// stride per table. Every section starts at SHADER_TABLE_ALIGNMENT, and so does every ray generation record, as a
+// dispatch references a single ray generation record by its start address.
+//
+// Hit group records are indexed by DXR as
+//   InstanceContributionToHitGroupIndex + RayContributionToHitGroupIndex
+//       + MultiplierForGeometryContributionToHitGroupIndex * GeometryIndex
+// so AddHitGroupRecords() lays out rayTypeCount records per geometry: the ray type is the ray contribution, the ray
+// type count is the multiplier and the first returned index is the instance contribution.
+//
+// The constants mirror D3D12 and are checked against d3d12.h by ShaderTableBuilder. This module has no Direct3D12
+// dependency, the layout rules are checked on the CPU by tools/ShaderTableTool.
+
+const uint32_t SHADER_IDENTIFIER_SIZE = 32;         // D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES
+const uint32_t SHADER_RECORD_ALIGNMENT = 32;        // D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT
+const uint32_t SHADER_TABLE_ALIGNMENT = 64;         // D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT
+const uint32_t MAX_SHADER_RECORD_STRIDE = 4096;     // D3D12_RAYTRACING_MAX_SHADER_RECORD_STRIDE
+
+enum class ShaderTableSection : uint32_t
+{
+    RayGen,
+    Miss,
+    HitGroup,
+    Callable,
+    Count
+};
+
+inline uint32_t GetHitGroupRecordIndex(uint32_t instanceContribution, uint32_t rayContribution, uint32_t multiplier, uint32_t geometryIndex)
+{
+    return instanceContribution + rayContribution + multiplier * geometryIndex;
+}
+
+class ShaderTableLayout
+{
+public:
+    void Reset();
+
+    // Append a record with localRootArgumentsSize bytes after the identifier and return its index in the section
+    uint32_t AddRecord(ShaderTableSection section, uint32_t localRootArgumentsSize);
+
+    // Append the hit group records of geometryCount geometries, rayTypeCount consecutive records per geometry, and
+    // return the index of the first one
+    uint32_t AddHitGroupRecords(uint32_t geometryCount, uint32_t rayTypeCount, uint32_t localRootArgumentsSize);
+
+    // Compute the strides and the section offsets, false when a stride exceeds MAX_SHADER_RECORD_STRIDE
+    bool Finalize();
+
+    // Valid after Finalize()
+    uint64_t GetSize() const { return m_size; }
+    uint32_t GetRecordCount(ShaderTableSection section) const { return static_cast<uint32_t>(m_sections[static_cast<uint32_t>(section)].argumentSizes.size()); }
+    uint32_t GetLocalRootArgumentsSize(ShaderTableSection section, uint32_t index) const { return m_sections[static_cast<uint32_t>(section)].argumentSizes[index]; }
+    uint32_t GetStride(ShaderTableSection section) const { return m_sections[static_cast<uint32_t>(section)].stride; }
+    uint64_t GetSectionOffset(ShaderTableSection section) const { return m_sections[static_cast<uint32_t>(section)].offset; }
+    uint64_t GetSectionSize(ShaderTableSection section) const { return static_cast<uint64_t>(GetStride(section)) * GetRecordCount(section); }
+    uint64_t GetRecordOffset(ShaderTableSection section, uint32_t index) const { return GetSectionOffset(section) + static_cast<uint64_t>(GetStride(section)) * index; }
+
+private:
+    struct Section
+    {
+        std::vector<uint32_t> argumentSizes;
+        uint32_t stride = 0;
+        uint64_t offset = 0;
+    };
+
+    Section m_sections[static_cast<uint32_t>(ShaderTableSection::Count)];
+    uint64_t m_size = 0;
+};
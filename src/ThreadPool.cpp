@@ -0,0 +1,126 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+namespace
+{
+    // Set while the thread executes a task, nested ParallelFor() calls then run inline
+    thread_local bool t_isInsideTask = false;
+}
+
+ThreadPool::ThreadPool(uint32_t numThreads) :
+    m_task(nullptr),
+    m_numTasks(0),
+    m_generation(0),
+    m_numActiveWorkers(0),
+    m_stop(false),
+    m_nextTask(0)
+{
+    if (numThreads == 0)
+    {
+        numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    m_workers.reserve(numThreads - 1);
+    for (uint32_t i = 1; i < numThreads; ++i)
+    {
+        m_workers.emplace_back(&ThreadPool::WorkerMain, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_workAvailable.notify_all();
+
+    for (std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::ParallelFor(uint32_t numTasks, const std::function<void(uint32_t)>& task)
+{
+    if (numTasks == 0)
+    {
+        return;
+    }
+
+    if (m_workers.empty() || numTasks == 1 || t_isInsideTask)
+    {
+        for (uint32_t i = 0; i < numTasks; ++i)
+        {
+            task(i);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> parallelForLock(m_parallelForMutex);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = &task;
+        m_numTasks = numTasks;
+        m_nextTask.store(0, std::memory_order_relaxed);
+        ++m_generation;
+    }
+    m_workAvailable.notify_all();
+
+    RunTasks(task, numTasks);
+
+    // Workers register themselves before claiming a task, so no task is running once none is registered
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_workDone.wait(lock, [this]() { return m_numActiveWorkers == 0; });
+    m_task = nullptr;
+}
+
+void ThreadPool::WorkerMain()
+{
+    uint64_t lastGeneration = 0;
+    for (;;)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_workAvailable.wait(lock, [this, lastGeneration]() { return m_stop || m_generation != lastGeneration; });
+        if (m_stop)
+        {
+            return;
+        }
+
+        lastGeneration = m_generation;
+        if (!m_task)
+        {
+            // Woken after the ParallelFor() has already completed
+            continue;
+        }
+
+        const std::function<void(uint32_t)>& task = *m_task;
+        const uint32_t numTasks = m_numTasks;
+        ++m_numActiveWorkers;
+        lock.unlock();
+
+        RunTasks(task, numTasks);
+
+        lock.lock();
+        if (--m_numActiveWorkers == 0)
+        {
+            m_workDone.notify_all();
+        }
+    }
+}
+
+void ThreadPool::RunTasks(const std::function<void(uint32_t)>& task, uint32_t numTasks)
+{
+    t_isInsideTask = true;
+    for (;;)
+    {
+        const uint32_t i = m_nextTask.fetch_add(1, std::memory_order_relaxed);
+        if (i >= numTasks)
+        {
+            break;
+        }
+        task(i);
+    }
+    t_isInsideTask = false;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed size pool of worker threads for data parallel CPU work (file parsing, mesh preprocessing).
+// ParallelFor() blocks until all tasks have finished; the calling thread executes tasks as well.
+// Calls from inside a task run serially on the calling thread instead of deadlocking.
+class ThreadPool
+{
+public:
+    // numThreads includes the calling thread, 0 selects the number of hardware threads
+    explicit ThreadPool(uint32_t numThreads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Number of threads executing the tasks, including the calling thread
+    uint32_t GetNumThreads() const { return static_cast<uint32_t>(m_workers.size()) + 1; }
+
+    // Call task(i) for every i in [0, numTasks). Tasks are claimed dynamically, in increasing order.
+    void ParallelFor(uint32_t numTasks, const std::function<void(uint32_t)>& task);
+
+private:
+    void WorkerMain();
+    void RunTasks(const std::function<void(uint32_t)>& task, uint32_t numTasks);
+
+    std::vector<std::thread> m_workers;
+
+    // Serializes ParallelFor() calls from different threads
+    std::mutex m_parallelForMutex;
+
+    std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_workDone;
+    const std::function<void(uint32_t)>* m_task;
+    uint32_t m_numTasks;
+    uint64_t m_generation;
+    uint32_t m_numActiveWorkers;
+    bool m_stop;
+
+    std::atomic<uint32_t> m_nextTask;
+};
@@ -0,0 +1,178 @@
+#include "UploadWriter.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define UPLOAD_WRITER_USE_SSE 1
+#include <immintrin.h>
+#else
+#define UPLOAD_WRITER_USE_SSE 0
+#endif
+
+namespace
+{
+    // Write whole lines with non-temporal stores. destination must be LINE_SIZE aligned, size a multiple of LINE_SIZE.
+    void StreamLines(uint8_t* destination, const uint8_t* source, size_t size)
+    {
+        assert((reinterpret_cast<uintptr_t>(destination) & (UploadWriter::LINE_SIZE - 1)) == 0);
+        assert((size & (UploadWriter::LINE_SIZE - 1)) == 0);
+
+#if UPLOAD_WRITER_USE_SSE && defined(__AVX__)
+        for (size_t i = 0; i < size; i += UploadWriter::LINE_SIZE)
+        {
+            const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i));
+            const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i + 32));
+            _mm256_stream_si256(reinterpret_cast<__m256i*>(destination + i), a);
+            _mm256_stream_si256(reinterpret_cast<__m256i*>(destination + i + 32), b);
+        }
+#elif UPLOAD_WRITER_USE_SSE
+        for (size_t i = 0; i < size; i += UploadWriter::LINE_SIZE)
+        {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i + 16));
+            const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i + 32));
+            const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i + 48));
+            _mm_stream_si128(reinterpret_cast<__m128i*>(destination + i), a);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(destination + i + 16), b);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(destination + i + 32), c);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(destination + i + 48), d);
+        }
+#else
+        memcpy(destination, source, size);
+#endif
+    }
+
+    // Order the non-temporal stores before the following stores (e.g. the fence signal)
+    void StoreFence()
+    {
+#if UPLOAD_WRITER_USE_SSE
+        _mm_sfence();
+#else
+        std::atomic_thread_fence(std::memory_order_release);
+#endif
+    }
+}
+
+UploadWriter::UploadWriter(void* destination, size_t capacity) :
+    m_destination(static_cast<uint8_t*>(destination)),
+    m_capacity(capacity),
+    m_offset(0),
+    m_lineBase(nullptr),
+    m_stagingBegin(0),
+    m_stagingEnd(0)
+{
+}
+
+UploadWriter::~UploadWriter()
+{
+    Flush();
+}
+
+void UploadWriter::Write(const void* data, size_t size)
+{
+    assert(m_offset + size <= m_capacity);
+
+    const uint8_t* source = static_cast<const uint8_t*>(data);
+    while (size > 0)
+    {
+        uint8_t* destination = m_destination + m_offset;
+        const size_t lineOffset = reinterpret_cast<uintptr_t>(destination) & (LINE_SIZE - 1);
+
+        if (m_stagingBegin == m_stagingEnd)
+        {
+            // Nothing is staged and the destination is at a line boundary: stream the whole lines directly
+            if (lineOffset == 0 && size >= LINE_SIZE)
+            {
+                const size_t bulkSize = size & ~(LINE_SIZE - 1);
+                StreamLines(destination, source, bulkSize);
+                source += bulkSize;
+                size -= bulkSize;
+                m_offset += bulkSize;
+                continue;
+            }
+
+            // Start staging the line of the destination
+            m_lineBase = destination - lineOffset;
+            m_stagingBegin = lineOffset;
+            m_stagingEnd = lineOffset;
+        }
+
+        const size_t copySize = std::min(size, LINE_SIZE - m_stagingEnd);
+        memcpy(m_staging + m_stagingEnd, source, copySize);
+        m_stagingEnd += copySize;
+        source += copySize;
+        size -= copySize;
+        m_offset += copySize;
+
+        if (m_stagingEnd == LINE_SIZE)
+        {
+            FlushStaging();
+        }
+    }
+}
+
+void UploadWriter::Flush()
+{
+    FlushStaging();
+    StoreFence();
+}
+
+void UploadWriter::FlushStaging()
+{
+    if (m_stagingBegin == m_stagingEnd)
+    {
+        return;
+    }
+
+    if (m_stagingBegin == 0 && m_stagingEnd == LINE_SIZE)
+    {
+        StreamLines(m_lineBase, m_staging, LINE_SIZE);
+    }
+    else
+    {
+        // Partial line: the rest of the line may belong to another allocation, so only the staged bytes are written
+        memcpy(m_lineBase + m_stagingBegin, m_staging + m_stagingBegin, m_stagingEnd - m_stagingBegin);
+    }
+
+    m_stagingBegin = 0;
+    m_stagingEnd = 0;
+}
+
+void StreamCopy(void* destination, const void* source, size_t size)
+{
+    UploadWriter writer(destination, size);
+    writer.Write(source, size);
+    writer.Flush();
+}
+
+void WriteRangeAccumulator::Add(size_t begin, size_t end)
+{
+    if (begin >= end)
+    {
+        return;
+    }
+
+    // First range which ends at or after the new range begins, i.e. the first one that can be merged
+    auto it = std::lower_bound(m_ranges.begin(), m_ranges.end(), begin, [](const Range& range, size_t value) { return range.end < value; });
+
+    // Absorb every range which overlaps or touches the new range
+    auto last = it;
+    while (last != m_ranges.end() && last->begin <= end)
+    {
+        begin = std::min(begin, last->begin);
+        end = std::max(end, last->end);
+        ++last;
+    }
+
+    it = m_ranges.erase(it, last);
+    m_ranges.insert(it, { begin, end });
+}
+
+std::vector<WriteRangeAccumulator::Range> WriteRangeAccumulator::Take()
+{
+    std::vector<Range> ranges;
+    ranges.swap(m_ranges);
+    return ranges;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Sequential writer for write-combined memory (D3D12_HEAP_TYPE_UPLOAD / GPU_UPLOAD mapped pointers).
+//
+// Write-combined memory must never be read and should be written in whole 64-byte lines.
+// Writes are staged in a 64-byte aligned buffer which mirrors the current destination line;
+// whole lines are written with non-temporal stores (SSE2, or AVX when compiled with it) and
+// partial lines at the head and tail of the region with regular stores. Large aligned writes
+// bypass the staging buffer. Flush() must be called before the GPU reads the memory.
+//
+// This class has no Direct3D12 dependency so that the bandwidth benchmark can use it.
+class UploadWriter
+{
+public:
+    static constexpr size_t LINE_SIZE = 64;
+
+    UploadWriter(void* destination, size_t capacity);
+    ~UploadWriter();
+
+    UploadWriter(const UploadWriter&) = delete;
+    UploadWriter& operator=(const UploadWriter&) = delete;
+
+    // Append data at the current position
+    void Write(const void* data, size_t size);
+
+    template <typename T>
+    void Write(const T& value)
+    {
+        Write(&value, sizeof(T));
+    }
+
+    // Write the staged bytes and fence the non-temporal stores
+    void Flush();
+
+    size_t BytesWritten() const { return m_offset; }
+
+private:
+    void FlushStaging();
+
+    alignas(LINE_SIZE) uint8_t m_staging[LINE_SIZE];
+
+    uint8_t* m_destination;
+    size_t m_capacity;
+    size_t m_offset;
+
+    // Destination line mirrored by m_staging, and the staged byte range within the line
+    uint8_t* m_lineBase;
+    size_t m_stagingBegin;
+    size_t m_stagingEnd;
+};
+
+// Copy a block into write-combined memory with non-temporal stores
+void StreamCopy(void* destination, const void* source, size_t size);
+
+// Accumulates written byte ranges and merges overlapping and adjacent ones,
+// so that write tracking can be reported once per contiguous range.
+class WriteRangeAccumulator
+{
+public:
+    struct Range
+    {
+        size_t begin;
+        size_t end;
+    };
+
+    void Add(size_t begin, size_t end);
+
+    // Return the merged ranges sorted by offset and clear the accumulator
+    std::vector<Range> Take();
+
+    bool Empty() const { return m_ranges.empty(); }
+
+private:
+    std::vector<Range> m_ranges;
+};
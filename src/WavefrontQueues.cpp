@@ -0,0 +1,39 @@
+#include "WavefrontQueues.h"
+
+void ComputeWavefrontBinOffsets(const uint32_t* binCounts, uint32_t* binOffsets)
+{
+    uint32_t offset = 0;
+    for (uint32_t bin = 0; bin < WAVEFRONT_MATERIAL_BIN_COUNT; ++bin)
+    {
+        binOffsets[bin] = offset;
+        offset += binCounts[bin];
+    }
+}
+
+bool IsWavefrontHitOrderValid(const std::vector<WavefrontHit>& hits, uint32_t hitCount, const std::vector<uint32_t>& sortedHitIndices)
+{
+    if (sortedHitIndices.size() < hitCount || hits.size() < hitCount)
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> isSeen(hitCount, 0);
+    uint32_t previousBin = 0;
+    for (uint32_t i = 0; i < hitCount; ++i)
+    {
+        const uint32_t hitIndex = sortedHitIndices[i];
+        if (hitIndex >= hitCount || isSeen[hitIndex])
+        {
+            return false;
+        }
+        isSeen[hitIndex] = 1;
+
+        const uint32_t bin = GetWavefrontMaterialBin(hits[hitIndex].meshIndex);
+        if (bin < previousBin)
+        {
+            return false;
+        }
+        previousBin = bin;
+    }
+    return true;
+}
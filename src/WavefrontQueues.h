@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Queue layout and compaction of the wavefront path tracing mode.
+//
+// The wavefront mode splits a path traced sample into stages which communicate through queues in UAV buffers:
+//   generate -> ray queue -> extend (trace) -> hit queue -> bin by material -> shade -> shadow queue -> connect
+//                   ^                                                            |
+//                   +----------- continuation rays of the next bounce -----------+
+// The shade stage runs the estimator of PathTracing.h: the light sample becomes a shadow ray carrying its
+// contribution, and the BSDF sample a continuation ray carrying the path state (throughput, pdf of the BSDF sample,
+// state of the Random sampler) unless Russian roulette ends the path. The ray queue holds two queues of one entry per
+// pixel, the rays of the bounce and the continuation rays, which swap between the bounces. The radiance of a path is
+// summed per pixel, a pixel has at most one ray in every queue.
+//
+// Every queue is compacted: a producer appends with an atomic add on the queue counter, so a stage only runs on
+// the live entries. The compute stages reserve the entries of a whole wave with one atomic (WaveActiveCountBits and
+// WavePrefixCountBits), the closest hit shader appends its hit alone. The CPU backend reserves the entries of one
+// task of WAVEFRONT_TASK_SIZE items like a wave.
+//
+// Between extend and shade the hits are binned by material key with a counting sort: extend counts the hits of
+// every bin, a prefix sum gives the bin offsets, and a scatter writes the hit indices grouped by bin. The shade
+// stage then reads hits of one material in consecutive threads, so the waves shade one material each instead of
+// diverging over all materials. The material key is the mesh index (every mesh has one vertex colored diffuse
+// material) modulo WAVEFRONT_MATERIAL_BIN_COUNT.
+//
+// The structures must match shaders/WavefrontQueues.hlsli. This module has no Direct3D12 dependency, the layout and
+// the compaction are checked on the CPU by CpuRaytracer::RenderWavefront() and tools/RaytracingBenchmark.
+
+const uint32_t WAVEFRONT_MATERIAL_BIN_COUNT = 256;
+
+// Items per wave on the GPU and per task on the CPU
+const uint32_t WAVEFRONT_TASK_SIZE = 64;
+
+// Entry of the ray queue, a path before its next bounce. The other state of the PathSampler is derived from the pixel
+// and the sample index.
+struct WavefrontRay
+{
+    float origin[3];
+    uint32_t pixelIndex;
+    float direction[3];
+    float bsdfPdf;              // of the last bounce, 0 for the camera ray
+    float throughput[3];
+    uint32_t random;            // PathSampler::random
+};
+static_assert(sizeof(WavefrontRay) == 48, "WavefrontRay must match shaders/WavefrontQueues.hlsli");
+
+// Entry of the hit queue, written by the closest hit shader of the extend stage. The object to world rotation is
+// stored because the shade stage runs in a compute shader without the instance intrinsics.
+struct WavefrontHit
+{
+    uint32_t rayIndex;
+    uint32_t meshIndex;
+    uint32_t primitiveIndex;
+    float hitT;
+    float barycentrics[2];
+    float objectToWorld[3][3];
+    uint32_t padding;
+};
+static_assert(sizeof(WavefrontHit) == 64, "WavefrontHit must match shaders/WavefrontQueues.hlsli");
+
+// Entry of the shadow queue: the contribution is added to the pixel when the segment to the light is unoccluded
+struct WavefrontShadowRay
+{
+    float origin[3];
+    uint32_t pixelIndex;
+    float direction[3];
+    float tMax;
+    float contribution[3];
+    uint32_t padding;
+};
+static_assert(sizeof(WavefrontShadowRay) == 48, "WavefrontShadowRay must match shaders/WavefrontQueues.hlsli");
+
+// Byte offsets in the counter buffer
+namespace WavefrontCounters
+{
+    const uint32_t RAY_COUNT = 0;
+    const uint32_t HIT_COUNT = 4;
+    const uint32_t SHADOW_RAY_COUNT = 8;
+    const uint32_t NEXT_RAY_COUNT = 12;                                     // continuation rays
+    const uint32_t BIN_COUNTS = 16;                                         // hits per material bin
+    const uint32_t BIN_OFFSETS = BIN_COUNTS + WAVEFRONT_MATERIAL_BIN_COUNT * 4;  // scatter cursors, start at the bin offsets
+    const uint32_t SIZE = BIN_OFFSETS + WAVEFRONT_MATERIAL_BIN_COUNT * 4;
+}
+
+inline uint32_t GetWavefrontMaterialBin(uint32_t meshIndex)
+{
+    return meshIndex % WAVEFRONT_MATERIAL_BIN_COUNT;
+}
+
+// Append count entries to a queue with one atomic add and return the index of the first one
+inline uint32_t AppendWavefrontQueue(std::atomic<uint32_t>& counter, uint32_t count)
+{
+    return counter.fetch_add(count, std::memory_order_relaxed);
+}
+
+// Exclusive prefix sum of the bin counts
+void ComputeWavefrontBinOffsets(const uint32_t* binCounts, uint32_t* binOffsets);
+
+// True if the sorted indices are a permutation of the hits grouped by material bin in ascending bin order
+bool IsWavefrontHitOrderValid(const std::vector<WavefrontHit>& hits, uint32_t hitCount, const std::vector<uint32_t>& sortedHitIndices);
@@ -0,0 +1,329 @@
+// Checks the BLAS build policy (AccelerationStructurePolicy) on the CPU. Invalid policies (numbers that are not parsed
+// completely, a growth below 1, entries without '=', unknown keys and usages) are rejected without changing the
+// settings, a valid policy only changes its entries. The usage rules are matched in the order of the policy and the
+// first match wins. DecideUpdate() is checked with fixed sequences for the refit count and surface area growth
+// transitions and the reset of the state on a rebuild, then with random sequences against the rules of the policy.
+// Exits with 1 when a check fails.
+//
+// Build (Linux):
+//   g++ -std=c++20 -O2 -Isrc tools/AccelerationStructurePolicyTool.cpp src/AccelerationStructurePolicy.cpp -o AccelerationStructurePolicyTool
+// Build (Windows, Developer Command Prompt):
+//   cl /std:c++20 /O2 /EHsc /Isrc tools\AccelerationStructurePolicyTool.cpp src\AccelerationStructurePolicy.cpp /Fe:AccelerationStructurePolicyTool.exe
+//
+// Usage:
+//   AccelerationStructurePolicyTool [-iterations <count>] [-seed <value>]
+
+#include "AccelerationStructurePolicy.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const uint32_t NUM_UPDATES = 200;
+
+    void PrintUsage()
+    {
+        printf("Usage: AccelerationStructurePolicyTool [-iterations <count>] [-seed <value>]\n");
+    }
+
+    bool Check(bool condition, const char* message)
+    {
+        if (!condition)
+        {
+            printf("%s\n", message);
+        }
+        return condition;
+    }
+
+    bool Check(bool condition, const char* message, uint32_t iteration)
+    {
+        if (!condition)
+        {
+            printf("Iteration %u: %s\n", iteration, message);
+        }
+        return condition;
+    }
+
+    bool IsSameSettings(const AccelerationStructurePolicySettings& a, const AccelerationStructurePolicySettings& b)
+    {
+        if (a.defaultUsage != b.defaultUsage || a.compactStatic != b.compactStatic ||
+            a.maxRefitsBeforeRebuild != b.maxRefitsBeforeRebuild || a.maxSurfaceAreaGrowth != b.maxSurfaceAreaGrowth ||
+            a.usageRules.size() != b.usageRules.size())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < a.usageRules.size(); ++i)
+        {
+            if (a.usageRules[i].pattern != b.usageRules[i].pattern || a.usageRules[i].usage != b.usageRules[i].usage)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool CheckParseErrors()
+    {
+        const char* invalidPolicies[] = {
+            "refits=x",
+            "refits=30x",
+            "refits=",
+            "growth=0.5",
+            "growth=1.5.2",
+            "growth=",
+            "refits",
+            "deforming=cloth;growth",
+            "unknown=1",
+            "Deforming=cloth",
+            "default=moving",
+            "compaction=yes",
+        };
+
+        AccelerationStructurePolicySettings original;
+        original.usageRules.push_back({ "rock", MeshUsage::Static });
+        bool passed = true;
+        for (const char* policy : invalidPolicies)
+        {
+            // The valid entries before the error must not be applied either
+            AccelerationStructurePolicySettings settings = original;
+            std::string error;
+            const bool isParsed = ParseAccelerationStructurePolicy(std::string("refits=7;") + policy, settings, &error);
+            if (isParsed || error.empty() || !IsSameSettings(settings, original))
+            {
+                printf("Invalid policy \"%s\" %s\n", policy, isParsed ? "was accepted" : "changed the settings or has no error");
+                passed = false;
+            }
+        }
+        return passed;
+    }
+
+    bool CheckParse()
+    {
+        bool passed = true;
+        AccelerationStructurePolicySettings settings;
+        settings.usageRules.push_back({ "rock", MeshUsage::Static });
+        std::string error;
+        const char* policy = "deforming=cloth,,flag;;rebuilt=debris;refits=30;growth=1.25;compaction=off;default=rebuilt";
+        passed = Check(ParseAccelerationStructurePolicy(policy, settings, &error), "A valid policy was rejected") && passed;
+        passed = Check(settings.usageRules.size() == 4 && settings.usageRules[0].pattern == "rock" &&
+            settings.usageRules[1].pattern == "cloth" && settings.usageRules[1].usage == MeshUsage::Deforming &&
+            settings.usageRules[2].pattern == "flag" && settings.usageRules[2].usage == MeshUsage::Deforming &&
+            settings.usageRules[3].pattern == "debris" && settings.usageRules[3].usage == MeshUsage::Rebuilt,
+            "The usage rules are not appended in the policy order") && passed;
+        passed = Check(settings.maxRefitsBeforeRebuild == 30 && settings.maxSurfaceAreaGrowth == 1.25f && !settings.compactStatic &&
+            settings.defaultUsage == MeshUsage::Rebuilt, "Wrong values of a valid policy") && passed;
+
+        // The entries not given keep their value
+        const AccelerationStructurePolicySettings defaults;
+        AccelerationStructurePolicySettings partial;
+        passed = Check(ParseAccelerationStructurePolicy("refits=0", partial) && partial.maxRefitsBeforeRebuild == 0 &&
+            partial.maxSurfaceAreaGrowth == defaults.maxSurfaceAreaGrowth && partial.compactStatic == defaults.compactStatic &&
+            partial.defaultUsage == defaults.defaultUsage && partial.usageRules.empty(),
+            "A policy changed an entry it does not give") && passed;
+        passed = Check(ParseAccelerationStructurePolicy("", partial) && partial.maxRefitsBeforeRebuild == 0,
+            "The empty policy was rejected or changed the settings") && passed;
+        passed = Check(ParseAccelerationStructurePolicy("growth=1", partial) && partial.maxSurfaceAreaGrowth == 1.0f,
+            "A growth of 1 was rejected") && passed;
+        return passed;
+    }
+
+    bool CheckClassify()
+    {
+        AccelerationStructurePolicySettings settings;
+        const char* text = "static=clothStatic;deforming=cloth,flag;rebuilt=flag_torn,debris;default=rebuilt";
+        bool passed = Check(ParseAccelerationStructurePolicy(text, settings), "The classification policy was rejected");
+        const AccelerationStructurePolicy policy(settings);
+
+        struct Case
+        {
+            const char* name;
+            MeshUsage usage;
+            int ruleIndex;
+        };
+        const Case cases[] = {
+            { "clothStatic_01", MeshUsage::Static, 0 },     // matches the static and the deforming rule
+            { "cloth_01", MeshUsage::Deforming, 1 },
+            { "flag_torn", MeshUsage::Deforming, 2 },       // the deforming "flag" comes before "flag_torn"
+            { "debris", MeshUsage::Rebuilt, 4 },
+            { "rock", MeshUsage::Rebuilt, -1 },             // default
+            { "", MeshUsage::Rebuilt, -1 },
+        };
+        for (const Case& c : cases)
+        {
+            int ruleIndex = -2;
+            const MeshUsage usage = policy.Classify(c.name, &ruleIndex);
+            if (usage != c.usage || ruleIndex != c.ruleIndex)
+            {
+                printf("Mesh \"%s\" classified %s by rule %d, expected %s by rule %d\n", c.name, GetMeshUsageName(usage), ruleIndex,
+                    GetMeshUsageName(c.usage), c.ruleIndex);
+                passed = false;
+            }
+        }
+        return passed;
+    }
+
+    bool CheckBuildFlags()
+    {
+        AccelerationStructurePolicySettings settings;
+        const AccelerationStructurePolicy compacting(settings);
+        settings.compactStatic = false;
+        const AccelerationStructurePolicy notCompacting(settings);
+
+        using namespace AccelerationStructureBuildFlags;
+        bool passed = Check(compacting.GetBuildFlags(MeshUsage::Static) == (PREFER_FAST_TRACE | ALLOW_COMPACTION), "Wrong static flags");
+        passed = Check(notCompacting.GetBuildFlags(MeshUsage::Static) == PREFER_FAST_TRACE,
+            "Wrong static flags without compaction") && passed;
+        passed = Check(compacting.GetBuildFlags(MeshUsage::Deforming) == (PREFER_FAST_TRACE | ALLOW_UPDATE), "Wrong deforming flags") && passed;
+        passed = Check(compacting.GetBuildFlags(MeshUsage::Rebuilt) == PREFER_FAST_BUILD, "Wrong rebuilt flags") && passed;
+        return passed;
+    }
+
+    bool CheckDecision(const AccelerationStructurePolicy& policy, MeshUsage usage, BLASUpdateState& state, float surfaceArea,
+        BLASUpdate expectedUpdate, BLASRebuildReason expectedReason, const BLASUpdateState& expectedState, const char* step)
+    {
+        BLASRebuildReason reason = BLASRebuildReason::None;
+        const BLASUpdate update = policy.DecideUpdate(usage, state, surfaceArea, &reason);
+        if (update != expectedUpdate || reason != expectedReason || state.builtSurfaceArea != expectedState.builtSurfaceArea ||
+            state.refitCount != expectedState.refitCount)
+        {
+            printf("%s: %s (%s) with state %g / %u, expected %s (%s) with state %g / %u\n", step,
+                update == BLASUpdate::Refit ? "refit" : "rebuild", GetBLASRebuildReasonName(reason), state.builtSurfaceArea,
+                state.refitCount, expectedUpdate == BLASUpdate::Refit ? "refit" : "rebuild", GetBLASRebuildReasonName(expectedReason),
+                expectedState.builtSurfaceArea, expectedState.refitCount);
+            return false;
+        }
+        return true;
+    }
+
+    bool CheckDecideUpdate()
+    {
+        AccelerationStructurePolicySettings settings;
+        settings.maxRefitsBeforeRebuild = 3;
+        settings.maxSurfaceAreaGrowth = 1.5f;
+        const AccelerationStructurePolicy policy(settings);
+        const BLASUpdate REFIT = BLASUpdate::Refit;
+        const BLASUpdate REBUILD = BLASUpdate::Rebuild;
+        const MeshUsage DEFORMING = MeshUsage::Deforming;
+
+        // Periodic rebuild after 3 refits, the shrinking bounds do not matter
+        BLASUpdateState state = { 10.0f, 0 };
+        bool passed = CheckDecision(policy, DEFORMING, state, 12.0f, REFIT, BLASRebuildReason::None, { 10.0f, 1 }, "Refit 1");
+        passed = CheckDecision(policy, DEFORMING, state, 14.0f, REFIT, BLASRebuildReason::None, { 10.0f, 2 }, "Refit 2") && passed;
+        passed = CheckDecision(policy, DEFORMING, state, 4.0f, REFIT, BLASRebuildReason::None, { 10.0f, 3 }, "Refit 3") && passed;
+        passed = CheckDecision(policy, DEFORMING, state, 11.0f, REBUILD, BLASRebuildReason::RefitCount, { 11.0f, 0 }, "Refit 4") && passed;
+
+        // The growth is relative to the area of the last build, exactly the limit still refits
+        passed = CheckDecision(policy, DEFORMING, state, 16.5f, REFIT, BLASRebuildReason::None, { 11.0f, 1 },
+            "Growth to the limit") && passed;
+        passed = CheckDecision(policy, DEFORMING, state, 16.6f, REBUILD, BLASRebuildReason::SurfaceAreaGrowth, { 16.6f, 0 },
+            "Growth above the limit") && passed;
+        passed = CheckDecision(policy, DEFORMING, state, 20.0f, REFIT, BLASRebuildReason::None, { 16.6f, 1 },
+            "Refit after the growth") && passed;
+
+        // The refit count is checked before the growth
+        state = { 10.0f, 3 };
+        passed = CheckDecision(policy, DEFORMING, state, 100.0f, REBUILD, BLASRebuildReason::RefitCount, { 100.0f, 0 },
+            "Refit count and growth") && passed;
+
+        // The other usages always rebuild and reset the state
+        state = { 10.0f, 2 };
+        passed = CheckDecision(policy, MeshUsage::Static, state, 5.0f, REBUILD, BLASRebuildReason::Usage, { 5.0f, 0 },
+            "Static") && passed;
+        state = { 10.0f, 2 };
+        passed = CheckDecision(policy, MeshUsage::Rebuilt, state, 5.0f, REBUILD, BLASRebuildReason::Usage, { 5.0f, 0 },
+            "Rebuilt") && passed;
+
+        // Without a refit limit only the growth rebuilds
+        settings.maxRefitsBeforeRebuild = 0;
+        const AccelerationStructurePolicy unlimited(settings);
+        state = { 10.0f, 0 };
+        uint32_t numRebuilds = 0;
+        for (uint32_t i = 0; i < 1000; ++i)
+        {
+            numRebuilds += unlimited.DecideUpdate(DEFORMING, state, 10.0f) == REBUILD;
+        }
+        passed = Check(numRebuilds == 0 && state.refitCount == 1000,
+            "A BLAS without a refit limit was rebuilt periodically") && passed;
+        return passed;
+    }
+
+    // Random bounds against the rules of the policy
+    bool CheckRandomUpdates(uint32_t iteration, std::mt19937& random)
+    {
+        std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        AccelerationStructurePolicySettings settings;
+        settings.maxRefitsBeforeRebuild = std::uniform_int_distribution<uint32_t>(0, 8)(random);
+        settings.maxSurfaceAreaGrowth = 1.0f + uniform(random);
+        const AccelerationStructurePolicy policy(settings);
+
+        float surfaceArea = 1.0f + uniform(random);
+        BLASUpdateState state = { surfaceArea, 0 };
+        for (uint32_t i = 0; i < NUM_UPDATES; ++i)
+        {
+            surfaceArea *= 0.8f + 0.45f * uniform(random);
+            const BLASUpdateState previous = state;
+            BLASRebuildReason reason = BLASRebuildReason::None;
+            const BLASUpdate update = policy.DecideUpdate(MeshUsage::Deforming, state, surfaceArea, &reason);
+
+            const bool isCountExceeded = settings.maxRefitsBeforeRebuild > 0 && previous.refitCount >= settings.maxRefitsBeforeRebuild;
+            const bool isGrown = surfaceArea > previous.builtSurfaceArea * settings.maxSurfaceAreaGrowth;
+            const BLASRebuildReason expectedReason = isCountExceeded ? BLASRebuildReason::RefitCount :
+                isGrown ? BLASRebuildReason::SurfaceAreaGrowth : BLASRebuildReason::None;
+            if (!Check(reason == expectedReason && (update == BLASUpdate::Rebuild) == (expectedReason != BLASRebuildReason::None),
+                "Wrong decision for the refit count and the growth", iteration))
+            {
+                return false;
+            }
+
+            const bool isStateValid = update == BLASUpdate::Rebuild ? state.builtSurfaceArea == surfaceArea && state.refitCount == 0 :
+                state.builtSurfaceArea == previous.builtSurfaceArea && state.refitCount == previous.refitCount + 1;
+            if (!Check(isStateValid, "Wrong state after the decision", iteration))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t numIterations = 10000;
+    uint32_t seed = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-iterations") == 0 && i + 1 < argc)
+        {
+            numIterations = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc)
+        {
+            seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    bool passed = CheckParseErrors();
+    passed = CheckParse() && passed;
+    passed = CheckClassify() && passed;
+    passed = CheckBuildFlags() && passed;
+    passed = CheckDecideUpdate() && passed;
+
+    std::mt19937 random(seed);
+    for (uint32_t iteration = 0; iteration < numIterations; ++iteration)
+    {
+        passed = CheckRandomUpdates(iteration, random) && passed;
+    }
+    printf("%u random sequences of %u updates\n", numIterations, NUM_UPDATES);
+
+    printf("%s\n", passed ? "PASS" : "FAIL");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,174 @@
+// Replays an allocation trace recorded with "-allocTrace <file>" against the allocator backends
+// and reports throughput, peak footprint, fragmentation over time and failure points.
+//
+// Build (Linux):
+//   g++ -std=c++20 -O2 -Isrc tools/AllocationReplayTool.cpp src/AllocationReplay.cpp src/AllocationTrace.cpp src/HeapAllocator.cpp -o AllocationReplay
+// Build (Windows, Developer Command Prompt):
+//   cl /std:c++20 /O2 /EHsc /Isrc tools\AllocationReplayTool.cpp src\AllocationReplay.cpp src\AllocationTrace.cpp src\HeapAllocator.cpp /Fe:AllocationReplay.exe
+//
+// Usage:
+//   AllocationReplay <trace file> [-backend <name>|all] [-sampleInterval <events>] [-csv <file>]
+
+#include "AllocationReplay.h"
+#include "PlatformHelpers.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+    void PrintUsage()
+    {
+        printf("Usage: AllocationReplay <trace file> [-backend <name>|all] [-sampleInterval <events>] [-csv <file>]\n");
+        printf("Backends:");
+        for (const auto& name : GetAllocatorBackendNames())
+        {
+            printf(" %s", name.c_str());
+        }
+        printf("\n");
+    }
+
+    void PrintResult(const AllocationReplayResult& result)
+    {
+        printf("=== %s ===\n", result.backendName.c_str());
+        printf("  events          : %llu\n", static_cast<unsigned long long>(result.numEvents));
+        printf("  elapsed         : %.3f ms\n", result.elapsedSeconds * 1000.0);
+        printf("  throughput      : %.2f Mops/s\n", result.operationsPerSecond / 1.0e6);
+
+        for (const auto& heap : result.heaps)
+        {
+            const double capacity = heap.capacity > 0 ? static_cast<double>(heap.capacity) : 1.0;
+            printf("  [%u] %s\n", heap.heapId, heap.name.c_str());
+            printf("      allocations : %llu, frees: %llu\n",
+                static_cast<unsigned long long>(heap.numAllocations), static_cast<unsigned long long>(heap.numFrees));
+            printf("      peak used   : %llu bytes (%.1f%%)\n",
+                static_cast<unsigned long long>(heap.peakUsedSize), 100.0 * static_cast<double>(heap.peakUsedSize) / capacity);
+            printf("      footprint   : %llu bytes (%.1f%%)\n",
+                static_cast<unsigned long long>(heap.peakFootprint), 100.0 * static_cast<double>(heap.peakFootprint) / capacity);
+
+            float maxFragmentation = 0.0f;
+            for (const auto& sample : result.fragmentation)
+            {
+                if (sample.heapId == heap.heapId)
+                {
+                    maxFragmentation = std::max(maxFragmentation, sample.fragmentationRatio);
+                }
+            }
+            printf("      max fragmentation: %.3f\n", maxFragmentation);
+        }
+
+        // Only the first failures are listed, they are the interesting ones for OOM analysis
+        const size_t MAX_PRINTED_FAILURES = 32;
+        printf("  failures        : %zu\n", result.failures.size());
+        for (size_t i = 0; i < std::min(result.failures.size(), MAX_PRINTED_FAILURES); ++i)
+        {
+            const AllocationReplayFailure& failure = result.failures[i];
+            printf("      event %llu (t=%.3f ms) heap %u: %u bytes, used=%zu, largest free=%zu%s\n",
+                static_cast<unsigned long long>(failure.eventIndex), static_cast<double>(failure.timestamp) / 1.0e6,
+                failure.heapId, failure.size, failure.usedSize, failure.largestFreeBlock,
+                failure.failedInTrace ? " (also failed in trace)" : "");
+        }
+    }
+
+    void WriteFragmentationCsv(FILE* file, const AllocationReplayResult& result)
+    {
+        for (const auto& sample : result.fragmentation)
+        {
+            fprintf(file, "%s,%llu,%llu,%u,%zu,%zu,%zu,%f\n", result.backendName.c_str(),
+                static_cast<unsigned long long>(sample.eventIndex), static_cast<unsigned long long>(sample.timestamp),
+                sample.heapId, sample.usedSize, sample.largestFreeBlock, sample.numFreeBlocks, sample.fragmentationRatio);
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    const char* tracePath = argv[1];
+    std::string backend = "all";
+    uint32_t sampleInterval = 1024;
+    const char* csvPath = nullptr;
+
+    for (int i = 2; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-backend") == 0 && i + 1 < argc)
+        {
+            backend = argv[++i];
+        }
+        else if (strcmp(argv[i], "-sampleInterval") == 0 && i + 1 < argc)
+        {
+            sampleInterval = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "-csv") == 0 && i + 1 < argc)
+        {
+            csvPath = argv[++i];
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    AllocationTrace trace;
+    if (!LoadAllocationTrace(tracePath, trace))
+    {
+        return 1;
+    }
+    printf("Loaded %zu events on %zu heaps (%llu events were dropped while recording)\n",
+        trace.events.size(), trace.heaps.size(), static_cast<unsigned long long>(trace.numDroppedEvents));
+
+    std::vector<std::string> backends;
+    if (backend == "all")
+    {
+        backends = GetAllocatorBackendNames();
+    }
+    else
+    {
+        backends.push_back(backend);
+    }
+
+    FILE* csvFile = nullptr;
+    if (csvPath)
+    {
+        csvFile = OpenFileStream(csvPath, "w");
+        if (!csvFile)
+        {
+            printf("Failed to open %s\n", csvPath);
+            return 1;
+        }
+        fprintf(csvFile, "backend,event,timestamp_ns,heap,used,largest_free,free_blocks,fragmentation\n");
+    }
+
+    for (const auto& name : backends)
+    {
+        AllocatorBackendFactory factory = GetAllocatorBackendFactory(name);
+        if (!factory)
+        {
+            printf("Unknown backend: %s\n", name.c_str());
+            PrintUsage();
+            return 1;
+        }
+
+        const AllocationReplayResult result = ReplayAllocationTrace(trace, name, factory, sampleInterval);
+        PrintResult(result);
+        if (csvFile)
+        {
+            WriteFragmentationCsv(csvFile, result);
+        }
+    }
+
+    if (csvFile)
+    {
+        fclose(csvFile);
+    }
+    return 0;
+}
@@ -0,0 +1,179 @@
+// Checks the change debounce and the file watcher used by the shader hot reload. The debounce is checked with explicit
+// times: a change is released exactly after the debounce time, a burst of changes is released once after the last
+// one, with every path once. The watcher is checked on a temporary directory: the files present at the start are not
+// reported, a modified, a new, a removed file and a file in a subdirectory are reported once, files of other
+// extensions are not, and a burst of writes to several files is one report. Exits with 1 when a check fails.
+//
+// Build (Linux):
+//   g++ -std=c++20 -O2 -pthread -Isrc tools/FileWatcherTool.cpp src/FileWatcher.cpp -o FileWatcherTool
+// Build (Windows, Developer Command Prompt):
+//   cl /std:c++20 /O2 /EHsc /Isrc tools\FileWatcherTool.cpp src\FileWatcher.cpp /Fe:FileWatcherTool.exe
+//
+// Usage:
+//   FileWatcherTool [-directory <path>] [-poll <milliseconds>] [-debounce <milliseconds>]
+
+#include "FileWatcher.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    void PrintUsage()
+    {
+        printf("Usage: FileWatcherTool [-directory <path>] [-poll <milliseconds>] [-debounce <milliseconds>]\n");
+    }
+
+    bool Check(bool condition, const char* message)
+    {
+        if (!condition)
+        {
+            printf("%s\n", message);
+        }
+        return condition;
+    }
+
+    std::string Join(const std::vector<std::string>& paths)
+    {
+        std::string joined;
+        for (const std::string& path : paths)
+        {
+            joined += (joined.empty() ? "" : " ") + path;
+        }
+        return joined;
+    }
+
+    // Content of a growing length, so that the size changes even when the write time resolution is coarse
+    void WriteFile(const std::filesystem::path& path, uint32_t version)
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << std::string(version + 1, 'x') << "\n";
+    }
+
+    // Changes reported within the timeout, or after the quiet time when nothing is expected
+    std::vector<std::string> WaitForChanges(FileWatcher& watcher, uint32_t timeoutMilliseconds)
+    {
+        const auto endTime = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMilliseconds);
+        while (std::chrono::steady_clock::now() < endTime)
+        {
+            std::vector<std::string> changes = watcher.TakeChanges();
+            if (!changes.empty())
+            {
+                return changes;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return {};
+    }
+
+    bool CheckChanges(FileWatcher& watcher, const std::vector<std::string>& expected, uint32_t timeoutMilliseconds, const char* step)
+    {
+        const std::vector<std::string> changes = WaitForChanges(watcher, timeoutMilliseconds);
+        if (changes != expected)
+        {
+            printf("%s: expected [%s], got [%s]\n", step, Join(expected).c_str(), Join(changes).c_str());
+            return false;
+        }
+        return true;
+    }
+
+    bool IsDebouncerValid()
+    {
+        bool isValid = true;
+        ChangeDebouncer debouncer(100);
+        debouncer.AddChange("a.hlsl", 1000);
+        isValid = Check(debouncer.Take(1099).empty(), "A change is released before the debounce time") && isValid;
+        isValid = Check(debouncer.Take(1100) == std::vector<std::string>{ "a.hlsl" }, "A change is not released after the debounce time") && isValid;
+        isValid = Check(debouncer.Take(5000).empty() && !debouncer.IsPending(), "A change is released twice") && isValid;
+
+        // Every change of a burst restarts the debounce time
+        for (uint64_t time = 2000; time <= 2500; time += 50)
+        {
+            debouncer.AddChange(time % 100 == 0 ? "b.hlsli" : "a.hlsl", time);
+            isValid = Check(debouncer.Take(time + 99).empty(), "A burst is released before its last change is debounced") && isValid;
+        }
+        isValid = Check(debouncer.Take(2600) == std::vector<std::string>{ "a.hlsl", "b.hlsli" }, "A burst is not released once with every path once") && isValid;
+        return isValid;
+    }
+
+    bool IsWatcherValid(const std::filesystem::path& directory, uint32_t pollMilliseconds, uint32_t debounceMilliseconds)
+    {
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory / "include");
+        WriteFile(directory / "a.hlsl", 0);
+        WriteFile(directory / "b.hlsli", 0);
+        WriteFile(directory / "notes.txt", 0);
+
+        FileWatcher watcher;
+        if (!Check(watcher.Start(directory.string(), { ".hlsl", ".hlsli" }, pollMilliseconds, debounceMilliseconds), "The watcher does not start"))
+        {
+            return false;
+        }
+
+        // Long enough for a report of every step, and for the absence of one
+        const uint32_t timeout = (pollMilliseconds + debounceMilliseconds) * 4 + 500;
+        bool isValid = CheckChanges(watcher, {}, timeout, "Files present at the start");
+        WriteFile(directory / "a.hlsl", 1);
+        isValid = CheckChanges(watcher, { "a.hlsl" }, timeout, "Modified file") && isValid;
+        WriteFile(directory / "notes.txt", 1);
+        isValid = CheckChanges(watcher, {}, timeout, "File of another extension") && isValid;
+        WriteFile(directory / "include" / "c.hlsli", 0);
+        isValid = CheckChanges(watcher, { "include/c.hlsli" }, timeout, "New file in a subdirectory") && isValid;
+        std::filesystem::remove(directory / "b.hlsli");
+        isValid = CheckChanges(watcher, { "b.hlsli" }, timeout, "Removed file") && isValid;
+
+        // A burst shorter than the debounce time between the writes is one report
+        const uint32_t burstInterval = std::max(debounceMilliseconds / 4, 1u);
+        for (uint32_t i = 0; i < 8; ++i)
+        {
+            WriteFile(directory / (i % 2 == 0 ? "a.hlsl" : "include/c.hlsli"), i + 2);
+            std::this_thread::sleep_for(std::chrono::milliseconds(burstInterval));
+        }
+        isValid = CheckChanges(watcher, { "a.hlsl", "include/c.hlsli" }, timeout, "Burst of writes") && isValid;
+        isValid = CheckChanges(watcher, {}, timeout, "After the burst") && isValid;
+
+        watcher.Stop();
+        std::filesystem::remove_all(directory);
+        return isValid;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / ("FileWatcherTool-" + std::to_string(std::random_device()()));
+    uint32_t pollMilliseconds = 20;
+    uint32_t debounceMilliseconds = 100;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-directory") == 0 && i + 1 < argc)
+        {
+            directory = argv[++i];
+        }
+        else if (strcmp(argv[i], "-poll") == 0 && i + 1 < argc)
+        {
+            pollMilliseconds = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "-debounce") == 0 && i + 1 < argc)
+        {
+            debounceMilliseconds = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    bool passed = IsDebouncerValid();
+    passed = IsWatcherValid(directory, pollMilliseconds, debounceMilliseconds) && passed;
+
+    printf("%s\n", passed ? "PASS" : "FAIL");
+    return passed ? 0 : 1;
+}
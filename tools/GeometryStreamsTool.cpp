@@ -0,0 +1,172 @@
+// Checks the round-trip errors of the compressed vertex streams (GeometryStreams) and compares the
+// throughput of the SSE2 and the scalar conversion. Exits with 1 when an error bound is exceeded or
+// when the two paths do not produce identical streams.
+//
+// Build (Linux):
+//   g++ -std=c++20 -O2 -Isrc tools/GeometryStreamsTool.cpp src/GeometryStreams.cpp -o GeometryStreamsTool
+// Build (Windows, Developer Command Prompt):
+//   cl /std:c++20 /O2 /EHsc /Isrc tools\GeometryStreamsTool.cpp src\GeometryStreams.cpp /Fe:GeometryStreamsTool.exe
+//
+// Usage:
+//   GeometryStreamsTool [-vertices <count>] [-seed <value>]
+
+#include "GeometryStreams.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+    void PrintUsage()
+    {
+        printf("Usage: GeometryStreamsTool [-vertices <count>] [-seed <value>]\n");
+    }
+
+    // Random vertices, including axis aligned normals and colors outside of [0, 1]
+    std::vector<GeometrySourceVertex> GenerateVertices(uint32_t vertexCount, uint32_t seed)
+    {
+        std::mt19937 random(seed);
+        std::uniform_real_distribution<float> positionDistribution(-50.0f, 50.0f);
+        std::normal_distribution<float> normalDistribution(0.0f, 1.0f);
+        std::uniform_real_distribution<float> colorDistribution(-0.1f, 1.1f);
+
+        const float AXES[6][3] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+
+        std::vector<GeometrySourceVertex> vertices(vertexCount);
+        for (uint32_t i = 0; i < vertexCount; ++i)
+        {
+            GeometrySourceVertex& vertex = vertices[i];
+            for (float& value : vertex.position)
+            {
+                value = positionDistribution(random);
+            }
+
+            if (i < 6)
+            {
+                memcpy(vertex.normal, AXES[i], sizeof(vertex.normal));
+            }
+            else
+            {
+                float length = 0.0f;
+                do
+                {
+                    for (float& value : vertex.normal)
+                    {
+                        value = normalDistribution(random);
+                    }
+                    length = std::sqrt(vertex.normal[0] * vertex.normal[0] + vertex.normal[1] * vertex.normal[1] + vertex.normal[2] * vertex.normal[2]);
+                } while (length < 1.0e-3f);
+
+                for (float& value : vertex.normal)
+                {
+                    value /= length;
+                }
+            }
+
+            for (float& value : vertex.color)
+            {
+                value = colorDistribution(random);
+            }
+        }
+        return vertices;
+    }
+
+    bool StreamsEqual(const GeometryStreams& a, const GeometryStreams& b)
+    {
+        return a.positions == b.positions &&
+            a.quantizedPositions == b.quantizedPositions &&
+            a.attributes.size() == b.attributes.size() &&
+            memcmp(a.attributes.data(), b.attributes.data(), a.attributes.size() * sizeof(PackedVertexAttributes)) == 0;
+    }
+
+    double MeasureVerticesPerSecond(const std::vector<GeometrySourceVertex>& vertices, PositionFormat positionFormat, ColorFormat colorFormat, bool useSimd)
+    {
+        const uint32_t NUM_ITERATIONS = 10;
+
+        GeometryStreams streams;
+        const auto startTime = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < NUM_ITERATIONS; ++i)
+        {
+            BuildGeometryStreams(vertices.data(), static_cast<uint32_t>(vertices.size()), positionFormat, colorFormat, streams, useSimd);
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        return static_cast<double>(vertices.size()) * NUM_ITERATIONS / seconds;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t vertexCount = 1 << 20;
+    uint32_t seed = 1;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-vertices") == 0 && i + 1 < argc)
+        {
+            vertexCount = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc)
+        {
+            seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    const std::vector<GeometrySourceVertex> vertices = GenerateVertices(vertexCount, seed);
+
+    // Bounds of the quantization: half a step of each encoding, with a margin for float rounding
+    const float POSITION_RANGE = 50.0f;
+    const float MAX_NORMAL_ERROR_DEGREES = 0.01f;
+
+    const PositionFormat positionFormats[] = { PositionFormat::Float3, PositionFormat::Snorm16 };
+    const ColorFormat colorFormats[] = { ColorFormat::RGBA8, ColorFormat::RGB10A2 };
+
+    bool passed = true;
+    for (PositionFormat positionFormat : positionFormats)
+    {
+        for (ColorFormat colorFormat : colorFormats)
+        {
+            GeometryStreams simdStreams;
+            GeometryStreams scalarStreams;
+            BuildGeometryStreams(vertices.data(), vertexCount, positionFormat, colorFormat, simdStreams, true);
+            BuildGeometryStreams(vertices.data(), vertexCount, positionFormat, colorFormat, scalarStreams, false);
+
+            const GeometryStreamErrors errors = MeasureGeometryStreamErrors(vertices.data(), vertexCount, simdStreams);
+
+            const float maxPositionError = positionFormat == PositionFormat::Snorm16 ? POSITION_RANGE / 32767.0f * 0.5f * 1.01f : 0.0f;
+            // The 2-bit alpha of RGB10A2 dominates its color error
+            const float maxColorError = (colorFormat == ColorFormat::RGB10A2 ? 0.5f / 3.0f : 0.5f / 255.0f) * 1.01f;
+
+            const bool identical = StreamsEqual(simdStreams, scalarStreams);
+            const bool withinBounds = errors.maxPositionError <= maxPositionError &&
+                errors.maxNormalErrorDegrees <= MAX_NORMAL_ERROR_DEGREES &&
+                errors.maxColorError <= maxColorError;
+            passed = passed && identical && withinBounds;
+
+            const double simdRate = MeasureVerticesPerSecond(vertices, positionFormat, colorFormat, true);
+            const double scalarRate = MeasureVerticesPerSecond(vertices, positionFormat, colorFormat, false);
+
+            printf("=== position %s, color %s ===\n",
+                positionFormat == PositionFormat::Snorm16 ? "snorm16" : "float3",
+                colorFormat == ColorFormat::RGB10A2 ? "RGB10A2" : "RGBA8");
+            printf("  stream size     : %u + %u bytes per vertex (source %u)\n",
+                simdStreams.GetPositionStride(), static_cast<uint32_t>(sizeof(PackedVertexAttributes)), static_cast<uint32_t>(sizeof(GeometrySourceVertex)));
+            printf("  position error  : %g (bound %g)\n", errors.maxPositionError, maxPositionError);
+            printf("  normal error    : %g degrees (bound %g)\n", errors.maxNormalErrorDegrees, MAX_NORMAL_ERROR_DEGREES);
+            printf("  color error     : %g (bound %g)\n", errors.maxColorError, maxColorError);
+            printf("  SIMD == scalar  : %s\n", identical ? "yes" : "NO");
+            printf("  throughput      : SIMD %.1f Mvertices/s, scalar %.1f Mvertices/s\n", simdRate / 1.0e6, scalarRate / 1.0e6);
+            printf("  result          : %s\n", identical && withinBounds ? "PASS" : "FAIL");
+        }
+    }
+
+    return passed ? 0 : 1;
+}
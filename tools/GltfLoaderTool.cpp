@@ -0,0 +1,385 @@
+// Generates a glTF 2.0 scene with a node hierarchy in the three buffer layouts (.glb, .gltf with an external .bin
+// file and .gltf with a data URI), loads it with GltfScene and checks the meshes, the zero-copy accessor views, the
+// skipped primitives and the flattened world transforms against a serial reference. Exits with 1 when a check fails.
+//
+// Build (Linux):
+//   g++ -std=c++20 -O2 -pthread -Isrc tools/GltfLoaderTool.cpp src/GltfLoader.cpp src/Json.cpp src/MappedFile.cpp src/ThreadPool.cpp src/GeometryStreams.cpp -o GltfLoaderTool
+// Build (Windows, Developer Command Prompt):
+//   cl /std:c++20 /O2 /EHsc /Isrc tools\GltfLoaderTool.cpp src\GltfLoader.cpp src\Json.cpp src\MappedFile.cpp src\ThreadPool.cpp src\GeometryStreams.cpp /Fe:GltfLoaderTool.exe
+//
+// Usage:
+//   GltfLoaderTool [-grid <quads per side>] [-nodes <count>] [-threads <count>] [-output <directory>]
+
+#include "GltfLoader.h"
+#include "PlatformHelpers.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const uint32_t STRIP_TRIANGLES = 8;
+    const uint32_t STRIP_STRIDE = sizeof(float) * 7;    // interleaved float3 position and float4 color
+
+    struct GeneratedScene
+    {
+        std::string json;               // with "$URI$" in place of the buffer uri
+        std::vector<uint8_t> binary;
+        std::vector<float> gridPositions;
+        std::vector<uint32_t> gridIndices;
+        std::vector<float> stripColors;
+        std::vector<std::array<float, 12>> worldTransforms;  // serial reference, row-major 3x4
+        bool is16BitIndices;
+    };
+
+    void PrintUsage()
+    {
+        printf("Usage: GltfLoaderTool [-grid <quads per side>] [-nodes <count>] [-threads <count>] [-output <directory>]\n");
+    }
+
+    template<typename T>
+    void Append(std::vector<uint8_t>& binary, const T* data, size_t count)
+    {
+        const size_t offset = binary.size();
+        binary.resize(offset + count * sizeof(T));
+        memcpy(binary.data() + offset, data, count * sizeof(T));
+        binary.resize(AlignSize(static_cast<uint64_t>(binary.size()), 4u));
+    }
+
+    // Node i > 0 is a child of node (i - 1) / 4, every node instances mesh i % 2 with a translation, a rotation
+    // around Y and a uniform scale. The world transforms are accumulated in node order, parents come first.
+    GeneratedScene GenerateScene(uint32_t gridSize, uint32_t numNodes)
+    {
+        GeneratedScene scene;
+        const uint32_t numVertices = (gridSize + 1) * (gridSize + 1);
+        scene.is16BitIndices = numVertices <= 65536;
+
+        // Grid: tightly packed float3 positions and normals, uint16 or uint32 indices
+        std::vector<float> normals;
+        for (uint32_t y = 0; y <= gridSize; ++y)
+        {
+            for (uint32_t x = 0; x <= gridSize; ++x)
+            {
+                const float height = 0.1f * std::sin(static_cast<float>(x) * 0.3f) * std::cos(static_cast<float>(y) * 0.2f);
+                scene.gridPositions.insert(scene.gridPositions.end(), { static_cast<float>(x) / gridSize, height, static_cast<float>(y) / gridSize });
+                normals.insert(normals.end(), { 0.0f, 1.0f, 0.0f });
+            }
+        }
+        for (uint32_t y = 0; y < gridSize; ++y)
+        {
+            for (uint32_t x = 0; x < gridSize; ++x)
+            {
+                const uint32_t v = y * (gridSize + 1) + x;
+                scene.gridIndices.insert(scene.gridIndices.end(), { v, v + gridSize + 1, v + 1, v + 1, v + gridSize + 1, v + gridSize + 2 });
+            }
+        }
+
+        // Strip: non-indexed triangles with interleaved colors, not in the GPU layout
+        std::vector<float> strip;
+        for (uint32_t v = 0; v < STRIP_TRIANGLES * 3; ++v)
+        {
+            const float color[4] = { static_cast<float>(v % 3) * 0.5f, static_cast<float>(v % 5) * 0.25f, 1.0f, 1.0f };
+            strip.insert(strip.end(), { static_cast<float>(v / 2), static_cast<float>(v % 2), static_cast<float>(v % 3) * 0.5f });
+            strip.insert(strip.end(), color, color + 4);
+            scene.stripColors.insert(scene.stripColors.end(), color, color + 4);
+        }
+
+        const uint64_t positionOffset = 0;
+        Append(scene.binary, scene.gridPositions.data(), scene.gridPositions.size());
+        const uint64_t normalOffset = scene.binary.size();
+        Append(scene.binary, normals.data(), normals.size());
+        const uint64_t indexOffset = scene.binary.size();
+        if (scene.is16BitIndices)
+        {
+            std::vector<uint16_t> indices(scene.gridIndices.begin(), scene.gridIndices.end());
+            Append(scene.binary, indices.data(), indices.size());
+        }
+        else
+        {
+            Append(scene.binary, scene.gridIndices.data(), scene.gridIndices.size());
+        }
+        const uint64_t stripOffset = scene.binary.size();
+        Append(scene.binary, strip.data(), strip.size());
+
+        const uint64_t indexSize = scene.gridIndices.size() * (scene.is16BitIndices ? 2 : 4);
+        std::string json = "{\"asset\":{\"version\":\"2.0\",\"generator\":\"GltfLoaderTool\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],";
+        json += "\"buffers\":[{\"byteLength\":" + std::to_string(scene.binary.size()) + "$URI$}],";
+        json += std::format("\"bufferViews\":[{{\"buffer\":0,\"byteOffset\":{},\"byteLength\":{}}},{{\"buffer\":0,\"byteOffset\":{},\"byteLength\":{}}},"
+            "{{\"buffer\":0,\"byteOffset\":{},\"byteLength\":{}}},{{\"buffer\":0,\"byteOffset\":{},\"byteLength\":{},\"byteStride\":{}}}],",
+            positionOffset, numVertices * 12, normalOffset, numVertices * 12, indexOffset, indexSize, stripOffset, strip.size() * sizeof(float), STRIP_STRIDE);
+        json += std::format("\"accessors\":[{{\"bufferView\":0,\"componentType\":5126,\"count\":{},\"type\":\"VEC3\",\"min\":[0,-0.1,0],\"max\":[1,0.1,1]}},"
+            "{{\"bufferView\":1,\"componentType\":5126,\"count\":{},\"type\":\"VEC3\"}},"
+            "{{\"bufferView\":2,\"componentType\":{},\"count\":{},\"type\":\"SCALAR\"}},"
+            "{{\"bufferView\":3,\"componentType\":5126,\"count\":{},\"type\":\"VEC3\"}},"
+            "{{\"bufferView\":3,\"byteOffset\":12,\"componentType\":5126,\"count\":{},\"type\":\"VEC4\"}}],",
+            numVertices, numVertices, scene.is16BitIndices ? 5123 : 5125, scene.gridIndices.size(), STRIP_TRIANGLES * 3, STRIP_TRIANGLES * 3);
+        json += "\"materials\":[{\"pbrMetallicRoughness\":{\"baseColorFactor\":[0.2,0.4,0.6,1.0]}},{\"pbrMetallicRoughness\":{}}],";
+        json += "\"meshes\":[{\"name\":\"grid\",\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1},\"indices\":2,\"material\":0}]},"
+            "{\"name\":\"strip\",\"primitives\":[{\"attributes\":{\"POSITION\":3,\"COLOR_0\":4},\"material\":1},{\"attributes\":{\"POSITION\":3},\"mode\":1}]}],";
+
+        json += "\"nodes\":[";
+        scene.worldTransforms.resize(numNodes);
+        for (uint32_t i = 0; i < numNodes; ++i)
+        {
+            const float angle = static_cast<float>(i % 8) * 0.1f;
+            const float scale = 0.9f;
+            const float translation[3] = { 1.0f, 0.0f, static_cast<float>(i % 3) * 0.5f };
+            const float local[12] = {
+                std::cos(angle) * scale, 0.0f, std::sin(angle) * scale, translation[0],
+                0.0f, scale, 0.0f, translation[1],
+                -std::sin(angle) * scale, 0.0f, std::cos(angle) * scale, translation[2],
+            };
+
+            std::array<float, 12>& world = scene.worldTransforms[i];
+            if (i == 0)
+            {
+                std::copy(local, local + 12, world.begin());
+            }
+            else
+            {
+                const std::array<float, 12>& parent = scene.worldTransforms[(i - 1) / 4];
+                for (uint32_t row = 0; row < 3; ++row)
+                {
+                    for (uint32_t column = 0; column < 4; ++column)
+                    {
+                        world[row * 4 + column] = parent[row * 4 + 0] * local[0 * 4 + column] + parent[row * 4 + 1] * local[1 * 4 + column] +
+                            parent[row * 4 + 2] * local[2 * 4 + column] + (column == 3 ? parent[row * 4 + 3] : 0.0f);
+                    }
+                }
+            }
+
+            json += std::format("{}{{\"name\":\"node_{}\",\"mesh\":{},\"translation\":[{},{},{}],\"rotation\":[0,{:.9g},0,{:.9g}],\"scale\":[{},{},{}]",
+                i == 0 ? "" : ",", i, i % 2, translation[0], translation[1], translation[2], std::sin(angle * 0.5f), std::cos(angle * 0.5f), scale, scale, scale);
+            std::string children;
+            for (uint32_t child = i * 4 + 1; child <= i * 4 + 4 && child < numNodes; ++child)
+            {
+                children += (children.empty() ? "" : ",") + std::to_string(child);
+            }
+            if (!children.empty())
+            {
+                json += ",\"children\":[" + children + "]";
+            }
+            json += "}";
+        }
+        json += "]}";
+        scene.json = std::move(json);
+        return scene;
+    }
+
+    std::string ReplaceUri(const std::string& json, const std::string& uri)
+    {
+        std::string result = json;
+        const size_t position = result.find("$URI$");
+        result.replace(position, 5, uri.empty() ? "" : ",\"uri\":\"" + uri + "\"");
+        return result;
+    }
+
+    std::string EncodeBase64(const std::vector<uint8_t>& data)
+    {
+        static const char TABLE[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::string text;
+        for (size_t i = 0; i < data.size(); i += 3)
+        {
+            const uint32_t n = (data[i] << 16) | ((i + 1 < data.size() ? data[i + 1] : 0) << 8) | (i + 2 < data.size() ? data[i + 2] : 0);
+            text += TABLE[(n >> 18) & 63];
+            text += TABLE[(n >> 12) & 63];
+            text += i + 1 < data.size() ? TABLE[(n >> 6) & 63] : '=';
+            text += i + 2 < data.size() ? TABLE[n & 63] : '=';
+        }
+        return text;
+    }
+
+    bool WriteFile(const std::string& path, const void* data, size_t size)
+    {
+        FILE* file = OpenFileStream(path.c_str(), "wb");
+        if (!file)
+        {
+            printf("Failed to create %s\n", path.c_str());
+            return false;
+        }
+        const bool isWritten = fwrite(data, 1, size, file) == size;
+        fclose(file);
+        return isWritten;
+    }
+
+    bool WriteGlb(const std::string& path, const GeneratedScene& scene)
+    {
+        std::string json = ReplaceUri(scene.json, "");
+        json.resize(AlignSize(static_cast<uint64_t>(json.size()), 4u), ' ');
+        std::vector<uint8_t> binary = scene.binary;
+        binary.resize(AlignSize(static_cast<uint64_t>(binary.size()), 4u), 0);
+
+        const uint32_t header[3] = { 0x46546C67, 2, static_cast<uint32_t>(12 + 8 + json.size() + 8 + binary.size()) };
+        const uint32_t jsonChunk[2] = { static_cast<uint32_t>(json.size()), 0x4E4F534A };
+        const uint32_t binaryChunk[2] = { static_cast<uint32_t>(binary.size()), 0x004E4942 };
+
+        std::vector<uint8_t> file;
+        Append(file, header, 3);
+        Append(file, jsonChunk, 2);
+        Append(file, json.data(), json.size());
+        Append(file, binaryChunk, 2);
+        Append(file, binary.data(), binary.size());
+        return WriteFile(path, file.data(), file.size());
+    }
+
+    bool Check(bool condition, const char* label, bool& passed)
+    {
+        if (!condition)
+        {
+            printf("  FAIL: %s\n", label);
+            passed = false;
+        }
+        return condition;
+    }
+
+    bool Verify(const char* label, const std::string& path, const GeneratedScene& expected, uint32_t numNodes, ThreadPool& threadPool)
+    {
+        GltfScene scene;
+        GltfLoadStats stats = {};
+        if (!scene.Load(path.c_str(), threadPool, &stats))
+        {
+            printf("=== %s: failed to load %s ===\n", label, path.c_str());
+            return false;
+        }
+
+        printf("=== %s: %.1f KB, %.1f KB buffers (%.1f KB decoded) ===\n", label, static_cast<double>(stats.fileSize) / 1024.0,
+            static_cast<double>(stats.bufferSize) / 1024.0, static_cast<double>(stats.copiedBufferSize) / 1024.0);
+        printf("  %u nodes (depth %u), %u meshes, %u primitives (%u skipped), %u instances\n",
+            stats.numNodes, stats.hierarchyDepth, stats.numMeshes, stats.numPrimitives, stats.numSkippedPrimitives, stats.numInstances);
+        printf("  map %.3f ms, JSON %.3f ms, flatten %.3f ms\n", stats.mapMilliseconds, stats.parseMilliseconds, stats.flattenMilliseconds);
+
+        bool passed = true;
+        Check(stats.numMeshes == 2 && stats.numPrimitives == 2 && stats.numSkippedPrimitives == 1, "mesh and primitive counts", passed);
+        Check(stats.numInstances == numNodes && scene.GetInstances().size() == numNodes, "one instance per node", passed);
+        if (!passed)
+        {
+            return false;
+        }
+
+        // The grid is in the GPU layout, its views must be tight and point at the generated data
+        const GltfPrimitive& grid = scene.GetPrimitives()[scene.GetMeshes()[0].firstPrimitive];
+        Check(grid.positions.Is(GltfComponentType::Float, 3) && grid.positions.IsTightlyPacked(), "tightly packed float3 positions", passed);
+        Check(grid.indices.Is(expected.is16BitIndices ? GltfComponentType::UInt16 : GltfComponentType::UInt32, 1) && grid.indices.IsTightlyPacked(),
+            "tightly packed indices", passed);
+        Check(grid.positions.IsPresent() && memcmp(grid.positions.data, expected.gridPositions.data(), expected.gridPositions.size() * sizeof(float)) == 0,
+            "position data", passed);
+        bool isIndexMatching = grid.indices.count == expected.gridIndices.size();
+        for (uint32_t i = 0; isIndexMatching && i < grid.indices.count; ++i)
+        {
+            isIndexMatching = grid.indices.ReadIndex(i) == expected.gridIndices[i];
+        }
+        Check(isIndexMatching, "index data", passed);
+        Check(grid.baseColor[2] == 0.6f && grid.boundsMax[0] == 1.0f, "material and bounds", passed);
+
+        // The strip is interleaved and non-indexed, it is converted
+        const GltfPrimitive& strip = scene.GetPrimitives()[scene.GetMeshes()[1].firstPrimitive];
+        std::vector<GeometrySourceVertex> vertices;
+        std::vector<uint32_t> indices;
+        ConvertGltfPrimitive(strip, vertices, indices);
+        Check(!strip.positions.IsTightlyPacked() && strip.positions.stride == STRIP_STRIDE, "interleaved positions", passed);
+        Check(vertices.size() == STRIP_TRIANGLES * 3 && indices.size() == STRIP_TRIANGLES * 3, "converted strip", passed);
+        bool isColorMatching = vertices.size() == STRIP_TRIANGLES * 3;
+        for (size_t v = 0; isColorMatching && v < vertices.size(); ++v)
+        {
+            const float length = std::sqrt(vertices[v].normal[0] * vertices[v].normal[0] + vertices[v].normal[1] * vertices[v].normal[1] + vertices[v].normal[2] * vertices[v].normal[2]);
+            isColorMatching = std::abs(length - 1.0f) < 1.0e-3f || length == 0.0f;
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                isColorMatching = isColorMatching && vertices[v].color[c] == expected.stripColors[v * 4 + c];
+            }
+        }
+        Check(isColorMatching, "converted normals and colors", passed);
+
+        // Flattened hierarchy against the serial reference
+        float maxError = 0.0f;
+        for (const GltfInstance& instance : scene.GetInstances())
+        {
+            // Instances are not in node order, match them by transform
+            float bestError = FLT_MAX;
+            for (uint32_t node = instance.meshIndex; node < numNodes; node += 2)
+            {
+                float error = 0.0f;
+                for (uint32_t e = 0; e < 12; ++e)
+                {
+                    error = std::max(error, std::abs(instance.transform[e / 4][e % 4] - expected.worldTransforms[node][e]));
+                }
+                bestError = std::min(bestError, error);
+            }
+            maxError = std::max(maxError, bestError);
+        }
+        printf("  world transforms: max error %g\n", maxError);
+        Check(maxError < 1.0e-4f, "world transforms", passed);
+
+        printf("  %s\n", passed ? "PASS" : "FAIL");
+        return passed;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t gridSize = 300;
+    uint32_t numNodes = 1000;
+    uint32_t numThreads = 0;
+    std::string directory = ".";
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-grid") == 0 && i + 1 < argc)
+        {
+            gridSize = std::max(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 1u);
+        }
+        else if (strcmp(argv[i], "-nodes") == 0 && i + 1 < argc)
+        {
+            numNodes = std::max(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 1u);
+        }
+        else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+        {
+            numThreads = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "-output") == 0 && i + 1 < argc)
+        {
+            directory = argv[++i];
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    const GeneratedScene scene = GenerateScene(gridSize, numNodes);
+    printf("Generated: %u x %u grid (%s indices), %u nodes, %zu bytes of buffer\n", gridSize, gridSize,
+        scene.is16BitIndices ? "16-bit" : "32-bit", numNodes, scene.binary.size());
+
+    // The external buffer name needs percent decoding
+    const std::string glbPath = directory + "/GltfLoaderTool.glb";
+    const std::string gltfPath = directory + "/GltfLoaderTool.gltf";
+    const std::string binaryPath = directory + "/GltfLoaderTool buffer.bin";
+    const std::string dataUriPath = directory + "/GltfLoaderTool_embedded.gltf";
+    const std::string gltfJson = ReplaceUri(scene.json, "GltfLoaderTool%20buffer.bin");
+    const std::string dataUriJson = ReplaceUri(scene.json, "data:application/octet-stream;base64," + EncodeBase64(scene.binary));
+    if (!WriteGlb(glbPath, scene) || !WriteFile(gltfPath, gltfJson.data(), gltfJson.size()) ||
+        !WriteFile(binaryPath, scene.binary.data(), scene.binary.size()) || !WriteFile(dataUriPath, dataUriJson.data(), dataUriJson.size()))
+    {
+        return 1;
+    }
+
+    ThreadPool threadPool(numThreads);
+    bool passed = Verify("GLB", glbPath, scene, numNodes, threadPool);
+    passed = Verify("glTF + .bin", gltfPath, scene, numNodes, threadPool) && passed;
+    passed = Verify("glTF + data URI", dataUriPath, scene, numNodes, threadPool) && passed;
+
+    remove(glbPath.c_str());
+    remove(gltfPath.c_str());
+    remove(binaryPath.c_str());
+    remove(dataUriPath.c_str());
+    return passed ? 0 : 1;
+}
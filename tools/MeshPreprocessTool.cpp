@@ -0,0 +1,270 @@
+// Runs the mesh preprocessing (MeshPreprocess) on a generated CAD-like mesh and reports the vertex and index
+// savings, the vertex cache efficiency and the processing time. The output is checked to contain exactly the
+// non-degenerate triangles of the input; the tool exits with 1 otherwise.
+//
+// The generated mesh is a tessellated sphere stored like an exported CAD mesh: every triangle has its own three
+// vertices (6x duplicated vertices in the interior of the tessellation) and the triangles are shuffled.
+//
+// Build (Linux):
+//   g++ -std=c++20 -O2 -Isrc tools/MeshPreprocessTool.cpp src/MeshPreprocess.cpp -o MeshPreprocessTool
+// Build (Windows, Developer Command Prompt):
+//   cl /std:c++20 /O2 /EHsc /Isrc tools\MeshPreprocessTool.cpp src\MeshPreprocess.cpp /Fe:MeshPreprocessTool.exe
+//
+// Usage:
+//   MeshPreprocessTool [-segments <count>] [-seed <value>] [-indexed]
+
+#include "MeshPreprocess.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+    using Triangle = std::array<GeometrySourceVertex, 3>;
+
+    void PrintUsage()
+    {
+        printf("Usage: MeshPreprocessTool [-segments <count>] [-seed <value>] [-indexed]\n");
+    }
+
+    GeometrySourceVertex MakeSphereVertex(uint32_t ring, uint32_t segment, uint32_t numRings, uint32_t numSegments)
+    {
+        const float PI = 3.14159265f;
+        const float theta = PI * static_cast<float>(ring) / static_cast<float>(numRings);
+        // The seam reuses the first segment so that it welds
+        const float phi = 2.0f * PI * static_cast<float>(segment % numSegments) / static_cast<float>(numSegments);
+
+        GeometrySourceVertex vertex = {};
+        vertex.normal[0] = std::sin(theta) * std::cos(phi);
+        vertex.normal[1] = std::cos(theta);
+        vertex.normal[2] = std::sin(theta) * std::sin(phi);
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            vertex.position[axis] = vertex.normal[axis] * 10.0f;
+        }
+        vertex.color[0] = 0.8f;
+        vertex.color[1] = 0.8f;
+        vertex.color[2] = 0.8f;
+        vertex.color[3] = 1.0f;
+        return vertex;
+    }
+
+    // Sphere tessellation as a triangle list, the triangles touching the poles are degenerate like in many exporters
+    void GenerateSphere(uint32_t numSegments, bool indexed, uint32_t seed, std::vector<GeometrySourceVertex>& vertices, std::vector<uint32_t>& indices)
+    {
+        const uint32_t numRings = std::max(numSegments / 2, 2u);
+
+        std::vector<std::array<uint32_t, 3>> triangles;
+        std::vector<GeometrySourceVertex> gridVertices;
+        for (uint32_t ring = 0; ring <= numRings; ++ring)
+        {
+            for (uint32_t segment = 0; segment <= numSegments; ++segment)
+            {
+                gridVertices.push_back(MakeSphereVertex(ring, segment, numRings, numSegments));
+            }
+        }
+
+        const uint32_t rowSize = numSegments + 1;
+        for (uint32_t ring = 0; ring < numRings; ++ring)
+        {
+            for (uint32_t segment = 0; segment < numSegments; ++segment)
+            {
+                const uint32_t v0 = ring * rowSize + segment;
+                const uint32_t v1 = v0 + 1;
+                const uint32_t v2 = v0 + rowSize;
+                const uint32_t v3 = v2 + 1;
+                triangles.push_back({ v0, v2, v1 });
+                triangles.push_back({ v1, v2, v3 });
+            }
+        }
+
+        std::mt19937 random(seed);
+        std::shuffle(triangles.begin(), triangles.end(), random);
+
+        vertices.clear();
+        indices.clear();
+        if (indexed)
+        {
+            vertices = gridVertices;
+            for (const auto& triangle : triangles)
+            {
+                indices.insert(indices.end(), triangle.begin(), triangle.end());
+            }
+            return;
+        }
+
+        for (const auto& triangle : triangles)
+        {
+            for (uint32_t v : triangle)
+            {
+                indices.push_back(static_cast<uint32_t>(vertices.size()));
+                vertices.push_back(gridVertices[v]);
+            }
+        }
+    }
+
+    bool VerticesEqual(const GeometrySourceVertex& a, const GeometrySourceVertex& b)
+    {
+        const float* va = reinterpret_cast<const float*>(&a);
+        const float* vb = reinterpret_cast<const float*>(&b);
+        for (size_t i = 0; i < sizeof(GeometrySourceVertex) / sizeof(float); ++i)
+        {
+            if (va[i] != vb[i])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool TriangleLess(const Triangle& a, const Triangle& b)
+    {
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            const float* va = reinterpret_cast<const float*>(&a[k]);
+            const float* vb = reinterpret_cast<const float*>(&b[k]);
+            for (size_t i = 0; i < sizeof(GeometrySourceVertex) / sizeof(float); ++i)
+            {
+                if (va[i] != vb[i])
+                {
+                    return va[i] < vb[i];
+                }
+            }
+        }
+        return false;
+    }
+
+    // The output must contain the same triangles, with the same winding, as the non-degenerate input triangles.
+    // Without the weld only the triangles with repeated indices are degenerate.
+    bool VerifyTriangles(const std::vector<GeometrySourceVertex>& vertices, const std::vector<uint32_t>& indices, bool weldVertices, const PreprocessedMesh& mesh)
+    {
+        std::vector<Triangle> expected;
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            const uint32_t a = indices[i];
+            const uint32_t b = indices[i + 1];
+            const uint32_t c = indices[i + 2];
+            const Triangle triangle = { vertices[a], vertices[b], vertices[c] };
+            const bool isDegenerate = weldVertices ?
+                VerticesEqual(triangle[0], triangle[1]) || VerticesEqual(triangle[1], triangle[2]) || VerticesEqual(triangle[2], triangle[0]) :
+                a == b || b == c || c == a;
+            if (!isDegenerate)
+            {
+                expected.push_back(triangle);
+            }
+        }
+
+        std::vector<Triangle> actual;
+        for (uint32_t i = 0; i < mesh.GetIndexCount(); i += 3)
+        {
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                if (mesh.GetIndex(i + k) >= mesh.vertices.size())
+                {
+                    printf("  index %u out of range\n", i + k);
+                    return false;
+                }
+            }
+            actual.push_back({ mesh.vertices[mesh.GetIndex(i)], mesh.vertices[mesh.GetIndex(i + 1)], mesh.vertices[mesh.GetIndex(i + 2)] });
+        }
+
+        if (expected.size() != actual.size())
+        {
+            printf("  triangle count mismatch: expected %zu, got %zu\n", expected.size(), actual.size());
+            return false;
+        }
+
+        std::sort(expected.begin(), expected.end(), TriangleLess);
+        std::sort(actual.begin(), actual.end(), TriangleLess);
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                if (!VerticesEqual(expected[i][k], actual[i][k]))
+                {
+                    printf("  triangle %zu differs\n", i);
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t numSegments = 256;
+    uint32_t seed = 1;
+    bool indexed = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-segments") == 0 && i + 1 < argc)
+        {
+            numSegments = std::max(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 3u);
+        }
+        else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc)
+        {
+            seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "-indexed") == 0)
+        {
+            indexed = true;
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    std::vector<GeometrySourceVertex> vertices;
+    std::vector<uint32_t> indices;
+    GenerateSphere(numSegments, indexed, seed, vertices, indices);
+
+    struct Configuration
+    {
+        const char* name;
+        MeshPreprocessOptions options;
+    };
+    const Configuration configurations[] = {
+        { "16-bit indices only", { false, false, true } },
+        { "weld", { true, false, true } },
+        { "weld + triangle order", { true, true, true } },
+        { "weld + triangle order, 32-bit", { true, true, false } },
+    };
+
+    printf("Input: %u vertices, %u triangles (%s)\n", static_cast<uint32_t>(vertices.size()), static_cast<uint32_t>(indices.size() / 3),
+        indexed ? "indexed" : "triangle soup");
+
+    bool passed = true;
+    for (const Configuration& configuration : configurations)
+    {
+        PreprocessedMesh mesh;
+        MeshPreprocessStats stats = {};
+        PreprocessMesh(vertices.data(), static_cast<uint32_t>(vertices.size()), indices.data(), static_cast<uint32_t>(indices.size()),
+            configuration.options, mesh, &stats);
+
+        const bool verified = VerifyTriangles(vertices, indices, configuration.options.weldVertices, mesh);
+        passed = passed && verified;
+
+        printf("=== %s ===\n", configuration.name);
+        printf("  vertices        : %u -> %u (%.2fx duplication)\n", stats.inputVertexCount, stats.outputVertexCount,
+            static_cast<double>(stats.inputVertexCount) / std::max(stats.outputVertexCount, 1u));
+        printf("  triangles       : %u -> %u\n", stats.inputTriangleCount, stats.outputTriangleCount);
+        printf("  index format    : %u bytes\n", stats.indexStride);
+        printf("  size            : %zu -> %zu bytes (%.1f%% saved)\n", stats.inputBytes, stats.outputBytes,
+            100.0 * (1.0 - static_cast<double>(stats.outputBytes) / static_cast<double>(stats.inputBytes)));
+        printf("  ACMR (cache %2u) : %.3f -> %.3f\n", ACMR_CACHE_SIZE, stats.inputAcmr, stats.outputAcmr);
+        printf("  time            : %.2f ms (%.1f Mtriangles/s)\n", stats.milliseconds,
+            stats.inputTriangleCount / std::max(stats.milliseconds, 1.0e-3) / 1.0e3);
+        printf("  result          : %s\n", verified ? "PASS" : "FAIL");
+    }
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,321 @@
+// Measures the throughput of the multithreaded OBJ loader (ObjLoader) on a generated multi-million triangle OBJ file
+// and checks the loaded counts and the accuracy of the hand-written float parser against strtof. Exits with 1 when a
+// check fails.
+//
+// Build (Linux):
+//   g++ -std=c++20 -O2 -pthread -Isrc tools/ObjLoaderBenchmark.cpp src/ObjLoader.cpp src/MappedFile.cpp src/ThreadPool.cpp -o ObjLoaderBenchmark
+// Build (Windows, Developer Command Prompt):
+//   cl /std:c++20 /O2 /EHsc /Isrc tools\ObjLoaderBenchmark.cpp src\ObjLoader.cpp src\MappedFile.cpp src\ThreadPool.cpp /Fe:ObjLoaderBenchmark.exe
+//
+// Usage:
+//   ObjLoaderBenchmark <file.obj> [-generate <triangles>] [-threads <count>] [-iterations <count>]
+//   With -generate the file is (over)written with a generated mesh of about the given number of triangles first.
+
+#include "MappedFile.h"
+#include "ObjLoader.h"
+#include "PlatformHelpers.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    const uint32_t NUM_OBJECTS = 16;
+
+    struct GeneratedCounts
+    {
+        uint64_t numPositions;
+        uint64_t numNormals;
+        uint64_t numTriangles;
+        uint32_t numMeshes;
+    };
+
+    void PrintUsage()
+    {
+        printf("Usage: ObjLoaderBenchmark <file.obj> [-generate <triangles>] [-threads <count>] [-iterations <count>]\n");
+    }
+
+    // Grids of quads with jittered positions, one object per grid. Every 4th quad is written as two triangles,
+    // the others as polygons. Faces use v//vn corners, every 8th row uses relative indices.
+    bool GenerateObj(const char* path, uint64_t targetTriangles, GeneratedCounts& counts)
+    {
+        FILE* file = OpenFileStream(path, "wb");
+        if (!file)
+        {
+            printf("Failed to create %s\n", path);
+            return false;
+        }
+
+        const uint64_t trianglesPerObject = std::max<uint64_t>(targetTriangles / NUM_OBJECTS, 2);
+        const uint32_t gridSize = std::max(static_cast<uint32_t>(std::sqrt(static_cast<double>(trianglesPerObject) / 2.0)), 1u);
+
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> jitter(-0.25f, 0.25f);
+
+        counts = {};
+        std::string buffer;
+        buffer.reserve(1 << 22);
+        char line[256];
+
+        auto flush = [&](bool force)
+        {
+            if (force || buffer.size() > (1 << 21))
+            {
+                fwrite(buffer.data(), 1, buffer.size(), file);
+                buffer.clear();
+            }
+        };
+
+        fprintf(file, "# Generated by ObjLoaderBenchmark\n");
+        for (uint32_t object = 0; object < NUM_OBJECTS; ++object)
+        {
+            const uint64_t positionBase = counts.numPositions + 1;
+            buffer += "o object_" + std::to_string(object) + "\n";
+
+            const uint32_t numVertices = gridSize + 1;
+            for (uint32_t y = 0; y < numVertices; ++y)
+            {
+                for (uint32_t x = 0; x < numVertices; ++x)
+                {
+                    const int length = snprintf(line, sizeof(line), "v %.6f %.6f %.6f\nvn %.6f %.6f %.6f\n",
+                        static_cast<float>(x) + jitter(random), static_cast<float>(object) * 2.0f + jitter(random), static_cast<float>(y) + jitter(random),
+                        jitter(random), 1.0f, jitter(random));
+                    buffer.append(line, static_cast<size_t>(length));
+                    flush(false);
+                }
+            }
+            counts.numPositions += static_cast<uint64_t>(numVertices) * numVertices;
+            counts.numNormals += static_cast<uint64_t>(numVertices) * numVertices;
+
+            const uint64_t numObjectVertices = static_cast<uint64_t>(numVertices) * numVertices;
+            for (uint32_t y = 0; y < gridSize; ++y)
+            {
+                for (uint32_t x = 0; x < gridSize; ++x)
+                {
+                    uint64_t v[4] = {
+                        positionBase + static_cast<uint64_t>(y) * numVertices + x,
+                        positionBase + static_cast<uint64_t>(y) * numVertices + x + 1,
+                        positionBase + static_cast<uint64_t>(y + 1) * numVertices + x + 1,
+                        positionBase + static_cast<uint64_t>(y + 1) * numVertices + x,
+                    };
+
+                    int length = 0;
+                    if (y % 8 == 7)
+                    {
+                        // Relative to the end of the positions of this object
+                        const int64_t end = static_cast<int64_t>(positionBase + numObjectVertices);
+                        length = snprintf(line, sizeof(line), "f %lld//%lld %lld//%lld %lld//%lld %lld//%lld\n",
+                            static_cast<long long>(v[0] - end), static_cast<long long>(v[0] - end), static_cast<long long>(v[1] - end), static_cast<long long>(v[1] - end),
+                            static_cast<long long>(v[2] - end), static_cast<long long>(v[2] - end), static_cast<long long>(v[3] - end), static_cast<long long>(v[3] - end));
+                    }
+                    else if (x % 4 == 0)
+                    {
+                        length = snprintf(line, sizeof(line), "f %llu//%llu %llu//%llu %llu//%llu\nf %llu//%llu %llu//%llu %llu//%llu\n",
+                            static_cast<unsigned long long>(v[0]), static_cast<unsigned long long>(v[0]), static_cast<unsigned long long>(v[1]), static_cast<unsigned long long>(v[1]),
+                            static_cast<unsigned long long>(v[2]), static_cast<unsigned long long>(v[2]), static_cast<unsigned long long>(v[0]), static_cast<unsigned long long>(v[0]),
+                            static_cast<unsigned long long>(v[2]), static_cast<unsigned long long>(v[2]), static_cast<unsigned long long>(v[3]), static_cast<unsigned long long>(v[3]));
+                    }
+                    else
+                    {
+                        length = snprintf(line, sizeof(line), "f %llu//%llu %llu//%llu %llu//%llu %llu//%llu\n",
+                            static_cast<unsigned long long>(v[0]), static_cast<unsigned long long>(v[0]), static_cast<unsigned long long>(v[1]), static_cast<unsigned long long>(v[1]),
+                            static_cast<unsigned long long>(v[2]), static_cast<unsigned long long>(v[2]), static_cast<unsigned long long>(v[3]), static_cast<unsigned long long>(v[3]));
+                    }
+                    buffer.append(line, static_cast<size_t>(length));
+                    flush(false);
+                }
+            }
+            counts.numTriangles += static_cast<uint64_t>(gridSize) * gridSize * 2;
+            ++counts.numMeshes;
+        }
+        flush(true);
+        fclose(file);
+        return true;
+    }
+
+    uint32_t UlpDistance(float a, float b)
+    {
+        int32_t ia = 0;
+        int32_t ib = 0;
+        memcpy(&ia, &a, sizeof(a));
+        memcpy(&ib, &b, sizeof(b));
+        // Map the sign-magnitude representation to a monotonic one
+        ia = ia < 0 ? INT32_MIN - ia : ia;
+        ib = ib < 0 ? INT32_MIN - ib : ib;
+        return static_cast<uint32_t>(std::abs(static_cast<int64_t>(ia) - static_cast<int64_t>(ib)));
+    }
+
+    // Compare ParseObjFloat with strtof on random numbers in the notations found in OBJ files
+    bool CheckFloatParser()
+    {
+        std::mt19937 random(7);
+        std::uniform_real_distribution<double> mantissaDistribution(-1.0, 1.0);
+        std::uniform_int_distribution<int> exponentDistribution(-12, 12);
+        std::uniform_int_distribution<int> precisionDistribution(1, 12);
+
+        const uint32_t NUM_SAMPLES = 1000000;
+        uint32_t numExact = 0;
+        uint32_t maxUlp = 0;
+        char text[64];
+        for (uint32_t i = 0; i < NUM_SAMPLES; ++i)
+        {
+            const double value = mantissaDistribution(random) * std::pow(10.0, exponentDistribution(random));
+            const int length = (i % 2 == 0) ?
+                snprintf(text, sizeof(text), "%.*f", precisionDistribution(random), value) :
+                snprintf(text, sizeof(text), "%.*e", precisionDistribution(random), value);
+
+            float parsed = 0.0f;
+            const char* end = ParseObjFloat(text, text + length, parsed);
+            const float expected = strtof(text, nullptr);
+            if (end != text + length)
+            {
+                printf("  float parser stopped early on \"%s\"\n", text);
+                return false;
+            }
+
+            const uint32_t ulp = UlpDistance(parsed, expected);
+            numExact += ulp == 0;
+            maxUlp = std::max(maxUlp, ulp);
+        }
+
+        printf("Float parser: %.4f%% identical to strtof, max %u ulp\n", 100.0 * numExact / NUM_SAMPLES, maxUlp);
+        return maxUlp <= 1;
+    }
+
+    struct Measurement
+    {
+        ObjLoadStats stats;
+        double totalMilliseconds;
+    };
+
+    // Best of the iterations, the file is mapped once so that the parse is measured from the page cache
+    Measurement Measure(const MappedFile& file, uint32_t numThreads, uint32_t numIterations, uint64_t& numTriangles)
+    {
+        ThreadPool threadPool(numThreads);
+        Measurement best = {};
+        best.totalMilliseconds = 1.0e30;
+        for (uint32_t i = 0; i < numIterations; ++i)
+        {
+            std::vector<ObjMesh> meshes;
+            ObjLoadStats stats = {};
+            const auto startTime = std::chrono::steady_clock::now();
+            ParseObj(file.GetData(), static_cast<size_t>(file.GetSize()), threadPool, meshes, &stats);
+            const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+            if (milliseconds < best.totalMilliseconds)
+            {
+                best.stats = stats;
+                best.totalMilliseconds = milliseconds;
+            }
+            numTriangles = stats.numTriangles;
+        }
+        return best;
+    }
+
+    void PrintMeasurement(const char* label, const Measurement& measurement)
+    {
+        const double gigabytes = static_cast<double>(measurement.stats.fileSize) / 1.0e9;
+        printf("=== %s: %u threads, %u chunks ===\n", label, measurement.stats.numThreads, measurement.stats.numChunks);
+        printf("  parse           : %8.1f ms (%.2f GB/s)\n", measurement.stats.parseMilliseconds, gigabytes / (measurement.stats.parseMilliseconds / 1000.0));
+        printf("  merge           : %8.1f ms\n", measurement.stats.mergeMilliseconds);
+        printf("  build meshes    : %8.1f ms\n", measurement.stats.buildMilliseconds);
+        printf("  total           : %8.1f ms (%.2f GB/s)\n", measurement.totalMilliseconds, gigabytes / (measurement.totalMilliseconds / 1000.0));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* path = nullptr;
+    uint64_t generateTriangles = 0;
+    uint32_t numThreads = 0;
+    uint32_t numIterations = 3;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-generate") == 0 && i + 1 < argc)
+        {
+            generateTriangles = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+        {
+            numThreads = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "-iterations") == 0 && i + 1 < argc)
+        {
+            numIterations = std::max(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 1u);
+        }
+        else if (argv[i][0] != '-' && !path)
+        {
+            path = argv[i];
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (!path)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    bool passed = CheckFloatParser();
+
+    GeneratedCounts expected = {};
+    if (generateTriangles > 0)
+    {
+        printf("Generating %s ...\n", path);
+        if (!GenerateObj(path, generateTriangles, expected))
+        {
+            return 1;
+        }
+    }
+
+    MappedFile file;
+    if (!file.Open(path))
+    {
+        printf("Failed to open %s\n", path);
+        return 1;
+    }
+    printf("%s: %.1f MB\n", path, static_cast<double>(file.GetSize()) / 1.0e6);
+
+    if (numThreads == 0)
+    {
+        numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    uint64_t numTriangles = 0;
+    const Measurement singleThreaded = Measure(file, 1, numIterations, numTriangles);
+    PrintMeasurement("single thread", singleThreaded);
+    const Measurement multiThreaded = Measure(file, numThreads, numIterations, numTriangles);
+    PrintMeasurement("thread pool", multiThreaded);
+    printf("Speedup: parse %.2fx, total %.2fx\n",
+        singleThreaded.stats.parseMilliseconds / multiThreaded.stats.parseMilliseconds,
+        singleThreaded.totalMilliseconds / multiThreaded.totalMilliseconds);
+
+    const ObjLoadStats& stats = multiThreaded.stats;
+    printf("Loaded: %llu positions, %llu normals, %llu triangles, %u meshes\n",
+        static_cast<unsigned long long>(stats.numPositions), static_cast<unsigned long long>(stats.numNormals),
+        static_cast<unsigned long long>(stats.numTriangles), stats.numMeshes);
+
+    // Both thread counts must load the same mesh, and a generated file the generated counts
+    bool countsMatch = singleThreaded.stats.numTriangles == stats.numTriangles && stats.numInvalidTriangles == 0;
+    if (generateTriangles > 0)
+    {
+        countsMatch = countsMatch && stats.numPositions == expected.numPositions && stats.numNormals == expected.numNormals &&
+            stats.numTriangles == expected.numTriangles && stats.numMeshes == expected.numMeshes;
+    }
+    printf("Counts: %s\n", countsMatch ? "PASS" : "FAIL");
+    passed = passed && countsMatch;
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,298 @@
+// Checks the pipeline stack size (PipelineStackGraph) on random call graphs: the stack size is the one of the deepest
+// path found by a plain enumeration of every path, it never exceeds the default of the DXR specification, it equals
+// the default when every closest hit and miss shader traces every ray type, and it grows with the recursion depth.
+// The megakernel and a recursive reflection graph are checked with fixed values. Exits with 1 when a check fails.
+//
+// Build (Linux):
+//   g++ -std=c++20 -O2 -Isrc tools/PipelineStackSizeTool.cpp src/PipelineStackSize.cpp -o PipelineStackSizeTool
+// Build (Windows, Developer Command Prompt):
+//   cl /std:c++20 /O2 /EHsc /Isrc tools\PipelineStackSizeTool.cpp src\PipelineStackSize.cpp /Fe:PipelineStackSizeTool.exe
+//
+// Usage:
+//   PipelineStackSizeTool [-iterations <count>] [-seed <value>]
+
+#include "PipelineStackSize.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+    const uint32_t MAX_RECURSION_DEPTH = 31;     // D3D12_RAYTRACING_MAX_DECLARABLE_TRACE_RECURSION_DEPTH
+
+    // Copy of the graph given to PipelineStackGraph, for the enumeration of the paths
+    struct Graph
+    {
+        struct Shader
+        {
+            PipelineShaderStage stage;
+            uint64_t stackSize;
+            std::vector<uint32_t> tracedRayTypes;
+        };
+        struct HitGroup
+        {
+            uint32_t rayType;
+            uint32_t closestHit;
+            uint32_t anyHit;
+            uint32_t intersection;
+        };
+
+        std::vector<Shader> shaders;
+        std::vector<HitGroup> hitGroups;
+        std::vector<std::pair<uint32_t, uint32_t>> misses;
+        PipelineStackGraph stackGraph;
+
+        uint32_t AddShader(PipelineShaderStage stage, uint64_t stackSize)
+        {
+            shaders.push_back({ stage, stackSize, {} });
+            return stackGraph.AddShader(stage, stackSize);
+        }
+        void AddHitGroup(uint32_t rayType, uint32_t closestHit, uint32_t anyHit, uint32_t intersection)
+        {
+            hitGroups.push_back({ rayType, closestHit, anyHit, intersection });
+            stackGraph.AddHitGroup(rayType, closestHit, anyHit, intersection);
+        }
+        void AddMiss(uint32_t rayType, uint32_t miss)
+        {
+            misses.emplace_back(rayType, miss);
+            stackGraph.AddMiss(rayType, miss);
+        }
+        void AddTrace(uint32_t shader, uint32_t rayType)
+        {
+            shaders[shader].tracedRayTypes.push_back(rayType);
+            stackGraph.AddTrace(shader, rayType);
+        }
+    };
+
+    void PrintUsage()
+    {
+        printf("Usage: PipelineStackSizeTool [-iterations <count>] [-seed <value>]\n");
+    }
+
+    bool Check(bool condition, const char* message, uint32_t iteration)
+    {
+        if (!condition)
+        {
+            printf("Iteration %u: %s\n", iteration, message);
+        }
+        return condition;
+    }
+
+    uint64_t GetStackSize(const Graph& graph, uint32_t shader)
+    {
+        return shader == PipelineStackGraph::NO_SHADER ? 0 : graph.shaders[shader].stackSize;
+    }
+
+    // Every path below a shader, without sharing the results of a shader reached twice
+    uint64_t EnumeratePaths(const Graph& graph, uint32_t shader, uint32_t depth, uint32_t maxDepth)
+    {
+        uint64_t deepest = 0;
+        for (uint32_t rayType : depth < maxDepth ? graph.shaders[shader].tracedRayTypes : std::vector<uint32_t>())
+        {
+            for (const Graph::HitGroup& hitGroup : graph.hitGroups)
+            {
+                if (hitGroup.rayType == rayType)
+                {
+                    if (hitGroup.closestHit != PipelineStackGraph::NO_SHADER)
+                    {
+                        deepest = std::max(deepest, EnumeratePaths(graph, hitGroup.closestHit, depth + 1, maxDepth));
+                    }
+                    deepest = std::max(deepest, GetStackSize(graph, hitGroup.intersection) + GetStackSize(graph, hitGroup.anyHit));
+                }
+            }
+            for (const auto& [missRayType, miss] : graph.misses)
+            {
+                if (missRayType == rayType)
+                {
+                    deepest = std::max(deepest, EnumeratePaths(graph, miss, depth + 1, maxDepth));
+                }
+            }
+        }
+        return graph.shaders[shader].stackSize + deepest;
+    }
+
+    uint64_t EnumeratePaths(const Graph& graph, uint32_t maxDepth)
+    {
+        uint64_t deepest = 0;
+        for (uint32_t shader = 0; shader < graph.shaders.size(); ++shader)
+        {
+            if (graph.shaders[shader].stage == PipelineShaderStage::RayGen)
+            {
+                deepest = std::max(deepest, EnumeratePaths(graph, shader, 0, maxDepth));
+            }
+        }
+        return deepest;
+    }
+
+    // Shaders of every stage for rayTypeCount ray types with a miss shader each, hit groups with random shaders, and
+    // random traces. With isFullyTracing every ray generation, closest hit and miss shader traces every ray type and
+    // the largest any hit and intersection shaders share a hit group, which is the assumption of the default.
+    Graph CreateRandomGraph(std::mt19937& random, bool isFullyTracing)
+    {
+        std::uniform_int_distribution<uint32_t> countDistribution(1, 3);
+        std::uniform_int_distribution<uint64_t> stackSizeDistribution(0, 64);
+        auto randomStackSize = [&]() { return stackSizeDistribution(random) * 8; };
+
+        Graph graph;
+        const uint32_t rayTypeCount = countDistribution(random);
+        const uint32_t rayGenCount = countDistribution(random);
+        for (uint32_t i = 0; i < rayGenCount; ++i)
+        {
+            graph.AddShader(PipelineShaderStage::RayGen, randomStackSize());
+        }
+        for (uint32_t rayType = 0; rayType < rayTypeCount; ++rayType)
+        {
+            graph.AddMiss(rayType, graph.AddShader(PipelineShaderStage::Miss, randomStackSize()));
+        }
+
+        // A hit group may lack any of its shaders, a ray type without hit group has null records
+        std::vector<uint32_t> anyHits;
+        std::vector<uint32_t> intersections;
+        const uint32_t hitGroupCount = countDistribution(random) + 1;
+        for (uint32_t i = 0; i < hitGroupCount; ++i)
+        {
+            const uint32_t closestHit = random() % 4 != 0 ? graph.AddShader(PipelineShaderStage::ClosestHit, randomStackSize()) : PipelineStackGraph::NO_SHADER;
+            const uint32_t anyHit = random() % 2 == 0 ? graph.AddShader(PipelineShaderStage::AnyHit, randomStackSize()) : PipelineStackGraph::NO_SHADER;
+            const uint32_t intersection = random() % 2 == 0 ? graph.AddShader(PipelineShaderStage::Intersection, randomStackSize()) : PipelineStackGraph::NO_SHADER;
+            graph.AddHitGroup(random() % rayTypeCount, closestHit, anyHit, intersection);
+            if (anyHit != PipelineStackGraph::NO_SHADER)
+            {
+                anyHits.push_back(anyHit);
+            }
+            if (intersection != PipelineStackGraph::NO_SHADER)
+            {
+                intersections.push_back(intersection);
+            }
+        }
+        if (isFullyTracing)
+        {
+            auto largest = [&graph](const std::vector<uint32_t>& shaders)
+            {
+                auto it = std::max_element(shaders.begin(), shaders.end(),
+                    [&graph](uint32_t a, uint32_t b) { return graph.shaders[a].stackSize < graph.shaders[b].stackSize; });
+                return it != shaders.end() ? *it : PipelineStackGraph::NO_SHADER;
+            };
+            graph.AddHitGroup(0, PipelineStackGraph::NO_SHADER, largest(anyHits), largest(intersections));
+        }
+
+        for (uint32_t shader = 0; shader < graph.shaders.size(); ++shader)
+        {
+            const PipelineShaderStage stage = graph.shaders[shader].stage;
+            if (stage == PipelineShaderStage::AnyHit || stage == PipelineShaderStage::Intersection)
+            {
+                continue;
+            }
+            for (uint32_t rayType = 0; rayType < rayTypeCount; ++rayType)
+            {
+                if (isFullyTracing || random() % 3 == 0)
+                {
+                    graph.AddTrace(shader, rayType);
+                }
+            }
+        }
+        return graph;
+    }
+
+    // Ray generation traces the radiance and the shadow ray, the hit and miss shaders do not trace, as in
+    // Raytracing::CreateRaytracingStateObject()
+    bool IsMegakernelStackSizeValid()
+    {
+        PipelineStackGraph graph;
+        const uint32_t rayGen = graph.AddShader(PipelineShaderStage::RayGen, 96);
+        graph.AddHitGroup(0, graph.AddShader(PipelineShaderStage::ClosestHit, 48), PipelineStackGraph::NO_SHADER, PipelineStackGraph::NO_SHADER);
+        graph.AddMiss(0, graph.AddShader(PipelineShaderStage::Miss, 16));
+        graph.AddMiss(1, graph.AddShader(PipelineShaderStage::Miss, 8));
+        graph.AddTrace(rayGen, 0);
+        graph.AddTrace(rayGen, 1);
+        bool isValid = Check(graph.ComputeStackSize(1) == 144, "Unexpected megakernel stack size", 0);
+        isValid = Check(graph.ComputeDefaultStackSize(1) == 144, "Unexpected megakernel default stack size", 0) && isValid;
+
+        // A deeper recursion limit adds nothing when only the ray generation shader traces
+        isValid = Check(graph.ComputeStackSize(8) == 144 && graph.ComputeDefaultStackSize(8) == 144 + 48 * 7,
+            "Unexpected megakernel stack size with a recursion limit of 8", 0) && isValid;
+        return isValid;
+    }
+
+    // Closest hit traces reflection and shadow rays, the miss shaders do not trace
+    bool IsReflectionStackSizeValid()
+    {
+        PipelineStackGraph graph;
+        const uint32_t rayGen = graph.AddShader(PipelineShaderStage::RayGen, 32);
+        const uint32_t closestHit = graph.AddShader(PipelineShaderStage::ClosestHit, 64);
+        graph.AddHitGroup(0, closestHit, PipelineStackGraph::NO_SHADER, PipelineStackGraph::NO_SHADER);
+        graph.AddHitGroup(1, PipelineStackGraph::NO_SHADER, graph.AddShader(PipelineShaderStage::AnyHit, 24), PipelineStackGraph::NO_SHADER);
+        graph.AddMiss(0, graph.AddShader(PipelineShaderStage::Miss, 128));
+        graph.AddMiss(1, graph.AddShader(PipelineShaderStage::Miss, 8));
+        graph.AddTrace(rayGen, 0);
+        graph.AddTrace(closestHit, 0);
+        graph.AddTrace(closestHit, 1);
+
+        // Depth 3: ray generation, two closest hits and the radiance miss, the default has three 128 byte misses
+        bool isValid = Check(graph.ComputeStackSize(3) == 32 + 64 + 64 + 128, "Unexpected reflection stack size", 0);
+        isValid = Check(graph.ComputeDefaultStackSize(3) == 32 + 128 * 3, "Unexpected reflection default stack size", 0) && isValid;
+        isValid = Check(graph.ComputeStackSize(0) == 32, "A recursion limit of 0 traces", 0) && isValid;
+        return isValid;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t numIterations = 10000;
+    uint32_t seed = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-iterations") == 0 && i + 1 < argc)
+        {
+            numIterations = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc)
+        {
+            seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    bool passed = IsMegakernelStackSizeValid();
+    passed = IsReflectionStackSizeValid() && passed;
+
+    // The enumeration is exponential in the depth, the deep limits are only checked against the default
+    std::mt19937 random(seed);
+    uint64_t savedBytes = 0;
+    uint64_t defaultBytes = 0;
+    for (uint32_t iteration = 0; iteration < numIterations && passed; ++iteration)
+    {
+        const bool isFullyTracing = iteration % 4 == 0;
+        const Graph graph = CreateRandomGraph(random, isFullyTracing);
+        uint64_t previousStackSize = 0;
+        for (uint32_t depth = 0; depth <= MAX_RECURSION_DEPTH && passed; ++depth)
+        {
+            const uint64_t stackSize = graph.stackGraph.ComputeStackSize(depth);
+            const uint64_t defaultStackSize = graph.stackGraph.ComputeDefaultStackSize(depth);
+            if (depth <= 4)
+            {
+                passed = Check(stackSize == EnumeratePaths(graph, depth), "The stack size is not the one of the deepest path", iteration) && passed;
+            }
+            passed = Check(stackSize <= defaultStackSize, "The stack size exceeds the default", iteration) && passed;
+            passed = Check(!isFullyTracing || stackSize == defaultStackSize, "The stack size of a fully tracing graph is not the default", iteration) && passed;
+            passed = Check(stackSize >= previousStackSize, "The stack size shrinks with a deeper recursion limit", iteration) && passed;
+            previousStackSize = stackSize;
+            if (depth == 2)
+            {
+                savedBytes += defaultStackSize - stackSize;
+                defaultBytes += defaultStackSize;
+            }
+        }
+    }
+
+    printf("%u graphs, %.1f%% of the default stack at recursion depth 2 saved\n", numIterations,
+        defaultBytes > 0 ? 100.0 * static_cast<double>(savedBytes) / static_cast<double>(defaultBytes) : 0.0);
+    printf("%s\n", passed ? "PASS" : "FAIL");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,342 @@
+// Checks the scheduling order produced by QueueSyncTracker on the CPU. Random submissions of several queues read and
+// write random resources with the waits given by the tracker, then the GPU is simulated: each queue executes its
+// submissions in order, a submission starts once its waits are signaled, and the runnable queue is chosen at random.
+// Every pair of conflicting accesses (at least one write) from different queues must execute in submission order.
+// The frame pattern of the Scene (AS builds on the compute queue into two alternating TLAS buffers, frames on the
+// direct queue reading the BLASes and one TLAS) is checked with the expected waits. Exits with 1 when a check fails.
+//
+// Build (Linux):
+//   g++ -std=c++20 -O2 -Isrc tools/QueueSyncTool.cpp src/QueueSyncTracker.cpp -o QueueSyncTool
+// Build (Windows, Developer Command Prompt):
+//   cl /std:c++20 /O2 /EHsc /Isrc tools\QueueSyncTool.cpp src\QueueSyncTracker.cpp /Fe:QueueSyncTool.exe
+//
+// Usage:
+//   QueueSyncTool [-queues <count>] [-resources <count>] [-submissions <count>] [-iterations <count>] [-seed <value>]
+
+#include "QueueSyncTracker.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+    struct Access
+    {
+        uint32_t resource;
+        bool isWrite;
+    };
+
+    struct Submission
+    {
+        uint32_t queue;
+        uint64_t fenceValue;
+        std::vector<QueueWait> waits;
+        std::vector<Access> accesses;
+    };
+
+    struct RandomRunResult
+    {
+        bool isOrdered;
+        uint32_t numWaits;
+        uint32_t numConflicts;      // cross-queue conflicting pairs, a wait per pair without elision
+    };
+
+    // Submit random accesses through the tracker, execute them in a random valid order and check the conflicts
+    RandomRunResult RunRandom(uint32_t numQueues, uint32_t numResources, uint32_t numSubmissions, std::mt19937& random)
+    {
+        QueueSyncTracker tracker(numQueues, numResources);
+        std::vector<Submission> submissions;
+        RandomRunResult result = { true, 0, 0 };
+
+        std::uniform_int_distribution<uint32_t> queueDistribution(0, numQueues - 1);
+        std::uniform_int_distribution<uint32_t> resourceDistribution(0, numResources - 1);
+        std::uniform_int_distribution<uint32_t> accessCountDistribution(1, 3);
+        std::bernoulli_distribution writeDistribution(0.4);
+        for (uint32_t i = 0; i < numSubmissions; ++i)
+        {
+            Submission submission = {};
+            submission.queue = queueDistribution(random);
+            const uint32_t numAccesses = accessCountDistribution(random);
+            for (uint32_t a = 0; a < numAccesses; ++a)
+            {
+                submission.accesses.push_back({ resourceDistribution(random), writeDistribution(random) });
+            }
+
+            for (const Access& access : submission.accesses)
+            {
+                if (access.isWrite)
+                {
+                    tracker.GetWaitsBeforeWrite(submission.queue, access.resource, submission.waits);
+                }
+                else
+                {
+                    tracker.GetWaitsBeforeRead(submission.queue, access.resource, submission.waits);
+                }
+            }
+            for (const QueueWait& wait : submission.waits)
+            {
+                tracker.RecordWait(submission.queue, wait);
+            }
+
+            submission.fenceValue = tracker.Submit(submission.queue);
+            for (const Access& access : submission.accesses)
+            {
+                if (access.isWrite)
+                {
+                    tracker.RecordWrite(submission.queue, access.resource, submission.fenceValue);
+                }
+                else
+                {
+                    tracker.RecordRead(submission.queue, access.resource, submission.fenceValue);
+                }
+            }
+            result.numWaits += static_cast<uint32_t>(submission.waits.size());
+            submissions.push_back(std::move(submission));
+        }
+
+        // Simulate the queues, the fences are the completed values
+        std::vector<std::vector<uint32_t>> queueSubmissions(numQueues);
+        for (uint32_t i = 0; i < submissions.size(); ++i)
+        {
+            queueSubmissions[submissions[i].queue].push_back(i);
+        }
+        std::vector<uint32_t> nextSubmission(numQueues, 0);
+        std::vector<uint64_t> fences(numQueues, 0);
+        std::vector<uint32_t> executionOrder(submissions.size(), 0);
+        for (uint32_t step = 0; step < submissions.size(); ++step)
+        {
+            std::vector<uint32_t> runnable;
+            for (uint32_t queue = 0; queue < numQueues; ++queue)
+            {
+                if (nextSubmission[queue] == queueSubmissions[queue].size())
+                {
+                    continue;
+                }
+                const Submission& submission = submissions[queueSubmissions[queue][nextSubmission[queue]]];
+                bool isReady = true;
+                for (const QueueWait& wait : submission.waits)
+                {
+                    isReady &= fences[wait.queue] >= wait.fenceValue;
+                }
+                if (isReady)
+                {
+                    runnable.push_back(queue);
+                }
+            }
+            if (runnable.empty())
+            {
+                printf("Deadlock after %u of %zu submissions\n", step, submissions.size());
+                result.isOrdered = false;
+                return result;
+            }
+
+            const uint32_t queue = runnable[std::uniform_int_distribution<size_t>(0, runnable.size() - 1)(random)];
+            const uint32_t index = queueSubmissions[queue][nextSubmission[queue]++];
+            executionOrder[index] = step;
+            fences[queue] = submissions[index].fenceValue;
+        }
+
+        // Conflicting accesses of different queues must execute in submission order
+        for (uint32_t i = 0; i < submissions.size(); ++i)
+        {
+            for (uint32_t j = i + 1; j < submissions.size(); ++j)
+            {
+                if (submissions[i].queue == submissions[j].queue)
+                {
+                    continue;
+                }
+
+                bool isConflict = false;
+                for (const Access& a : submissions[i].accesses)
+                {
+                    for (const Access& b : submissions[j].accesses)
+                    {
+                        isConflict |= a.resource == b.resource && (a.isWrite || b.isWrite);
+                    }
+                }
+                if (!isConflict)
+                {
+                    continue;
+                }
+
+                result.numConflicts++;
+                if (executionOrder[i] > executionOrder[j])
+                {
+                    if (result.isOrdered)
+                    {
+                        printf("Submission %u (queue %u) executed after the conflicting submission %u (queue %u)\n",
+                            i, submissions[i].queue, j, submissions[j].queue);
+                    }
+                    result.isOrdered = false;
+                }
+            }
+        }
+        return result;
+    }
+
+    bool Check(bool condition, const char* description)
+    {
+        printf("%-72s %s\n", description, condition ? "ok" : "FAILED");
+        return condition;
+    }
+
+    bool IsWait(const std::vector<QueueWait>& waits, uint32_t queue, uint64_t fenceValue)
+    {
+        return waits.size() == 1 && waits[0].queue == queue && waits[0].fenceValue == fenceValue;
+    }
+
+    // The frame pattern of the Scene: builds on the compute queue, frames on the direct queue
+    bool CheckScenePattern()
+    {
+        const uint32_t DIRECT = 0;
+        const uint32_t COMPUTE = 1;
+        const uint32_t BLAS = 0;
+        const uint32_t TLAS0 = 1;
+        const uint32_t TLAS1 = 2;
+        QueueSyncTracker tracker(2, 3);
+        std::vector<QueueWait> waits;
+        bool isPassed = true;
+
+        // Initial build of the BLASes and TLAS0
+        const uint64_t build = tracker.Submit(COMPUTE);
+        tracker.RecordWrite(COMPUTE, BLAS, build);
+        tracker.RecordWrite(COMPUTE, TLAS0, build);
+
+        // The first frame waits for the build, the next frames do not wait again
+        waits.clear();
+        tracker.GetWaitsBeforeRead(DIRECT, BLAS, waits);
+        tracker.GetWaitsBeforeRead(DIRECT, TLAS0, waits);
+        isPassed &= Check(IsWait(waits, COMPUTE, build), "first frame waits for the initial build");
+        tracker.RecordWait(DIRECT, waits[0]);
+        const uint64_t frame1 = tracker.Submit(DIRECT);
+        tracker.RecordRead(DIRECT, BLAS, frame1);
+        tracker.RecordRead(DIRECT, TLAS0, frame1);
+
+        waits.clear();
+        tracker.GetWaitsBeforeRead(DIRECT, BLAS, waits);
+        tracker.GetWaitsBeforeRead(DIRECT, TLAS0, waits);
+        isPassed &= Check(waits.empty(), "second frame does not wait");
+        const uint64_t frame2 = tracker.Submit(DIRECT);
+        tracker.RecordRead(DIRECT, BLAS, frame2);
+        tracker.RecordRead(DIRECT, TLAS0, frame2);
+
+        // A TLAS rebuild into the other buffer does not wait for the frames reading TLAS0
+        waits.clear();
+        tracker.GetWaitsBeforeRead(COMPUTE, BLAS, waits);
+        tracker.GetWaitsBeforeWrite(COMPUTE, TLAS1, waits);
+        isPassed &= Check(waits.empty(), "TLAS1 build does not wait for the frames");
+        const uint64_t rebuild = tracker.Submit(COMPUTE);
+        tracker.RecordWrite(COMPUTE, TLAS1, rebuild);
+
+        // Frames keep reading TLAS0 without waiting while TLAS1 builds
+        waits.clear();
+        tracker.GetWaitsBeforeRead(DIRECT, TLAS0, waits);
+        isPassed &= Check(waits.empty(), "frame during the TLAS1 build keeps TLAS0 without a wait");
+        const uint64_t frame3 = tracker.Submit(DIRECT);
+        tracker.RecordRead(DIRECT, BLAS, frame3);
+        tracker.RecordRead(DIRECT, TLAS0, frame3);
+
+        // Once the rebuild is seen completed, the switch to TLAS1 needs no GPU wait
+        tracker.SetCompletedValue(COMPUTE, rebuild);
+        waits.clear();
+        tracker.GetWaitsBeforeRead(DIRECT, TLAS1, waits);
+        isPassed &= Check(waits.empty(), "switch to the completed TLAS1 needs no wait");
+        const uint64_t frame4 = tracker.Submit(DIRECT);
+        tracker.RecordRead(DIRECT, BLAS, frame4);
+        tracker.RecordRead(DIRECT, TLAS1, frame4);
+
+        // The next build into TLAS0 waits for the last frame which read it, and a BLAS refit for the last frame
+        // which read the BLASes
+        waits.clear();
+        tracker.GetWaitsBeforeWrite(COMPUTE, TLAS0, waits);
+        isPassed &= Check(IsWait(waits, DIRECT, frame3), "TLAS0 rebuild waits for the last frame reading TLAS0");
+        waits.clear();
+        tracker.GetWaitsBeforeWrite(COMPUTE, BLAS, waits);
+        tracker.GetWaitsBeforeWrite(COMPUTE, TLAS0, waits);
+        isPassed &= Check(IsWait(waits, DIRECT, frame4), "BLAS refit waits for the last frame reading the BLASes");
+        tracker.RecordWait(COMPUTE, waits[0]);
+        const uint64_t refit = tracker.Submit(COMPUTE);
+        tracker.RecordWrite(COMPUTE, BLAS, refit);
+        tracker.RecordWrite(COMPUTE, TLAS0, refit);
+
+        // A frame after the refit must wait for it, the refitted BLASes are written in place
+        waits.clear();
+        tracker.GetWaitsBeforeRead(DIRECT, BLAS, waits);
+        tracker.GetWaitsBeforeRead(DIRECT, TLAS0, waits);
+        isPassed &= Check(IsWait(waits, COMPUTE, refit), "frame after the refit waits for it");
+
+        // Completed values elide waits
+        tracker.SetCompletedValue(COMPUTE, refit);
+        waits.clear();
+        tracker.GetWaitsBeforeRead(DIRECT, BLAS, waits);
+        isPassed &= Check(waits.empty(), "completed refit needs no wait");
+        return isPassed;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t numQueues = 3;
+    uint32_t numResources = 6;
+    uint32_t numSubmissions = 64;
+    uint32_t numIterations = 2000;
+    uint32_t seed = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-queues") == 0 && i + 1 < argc)
+        {
+            numQueues = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "-resources") == 0 && i + 1 < argc)
+        {
+            numResources = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "-submissions") == 0 && i + 1 < argc)
+        {
+            numSubmissions = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "-iterations") == 0 && i + 1 < argc)
+        {
+            numIterations = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc)
+        {
+            seed = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else
+        {
+            printf("Usage: QueueSyncTool [-queues <count>] [-resources <count>] [-submissions <count>] [-iterations <count>] [-seed <value>]\n");
+            return 1;
+        }
+    }
+    if (numQueues == 0 || numResources == 0)
+    {
+        printf("The queue and resource counts must not be 0\n");
+        return 1;
+    }
+
+    bool isPassed = CheckScenePattern();
+
+    std::mt19937 random(seed);
+    uint32_t numOrdered = 0;
+    uint64_t numWaits = 0;
+    uint64_t numConflicts = 0;
+    for (uint32_t iteration = 0; iteration < numIterations; ++iteration)
+    {
+        const RandomRunResult result = RunRandom(numQueues, numResources, numSubmissions, random);
+        numOrdered += result.isOrdered;
+        numWaits += result.numWaits;
+        numConflicts += result.numConflicts;
+    }
+
+    printf("\n%u queues, %u resources, %u submissions x %u iterations\n", numQueues, numResources, numSubmissions, numIterations);
+    printf("Ordered runs: %u / %u\n", numOrdered, numIterations);
+    printf("Waits: %.2f per submission, %llu for %llu cross-queue conflicts\n",
+        static_cast<double>(numWaits) / (static_cast<double>(numSubmissions) * numIterations),
+        static_cast<unsigned long long>(numWaits), static_cast<unsigned long long>(numConflicts));
+    isPassed &= Check(numOrdered == numIterations, "every conflict executed in submission order");
+
+    return isPassed ? 0 : 1;
+}
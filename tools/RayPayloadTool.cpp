@@ -0,0 +1,177 @@
+// Checks the packing of the ray payloads (shaders/RayPayloads.hlsli, src/RayPayloads.cpp) on random values: an RGB9E5
+// channel is within half a mantissa step of the clamped input and a packed color packs to the same bits again, an
+// octahedral normal is unit length and within OCTAHEDRAL_MAX_ANGLE of the input, and GetRayPayloadSize() is the size of
+// the payload struct of every PayloadPrecision. Fixed values check the bit layouts against DXGI_FORMAT_R9G9B9E5_SHAREDEXP
+// and the folding of the lower hemisphere. Exits with 1 when a check fails.
+//
+// Build (Linux):
+//   g++ -std=c++20 -O2 -Isrc tools/RayPayloadTool.cpp src/RayPayloads.cpp src/ShaderPermutation.cpp -o RayPayloadTool
+// Build (Windows, Developer Command Prompt):
+//   cl /std:c++20 /O2 /EHsc /Isrc tools\RayPayloadTool.cpp src\RayPayloads.cpp src\ShaderPermutation.cpp /Fe:RayPayloadTool.exe
+//
+// Usage:
+//   RayPayloadTool [-iterations <count>] [-seed <value>]
+
+#include "RayPayloads.h"
+#include "ShaderPermutation.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+using namespace ShaderLayout;
+
+namespace
+{
+    // Worst case of 16 bit octahedral components, with margin for float
+    const double OCTAHEDRAL_MAX_ANGLE = 1.0e-4;
+
+    void PrintUsage()
+    {
+        printf("Usage: RayPayloadTool [-iterations <count>] [-seed <value>]\n");
+    }
+
+    bool Check(bool condition, const char* message, uint32_t iteration)
+    {
+        if (!condition)
+        {
+            printf("Iteration %u: %s\n", iteration, message);
+        }
+        return condition;
+    }
+
+    // Angle between two directions, from the cross product so that small angles are exact
+    double GetAngle(const float a[3], const float b[3])
+    {
+        const double cross[3] = {
+            static_cast<double>(a[1]) * b[2] - static_cast<double>(a[2]) * b[1],
+            static_cast<double>(a[2]) * b[0] - static_cast<double>(a[0]) * b[2],
+            static_cast<double>(a[0]) * b[1] - static_cast<double>(a[1]) * b[0]
+        };
+        const double dot = static_cast<double>(a[0]) * b[0] + static_cast<double>(a[1]) * b[1] + static_cast<double>(a[2]) * b[2];
+        return std::atan2(std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]), dot);
+    }
+
+    bool IsRgb9e5Valid(const float value[3], uint32_t iteration)
+    {
+        const uint32_t packed = PackRgb9e5(value);
+        float unpacked[3];
+        UnpackRgb9e5(packed, unpacked);
+
+        // Half a mantissa step of the shared exponent, the mantissa of the largest channel uses the top bit unless the
+        // exponent is the smallest one
+        const int exponent = static_cast<int>(packed >> (RGB9E5_MANTISSA_BITS * 3));
+        const double step = std::ldexp(1.0, exponent - static_cast<int>(RGB9E5_EXPONENT_BIAS + RGB9E5_MANTISSA_BITS));
+        uint32_t maxMantissa = 0;
+        bool isValid = true;
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            const double clamped = std::clamp(static_cast<double>(value[i]), 0.0, static_cast<double>(RGB9E5_MAX_VALUE));
+            maxMantissa = std::max(maxMantissa, (packed >> (RGB9E5_MANTISSA_BITS * i)) & ((1u << RGB9E5_MANTISSA_BITS) - 1));
+            isValid = Check(std::abs(unpacked[i] - clamped) <= step * 0.5 * (1.0 + 1.0e-6), "An RGB9E5 channel is off by more than half a step", iteration) && isValid;
+        }
+        isValid = Check(exponent == 0 || maxMantissa >= 1u << (RGB9E5_MANTISSA_BITS - 1), "The RGB9E5 exponent is larger than needed", iteration) && isValid;
+        isValid = Check(PackRgb9e5(unpacked) == packed, "An unpacked RGB9E5 color packs to other bits", iteration) && isValid;
+        return isValid;
+    }
+
+    bool IsOctahedralNormalValid(const float normal[3], uint32_t iteration, double& maxAngle)
+    {
+        float unpacked[3];
+        UnpackOctahedralNormal(PackOctahedralNormal(normal), unpacked);
+        const double length = std::sqrt(static_cast<double>(unpacked[0]) * unpacked[0] + static_cast<double>(unpacked[1]) * unpacked[1] + static_cast<double>(unpacked[2]) * unpacked[2]);
+        const double angle = GetAngle(normal, unpacked);
+        maxAngle = std::max(maxAngle, angle);
+        bool isValid = Check(std::abs(length - 1.0) < 1.0e-6, "An unpacked normal is not unit length", iteration);
+        return Check(angle <= OCTAHEDRAL_MAX_ANGLE, "An unpacked normal is too far from the packed one", iteration) && isValid;
+    }
+
+    bool IsFixedPackingValid()
+    {
+        const float one[3] = { 1.0f, 1.0f, 1.0f };
+        const float black[3] = { 0.0f, 0.0f, 0.0f };
+        const float negative[3] = { -1.0f, -0.5f, -0.0f };
+        const float overflow[3] = { 1.0e6f, 1.0e6f, 1.0e6f };
+        bool isValid = Check(PackRgb9e5(one) == 0x84020100u, "Unexpected RGB9E5 bits of white", 0);
+        isValid = Check(PackRgb9e5(black) == 0 && PackRgb9e5(negative) == 0, "Unexpected RGB9E5 bits of black", 0) && isValid;
+        isValid = Check(PackRgb9e5(overflow) == 0xffffffffu, "Unexpected RGB9E5 bits of the clamped maximum", 0) && isValid;
+
+        // The axes, the upper hemisphere at the center and the lower one at the corners
+        double maxAngle = 0.0;
+        const float axes[6][3] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+        for (const float* axis : axes)
+        {
+            isValid = IsOctahedralNormalValid(axis, 0, maxAngle) && isValid;
+        }
+        isValid = Check(PackOctahedralNormal(axes[4]) == 0x80008000u, "Unexpected octahedral bits of +z", 0) && isValid;
+        isValid = Check((PackOctahedralNormal(axes[5]) & 0x7fff7fffu) == 0x7fff7fffu, "Unexpected octahedral bits of -z", 0) && isValid;
+        return isValid;
+    }
+
+    bool IsPayloadSizeValid()
+    {
+        ShaderPermutationKey key;
+        key.Set(ShaderPermutationAxis::PayloadPrecision, static_cast<uint32_t>(PayloadPrecision::Full));
+        bool isValid = Check(GetRayPayloadSize(key) == sizeof(RayPayloadFull), "Unexpected size of the full payload", 0);
+        key.Set(ShaderPermutationAxis::PayloadPrecision, static_cast<uint32_t>(PayloadPrecision::Packed));
+        isValid = Check(GetRayPayloadSize(key) == sizeof(RayPayloadPacked), "Unexpected size of the packed payload", 0) && isValid;
+        return isValid;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t numIterations = 1000000;
+    uint32_t seed = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-iterations") == 0 && i + 1 < argc)
+        {
+            numIterations = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc)
+        {
+            seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    bool passed = IsFixedPackingValid();
+    passed = IsPayloadSizeValid() && passed;
+
+    // Colors over the whole exponent range and beyond, with channels of very different magnitude; directions uniform on
+    // the sphere
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> exponentDistribution(-28.0f, 18.0f);
+    std::normal_distribution<float> normalDistribution;
+    double maxAngle = 0.0;
+    for (uint32_t iteration = 0; iteration < numIterations && passed; ++iteration)
+    {
+        float color[3];
+        for (float& channel : color)
+        {
+            channel = random() % 16 == 0 ? 0.0f : std::exp2(exponentDistribution(random));
+        }
+        passed = IsRgb9e5Valid(color, iteration) && passed;
+
+        float direction[3];
+        do
+        {
+            for (float& component : direction)
+            {
+                component = normalDistribution(random);
+            }
+        } while (std::abs(direction[0]) + std::abs(direction[1]) + std::abs(direction[2]) < 1.0e-3f);
+        passed = IsOctahedralNormalValid(direction, iteration, maxAngle) && passed;
+    }
+
+    printf("%u colors and normals, octahedral normal error up to %.2e radians\n", numIterations, maxAngle);
+    printf("%s\n", passed ? "PASS" : "FAIL");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,557 @@
+// Ray tracing throughput benchmark on the CPU backend (CpuRaytracer) over a procedural stress scene
+// (ProceduralScene). The acceleration structures are built, then every fixed camera path is rendered for a number of
+// frames. The report is JSON: scene settings, BLAS and TLAS build ms, AS memory, and per path the MRays/s and the
+// frame time percentiles, so that the numbers can be compared between commits. Every path is rendered a second time
+// as path traced samples in the stages of the wavefront mode (CpuRaytracer::RenderWavefront()) with the stage times
+// and queue sizes.
+//
+// The run also checks that the scene is deterministic: a second generation from the same settings must produce the
+// same geometry and the same first frame, and every path must hit some geometry. The first wavefront frame must be the
+// sample of CpuRaytracer::RenderPathTraced() with the same rays, and the wavefront frames must sort their hits by
+// material bin.
+//
+// The path tracing estimator (CpuRaytracer::RenderPathTraced()) is checked at 1/8 of the resolution from the middle of
+// the flythrough, inside the layers, with every sampler of Sampler.h: the RMSE of the Random sampler against a reference
+// of 4 x pathSamples independent samples must drop by at least a quarter every time the samples are quadrupled (a half
+// is expected), the RMSE of Sobol and Lattice must not exceed it at pathSamples, and a furnace (white albedo, the sky
+// alone, seen from the overview) must render the sky radiance within 4 standard errors with every sampler. At one and
+// two bounces the images with and without light samples must match within 4 standard errors. Exits with 1 when a check
+// fails.
+//
+// Build (Linux):
+//   g++ -std=c++20 -O2 -pthread -Isrc tools/RaytracingBenchmark.cpp src/ProceduralScene.cpp src/CpuBvh.cpp src/CpuRaytracer.cpp src/WavefrontQueues.cpp src/PathTracing.cpp src/Sampler.cpp src/Camera.cpp src/Hash.cpp src/ThreadPool.cpp -o RaytracingBenchmark
+// Build (Windows, Developer Command Prompt):
+//   cl /std:c++20 /O2 /EHsc /Isrc tools\RaytracingBenchmark.cpp src\ProceduralScene.cpp src\CpuBvh.cpp src\CpuRaytracer.cpp src\WavefrontQueues.cpp src\PathTracing.cpp src\Sampler.cpp src\Camera.cpp src\Hash.cpp src\ThreadPool.cpp /Fe:RaytracingBenchmark.exe
+//
+// Usage:
+//   RaytracingBenchmark [-scene <settings>] [-width <pixels>] [-height <pixels>] [-frames <count per path>] [-threads <count>] [-pathSamples <count>] [-output <file.json>]
+//   <settings> as in ProceduralScene.h, e.g. "instances=10000;triangles=2000;overlap=1;depth=8"
+
+#include "Camera.h"
+#include "CpuRaytracer.h"
+#include "Hash.h"
+#include "PlatformHelpers.h"
+#include "ProceduralScene.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // Fraction of the sky radiance the furnace may lose to the interpolated shading normals, which reflect some
+    // directions below the geometric surface and end those paths
+    const double FURNACE_SHADING_NORMAL_LOSS = 0.005;
+
+    struct PathResult
+    {
+        CameraPath path;
+        std::vector<double> frameMilliseconds;
+        uint64_t rayCount;
+        uint64_t hitCount;
+        uint64_t imageHash;     // of the first frame
+
+        std::vector<double> wavefrontFrameMilliseconds;
+        CpuRaytracerWavefrontStats wavefrontStats;      // summed over the frames
+        bool isWavefrontValid;
+    };
+
+    void PrintUsage()
+    {
+        printf("Usage: RaytracingBenchmark [-scene <settings>] [-width <pixels>] [-height <pixels>] [-frames <count per path>] [-threads <count>] [-pathSamples <count>] [-output <file.json>]\n");
+    }
+
+    // Root mean square error of the accumulations divided by their sample counts
+    double GetRootMeanSquareError(const std::vector<float>& accumulation, uint32_t sampleCount, const std::vector<float>& reference, uint32_t referenceSampleCount)
+    {
+        double sum = 0.0;
+        for (size_t i = 0; i < accumulation.size(); ++i)
+        {
+            const double error = static_cast<double>(accumulation[i]) / sampleCount - static_cast<double>(reference[i]) / referenceSampleCount;
+            sum += error * error;
+        }
+        return accumulation.empty() ? 0.0 : std::sqrt(sum / static_cast<double>(accumulation.size()));
+    }
+
+    // Mean radiance of the pixels of an accumulation and its standard error, from the spread of the pixel means
+    struct ImageMean
+    {
+        double mean[3];
+        double standardError[3];
+    };
+
+    ImageMean GetImageMean(const std::vector<float>& accumulation, uint32_t sampleCount)
+    {
+        ImageMean result = {};
+        double sumSquares[3] = {};
+        for (size_t i = 0; i < accumulation.size(); ++i)
+        {
+            const double pixelMean = static_cast<double>(accumulation[i]) / sampleCount;
+            result.mean[i % 3] += pixelMean;
+            sumSquares[i % 3] += pixelMean * pixelMean;
+        }
+        const double numPixels = static_cast<double>(accumulation.size() / 3);
+        for (uint32_t j = 0; j < 3 && numPixels > 1.0; ++j)
+        {
+            result.mean[j] /= numPixels;
+            const double variance = std::max(sumSquares[j] / numPixels - result.mean[j] * result.mean[j], 0.0) * numPixels / (numPixels - 1.0);
+            result.standardError[j] = std::sqrt(variance / numPixels);
+        }
+        return result;
+    }
+
+    double MillisecondsSince(std::chrono::steady_clock::time_point startTime)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    }
+
+    // Nearest rank percentile of sorted values
+    double GetPercentile(const std::vector<double>& sortedValues, double percentile)
+    {
+        const size_t rank = static_cast<size_t>(percentile / 100.0 * static_cast<double>(sortedValues.size()) + 0.5);
+        return sortedValues[std::min(std::max<size_t>(rank, 1), sortedValues.size()) - 1];
+    }
+
+    uint64_t HashScene(const ProceduralScene& scene)
+    {
+        uint64_t hash = 0;
+        for (const ProceduralMesh& mesh : scene.meshes)
+        {
+            hash = Hash64(mesh.vertices.data(), mesh.vertices.size() * sizeof(GeometrySourceVertex), hash);
+            hash = Hash64(mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t), hash);
+        }
+        return Hash64(scene.instances.data(), scene.instances.size() * sizeof(ProceduralInstance), hash);
+    }
+
+    void GetRaytracerInputs(const ProceduralScene& scene, std::vector<CpuRaytracerMesh>& meshes, std::vector<CpuRaytracerInstance>& instances)
+    {
+        meshes.clear();
+        for (const ProceduralMesh& mesh : scene.meshes)
+        {
+            meshes.push_back({ mesh.vertices.data(), static_cast<uint32_t>(mesh.vertices.size()), mesh.indices.data(), static_cast<uint32_t>(mesh.indices.size()) });
+        }
+        instances.resize(scene.instances.size());
+        for (size_t i = 0; i < scene.instances.size(); ++i)
+        {
+            instances[i].meshIndex = scene.instances[i].meshIndex;
+            memcpy(instances[i].transform, scene.instances[i].transform, sizeof(instances[i].transform));
+        }
+    }
+
+    std::string FormatNumber(double value)
+    {
+        char text[64];
+        snprintf(text, sizeof(text), "%.3f", value);
+        return text;
+    }
+
+    // [x, y, z] with 4 significant digits, for the small standard errors
+    std::string FormatTriple(const double values[3])
+    {
+        char text[128];
+        snprintf(text, sizeof(text), "[%.4g, %.4g, %.4g]", values[0], values[1], values[2]);
+        return text;
+    }
+
+    std::string FormatHash(uint64_t hash)
+    {
+        char text[32];
+        snprintf(text, sizeof(text), "\"%016llx\"", static_cast<unsigned long long>(hash));
+        return text;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    ProceduralSceneSettings settings;
+    uint32_t width = 640;
+    uint32_t height = 360;
+    uint32_t numFrames = 16;
+    uint32_t numThreads = 0;
+    uint32_t numPathSamples = 64;
+    std::string outputPath;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-scene") == 0 && i + 1 < argc)
+        {
+            std::string error;
+            if (!ParseProceduralSceneSettings(argv[++i], settings, &error))
+            {
+                printf("Invalid scene settings: %s\n", error.c_str());
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "-width") == 0 && i + 1 < argc)
+        {
+            width = std::max(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 1u);
+        }
+        else if (strcmp(argv[i], "-height") == 0 && i + 1 < argc)
+        {
+            height = std::max(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 1u);
+        }
+        else if (strcmp(argv[i], "-frames") == 0 && i + 1 < argc)
+        {
+            numFrames = std::max(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 1u);
+        }
+        else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+        {
+            numThreads = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "-pathSamples") == 0 && i + 1 < argc)
+        {
+            numPathSamples = std::max(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 1u);
+        }
+        else if (strcmp(argv[i], "-output") == 0 && i + 1 < argc)
+        {
+            outputPath = argv[++i];
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    ThreadPool threadPool(numThreads);
+    bool passed = true;
+
+    // Scene generation, and a second generation for the determinism check
+    const auto generateStartTime = std::chrono::steady_clock::now();
+    ProceduralScene scene;
+    GenerateProceduralScene(settings, scene, &threadPool);
+    const double generateMilliseconds = MillisecondsSince(generateStartTime);
+
+    ProceduralScene secondScene;
+    GenerateProceduralScene(settings, secondScene, &threadPool);
+    const uint64_t sceneHash = HashScene(scene);
+    const bool isSceneDeterministic = sceneHash == HashScene(secondScene);
+    secondScene = {};
+
+    uint64_t numTriangles = 0;
+    uint64_t numInstancedTriangles = 0;
+    for (const ProceduralMesh& mesh : scene.meshes)
+    {
+        numTriangles += mesh.indices.size() / 3;
+    }
+    for (const ProceduralInstance& instance : scene.instances)
+    {
+        numInstancedTriangles += scene.meshes[instance.meshIndex].indices.size() / 3;
+    }
+
+    std::vector<CpuRaytracerMesh> meshes;
+    std::vector<CpuRaytracerInstance> instances;
+    GetRaytracerInputs(scene, meshes, instances);
+    CpuRaytracer raytracer;
+    CpuRaytracerBuildStats buildStats = {};
+    raytracer.Build(meshes, instances, threadPool, &buildStats);
+
+    // The paths, a warm-up frame first
+    std::vector<PathResult> results;
+    std::vector<uint32_t> pixels;
+    std::vector<float> wavefrontAccumulation;
+    std::vector<float> pathTracedAccumulation;
+    const PathTracingSettings wavefrontSettings;
+    const float aspectRatio = static_cast<float>(width) / static_cast<float>(height);
+    for (uint32_t path = 0; path < static_cast<uint32_t>(CameraPath::Count); ++path)
+    {
+        PathResult result = {};
+        result.path = static_cast<CameraPath>(path);
+        raytracer.Render(GetCameraConstants(GetCameraPathCamera(result.path, 0.0f, scene.boundsMin, scene.boundsMax), aspectRatio), width, height, threadPool, pixels);
+        result.imageHash = Hash64(pixels.data(), pixels.size() * sizeof(uint32_t));
+
+        for (uint32_t frame = 0; frame < numFrames; ++frame)
+        {
+            const float t = numFrames > 1 ? static_cast<float>(frame) / static_cast<float>(numFrames - 1) : 0.0f;
+            const CameraConstants camera = GetCameraConstants(GetCameraPathCamera(result.path, t, scene.boundsMin, scene.boundsMax), aspectRatio);
+            CpuRaytracerRenderStats renderStats = {};
+            const auto frameStartTime = std::chrono::steady_clock::now();
+            raytracer.Render(camera, width, height, threadPool, pixels, &renderStats);
+            result.frameMilliseconds.push_back(MillisecondsSince(frameStartTime));
+            result.rayCount += renderStats.rayCount;
+            result.hitCount += renderStats.hitCount;
+        }
+
+        // The same frames as path traced samples in the wavefront stages, the first one must be the sample of the
+        // megakernel estimator with the same rays
+        const CameraConstants firstCamera = GetCameraConstants(GetCameraPathCamera(result.path, 0.0f, scene.boundsMin, scene.boundsMax), aspectRatio);
+        CpuRaytracerRenderStats pathTracedStats = {};
+        CpuRaytracerWavefrontStats firstWavefrontStats = {};
+        raytracer.RenderPathTraced(firstCamera, width, height, 0, wavefrontSettings, threadPool, pathTracedAccumulation, &pathTracedStats);
+        raytracer.RenderWavefront(firstCamera, width, height, 0, wavefrontSettings, threadPool, wavefrontAccumulation, &firstWavefrontStats);
+        result.isWavefrontValid = wavefrontAccumulation == pathTracedAccumulation &&
+            firstWavefrontStats.rayCount + firstWavefrontStats.shadowRayCount == pathTracedStats.rayCount;
+        for (uint32_t frame = 0; frame < numFrames; ++frame)
+        {
+            const float t = numFrames > 1 ? static_cast<float>(frame) / static_cast<float>(numFrames - 1) : 0.0f;
+            const CameraConstants camera = GetCameraConstants(GetCameraPathCamera(result.path, t, scene.boundsMin, scene.boundsMax), aspectRatio);
+            CpuRaytracerWavefrontStats wavefrontStats = {};
+            const auto frameStartTime = std::chrono::steady_clock::now();
+            raytracer.RenderWavefront(camera, width, height, frame, wavefrontSettings, threadPool, wavefrontAccumulation, &wavefrontStats);
+            result.wavefrontFrameMilliseconds.push_back(MillisecondsSince(frameStartTime));
+            result.isWavefrontValid = result.isWavefrontValid && wavefrontStats.isHitOrderValid;
+
+            CpuRaytracerWavefrontStats& sum = result.wavefrontStats;
+            sum.rayCount += wavefrontStats.rayCount;
+            sum.hitCount += wavefrontStats.hitCount;
+            sum.shadowRayCount += wavefrontStats.shadowRayCount;
+            sum.visibleShadowRayCount += wavefrontStats.visibleShadowRayCount;
+            sum.bounceCount += wavefrontStats.bounceCount;
+            sum.generateMilliseconds += wavefrontStats.generateMilliseconds;
+            sum.extendMilliseconds += wavefrontStats.extendMilliseconds;
+            sum.sortMilliseconds += wavefrontStats.sortMilliseconds;
+            sum.shadeMilliseconds += wavefrontStats.shadeMilliseconds;
+            sum.connectMilliseconds += wavefrontStats.connectMilliseconds;
+        }
+        results.push_back(std::move(result));
+    }
+
+    // The first frame of the rebuilt scene must be identical
+    bool isImageDeterministic = false;
+    {
+        CpuRaytracer secondRaytracer;
+        secondRaytracer.Build(meshes, instances, threadPool);
+        secondRaytracer.Render(GetCameraConstants(GetCameraPathCamera(CameraPath::Overview, 0.0f, scene.boundsMin, scene.boundsMax), aspectRatio), width, height, threadPool, pixels);
+        isImageDeterministic = Hash64(pixels.data(), pixels.size() * sizeof(uint32_t)) == results[0].imageHash;
+    }
+
+    // Path tracing convergence of every sampler: the images at 1, 4, 16... samples against a reference of the Random
+    // sampler with other sample indices
+    const uint32_t pathWidth = std::max(width / 8, 1u);
+    const uint32_t pathHeight = std::max(height / 8, 1u);
+    const CameraConstants pathCamera = GetCameraConstants(GetCameraPathCamera(CameraPath::Flythrough, 0.5f, scene.boundsMin, scene.boundsMax), aspectRatio);
+    const CameraConstants furnaceCamera = GetCameraConstants(GetCameraPathCamera(CameraPath::Overview, 0.0f, scene.boundsMin, scene.boundsMax), aspectRatio);
+    SamplerTables samplerTables;
+    GenerateSamplerTables(threadPool, samplerTables);
+    PathTracingSettings pathSettings;
+    pathSettings.samplerTables = &samplerTables;
+    std::vector<float> reference(pathWidth * pathHeight * 3, 0.0f);
+    const uint32_t numReferenceSamples = numPathSamples * 4;
+    for (uint32_t sample = 0; sample < numReferenceSamples; ++sample)
+    {
+        raytracer.RenderPathTraced(pathCamera, pathWidth, pathHeight, numPathSamples + sample, pathSettings, threadPool, reference);
+    }
+
+    struct SamplerResult
+    {
+        std::vector<double> errors;
+        std::vector<uint32_t> errorSamples;
+        uint64_t rayCount;
+        double milliseconds;
+        ImageMean furnaceMean;
+        bool isFurnaceValid;
+    };
+    const uint32_t numSamplerTypes = static_cast<uint32_t>(SamplerType::Count);
+    SamplerResult samplerResults[numSamplerTypes] = {};
+    std::vector<float> accumulation;
+    for (uint32_t type = 0; type < numSamplerTypes; ++type)
+    {
+        SamplerResult& samplerResult = samplerResults[type];
+        pathSettings.samplerType = static_cast<SamplerType>(type);
+        const auto pathStartTime = std::chrono::steady_clock::now();
+        for (uint32_t sample = 0; sample < numPathSamples; ++sample)
+        {
+            CpuRaytracerRenderStats renderStats = {};
+            raytracer.RenderPathTraced(pathCamera, pathWidth, pathHeight, sample, pathSettings, threadPool, accumulation, &renderStats);
+            samplerResult.rayCount += renderStats.rayCount;
+            if (((sample + 1) & sample) == 0 && ((sample + 1) & 0x55555555u) != 0)
+            {
+                // A power of 4
+                samplerResult.errors.push_back(GetRootMeanSquareError(accumulation, sample + 1, reference, numReferenceSamples));
+                samplerResult.errorSamples.push_back(sample + 1);
+            }
+        }
+        samplerResult.milliseconds = MillisecondsSince(pathStartTime);
+
+        // Furnace: every path ends in the sky and nothing is absorbed, so every pixel converges to the sky radiance.
+        // It is rendered from outside the bounds, as from inside the layers some pixels see surfaces enclosed by
+        // overlapping instances, whose paths never reach the sky. The mean must be within 4 standard errors of the
+        // pixel means, plus FURNACE_SHADING_NORMAL_LOSS for the energy lost by the interpolated normals. The bounce
+        // limit is high enough that the energy of the cut paths is far below that.
+        PathTracingSettings furnaceSettings = pathSettings;
+        furnaceSettings.maxBounces = 256;
+        furnaceSettings.isSunEnabled = false;
+        furnaceSettings.albedoOverride = 1.0f;
+        for (uint32_t sample = 0; sample < numPathSamples; ++sample)
+        {
+            raytracer.RenderPathTraced(furnaceCamera, pathWidth, pathHeight, sample, furnaceSettings, threadPool, accumulation);
+        }
+        samplerResult.furnaceMean = GetImageMean(accumulation, numPathSamples);
+        samplerResult.isFurnaceValid = true;
+        for (uint32_t j = 0; j < 3; ++j)
+        {
+            samplerResult.isFurnaceValid = samplerResult.isFurnaceValid &&
+                std::abs(samplerResult.furnaceMean.mean[j] - SKY_RADIANCE[j]) <=
+                4.0 * samplerResult.furnaceMean.standardError[j] + SKY_RADIANCE[j] * FURNACE_SHADING_NORMAL_LOSS;
+        }
+        passed = passed && samplerResult.isFurnaceValid;
+    }
+
+    // The light samples only change the noise. At a low bounce limit, where the light samples of the last hit would
+    // matter most, the mean difference of the pixels with and without them must be within 4 standard errors. The
+    // albedo is white and the sky alone is the light, as in the furnace, so that the light reaching the last hit is
+    // large and the noise of the sun seen without light samples does not hide it.
+    struct NeeResult
+    {
+        uint32_t maxBounces;
+        ImageMean difference;
+        bool isValid;
+    };
+    NeeResult neeResults[] = { { 1, {}, false }, { 2, {}, false } };
+    for (NeeResult& neeResult : neeResults)
+    {
+        PathTracingSettings neeSettings = pathSettings;
+        neeSettings.samplerType = SamplerType::Random;
+        neeSettings.maxBounces = neeResult.maxBounces;
+        neeSettings.isSunEnabled = false;
+        neeSettings.albedoOverride = 1.0f;
+        std::vector<float> withoutNee;
+        for (uint32_t sample = 0; sample < numPathSamples; ++sample)
+        {
+            neeSettings.isNeeEnabled = true;
+            raytracer.RenderPathTraced(pathCamera, pathWidth, pathHeight, sample, neeSettings, threadPool, accumulation);
+            neeSettings.isNeeEnabled = false;
+            raytracer.RenderPathTraced(pathCamera, pathWidth, pathHeight, numPathSamples + sample, neeSettings, threadPool, withoutNee);
+        }
+        for (size_t i = 0; i < accumulation.size(); ++i)
+        {
+            accumulation[i] -= withoutNee[i];
+        }
+        neeResult.difference = GetImageMean(accumulation, numPathSamples);
+        neeResult.isValid = true;
+        for (uint32_t j = 0; j < 3; ++j)
+        {
+            neeResult.isValid = neeResult.isValid && std::abs(neeResult.difference.mean[j]) <= 4.0 * neeResult.difference.standardError[j];
+        }
+        passed = passed && neeResult.isValid;
+    }
+
+    // The Random sampler converges at the Monte Carlo rate, the error of the others is at most the Random one with
+    // the most samples. The reference noise is half of that error, so a quarter less is all that can be measured.
+    const SamplerResult& randomResult = samplerResults[static_cast<uint32_t>(SamplerType::Random)];
+    bool isPathTracingConverging = true;
+    for (size_t i = 1; i < randomResult.errors.size(); ++i)
+    {
+        isPathTracingConverging = isPathTracingConverging && randomResult.errors[i] < randomResult.errors[i - 1] * 0.75;
+    }
+    for (const SamplerResult& samplerResult : samplerResults)
+    {
+        isPathTracingConverging = isPathTracingConverging && samplerResult.errors.back() <= randomResult.errors.back();
+    }
+    passed = passed && isPathTracingConverging;
+
+    // Report
+    std::string json = "{\n";
+    json += "  \"scene\": { \"settings\": \"" + GetProceduralSceneSettingsText(settings) + "\", \"meshes\": " + std::to_string(scene.meshes.size()) +
+        ", \"instances\": " + std::to_string(scene.instances.size()) + ", \"triangles\": " + std::to_string(numTriangles) +
+        ", \"instancedTriangles\": " + std::to_string(numInstancedTriangles) + ", \"hash\": " + FormatHash(sceneHash) +
+        ", \"generateMilliseconds\": " + FormatNumber(generateMilliseconds) + " },\n";
+    json += "  \"build\": { \"blasMilliseconds\": " + FormatNumber(buildStats.blasMilliseconds) + ", \"tlasMilliseconds\": " + FormatNumber(buildStats.tlasMilliseconds) +
+        ", \"totalMilliseconds\": " + FormatNumber(buildStats.blasMilliseconds + buildStats.tlasMilliseconds) +
+        ", \"blasMemoryBytes\": " + std::to_string(buildStats.blasMemorySize) + ", \"tlasMemoryBytes\": " + std::to_string(buildStats.tlasMemorySize) +
+        ", \"maxBlasDepth\": " + std::to_string(buildStats.maxBLASDepth) + ", \"tlasDepth\": " + std::to_string(buildStats.tlasDepth) + " },\n";
+    json += "  \"render\": { \"width\": " + std::to_string(width) + ", \"height\": " + std::to_string(height) + ", \"frames\": " + std::to_string(numFrames) +
+        ", \"threads\": " + std::to_string(threadPool.GetNumThreads()) + " },\n";
+    json += "  \"paths\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const PathResult& result = results[i];
+        std::vector<double> sorted = result.frameMilliseconds;
+        std::sort(sorted.begin(), sorted.end());
+        double totalMilliseconds = 0.0;
+        for (double milliseconds : sorted)
+        {
+            totalMilliseconds += milliseconds;
+        }
+        const double megaRaysPerSecond = static_cast<double>(result.rayCount) / (totalMilliseconds * 1000.0);
+        const bool hasHits = result.hitCount > 0;
+        passed = passed && hasHits && result.isWavefrontValid;
+
+        // Path and shadow rays per second of the wavefront frames, stage times and bounces per frame
+        const CpuRaytracerWavefrontStats& wavefront = result.wavefrontStats;
+        std::vector<double> wavefrontSorted = result.wavefrontFrameMilliseconds;
+        std::sort(wavefrontSorted.begin(), wavefrontSorted.end());
+        double wavefrontTotalMilliseconds = 0.0;
+        for (double milliseconds : wavefrontSorted)
+        {
+            wavefrontTotalMilliseconds += milliseconds;
+        }
+        const double wavefrontMegaRaysPerSecond = static_cast<double>(wavefront.rayCount + wavefront.shadowRayCount) / (wavefrontTotalMilliseconds * 1000.0);
+        const double frameCount = static_cast<double>(numFrames);
+
+        json += "    { \"name\": \"" + std::string(GetCameraPathName(result.path)) + "\", \"mraysPerSecond\": " + FormatNumber(megaRaysPerSecond) +
+            ", \"hitRatio\": " + FormatNumber(static_cast<double>(result.hitCount) / static_cast<double>(result.rayCount)) +
+            ", \"frameMilliseconds\": { \"min\": " + FormatNumber(sorted.front()) + ", \"p50\": " + FormatNumber(GetPercentile(sorted, 50.0)) +
+            ", \"p90\": " + FormatNumber(GetPercentile(sorted, 90.0)) + ", \"p99\": " + FormatNumber(GetPercentile(sorted, 99.0)) +
+            ", \"max\": " + FormatNumber(sorted.back()) + " }, \"imageHash\": " + FormatHash(result.imageHash) +
+            ",\n      \"wavefront\": { \"mraysPerSecond\": " + FormatNumber(wavefrontMegaRaysPerSecond) +
+            ", \"frameMilliseconds\": { \"min\": " + FormatNumber(wavefrontSorted.front()) + ", \"p50\": " + FormatNumber(GetPercentile(wavefrontSorted, 50.0)) +
+            ", \"max\": " + FormatNumber(wavefrontSorted.back()) + " }, \"stageMilliseconds\": { \"generate\": " + FormatNumber(wavefront.generateMilliseconds / frameCount) +
+            ", \"extend\": " + FormatNumber(wavefront.extendMilliseconds / frameCount) + ", \"sort\": " + FormatNumber(wavefront.sortMilliseconds / frameCount) +
+            ", \"shade\": " + FormatNumber(wavefront.shadeMilliseconds / frameCount) + ", \"connect\": " + FormatNumber(wavefront.connectMilliseconds / frameCount) +
+            " }, \"bounces\": " + FormatNumber(static_cast<double>(wavefront.bounceCount) / frameCount) +
+            ", \"hitRatio\": " + FormatNumber(static_cast<double>(wavefront.hitCount) / static_cast<double>(wavefront.rayCount)) +
+            ", \"shadowRayRatio\": " + FormatNumber(static_cast<double>(wavefront.shadowRayCount) / static_cast<double>(wavefront.rayCount)) +
+            ", \"visibleShadowRayRatio\": " + FormatNumber(wavefront.shadowRayCount > 0 ? static_cast<double>(wavefront.visibleShadowRayCount) / static_cast<double>(wavefront.shadowRayCount) : 0.0) +
+            ", \"valid\": " + std::string(result.isWavefrontValid ? "true" : "false") + " } }" + (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    json += "  ],\n";
+
+    json += "  \"pathTracing\": { \"width\": " + std::to_string(pathWidth) + ", \"height\": " + std::to_string(pathHeight) +
+        ", \"samples\": " + std::to_string(numPathSamples) + ", \"referenceSamples\": " + std::to_string(numReferenceSamples) +
+        ", \"converging\": " + std::string(isPathTracingConverging ? "true" : "false") + ", \"samplers\": [\n";
+    for (uint32_t type = 0; type < numSamplerTypes; ++type)
+    {
+        const SamplerResult& samplerResult = samplerResults[type];
+        std::string errors;
+        for (size_t i = 0; i < samplerResult.errors.size(); ++i)
+        {
+            errors += (i > 0 ? ", \"" : "\"") + std::to_string(samplerResult.errorSamples[i]) + "\": " + FormatNumber(samplerResult.errors[i]);
+        }
+        json += "    { \"sampler\": \"" + std::string(GetSamplerTypeName(static_cast<SamplerType>(type))) + "\"" +
+            ", \"mraysPerSecond\": " + FormatNumber(static_cast<double>(samplerResult.rayCount) / (samplerResult.milliseconds * 1000.0)) +
+            ", \"raysPerPath\": " + FormatNumber(static_cast<double>(samplerResult.rayCount) / (static_cast<double>(pathWidth) * pathHeight * numPathSamples)) +
+            ",\n      \"rmse\": { " + errors + " }" +
+            ", \"furnaceMean\": " + FormatTriple(samplerResult.furnaceMean.mean) + ", \"furnaceStandardError\": " + FormatTriple(samplerResult.furnaceMean.standardError) +
+            ", \"furnaceValid\": " + std::string(samplerResult.isFurnaceValid ? "true" : "false") + " }" + (type + 1 < numSamplerTypes ? ",\n" : "\n");
+    }
+    json += "  ], \"nee\": [\n";
+    for (size_t i = 0; i < std::size(neeResults); ++i)
+    {
+        const NeeResult& neeResult = neeResults[i];
+        json += "    { \"maxBounces\": " + std::to_string(neeResult.maxBounces) + ", \"meanDifference\": " + FormatTriple(neeResult.difference.mean) +
+            ", \"standardError\": " + FormatTriple(neeResult.difference.standardError) + ", \"valid\": " +
+            std::string(neeResult.isValid ? "true" : "false") + " }" + (i + 1 < std::size(neeResults) ? ",\n" : "\n");
+    }
+    json += "  ] },\n";
+
+    passed = passed && isSceneDeterministic && isImageDeterministic;
+    json += "  \"checks\": { \"sceneDeterministic\": " + std::string(isSceneDeterministic ? "true" : "false") +
+        ", \"imageDeterministic\": " + std::string(isImageDeterministic ? "true" : "false") + ", \"passed\": " + std::string(passed ? "true" : "false") + " }\n";
+    json += "}\n";
+
+    if (outputPath.empty())
+    {
+        fputs(json.c_str(), stdout);
+    }
+    else
+    {
+        FILE* file = OpenFileStream(outputPath.c_str(), "wb");
+        if (!file)
+        {
+            printf("Failed to create %s\n", outputPath.c_str());
+            return 1;
+        }
+        fwrite(json.data(), 1, json.size(), file);
+        fclose(file);
+        printf("Wrote %s\n", outputPath.c_str());
+    }
+    // On stderr, so that stdout stays valid JSON
+    fprintf(stderr, "%s\n", passed ? "PASS" : "FAIL");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,322 @@
+// Checks the bookkeeping of ReadbackQueue on the CPU. TakePendingRegions() must merge overlapping and exactly adjacent
+// requests and never merge requests with a gap between them, so that the copy regions cover exactly the requested
+// bytes. Retire() must resolve only the batches whose fence value has completed and invoke their callbacks in ticket
+// order with the data at their offset. IsReady() and GetNumUnresolvedRequests() must follow the tickets through
+// Request(), TakePendingRegions(), Submit() and Retire(). Random sequences of requests, command lists, submissions and
+// fence completions are checked against a model of the same rules. Exits with 1 when a check fails.
+//
+// Build (Linux):
+//   g++ -std=c++20 -O2 -Isrc tools/ReadbackQueueTool.cpp src/ReadbackQueue.cpp -o ReadbackQueueTool
+// Build (Windows, Developer Command Prompt):
+//   cl /std:c++20 /O2 /EHsc /Isrc tools\ReadbackQueueTool.cpp src\ReadbackQueue.cpp /Fe:ReadbackQueueTool.exe
+//
+// Usage:
+//   ReadbackQueueTool [-iterations <count>] [-seed <value>]
+
+#include "ReadbackQueue.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+    // Size of the simulated readback resource of the random sequences
+    const uint32_t RESOURCE_SIZE = 512;
+    const uint32_t MAX_REQUEST_SIZE = 24;
+    const uint32_t NUM_RANDOM_STEPS = 200;
+
+    bool Check(bool condition, const char* description)
+    {
+        printf("%-72s %s\n", description, condition ? "ok" : "FAILED");
+        return condition;
+    }
+
+    bool IsRegion(const ReadbackRegion& region, uint64_t offset, uint64_t size)
+    {
+        return region.offset == offset && region.size == size;
+    }
+
+    // Mapped data of the simulated readback resource, the first byte of a request identifies its offset
+    uint8_t GetMappedByte(uint64_t offset)
+    {
+        return static_cast<uint8_t>(offset * 7 + 3);
+    }
+
+    std::vector<uint8_t> GetMappedData()
+    {
+        std::vector<uint8_t> mapped(RESOURCE_SIZE);
+        for (uint32_t i = 0; i < RESOURCE_SIZE; ++i)
+        {
+            mapped[i] = GetMappedByte(i);
+        }
+        return mapped;
+    }
+
+    // Regions sorted by offset with a gap between each other, covering exactly the requested bytes
+    bool IsExactCover(const std::vector<ReadbackRegion>& regions, const std::vector<bool>& isRequested)
+    {
+        std::vector<bool> isCopied(isRequested.size(), false);
+        for (size_t i = 0; i < regions.size(); ++i)
+        {
+            if (regions[i].size == 0 || regions[i].offset + regions[i].size > isCopied.size() ||
+                (i > 0 && regions[i].offset <= regions[i - 1].offset + regions[i - 1].size))
+            {
+                return false;
+            }
+            for (uint64_t byte = regions[i].offset; byte < regions[i].offset + regions[i].size; ++byte)
+            {
+                isCopied[byte] = true;
+            }
+        }
+        return isCopied == isRequested;
+    }
+
+    bool CheckCoalescing()
+    {
+        bool isPassed = true;
+        ReadbackQueue queue;
+
+        // [8, 24) and [0, 16) overlap, [24, 32) touches them and [4, 12) is inside
+        queue.Request(8, 16);
+        queue.Request(24, 8);
+        queue.Request(0, 16);
+        queue.Request(4, 8);
+        std::vector<ReadbackRegion> regions = queue.TakePendingRegions();
+        isPassed &= Check(regions.size() == 1 && IsRegion(regions[0], 0, 32), "overlapping and adjacent requests merge into one region");
+
+        // A gap of one byte keeps the regions apart, the bytes between them may be written by ResolveQueryData()
+        queue.Request(64, 16);
+        queue.Request(81, 15);
+        queue.Request(32, 8);
+        queue.Request(200, 4);
+        regions = queue.TakePendingRegions();
+        isPassed &= Check(regions.size() == 4 && IsRegion(regions[0], 32, 8) && IsRegion(regions[1], 64, 16) &&
+            IsRegion(regions[2], 81, 15) && IsRegion(regions[3], 200, 4), "requests with a gap never merge");
+
+        regions = queue.TakePendingRegions();
+        isPassed &= Check(regions.empty(), "recorded requests are not copied again");
+        return isPassed;
+    }
+
+    bool CheckRetire()
+    {
+        const std::vector<uint8_t> mapped = GetMappedData();
+        ReadbackQueue queue;
+        bool isPassed = true;
+        isPassed &= Check(!queue.IsReady(ReadbackQueue::INVALID_TICKET) && queue.GetNumUnresolvedRequests() == 0,
+            "an empty queue has no unresolved request");
+
+        // Three command lists signaling the fence values 1, 2 and 3 with two requests each
+        const uint64_t offsets[6] = { 16, 100, 40, 8, 200, 64 };
+        ReadbackQueue::Ticket tickets[6] = {};
+        std::vector<ReadbackQueue::Ticket> resolved;
+        bool isDataValid = true;
+        for (uint32_t batch = 0; batch < 3; ++batch)
+        {
+            for (uint32_t i = batch * 2; i < batch * 2 + 2; ++i)
+            {
+                tickets[i] = queue.Request(offsets[i], 4, [&, i](const void* data, uint64_t size)
+                {
+                    resolved.push_back(tickets[i]);
+                    isDataValid = isDataValid && size == 4 && *static_cast<const uint8_t*>(data) == GetMappedByte(offsets[i]);
+                });
+            }
+            if (batch == 0)
+            {
+                isPassed &= Check(queue.GetNumUnresolvedRequests() == 2 && !queue.IsReady(tickets[0]) && !queue.IsReady(tickets[1]),
+                    "pending requests are unresolved");
+            }
+            queue.TakePendingRegions();
+            if (batch == 0)
+            {
+                isPassed &= Check(queue.GetNumUnresolvedRequests() == 2 && !queue.IsReady(tickets[0]) && !queue.IsReady(tickets[1]),
+                    "recorded requests are unresolved");
+            }
+            queue.Submit(batch + 1);
+        }
+        isPassed &= Check(queue.GetNumUnresolvedRequests() == 6 && !queue.IsReady(tickets[0]), "submitted requests are unresolved");
+
+        isPassed &= Check(queue.Retire(0, mapped.data()) == 0 && resolved.empty() && queue.GetNumUnresolvedRequests() == 6,
+            "no batch retires before its fence value completes");
+
+        // Fence value 2 completed: the first two batches in ticket order, the last one stays in flight
+        const uint32_t numRetired = queue.Retire(2, mapped.data());
+        isPassed &= Check(numRetired == 4 && resolved.size() == 4 && resolved[0] == tickets[0] && resolved[1] == tickets[1] &&
+            resolved[2] == tickets[2] && resolved[3] == tickets[3], "batches at or below the completed fence retire in ticket order");
+        isPassed &= Check(isDataValid, "callbacks get the mapped data at their offset");
+        isPassed &= Check(queue.IsReady(tickets[3]) && !queue.IsReady(tickets[4]) && !queue.IsReady(tickets[5]) &&
+            queue.GetNumUnresolvedRequests() == 2, "only the retired tickets are ready");
+
+        // A request from a callback goes to the next command list
+        ReadbackQueue::Ticket nested = ReadbackQueue::INVALID_TICKET;
+        const ReadbackQueue::Ticket outer = queue.Request(120, 4, [&](const void*, uint64_t)
+        {
+            nested = queue.Request(124, 4);
+        });
+        queue.TakePendingRegions();
+        queue.Submit(4);
+        isPassed &= Check(queue.Retire(4, mapped.data()) == 3 && queue.IsReady(tickets[5]) && queue.IsReady(outer),
+            "a later fence value retires every earlier batch");
+        isPassed &= Check(nested != ReadbackQueue::INVALID_TICKET && !queue.IsReady(nested) && queue.GetNumUnresolvedRequests() == 1,
+            "a request from a callback is pending");
+        return isPassed;
+    }
+
+    struct RandomRunResult
+    {
+        bool isCoverExact;
+        bool isRetireOrdered;
+        bool isStateValid;
+        uint32_t numRequests;
+        uint32_t numRegions;
+    };
+
+    struct ModelRequest
+    {
+        uint64_t offset;
+        uint64_t size;
+        uint64_t fenceValue;    // 0 until submitted
+        bool isRecorded;
+    };
+
+    // Random requests, command lists, submissions and fence completions against a model of the tickets
+    RandomRunResult RunRandom(std::mt19937& random)
+    {
+        RandomRunResult result = { true, true, true, 0, 0 };
+        const std::vector<uint8_t> mapped = GetMappedData();
+
+        ReadbackQueue queue;
+        std::vector<ModelRequest> requests(1);      // by ticket, ticket 0 is invalid
+        std::vector<ReadbackQueue::Ticket> resolved;
+        uint64_t fenceValue = 0;
+        uint64_t completedFenceValue = 0;
+
+        std::uniform_int_distribution<uint32_t> actionDistribution(0, 9);
+        std::uniform_int_distribution<uint64_t> sizeDistribution(1, MAX_REQUEST_SIZE);
+        for (uint32_t step = 0; step < NUM_RANDOM_STEPS; ++step)
+        {
+            const uint32_t action = actionDistribution(random);
+            if (action < 5)
+            {
+                const uint64_t size = sizeDistribution(random);
+                const uint64_t offset = std::uniform_int_distribution<uint64_t>(0, RESOURCE_SIZE - size)(random);
+                const ReadbackQueue::Ticket expectedTicket = requests.size();
+                const ReadbackQueue::Ticket ticket = queue.Request(offset, size, [&, expectedTicket, offset, size](const void* data, uint64_t dataSize)
+                {
+                    result.isRetireOrdered = result.isRetireOrdered && dataSize == size &&
+                        *static_cast<const uint8_t*>(data) == GetMappedByte(offset);
+                    resolved.push_back(expectedTicket);
+                });
+                result.isStateValid = result.isStateValid && ticket == expectedTicket;
+                requests.push_back({ offset, size, 0, false });
+                ++result.numRequests;
+            }
+            else if (action < 7)
+            {
+                std::vector<bool> isRequested(RESOURCE_SIZE, false);
+                for (ModelRequest& request : requests)
+                {
+                    if (request.size > 0 && !request.isRecorded)
+                    {
+                        for (uint64_t byte = request.offset; byte < request.offset + request.size; ++byte)
+                        {
+                            isRequested[byte] = true;
+                        }
+                        request.isRecorded = true;
+                    }
+                }
+                const std::vector<ReadbackRegion> regions = queue.TakePendingRegions();
+                result.isCoverExact = result.isCoverExact && IsExactCover(regions, isRequested);
+                result.numRegions += static_cast<uint32_t>(regions.size());
+            }
+            else if (action < 8)
+            {
+                // The fence is signaled after every command list, with or without readbacks
+                queue.Submit(++fenceValue);
+                for (ModelRequest& request : requests)
+                {
+                    if (request.isRecorded && request.fenceValue == 0)
+                    {
+                        request.fenceValue = fenceValue;
+                    }
+                }
+            }
+            else
+            {
+                completedFenceValue = std::uniform_int_distribution<uint64_t>(completedFenceValue, fenceValue)(random);
+                const size_t numResolved = resolved.size();
+                const uint32_t numRetired = queue.Retire(completedFenceValue, mapped.data());
+                result.isRetireOrdered = result.isRetireOrdered && numRetired == resolved.size() - numResolved;
+            }
+
+            // Resolved in ticket order, ready exactly when the fence value of the ticket has completed
+            uint32_t numUnresolved = 0;
+            size_t numReady = 0;
+            for (ReadbackQueue::Ticket ticket = 1; ticket < requests.size(); ++ticket)
+            {
+                const bool isReady = requests[ticket].fenceValue != 0 && requests[ticket].fenceValue <= completedFenceValue;
+                numUnresolved += !isReady;
+                numReady += isReady;
+                result.isStateValid = result.isStateValid && queue.IsReady(ticket) == isReady;
+            }
+            result.isStateValid = result.isStateValid && queue.GetNumUnresolvedRequests() == numUnresolved;
+            result.isRetireOrdered = result.isRetireOrdered && resolved.size() == numReady;
+            for (size_t i = 0; i < resolved.size(); ++i)
+            {
+                result.isRetireOrdered = result.isRetireOrdered && resolved[i] == i + 1;
+            }
+        }
+        return result;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t numIterations = 2000;
+    uint32_t seed = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-iterations") == 0 && i + 1 < argc)
+        {
+            numIterations = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc)
+        {
+            seed = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else
+        {
+            printf("Usage: ReadbackQueueTool [-iterations <count>] [-seed <value>]\n");
+            return 1;
+        }
+    }
+
+    bool isPassed = CheckCoalescing();
+    isPassed &= CheckRetire();
+
+    std::mt19937 random(seed);
+    uint32_t numExactCovers = 0;
+    uint32_t numOrderedRetires = 0;
+    uint32_t numValidStates = 0;
+    uint64_t numRequests = 0;
+    uint64_t numRegions = 0;
+    for (uint32_t iteration = 0; iteration < numIterations; ++iteration)
+    {
+        const RandomRunResult result = RunRandom(random);
+        numExactCovers += result.isCoverExact;
+        numOrderedRetires += result.isRetireOrdered;
+        numValidStates += result.isStateValid;
+        numRequests += result.numRequests;
+        numRegions += result.numRegions;
+    }
+
+    printf("\n%u random sequences of %u steps\n", numIterations, NUM_RANDOM_STEPS);
+    printf("Copy regions: %.2f per request\n", numRequests > 0 ? static_cast<double>(numRegions) / static_cast<double>(numRequests) : 0.0);
+    isPassed &= Check(numExactCovers == numIterations, "every copy region list covers exactly the requested bytes");
+    isPassed &= Check(numOrderedRetires == numIterations, "every ticket retired in order once its fence value completed");
+    isPassed &= Check(numValidStates == numIterations, "every ready state and unresolved count matched");
+
+    return isPassed ? 0 : 1;
+}
@@ -0,0 +1,513 @@
+// Checks the flat scene graph of the instance transforms (SceneGraph) on random forests. Build() must reject parents
+// out of range and cycles, and lay out the nodes in preorder with exact subtree ends and the world transforms of a
+// reference composition. After random SetLocalTransform() calls, Update() must give the world transforms of a full
+// rebuild, update exactly the nodes of the dirty subtrees, and return exactly the instances of those subtrees as
+// sorted and merged ranges. On a large graph, moving one leaf must update that leaf only. Exits with 1 when a check
+// fails.
+//
+// SceneGraph uses DirectXMath, on Linux the headers of https://github.com/microsoft/DirectXMath and the sal.h of
+// https://github.com/microsoft/DirectX-Headers (include/wsl/stubs) are needed.
+//
+// Build (Linux):
+//   g++ -std=c++20 -O2 -pthread -Isrc -IDirectXMath/Inc -IDirectX-Headers/include/wsl/stubs tools/SceneGraphTool.cpp src/SceneGraph.cpp src/ThreadPool.cpp -o SceneGraphTool
+// Build (Windows, Developer Command Prompt):
+//   cl /std:c++20 /O2 /EHsc /Isrc tools\SceneGraphTool.cpp src\SceneGraph.cpp src\ThreadPool.cpp /Fe:SceneGraphTool.exe
+//
+// Usage:
+//   SceneGraphTool [-iterations <count>] [-nodes <count>] [-threads <count>] [-seed <value>]
+
+#include "SceneGraph.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+    const uint32_t MAX_RANDOM_NODES = 5000;
+    const uint32_t NUM_UPDATE_ROUNDS = 4;
+    const uint32_t MAX_INSTANCES_PER_NODE = 3;
+    const double MAX_TRANSFORM_ERROR = 1.0e-5;     // per level
+
+    void PrintUsage()
+    {
+        printf("Usage: SceneGraphTool [-iterations <count>] [-nodes <count>] [-threads <count>] [-seed <value>]\n");
+    }
+
+    bool Check(bool condition, const char* message)
+    {
+        if (!condition)
+        {
+            printf("%s\n", message);
+        }
+        return condition;
+    }
+
+    bool Check(bool condition, const char* message, uint32_t iteration)
+    {
+        if (!condition)
+        {
+            printf("Iteration %u: %s\n", iteration, message);
+        }
+        return condition;
+    }
+
+    XMFLOAT3X4 GetRandomTransform(std::mt19937& random)
+    {
+        // A rotation from a random unit quaternion, so that deep chains neither grow nor shrink
+        std::normal_distribution<float> normal;
+        float q[4] = { normal(random), normal(random), normal(random), normal(random) };
+        const float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+        for (float& value : q)
+        {
+            value /= std::max(length, 1.0e-6f);
+        }
+        const float x = q[0], y = q[1], z = q[2], w = q[3];
+
+        std::uniform_real_distribution<float> uniform(-10.0f, 10.0f);
+        XMFLOAT3X4 transform;
+        const float rotation[3][3] = {
+            { 1 - 2 * (y * y + z * z), 2 * (x * y - z * w), 2 * (x * z + y * w) },
+            { 2 * (x * y + z * w), 1 - 2 * (x * x + z * z), 2 * (y * z - x * w) },
+            { 2 * (x * z - y * w), 2 * (y * z + x * w), 1 - 2 * (x * x + y * y) },
+        };
+        for (uint32_t row = 0; row < 3; ++row)
+        {
+            for (uint32_t column = 0; column < 3; ++column)
+            {
+                transform.m[row][column] = rotation[row][column];
+            }
+            transform.m[row][3] = uniform(random);
+        }
+        return transform;
+    }
+
+    // Random forest with the descs in random order. The parent of a node is a random earlier node, the last node
+    // or none with the given probabilities, so that both wide and deep trees are made.
+    std::vector<SceneGraphNodeDesc> GenerateForest(uint32_t numNodes, float rootProbability, float chainProbability, std::mt19937& random)
+    {
+        std::vector<uint32_t> order(numNodes);
+        for (uint32_t i = 0; i < numNodes; ++i)
+        {
+            order[i] = i;
+        }
+        std::shuffle(order.begin(), order.end(), random);
+
+        std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        std::vector<SceneGraphNodeDesc> descs(numNodes);
+        for (uint32_t i = 0; i < numNodes; ++i)
+        {
+            SceneGraphNodeDesc& desc = descs[order[i]];
+            const float choice = uniform(random);
+            if (i == 0 || choice < rootProbability)
+            {
+                desc.parent = SceneGraph::INVALID_NODE;
+            }
+            else if (choice < rootProbability + chainProbability)
+            {
+                desc.parent = order[i - 1];
+            }
+            else
+            {
+                desc.parent = order[std::uniform_int_distribution<uint32_t>(0, i - 1)(random)];
+            }
+            desc.localTransform = GetRandomTransform(random);
+        }
+        return descs;
+    }
+
+    // Sorted node of every instance, up to MAX_INSTANCES_PER_NODE per node
+    std::vector<uint32_t> GenerateInstanceNodes(uint32_t numNodes, std::mt19937& random)
+    {
+        std::uniform_int_distribution<uint32_t> instanceCount(0, MAX_INSTANCES_PER_NODE);
+        std::vector<uint32_t> instanceNodes;
+        for (uint32_t node = 0; node < numNodes; ++node)
+        {
+            instanceNodes.insert(instanceNodes.end(), instanceCount(random), node);
+        }
+        return instanceNodes;
+    }
+
+    bool IsSameTransform(const XMFLOAT3X4& a, const XMFLOAT3X4& b)
+    {
+        return memcmp(&a, &b, sizeof(XMFLOAT3X4)) == 0;
+    }
+
+    // Composition of the 3x4 matrices in double, parent * local with an implicit last row of (0, 0, 0, 1)
+    struct Affine
+    {
+        double m[3][4];
+    };
+
+    Affine Compose(const Affine& parent, const XMFLOAT3X4& local)
+    {
+        Affine result;
+        for (uint32_t row = 0; row < 3; ++row)
+        {
+            for (uint32_t column = 0; column < 4; ++column)
+            {
+                double value = column == 3 ? parent.m[row][3] : 0.0;
+                for (uint32_t k = 0; k < 3; ++k)
+                {
+                    value += parent.m[row][k] * local.m[k][column];
+                }
+                result.m[row][column] = value;
+            }
+        }
+        return result;
+    }
+
+    // Largest difference of the world transforms to the reference composition, relative to the translation and per
+    // level of the node, as the float rounding accumulates along the path from the root
+    double GetMaxWorldError(const SceneGraph& graph)
+    {
+        const Affine identity = { { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 } } };
+        std::vector<Affine> worlds(graph.GetNodeCount());
+        std::vector<uint32_t> depths(graph.GetNodeCount(), 1);
+        double maxError = 0.0;
+        for (uint32_t node = 0; node < graph.GetNodeCount(); ++node)
+        {
+            const uint32_t parent = graph.GetParent(node);
+            worlds[node] = Compose(parent != SceneGraph::INVALID_NODE ? worlds[parent] : identity, graph.GetLocalTransform(node));
+            depths[node] = parent != SceneGraph::INVALID_NODE ? depths[parent] + 1 : 1;
+            const XMFLOAT3X4& world = graph.GetWorldTransform(node);
+            for (uint32_t row = 0; row < 3; ++row)
+            {
+                for (uint32_t column = 0; column < 4; ++column)
+                {
+                    const double scale = column == 3 ? std::max(1.0, std::abs(worlds[node].m[row][3])) : 1.0;
+                    maxError = std::max(maxError, std::abs(world.m[row][column] - worlds[node].m[row][column]) / (scale * depths[node]));
+                }
+            }
+        }
+        return maxError;
+    }
+
+    // The nodes are a preorder of the descs: a parent before its children, every subtree contiguous
+    bool CheckLayout(const SceneGraph& graph, const std::vector<SceneGraphNodeDesc>& descs, const std::vector<uint32_t>& nodeIndices,
+        uint32_t iteration)
+    {
+        const uint32_t numNodes = graph.GetNodeCount();
+        std::vector<uint8_t> isUsed(numNodes, 0);
+        for (uint32_t i = 0; i < descs.size(); ++i)
+        {
+            const uint32_t node = nodeIndices[i];
+            if (!Check(node < numNodes && !isUsed[node], "The node indices are not a permutation", iteration))
+            {
+                return false;
+            }
+            isUsed[node] = 1;
+
+            const uint32_t expectedParent =
+                descs[i].parent != SceneGraph::INVALID_NODE ? nodeIndices[descs[i].parent] : SceneGraph::INVALID_NODE;
+            if (!Check(graph.GetParent(node) == expectedParent && IsSameTransform(graph.GetLocalTransform(node), descs[i].localTransform),
+                "A node has the wrong parent or local transform", iteration))
+            {
+                return false;
+            }
+        }
+
+        // The subtree of a node is the node and its descendants
+        std::vector<uint32_t> subtreeSizes(numNodes, 1);
+        for (uint32_t node = numNodes; node-- > 0;)
+        {
+            const uint32_t parent = graph.GetParent(node);
+            if (parent != SceneGraph::INVALID_NODE)
+            {
+                if (!Check(parent < node, "A child is before its parent", iteration))
+                {
+                    return false;
+                }
+                subtreeSizes[parent] += subtreeSizes[node];
+            }
+        }
+        for (uint32_t node = 0; node < numNodes; ++node)
+        {
+            const uint32_t parent = graph.GetParent(node);
+            if (!Check(graph.GetSubtreeEnd(node) == node + subtreeSizes[node] &&
+                (parent == SceneGraph::INVALID_NODE || graph.GetSubtreeEnd(node) <= graph.GetSubtreeEnd(parent)),
+                "A subtree is not contiguous", iteration))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool CheckInvalidGraphs(std::mt19937& random)
+    {
+        const uint32_t INVALID = SceneGraph::INVALID_NODE;
+        const XMFLOAT3X4 transform = GetRandomTransform(random);
+        struct Case
+        {
+            const char* name;
+            std::vector<uint32_t> parents;
+        };
+        const Case cases[] = {
+            { "parent out of range", { INVALID, 0, 3 } },
+            { "parent out of range of a root-less graph", { 5 } },
+            { "node parented to itself", { INVALID, 1, 0 } },
+            { "two node cycle", { INVALID, 2, 1, 0 } },
+            { "cycle below a valid tree", { INVALID, 0, 1, 4, 5, 3 } },
+            { "graph without a root", { 1, 2, 0 } },
+        };
+
+        bool passed = true;
+        for (const Case& c : cases)
+        {
+            std::vector<SceneGraphNodeDesc> descs;
+            for (uint32_t parent : c.parents)
+            {
+                descs.push_back({ parent, transform });
+            }
+            SceneGraph graph;
+            std::vector<uint32_t> nodeIndices;
+            if (graph.Build(descs, nodeIndices))
+            {
+                printf("The graph with a %s was accepted\n", c.name);
+                passed = false;
+            }
+        }
+
+        // Random forests with one parent redirected into the subtree of its node
+        for (uint32_t i = 0; i < 100; ++i)
+        {
+            std::vector<SceneGraphNodeDesc> descs = GenerateForest(64, 0.1f, 0.5f, random);
+            SceneGraph graph;
+            std::vector<uint32_t> nodeIndices;
+            graph.Build(descs, nodeIndices);
+            std::vector<uint32_t> descIndices(descs.size());
+            for (uint32_t desc = 0; desc < descs.size(); ++desc)
+            {
+                descIndices[nodeIndices[desc]] = desc;
+            }
+            const uint32_t node = std::uniform_int_distribution<uint32_t>(0, graph.GetNodeCount() - 1)(random);
+            const uint32_t descendant = std::uniform_int_distribution<uint32_t>(node, graph.GetSubtreeEnd(node) - 1)(random);
+            descs[descIndices[node]].parent = descIndices[descendant];
+            passed = Check(!graph.Build(descs, nodeIndices), "A random cycle was accepted", i) && passed;
+        }
+        return passed;
+    }
+
+    // Instances of the nodes flagged as updated, as maximal runs
+    std::vector<SceneGraphInstanceRange> GetExpectedRanges(const SceneGraph& graph, const std::vector<uint8_t>& isNodeUpdated)
+    {
+        std::vector<SceneGraphInstanceRange> ranges;
+        for (uint32_t instance = 0; instance < graph.GetInstanceCount(); ++instance)
+        {
+            if (!isNodeUpdated[graph.GetInstanceNode(instance)])
+            {
+                continue;
+            }
+            if (!ranges.empty() && ranges.back().end == instance)
+            {
+                ranges.back().end++;
+            }
+            else
+            {
+                ranges.push_back({ instance, instance + 1 });
+            }
+        }
+        return ranges;
+    }
+
+    bool IsSameRanges(const std::vector<SceneGraphInstanceRange>& a, const std::vector<SceneGraphInstanceRange>& b)
+    {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(),
+            [](const SceneGraphInstanceRange& x, const SceneGraphInstanceRange& y) { return x.begin == y.begin && x.end == y.end; });
+    }
+
+    // Rounds of random moves against a full rebuild of the moved descs
+    bool CheckRandomUpdates(uint32_t iteration, std::mt19937& random, ThreadPool& threadPool)
+    {
+        const uint32_t numNodes = std::uniform_int_distribution<uint32_t>(1, MAX_RANDOM_NODES)(random);
+        std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        std::vector<SceneGraphNodeDesc> descs = GenerateForest(numNodes, 0.05f * uniform(random), uniform(random), random);
+
+        SceneGraph graph;
+        std::vector<uint32_t> nodeIndices;
+        if (!Check(graph.Build(descs, nodeIndices), "A forest was rejected", iteration) ||
+            !CheckLayout(graph, descs, nodeIndices, iteration) ||
+            !Check(GetMaxWorldError(graph) < MAX_TRANSFORM_ERROR, "Wrong world transforms after the build", iteration))
+        {
+            return false;
+        }
+        graph.SetInstanceNodes(GenerateInstanceNodes(numNodes, random));
+
+        std::vector<uint32_t> descIndices(numNodes);
+        for (uint32_t desc = 0; desc < numNodes; ++desc)
+        {
+            descIndices[nodeIndices[desc]] = desc;
+        }
+
+        std::uniform_int_distribution<uint32_t> randomNode(0, numNodes - 1);
+        for (uint32_t round = 0; round < NUM_UPDATE_ROUNDS; ++round)
+        {
+            // Some nodes are moved twice or inside the subtree of another moved node
+            std::vector<uint8_t> isNodeUpdated(numNodes, 0);
+            const uint32_t numMoves = std::uniform_int_distribution<uint32_t>(0, 8)(random);
+            for (uint32_t move = 0; move < numMoves; ++move)
+            {
+                const uint32_t node = randomNode(random);
+                const XMFLOAT3X4 transform = GetRandomTransform(random);
+                graph.SetLocalTransform(node, XMLoadFloat3x4(&transform));
+                descs[descIndices[node]].localTransform = transform;
+                std::fill(isNodeUpdated.begin() + node, isNodeUpdated.begin() + graph.GetSubtreeEnd(node), 1);
+            }
+            if (!Check(graph.IsDirty() == (numMoves > 0), "Wrong dirty state", iteration))
+            {
+                return false;
+            }
+
+            std::vector<SceneGraphInstanceRange> changedInstances;
+            const uint32_t numUpdated = graph.Update(threadPool, changedInstances);
+            const uint32_t expectedUpdated = static_cast<uint32_t>(std::count(isNodeUpdated.begin(), isNodeUpdated.end(), 1));
+            if (!Check(numUpdated == expectedUpdated && !graph.IsDirty(), "The update did not update the dirty subtrees exactly",
+                iteration) ||
+                !Check(IsSameRanges(changedInstances, GetExpectedRanges(graph, isNodeUpdated)),
+                "The changed instance ranges are not the merged ranges of the dirty subtrees", iteration))
+            {
+                return false;
+            }
+
+            SceneGraph rebuilt;
+            std::vector<uint32_t> rebuiltIndices;
+            rebuilt.Build(descs, rebuiltIndices);
+            bool isMatching = rebuiltIndices == nodeIndices;
+            for (uint32_t node = 0; isMatching && node < numNodes; ++node)
+            {
+                isMatching = IsSameTransform(graph.GetWorldTransform(node), rebuilt.GetWorldTransform(node));
+            }
+            if (!Check(isMatching, "The updated world transforms differ from a full rebuild", iteration))
+            {
+                return false;
+            }
+        }
+
+        // Nothing to do without a move
+        std::vector<SceneGraphInstanceRange> changedInstances;
+        return Check(graph.Update(threadPool, changedInstances) == 0 && changedInstances.empty(), "An update without a move did work",
+            iteration);
+    }
+
+    double MillisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // One leaf of a large graph is moved: only that node changes, only its instances are returned
+    bool CheckLeafUpdate(uint32_t numNodes, std::mt19937& random, ThreadPool& threadPool)
+    {
+        const std::vector<SceneGraphNodeDesc> descs = GenerateForest(numNodes, 0.001f, 0.3f, random);
+        SceneGraph graph;
+        std::vector<uint32_t> nodeIndices;
+        auto startTime = std::chrono::steady_clock::now();
+        if (!Check(graph.Build(descs, nodeIndices), "The large forest was rejected"))
+        {
+            return false;
+        }
+        const double buildMilliseconds = MillisecondsSince(startTime);
+        graph.SetInstanceNodes(GenerateInstanceNodes(numNodes, random));
+
+        // A leaf with instances
+        std::vector<uint32_t> leaves;
+        for (uint32_t instance = 0; instance < graph.GetInstanceCount(); ++instance)
+        {
+            const uint32_t node = graph.GetInstanceNode(instance);
+            if (graph.GetSubtreeEnd(node) == node + 1 && (leaves.empty() || leaves.back() != node))
+            {
+                leaves.push_back(node);
+            }
+        }
+        if (!Check(!leaves.empty(), "The large forest has no leaf with instances"))
+        {
+            return false;
+        }
+        const uint32_t leaf = leaves[std::uniform_int_distribution<size_t>(0, leaves.size() - 1)(random)];
+
+        const std::vector<XMFLOAT3X4> previousWorlds = [&]()
+        {
+            std::vector<XMFLOAT3X4> worlds(numNodes);
+            for (uint32_t node = 0; node < numNodes; ++node)
+            {
+                worlds[node] = graph.GetWorldTransform(node);
+            }
+            return worlds;
+        }();
+
+        const XMFLOAT3X4 transform = GetRandomTransform(random);
+        graph.SetLocalTransform(leaf, XMLoadFloat3x4(&transform));
+        std::vector<SceneGraphInstanceRange> changedInstances;
+        startTime = std::chrono::steady_clock::now();
+        const uint32_t numUpdated = graph.Update(threadPool, changedInstances);
+        const double updateMilliseconds = MillisecondsSince(startTime);
+
+        std::vector<uint8_t> isNodeUpdated(numNodes, 0);
+        isNodeUpdated[leaf] = 1;
+        bool passed = Check(numUpdated == 1, "Moving a leaf updated more than the leaf");
+        passed = Check(IsSameRanges(changedInstances, GetExpectedRanges(graph, isNodeUpdated)),
+            "Moving a leaf did not return exactly its instances") && passed;
+        bool isUnchanged = true;
+        for (uint32_t node = 0; node < numNodes; ++node)
+        {
+            isUnchanged = isUnchanged && (node == leaf || IsSameTransform(graph.GetWorldTransform(node), previousWorlds[node]));
+        }
+        passed = Check(isUnchanged, "Moving a leaf changed the world transform of another node") && passed;
+        passed = Check(GetMaxWorldError(graph) < MAX_TRANSFORM_ERROR, "Wrong world transforms after moving a leaf") && passed;
+
+        printf("%u nodes, %u instances: leaf update %.3f ms (%u node, %zu range), full build %.3f ms\n", numNodes,
+            graph.GetInstanceCount(), updateMilliseconds, numUpdated, changedInstances.size(), buildMilliseconds);
+        return passed;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t numIterations = 200;
+    uint32_t numLargeNodes = 100000;
+    uint32_t numThreads = 0;
+    uint32_t seed = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-iterations") == 0 && i + 1 < argc)
+        {
+            numIterations = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "-nodes") == 0 && i + 1 < argc)
+        {
+            numLargeNodes = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+        {
+            numThreads = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc)
+        {
+            seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+    numLargeNodes = std::max(numLargeNodes, 2u);
+
+    ThreadPool threadPool(numThreads);
+    std::mt19937 random(seed);
+    bool passed = CheckInvalidGraphs(random);
+    for (uint32_t iteration = 0; iteration < numIterations; ++iteration)
+    {
+        passed = CheckRandomUpdates(iteration, random, threadPool) && passed;
+    }
+    printf("%u random forests of up to %u nodes, %u update rounds each\n", numIterations, MAX_RANDOM_NODES, NUM_UPDATE_ROUNDS);
+    passed = CheckLeafUpdate(numLargeNodes, random, threadPool) && passed;
+
+    printf("%s\n", passed ? "PASS" : "FAIL");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,337 @@
+// Measures cold and warm loads of a scene pack (ScenePack) of generated mesh streams, and checks that the loaded data
+// is intact and that a pack is invalidated by changed sources, settings and truncation. A load is the map and
+// validation of the pack plus the parallel copy of every stream into a preallocated buffer, like the upload into the
+// geometry heap. Exits with 1 when a check fails.
+//
+// The cold load evicts the pack from the page cache first, which is supported on Linux only. On Windows the first
+// load after writing is usually warm; empty the standby list (e.g. with RAMMap) before running for a cold number.
+//
+// Build (Linux):
+//   g++ -std=c++20 -O2 -pthread -Isrc tools/ScenePackBenchmark.cpp src/ScenePack.cpp src/Hash.cpp src/MappedFile.cpp src/ThreadPool.cpp -o ScenePackBenchmark
+// Build (Windows, Developer Command Prompt):
+//   cl /std:c++20 /O2 /EHsc /Isrc tools\ScenePackBenchmark.cpp src\ScenePack.cpp src\Hash.cpp src\MappedFile.cpp src\ThreadPool.cpp /Fe:ScenePackBenchmark.exe
+//
+// Usage:
+//   ScenePackBenchmark [-size <MB>] [-meshes <count>] [-threads <count>] [-iterations <count>] [-output <directory>]
+
+#include "Hash.h"
+#include "PlatformHelpers.h"
+#include "ScenePack.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const uint64_t SETTINGS_HASH = 0x5CE7E9AC4B1D2F30ull;
+    const uint32_t BYTES_PER_VERTEX = 12 + 8 + 24;  // float3 position, packed attributes, two triangles of 32-bit indices
+
+    struct GeneratedScene
+    {
+        std::vector<uint8_t> data;
+        std::vector<ScenePackMesh> meshes;
+        std::vector<ScenePackInstance> instances;
+        std::vector<uint64_t> meshHashes;
+    };
+
+    void PrintUsage()
+    {
+        printf("Usage: ScenePackBenchmark [-size <MB>] [-meshes <count>] [-threads <count>] [-iterations <count>] [-output <directory>]\n");
+    }
+
+    double MillisecondsSince(std::chrono::steady_clock::time_point startTime)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    }
+
+    uint64_t HashMesh(const void* positions, const void* attributes, const void* indices, const ScenePackMesh& mesh)
+    {
+        uint64_t hash = Hash64(positions, static_cast<size_t>(mesh.positionDataSize));
+        hash = Hash64(attributes, static_cast<size_t>(mesh.attributeDataSize), hash);
+        return Hash64(indices, static_cast<size_t>(mesh.indexDataSize), hash);
+    }
+
+    // Random streams, the content does not matter for the pack
+    GeneratedScene GenerateScene(uint64_t size, uint32_t numMeshes, ThreadPool& threadPool)
+    {
+        GeneratedScene scene;
+        const uint32_t vertexCount = static_cast<uint32_t>(std::max<uint64_t>(size / numMeshes / BYTES_PER_VERTEX, 3));
+        const uint64_t positionSize = static_cast<uint64_t>(vertexCount) * 12;
+        const uint64_t attributeSize = static_cast<uint64_t>(vertexCount) * 8;
+        const uint64_t indexSize = static_cast<uint64_t>(vertexCount) * 2 * 3 * 4;
+        const uint64_t meshSize = positionSize + attributeSize + indexSize;
+        scene.data.resize(static_cast<size_t>(meshSize * numMeshes));
+
+        scene.meshes.resize(numMeshes);
+        scene.meshHashes.resize(numMeshes);
+        threadPool.ParallelFor(numMeshes, [&](uint32_t i)
+        {
+            uint8_t* base = scene.data.data() + meshSize * i;
+            uint64_t state = 0x9E3779B97F4A7C15ull * (i + 1);
+            for (uint64_t offset = 0; offset + 8 <= meshSize; offset += 8)
+            {
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+                memcpy(base + offset, &state, sizeof(state));
+            }
+
+            ScenePackMesh& mesh = scene.meshes[i];
+            mesh = {};
+            mesh.name = "mesh_" + std::to_string(i);
+            mesh.positionData = base;
+            mesh.positionDataSize = positionSize;
+            mesh.attributeData = base + positionSize;
+            mesh.attributeDataSize = attributeSize;
+            mesh.indexData = base + positionSize + attributeSize;
+            mesh.indexDataSize = indexSize;
+            mesh.vertexCount = vertexCount;
+            mesh.indexCount = static_cast<uint32_t>(indexSize / 4);
+            mesh.indexStride = 4;
+            mesh.geometryTransform[0] = mesh.geometryTransform[5] = mesh.geometryTransform[10] = 1.0f;
+            scene.meshHashes[i] = HashMesh(mesh.positionData, mesh.attributeData, mesh.indexData, mesh);
+        });
+
+        for (uint32_t i = 0; i < numMeshes * 4; ++i)
+        {
+            ScenePackInstance instance = {};
+            instance.meshIndex = i % numMeshes;
+            instance.transform[0][0] = instance.transform[1][1] = instance.transform[2][2] = 1.0f;
+            instance.transform[0][3] = static_cast<float>(i);
+            scene.instances.push_back(instance);
+        }
+        return scene;
+    }
+
+    // Drop the pages of a file from the page cache
+    bool EvictFromPageCache(const std::string& path)
+    {
+#ifdef _WIN32
+        (void)path;
+        return false;
+#else
+        const int file = open(path.c_str(), O_RDONLY);
+        if (file < 0)
+        {
+            return false;
+        }
+        const bool isEvicted = fdatasync(file) == 0 && posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED) == 0;
+        close(file);
+        return isEvicted;
+#endif
+    }
+
+    struct Measurement
+    {
+        double openMilliseconds;
+        double copyMilliseconds;
+        uint64_t dataSize;
+        bool isIntact;
+    };
+
+    // Open the pack and copy every stream into the destination in parallel, one task per mesh
+    bool Load(const std::string& path, const GeneratedScene& expected, std::vector<uint8_t>& destination, ThreadPool& threadPool, Measurement& measurement)
+    {
+        const auto startTime = std::chrono::steady_clock::now();
+        ScenePack pack;
+        ScenePackStats stats = {};
+        std::string error;
+        if (!pack.Open(path.c_str(), SETTINGS_HASH, threadPool, &stats, &error))
+        {
+            printf("  failed to open the pack: %s\n", error.c_str());
+            return false;
+        }
+        measurement.openMilliseconds = MillisecondsSince(startTime);
+
+        const std::vector<ScenePackMesh>& meshes = pack.GetMeshes();
+        std::vector<uint64_t> offsets(meshes.size() + 1, 0);
+        for (size_t i = 0; i < meshes.size(); ++i)
+        {
+            offsets[i + 1] = offsets[i] + meshes[i].positionDataSize + meshes[i].attributeDataSize + meshes[i].indexDataSize;
+        }
+        if (destination.size() < offsets.back())
+        {
+            printf("  unexpected data size\n");
+            return false;
+        }
+
+        const auto copyStartTime = std::chrono::steady_clock::now();
+        threadPool.ParallelFor(static_cast<uint32_t>(meshes.size()), [&](uint32_t i)
+        {
+            uint8_t* p = destination.data() + offsets[i];
+            memcpy(p, meshes[i].positionData, static_cast<size_t>(meshes[i].positionDataSize));
+            p += meshes[i].positionDataSize;
+            memcpy(p, meshes[i].attributeData, static_cast<size_t>(meshes[i].attributeDataSize));
+            p += meshes[i].attributeDataSize;
+            memcpy(p, meshes[i].indexData, static_cast<size_t>(meshes[i].indexDataSize));
+        });
+        measurement.copyMilliseconds = MillisecondsSince(copyStartTime);
+        measurement.dataSize = offsets.back();
+
+        // Compare the copies with the generated streams
+        measurement.isIntact = meshes.size() == expected.meshes.size() && pack.GetInstances().size() == expected.instances.size() &&
+            memcmp(pack.GetInstances().data(), expected.instances.data(), expected.instances.size() * sizeof(ScenePackInstance)) == 0;
+        for (size_t i = 0; measurement.isIntact && i < meshes.size(); ++i)
+        {
+            const uint8_t* p = destination.data() + offsets[i];
+            measurement.isIntact = meshes[i].name == expected.meshes[i].name &&
+                HashMesh(p, p + meshes[i].positionDataSize, p + meshes[i].positionDataSize + meshes[i].attributeDataSize, meshes[i]) == expected.meshHashes[i];
+        }
+        return true;
+    }
+
+    void PrintMeasurement(const char* label, const Measurement& measurement)
+    {
+        const double totalMilliseconds = measurement.openMilliseconds + measurement.copyMilliseconds;
+        printf("=== %s ===\n", label);
+        printf("  open + validate : %8.3f ms\n", measurement.openMilliseconds);
+        printf("  copy streams    : %8.1f ms (%.2f GB/s)\n", measurement.copyMilliseconds, static_cast<double>(measurement.dataSize) / 1.0e9 / (measurement.copyMilliseconds / 1000.0));
+        printf("  total           : %8.1f ms (%.2f GB/s), data %s\n", totalMilliseconds, static_cast<double>(measurement.dataSize) / 1.0e9 / (totalMilliseconds / 1000.0),
+            measurement.isIntact ? "intact" : "CORRUPT");
+    }
+
+    bool CheckRejected(const char* label, const std::string& path, uint64_t settingsHash, ThreadPool& threadPool)
+    {
+        ScenePack pack;
+        std::string error;
+        const bool isRejected = !pack.Open(path.c_str(), settingsHash, threadPool, nullptr, &error);
+        printf("Invalidation, %s: %s%s%s\n", label, isRejected ? "PASS (" : "FAIL", isRejected ? error.c_str() : "", isRejected ? ")" : "");
+        return isRejected;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint64_t sizeMB = 1024;
+    uint32_t numMeshes = 64;
+    uint32_t numThreads = 0;
+    uint32_t numIterations = 3;
+    std::string directory = ".";
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-size") == 0 && i + 1 < argc)
+        {
+            sizeMB = std::max<uint64_t>(strtoull(argv[++i], nullptr, 10), 1);
+        }
+        else if (strcmp(argv[i], "-meshes") == 0 && i + 1 < argc)
+        {
+            numMeshes = std::max(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 1u);
+        }
+        else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+        {
+            numThreads = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "-iterations") == 0 && i + 1 < argc)
+        {
+            numIterations = std::max(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 1u);
+        }
+        else if (strcmp(argv[i], "-output") == 0 && i + 1 < argc)
+        {
+            directory = argv[++i];
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    ThreadPool threadPool(numThreads);
+    const GeneratedScene scene = GenerateScene(sizeMB * 1024 * 1024, numMeshes, threadPool);
+
+    // A small stand-in for the scene file the pack was built from
+    const std::string sourcePath = directory + "/ScenePackBenchmark.obj";
+    const std::string packPath = GetScenePackPath(sourcePath);
+    {
+        FILE* file = OpenFileStream(sourcePath.c_str(), "wb");
+        if (!file)
+        {
+            printf("Failed to create %s\n", sourcePath.c_str());
+            return 1;
+        }
+        fwrite(scene.data.data(), 1, std::min<size_t>(scene.data.size(), 1024 * 1024), file);
+        fclose(file);
+    }
+
+    ScenePackStats writeStats = {};
+    std::string error;
+    if (!WriteScenePack(packPath.c_str(), SETTINGS_HASH, { sourcePath }, scene.meshes, scene.instances, threadPool, &writeStats, &error))
+    {
+        printf("Failed to write the pack: %s\n", error.c_str());
+        return 1;
+    }
+    printf("Pack: %.1f MB, %u meshes, %u instances, written in %.1f ms (%.2f GB/s) on %u threads\n",
+        static_cast<double>(writeStats.fileSize) / (1024.0 * 1024.0), writeStats.numMeshes, writeStats.numInstances, writeStats.milliseconds,
+        static_cast<double>(writeStats.fileSize) / 1.0e9 / (writeStats.milliseconds / 1000.0), threadPool.GetNumThreads());
+
+    // The destination is touched before the measurements, like the upload heap which is created up front
+    std::vector<uint8_t> destination(scene.data.size(), 0);
+
+    bool passed = true;
+    Measurement cold = {};
+    const bool isEvicted = EvictFromPageCache(packPath);
+    passed = Load(packPath, scene, destination, threadPool, cold) && cold.isIntact && passed;
+    PrintMeasurement(isEvicted ? "cold (evicted from the page cache)" : "first load (not evicted, see the notes of the tool)", cold);
+
+    Measurement warm = {};
+    warm.openMilliseconds = 1.0e30;
+    for (uint32_t i = 0; i < numIterations; ++i)
+    {
+        Measurement measurement = {};
+        passed = Load(packPath, scene, destination, threadPool, measurement) && measurement.isIntact && passed;
+        if (measurement.openMilliseconds + measurement.copyMilliseconds < warm.openMilliseconds + warm.copyMilliseconds)
+        {
+            warm = measurement;
+        }
+    }
+    PrintMeasurement("warm (best)", warm);
+    printf("Speedup warm over cold: %.2fx\n", (cold.openMilliseconds + cold.copyMilliseconds) / (warm.openMilliseconds + warm.copyMilliseconds));
+
+    // A touched but unchanged source is hashed and accepted
+    {
+        std::error_code errorCode;
+        std::filesystem::last_write_time(sourcePath, std::filesystem::last_write_time(sourcePath) + std::chrono::seconds(10), errorCode);
+        ScenePack pack;
+        ScenePackStats stats = {};
+        const bool isAccepted = pack.Open(packPath.c_str(), SETTINGS_HASH, threadPool, &stats, &error) && stats.numHashedSources == 1;
+        printf("Invalidation, touched source with the same content: %s\n", isAccepted ? "PASS (accepted after hashing)" : "FAIL");
+        passed = passed && isAccepted;
+    }
+
+    passed = CheckRejected("different settings", packPath, SETTINGS_HASH + 1, threadPool) && passed;
+
+    // Same size, different content
+    {
+        FILE* file = OpenFileStream(sourcePath.c_str(), "r+b");
+        if (file)
+        {
+            const int first = fgetc(file);
+            SeekFile(file, 0);
+            fputc(first ^ 0x5A, file);
+            fclose(file);
+        }
+        std::error_code errorCode;
+        std::filesystem::last_write_time(sourcePath, std::filesystem::last_write_time(sourcePath) + std::chrono::seconds(10), errorCode);
+    }
+    passed = CheckRejected("changed source", packPath, SETTINGS_HASH, threadPool) && passed;
+
+    std::filesystem::resize_file(packPath, writeStats.fileSize - 1);
+    passed = CheckRejected("truncated pack", packPath, SETTINGS_HASH, threadPool) && passed;
+
+    remove(packPath.c_str());
+    remove(sourcePath.c_str());
+    printf("%s\n", passed ? "PASS" : "FAIL");
+    return passed ? 0 : 1;
+}
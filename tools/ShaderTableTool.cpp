@@ -0,0 +1,199 @@
+// Checks the shader table layout (ShaderTableLayout) against the DXR alignment and indexing rules on random tables:
+// every section and every ray generation record starts at the table alignment, the other records at the record
+// alignment, a stride holds the largest record of its section with less than one alignment of padding, the sections do
+// not overlap, and the hit group index of every (geometry, ray type) pair of AddHitGroupRecords() hits its own record.
+// The layout of the megakernel table and the rejection of a stride above the maximum are checked with fixed values.
+// Exits with 1 when a check fails.
+//
+// Build (Linux):
+//   g++ -std=c++20 -O2 -Isrc tools/ShaderTableTool.cpp src/ShaderTableLayout.cpp -o ShaderTableTool
+// Build (Windows, Developer Command Prompt):
+//   cl /std:c++20 /O2 /EHsc /Isrc tools\ShaderTableTool.cpp src\ShaderTableLayout.cpp /Fe:ShaderTableTool.exe
+//
+// Usage:
+//   ShaderTableTool [-iterations <count>] [-seed <value>]
+
+#include "ShaderTableLayout.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+    struct HitGroupRange
+    {
+        uint32_t firstIndex;
+        uint32_t geometryCount;
+        uint32_t rayTypeCount;
+    };
+
+    void PrintUsage()
+    {
+        printf("Usage: ShaderTableTool [-iterations <count>] [-seed <value>]\n");
+    }
+
+    bool Check(bool condition, const char* message, uint32_t iteration)
+    {
+        if (!condition)
+        {
+            printf("Iteration %u: %s\n", iteration, message);
+        }
+        return condition;
+    }
+
+    // Alignment, stride and overlap rules of a finalized layout
+    bool IsLayoutValid(const ShaderTableLayout& layout, uint32_t iteration)
+    {
+        bool isValid = true;
+        uint64_t previousEnd = 0;
+        for (uint32_t i = 0; i < static_cast<uint32_t>(ShaderTableSection::Count); ++i)
+        {
+            const ShaderTableSection section = static_cast<ShaderTableSection>(i);
+            const uint32_t recordCount = layout.GetRecordCount(section);
+            const uint32_t stride = layout.GetStride(section);
+            const uint64_t offset = layout.GetSectionOffset(section);
+            const uint32_t recordAlignment = section == ShaderTableSection::RayGen ? SHADER_TABLE_ALIGNMENT : SHADER_RECORD_ALIGNMENT;
+
+            uint32_t maxRecordSize = 0;
+            for (uint32_t record = 0; record < recordCount; ++record)
+            {
+                const uint32_t recordSize = SHADER_IDENTIFIER_SIZE + layout.GetLocalRootArgumentsSize(section, record);
+                maxRecordSize = std::max(maxRecordSize, recordSize);
+                const uint64_t recordOffset = layout.GetRecordOffset(section, record);
+                isValid = Check(recordOffset % recordAlignment == 0, "A record is not aligned", iteration) && isValid;
+                isValid = Check(recordOffset + recordSize <= offset + layout.GetSectionSize(section), "A record ends after its section", iteration) && isValid;
+            }
+
+            isValid = Check(offset % SHADER_TABLE_ALIGNMENT == 0, "A section is not aligned", iteration) && isValid;
+            isValid = Check(offset >= previousEnd, "Two sections overlap", iteration) && isValid;
+            isValid = Check(offset < previousEnd + SHADER_TABLE_ALIGNMENT, "A section has more padding than its alignment", iteration) && isValid;
+            if (recordCount > 0)
+            {
+                isValid = Check(stride % recordAlignment == 0, "A stride is not aligned", iteration) && isValid;
+                isValid = Check(stride >= maxRecordSize && stride < maxRecordSize + recordAlignment, "A stride is not the aligned largest record", iteration) && isValid;
+            }
+            else
+            {
+                isValid = Check(stride == 0, "An empty section has a stride", iteration) && isValid;
+            }
+            previousEnd = offset + layout.GetSectionSize(section);
+        }
+        return Check(layout.GetSize() == previousEnd, "The size is not the end of the last section", iteration) && isValid;
+    }
+
+    // Every (geometry, ray type) pair of a range selects its own record in the range
+    bool IsHitGroupIndexingValid(const ShaderTableLayout& layout, const HitGroupRange& range, uint32_t iteration)
+    {
+        std::vector<bool> isUsed(static_cast<size_t>(range.geometryCount) * range.rayTypeCount, false);
+        for (uint32_t geometry = 0; geometry < range.geometryCount; ++geometry)
+        {
+            for (uint32_t rayType = 0; rayType < range.rayTypeCount; ++rayType)
+            {
+                const uint32_t index = GetHitGroupRecordIndex(range.firstIndex, rayType, range.rayTypeCount, geometry);
+                if (!Check(index >= range.firstIndex && index - range.firstIndex < isUsed.size() && index < layout.GetRecordCount(ShaderTableSection::HitGroup),
+                    "A hit group index is outside of its records", iteration))
+                {
+                    return false;
+                }
+                if (!Check(!isUsed[index - range.firstIndex], "Two hit group indices select the same record", iteration))
+                {
+                    return false;
+                }
+                isUsed[index - range.firstIndex] = true;
+            }
+        }
+        return true;
+    }
+
+    // One ray generation record, and a miss and a hit group record per ray type as in Raytracing::CreateShaderTable()
+    bool IsMegakernelLayoutValid()
+    {
+        ShaderTableLayout layout;
+        layout.AddRecord(ShaderTableSection::RayGen, 0);
+        layout.AddRecord(ShaderTableSection::Miss, 0);
+        layout.AddRecord(ShaderTableSection::Miss, 0);
+        layout.AddHitGroupRecords(1, 2, 0);
+        const bool isValid = layout.Finalize() &&
+            layout.GetStride(ShaderTableSection::RayGen) == 64 && layout.GetSectionOffset(ShaderTableSection::Miss) == 64 &&
+            layout.GetStride(ShaderTableSection::Miss) == 32 && layout.GetSectionOffset(ShaderTableSection::HitGroup) == 128 &&
+            layout.GetStride(ShaderTableSection::HitGroup) == 32 && layout.GetSize() == 192;
+        return Check(isValid, "Unexpected megakernel table layout", 0);
+    }
+
+    bool IsStrideLimitChecked()
+    {
+        ShaderTableLayout layout;
+        layout.AddRecord(ShaderTableSection::Miss, MAX_SHADER_RECORD_STRIDE - SHADER_IDENTIFIER_SIZE);
+        bool isValid = Check(layout.Finalize(), "The largest stride is rejected", 0);
+        layout.AddRecord(ShaderTableSection::Miss, MAX_SHADER_RECORD_STRIDE - SHADER_IDENTIFIER_SIZE + 4);
+        isValid = Check(!layout.Finalize(), "A stride above the maximum is accepted", 0) && isValid;
+        return isValid;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t numIterations = 10000;
+    uint32_t seed = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-iterations") == 0 && i + 1 < argc)
+        {
+            numIterations = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc)
+        {
+            seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    bool passed = IsMegakernelLayoutValid() && IsStrideLimitChecked();
+
+    // Random tables with local root arguments of 4 byte multiples (root constants and 8 byte descriptors)
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<uint32_t> countDistribution(0, 6);
+    std::uniform_int_distribution<uint32_t> argumentsDistribution(0, 64);
+    uint64_t numRecords = 0;
+    for (uint32_t iteration = 0; iteration < numIterations && passed; ++iteration)
+    {
+        ShaderTableLayout layout;
+        std::vector<HitGroupRange> hitGroupRanges;
+        for (uint32_t i = 0; i < static_cast<uint32_t>(ShaderTableSection::Count); ++i)
+        {
+            const ShaderTableSection section = static_cast<ShaderTableSection>(i);
+            const uint32_t count = countDistribution(random);
+            for (uint32_t record = 0; record < count; ++record)
+            {
+                if (section == ShaderTableSection::HitGroup && random() % 2 == 0)
+                {
+                    HitGroupRange range = { 0, countDistribution(random) + 1, countDistribution(random) % 3 + 1 };
+                    range.firstIndex = layout.AddHitGroupRecords(range.geometryCount, range.rayTypeCount, argumentsDistribution(random) * 4);
+                    hitGroupRanges.push_back(range);
+                }
+                else
+                {
+                    layout.AddRecord(section, argumentsDistribution(random) * 4);
+                }
+            }
+            numRecords += layout.GetRecordCount(section);
+        }
+
+        passed = Check(layout.Finalize(), "A valid layout is rejected", iteration) && IsLayoutValid(layout, iteration);
+        for (const HitGroupRange& range : hitGroupRanges)
+        {
+            passed = passed && IsHitGroupIndexingValid(layout, range, iteration);
+        }
+    }
+
+    printf("%u tables, %llu records\n", numIterations, static_cast<unsigned long long>(numRecords));
+    printf("%s\n", passed ? "PASS" : "FAIL");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,224 @@
+// Measures the CPU write bandwidth of UploadWriter against plain memcpy into cached host memory and,
+// on Windows, into write-combined / uncached memory which behaves like mapped UPLOAD / GPU_UPLOAD heaps.
+//
+// Build (Linux):
+//   g++ -std=c++20 -O2 -Isrc tools/UploadBandwidthBenchmark.cpp src/UploadWriter.cpp -o UploadBandwidthBenchmark
+// Build (Windows, Developer Command Prompt):
+//   cl /std:c++20 /O2 /EHsc /Isrc tools\UploadBandwidthBenchmark.cpp src\UploadWriter.cpp /Fe:UploadBandwidthBenchmark.exe
+//   (add /arch:AVX2 to use the AVX streaming stores)
+//
+// Usage:
+//   UploadBandwidthBenchmark [-minBytes <bytes>] [-iterations <count>]
+
+#include "PlatformHelpers.h"
+#include "UploadWriter.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+    enum class MemoryKind
+    {
+        Cached,
+        WriteCombined,
+        Uncached,
+    };
+
+    const char* GetMemoryKindName(MemoryKind kind)
+    {
+        switch (kind)
+        {
+        case MemoryKind::Cached:        return "cached";
+        case MemoryKind::WriteCombined: return "write-combined";
+        case MemoryKind::Uncached:      return "uncached";
+        }
+        return "unknown";
+    }
+
+    void* AllocateMemory(MemoryKind kind, size_t size)
+    {
+#ifdef _WIN32
+        switch (kind)
+        {
+        case MemoryKind::Cached:
+            return VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+        case MemoryKind::WriteCombined:
+            return VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE | PAGE_WRITECOMBINE);
+        case MemoryKind::Uncached:
+            return VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE | PAGE_NOCACHE);
+        }
+        return nullptr;
+#else
+        // User mode has no way to request write-combined pages here
+        if (kind != MemoryKind::Cached)
+        {
+            return nullptr;
+        }
+        return std::aligned_alloc(4096, AlignSize(static_cast<uint64_t>(size), 4096));
+#endif
+    }
+
+    void FreeMemory(void* ptr)
+    {
+#ifdef _WIN32
+        VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+        std::free(ptr);
+#endif
+    }
+
+    // Size of the records of the scattered write tests, the size of a vertex of the scene
+    const size_t RECORD_SIZE = 40;
+
+    enum class Method
+    {
+        Memcpy,
+        StreamCopy,
+        MemcpyRecords,
+        UploadWriterRecords,
+    };
+
+    const char* GetMethodName(Method method)
+    {
+        switch (method)
+        {
+        case Method::Memcpy:              return "memcpy";
+        case Method::StreamCopy:          return "StreamCopy";
+        case Method::MemcpyRecords:       return "memcpy (40B records)";
+        case Method::UploadWriterRecords: return "UploadWriter (40B records)";
+        }
+        return "unknown";
+    }
+
+    void RunMethod(Method method, uint8_t* destination, const uint8_t* source, size_t size)
+    {
+        switch (method)
+        {
+        case Method::Memcpy:
+            memcpy(destination, source, size);
+            break;
+        case Method::StreamCopy:
+            StreamCopy(destination, source, size);
+            break;
+        case Method::MemcpyRecords:
+            for (size_t offset = 0; offset < size; offset += RECORD_SIZE)
+            {
+                memcpy(destination + offset, source + offset, std::min(RECORD_SIZE, size - offset));
+            }
+            break;
+        case Method::UploadWriterRecords:
+        {
+            UploadWriter writer(destination, size);
+            for (size_t offset = 0; offset < size; offset += RECORD_SIZE)
+            {
+                writer.Write(source + offset, std::min(RECORD_SIZE, size - offset));
+            }
+            writer.Flush();
+            break;
+        }
+        }
+    }
+
+    // Returns the bandwidth in GB/s, or a negative value when the written data is wrong
+    double Measure(Method method, uint8_t* destination, const uint8_t* source, size_t size, uint32_t iterations)
+    {
+        // Warm up the pages and the caches
+        RunMethod(method, destination, source, size);
+
+        const auto startTime = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; ++i)
+        {
+            RunMethod(method, destination, source, size);
+        }
+        const auto endTime = std::chrono::steady_clock::now();
+
+        // Reading uncached memory is slow, but it is outside of the measurement
+        if (memcmp(destination, source, size) != 0)
+        {
+            return -1.0;
+        }
+
+        const double seconds = std::chrono::duration<double>(endTime - startTime).count();
+        return static_cast<double>(size) * iterations / seconds / 1.0e9;
+    }
+
+    void PrintUsage()
+    {
+        printf("Usage: UploadBandwidthBenchmark [-minBytes <bytes>] [-iterations <count>]\n");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    // Bytes written per measurement; small buffers are repeated until this amount is reached
+    uint64_t minBytes = 1024ull * 1024 * 1024;
+    uint32_t maxIterations = 100000;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-minBytes") == 0 && i + 1 < argc)
+        {
+            minBytes = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "-iterations") == 0 && i + 1 < argc)
+        {
+            maxIterations = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    const size_t sizes[] = { 64 * 1024, 1024 * 1024, 16 * 1024 * 1024, 256 * 1024 * 1024 };
+    const MemoryKind memoryKinds[] = { MemoryKind::Cached, MemoryKind::WriteCombined, MemoryKind::Uncached };
+    const Method methods[] = { Method::Memcpy, Method::StreamCopy, Method::MemcpyRecords, Method::UploadWriterRecords };
+
+    const size_t maxSize = sizes[std::size(sizes) - 1];
+    std::vector<uint8_t> source(maxSize);
+    for (size_t i = 0; i < source.size(); ++i)
+    {
+        source[i] = static_cast<uint8_t>(i * 2654435761u >> 24);
+    }
+
+    printf("%-16s %10s  %-28s %10s\n", "memory", "size", "method", "GB/s");
+    for (MemoryKind kind : memoryKinds)
+    {
+        for (size_t size : sizes)
+        {
+            uint8_t* destination = static_cast<uint8_t*>(AllocateMemory(kind, size));
+            if (!destination)
+            {
+                printf("%-16s %10zu  %s memory is not available on this platform\n", GetMemoryKindName(kind), size, GetMemoryKindName(kind));
+                break;
+            }
+
+            // Uncached memory is orders of magnitude slower, keep its run time bounded
+            const uint64_t bytesToWrite = kind == MemoryKind::Uncached ? minBytes / 64 : minBytes;
+            const uint32_t iterations = static_cast<uint32_t>(std::clamp<uint64_t>(bytesToWrite / size, 1, maxIterations));
+
+            for (Method method : methods)
+            {
+                const double bandwidth = Measure(method, destination, source.data(), size, iterations);
+                if (bandwidth < 0.0)
+                {
+                    printf("%-16s %10zu  %-28s   MISMATCH\n", GetMemoryKindName(kind), size, GetMethodName(method));
+                    FreeMemory(destination);
+                    return 1;
+                }
+                printf("%-16s %10zu  %-28s %10.2f\n", GetMemoryKindName(kind), size, GetMethodName(method), bandwidth);
+            }
+
+            FreeMemory(destination);
+        }
+    }
+
+    return 0;
+}